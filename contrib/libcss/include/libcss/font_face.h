@@ -45,6 +45,14 @@ typedef enum css_font_face_format {
      */
 } css_font_face_format;
 
+typedef enum css_font_display {
+    CSS_FONT_DISPLAY_AUTO = 0,
+    CSS_FONT_DISPLAY_BLOCK = 1,
+    CSS_FONT_DISPLAY_SWAP = 2,
+    CSS_FONT_DISPLAY_FALLBACK = 3,
+    CSS_FONT_DISPLAY_OPTIONAL = 4
+} css_font_display;
+
 typedef enum css_font_face_location_type {
     CSS_FONT_FACE_LOCATION_TYPE_UNSPECIFIED = 0,
     CSS_FONT_FACE_LOCATION_TYPE_LOCAL = 1,
@@ -64,6 +72,7 @@ css_font_face_format css_font_face_src_format(const css_font_face_src *src);
 
 uint8_t css_font_face_font_style(const css_font_face *font_face);
 uint8_t css_font_face_font_weight(const css_font_face *font_face);
+css_font_display css_font_face_font_display(const css_font_face *font_face);
 
 #ifdef __cplusplus
 }
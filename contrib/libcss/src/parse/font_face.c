@@ -327,6 +327,46 @@ font_face_parse_font_weight(css_language *c, const parserutils_vector *vector, i
     return error;
 }
 
+static css_error
+font_face_parse_font_display(css_language *c, const parserutils_vector *vector, int32_t *ctx, css_font_face *font_face)
+{
+    int32_t orig_ctx = *ctx;
+    css_error error = CSS_OK;
+    const css_token *token;
+    css_font_display display = CSS_FONT_DISPLAY_AUTO;
+    bool match;
+
+    /* IDENT(auto, block, swap, fallback, optional) */
+
+    token = parserutils_vector_iterate(vector, ctx);
+    if ((token == NULL) || ((token->type != CSS_TOKEN_IDENT))) {
+        *ctx = orig_ctx;
+        return CSS_INVALID;
+    }
+
+    if ((lwc_string_caseless_isequal(token->idata, c->strings[AUTO], &match) == lwc_error_ok && match)) {
+        display = CSS_FONT_DISPLAY_AUTO;
+    } else if ((lwc_string_caseless_isequal(token->idata, c->strings[BLOCK], &match) == lwc_error_ok && match)) {
+        display = CSS_FONT_DISPLAY_BLOCK;
+    } else if ((lwc_string_caseless_isequal(token->idata, c->strings[SWAP], &match) == lwc_error_ok && match)) {
+        display = CSS_FONT_DISPLAY_SWAP;
+    } else if ((lwc_string_caseless_isequal(token->idata, c->strings[FALLBACK], &match) == lwc_error_ok && match)) {
+        display = CSS_FONT_DISPLAY_FALLBACK;
+    } else if ((lwc_string_caseless_isequal(token->idata, c->strings[OPTIONAL], &match) == lwc_error_ok && match)) {
+        display = CSS_FONT_DISPLAY_OPTIONAL;
+    } else {
+        error = CSS_INVALID;
+    }
+
+    if (error == CSS_OK) {
+        font_face->bits[1] = (font_face->bits[1] & 0xf8) | display;
+    } else {
+        *ctx = orig_ctx;
+    }
+
+    return error;
+}
+
 /**
  * Parse a descriptor in an @font-face rule
  *
@@ -366,6 +406,9 @@ css_error css__parse_font_descriptor(css_language *c, const css_token *descripto
     } else if (lwc_string_caseless_isequal(descriptor->idata, c->strings[FONT_WEIGHT], &match) == lwc_error_ok &&
         match) {
         return font_face_parse_font_weight(c, vector, ctx, font_face);
+    } else if (lwc_string_caseless_isequal(descriptor->idata, c->strings[FONT_DISPLAY], &match) == lwc_error_ok &&
+        match) {
+        return font_face_parse_font_display(c, vector, ctx, font_face);
     }
 
     return CSS_INVALID;
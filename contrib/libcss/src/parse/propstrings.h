@@ -361,6 +361,10 @@ enum {
     OPENTYPE,
     EMBEDDED_OPENTYPE,
     SVG,
+    FONT_DISPLAY,
+    SWAP,
+    FALLBACK,
+    OPTIONAL,
     COLUMN,
     AVOID_PAGE,
     AVOID_COLUMN,
@@ -25,7 +25,8 @@ static void font_faces_srcs_destroy(css_font_face *font_face)
     font_face->srcs = NULL;
 }
 
-static const css_font_face default_font_face = {NULL, NULL, 0, {(CSS_FONT_WEIGHT_NORMAL << 2) | CSS_FONT_STYLE_NORMAL}};
+static const css_font_face default_font_face = {
+    NULL, NULL, 0, {(CSS_FONT_WEIGHT_NORMAL << 2) | CSS_FONT_STYLE_NORMAL, CSS_FONT_DISPLAY_AUTO}};
 
 /**
  * Create a font-face
@@ -138,6 +139,17 @@ uint8_t css_font_face_font_weight(const css_font_face *font_face)
     return (font_face->bits[0] >> 2) & 0xf;
 }
 
+/**
+ * Get the display policy for a font-face.
+ *
+ * \param src  The font-face
+ * \return The display policy, as a css_font_display
+ */
+css_font_display css_font_face_font_display(const css_font_face *font_face)
+{
+    return font_face->bits[1] & 0x7;
+}
+
 /**
  * Get the number of potential src locations for a font-face
  *
@@ -33,8 +33,9 @@ struct css_font_face {
      *
      *    76543210
      *  1 __wwwwss	font-weight | font-style
+     *  2 _____ddd	font-display
      */
-    uint8_t bits[1];
+    uint8_t bits[2];
 };
 
 css_error css__font_face_create(css_font_face **result);
@@ -849,6 +849,15 @@ static css_error css_select_style__get_named_cousin(css_select_state *state, voi
 }
 
 
+/**
+ * Maximum number of candidate nodes to consider for style sharing.
+ *
+ * Nodes whose style depends on their position, such as the rows of a
+ * striped table, can never be shared with. Looking past every one of a long
+ * run of them for each node selected would be quadratic.
+ */
+#define SHARE_CANDIDATES_MAX 8
+
 /**
  * Get node_data for any node that we can reuse the style for.
  *
@@ -865,6 +874,7 @@ css_select_style__get_sharable_node_data(void *node, css_select_state *state, st
 {
     css_error error;
     enum share_candidate_type type = CANDIDATE_SIBLING;
+    unsigned int candidates;
 
     *sharable_node_data = NULL;
 
@@ -891,7 +901,7 @@ css_select_style__get_sharable_node_data(void *node, css_select_state *state, st
         return CSS_OK;
     }
 
-    while (true) {
+    for (candidates = 0; candidates < SHARE_CANDIDATES_MAX; candidates++) {
         void *share_candidate_node;
 
         /* Get previous sibling with same element name */
@@ -176,6 +176,11 @@ void _dom_node_unref_debug(dom_node *node, const char *file, int line);
 dom_exception _dom_node_contains(struct dom_node_internal *node, struct dom_node_internal *other, bool *contains);
 #define dom_node_contains(n, o, c) _dom_node_contains((dom_node_internal *)(n), (dom_node_internal *)(o), (c))
 
+/* The child list generation of a node's document changes whenever any node
+ * in the document gains or loses children */
+dom_exception _dom_node_get_child_list_generation(struct dom_node_internal *node, uint32_t *generation);
+#define dom_node_get_child_list_generation(n, g) _dom_node_get_child_list_generation((dom_node_internal *)(n), (g))
+
 /* All the rest are virtual */
 
 static inline dom_exception dom_node_get_node_name(struct dom_node *node, dom_string **result)
@@ -18,6 +18,7 @@
 #include <dom/events/mouse_multi_wheel_event.h>
 #include <dom/events/mouse_wheel_event.h>
 #include <dom/events/mutation_event.h>
+#include <dom/events/mutation_record.h>
 #include <dom/events/mutation_name_event.h>
 #include <dom/events/text_event.h>
 #include <dom/events/ui_event.h>
@@ -0,0 +1,72 @@
+/*
+ * This file is part of libdom.
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ * Copyright 2026 Wisp Contributors
+ */
+
+#ifndef dom_events_mutation_record_h_
+#define dom_events_mutation_record_h_
+
+#include <stdint.h>
+
+#include <dom/core/exceptions.h>
+#include <dom/core/string.h>
+#include <dom/events/mutation_event.h>
+
+struct dom_document;
+struct dom_node;
+
+/**
+ * The kind of change a mutation record describes
+ */
+typedef enum {
+    DOM_MUTATION_RECORD_CHILD_LIST = 0, /**< A child was added or removed */
+    DOM_MUTATION_RECORD_ATTRIBUTES, /**< An attribute was set or removed */
+    DOM_MUTATION_RECORD_CHARACTER_DATA /**< Character data was changed */
+} dom_mutation_record_type;
+
+/**
+ * A queued mutation record
+ *
+ * The nodes and the attribute name are only guaranteed to remain valid for
+ * the duration of the records callback.
+ */
+typedef struct dom_mutation_record {
+    dom_mutation_record_type type;
+    dom_mutation_type change; /**< Addition, removal or modification */
+    struct dom_node *target; /**< Parent, element or character data node */
+    struct dom_node *node; /**< Added or removed child or attribute */
+    dom_string *attr_name; /**< Name of a changed attribute */
+} dom_mutation_record;
+
+/**
+ * Callback receiving a batch of mutation records, oldest first
+ *
+ * \param doc    The document the records were queued on
+ * \param rec    The records
+ * \param count  The number of records
+ * \param pw     The observer's private data
+ */
+typedef void (*dom_mutation_records_callback)(
+    struct dom_document *doc, const dom_mutation_record *rec, uint32_t count, void *pw);
+
+/**
+ * Callback notifying that the first record has been queued since the last
+ * flush, so the observer can arrange for a checkpoint
+ *
+ * \param doc  The document the record was queued on
+ * \param pw   The observer's private data
+ */
+typedef void (*dom_mutation_pending_callback)(struct dom_document *doc, void *pw);
+
+dom_exception _dom_document_set_mutation_observer(struct dom_document *doc, dom_mutation_records_callback records,
+    dom_mutation_pending_callback pending, void *pw);
+#define dom_document_set_mutation_observer(d, r, p, pw)                                                                \
+    _dom_document_set_mutation_observer((struct dom_document *)(d), (dom_mutation_records_callback)(r),             \
+        (dom_mutation_pending_callback)(p), (void *)(pw))
+
+dom_exception _dom_document_flush_mutation_records(struct dom_document *doc);
+#define dom_document_flush_mutation_records(d) _dom_document_flush_mutation_records((struct dom_document *)(d))
+
+#endif
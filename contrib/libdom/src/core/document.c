@@ -264,6 +264,8 @@ dom_exception _dom_document_initialise(dom_document *doc, dom_events_default_act
     }
 
     doc->dispatching_mutation = 0;
+    doc->child_list_generation = 0;
+    _dom_mutation_queue_initialise(&doc->mutations);
 
     /* We should not pass a NULL when all things hook up */
     return _dom_document_event_internal_initialise(&doc->dei, daf, daf_ctx);
@@ -329,6 +331,7 @@ bool _dom_document_finalise(dom_document *doc)
     dom_string_unref(doc->_memo_domcharacterdatamodified);
     dom_string_unref(doc->_memo_domsubtreemodified);
 
+    _dom_mutation_queue_finalise(&doc->mutations);
     _dom_document_event_internal_finalise(&doc->dei);
 
     return true;
@@ -1071,6 +1074,9 @@ dom_exception _dom_document_adopt_node(dom_document *doc, dom_node *node, dom_no
         return err;
     }
 
+    /* The node keeps its listeners when adopted */
+    _dom_node_adopt_event_listeners(n, (dom_node_internal *)*result);
+
     parent = n->parent;
     if (parent != NULL) {
         err = dom_node_remove_child(parent, node, (void *)&tmp);
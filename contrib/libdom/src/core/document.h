@@ -32,6 +32,7 @@
 #include "utils/list.h"
 
 #include "events/document_event.h"
+#include "events/mutation_record.h"
 
 struct dom_doc_nl;
 
@@ -76,6 +77,11 @@ struct dom_document {
     dom_string *_memo_domsubtreemodified; /**< DOMSubtreeModified */
 
     uint32_t dispatching_mutation; /**< Mutation event semaphore */
+
+    uint32_t child_list_generation; /**< Changed whenever a node in the
+                                     * document gains or loses children */
+
+    struct dom_mutation_queue mutations; /**< Queued mutation records */
 };
 
 /* Create a DOM document */
@@ -326,10 +326,13 @@ void _dom_node_finalise(dom_node_internal *node)
     }
 
     /* If the node has no owner document, we need not to finalise its
-     * dom_event_target_internal structure.
+     * dom_event_target_internal structure. Its listeners no longer count
+     * towards the document.
      */
-    if (node->owner != NULL)
+    if (node->owner != NULL) {
+        _dom_mutation_listeners_changed(node->owner, &node->eti, false);
         _dom_event_target_internal_finalise(&node->eti);
+    }
 
     /* Detach from the pending list, if we are in it,
      * this part of code should always be the end of this function. */
@@ -373,6 +376,25 @@ dom_exception _dom_node_contains(struct dom_node_internal *node, struct dom_node
     return DOM_NO_ERR;
 }
 
+/**
+ * Retrieve the child list generation of a node's document
+ *
+ * \param node        The node
+ * \param generation  Pointer to location to receive the generation
+ * \return DOM_NO_ERR.
+ *
+ * Two calls return the same generation only if no node in the document
+ * gained or lost children in between.
+ */
+dom_exception _dom_node_get_child_list_generation(struct dom_node_internal *node, uint32_t *generation)
+{
+    assert(node != NULL);
+    assert(generation != NULL);
+
+    *generation = (node->owner != NULL) ? node->owner->child_list_generation : 0;
+    return DOM_NO_ERR;
+}
+
 
 /* ---------------------------------------------------------------------*/
 
@@ -2046,6 +2068,17 @@ bool _dom_node_readonly(const dom_node_internal *node)
     return false;
 }
 
+/**
+ * Note that a node has gained or lost children
+ *
+ * \param parent  The node whose child list changed
+ */
+static inline void _dom_node_child_list_changed(dom_node_internal *parent)
+{
+    if (parent->owner != NULL)
+        parent->owner->child_list_generation++;
+}
+
 /**
  * Attach a node to the tree
  *
@@ -2107,6 +2140,8 @@ dom_exception _dom_node_attach_range(dom_node_internal *first, dom_node_internal
     else
         parent->last_child = last;
 
+    _dom_node_child_list_changed(parent);
+
     for (n = first; n != last->next; n = n->next) {
         n->parent = parent;
         /* Dispatch a DOMNodeInserted event */
@@ -2149,6 +2184,8 @@ dom_exception _dom_node_detach_range(dom_node_internal *first, dom_node_internal
         last->parent->last_child = first->previous;
 
     parent = first->parent;
+    _dom_node_child_list_changed(parent);
+
     for (n = first; n != last->next; n = n->next) {
         /* Dispatch a DOMNodeRemoval event */
         err = dom_node_dispatch_node_change_event(n->owner, n, n->parent, DOM_MUTATION_REMOVAL, &success);
@@ -2187,11 +2224,14 @@ void _dom_node_replace(dom_node_internal *old, dom_node_internal *replacement)
         last = replacement->last_child;
 
         replacement->first_child = replacement->last_child = NULL;
+        _dom_node_child_list_changed(replacement);
     } else {
         first = replacement;
         last = replacement;
     }
 
+    _dom_node_child_list_changed(old->parent);
+
     if (first == NULL) {
         /* All we're doing is removing old */
         if (old->previous == NULL) {
@@ -2325,39 +2365,110 @@ void _dom_node_remove_pending(dom_node_internal *node)
  * Event Target API                                                           *
  ******************************************************************************/
 
+/* Find the document whose mutation listener count covers a node */
+static inline dom_document *_dom_node_event_document(dom_node_internal *node)
+{
+    if (node->type == DOM_DOCUMENT_NODE)
+        return (dom_document *)node;
+
+    return node->owner;
+}
+
 dom_exception
 _dom_node_add_event_listener(dom_event_target *et, dom_string *type, struct dom_event_listener *listener, bool capture)
 {
     dom_node_internal *node = (dom_node_internal *)et;
+    dom_exception err;
+
+    err = _dom_event_target_add_event_listener(&node->eti, type, listener, capture);
+    if (err == DOM_NO_ERR)
+        _dom_mutation_listener_changed(_dom_node_event_document(node), type, true);
 
-    return _dom_event_target_add_event_listener(&node->eti, type, listener, capture);
+    return err;
 }
 
 dom_exception _dom_node_remove_event_listener(
     dom_event_target *et, dom_string *type, struct dom_event_listener *listener, bool capture)
 {
     dom_node_internal *node = (dom_node_internal *)et;
+    dom_exception err;
+
+    /* A removal matches any number of registrations, even none */
+    _dom_mutation_listeners_changed(_dom_node_event_document(node), &node->eti, false);
+    err = _dom_event_target_remove_event_listener(&node->eti, type, listener, capture);
+    _dom_mutation_listeners_changed(_dom_node_event_document(node), &node->eti, true);
 
-    return _dom_event_target_remove_event_listener(&node->eti, type, listener, capture);
+    return err;
 }
 
 dom_exception _dom_node_add_event_listener_ns(
     dom_event_target *et, dom_string *namespace, dom_string *type, struct dom_event_listener *listener, bool capture)
 {
     dom_node_internal *node = (dom_node_internal *)et;
+    dom_exception err;
 
-    return _dom_event_target_add_event_listener_ns(&node->eti, namespace, type, listener, capture);
+    err = _dom_event_target_add_event_listener_ns(&node->eti, namespace, type, listener, capture);
+    if (err == DOM_NO_ERR)
+        _dom_mutation_listener_changed(_dom_node_event_document(node), type, true);
+
+    return err;
 }
 
 dom_exception _dom_node_remove_event_listener_ns(
     dom_event_target *et, dom_string *namespace, dom_string *type, struct dom_event_listener *listener, bool capture)
 {
     dom_node_internal *node = (dom_node_internal *)et;
+    dom_exception err;
 
-    return _dom_event_target_remove_event_listener_ns(&node->eti, namespace, type, listener, capture);
+    /* A removal matches any number of registrations, even none */
+    _dom_mutation_listeners_changed(_dom_node_event_document(node), &node->eti, false);
+    err = _dom_event_target_remove_event_listener_ns(&node->eti, namespace, type, listener, capture);
+    _dom_mutation_listeners_changed(_dom_node_event_document(node), &node->eti, true);
+
+    return err;
 }
 
 
+/**
+ * Move the event listeners of a subtree to its adopted copy
+ *
+ * Adopting a node copies it, so the listeners registered on the original
+ * subtree are moved to the matching nodes of the copy, and the mutation
+ * listener counts of the documents involved are moved with them.
+ *
+ * \param from  The adopted node
+ * \param to    The deep copy of ::from
+ */
+void _dom_node_adopt_event_listeners(dom_node_internal *from, dom_node_internal *to)
+{
+    struct listener_entry *le;
+
+    _dom_mutation_listeners_changed(_dom_node_event_document(from), &from->eti, false);
+
+    while (from->eti.listeners != NULL) {
+        le = from->eti.listeners;
+        if (le->list.next == &le->list) {
+            from->eti.listeners = NULL;
+        } else {
+            from->eti.listeners = (struct listener_entry *)le->list.next;
+        }
+        list_del(&le->list);
+
+        if (to->eti.listeners == NULL) {
+            to->eti.listeners = le;
+        } else {
+            list_append(&to->eti.listeners->list, &le->list);
+        }
+        _dom_mutation_listener_changed(_dom_node_event_document(to), le->type, true);
+    }
+
+    /* The copy has the same children, in the same order */
+    for (from = from->first_child, to = to->first_child; from != NULL && to != NULL;
+         from = from->next, to = to->next) {
+        _dom_node_adopt_event_listeners(from, to);
+    }
+}
+
 /** Helper for allocating/expanding array of event targets */
 static inline dom_exception _dom_event_targets_expand(uint32_t *ntargets_allocated, dom_event_target ***targets)
 {
@@ -2603,6 +2714,12 @@ dom_exception _dom_node_dispatch_node_change_event(
     if (err != DOM_NO_ERR)
         return err;
 
+    /* Nothing would see the document change events */
+    if (!_dom_mutation_event_wanted(doc,
+            (change == DOM_MUTATION_ADDITION) ? doc->_memo_domnodeinsertedintodocument
+                                              : doc->_memo_domnoderemovedfromdocument))
+        return DOM_NO_ERR;
+
     /* Fire document change event at subtree */
     target = node->first_child;
     while (target != NULL) {
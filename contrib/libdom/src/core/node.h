@@ -207,6 +207,9 @@ void _dom_node_mark_pending(dom_node_internal *node);
 void _dom_node_remove_pending(dom_node_internal *node);
 #define dom_node_remove_pending(n) _dom_node_remove_pending((dom_node_internal *)(n))
 
+/* Move the event listeners of a subtree to its adopted copy */
+void _dom_node_adopt_event_listeners(dom_node_internal *from, dom_node_internal *to);
+
 dom_exception _dom_node_dispatch_node_change_event(
     dom_document *doc, dom_node_internal *node, dom_node_internal *related, dom_mutation_type change, bool *success);
 #define dom_node_dispatch_node_change_event(doc, node, related, change, success)                                       \
@@ -10,6 +10,7 @@
 #include "core/document.h"
 #include "events/dispatch.h"
 #include "events/mutation_event.h"
+#include "events/mutation_record.h"
 
 #include "utils/utils.h"
 
@@ -30,7 +31,20 @@ dom_exception __dom_dispatch_node_change_event(
     dom_string *type = NULL;
     dom_exception err;
 
-    err = _dom_mutation_event_create(&evt);
+    /* Attributes are reported by __dom_dispatch_attr_modified_event */
+    if (((dom_node_internal *)et)->type != DOM_ATTRIBUTE_NODE) {
+        err = _dom_mutation_record_queue(
+            doc, DOM_MUTATION_RECORD_CHILD_LIST, change, (struct dom_node *)related, (struct dom_node *)et, NULL);
+        if (err != DOM_NO_ERR)
+            return err;
+    }
+
+    *success = true;
+    if (!_dom_mutation_event_wanted(
+            doc, (change == DOM_MUTATION_ADDITION) ? doc->_memo_domnodeinserted : doc->_memo_domnoderemoved))
+        return DOM_NO_ERR;
+
+    err = _dom_mutation_event_acquire(doc, &evt);
     if (err != DOM_NO_ERR)
         return err;
 
@@ -54,7 +68,7 @@ dom_exception __dom_dispatch_node_change_event(
         goto cleanup;
 
 cleanup:
-    dom_event_unref(evt);
+    _dom_mutation_event_release(doc, evt);
 
     return err;
 }
@@ -75,7 +89,13 @@ dom_exception __dom_dispatch_node_change_document_event(
     dom_string *type = NULL;
     dom_exception err;
 
-    err = _dom_mutation_event_create(&evt);
+    *success = true;
+    if (!_dom_mutation_event_wanted(doc,
+            (change == DOM_MUTATION_ADDITION) ? doc->_memo_domnodeinsertedintodocument
+                                              : doc->_memo_domnoderemovedfromdocument))
+        return DOM_NO_ERR;
+
+    err = _dom_mutation_event_acquire(doc, &evt);
     if (err != DOM_NO_ERR)
         return err;
 
@@ -98,7 +118,7 @@ dom_exception __dom_dispatch_node_change_document_event(
         goto cleanup;
 
 cleanup:
-    dom_event_unref(evt);
+    _dom_mutation_event_release(doc, evt);
 
     return err;
 }
@@ -123,6 +143,15 @@ dom_exception __dom_dispatch_attr_modified_event(dom_document *doc, dom_event_ta
     dom_string *type = NULL;
     dom_exception err;
 
+    err = _dom_mutation_record_queue(
+        doc, DOM_MUTATION_RECORD_ATTRIBUTES, change, (struct dom_node *)et, (struct dom_node *)related, attr_name);
+    if (err != DOM_NO_ERR)
+        return err;
+
+    *success = true;
+    if (!_dom_mutation_event_wanted(doc, doc->_memo_domattrmodified))
+        return DOM_NO_ERR;
+
     err = _dom_mutation_event_create(&evt);
     if (err != DOM_NO_ERR)
         return err;
@@ -165,6 +194,15 @@ dom_exception __dom_dispatch_characterdata_modified_event(
     dom_string *type = NULL;
     dom_exception err;
 
+    err = _dom_mutation_record_queue(
+        doc, DOM_MUTATION_RECORD_CHARACTER_DATA, DOM_MUTATION_MODIFICATION, (struct dom_node *)et, NULL, NULL);
+    if (err != DOM_NO_ERR)
+        return err;
+
+    *success = true;
+    if (!_dom_mutation_event_wanted(doc, doc->_memo_domcharacterdatamodified))
+        return DOM_NO_ERR;
+
     err = _dom_mutation_event_create(&evt);
     if (err != DOM_NO_ERR)
         return err;
@@ -199,6 +237,10 @@ dom_exception __dom_dispatch_subtree_modified_event(dom_document *doc, dom_event
     dom_string *type = NULL;
     dom_exception err;
 
+    *success = true;
+    if (!_dom_mutation_event_wanted(doc, doc->_memo_domsubtreemodified))
+        return DOM_NO_ERR;
+
     err = _dom_mutation_event_create(&evt);
     if (err != DOM_NO_ERR)
         return err;
@@ -0,0 +1,359 @@
+/*
+ * This file is part of libdom.
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ * Copyright 2026 Wisp Contributors
+ */
+
+#include <stdlib.h>
+
+#include "core/document.h"
+#include "events/event_target.h"
+#include "events/mutation_event.h"
+#include "events/mutation_record.h"
+
+#include "utils/utils.h"
+
+/** Number of records allocated when a queue is first used */
+#define MUTATION_QUEUE_INITIAL 64
+
+/**
+ * Release the references held by a batch of records
+ *
+ * \param rec    The records
+ * \param count  The number of records
+ */
+static void _dom_mutation_records_release(dom_mutation_record *rec, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        dom_node_unref(rec[i].target);
+        if (rec[i].node != NULL)
+            dom_node_unref(rec[i].node);
+        if (rec[i].attr_name != NULL)
+            dom_string_unref(rec[i].attr_name);
+    }
+}
+
+/**
+ * Initialise a mutation record queue
+ *
+ * \param queue  The queue to initialise
+ */
+void _dom_mutation_queue_initialise(struct dom_mutation_queue *queue)
+{
+    queue->records = NULL;
+    queue->count = 0;
+    queue->capacity = 0;
+    queue->callback = NULL;
+    queue->pending = NULL;
+    queue->pw = NULL;
+    queue->listeners = 0;
+    queue->actions_known = 0;
+    queue->actions = 0;
+    queue->spare = NULL;
+}
+
+/**
+ * Finalise a mutation record queue, discarding any queued records
+ *
+ * \param queue  The queue to finalise
+ */
+void _dom_mutation_queue_finalise(struct dom_mutation_queue *queue)
+{
+    _dom_mutation_records_release(queue->records, queue->count);
+    free(queue->records);
+    queue->records = NULL;
+    queue->count = 0;
+    queue->capacity = 0;
+
+    if (queue->spare != NULL) {
+        _dom_mutation_event_destroy(queue->spare);
+        queue->spare = NULL;
+    }
+}
+
+/**
+ * Queue a mutation record if the document is being observed
+ *
+ * \param doc        The document
+ * \param type       The kind of change
+ * \param change     Whether something was added, removed or modified
+ * \param target     The parent, element or character data node changed
+ * \param node       The child or attribute added or removed, or NULL
+ * \param attr_name  The name of a changed attribute, or NULL
+ * \return DOM_NO_ERR on success, DOM_NO_MEM_ERR on memory exhaustion.
+ */
+dom_exception _dom_mutation_record_queue(dom_document *doc, dom_mutation_record_type type, dom_mutation_type change,
+    struct dom_node *target, struct dom_node *node, dom_string *attr_name)
+{
+    struct dom_mutation_queue *queue = &doc->mutations;
+    dom_mutation_record *rec;
+
+    if (queue->callback == NULL || target == NULL)
+        return DOM_NO_ERR;
+
+    if (queue->count == queue->capacity) {
+        uint32_t capacity = (queue->capacity == 0) ? MUTATION_QUEUE_INITIAL : queue->capacity * 2;
+
+        rec = realloc(queue->records, capacity * sizeof(*rec));
+        if (rec == NULL)
+            return DOM_NO_MEM_ERR;
+
+        queue->records = rec;
+        queue->capacity = capacity;
+    }
+
+    rec = &queue->records[queue->count++];
+    rec->type = type;
+    rec->change = change;
+    rec->target = dom_node_ref(target);
+    rec->node = (node != NULL) ? dom_node_ref(node) : NULL;
+    rec->attr_name = (attr_name != NULL) ? dom_string_ref(attr_name) : NULL;
+
+    if (queue->count == 1 && queue->pending != NULL)
+        queue->pending(doc, queue->pw);
+
+    return DOM_NO_ERR;
+}
+
+/**
+ * Find the index of a mutation event type
+ *
+ * \param doc   The document
+ * \param type  The event type
+ * \return the index of the type, or -1 if it is not a mutation event type
+ */
+static int _dom_mutation_event_index(dom_document *doc, dom_string *type)
+{
+    dom_string *types[] = {doc->_memo_domnodeinserted, doc->_memo_domnoderemoved,
+        doc->_memo_domnodeinsertedintodocument, doc->_memo_domnoderemovedfromdocument, doc->_memo_domattrmodified,
+        doc->_memo_domcharacterdatamodified, doc->_memo_domsubtreemodified};
+    int count = (int)(sizeof(types) / sizeof(types[0]));
+    int i;
+
+    /* Events dispatched by libdom itself use the memoised strings */
+    for (i = 0; i < count; i++) {
+        if (type == types[i])
+            return i;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (dom_string_isequal(type, types[i]))
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Note a mutation event listener being added to or removed from a node
+ *
+ * \param doc    The document owning the node
+ * \param type   The type of event listened for
+ * \param added  true if the listener was added, false if removed
+ */
+void _dom_mutation_listener_changed(dom_document *doc, dom_string *type, bool added)
+{
+    struct dom_mutation_queue *queue;
+
+    if (doc == NULL || type == NULL || _dom_mutation_event_index(doc, type) < 0)
+        return;
+
+    queue = &doc->mutations;
+    if (added) {
+        queue->listeners++;
+    } else if (queue->listeners > 0) {
+        queue->listeners--;
+    }
+}
+
+/**
+ * Note every mutation event listener of a node being added or removed
+ *
+ * Used when a node's listeners start or stop counting towards a document
+ * as a whole: when they are moved to another node, when the node is
+ * finalised, and around removals which may match any number of them.
+ *
+ * \param doc    The document the node's listeners count towards
+ * \param eti    The node's event target
+ * \param added  true if the listeners were added, false if removed
+ */
+void _dom_mutation_listeners_changed(dom_document *doc, struct dom_event_target_internal *eti, bool added)
+{
+    struct listener_entry *le = eti->listeners;
+
+    if (le == NULL)
+        return;
+
+    do {
+        _dom_mutation_listener_changed(doc, le->type, added);
+        le = (struct listener_entry *)le->list.next;
+    } while (le != eti->listeners);
+}
+
+/**
+ * Determine whether a mutation event would be observed by anything
+ *
+ * Listeners are counted per document rather than per node, so this may
+ * report an event as wanted when none of its targets listen for it.
+ *
+ * \param doc   The document
+ * \param type  The mutation event type
+ * \return true if a listener or default action may see the event
+ */
+bool _dom_mutation_event_wanted(dom_document *doc, dom_string *type)
+{
+    struct dom_mutation_queue *queue = &doc->mutations;
+    dom_events_default_action_fetcher actions = doc->dei.actions;
+    uint32_t bit;
+    int index;
+
+    if (queue->listeners > 0)
+        return true;
+
+    if (actions == NULL)
+        return false;
+
+    index = _dom_mutation_event_index(doc, type);
+    if (index < 0)
+        return true;
+    bit = 1u << index;
+
+    if ((queue->actions_known & bit) == 0) {
+        void *pw = doc->dei.actions_ctx;
+
+        /* The finished phase only tidies up after an event, it is
+         * not a reason to create one */
+        if (actions(type, DOM_DEFAULT_ACTION_STARTED, &pw) != NULL ||
+            actions(type, DOM_DEFAULT_ACTION_PREVENTED, &pw) != NULL ||
+            actions(type, DOM_DEFAULT_ACTION_END, &pw) != NULL) {
+            queue->actions |= bit;
+        }
+        queue->actions_known |= bit;
+    }
+
+    return (queue->actions & bit) != 0;
+}
+
+/**
+ * Get a mutation event for a node change, reusing the spare if possible
+ *
+ * While the document has no mutation event listeners only default actions
+ * see node change events, so one event is reinitialised for each change
+ * instead of allocating another. An event dispatched while the spare is
+ * in use, from within a default action, is allocated as usual.
+ *
+ * \param doc  The document
+ * \param evt  Pointer to location to receive the uninitialised event
+ * \return DOM_NO_ERR on success, DOM_NO_MEM_ERR on memory exhaustion.
+ */
+dom_exception _dom_mutation_event_acquire(dom_document *doc, struct dom_mutation_event **evt)
+{
+    struct dom_mutation_queue *queue = &doc->mutations;
+
+    if (queue->listeners > 0 || queue->spare == NULL)
+        return _dom_mutation_event_create(evt);
+
+    *evt = queue->spare;
+    queue->spare = NULL;
+
+    return _dom_mutation_event_initialise(*evt);
+}
+
+/**
+ * Finish with a node change mutation event, keeping it as the spare
+ *
+ * The event is only kept if nothing else holds a reference to it and no
+ * listener could have seen it.
+ *
+ * \param doc  The document
+ * \param evt  The event, released by this call
+ */
+void _dom_mutation_event_release(dom_document *doc, struct dom_mutation_event *evt)
+{
+    struct dom_mutation_queue *queue = &doc->mutations;
+
+    if (queue->listeners > 0 || queue->spare != NULL || evt->base.refcnt != 1) {
+        dom_event_unref(evt);
+        return;
+    }
+
+    _dom_mutation_event_finalise(evt);
+    queue->spare = evt;
+}
+
+/**
+ * Set the mutation observer of a document
+ *
+ * Any records queued for a previous observer are discarded. Passing a NULL
+ * records callback stops records being queued.
+ *
+ * \param doc      The document
+ * \param records  Callback receiving batches of records, or NULL
+ * \param pending  Callback notified when a batch starts, or NULL
+ * \param pw       Private data for the callbacks
+ * \return DOM_NO_ERR.
+ */
+dom_exception _dom_document_set_mutation_observer(
+    dom_document *doc, dom_mutation_records_callback records, dom_mutation_pending_callback pending, void *pw)
+{
+    struct dom_mutation_queue *queue = &doc->mutations;
+    uint32_t count = queue->count;
+
+    queue->count = 0;
+    queue->callback = records;
+    queue->pending = pending;
+    queue->pw = pw;
+
+    /* The records may hold the last references to the document */
+    dom_node_ref(doc);
+    _dom_mutation_records_release(queue->records, count);
+    dom_node_unref(doc);
+
+    return DOM_NO_ERR;
+}
+
+/**
+ * Deliver the queued mutation records of a document to its observer
+ *
+ * Records queued while the observer runs form the next batch.
+ *
+ * \param doc  The document
+ * \return DOM_NO_ERR.
+ */
+dom_exception _dom_document_flush_mutation_records(dom_document *doc)
+{
+    struct dom_mutation_queue *queue = &doc->mutations;
+    dom_mutation_record *rec = queue->records;
+    uint32_t count = queue->count;
+    uint32_t capacity = queue->capacity;
+
+    if (count == 0)
+        return DOM_NO_ERR;
+
+    queue->records = NULL;
+    queue->count = 0;
+    queue->capacity = 0;
+
+    /* The records may hold the last references to the document */
+    dom_node_ref(doc);
+
+    if (queue->callback != NULL)
+        queue->callback(doc, rec, count, queue->pw);
+
+    _dom_mutation_records_release(rec, count);
+
+    if (queue->records == NULL) {
+        /* Nothing was queued meanwhile, keep the storage */
+        queue->records = rec;
+        queue->capacity = capacity;
+    } else {
+        free(rec);
+    }
+
+    dom_node_unref(doc);
+
+    return DOM_NO_ERR;
+}
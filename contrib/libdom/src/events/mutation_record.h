@@ -0,0 +1,66 @@
+/*
+ * This file is part of libdom.
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ * Copyright 2026 Wisp Contributors
+ */
+
+#ifndef dom_internal_events_mutation_record_h_
+#define dom_internal_events_mutation_record_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <dom/core/document.h>
+#include <dom/events/mutation_record.h>
+
+/**
+ * The mutation record queue of a document
+ */
+struct dom_mutation_queue {
+    dom_mutation_record *records; /**< Queued records, oldest first */
+    uint32_t count; /**< Number of queued records */
+    uint32_t capacity; /**< Number of records allocated */
+
+    dom_mutation_records_callback callback; /**< Observer, NULL if none */
+    dom_mutation_pending_callback pending; /**< Checkpoint request */
+    void *pw; /**< Observer private data */
+
+    uint32_t listeners; /**< Mutation event listeners in the document */
+    uint32_t actions_known; /**< Event types whose default actions
+                             * have been looked up */
+    uint32_t actions; /**< Event types with default actions */
+
+    struct dom_mutation_event *spare; /**< Node change event for reuse */
+};
+
+/* Initialise a mutation record queue */
+void _dom_mutation_queue_initialise(struct dom_mutation_queue *queue);
+
+/* Finalise a mutation record queue, discarding any queued records */
+void _dom_mutation_queue_finalise(struct dom_mutation_queue *queue);
+
+/* Queue a mutation record if the document is being observed */
+dom_exception _dom_mutation_record_queue(dom_document *doc, dom_mutation_record_type type, dom_mutation_type change,
+    struct dom_node *target, struct dom_node *node, dom_string *attr_name);
+
+/* Note a mutation event listener being added to or removed from a node */
+void _dom_mutation_listener_changed(dom_document *doc, dom_string *type, bool added);
+
+struct dom_event_target_internal;
+
+/* Note every mutation event listener of a node being added or removed */
+void _dom_mutation_listeners_changed(dom_document *doc, struct dom_event_target_internal *eti, bool added);
+
+/* Determine whether a mutation event would be observed by anything */
+bool _dom_mutation_event_wanted(dom_document *doc, dom_string *type);
+
+struct dom_mutation_event;
+
+/* Get a mutation event for a node change, reusing the spare if possible */
+dom_exception _dom_mutation_event_acquire(dom_document *doc, struct dom_mutation_event **evt);
+
+/* Finish with a node change mutation event, keeping it as the spare */
+void _dom_mutation_event_release(dom_document *doc, struct dom_mutation_event *evt);
+
+#endif
@@ -274,6 +274,35 @@ static nserror bitmap_render(struct bitmap *bitmap, struct hlcache_handle *conte
 }
 
 
+/**
+ * Plot into a bitmap.
+ *
+ * \param bitmap The bitmap to plot into.
+ * \param redraw The function performing the plot operations.
+ * \param pw Private word passed to the redraw function.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror bitmap_render_plot(
+    struct bitmap *bitmap, bool (*redraw)(const struct redraw_context *ctx, void *pw), void *pw)
+{
+    cairo_t *old_cr;
+    bool ok;
+    struct redraw_context ctx = {.interactive = false, .background_images = true, .plot = &nsgtk_plotters};
+
+    assert(bitmap);
+
+    old_cr = current_cr;
+    current_cr = cairo_create(bitmap->surface);
+
+    ok = redraw(&ctx, pw);
+
+    cairo_destroy(current_cr);
+    current_cr = old_cr;
+
+    return ok ? NSERROR_OK : NSERROR_INVALID;
+}
+
+
 static struct gui_bitmap_table bitmap_table = {
     .create = bitmap_create,
     .destroy = bitmap_destroy,
@@ -285,6 +314,7 @@ static struct gui_bitmap_table bitmap_table = {
     .get_height = nsgtk_bitmap_get_height,
     .modified = bitmap_modified,
     .render = bitmap_render,
+    .render_plot = bitmap_render_plot,
 };
 
 struct gui_bitmap_table *nsgtk_bitmap_table = &bitmap_table;
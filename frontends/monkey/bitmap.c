@@ -22,9 +22,12 @@
 
 #include "utils/errors.h"
 #include "wisp/bitmap.h"
+#include "wisp/content.h"
+#include "wisp/plotters.h"
 
 #include "monkey/bitmap.h"
 #include "monkey/output.h"
+#include "monkey/raster.h"
 
 struct bitmap {
     void *ptr;
@@ -105,9 +108,35 @@ static int bitmap_get_height(void *bitmap)
     return bmap->height;
 }
 
+/**
+ * Render content into a bitmap with the raster plotters.
+ *
+ * \param bitmap The bitmap to render into.
+ * \param content The content to render.
+ * \return NSERROR_OK on success else error code.
+ */
 static nserror bitmap_render(struct bitmap *bitmap, struct hlcache_handle *content)
 {
+    struct redraw_context ctx = {
+        .interactive = false,
+        .background_images = true,
+        .plot = monkey_raster_plotters,
+    };
+    struct monkey_raster *raster;
+    nserror res;
+
     moutf(MOUT_GENERIC, "BITMAP RENDER");
+
+    res = monkey_raster_create(bitmap->ptr, bitmap_get_rowstride(bitmap), bitmap->width, bitmap->height, &raster);
+    if (res != NSERROR_OK) {
+        return res;
+    }
+    monkey_raster_clear(raster, 0xffffff);
+    ctx.priv = raster;
+
+    content_scaled_redraw(content, bitmap->width, bitmap->height, &ctx);
+
+    monkey_raster_destroy(raster);
     return NSERROR_OK;
 }
 
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "utils/log.h"
 #include "utils/messages.h"
@@ -35,6 +36,7 @@
 #include "monkey/browser.h"
 #include "monkey/output.h"
 #include "monkey/plot.h"
+#include "monkey/raster.h"
 
 static uint32_t win_ctr = 0;
 
@@ -96,6 +98,9 @@ static void gui_window_destroy(struct gui_window *g)
 {
     moutf(MOUT_WINDOW, "DESTROY WIN %u", g->win_num);
     RING_REMOVE(gw_ring, g);
+    if (g->raster != NULL) {
+        monkey_raster_destroy(g->raster);
+    }
     free(g);
 }
 
@@ -497,6 +502,49 @@ static void monkey_window_handle_stop(int argc, char **argv)
 }
 
 
+/**
+ * Redraw a window into its raster surface.
+ *
+ * The surface is created, or recreated at the window size, as needed and
+ * the time spent in the redraw is reported.
+ *
+ * \param gw The window to paint.
+ * \param clip The area of the window to redraw.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror monkey_window_paint(struct gui_window *gw, const struct rect *clip)
+{
+    struct redraw_context ctx = {.interactive = true, .background_images = true, .plot = monkey_raster_plotters};
+    struct timespec start, end;
+    int width = 0, height = 0;
+    nserror res;
+
+    if (gw->raster != NULL) {
+        monkey_raster_get_size(gw->raster, &width, &height);
+    }
+    if (gw->raster == NULL || width != gw->width || height != gw->height) {
+        if (gw->raster != NULL) {
+            monkey_raster_destroy(gw->raster);
+            gw->raster = NULL;
+        }
+        res = monkey_raster_create(NULL, 0, gw->width, gw->height, &gw->raster);
+        if (res != NSERROR_OK) {
+            return res;
+        }
+        monkey_raster_clear(gw->raster, 0xffffff);
+    }
+    ctx.priv = gw->raster;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    browser_window_redraw(gw->bw, gw->scrollx, gw->scrolly, clip, &ctx);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    moutf(MOUT_WINDOW, "PAINT WIN %u TIME %lld", gw->win_num,
+        (long long)(end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+
+    return NSERROR_OK;
+}
+
 static void monkey_window_handle_redraw(int argc, char **argv)
 {
     struct gui_window *gw;
@@ -529,10 +577,86 @@ static void monkey_window_handle_redraw(int argc, char **argv)
 
     NSLOG(wisp, INFO, "Issue redraw");
     moutf(MOUT_WINDOW, "REDRAW WIN %d START", atoi(argv[2]));
-    browser_window_redraw(gw->bw, gw->scrollx, gw->scrolly, &clip, &ctx);
+    if (gw->raster_plot) {
+        if (monkey_window_paint(gw, &clip) != NSERROR_OK) {
+            moutf(MOUT_ERROR, "WINDOW PAINT FAILED");
+        }
+    } else {
+        browser_window_redraw(gw->bw, gw->scrollx, gw->scrolly, &clip, &ctx);
+    }
     moutf(MOUT_WINDOW, "REDRAW WIN %d STOP", atoi(argv[2]));
 }
 
+/**
+ * handle WINDOW PLOTTER command
+ *
+ * Selects whether redraws report plot operations as text or paint them
+ * with the raster plotters.
+ */
+static void monkey_window_handle_plotter(int argc, char **argv)
+{
+    struct gui_window *gw;
+
+    if (argc != 4) {
+        moutf(MOUT_ERROR, "WINDOW PLOTTER ARGS BAD");
+        return;
+    }
+
+    gw = monkey_find_window_by_num(atoi(argv[2]));
+
+    if (gw == NULL) {
+        moutf(MOUT_ERROR, "WINDOW NUM BAD");
+    } else if (strcmp(argv[3], "RASTER") == 0) {
+        gw->raster_plot = true;
+        moutf(MOUT_WINDOW, "PLOTTER WIN %u RASTER", gw->win_num);
+    } else if (strcmp(argv[3], "TEXT") == 0) {
+        gw->raster_plot = false;
+        moutf(MOUT_WINDOW, "PLOTTER WIN %u TEXT", gw->win_num);
+    } else {
+        moutf(MOUT_ERROR, "WINDOW PLOTTER BAD");
+    }
+}
+
+/**
+ * handle WINDOW SCREENSHOT command
+ *
+ * Paints the whole window with the raster plotters and writes it to a PNG
+ * file.
+ */
+static void monkey_window_handle_screenshot(int argc, char **argv)
+{
+    struct gui_window *gw;
+    struct rect clip;
+    nserror res;
+
+    if (argc != 4) {
+        moutf(MOUT_ERROR, "WINDOW SCREENSHOT ARGS BAD");
+        return;
+    }
+
+    gw = monkey_find_window_by_num(atoi(argv[2]));
+
+    if (gw == NULL) {
+        moutf(MOUT_ERROR, "WINDOW NUM BAD");
+        return;
+    }
+
+    clip.x0 = 0;
+    clip.y0 = 0;
+    clip.x1 = gw->width;
+    clip.y1 = gw->height;
+
+    res = monkey_window_paint(gw, &clip);
+    if (res == NSERROR_OK) {
+        res = monkey_raster_write_png(gw->raster, argv[3]);
+    }
+    if (res != NSERROR_OK) {
+        moutf(MOUT_ERROR, "WINDOW SCREENSHOT FAILED %s", messages_get_errorcode(res));
+        return;
+    }
+    moutf(MOUT_WINDOW, "SCREENSHOT WIN %u PATH %s", gw->win_num, argv[3]);
+}
+
 static void monkey_window_handle_reload(int argc, char **argv)
 {
     struct gui_window *gw;
@@ -651,6 +775,10 @@ void monkey_window_handle_command(int argc, char **argv)
         monkey_window_handle_exec(argc, argv);
     } else if (strcmp(argv[1], "CLICK") == 0) {
         monkey_window_handle_click(argc, argv);
+    } else if (strcmp(argv[1], "PLOTTER") == 0) {
+        monkey_window_handle_plotter(argc, argv);
+    } else if (strcmp(argv[1], "SCREENSHOT") == 0) {
+        monkey_window_handle_screenshot(argc, argv);
     } else {
         moutf(MOUT_ERROR, "WINDOW COMMAND UNKNOWN %s\n", argv[1]);
     }
@@ -20,6 +20,7 @@
 #define WISP_MONKEY_BROWSER_H
 
 struct hlcache_handle;
+struct monkey_raster;
 
 extern struct gui_window_table *monkey_window_table;
 extern struct gui_download_table *monkey_download_table;
@@ -34,6 +35,9 @@ struct gui_window {
     int width, height;
     int scrollx, scrolly;
 
+    bool raster_plot; /* redraw with the raster plotters */
+    struct monkey_raster *raster; /* surface the raster plotters paint */
+
     char *host; /* Ignore this, it's in case RING*() gets debugging for
                fetchers */
 };
@@ -53,7 +53,9 @@
 #include "monkey/filetype.h"
 #include "monkey/layout.h"
 #include "monkey/output.h"
+#include "monkey/raster.h"
 #include "monkey/schedule.h"
+#include "monkey/stats.h"
 
 /** maximum number of languages in language vector */
 #define LANGV_SIZE 32
@@ -522,6 +524,11 @@ int main(int argc, char **argv)
         die("login handler failed to register");
     }
 
+    ret = monkey_register_handler("STATS", monkey_stats_handle_command);
+    if (ret != NSERROR_OK) {
+        die("stats handler failed to register");
+    }
+
     moutf(MOUT_GENERIC, "BOOT HANDLERS REGISTERED");
 
 
@@ -543,6 +550,7 @@ int main(int argc, char **argv)
 
     /* And free any monkey-specific bits */
     monkey_free_handlers();
+    monkey_raster_finalise();
 
     return 0;
 }
@@ -35,3 +35,6 @@ NSOPTION_BOOL(new_blank, false)
 NSOPTION_STRING(hotlist_path, NULL)
 NSOPTION_BOOL(source_tab, false)
 NSOPTION_INTEGER(current_theme, 0)
+
+/* font file the raster plotters render text with */
+NSOPTION_STRING(raster_font, NULL)
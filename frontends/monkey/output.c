@@ -33,6 +33,7 @@ static const char *type_text[] = {
     "LOGIN",
     "DOWNLOAD",
     "PLOT",
+    "STATS",
 };
 
 /* exported interface documented in monkey/output.h */
@@ -0,0 +1,2251 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Monkey software raster plotters (implementation).
+ *
+ * Shapes are reduced to edge lists in surface coordinates and scan
+ * converted with the non-zero winding rule, sampling each pixel at its
+ * centre.  There is no anti-aliasing apart from glyph coverage; the aim is
+ * deterministic pixels at a realistic cost, not display quality.  Every
+ * span ends up in either a solid fill or a row blend, which have SSE2
+ * versions where the compiler targets it.
+ *
+ * Strokes are built as one quadrilateral per segment, all wound the same
+ * way so overlaps are painted once.  Bitmaps are sampled nearest
+ * neighbour.  Glyphs come from FreeType when available and are placed on
+ * the fixed advance monkey's layout measures with, so text lines up with
+ * the boxes the core laid out.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef WITH_PNG
+#include <png.h>
+#endif
+
+#ifdef WITH_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+#endif
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "utils/nsoption.h"
+#include "utils/utf8.h"
+#include "utils/utils.h"
+#include "wisp/bitmap.h"
+#include "wisp/plotters.h"
+
+#include "monkey/bitmap.h"
+#include "monkey/raster.h"
+
+/** Depth of the transform stack */
+#define RASTER_STACK_DEPTH 32
+
+/** Entries in a gradient colour ramp */
+#define RASTER_RAMP_SIZE 256
+
+/** Most line segments a cubic curve is flattened into */
+#define RASTER_CURVE_SEGMENTS 64
+
+/** Most line segments a circle is approximated with */
+#define RASTER_CIRCLE_SEGMENTS 256
+
+/** Stroke width above which segment joins are filled in */
+#define RASTER_JOIN_WIDTH 2.0f
+
+/** Number of rendered glyphs kept */
+#define RASTER_GLYPH_CACHE 1024
+
+/** A polygon edge, stored top to bottom */
+struct raster_edge {
+    float x0; /**< x at the top end */
+    float y0; /**< y at the top end */
+    float y1; /**< y at the bottom end */
+    float dxdy; /**< change in x per unit of y */
+    int winding; /**< 1 when the edge runs down the surface, else -1 */
+};
+
+/** An edge crossing a scanline */
+struct raster_crossing {
+    float x;
+    int winding;
+};
+
+/** A point in surface coordinates */
+struct raster_point {
+    float x;
+    float y;
+};
+
+/** A run of flattened points */
+struct raster_subpath {
+    size_t start; /**< index of the first point */
+    size_t count; /**< number of points */
+    bool closed; /**< whether the path closed this subpath */
+};
+
+/** What spans are painted with */
+enum raster_paint_type {
+    RASTER_PAINT_SOLID,
+    RASTER_PAINT_LINEAR,
+    RASTER_PAINT_RADIAL,
+};
+
+/** A span painter */
+struct raster_paint {
+    enum raster_paint_type type;
+    uint32_t pixel; /**< solid colour, in surface byte order */
+    float inverse[6]; /**< surface to gradient space */
+    float x0, y0; /**< gradient start or centre */
+    float dx, dy; /**< linear direction over its squared length, or reciprocal radii */
+    uint32_t ramp[RASTER_RAMP_SIZE]; /**< gradient colours from start to end */
+};
+
+/** Plot state saved by push_transform */
+struct raster_state {
+    float transform[6];
+    struct rect clip;
+};
+
+/** A raster surface */
+struct monkey_raster {
+    uint8_t *pixels; /**< red, green, blue, alpha bytes */
+    size_t rowstride; /**< bytes per row */
+    int width;
+    int height;
+    bool owned; /**< whether pixels were allocated here */
+
+    float transform[6]; /**< user to surface transform */
+    struct rect clip; /**< clip in surface coordinates, within the surface */
+    struct raster_state stack[RASTER_STACK_DEPTH];
+    unsigned int depth;
+
+    /* scratch space reused between plots */
+    struct raster_point *points;
+    size_t point_count;
+    size_t point_alloc;
+    struct raster_subpath *subpaths;
+    size_t subpath_count;
+    size_t subpath_alloc;
+    struct raster_edge *edges;
+    size_t edge_count;
+    size_t edge_alloc;
+    struct raster_edge **active;
+    struct raster_crossing *crossings;
+    size_t crossing_alloc;
+    uint8_t *row; /**< one row of source pixels */
+    int *columns; /**< source column for each surface column */
+};
+
+/** The identity transform */
+static const float raster_identity[6] = {1, 0, 0, 1, 0, 0};
+
+
+/**
+ * Pack colour bytes into a pixel in surface byte order.
+ */
+static inline uint32_t raster_pack(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    uint8_t bytes[4] = {r, g, b, a};
+    uint32_t pixel;
+
+    memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+
+/**
+ * Convert a core colour, whose alpha is inverted, to a pixel.
+ *
+ * \param c The colour.
+ * \param opacity Opacity to apply, with 0 meaning unset.
+ * \return the pixel.
+ */
+static uint32_t raster_colour_pixel(colour c, float opacity)
+{
+    unsigned int alpha = 255 - ((c >> 24) & 0xff);
+
+    if (opacity > 0.0f && opacity < 1.0f) {
+        alpha = (unsigned int)(alpha * opacity + 0.5f);
+    }
+    return raster_pack(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, alpha);
+}
+
+
+/**
+ * Blend one channel, dividing by 255 with rounding.
+ */
+static inline uint8_t raster_mix(unsigned int s, unsigned int d, unsigned int a)
+{
+    unsigned int t = s * a + d * (255 - a) + 128;
+
+    return (t + (t >> 8)) >> 8;
+}
+
+
+/**
+ * Fill a span with a solid colour.
+ *
+ * The alpha of the colour is its coverage; the surface alpha composites
+ * as if the colour were opaque, so an opaque surface stays opaque.
+ *
+ * \param dst First pixel of the span.
+ * \param n Number of pixels.
+ * \param pixel The colour.
+ */
+static void raster_fill_span(uint8_t *dst, int n, uint32_t pixel)
+{
+    uint8_t src[4];
+    unsigned int alpha;
+
+    memcpy(src, &pixel, sizeof(src));
+    alpha = src[3];
+    if (alpha == 0) {
+        return;
+    }
+
+    if (alpha == 255) {
+#ifdef __SSE2__
+        __m128i v = _mm_set1_epi32((int)pixel);
+        for (; n >= 4; n -= 4, dst += 16) {
+            _mm_storeu_si128((__m128i *)(void *)dst, v);
+        }
+#endif
+        for (; n > 0; n--, dst += 4) {
+            memcpy(dst, &pixel, 4);
+        }
+        return;
+    }
+
+#ifdef __SSE2__
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ia = _mm_set1_epi16((short)(255 - alpha));
+        __m128i s;
+
+        s = _mm_set1_epi32((int)raster_pack(src[0], src[1], src[2], 255));
+        s = _mm_unpacklo_epi8(s, zero);
+        s = _mm_add_epi16(_mm_mullo_epi16(s, _mm_set1_epi16((short)alpha)), _mm_set1_epi16(128));
+
+        for (; n >= 4; n -= 4, dst += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(const void *)dst);
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia), s);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia), s);
+
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            _mm_storeu_si128((__m128i *)(void *)dst, _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif
+    for (; n > 0; n--, dst += 4) {
+        dst[0] = raster_mix(src[0], dst[0], alpha);
+        dst[1] = raster_mix(src[1], dst[1], alpha);
+        dst[2] = raster_mix(src[2], dst[2], alpha);
+        dst[3] = raster_mix(255, dst[3], alpha);
+    }
+}
+
+
+/**
+ * Blend a row of pixels, each with its own alpha, onto the surface.
+ *
+ * \param dst First pixel of the span.
+ * \param src Pixels to blend, not premultiplied.
+ * \param n Number of pixels.
+ */
+static void raster_blend_row(uint8_t *dst, const uint8_t *src, int n)
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i amask = _mm_set1_epi32((int)0xff000000);
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    /* SSE2 is only available on little endian hosts, so alpha is the top
+     * byte of each 32 bit lane.
+     */
+    for (; n >= 4; n -= 4, dst += 16, src += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(const void *)src);
+        __m128i a = _mm_and_si128(s, amask);
+        __m128i d, alo, ahi, lo, hi;
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, amask)) == 0xffff) {
+            _mm_storeu_si128((__m128i *)(void *)dst, s);
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) == 0xffff) {
+            continue;
+        }
+
+        a = _mm_srli_epi32(a, 24);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        alo = _mm_unpacklo_epi32(a, a);
+        ahi = _mm_unpackhi_epi32(a, a);
+        s = _mm_or_si128(s, amask);
+        d = _mm_loadu_si128((const __m128i *)(const void *)dst);
+
+        lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), alo),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(c255, alo)));
+        hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), ahi),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(c255, ahi)));
+        lo = _mm_add_epi16(lo, c128);
+        hi = _mm_add_epi16(hi, c128);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)(void *)dst, _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; n > 0; n--, dst += 4, src += 4) {
+        unsigned int alpha = src[3];
+
+        if (alpha == 255) {
+            memcpy(dst, src, 4);
+        } else if (alpha != 0) {
+            dst[0] = raster_mix(src[0], dst[0], alpha);
+            dst[1] = raster_mix(src[1], dst[1], alpha);
+            dst[2] = raster_mix(src[2], dst[2], alpha);
+            dst[3] = raster_mix(255, dst[3], alpha);
+        }
+    }
+}
+
+
+/**
+ * Grow a scratch array.
+ *
+ * \param array The array, may be NULL.
+ * \param alloc The number of entries allocated, updated on growth.
+ * \param needed The number of entries needed.
+ * \param size The size of an entry.
+ * \return the array, moved if it grew, or NULL on memory exhaustion.
+ */
+static void *raster_grow(void *array, size_t *alloc, size_t needed, size_t size)
+{
+    size_t count;
+
+    if (array != NULL && needed <= *alloc) {
+        return array;
+    }
+    count = (*alloc < 64) ? 64 : *alloc;
+    while (count < needed) {
+        count *= 2;
+    }
+    array = realloc(array, count * size);
+    if (array != NULL) {
+        *alloc = count;
+    }
+    return array;
+}
+
+
+/**
+ * Combine two transforms.
+ *
+ * \param out Updated with the transform applying \a first then \a second.
+ * \param first The transform applied first.
+ * \param second The transform applied second.
+ */
+static void raster_transform_multiply(float out[6], const float first[6], const float second[6])
+{
+    float m[6];
+
+    m[0] = second[0] * first[0] + second[2] * first[1];
+    m[1] = second[1] * first[0] + second[3] * first[1];
+    m[2] = second[0] * first[2] + second[2] * first[3];
+    m[3] = second[1] * first[2] + second[3] * first[3];
+    m[4] = second[0] * first[4] + second[2] * first[5] + second[4];
+    m[5] = second[1] * first[4] + second[3] * first[5] + second[5];
+    memcpy(out, m, sizeof(m));
+}
+
+
+/**
+ * Invert a transform.
+ *
+ * \return false if the transform is singular.
+ */
+static bool raster_transform_invert(float out[6], const float m[6])
+{
+    float det = m[0] * m[3] - m[2] * m[1];
+
+    if (det == 0.0f || !isfinite(det)) {
+        return false;
+    }
+    out[0] = m[3] / det;
+    out[1] = -m[1] / det;
+    out[2] = -m[2] / det;
+    out[3] = m[0] / det;
+    out[4] = -(out[0] * m[4] + out[2] * m[5]);
+    out[5] = -(out[1] * m[4] + out[3] * m[5]);
+    return true;
+}
+
+
+/**
+ * Get the factor a transform scales lengths by on average.
+ */
+static float raster_transform_scale(const float m[6])
+{
+    return sqrtf(fabsf(m[0] * m[3] - m[1] * m[2]));
+}
+
+
+/**
+ * Map a point through a transform.
+ */
+static inline struct raster_point raster_map(const float m[6], float x, float y)
+{
+    struct raster_point p = {m[0] * x + m[2] * y + m[4], m[1] * x + m[3] * y + m[5]};
+
+    return p;
+}
+
+
+/**
+ * Paint a span of one row.
+ *
+ * \param r The surface.
+ * \param paint What to paint with.
+ * \param y The row, within the clip.
+ * \param x0 First column, within the clip.
+ * \param x1 Column after the last, within the clip.
+ */
+static void raster_paint_span(struct monkey_raster *r, const struct raster_paint *paint, int y, int x0, int x1)
+{
+    uint8_t *dst = r->pixels + (size_t)y * r->rowstride + (size_t)x0 * 4;
+    const float *m = paint->inverse;
+    float px = x0 + 0.5f;
+    float py = y + 0.5f;
+    float u, v, t;
+    int x, index;
+
+    if (paint->type == RASTER_PAINT_SOLID) {
+        raster_fill_span(dst, x1 - x0, paint->pixel);
+        return;
+    }
+
+    /* gradients step through gradient space a column at a time */
+    u = m[0] * px + m[2] * py + m[4];
+    v = m[1] * px + m[3] * py + m[5];
+    for (x = x0; x < x1; x++) {
+        if (paint->type == RASTER_PAINT_LINEAR) {
+            t = (u - paint->x0) * paint->dx + (v - paint->y0) * paint->dy;
+        } else {
+            float ru = (u - paint->x0) * paint->dx;
+            float rv = (v - paint->y0) * paint->dy;
+            t = sqrtf(ru * ru + rv * rv);
+        }
+        if (!(t > 0.0f)) {
+            index = 0;
+        } else if (t >= 1.0f) {
+            index = RASTER_RAMP_SIZE - 1;
+        } else {
+            index = (int)(t * (RASTER_RAMP_SIZE - 1) + 0.5f);
+        }
+        memcpy(r->row + (size_t)(x - x0) * 4, &paint->ramp[index], 4);
+        u += m[0];
+        v += m[1];
+    }
+    raster_blend_row(dst, r->row, x1 - x0);
+}
+
+
+/**
+ * Paint a rectangle of the surface, limited to the clip.
+ */
+static void raster_paint_area(struct monkey_raster *r, const struct raster_paint *paint, int x0, int y0, int x1, int y1)
+{
+    int y;
+
+    x0 = max(x0, r->clip.x0);
+    y0 = max(y0, r->clip.y0);
+    x1 = min(x1, r->clip.x1);
+    y1 = min(y1, r->clip.y1);
+    if (x0 >= x1) {
+        return;
+    }
+    for (y = y0; y < y1; y++) {
+        raster_paint_span(r, paint, y, x0, x1);
+    }
+}
+
+
+/**
+ * Add a point to the current subpath.
+ */
+static nserror raster_line_to(struct monkey_raster *r, struct raster_point p)
+{
+    struct raster_point *points;
+
+    points = raster_grow(r->points, &r->point_alloc, r->point_count + 1, sizeof(*points));
+    if (points == NULL) {
+        return NSERROR_NOMEM;
+    }
+    r->points = points;
+    points[r->point_count++] = p;
+    r->subpaths[r->subpath_count - 1].count++;
+    return NSERROR_OK;
+}
+
+
+/**
+ * Start a new subpath of flattened points at a point.
+ */
+static nserror raster_move_to(struct monkey_raster *r, struct raster_point p)
+{
+    struct raster_subpath *subpaths;
+
+    subpaths = raster_grow(r->subpaths, &r->subpath_alloc, r->subpath_count + 1, sizeof(*subpaths));
+    if (subpaths == NULL) {
+        return NSERROR_NOMEM;
+    }
+    r->subpaths = subpaths;
+    subpaths[r->subpath_count].start = r->point_count;
+    subpaths[r->subpath_count].count = 0;
+    subpaths[r->subpath_count].closed = false;
+    r->subpath_count++;
+    return raster_line_to(r, p);
+}
+
+
+/**
+ * Flatten a cubic curve onto the current subpath.
+ *
+ * The curve is split into segments according to the length of its
+ * control polygon on the surface.
+ */
+static nserror raster_curve_to(struct monkey_raster *r,
+    struct raster_point p0, struct raster_point p1, struct raster_point p2, struct raster_point p3)
+{
+    float length = hypotf(p1.x - p0.x, p1.y - p0.y) + hypotf(p2.x - p1.x, p2.y - p1.y) +
+        hypotf(p3.x - p2.x, p3.y - p2.y);
+    int segments = (int)(length / 4.0f) + 1;
+    nserror res = NSERROR_OK;
+    int i;
+
+    if (!(segments < RASTER_CURVE_SEGMENTS)) {
+        segments = RASTER_CURVE_SEGMENTS;
+    }
+    for (i = 1; i <= segments && res == NSERROR_OK; i++) {
+        float t = (float)i / segments;
+        float s = 1.0f - t;
+        float a = s * s * s;
+        float b = 3 * s * s * t;
+        float c = 3 * s * t * t;
+        float d = t * t * t;
+        struct raster_point p = {
+            a * p0.x + b * p1.x + c * p2.x + d * p3.x,
+            a * p0.y + b * p1.y + c * p2.y + d * p3.y,
+        };
+
+        res = raster_line_to(r, p);
+    }
+    return res;
+}
+
+
+/**
+ * Flatten a plotter path into subpaths on the surface.
+ *
+ * \param r The surface.
+ * \param p The path elements.
+ * \param n The number of path elements.
+ * \param transform Transform to apply to the path, may be NULL.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_flatten_path(struct monkey_raster *r, const float *p, unsigned int n, const float transform[6])
+{
+    float m[6];
+    struct raster_point current = {0, 0};
+    struct raster_point start = {0, 0};
+    bool open = false;
+    unsigned int idx = 0;
+    nserror res = NSERROR_OK;
+
+    r->point_count = 0;
+    r->subpath_count = 0;
+
+    if (transform != NULL) {
+        raster_transform_multiply(m, transform, r->transform);
+    } else {
+        memcpy(m, r->transform, sizeof(m));
+    }
+
+    while (idx < n && res == NSERROR_OK) {
+        switch ((int)p[idx]) {
+        case PLOTTER_PATH_MOVE:
+            if (idx + 3 > n) {
+                return NSERROR_INVALID;
+            }
+            current = raster_map(m, p[idx + 1], p[idx + 2]);
+            start = current;
+            res = raster_move_to(r, current);
+            open = true;
+            idx += 3;
+            break;
+
+        case PLOTTER_PATH_CLOSE:
+            if (open) {
+                r->subpaths[r->subpath_count - 1].closed = true;
+                open = false;
+            }
+            current = start;
+            idx += 1;
+            break;
+
+        case PLOTTER_PATH_LINE:
+            if (idx + 3 > n) {
+                return NSERROR_INVALID;
+            }
+            if (!open) {
+                res = raster_move_to(r, current);
+                open = true;
+            }
+            current = raster_map(m, p[idx + 1], p[idx + 2]);
+            if (res == NSERROR_OK) {
+                res = raster_line_to(r, current);
+            }
+            idx += 3;
+            break;
+
+        case PLOTTER_PATH_BEZIER: {
+            struct raster_point c1, c2, end;
+
+            if (idx + 7 > n) {
+                return NSERROR_INVALID;
+            }
+            if (!open) {
+                res = raster_move_to(r, current);
+                open = true;
+            }
+            c1 = raster_map(m, p[idx + 1], p[idx + 2]);
+            c2 = raster_map(m, p[idx + 3], p[idx + 4]);
+            end = raster_map(m, p[idx + 5], p[idx + 6]);
+            if (res == NSERROR_OK) {
+                res = raster_curve_to(r, current, c1, c2, end);
+            }
+            current = end;
+            idx += 7;
+            break;
+        }
+
+        default:
+            NSLOG(wisp, WARNING, "bad path command %f", p[idx]);
+            return NSERROR_INVALID;
+        }
+    }
+
+    return res;
+}
+
+
+/**
+ * Flatten a polygon given as a point list into a closed subpath.
+ *
+ * \param r The surface.
+ * \param p The user space points, x then y.
+ * \param n The number of points.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_polygon_path(struct monkey_raster *r, const float *p, unsigned int n)
+{
+    nserror res;
+    unsigned int i;
+
+    r->point_count = 0;
+    r->subpath_count = 0;
+    if (n == 0) {
+        return NSERROR_OK;
+    }
+
+    res = raster_move_to(r, raster_map(r->transform, p[0], p[1]));
+    for (i = 1; i < n && res == NSERROR_OK; i++) {
+        res = raster_line_to(r, raster_map(r->transform, p[i * 2], p[i * 2 + 1]));
+    }
+    if (res == NSERROR_OK) {
+        r->subpaths[0].closed = true;
+    }
+    return res;
+}
+
+
+/**
+ * Flatten a circular arc into a subpath.
+ *
+ * \param r The surface.
+ * \param x The x coordinate of the centre.
+ * \param y The y coordinate of the centre.
+ * \param radius The radius.
+ * \param angle1 Start angle in degrees, anticlockwise from horizontal.
+ * \param angle2 End angle in degrees.
+ * \param closed Whether the arc is a whole closed circle.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_arc_path(
+    struct monkey_raster *r, float x, float y, float radius, float angle1, float angle2, bool closed)
+{
+    float sweep = angle2 - angle1;
+    float length = radius * raster_transform_scale(r->transform);
+    int segments;
+    nserror res;
+    int i;
+
+    r->point_count = 0;
+    r->subpath_count = 0;
+
+    while (sweep <= 0.0f) {
+        sweep += 360.0f;
+    }
+    length *= sweep * (float)M_PI / 180.0f;
+    segments = (int)(length / 3.0f) + 8;
+    if (segments > RASTER_CIRCLE_SEGMENTS) {
+        segments = RASTER_CIRCLE_SEGMENTS;
+    }
+
+    res = raster_move_to(r, raster_map(r->transform, x + radius * cosf(angle1 * (float)M_PI / 180.0f),
+        y - radius * sinf(angle1 * (float)M_PI / 180.0f)));
+    for (i = 1; i <= segments && res == NSERROR_OK; i++) {
+        float angle = (angle1 + sweep * i / segments) * (float)M_PI / 180.0f;
+
+        res = raster_line_to(r, raster_map(r->transform, x + radius * cosf(angle), y - radius * sinf(angle)));
+    }
+    if (res == NSERROR_OK) {
+        r->subpaths[0].closed = closed;
+    }
+    return res;
+}
+
+
+/**
+ * Add an edge to the edge list.
+ */
+static nserror raster_add_edge(struct monkey_raster *r, struct raster_point a, struct raster_point b)
+{
+    struct raster_edge *edges;
+    struct raster_edge *edge;
+    int winding = 1;
+
+    if (a.y == b.y || !isfinite(a.x) || !isfinite(a.y) || !isfinite(b.x) || !isfinite(b.y)) {
+        return NSERROR_OK;
+    }
+    if (a.y > b.y) {
+        struct raster_point t = a;
+        a = b;
+        b = t;
+        winding = -1;
+    }
+
+    edges = raster_grow(r->edges, &r->edge_alloc, r->edge_count + 1, sizeof(*edges));
+    if (edges == NULL) {
+        return NSERROR_NOMEM;
+    }
+    r->edges = edges;
+    edge = &edges[r->edge_count++];
+    edge->x0 = a.x;
+    edge->y0 = a.y;
+    edge->y1 = b.y;
+    edge->dxdy = (b.x - a.x) / (b.y - a.y);
+    edge->winding = winding;
+    return NSERROR_OK;
+}
+
+
+/**
+ * Add a closed polygon to the edge list, wound clockwise on the surface.
+ *
+ * Winding every stroke piece the same way means overlapping pieces add
+ * up rather than cancel under the non-zero rule.
+ */
+static nserror raster_add_shape(struct monkey_raster *r, const struct raster_point *p, unsigned int n)
+{
+    float area = 0.0f;
+    nserror res = NSERROR_OK;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        const struct raster_point *a = &p[i];
+        const struct raster_point *b = &p[(i + 1) % n];
+        area += a->x * b->y - b->x * a->y;
+    }
+    for (i = 0; i < n && res == NSERROR_OK; i++) {
+        if (area >= 0.0f) {
+            res = raster_add_edge(r, p[i], p[(i + 1) % n]);
+        } else {
+            res = raster_add_edge(r, p[(i + 1) % n], p[i]);
+        }
+    }
+    return res;
+}
+
+
+/**
+ * Add the edges of the current subpaths, each implicitly closed.
+ */
+static nserror raster_add_subpath_edges(struct monkey_raster *r)
+{
+    nserror res = NSERROR_OK;
+    size_t s, i;
+
+    for (s = 0; s < r->subpath_count && res == NSERROR_OK; s++) {
+        const struct raster_subpath *sp = &r->subpaths[s];
+        const struct raster_point *p = &r->points[sp->start];
+
+        if (sp->count < 3) {
+            continue;
+        }
+        for (i = 0; i < sp->count && res == NSERROR_OK; i++) {
+            res = raster_add_edge(r, p[i], p[(i + 1) % sp->count]);
+        }
+    }
+    return res;
+}
+
+
+/**
+ * Order edges by their top.
+ */
+static int raster_edge_cmp(const void *a, const void *b)
+{
+    const struct raster_edge *ea = a;
+    const struct raster_edge *eb = b;
+
+    return (ea->y0 > eb->y0) - (ea->y0 < eb->y0);
+}
+
+
+/**
+ * Scan convert the edge list with the non-zero winding rule.
+ *
+ * The edge list is emptied.
+ *
+ * \param r The surface.
+ * \param paint What to fill with.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_fill_edges(struct monkey_raster *r, const struct raster_paint *paint)
+{
+    size_t count = r->edge_count;
+    size_t next = 0;
+    size_t active = 0;
+    float bottom = 0.0f;
+    int y, y0, y1;
+    size_t i;
+    void *grown;
+
+    r->edge_count = 0;
+    if (count == 0 || r->clip.x0 >= r->clip.x1) {
+        return NSERROR_OK;
+    }
+
+    grown = raster_grow(r->crossings, &r->crossing_alloc, count, sizeof(*r->crossings));
+    if (grown == NULL) {
+        return NSERROR_NOMEM;
+    }
+    r->crossings = grown;
+    /* the active list shares the crossing allocation size */
+    grown = realloc(r->active, r->crossing_alloc * sizeof(*r->active));
+    if (grown == NULL) {
+        return NSERROR_NOMEM;
+    }
+    r->active = grown;
+
+    qsort(r->edges, count, sizeof(*r->edges), raster_edge_cmp);
+    for (i = 0; i < count; i++) {
+        if (r->edges[i].y1 > bottom || i == 0) {
+            bottom = r->edges[i].y1;
+        }
+    }
+
+    y0 = max(r->clip.y0, (int)floorf(fmaxf(r->edges[0].y0, (float)r->clip.y0)));
+    y1 = min(r->clip.y1, (int)ceilf(fminf(bottom, (float)r->clip.y1)));
+
+    for (y = y0; y < y1; y++) {
+        float yc = y + 0.5f;
+        size_t crossings = 0;
+        int winding = 0;
+
+        while (next < count && r->edges[next].y0 <= yc) {
+            r->active[active++] = &r->edges[next++];
+        }
+
+        for (i = 0; i < active; i++) {
+            struct raster_edge *e = r->active[i];
+            struct raster_crossing c;
+            size_t j;
+
+            if (e->y1 <= yc) {
+                r->active[i--] = r->active[--active];
+                continue;
+            }
+            c.x = e->x0 + (yc - e->y0) * e->dxdy;
+            c.winding = e->winding;
+
+            /* insertion sort, the lists are short */
+            for (j = crossings; j > 0 && r->crossings[j - 1].x > c.x; j--) {
+                r->crossings[j] = r->crossings[j - 1];
+            }
+            r->crossings[j] = c;
+            crossings++;
+        }
+
+        for (i = 0; i + 1 < crossings; i++) {
+            winding += r->crossings[i].winding;
+            if (winding != 0) {
+                float fx0 = fminf(fmaxf(r->crossings[i].x - 0.5f, (float)r->clip.x0), (float)r->clip.x1);
+                float fx1 = fminf(fmaxf(r->crossings[i + 1].x - 0.5f, (float)r->clip.x0), (float)r->clip.x1);
+                int x0 = (int)ceilf(fx0);
+                int x1 = (int)ceilf(fx1);
+
+                if (x0 < x1) {
+                    raster_paint_span(r, paint, y, x0, x1);
+                }
+            }
+        }
+
+        if (next == count && active == 0) {
+            break;
+        }
+    }
+
+    return NSERROR_OK;
+}
+
+
+/**
+ * Fill the current subpaths.
+ */
+static nserror raster_fill_subpaths(struct monkey_raster *r, const struct raster_paint *paint)
+{
+    nserror res;
+
+    r->edge_count = 0;
+    res = raster_add_subpath_edges(r);
+    if (res == NSERROR_OK) {
+        res = raster_fill_edges(r, paint);
+    }
+    return res;
+}
+
+
+/**
+ * Add the outline of a circle to the edge list, used for stroke joins.
+ */
+static nserror raster_add_join(struct monkey_raster *r, struct raster_point c, float radius)
+{
+    struct raster_point p[8];
+    unsigned int i;
+
+    for (i = 0; i < 8; i++) {
+        float angle = i * (float)M_PI / 4.0f;
+        p[i].x = c.x + radius * cosf(angle);
+        p[i].y = c.y + radius * sinf(angle);
+    }
+    return raster_add_shape(r, p, 8);
+}
+
+
+/**
+ * Add a stroked segment to the edge list.
+ */
+static nserror raster_add_segment(struct monkey_raster *r, struct raster_point a, struct raster_point b, float half)
+{
+    struct raster_point q[4];
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float length = hypotf(dx, dy);
+    float nx, ny;
+
+    if (!(length > 0.0f)) {
+        return NSERROR_OK;
+    }
+    nx = -dy * half / length;
+    ny = dx * half / length;
+    q[0].x = a.x + nx;
+    q[0].y = a.y + ny;
+    q[1].x = b.x + nx;
+    q[1].y = b.y + ny;
+    q[2].x = b.x - nx;
+    q[2].y = b.y - ny;
+    q[3].x = a.x - nx;
+    q[3].y = a.y - ny;
+    return raster_add_shape(r, q, 4);
+}
+
+
+/** Progress through a dash pattern */
+struct raster_dash {
+    const float *pattern; /**< lengths, alternately on and off, or NULL for solid */
+    unsigned int count; /**< number of lengths */
+    float scale; /**< user to surface length factor */
+    unsigned int index; /**< current length */
+    float remain; /**< surface length left of the current length */
+    bool on; /**< whether the current length is drawn */
+};
+
+
+/**
+ * Start a dash pattern.
+ *
+ * \return false if the pattern has no length, so the stroke is solid.
+ */
+static bool
+raster_dash_init(struct raster_dash *dash, const float *pattern, unsigned int count, float offset, float scale)
+{
+    float total = 0.0f;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (pattern[i] < 0.0f) {
+            return false;
+        }
+        total += pattern[i];
+    }
+    if (!(total > 0.0f)) {
+        return false;
+    }
+
+    dash->pattern = pattern;
+    dash->count = count;
+    dash->scale = scale;
+    dash->index = 0;
+    dash->on = true;
+
+    /* odd length patterns repeat twice to make a whole on/off cycle */
+    offset = fmodf(offset, (count & 1) ? total * 2 : total);
+    if (offset < 0.0f) {
+        offset += (count & 1) ? total * 2 : total;
+    }
+    while (offset >= pattern[dash->index]) {
+        offset -= pattern[dash->index];
+        dash->index = (dash->index + 1) % count;
+        dash->on = !dash->on;
+    }
+    dash->remain = (pattern[dash->index] - offset) * scale;
+    return true;
+}
+
+
+/**
+ * Add a dashed segment to the edge list.
+ */
+static nserror raster_add_dashed_segment(struct monkey_raster *r, struct raster_dash *dash,
+    struct raster_point a, struct raster_point b, float half)
+{
+    float length = hypotf(b.x - a.x, b.y - a.y);
+    float done = 0.0f;
+    nserror res = NSERROR_OK;
+
+    while (done < length && res == NSERROR_OK) {
+        float step = fminf(dash->remain, length - done);
+
+        if (dash->on && step > 0.0f) {
+            struct raster_point p0 = {a.x + (b.x - a.x) * done / length, a.y + (b.y - a.y) * done / length};
+            struct raster_point p1 = {
+                a.x + (b.x - a.x) * (done + step) / length,
+                a.y + (b.y - a.y) * (done + step) / length,
+            };
+            res = raster_add_segment(r, p0, p1, half);
+        }
+        done += step;
+        dash->remain -= step;
+        if (dash->remain <= 0.0f) {
+            dash->index = (dash->index + 1) % dash->count;
+            dash->on = !dash->on;
+            dash->remain = dash->pattern[dash->index] * dash->scale;
+        }
+    }
+    return res;
+}
+
+
+/**
+ * Stroke the current subpaths.
+ *
+ * \param r The surface.
+ * \param style The plot style giving the stroke.
+ * \param align Whether to centre odd width strokes on pixels, for plots
+ *              whose coordinates are whole pixels.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_stroke_subpaths(struct monkey_raster *r, const plot_style_t *style, bool align)
+{
+    struct raster_paint paint;
+    struct raster_dash dash;
+    float pattern[2];
+    float scale = raster_transform_scale(r->transform);
+    float width = plot_style_fixed_to_float(style->stroke_width) * scale;
+    float shift = 0.0f;
+    bool dashed = false;
+    nserror res = NSERROR_OK;
+    size_t s, i;
+
+    if (style->stroke_type == PLOT_OP_TYPE_NONE) {
+        return NSERROR_OK;
+    }
+    if (width < 1.0f) {
+        width = 1.0f;
+    }
+    if (align && ((int)(width + 0.5f) & 1)) {
+        shift = 0.5f;
+    }
+
+    if (style->stroke_dasharray != NULL && style->stroke_dasharray_count > 0) {
+        dashed = raster_dash_init(
+            &dash, style->stroke_dasharray, style->stroke_dasharray_count, style->stroke_dashoffset, scale);
+    } else if (style->stroke_type == PLOT_OP_TYPE_DOT || style->stroke_type == PLOT_OP_TYPE_DASH) {
+        /* the same proportions as the Qt pen styles */
+        pattern[0] = (style->stroke_type == PLOT_OP_TYPE_DOT) ? width : width * 4;
+        pattern[1] = width * 2;
+        dashed = raster_dash_init(&dash, pattern, 2, 0.0f, 1.0f);
+    }
+
+    paint.type = RASTER_PAINT_SOLID;
+    paint.pixel = raster_colour_pixel(style->stroke_colour, style->stroke_opacity);
+
+    r->edge_count = 0;
+    for (s = 0; s < r->subpath_count && res == NSERROR_OK; s++) {
+        const struct raster_subpath *sp = &r->subpaths[s];
+        size_t segments = sp->closed ? sp->count : sp->count - 1;
+
+        if (sp->count < 2) {
+            continue;
+        }
+        for (i = 0; i < segments && res == NSERROR_OK; i++) {
+            struct raster_point a = r->points[sp->start + i];
+            struct raster_point b = r->points[sp->start + (i + 1) % sp->count];
+
+            a.x += shift;
+            a.y += shift;
+            b.x += shift;
+            b.y += shift;
+            if (dashed) {
+                res = raster_add_dashed_segment(r, &dash, a, b, width / 2);
+            } else {
+                res = raster_add_segment(r, a, b, width / 2);
+                if (res == NSERROR_OK && width > RASTER_JOIN_WIDTH && (sp->closed || i + 1 < segments)) {
+                    res = raster_add_join(r, b, width / 2);
+                }
+            }
+        }
+    }
+    if (res == NSERROR_OK) {
+        res = raster_fill_edges(r, &paint);
+    }
+    return res;
+}
+
+
+/**
+ * Fill and stroke the current subpaths as a plot style asks.
+ */
+static nserror raster_draw_subpaths(struct monkey_raster *r, const plot_style_t *style, bool align)
+{
+    nserror res = NSERROR_OK;
+
+    if (style->fill_type != PLOT_OP_TYPE_NONE) {
+        struct raster_paint paint;
+
+        paint.type = RASTER_PAINT_SOLID;
+        paint.pixel = raster_colour_pixel(style->fill_colour, style->fill_opacity);
+        res = raster_fill_subpaths(r, &paint);
+    }
+    if (res == NSERROR_OK) {
+        res = raster_stroke_subpaths(r, style, align);
+    }
+    return res;
+}
+
+
+/**
+ * \brief Sets a clip rectangle for subsequent plot operations.
+ *
+ * The clip is in surface coordinates whatever the current transform.
+ *
+ * \param ctx The current redraw context.
+ * \param clip The rectangle to limit all subsequent plot
+ *              operations within.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_clip(const struct redraw_context *ctx, const struct rect *clip)
+{
+    struct monkey_raster *r = ctx->priv;
+
+    r->clip.x0 = max(0, clip->x0);
+    r->clip.y0 = max(0, clip->y0);
+    r->clip.x1 = min(r->width, clip->x1);
+    r->clip.y1 = min(r->height, clip->y1);
+    if (r->clip.x1 < r->clip.x0) {
+        r->clip.x1 = r->clip.x0;
+    }
+    if (r->clip.y1 < r->clip.y0) {
+        r->clip.y1 = r->clip.y0;
+    }
+    return NSERROR_OK;
+}
+
+
+/**
+ * Plots an arc
+ *
+ * plot an arc segment around (x,y), anticlockwise from angle1
+ *  to angle2. Angles are measured anticlockwise from
+ *  horizontal, in degrees.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the arc plot.
+ * \param x The x coordinate of the arc.
+ * \param y The y coordinate of the arc.
+ * \param radius The radius of the arc.
+ * \param angle1 The start angle of the arc.
+ * \param angle2 The finish angle of the arc.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_arc(
+    const struct redraw_context *ctx, const plot_style_t *style, int x, int y, int radius, int angle1, int angle2)
+{
+    struct monkey_raster *r = ctx->priv;
+    nserror res;
+
+    res = raster_arc_path(r, x, y, radius, angle1, angle2, false);
+    if (res == NSERROR_OK) {
+        res = raster_stroke_subpaths(r, style, true);
+    }
+    return res;
+}
+
+
+/**
+ * Plots a circle
+ *
+ * Plot a circle centered on (x,y), which is optionally filled.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the circle plot.
+ * \param x x coordinate of circle centre.
+ * \param y y coordinate of circle centre.
+ * \param radius circle radius.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_disc(const struct redraw_context *ctx, const plot_style_t *style, int x, int y, int radius)
+{
+    struct monkey_raster *r = ctx->priv;
+    nserror res;
+
+    res = raster_arc_path(r, x, y, radius, 0, 360, true);
+    if (res == NSERROR_OK) {
+        res = raster_draw_subpaths(r, style, true);
+    }
+    return res;
+}
+
+
+/**
+ * Plots a line
+ *
+ * plot a line from (x0,y0) to (x1,y1). Coordinates are at
+ *  centre of line width/thickness.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the line plot.
+ * \param line A rectangle defining the line to be drawn
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_line(const struct redraw_context *ctx, const plot_style_t *style, const struct rect *line)
+{
+    struct monkey_raster *r = ctx->priv;
+    nserror res;
+
+    r->point_count = 0;
+    r->subpath_count = 0;
+    res = raster_move_to(r, raster_map(r->transform, line->x0, line->y0));
+    if (res == NSERROR_OK) {
+        res = raster_line_to(r, raster_map(r->transform, line->x1, line->y1));
+    }
+    if (res == NSERROR_OK) {
+        res = raster_stroke_subpaths(r, style, true);
+    }
+    return res;
+}
+
+
+/**
+ * Plots a rectangle.
+ *
+ * The rectangle can be filled an outline or both controlled
+ *  by the plot style The line can be solid, dotted or
+ *  dashed. Top left corner at (x0,y0) and rectangle has given
+ *  width and height.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the rectangle plot.
+ * \param rect A rectangle defining the line to be drawn
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+raster_plot_rectangle(const struct redraw_context *ctx, const plot_style_t *style, const struct rect *rect)
+{
+    struct monkey_raster *r = ctx->priv;
+    const float *m = r->transform;
+    float p[8] = {rect->x0, rect->y0, rect->x1, rect->y0, rect->x1, rect->y1, rect->x0, rect->y1};
+    nserror res;
+
+    /* untransformed fills, most of any page, skip scan conversion */
+    if (style->fill_type != PLOT_OP_TYPE_NONE && m[0] == 1.0f && m[1] == 0.0f && m[2] == 0.0f && m[3] == 1.0f &&
+        m[4] == floorf(m[4]) && m[5] == floorf(m[5])) {
+        struct raster_paint paint;
+        int tx = (int)m[4];
+        int ty = (int)m[5];
+
+        paint.type = RASTER_PAINT_SOLID;
+        paint.pixel = raster_colour_pixel(style->fill_colour, style->fill_opacity);
+        raster_paint_area(r, &paint, rect->x0 + tx, rect->y0 + ty, rect->x1 + tx, rect->y1 + ty);
+
+        if (style->stroke_type == PLOT_OP_TYPE_NONE) {
+            return NSERROR_OK;
+        }
+        res = raster_polygon_path(r, p, 4);
+        if (res == NSERROR_OK) {
+            res = raster_stroke_subpaths(r, style, true);
+        }
+        return res;
+    }
+
+    res = raster_polygon_path(r, p, 4);
+    if (res == NSERROR_OK) {
+        res = raster_draw_subpaths(r, style, true);
+    }
+    return res;
+}
+
+
+/**
+ * Plot a polygon
+ *
+ * Plots a filled polygon with straight lines between
+ * points. The lines around the edge of the ploygon are not
+ * plotted. The polygon is filled with the non-zero winding
+ * rule.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the polygon plot.
+ * \param p verticies of polygon
+ * \param n number of verticies.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+raster_plot_polygon(const struct redraw_context *ctx, const plot_style_t *style, const int *p, unsigned int n)
+{
+    struct monkey_raster *r = ctx->priv;
+    struct raster_paint paint;
+    nserror res = NSERROR_OK;
+    unsigned int i;
+
+    if (style->fill_type == PLOT_OP_TYPE_NONE || n < 3) {
+        return NSERROR_OK;
+    }
+
+    r->point_count = 0;
+    r->subpath_count = 0;
+    res = raster_move_to(r, raster_map(r->transform, p[0], p[1]));
+    for (i = 1; i < n && res == NSERROR_OK; i++) {
+        res = raster_line_to(r, raster_map(r->transform, p[i * 2], p[i * 2 + 1]));
+    }
+    if (res == NSERROR_OK) {
+        paint.type = RASTER_PAINT_SOLID;
+        paint.pixel = raster_colour_pixel(style->fill_colour, style->fill_opacity);
+        res = raster_fill_subpaths(r, &paint);
+    }
+    return res;
+}
+
+
+/**
+ * Plots a path.
+ *
+ * Path plot consisting of cubic Bezier curves. Line and fill colour is
+ *  controlled by the plot style.
+ *
+ * \param ctx The current redraw context.
+ * \param pstyle Style controlling the path plot.
+ * \param p elements of path
+ * \param n nunber of elements on path
+ * \param transform A transform to apply to the path.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_path(const struct redraw_context *ctx, const plot_style_t *pstyle, const float *p,
+    unsigned int n, const float transform[6])
+{
+    struct monkey_raster *r = ctx->priv;
+    float saved[6];
+    nserror res;
+
+    if (n < 3) {
+        return NSERROR_OK;
+    }
+    if (p[0] != PLOTTER_PATH_MOVE) {
+        return NSERROR_INVALID;
+    }
+
+    res = raster_flatten_path(r, p, n, transform);
+    if (res != NSERROR_OK) {
+        return res;
+    }
+
+    /* stroke widths are in path units */
+    memcpy(saved, r->transform, sizeof(saved));
+    if (transform != NULL) {
+        raster_transform_multiply(r->transform, transform, saved);
+    }
+    res = raster_draw_subpaths(r, pstyle, false);
+    memcpy(r->transform, saved, sizeof(saved));
+
+    return res;
+}
+
+
+/**
+ * Sample a bitmap onto the surface through a rotating or skewing transform.
+ */
+static void raster_bitmap_transformed(struct monkey_raster *r, const uint8_t *buffer, size_t stride, int bw, int bh,
+    float x, float y, float width, float height, bitmap_flags_t flags)
+{
+    bool repeat_x = (flags & BITMAPF_REPEAT_X) != 0;
+    bool repeat_y = (flags & BITMAPF_REPEAT_Y) != 0;
+    struct raster_point corner[4];
+    float inverse[6];
+    float fx0, fy0, fx1, fy1;
+    int x0, y0, x1, y1;
+    int sx, sy, i;
+
+    if (!raster_transform_invert(inverse, r->transform)) {
+        return;
+    }
+
+    x0 = r->clip.x0;
+    y0 = r->clip.y0;
+    x1 = r->clip.x1;
+    y1 = r->clip.y1;
+    if (!repeat_x && !repeat_y) {
+        corner[0] = raster_map(r->transform, x, y);
+        corner[1] = raster_map(r->transform, x + width, y);
+        corner[2] = raster_map(r->transform, x + width, y + height);
+        corner[3] = raster_map(r->transform, x, y + height);
+        fx0 = fx1 = corner[0].x;
+        fy0 = fy1 = corner[0].y;
+        for (i = 1; i < 4; i++) {
+            fx0 = fminf(fx0, corner[i].x);
+            fy0 = fminf(fy0, corner[i].y);
+            fx1 = fmaxf(fx1, corner[i].x);
+            fy1 = fmaxf(fy1, corner[i].y);
+        }
+        x0 = max(x0, (int)floorf(fmaxf(fx0, (float)x0)));
+        y0 = max(y0, (int)floorf(fmaxf(fy0, (float)y0)));
+        x1 = min(x1, (int)ceilf(fminf(fx1, (float)x1)));
+        y1 = min(y1, (int)ceilf(fminf(fy1, (float)y1)));
+    }
+
+    for (sy = y0; sy < y1; sy++) {
+        for (sx = x0; sx < x1; sx++) {
+            struct raster_point u = raster_map(inverse, sx + 0.5f, sy + 0.5f);
+            float fu = (u.x - x) / width;
+            float fv = (u.y - y) / height;
+            uint8_t *out = r->row + (size_t)(sx - x0) * 4;
+
+            if ((!repeat_x && (fu < 0.0f || fu >= 1.0f)) || (!repeat_y && (fv < 0.0f || fv >= 1.0f))) {
+                memset(out, 0, 4);
+                continue;
+            }
+            fu -= floorf(fu);
+            fv -= floorf(fv);
+            memcpy(out, buffer + (size_t)min((int)(fv * bh), bh - 1) * stride + (size_t)min((int)(fu * bw), bw - 1) * 4,
+                4);
+        }
+        if (x0 < x1) {
+            raster_blend_row(r->pixels + (size_t)sy * r->rowstride + (size_t)x0 * 4, r->row, x1 - x0);
+        }
+    }
+}
+
+
+/**
+ * Plot a bitmap
+ *
+ * Tiled plot of a bitmap image. (x,y) gives the top left
+ * coordinate of an explicitly placed tile. From this tile the
+ * image can repeat in all four directions -- up, down, left
+ * and right -- to the extents given by the current clip
+ * rectangle.
+ *
+ * The bitmap_flags say whether to tile in the x and y
+ * directions. If not tiling in x or y directions, the single
+ * image is plotted. The width and height give the dimensions
+ * the image is to be scaled to.
+ *
+ * \param ctx The current redraw context.
+ * \param bitmap The bitmap to plot
+ * \param x The x coordinate to plot the bitmap
+ * \param y The y coordiante to plot the bitmap
+ * \param width The width of area to plot the bitmap into
+ * \param height The height of area to plot the bitmap into
+ * \param bg the background colour to alpha blend into
+ * \param flags the flags controlling the type of plot operation
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_bitmap(const struct redraw_context *ctx, struct bitmap *bitmap, int x, int y, int width,
+    int height, colour bg, bitmap_flags_t flags)
+{
+    struct monkey_raster *r = ctx->priv;
+    const float *m = r->transform;
+    bool repeat_x = (flags & BITMAPF_REPEAT_X) != 0;
+    bool repeat_y = (flags & BITMAPF_REPEAT_Y) != 0;
+    const uint8_t *buffer;
+    size_t stride;
+    bool opaque;
+    int bw, bh;
+    int tx, ty, tw, th;
+    int x0, y0, x1, y1;
+    int sx, sy, prev_row = -1;
+    const uint8_t *src;
+
+    bw = monkey_bitmap_table->get_width(bitmap);
+    bh = monkey_bitmap_table->get_height(bitmap);
+    buffer = monkey_bitmap_table->get_buffer(bitmap);
+    stride = monkey_bitmap_table->get_rowstride(bitmap);
+    opaque = monkey_bitmap_table->get_opaque(bitmap);
+    if (width <= 0 || height <= 0 || bw <= 0 || bh <= 0 || buffer == NULL) {
+        return NSERROR_OK;
+    }
+
+    if (m[1] != 0.0f || m[2] != 0.0f || !(m[0] > 0.0f) || !(m[3] > 0.0f)) {
+        raster_bitmap_transformed(r, buffer, stride, bw, bh, x, y, width, height, flags);
+        return NSERROR_OK;
+    }
+
+    /* the tile on the surface */
+    tx = (int)floorf(m[0] * x + m[4] + 0.5f);
+    ty = (int)floorf(m[3] * y + m[5] + 0.5f);
+    tw = (int)floorf(m[0] * (x + width) + m[4] + 0.5f) - tx;
+    th = (int)floorf(m[3] * (y + height) + m[5] + 0.5f) - ty;
+    if (tw <= 0 || th <= 0) {
+        return NSERROR_OK;
+    }
+
+    x0 = repeat_x ? r->clip.x0 : max(r->clip.x0, tx);
+    x1 = repeat_x ? r->clip.x1 : min(r->clip.x1, tx + tw);
+    y0 = repeat_y ? r->clip.y0 : max(r->clip.y0, ty);
+    y1 = repeat_y ? r->clip.y1 : min(r->clip.y1, ty + th);
+    if (x0 >= x1 || y0 >= y1) {
+        return NSERROR_OK;
+    }
+
+    /* source column of each surface column, sampled at pixel centres */
+    for (sx = x0; sx < x1; sx++) {
+        int offset = (sx - tx) % tw;
+
+        if (offset < 0) {
+            offset += tw;
+        }
+        r->columns[sx - x0] = (int)(((int64_t)offset * 2 + 1) * bw / ((int64_t)tw * 2));
+    }
+
+    for (sy = y0; sy < y1; sy++) {
+        uint8_t *dst = r->pixels + (size_t)sy * r->rowstride + (size_t)x0 * 4;
+        int offset = (sy - ty) % th;
+        int row;
+
+        if (offset < 0) {
+            offset += th;
+        }
+        row = (int)(((int64_t)offset * 2 + 1) * bh / ((int64_t)th * 2));
+
+        if (tw == bw && !repeat_x) {
+            /* unscaled rows are used in place */
+            src = buffer + (size_t)row * stride + (size_t)(x0 - tx) * 4;
+        } else {
+            if (row != prev_row) {
+                const uint8_t *line = buffer + (size_t)row * stride;
+
+                for (sx = 0; sx < x1 - x0; sx++) {
+                    memcpy(r->row + (size_t)sx * 4, line + (size_t)r->columns[sx] * 4, 4);
+                }
+                prev_row = row;
+            }
+            src = r->row;
+        }
+
+        if (opaque) {
+            memcpy(dst, src, (size_t)(x1 - x0) * 4);
+        } else {
+            raster_blend_row(dst, src, x1 - x0);
+        }
+    }
+
+    return NSERROR_OK;
+}
+
+
+#ifdef WITH_FREETYPE
+
+/** A rendered glyph */
+struct raster_glyph {
+    bool valid;
+    uint32_t ucs4;
+    int size; /**< pixel size rendered at */
+    int style; /**< bit 0 for bold, bit 1 for slanted */
+    int width;
+    int height;
+    int left; /**< offset from the pen to the left column */
+    int top; /**< offset from the top row up to the baseline */
+    uint8_t *coverage;
+};
+
+/** Rendered glyphs, indexed by a hash of their key */
+static struct raster_glyph raster_glyphs[RASTER_GLYPH_CACHE];
+
+static FT_Library raster_ft_library;
+static FT_Face raster_ft_face;
+static bool raster_ft_tried = false;
+static int raster_ft_size = 0;
+
+/** Fonts tried when the raster_font option is not set */
+static const char *const raster_font_paths[] = {
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/dejavu-sans-fonts/DejaVuSans.ttf",
+    "/usr/local/share/fonts/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+};
+
+
+/**
+ * Get the face glyphs are rendered from, loading it on first use.
+ *
+ * \return the face or NULL if there is none.
+ */
+static FT_Face raster_font_face(void)
+{
+    const char *path = nsoption_charp(raster_font);
+    size_t i;
+
+    if (raster_ft_tried) {
+        return raster_ft_face;
+    }
+    raster_ft_tried = true;
+
+    if (FT_Init_FreeType(&raster_ft_library) != 0) {
+        NSLOG(wisp, WARNING, "FreeType initialisation failed");
+        return NULL;
+    }
+    if (path != NULL && FT_New_Face(raster_ft_library, path, 0, &raster_ft_face) == 0) {
+        return raster_ft_face;
+    }
+    for (i = 0; i < sizeof(raster_font_paths) / sizeof(raster_font_paths[0]); i++) {
+        if (FT_New_Face(raster_ft_library, raster_font_paths[i], 0, &raster_ft_face) == 0) {
+            NSLOG(wisp, INFO, "Raster text using %s", raster_font_paths[i]);
+            return raster_ft_face;
+        }
+    }
+
+    NSLOG(wisp, WARNING, "No font found for raster text, set raster_font");
+    raster_ft_face = NULL;
+    return NULL;
+}
+
+
+/**
+ * Get a rendered glyph.
+ *
+ * \param ucs4 The character.
+ * \param size The pixel size.
+ * \param style Bit 0 for bold, bit 1 for slanted.
+ * \return the glyph or NULL if there is no font or it failed to render.
+ */
+static const struct raster_glyph *raster_glyph_get(uint32_t ucs4, int size, int style)
+{
+    FT_Face face = raster_font_face();
+    struct raster_glyph *glyph;
+    FT_GlyphSlot slot;
+    int row;
+
+    if (face == NULL) {
+        return NULL;
+    }
+
+    glyph = &raster_glyphs[((ucs4 * 2654435761u) ^ ((uint32_t)size * 40503u) ^ (uint32_t)style) %
+        RASTER_GLYPH_CACHE];
+    if (glyph->valid && glyph->ucs4 == ucs4 && glyph->size == size && glyph->style == style) {
+        return glyph;
+    }
+
+    if (size != raster_ft_size) {
+        if (FT_Set_Pixel_Sizes(face, 0, size) != 0) {
+            return NULL;
+        }
+        raster_ft_size = size;
+    }
+    if (FT_Load_Char(face, ucs4, FT_LOAD_NO_BITMAP) != 0) {
+        return NULL;
+    }
+    slot = face->glyph;
+    if (style & 1) {
+        FT_GlyphSlot_Embolden(slot);
+    }
+    if (style & 2) {
+        FT_GlyphSlot_Oblique(slot);
+    }
+    if (FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL) != 0 || slot->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY) {
+        return NULL;
+    }
+
+    free(glyph->coverage);
+    glyph->valid = false;
+    glyph->coverage = NULL;
+    glyph->width = slot->bitmap.width;
+    glyph->height = slot->bitmap.rows;
+    if (glyph->width > 0 && glyph->height > 0) {
+        glyph->coverage = malloc((size_t)glyph->width * glyph->height);
+        if (glyph->coverage == NULL) {
+            return NULL;
+        }
+        for (row = 0; row < glyph->height; row++) {
+            memcpy(glyph->coverage + (size_t)row * glyph->width, slot->bitmap.buffer + row * slot->bitmap.pitch,
+                glyph->width);
+        }
+    }
+    glyph->ucs4 = ucs4;
+    glyph->size = size;
+    glyph->style = style;
+    glyph->left = slot->bitmap_left;
+    glyph->top = slot->bitmap_top;
+    glyph->valid = true;
+
+    return glyph;
+}
+
+
+/**
+ * Draw a rendered glyph.
+ *
+ * \param r The surface.
+ * \param glyph The glyph.
+ * \param x The pen position.
+ * \param y The baseline.
+ * \param pixel The text colour.
+ */
+static void raster_draw_glyph(struct monkey_raster *r, const struct raster_glyph *glyph, int x, int y, uint32_t pixel)
+{
+    uint8_t colour[4];
+    int gx = x + glyph->left;
+    int gy = y - glyph->top;
+    int x0 = max(gx, r->clip.x0);
+    int x1 = min(gx + glyph->width, r->clip.x1);
+    int y0 = max(gy, r->clip.y0);
+    int y1 = min(gy + glyph->height, r->clip.y1);
+    int row, col;
+
+    if (x0 >= x1) {
+        return;
+    }
+    memcpy(colour, &pixel, sizeof(colour));
+    for (row = y0; row < y1; row++) {
+        const uint8_t *coverage = glyph->coverage + (size_t)(row - gy) * glyph->width + (x0 - gx);
+
+        for (col = 0; col < x1 - x0; col++) {
+            uint8_t *out = r->row + (size_t)col * 4;
+
+            out[0] = colour[0];
+            out[1] = colour[1];
+            out[2] = colour[2];
+            out[3] = (coverage[col] * colour[3] + 127) / 255;
+        }
+        raster_blend_row(r->pixels + (size_t)row * r->rowstride + (size_t)x0 * 4, r->row, x1 - x0);
+    }
+}
+
+#endif
+
+
+/**
+ * Text plotting.
+ *
+ * Each character is drawn at the fixed advance monkey's layout measures
+ * with.  Without a font, a block the size of a lower case letter stands in
+ * for each visible character.
+ *
+ * \param ctx The current redraw context.
+ * \param fstyle plot style for this text
+ * \param x x coordinate
+ * \param y y coordinate
+ * \param text UTF-8 string to plot
+ * \param length length of string, in bytes
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_text(const struct redraw_context *ctx, const struct plot_font_style *fstyle, int x, int y,
+    const char *text, size_t length)
+{
+    struct monkey_raster *r = ctx->priv;
+    float scale = raster_transform_scale(r->transform);
+    float size = plot_style_fixed_to_float(fstyle->size) * scale;
+    float advance = (fstyle->size / PLOT_STYLE_SCALE + fstyle->letter_spacing) * scale;
+    struct raster_point pen = raster_map(r->transform, x, y);
+    uint32_t pixel = raster_colour_pixel(fstyle->foreground, 0.0f);
+    int em = (int)(size + 0.5f);
+    size_t offset = 0;
+
+    if (em < 1 || em > 2048) {
+        return NSERROR_OK;
+    }
+
+    while (offset < length) {
+        uint32_t ucs4 = utf8_to_ucs4(text + offset, length - offset);
+        int px = (int)floorf(pen.x + 0.5f);
+        int py = (int)floorf(pen.y + 0.5f);
+
+        if (ucs4 > 0x20) {
+#ifdef WITH_FREETYPE
+            const struct raster_glyph *glyph;
+            int style = ((fstyle->weight >= 600) ? 1 : 0) | ((fstyle->flags & (FONTF_ITALIC | FONTF_OBLIQUE)) ? 2 : 0);
+
+            if (raster_font_face() != NULL) {
+                glyph = raster_glyph_get(ucs4, em, style);
+                if (glyph != NULL) {
+                    raster_draw_glyph(r, glyph, px, py, pixel);
+                }
+            } else
+#endif
+            {
+                struct raster_paint paint;
+
+                paint.type = RASTER_PAINT_SOLID;
+                paint.pixel = pixel;
+                raster_paint_area(r, &paint, px + em / 10, py - (em * 11) / 20, px + (em * 6) / 10, py);
+            }
+        }
+
+        pen.x += advance;
+        offset = utf8_next(text, length, offset);
+    }
+
+    return NSERROR_OK;
+}
+
+
+/**
+ * Push a transformation matrix onto the transform stack.
+ *
+ * The clip is saved with the transform, as the other frontends do.
+ *
+ * \param ctx The current redraw context.
+ * \param transform 6-element affine transform matrix.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_push_transform(const struct redraw_context *ctx, const float transform[6])
+{
+    struct monkey_raster *r = ctx->priv;
+
+    if (r->depth == RASTER_STACK_DEPTH) {
+        NSLOG(wisp, WARNING, "raster transform stack overflow");
+        return NSERROR_NOSPACE;
+    }
+    memcpy(r->stack[r->depth].transform, r->transform, sizeof(r->transform));
+    r->stack[r->depth].clip = r->clip;
+    r->depth++;
+
+    raster_transform_multiply(r->transform, transform, r->transform);
+    return NSERROR_OK;
+}
+
+
+/**
+ * Pop the most recent transform from the transform stack.
+ *
+ * \param ctx The current redraw context.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_pop_transform(const struct redraw_context *ctx)
+{
+    struct monkey_raster *r = ctx->priv;
+
+    if (r->depth == 0) {
+        return NSERROR_INVALID;
+    }
+    r->depth--;
+    memcpy(r->transform, r->stack[r->depth].transform, sizeof(r->transform));
+    r->clip = r->stack[r->depth].clip;
+    return NSERROR_OK;
+}
+
+
+/**
+ * Build the colour ramp of a gradient.
+ */
+static void raster_build_ramp(uint32_t *ramp, const struct gradient_stop *stops, unsigned int count)
+{
+    unsigned int i, k = 0;
+
+    for (i = 0; i < RASTER_RAMP_SIZE; i++) {
+        float t = (float)i / (RASTER_RAMP_SIZE - 1);
+        uint32_t a, b;
+        uint8_t ca[4], cb[4];
+        float f;
+
+        while (k < count && stops[k].offset < t) {
+            k++;
+        }
+        if (k == 0) {
+            ramp[i] = raster_colour_pixel(stops[0].color, 0.0f);
+            continue;
+        }
+        if (k == count || stops[k].offset <= stops[k - 1].offset) {
+            ramp[i] = raster_colour_pixel(stops[min(k, count - 1)].color, 0.0f);
+            continue;
+        }
+
+        a = raster_colour_pixel(stops[k - 1].color, 0.0f);
+        b = raster_colour_pixel(stops[k].color, 0.0f);
+        memcpy(ca, &a, 4);
+        memcpy(cb, &b, 4);
+        f = (t - stops[k - 1].offset) / (stops[k].offset - stops[k - 1].offset);
+        ramp[i] = raster_pack(ca[0] + (cb[0] - ca[0]) * f + 0.5f, ca[1] + (cb[1] - ca[1]) * f + 0.5f,
+            ca[2] + (cb[2] - ca[2]) * f + 0.5f, ca[3] + (cb[3] - ca[3]) * f + 0.5f);
+    }
+}
+
+
+/**
+ * Fill a path, or the clip when there is no path, with a gradient.
+ *
+ * The gradient geometry is in the same space as the path.
+ *
+ * \param r The surface.
+ * \param paint The gradient with its geometry and ramp set up.
+ * \param path The path, may be NULL.
+ * \param path_len Number of elements in the path.
+ * \param transform Transform applied to the path and gradient, may be NULL.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_fill_gradient(struct monkey_raster *r, struct raster_paint *paint, const float *path,
+    unsigned int path_len, const float transform[6])
+{
+    float m[6];
+    nserror res;
+
+    if (path == NULL || path_len < 3) {
+        transform = NULL;
+    }
+    if (transform != NULL) {
+        raster_transform_multiply(m, transform, r->transform);
+    } else {
+        memcpy(m, r->transform, sizeof(m));
+    }
+    if (!raster_transform_invert(paint->inverse, m)) {
+        return NSERROR_OK;
+    }
+
+    if (path == NULL || path_len < 3) {
+        raster_paint_area(r, paint, r->clip.x0, r->clip.y0, r->clip.x1, r->clip.y1);
+        return NSERROR_OK;
+    }
+
+    res = raster_flatten_path(r, path, path_len, transform);
+    if (res == NSERROR_OK) {
+        res = raster_fill_subpaths(r, paint);
+    }
+    return res;
+}
+
+
+/**
+ * Plot a linear gradient filling a path.
+ *
+ * \param ctx The current redraw context.
+ * \param path Path data (float array with path commands).
+ * \param path_len Number of elements in path array.
+ * \param transform 6-element affine transform to apply to path.
+ * \param x0, y0 Start point of gradient line.
+ * \param x1, y1 End point of gradient line.
+ * \param stops Array of color stops.
+ * \param stop_count Number of color stops.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_linear_gradient(const struct redraw_context *ctx, const float *path, unsigned int path_len,
+    const float transform[6], float x0, float y0, float x1, float y1, const struct gradient_stop *stops,
+    unsigned int stop_count)
+{
+    struct monkey_raster *r = ctx->priv;
+    struct raster_paint paint;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float length2 = dx * dx + dy * dy;
+
+    if (stop_count < 2) {
+        return NSERROR_INVALID;
+    }
+
+    paint.type = RASTER_PAINT_LINEAR;
+    paint.x0 = x0;
+    paint.y0 = y0;
+    paint.dx = (length2 > 0.0f) ? dx / length2 : 0.0f;
+    paint.dy = (length2 > 0.0f) ? dy / length2 : 0.0f;
+    raster_build_ramp(paint.ramp, stops, stop_count);
+    if (!(length2 > 0.0f)) {
+        /* a gradient of no length shows its last colour */
+        paint.type = RASTER_PAINT_SOLID;
+        paint.pixel = paint.ramp[RASTER_RAMP_SIZE - 1];
+    }
+
+    return raster_fill_gradient(r, &paint, path, path_len, transform);
+}
+
+
+/**
+ * Plot a radial gradient filling a path.
+ *
+ * \param ctx The current redraw context.
+ * \param path Path data (float array with path commands).
+ * \param path_len Number of elements in path array.
+ * \param transform 6-element affine transform to apply to path.
+ * \param cx, cy Center point of gradient.
+ * \param rx, ry X and Y radii (set both equal for circle).
+ * \param stops Array of color stops.
+ * \param stop_count Number of color stops.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror raster_plot_radial_gradient(const struct redraw_context *ctx, const float *path, unsigned int path_len,
+    const float transform[6], float cx, float cy, float rx, float ry, const struct gradient_stop *stops,
+    unsigned int stop_count)
+{
+    struct monkey_raster *r = ctx->priv;
+    struct raster_paint paint;
+
+    if (stop_count < 2) {
+        return NSERROR_INVALID;
+    }
+
+    paint.type = RASTER_PAINT_RADIAL;
+    paint.x0 = cx;
+    paint.y0 = cy;
+    paint.dx = (rx > 0.0f) ? 1.0f / rx : 0.0f;
+    paint.dy = (ry > 0.0f) ? 1.0f / ry : 0.0f;
+    raster_build_ramp(paint.ramp, stops, stop_count);
+    if (!(rx > 0.0f) || !(ry > 0.0f)) {
+        paint.type = RASTER_PAINT_SOLID;
+        paint.pixel = paint.ramp[RASTER_RAMP_SIZE - 1];
+    }
+
+    return raster_fill_gradient(r, &paint, path, path_len, transform);
+}
+
+
+/* exported interface documented in monkey/raster.h */
+nserror
+monkey_raster_create(uint8_t *buffer, size_t rowstride, int width, int height, struct monkey_raster **raster_out)
+{
+    struct monkey_raster *r;
+
+    if (width <= 0 || height <= 0) {
+        return NSERROR_BAD_SIZE;
+    }
+
+    r = calloc(1, sizeof(*r));
+    if (r == NULL) {
+        return NSERROR_NOMEM;
+    }
+    r->width = width;
+    r->height = height;
+    if (buffer != NULL) {
+        r->pixels = buffer;
+        r->rowstride = rowstride;
+    } else {
+        r->rowstride = (size_t)width * 4;
+        r->pixels = malloc(r->rowstride * height);
+        r->owned = true;
+    }
+    r->row = malloc((size_t)width * 4);
+    r->columns = malloc((size_t)width * sizeof(*r->columns));
+    if (r->pixels == NULL || r->row == NULL || r->columns == NULL) {
+        monkey_raster_destroy(r);
+        return NSERROR_NOMEM;
+    }
+
+    memcpy(r->transform, raster_identity, sizeof(r->transform));
+    r->clip.x1 = width;
+    r->clip.y1 = height;
+
+    *raster_out = r;
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in monkey/raster.h */
+void monkey_raster_destroy(struct monkey_raster *raster)
+{
+    if (raster->owned) {
+        free(raster->pixels);
+    }
+    free(raster->points);
+    free(raster->subpaths);
+    free(raster->edges);
+    free(raster->active);
+    free(raster->crossings);
+    free(raster->row);
+    free(raster->columns);
+    free(raster);
+}
+
+
+/* exported interface documented in monkey/raster.h */
+void monkey_raster_clear(struct monkey_raster *raster, colour background)
+{
+    struct raster_paint paint;
+
+    memcpy(raster->transform, raster_identity, sizeof(raster->transform));
+    raster->depth = 0;
+    raster->clip.x0 = 0;
+    raster->clip.y0 = 0;
+    raster->clip.x1 = raster->width;
+    raster->clip.y1 = raster->height;
+
+    paint.type = RASTER_PAINT_SOLID;
+    paint.pixel = raster_colour_pixel(background & 0xffffff, 0.0f);
+    raster_paint_area(raster, &paint, 0, 0, raster->width, raster->height);
+}
+
+
+/* exported interface documented in monkey/raster.h */
+void monkey_raster_get_size(const struct monkey_raster *raster, int *width, int *height)
+{
+    *width = raster->width;
+    *height = raster->height;
+}
+
+
+/* exported interface documented in monkey/raster.h */
+nserror monkey_raster_write_png(const struct monkey_raster *raster, const char *path)
+{
+#ifdef WITH_PNG
+    png_structp png;
+    png_infop info;
+    FILE *fp;
+    int y;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return NSERROR_SAVE_FAILED;
+    }
+
+    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (png == NULL) {
+        fclose(fp);
+        return NSERROR_NOMEM;
+    }
+    info = png_create_info_struct(png);
+    if (info == NULL) {
+        png_destroy_write_struct(&png, NULL);
+        fclose(fp);
+        return NSERROR_NOMEM;
+    }
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        fclose(fp);
+        remove(path);
+        return NSERROR_SAVE_FAILED;
+    }
+
+    png_init_io(png, fp);
+    /* screenshots are taken often and read once, favour speed */
+    png_set_compression_level(png, 1);
+    png_set_IHDR(png, info, raster->width, raster->height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (y = 0; y < raster->height; y++) {
+        png_write_row(png, raster->pixels + (size_t)y * raster->rowstride);
+    }
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+
+    if (fclose(fp) != 0) {
+        remove(path);
+        return NSERROR_SAVE_FAILED;
+    }
+    return NSERROR_OK;
+#else
+    return NSERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/* exported interface documented in monkey/raster.h */
+void monkey_raster_finalise(void)
+{
+#ifdef WITH_FREETYPE
+    size_t i;
+
+    for (i = 0; i < RASTER_GLYPH_CACHE; i++) {
+        free(raster_glyphs[i].coverage);
+        raster_glyphs[i].coverage = NULL;
+        raster_glyphs[i].valid = false;
+    }
+    if (raster_ft_face != NULL) {
+        FT_Done_Face(raster_ft_face);
+        raster_ft_face = NULL;
+    }
+    if (raster_ft_tried && raster_ft_library != NULL) {
+        FT_Done_FreeType(raster_ft_library);
+        raster_ft_library = NULL;
+    }
+    raster_ft_tried = false;
+    raster_ft_size = 0;
+#endif
+}
+
+
+/** monkey raster plotter operations table */
+static const struct plotter_table plotters = {
+    .clip = raster_plot_clip,
+    .arc = raster_plot_arc,
+    .disc = raster_plot_disc,
+    .line = raster_plot_line,
+    .rectangle = raster_plot_rectangle,
+    .polygon = raster_plot_polygon,
+    .path = raster_plot_path,
+    .bitmap = raster_plot_bitmap,
+    .text = raster_plot_text,
+    .push_transform = raster_push_transform,
+    .pop_transform = raster_pop_transform,
+    .linear_gradient = raster_plot_linear_gradient,
+    .radial_gradient = raster_plot_radial_gradient,
+    .option_knockout = true,
+};
+
+const struct plotter_table *monkey_raster_plotters = &plotters;
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Monkey software raster plotters (interface).
+ *
+ * A CPU rasteriser implementing the whole plotter table into an RGBA
+ * surface, so monkey can measure real paint cost and produce screenshots
+ * without a display.  Redraws using these plotters must pass the surface
+ * as the redraw context private word.
+ */
+
+#ifndef WISP_MONKEY_RASTER_H
+#define WISP_MONKEY_RASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/errors.h"
+#include "wisp/types.h"
+
+struct plotter_table;
+struct monkey_raster;
+
+/** Plotters rendering into the struct monkey_raster in ctx->priv */
+extern const struct plotter_table *monkey_raster_plotters;
+
+/**
+ * Create a raster surface.
+ *
+ * Pixels are four bytes each, red, green, blue then alpha, which is the
+ * layout monkey bitmaps use.
+ *
+ * \param buffer Pixel memory to render into or NULL to allocate it.
+ * \param rowstride Bytes per row of \a buffer, ignored when it is NULL.
+ * \param width Width of the surface in pixels.
+ * \param height Height of the surface in pixels.
+ * \param raster_out Updated with the new surface on success.
+ * \return NSERROR_OK on success else error code.
+ */
+nserror monkey_raster_create(
+    uint8_t *buffer, size_t rowstride, int width, int height, struct monkey_raster **raster_out);
+
+/**
+ * Destroy a raster surface.
+ *
+ * Pixel memory passed to monkey_raster_create() is not freed.
+ *
+ * \param raster The surface to destroy.
+ */
+void monkey_raster_destroy(struct monkey_raster *raster);
+
+/**
+ * Prepare a raster surface for a redraw.
+ *
+ * Fills the surface with a colour and resets the clip and transform.
+ *
+ * \param raster The surface to prepare.
+ * \param background The colour to fill with.
+ */
+void monkey_raster_clear(struct monkey_raster *raster, colour background);
+
+/**
+ * Get the size of a raster surface.
+ *
+ * \param raster The surface to measure.
+ * \param width Updated with the width in pixels.
+ * \param height Updated with the height in pixels.
+ */
+void monkey_raster_get_size(const struct monkey_raster *raster, int *width, int *height);
+
+/**
+ * Write the contents of a raster surface to a PNG file.
+ *
+ * \param raster The surface to write.
+ * \param path The file to create.
+ * \return NSERROR_OK on success, NSERROR_NOT_IMPLEMENTED when built without
+ *         PNG support else error code.
+ */
+nserror monkey_raster_write_png(const struct monkey_raster *raster, const char *path);
+
+/**
+ * Release the font resources held by the raster plotters.
+ */
+void monkey_raster_finalise(void);
+
+#endif /* WISP_MONKEY_RASTER_H */
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Monkey performance statistics (implementation).
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "utils/phase.h"
+#include "wisp/types.h"
+#include "wisp/content/llcache.h"
+#include "desktop/measure_cache.h"
+#include "content/handlers/image/image_cache.h"
+
+#include "monkey/output.h"
+#include "monkey/stats.h"
+
+/*
+ * Allocations are counted by interposing the allocator, which is only
+ * possible where the C library exports its own entry points, and must be
+ * left alone when a sanitizer replaces the allocator itself.
+ */
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer) || __has_feature(thread_sanitizer)
+#define MONKEY_STATS_SANITIZED
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define MONKEY_STATS_SANITIZED
+#endif
+
+#if defined(__GLIBC__) && !defined(MONKEY_STATS_SANITIZED)
+#define MONKEY_STATS_ALLOC
+#endif
+
+/**
+ * Cache counters, as snapshotted by STATS RESET
+ */
+struct monkey_cache_stats {
+    struct llcache_stats llcache;
+    struct measure_cache_stats measure;
+    unsigned int image_hits; /**< reads satisfied without conversion */
+    unsigned int image_misses; /**< reads needing a conversion */
+    unsigned int image_fails; /**< reads which could not be satisfied */
+};
+
+/** Cache counters when the statistics were last reset */
+static struct monkey_cache_stats stats_base;
+
+
+#ifdef MONKEY_STATS_ALLOC
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+/** Number of allocation requests, from any thread */
+static uint64_t alloc_count;
+
+/** Bytes requested by allocations, from any thread */
+static uint64_t alloc_bytes;
+
+/** Allocation counters when the statistics were last reset */
+static uint64_t alloc_count_base;
+static uint64_t alloc_bytes_base;
+
+static inline void stats_count_alloc(size_t size)
+{
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&alloc_bytes, size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    stats_count_alloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    stats_count_alloc(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    stats_count_alloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+#endif
+
+
+/**
+ * Read the current cache counters.
+ */
+static void stats_get_caches(struct monkey_cache_stats *caches)
+{
+    char summary[64];
+
+    llcache_get_stats(&caches->llcache);
+    measure_cache_get_stats(&caches->measure);
+
+    caches->image_hits = caches->image_misses = caches->image_fails = 0;
+    image_cache_snsummaryf(summary, sizeof(summary), "%k %l %m");
+    if (sscanf(summary, "%u %u %u", &caches->image_hits, &caches->image_misses, &caches->image_fails) != 3) {
+        moutf(MOUT_WARNING, "STATS IMAGE SUMMARY UNREADABLE");
+    }
+}
+
+
+/**
+ * Start gathering statistics afresh.
+ */
+static void monkey_stats_reset(void)
+{
+    phase_reset();
+    stats_get_caches(&stats_base);
+#ifdef MONKEY_STATS_ALLOC
+    alloc_count_base = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    alloc_bytes_base = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+#endif
+
+    moutf(MOUT_STATS, "RESET");
+}
+
+
+/**
+ * Report the statistics gathered since the last reset.
+ */
+static void monkey_stats_report(void)
+{
+    struct phase_stats phases;
+    struct monkey_cache_stats caches;
+    enum phase phase;
+#ifndef _WIN32
+    struct rusage usage;
+#endif
+
+    phase_get_stats(&phases);
+    for (phase = PHASE_NONE; phase < PHASE__COUNT; phase++) {
+        moutf(MOUT_STATS, "PHASE %s TIME %" PRIu64 " COUNT %" PRIu64, phase_name(phase), phases.time[phase],
+            phases.count[phase]);
+    }
+    moutf(MOUT_STATS, "ELAPSED %" PRIu64, phases.elapsed);
+
+#ifndef _WIN32
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        /* reported in bytes rather than kilobytes */
+        usage.ru_maxrss /= 1024;
+#endif
+        moutf(MOUT_STATS, "MEMORY PEAK_RSS %ld", (long)usage.ru_maxrss);
+    }
+#endif
+
+#ifdef MONKEY_STATS_ALLOC
+    moutf(MOUT_STATS, "ALLOC COUNT %" PRIu64 " BYTES %" PRIu64,
+        __atomic_load_n(&alloc_count, __ATOMIC_RELAXED) - alloc_count_base,
+        __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED) - alloc_bytes_base);
+#endif
+
+    stats_get_caches(&caches);
+    moutf(MOUT_STATS, "CACHE LLCACHE HIT %" PRIu64 " MISS %" PRIu64 " REVALIDATE %" PRIu64 " UNCACHEABLE %" PRIu64,
+        caches.llcache.hits - stats_base.llcache.hits, caches.llcache.misses - stats_base.llcache.misses,
+        caches.llcache.revalidations - stats_base.llcache.revalidations,
+        caches.llcache.uncacheable - stats_base.llcache.uncacheable);
+    moutf(MOUT_STATS, "CACHE MEASURE HIT %" PRIu64 " MISS %" PRIu64 " BYPASS %" PRIu64,
+        caches.measure.hits - stats_base.measure.hits, caches.measure.misses - stats_base.measure.misses,
+        caches.measure.bypass - stats_base.measure.bypass);
+    moutf(MOUT_STATS, "CACHE IMAGE HIT %u MISS %u FAIL %u", caches.image_hits - stats_base.image_hits,
+        caches.image_misses - stats_base.image_misses, caches.image_fails - stats_base.image_fails);
+
+    moutf(MOUT_STATS, "END");
+}
+
+
+/* exported interface documented in monkey/stats.h */
+void monkey_stats_handle_command(int argc, char **argv)
+{
+    if (argc == 1)
+        return;
+
+    if (strcmp(argv[1], "RESET") == 0) {
+        monkey_stats_reset();
+    } else if (strcmp(argv[1], "REPORT") == 0) {
+        monkey_stats_report();
+    } else {
+        moutf(MOUT_ERROR, "STATS COMMAND UNKNOWN %s\n", argv[1]);
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Monkey performance statistics (interface).
+ *
+ * Reports the core phase timings, cache hit rates, allocations and peak
+ * memory so page loads can be benchmarked headlessly.
+ */
+
+#ifndef WISP_MONKEY_STATS_H
+#define WISP_MONKEY_STATS_H
+
+/**
+ * Handle a STATS command.
+ *
+ * \param argc The number of words in the command.
+ * \param argv The words of the command.
+ */
+void monkey_stats_handle_command(int argc, char **argv);
+
+#endif /* WISP_MONKEY_STATS_H */
@@ -219,6 +219,40 @@ static nserror nsqt_bitmap_render(struct bitmap *bitmap, struct hlcache_handle *
 }
 
 
+/**
+ * Plot into a bitmap.
+ *
+ * \param bitmap The bitmap to plot into.
+ * \param redraw The function performing the plot operations.
+ * \param pw Private word passed to the redraw function.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror nsqt_bitmap_render_plot(
+    struct bitmap *bitmap, bool (*redraw)(const struct redraw_context *ctx, void *pw), void *pw)
+{
+    QImage *dimg = (QImage *)bitmap;
+    struct redraw_context ctx = {
+        .interactive = false,
+        .background_images = true,
+        .plot = &nsqt_plotters,
+        .priv = NULL,
+    };
+    bool ok;
+
+    dimg->fill(Qt::transparent);
+
+    QPainter painter(dimg);
+    painter.setRenderHint(QPainter::Antialiasing);
+    ctx.priv = &painter;
+
+    ok = redraw(&ctx, pw);
+
+    painter.end();
+
+    return ok ? NSERROR_OK : NSERROR_INVALID;
+}
+
+
 static struct gui_bitmap_table bitmap_table = {
     .create = nsqt_bitmap_create,
     .destroy = nsqt_bitmap_destroy,
@@ -230,6 +264,7 @@ static struct gui_bitmap_table bitmap_table = {
     .get_height = nsqt_bitmap_get_height,
     .modified = nsqt_bitmap_modified,
     .render = nsqt_bitmap_render,
+    .render_plot = nsqt_bitmap_render_plot,
 };
 
 struct gui_bitmap_table *nsqt_bitmap_table = &bitmap_table;
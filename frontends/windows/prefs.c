@@ -30,6 +30,7 @@
 #include "wisp/utils/log.h"
 #include "wisp/utils/messages.h"
 #include "wisp/utils/nsoption.h"
+#include "wisp/browser.h"
 
 #include "windows/gui.h"
 #include "windows/prefs.h"
@@ -272,6 +273,7 @@ static INT_PTR CALLBACK options_appearance_dialog_handler(HWND hwnd, UINT msg, W
 
             if (ChooseFont(cf) == TRUE) {
                 nsoption_set_charp(font_sans, strdup(cf->lpLogFont->lfFaceName));
+                browser_font_options_changed();
             }
 
             free(cf->lpLogFont);
@@ -291,6 +293,7 @@ static INT_PTR CALLBACK options_appearance_dialog_handler(HWND hwnd, UINT msg, W
 
             if (ChooseFont(cf) == TRUE) {
                 nsoption_set_charp(font_serif, strdup(cf->lpLogFont->lfFaceName));
+                browser_font_options_changed();
             }
 
             free(cf->lpLogFont);
@@ -310,6 +313,7 @@ static INT_PTR CALLBACK options_appearance_dialog_handler(HWND hwnd, UINT msg, W
 
             if (ChooseFont(cf) == TRUE) {
                 nsoption_set_charp(font_mono, strdup(cf->lpLogFont->lfFaceName));
+                browser_font_options_changed();
             }
 
             free(cf->lpLogFont);
@@ -330,6 +334,7 @@ static INT_PTR CALLBACK options_appearance_dialog_handler(HWND hwnd, UINT msg, W
 
             if (ChooseFont(cf) == TRUE) {
                 nsoption_set_charp(font_cursive, strdup(cf->lpLogFont->lfFaceName));
+                browser_font_options_changed();
             }
             free(cf->lpLogFont);
             free(cf);
@@ -348,6 +353,7 @@ static INT_PTR CALLBACK options_appearance_dialog_handler(HWND hwnd, UINT msg, W
 
             if (ChooseFont(cf) == TRUE) {
                 nsoption_set_charp(font_fantasy, strdup(cf->lpLogFont->lfFaceName));
+                browser_font_options_changed();
             }
             free(cf->lpLogFont);
             free(cf);
@@ -104,6 +104,7 @@ typedef struct bitmap_fmt {
 struct content;
 struct bitmap;
 struct hlcache_handle;
+struct redraw_context;
 
 /**
  * Set client bitmap format.
@@ -210,6 +211,22 @@ struct gui_bitmap_table {
      * \param content The content to render.
      */
     nserror (*render)(struct bitmap *bitmap, struct hlcache_handle *content);
+
+    /* Optional entries */
+
+    /**
+     * Plot into a bitmap.
+     *
+     * Sets up a raster redraw context targeting the bitmap and
+     * calls the supplied redraw function with it. This allows the
+     * core to rasterise vector content for caching.
+     *
+     * \param bitmap The bitmap to plot into.
+     * \param redraw The function performing the plot operations.
+     * \param pw Private word passed to the redraw function.
+     * \return NSERROR_OK on success else error code.
+     */
+    nserror (*render_plot)(struct bitmap *bitmap, bool (*redraw)(const struct redraw_context *ctx, void *pw), void *pw);
 };
 
 #endif
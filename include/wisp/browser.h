@@ -41,4 +41,13 @@ nserror browser_set_dpi(int dpi);
  */
 int browser_get_dpi(void);
 
+/**
+ * Tell the browser the font face options have changed.
+ *
+ * Frontends must call this after changing any of the font_sans,
+ * font_serif, font_mono, font_cursive or font_fantasy options once
+ * browsing has started, as text may now measure differently.
+ */
+void browser_font_options_changed(void);
+
 #endif
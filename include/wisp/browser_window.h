@@ -141,7 +141,10 @@ enum browser_window_nav_flags {
     BW_NAVIGATE_NO_TERMINAL_HISTORY_UPDATE = (1 << 3),
 
     /** Internal navigation (set only by core features using such) */
-    BW_NAVIGATE_INTERNAL = (1 << 4)
+    BW_NAVIGATE_INTERNAL = (1 << 4),
+
+    /** reuse a retained converted content if possible (used by back/fwd) */
+    BW_NAVIGATE_RESTORE = (1 << 5)
 };
 
 /**
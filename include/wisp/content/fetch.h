@@ -180,6 +180,17 @@ void fetch_abort(struct fetch *f);
  */
 bool fetch_can_fetch(const nsurl *url);
 
+/**
+ * Speculatively resolve the host name of a URL.
+ *
+ * Used for resource hints and hovered links. Nothing is fetched and no
+ * connection is opened; the fetcher resolves the host so a later fetch
+ * skips the lookup. Hints the fetcher has no use for are ignored.
+ *
+ * \param url  URL whose origin is likely to be fetched from
+ */
+void fetch_prefetch_dns(const nsurl *url);
+
 /**
  * Change the callback function for a fetch.
  */
@@ -40,6 +40,11 @@ struct html_content;
 struct nsurl;
 struct dom_node;
 struct dom_string;
+struct form_control;
+struct hlcache_handle;
+struct scrollbar;
+struct flex_layout_cache;
+struct stacking_node;
 struct rect;
 
 #define UNKNOWN_WIDTH INT_MAX
@@ -194,112 +199,97 @@ struct object_params {
 
 
 /**
- * Node in box tree. All dimensions are in pixels.
+ * Box data that layout and redraw rarely look at.
+ *
+ * Most boxes have none of it, so it is kept out of struct box and only
+ * allocated for boxes that need it. Read it with box_extra() and change
+ * it through box_extra_alloc().
  */
-struct box {
-    /**
-     * Type of box.
-     */
-    box_type type;
-
+struct box_extra {
     /**
-     * Box flags
-     */
-    box_flags flags;
-
-    /**
-     * DOM node that generated this box or NULL
+     *  value of id attribute (or name for anchors)
      */
-    struct dom_node *node;
+    lwc_string *id;
 
     /**
-     * Computed styles for elements and their pseudo elements.
-     *  NULL on non-element boxes.
+     * Link, or NULL.
      */
-    css_select_results *styles;
+    struct nsurl *href;
 
     /**
-     * Style for this box. 0 for INLINE_CONTAINER and
-     *  FLOAT_*. Pointer into a box's 'styles' select results,
-     *  except for implied boxes, where it is a pointer to an
-     *  owned computed style.
+     * Link target, or NULL.
      */
-    css_computed_style *style;
+    const char *target;
 
     /**
-     *  value of id attribute (or name for anchors)
+     * Title, or NULL.
      */
-    lwc_string *id;
-
+    const char *title;
 
     /**
-     * Next sibling box, or NULL.
+     * Form control data, or NULL if not a form control.
      */
-    struct box *next;
+    struct form_control *gadget;
 
     /**
-     * Previous sibling box, or NULL.
+     * (Image)map to use with this object, or NULL if none
      */
-    struct box *prev;
+    char *usemap;
 
     /**
-     * First child box, or NULL.
+     * Parameters for the object, or NULL.
      */
-    struct box *children;
+    struct object_params *object_params;
 
     /**
-     * Last child box, or NULL.
+     * Iframe's browser_window, or NULL if none
      */
-    struct box *last;
+    struct browser_window *iframe;
+};
 
-    /**
-     * Parent box, or NULL.
-     */
-    struct box *parent;
 
+/**
+ * Node in box tree. All dimensions are in pixels.
+ *
+ * The tree links and geometry read by every layout and redraw traversal
+ * come first so that walking the tree touches as few cache lines as
+ * possible.
+ */
+struct box {
     /**
-     * INLINE_END box corresponding to this INLINE box, or INLINE
-     * box corresponding to this INLINE_END box.
+     * Type of box.
      */
-    struct box *inline_end;
-
+    box_type type;
 
     /**
-     * First float child box, or NULL. Float boxes are in the tree
-     * twice, in this list for the block box which defines the
-     * area for floats, and also in the standard tree given by
-     * children, next, prev, etc.
+     * Box flags
      */
-    struct box *float_children;
+    box_flags flags;
 
     /**
-     * Next sibling float box.
+     * Next sibling box, or NULL.
      */
-    struct box *next_float;
+    struct box *next;
 
     /**
-     * If box is a float, points to box's containing block
+     * Previous sibling box, or NULL.
      */
-    struct box *float_container;
+    struct box *prev;
 
     /**
-     * For absolutely/fixed positioned boxes, points to the containing block
-     * (nearest positioned ancestor per CSS 2.1 §10.1). NULL for non-positioned
-     * boxes or when not yet computed.
+     * First child box, or NULL.
      */
-    struct box *abs_containing_block;
+    struct box *children;
 
     /**
-     * Level below which subsequent floats must be cleared.  This
-     * is used only for boxes with float_children
+     * Last child box, or NULL.
      */
-    int clear_level;
+    struct box *last;
 
     /**
-     * Level below which floats have been placed.
+     * Parent box, or NULL.
      */
-    int cached_place_below_level;
-
+    struct box *parent;
 
     /**
      * Coordinate of left padding edge relative to parent box, or
@@ -356,26 +346,56 @@ struct box {
     struct box_border border[4];
 
     /**
-     * Horizontal scroll.
+     * Style for this box. 0 for INLINE_CONTAINER and
+     *  FLOAT_*. Pointer into a box's 'styles' select results,
+     *  except for implied boxes, where it is a pointer to an
+     *  owned computed style.
      */
-    struct scrollbar *scroll_x;
+    css_computed_style *style;
 
     /**
-     * Vertical scroll.
+     * INLINE_END box corresponding to this INLINE box, or INLINE
+     * box corresponding to this INLINE_END box.
      */
-    struct scrollbar *scroll_y;
+    struct box *inline_end;
 
     /**
-     * Width of box taking all line breaks (including margins
-     * etc). For flex items, use .type to check if auto vs explicit.
+     * First float child box, or NULL. Float boxes are in the tree
+     * twice, in this list for the block box which defines the
+     * area for floats, and also in the standard tree given by
+     * children, next, prev, etc.
      */
-    struct css_size min_width;
+    struct box *float_children;
 
     /**
-     * Width that would be taken with no line breaks. Must be
-     * non-negative.
+     * Next sibling float box.
      */
-    int max_width;
+    struct box *next_float;
+
+    /**
+     * List marker box if this is a list-item, or NULL.
+     */
+    struct box *list_marker;
+
+    /**
+     * Object in this box (usually an image), or NULL if none.
+     */
+    struct hlcache_handle *object;
+
+    /**
+     * Rarely used data, or NULL if the box has none.
+     */
+    struct box_extra *extra;
+
+    /**
+     * Horizontal scroll.
+     */
+    struct scrollbar *scroll_x;
+
+    /**
+     * Vertical scroll.
+     */
+    struct scrollbar *scroll_y;
 
 
     /**
@@ -394,92 +414,117 @@ struct box {
     int space;
 
     /**
-     * Byte offset within a textual representation of this content.
+     * Width that would be taken with no line breaks. Must be
+     * non-negative.
      */
-    size_t byte_offset;
-
+    int max_width;
 
     /**
-     * Link, or NULL.
+     * Width of box taking all line breaks (including margins
+     * etc). For flex items, use .type to check if auto vs explicit.
      */
-    struct nsurl *href;
+    struct css_size min_width;
 
     /**
-     * Link target, or NULL.
+     * Byte offset within a textual representation of this content.
      */
-    const char *target;
+    size_t byte_offset;
+
 
     /**
-     * Title, or NULL.
+     * DOM node that generated this box or NULL
      */
-    const char *title;
-
+    struct dom_node *node;
 
     /**
-     * Number of columns for TABLE / TABLE_CELL.
+     * Computed styles for elements and their pseudo elements.
+     *  NULL on non-element boxes.
      */
-    unsigned int columns;
+    css_select_results *styles;
 
     /**
-     * Number of rows for TABLE only.
+     * If box is a float, points to box's containing block
      */
-    unsigned int rows;
+    struct box *float_container;
 
     /**
-     * Start column for TABLE_CELL only.
+     * For absolutely/fixed positioned boxes, points to the containing block
+     * (nearest positioned ancestor per CSS 2.1 §10.1). NULL for non-positioned
+     * boxes or when not yet computed.
      */
-    unsigned int start_column;
+    struct box *abs_containing_block;
 
     /**
-     * Array of table column data for TABLE only.
+     * Constraints and results of recent layouts of this box as a flex
+     * item, or NULL if it has not been laid out as one.
      */
-    struct column *col;
+    struct flex_layout_cache *flex_cache;
 
     /**
-     * List item value.
+     * Positioned descendants painted in the stacking context this box
+     * establishes, or NULL if it does not establish one.
      */
-    int list_value;
+    struct stacking_node *stacking;
 
     /**
-     * List marker box if this is a list-item, or NULL.
+     * Level below which subsequent floats must be cleared.  This
+     * is used only for boxes with float_children
      */
-    struct box *list_marker;
-
+    int clear_level;
 
     /**
-     * Form control data, or NULL if not a form control.
+     * Level below which floats have been placed.
      */
-    struct form_control *gadget;
+    int cached_place_below_level;
 
 
     /**
-     * (Image)map to use with this object, or NULL if none
+     * Number of columns for TABLE / TABLE_CELL.
      */
-    char *usemap;
-
+    unsigned int columns;
 
     /**
-     * Background image for this box, or NULL if none
+     * Number of rows for TABLE only.
      */
-    struct hlcache_handle *background;
+    unsigned int rows;
 
+    /**
+     * Start column for TABLE_CELL only.
+     */
+    unsigned int start_column;
 
     /**
-     * Object in this box (usually an image), or NULL if none.
+     * List item value.
      */
-    struct hlcache_handle *object;
+    int list_value;
 
     /**
-     * Parameters for the object, or NULL.
+     * Array of table column data for TABLE only.
      */
-    struct object_params *object_params;
+    struct column *col;
 
 
     /**
-     * Iframe's browser_window, or NULL if none
+     * Background image for this box, or NULL if none
      */
-    struct browser_window *iframe;
+    struct hlcache_handle *background;
 };
 
 
+/** Rarely used data of boxes that have none */
+static const struct box_extra box_extra_empty;
+
+
+/**
+ * Get the rarely used data of a box
+ *
+ * \param box  The box
+ * \return the box's data, all empty if it has none
+ */
+static inline const struct box_extra *box_extra(const struct box *box)
+{
+    return (box->extra != NULL) ? box->extra : &box_extra_empty;
+}
+
+
 #endif
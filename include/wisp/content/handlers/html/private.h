@@ -160,11 +160,17 @@ typedef struct html_content {
     void *box_conversion_context;
     /** Box tree, or NULL. */
     struct box *layout;
+    /** A talloc pool for data only needed during a layout pass, or NULL */
+    void *layout_scratch;
     /** Document background colour. */
     colour background_colour;
 
     /** Timestamp when we first delayed box conversion for fonts (ms), 0 if not waiting */
     uint64_t font_wait_start_ms;
+    /** Number of web font downloads this content is waiting on */
+    unsigned int font_pending_count;
+    /** End of the font-display block period (monotonic ms), 0 if none */
+    uint64_t font_block_deadline_ms;
 
     /** Font callback table */
     const struct gui_layout_table *font_func;
@@ -49,6 +49,9 @@ struct hlcache_parameters {
     /** How frequently the background cache clean process is run (ms) */
     unsigned int bg_clean_time;
 
+    /** Bytes of unused converted contents kept for history navigation */
+    size_t retain_limit;
+
     struct llcache_parameters llcache;
 };
 
@@ -71,7 +74,9 @@ enum hlcache_retrieve_flag {
     /** It's permitted to convert this request into a download */
     HLCACHE_RETRIEVE_MAY_DOWNLOAD = (1 << 31),
     /* Permit content-type sniffing */
-    HLCACHE_RETRIEVE_SNIFF_TYPE = (1 << 30)
+    HLCACHE_RETRIEVE_SNIFF_TYPE = (1 << 30),
+    /** Reuse an unused retained content rather than converting afresh */
+    HLCACHE_RETRIEVE_RESTORE = (1 << 29)
 };
 
 /**
@@ -175,7 +180,8 @@ nserror hlcache_handle_clone(hlcache_handle *handle, hlcache_handle **result);
 /**
  * Create a high-level cache handle from a raw data buffer.
  *
- * Generates a content-hash URL for automatic deduplication.
+ * Generates a content-hash URL for automatic deduplication. Contents are
+ * only shared between buffers whose bytes are identical.
  * The resulting cache entry is pinned (not subject to eviction)
  * and must be explicitly released on page teardown.
  *
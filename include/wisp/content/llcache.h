@@ -173,6 +173,23 @@ void llcache_finalise(void);
  */
 void llcache_clean(bool purge);
 
+/**
+ * Low-level cache retrieval statistics
+ */
+struct llcache_stats {
+    uint64_t hits; /**< retrievals answered by a fresh or usable stale object */
+    uint64_t revalidations; /**< retrievals which revalidate a stale object */
+    uint64_t misses; /**< cacheable retrievals which fetch afresh */
+    uint64_t uncacheable; /**< retrievals which are never cached */
+};
+
+/**
+ * Retrieve low-level cache statistics.
+ *
+ * \param[out] stats updated with the counts since initialisation
+ */
+void llcache_get_stats(struct llcache_stats *stats);
+
 /**
  * Retrieve a handle for a low-level cache object
  *
@@ -259,12 +276,36 @@ nsurl *llcache_handle_get_url(const llcache_handle *handle);
 /**
  * Retrieve source data of a low-level cache object
  *
+ * The source data is made contiguous, copying it if necessary.
+ *
  * \param handle  Handle to retrieve source data from
  * \param size    Pointer to location to receive byte length of data
  * \return Pointer to source data
  */
 const uint8_t *llcache_handle_get_source_data(const llcache_handle *handle, size_t *size);
 
+/**
+ * Retrieve the byte length of a low-level cache object's source data
+ *
+ * \param handle  Handle to retrieve source length from
+ * \return Byte length of source data
+ */
+size_t llcache_handle_get_source_length(const llcache_handle *handle);
+
+/**
+ * Retrieve a contiguous run of a low-level cache object's source data
+ *
+ * Source data is held in several runs while it is being fetched. Unlike
+ * llcache_handle_get_source_data() this never copies it. Iterate over the
+ * source data by advancing \a offset by \a len until NULL is returned.
+ *
+ * \param handle  Handle to retrieve source data from
+ * \param offset  Offset of the first byte wanted
+ * \param len     Pointer to location to receive byte length of run
+ * \return Pointer to source data at \a offset, or NULL if there is none
+ */
+const uint8_t *llcache_handle_get_source_run(const llcache_handle *handle, size_t offset, size_t *len);
+
 /**
  * Retrieve a header value associated with a low-level cache object
  *
@@ -289,6 +330,14 @@ const char *llcache_handle_get_header(const llcache_handle *handle, const char *
  */
 bool llcache_handle_references_same_object(const llcache_handle *a, const llcache_handle *b);
 
+/**
+ * Retrieve an identifier for the object referenced by a handle
+ *
+ * \param handle  Handle to consider
+ * \return Identifier which is equal for handles referencing the same object
+ */
+uintptr_t llcache_handle_get_object_id(const llcache_handle *handle);
+
 /**
  * Create a low-level cache handle from a raw data buffer.
  *
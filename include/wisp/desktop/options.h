@@ -92,6 +92,12 @@ NSOPTION_STRING(accept_charset, NULL)
 /** Preferred maximum size of memory cache / bytes. */
 NSOPTION_INTEGER(memory_cache_size, 12 * 1024 * 1024)
 
+/** Preferred maximum size of unused pages kept for history navigation / bytes. */
+NSOPTION_UINT(retained_content_size, 16 * 1024 * 1024)
+
+/** Preferred maximum size of decoded local history thumbnails / bytes. */
+NSOPTION_UINT(history_thumbnail_size, 2 * 1024 * 1024)
+
 /** Preferred location of disc cache, or NULL for system provided location */
 NSOPTION_STRING(disc_cache_path, NULL)
 
@@ -115,6 +121,13 @@ NSOPTION_BOOL(do_not_track, false)
 /** Whether to send the referer HTTP header */
 NSOPTION_BOOL(send_referer, true)
 
+/** Whether to resolve host names ahead of fetches for resource hints
+ * (dns-prefetch, preconnect and preload links) and hovered links.
+ *
+ * Only the name lookup is done; no connection is opened.
+ */
+NSOPTION_BOOL(dns_prefetch, true)
+
 /** Whether to fetch foreground images */
 NSOPTION_BOOL(foreground_images, true)
 
@@ -151,6 +164,9 @@ NSOPTION_STRING(cookie_file, NULL)
 /** Cookie jar location */
 NSOPTION_STRING(cookie_jar, NULL)
 
+/** Network state file location, or NULL for one in the disc cache */
+NSOPTION_STRING(network_state_file, NULL)
+
 /** Home page location */
 NSOPTION_STRING(homepage_url, NULL)
 
@@ -295,6 +311,8 @@ NSOPTION_COLOUR(sys_colour_VisitedText, 0x008b1a55)
 NSOPTION_STRING(log_filter, WISP_BUILTIN_LOG_FILTER)
 /** Filter for verbose logging */
 NSOPTION_STRING(verbose_filter, WISP_BUILTIN_VERBOSE_FILTER)
+/** File the trace is written to on exit, when built with WISP_ENABLE_TRACE */
+NSOPTION_STRING(trace_file, NULL)
 
 /* page colour selection */
 NSOPTION_UINT(colour_selection, 0)
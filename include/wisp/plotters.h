@@ -374,6 +374,16 @@ struct plotter_table {
      *  than once. See desktop/knockout.c
      */
     bool option_knockout;
+
+    /**
+     * flag to request rasterised vector content.
+     *
+     * Set by plotters for which streaming many vector primitives
+     *  is expensive (e.g. PDF export). Content handlers with
+     *  complex vector output may then plot a cached bitmap
+     *  instead. See content/handlers/image/svg.c
+     */
+    bool option_raster_vectors;
 };
 
 #endif
@@ -147,6 +147,8 @@ CORESTRING_LWC_VALUE(slash_, "/");
 CORESTRING_LWC_VALUE(max_age, "max-age");
 CORESTRING_LWC_VALUE(no_cache, "no-cache");
 CORESTRING_LWC_VALUE(no_store, "no-store");
+CORESTRING_LWC_VALUE(stale_while_revalidate, "stale-while-revalidate");
+CORESTRING_LWC_VALUE(stale_if_error, "stale-if-error");
 CORESTRING_LWC_VALUE(query_auth, "query/auth");
 CORESTRING_LWC_VALUE(query_ssl, "query/ssl");
 CORESTRING_LWC_VALUE(query_timeout, "query/timeout");
@@ -374,6 +376,7 @@ CORESTRING_DOM_STRING(__ns_key_file_name_node_data);
 CORESTRING_DOM_STRING(__ns_key_image_coords_node_data);
 CORESTRING_DOM_STRING(__ns_key_html_content_data);
 CORESTRING_DOM_STRING(__ns_key_canvas_node_data);
+CORESTRING_DOM_STRING(__ns_key_sibling_index_node_data);
 
 /* unusual DOM strings */
 CORESTRING_DOM_VALUE(text_javascript, "text/javascript");
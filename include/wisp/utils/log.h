@@ -21,6 +21,7 @@
 #define WISP_LOG_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <wisp/utils/errors.h>
@@ -40,6 +41,10 @@ typedef bool(nslog_ensure_t)(FILE *fptr);
  * Sets up everything required for logging. Processes the argv passed
  * to remove the -v switch for verbose logging. If necessary ensures
  * the output file handle is available.
+ *
+ * Verbose and split logs are written by a logging thread unless the
+ * -sync-logs switch is given, in which case each message is written
+ * before the call logging it returns.
  */
 extern nserror nslog_init(nslog_ensure_t *ensure, int *pargc, char **argv);
 
@@ -52,6 +57,13 @@ extern nserror nslog_init(nslog_ensure_t *ensure, int *pargc, char **argv);
  */
 extern void nslog_finalise(void);
 
+/**
+ * Get the number of messages dropped because the logging thread fell behind.
+ *
+ * Only messages less severe than warnings are ever dropped.
+ */
+extern uint64_t nslog_dropped(void);
+
 /**
  * Set the logging filter.
  *
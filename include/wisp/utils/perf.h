@@ -28,6 +28,10 @@
  *
  * Output format:
  *   PERF[  1234.567] Event description
+ *
+ * When structured tracing is enabled (-DWISP_ENABLE_TRACE=ON) each PERF()
+ * is also recorded as an instant trace event named by its format string,
+ * whether or not the messages are printed.
  */
 
 #ifndef WISP_UTILS_PERF_H
@@ -36,6 +40,8 @@
 #include <nsutils/time.h>
 #include <stdio.h>
 
+#include "utils/trace.h"
+
 #ifdef WISP_PERF_TRACE_ENABLED
 
 /**
@@ -51,12 +57,13 @@
         fprintf(stderr, "PERF[%6lu.%03lu] " fmt "\n", (unsigned long)(_perf_ms / 1000),                                \
             (unsigned long)(_perf_ms % 1000), ##__VA_ARGS__);                                                          \
         fflush(stderr);                                                                                                \
+        TRACE_INSTANT("perf", fmt);                                                                                    \
     } while (0)
 
 #else
 
-/** No-op when performance tracing is disabled */
-#define PERF(fmt, ...) ((void)0)
+/** Only traced, if at all, when performance tracing is disabled */
+#define PERF(fmt, ...) TRACE_INSTANT("perf", fmt)
 
 #endif /* NEOSURF_PERF_TRACE_ENABLED */
 
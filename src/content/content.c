@@ -117,10 +117,6 @@ static nserror content_llcache_callback(llcache_handle *llcache, const llcache_e
         }
         break;
     case LLCACHE_EVENT_DONE: {
-        size_t source_size;
-
-        (void)llcache_handle_get_source_data(llcache, &source_size);
-
         content_set_status(c, messages_get("Processing"));
         msg_data.explicit_status_text = NULL;
         content_broadcast(c, CONTENT_MSG_STATUS, &msg_data);
@@ -692,6 +688,19 @@ bool content_is_shareable(struct content *c)
 }
 
 
+/* exported interface documented in content/content_protected.h */
+bool content_is_retainable(struct content *c)
+{
+    if (c->status != CONTENT_STATUS_DONE)
+        return false;
+
+    if (c->handler->is_retainable != NULL)
+        return c->handler->is_retainable(c);
+
+    return (c->handler->type != NULL) && ((c->handler->type() & CONTENT_IMAGE) != 0);
+}
+
+
 /* exported interface documented in content/protected.h */
 void content_broadcast(struct content *c, content_msg msg, const union content_msg_data *data)
 {
@@ -1184,6 +1193,30 @@ const uint8_t *content__get_source_data(struct content *c, size_t *size)
 }
 
 
+/* exported interface documented in content/content_protected.h */
+size_t content__get_source_length(struct content *c)
+{
+    if (c == NULL)
+        return 0;
+
+    return llcache_handle_get_source_length(c->llcache);
+}
+
+
+/* exported interface documented in content/content_protected.h */
+const uint8_t *content__get_source_run(struct content *c, size_t offset, size_t *len)
+{
+    assert(len != NULL);
+
+    if (c == NULL) {
+        *len = 0;
+        return NULL;
+    }
+
+    return llcache_handle_get_source_run(c->llcache, offset, len);
+}
+
+
 /* exported interface documented in content/content.h */
 void content_invalidate_reuse_data(hlcache_handle *h)
 {
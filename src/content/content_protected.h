@@ -193,6 +193,17 @@ struct content_handler {
      * There must be one content per user for this type.
      */
     bool no_share;
+
+    /**
+     * Determine if an unused content may be kept for reuse.
+     *
+     * Only consulted for contents that are done. When absent only image
+     * contents are kept.
+     *
+     * \param c The content to check
+     * \return true if the content may be reused once unused
+     */
+    bool (*is_retainable)(const struct content *c);
 };
 
 /**
@@ -491,12 +502,36 @@ int content__get_available_width(struct content *c);
 /**
  * Retrieve source of content.
  *
+ * The source is made contiguous, copying it if necessary, so prefer
+ * content__get_source_run() where a contiguous source is not needed.
+ *
  * \param c    Content to retrieve source of.
  * \param size Pointer to location to receive byte size of source.
  * \return Pointer to source data.
  */
 const uint8_t *content__get_source_data(struct content *c, size_t *size);
 
+/**
+ * Retrieve byte length of the source of content.
+ *
+ * \param c  Content to retrieve source length of.
+ * \return Byte length of source data.
+ */
+size_t content__get_source_length(struct content *c);
+
+/**
+ * Retrieve a contiguous run of the source of content without copying it.
+ *
+ * Iterate over the source by advancing \a offset by \a len until NULL is
+ * returned.
+ *
+ * \param c       Content to retrieve source of.
+ * \param offset  Offset of the first byte wanted.
+ * \param len     Pointer to location to receive byte length of run.
+ * \return Pointer to source data at \a offset, or NULL if there is none.
+ */
+const uint8_t *content__get_source_run(struct content *c, size_t offset, size_t *len);
+
 /**
  * Invalidate content reuse data.
  *
@@ -610,6 +645,14 @@ bool content_matches_quirks(struct content *c, bool quirks);
  */
 bool content_is_shareable(struct content *c);
 
+/**
+ * Determine if an unused content may be kept for history navigation
+ *
+ * \param c  Content to consider
+ * \return True if content may be retained, false otherwise
+ */
+bool content_is_retainable(struct content *c);
+
 /**
  * Retrieve the low-level cache handle for a content
  *
@@ -32,6 +32,7 @@
  */
 
 #include <libwapcaplet/libwapcaplet.h>
+#include <nsutils/time.h>
 #include <assert.h>
 #include <errno.h>
 #include <stdbool.h>
@@ -48,6 +49,8 @@
 #include <wisp/utils/messages.h>
 #include <wisp/utils/nsoption.h>
 #include <wisp/utils/nsurl.h>
+#include "utils/phase.h"
+#include "utils/trace.h"
 #include "utils/ring.h"
 
 #include <wisp/content/fetch.h>
@@ -73,6 +76,9 @@
 /** The fdset timeout in ms */
 #define FDSET_TIMEOUT 1000
 
+/** How long fetchers keep being polled after a DNS prefetch, in ms */
+#define DNS_PREFETCH_POLL_TIME 5000
+
 /**
  * Information about a fetcher for a given scheme.
  */
@@ -105,6 +111,9 @@ struct fetch {
 static struct fetch *fetch_ring = NULL; /**< Ring of active fetches. */
 static struct fetch *queue_ring = NULL; /**< Ring of queued fetches */
 
+/** Time until which fetchers are polled for DNS prefetches, in ms */
+static uint64_t dns_prefetch_poll_until = 0;
+
 /******************************************************************************
  * fetch internals							      *
  ******************************************************************************/
@@ -225,22 +234,52 @@ static bool fetch_dispatch_jobs(void)
 
     NSLOG(fetch, DEBUG, "Fetch ring is now %d elements.", all_active);
     NSLOG(fetch, DEBUG, "Queue ring is now %d elements.", all_queued);
+    TRACE_COUNTER("fetch", "active fetches", all_active);
+    TRACE_COUNTER("fetch", "queued fetches", all_queued);
 
     return (all_active > 0);
 }
 
+/**
+ * Determine whether fetchers need polling for recent DNS prefetches.
+ *
+ * DNS prefetches are not fetches so they do not keep the fetchers polled;
+ * instead polling continues for a while after each one.
+ */
+static bool fetch_dns_prefetch_pending(void)
+{
+    uint64_t now;
+
+    if (dns_prefetch_poll_until == 0) {
+        return false;
+    }
+
+    nsu_getmonotonic_ms(&now);
+    if (now >= dns_prefetch_poll_until) {
+        dns_prefetch_poll_until = 0;
+        return false;
+    }
+
+    return true;
+}
+
 static void fetcher_poll(void *unused)
 {
     int fetcherd;
 
-    if (fetch_dispatch_jobs()) {
+    if (fetch_dispatch_jobs() || fetch_dns_prefetch_pending()) {
+        enum phase previous = phase_enter(PHASE_FETCH);
+
         NSLOG(fetch, DEBUG, "Polling fetchers");
+        TRACE_BEGIN("fetch", "poll");
         for (fetcherd = 0; fetcherd < MAX_FETCHERS; fetcherd++) {
             if (fetchers[fetcherd].refcount > 0) {
                 /* fetcher present */
                 fetchers[fetcherd].ops.poll(fetchers[fetcherd].scheme);
             }
         }
+        TRACE_END("fetch", "poll");
+        phase_leave(previous);
 
         /* schedule active fetchers to run again in 10ms */
         guit->misc->schedule(SCHEDULE_TIME, fetcher_poll, NULL);
@@ -352,8 +391,9 @@ nserror fetch_fdset(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *except_fd
 {
     int maxfd = -1;
     int fetcherd; /* fetcher index */
+    enum phase previous;
 
-    if (!fetch_dispatch_jobs()) {
+    if (!fetch_dispatch_jobs() && !fetch_dns_prefetch_pending()) {
         NSLOG(fetch, DEBUG, "No jobs");
         *maxfd_out = -1;
         return NSERROR_OK;
@@ -361,12 +401,16 @@ nserror fetch_fdset(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *except_fd
 
     NSLOG(fetch, DEBUG, "Polling fetchers");
 
+    previous = phase_enter(PHASE_FETCH);
+    TRACE_BEGIN("fetch", "poll");
     for (fetcherd = 0; fetcherd < MAX_FETCHERS; fetcherd++) {
         if (fetchers[fetcherd].refcount > 0) {
             /* fetcher present */
             fetchers[fetcherd].ops.poll(fetchers[fetcherd].scheme);
         }
     }
+    TRACE_END("fetch", "poll");
+    phase_leave(previous);
 
     FD_ZERO(read_fd_set);
     FD_ZERO(write_fd_set);
@@ -468,6 +512,9 @@ nserror fetch_start(nsurl *url, nsurl *referer, fetch_callback callback, void *p
     /* Rah, got it, so ref the fetcher. */
     fetch_ref_fetcher(fetch->fetcherd);
 
+    TRACE_ASYNC_BEGIN("fetch", "fetch", TRACE_ID(fetch));
+    TRACE_FLOW_BEGIN("fetch", "fetch", TRACE_ID(fetch));
+
     /* Dump new fetch in the queue. */
     RING_INSERT(queue_ring, fetch);
 
@@ -507,6 +554,8 @@ void fetch_free(struct fetch *f)
     }
 
     NSLOG(fetch, DEBUG, "Freeing fetch %p, fetcher %p", f, f->fetcher_handle);
+    TRACE_FLOW_END("fetch", "fetch", TRACE_ID(f));
+    TRACE_ASYNC_END("fetch", "fetch", TRACE_ID(f));
 
     fetchers[f->fetcherd].ops.free(f->fetcher_handle);
 
@@ -539,6 +588,32 @@ bool fetch_can_fetch(const nsurl *url)
     return fetchers[fetcherd].ops.acceptable(url);
 }
 
+/* exported interface documented in content/fetch.h */
+void fetch_prefetch_dns(const nsurl *url)
+{
+    lwc_string *scheme = nsurl_get_component(url, NSURL_SCHEME);
+    int fetcherd;
+
+    if (scheme == NULL) {
+        return;
+    }
+
+    fetcherd = get_fetcher_for_scheme(scheme);
+    lwc_string_unref(scheme);
+
+    if ((fetcherd == -1) || (fetchers[fetcherd].ops.prefetch_dns == NULL) ||
+        !fetchers[fetcherd].ops.acceptable(url)) {
+        return;
+    }
+
+    if (fetchers[fetcherd].ops.prefetch_dns(url)) {
+        NSLOG(fetch, DEBUG, "scheduling poll for DNS prefetch of '%s'", nsurl_access(url));
+        nsu_getmonotonic_ms(&dns_prefetch_poll_until);
+        dns_prefetch_poll_until += DNS_PREFETCH_POLL_TIME;
+        guit->misc->schedule(SCHEDULE_TIME, fetcher_poll, NULL);
+    }
+}
+
 /* exported interface documented in content/fetch.h */
 void fetch_change_callback(struct fetch *fetch, fetch_callback callback, void *p)
 {
@@ -690,7 +765,11 @@ void fetch_send_callback(const fetch_msg *msg, struct fetch *fetch)
     /* Bump the last_msg to the greatest seen msg */
     if (msg->type > fetch->last_msg)
         fetch->last_msg = msg->type;
+
+    TRACE_BEGIN_ARG("fetch", "callback", "type", msg->type);
+    TRACE_FLOW_STEP("fetch", "fetch", TRACE_ID(fetch));
     fetch->callback(msg, fetch->p);
+    TRACE_END("fetch", "callback");
 }
 
 
@@ -715,6 +794,8 @@ void fetch_remove_from_queues(struct fetch *fetch)
 
     NSLOG(fetch, DEBUG, "Fetch ring is now %d elements.", all_active);
     NSLOG(fetch, DEBUG, "Queue ring is now %d elements.", all_queued);
+    TRACE_COUNTER("fetch", "active fetches", all_active);
+    TRACE_COUNTER("fetch", "queued fetches", all_queued);
 }
 
 
@@ -98,6 +98,16 @@ struct fetcher_operation_table {
      * Finalise the fetcher.
      */
     void (*finalise)(lwc_string *scheme);
+
+    /**
+     * Resolve the host name of a url ahead of any fetch from it.
+     *
+     * Optional; fetchers which have no use for it leave it NULL.
+     *
+     * \param url the URL whose origin will be fetched from
+     * \return true if work was started which needs polling else false.
+     */
+    bool (*prefetch_dns)(const struct nsurl *url);
 };
 
 
@@ -54,11 +54,14 @@
 #include <wisp/utils/utils.h>
 #include "utils/hashmap.h"
 #include "utils/ring.h"
+#include "utils/trace.h"
 #include "utils/useragent.h"
 
 #include "content/fetch.h"
 #include "content/fetchers.h"
 #include "content/fetchers/curl.h"
+#include "content/fetchers/curl_dns_prefetch.h"
+#include "content/fetchers/curl_persist.h"
 #include "content/urldb.h"
 
 /**
@@ -66,6 +69,16 @@
  */
 #define UPDATES_PER_SECOND 2
 
+/** Name lookups quicker than this were answered from the DNS cache / us */
+#define DNS_PREFETCH_CACHED_LOOKUP 1000
+
+/**
+ * How long a host address is kept across restarts / seconds.
+ *
+ * cURL does not report the DNS TTL so this is a conservative guess.
+ */
+#define PERSIST_HOST_LIFETIME (30 * 60)
+
 /* Performance tracing - enable via CMake: -DNEOSURF_ENABLE_PERF_TRACE=ON */
 #include <wisp/utils/perf.h>
 
@@ -249,9 +262,12 @@ struct curl_fetch_info {
     bool stopped; /**< Download stopped on purpose. */
     bool only_2xx; /**< Only HTTP 2xx responses acceptable. */
     bool downgrade_tls; /**< Downgrade to TLS 1.2 */
+    bool proxied; /**< Fetched through a proxy */
+    bool persisted_addr; /**< Connected to a host address kept across restarts */
     nsurl *url; /**< URL of this fetch. */
     lwc_string *host; /**< The hostname of this fetch. */
     struct curl_slist *headers; /**< List of request headers. */
+    struct curl_slist *resolve; /**< Host address kept across restarts, or NULL. */
     char *location; /**< Response Location header, or 0. */
     unsigned long content_length; /**< Response Content-Length, or 0. */
     char *cookie_string; /**< Cookie string for this fetch */
@@ -284,6 +300,22 @@ CURLM *fetch_curl_multi;
 /** Curl handle with default options set; not used for transfers. */
 static CURL *fetch_blank_curl;
 
+/** Share handle for DNS, TLS sessions and connections across all fetches. */
+static CURLSH *fetch_curl_share;
+
+/** Host addresses and TLS sessions kept across restarts, or NULL. */
+static struct curl_persist *fetch_curl_persist;
+
+/** Origins recently resolved ahead of fetches */
+static struct curl_dns_prefetch curl_dns_prefetches[CURL_DNS_PREFETCH_SLOTS];
+
+/** Counts of lookups ahead of fetches and the fetches which followed them */
+static struct {
+    unsigned int resolves; /**< Lookups started */
+    unsigned int fetches; /**< Fetches following a lookup */
+    unsigned int cached; /**< ... which found the host in the DNS cache */
+} curl_dns_prefetch_stats;
+
 /** Ring of cached handles */
 static struct cache_handle *curl_handle_ring = 0;
 
@@ -300,6 +332,123 @@ static char fetch_proxy_userpwd[100];
 static bool inside_curl = false;
 
 
+#if LIBCURL_VERSION_NUM >= 0x080c00
+/**
+ * Give a TLS session kept across restarts to the share handle.
+ */
+static void
+fetch_curl_import_session(const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len, void *pw)
+{
+    CURLcode code;
+
+    code = curl_easy_ssls_import(fetch_blank_curl, NULL, key, key_len, data, data_len);
+    if (code != CURLE_OK) {
+        NSLOG(wisp, DEBUG, "Unable to import TLS session: %s", curl_easy_strerror(code));
+    }
+}
+
+/**
+ * Keep a TLS session from the share handle across restarts.
+ *
+ * Only sessions identified by a salted hash of the peer are kept, so the
+ * state file does not list the hosts visited.
+ */
+static CURLcode fetch_curl_export_session(CURL *handle, void *userptr, const char *session_key,
+    const unsigned char *shmac, size_t shmac_len, const unsigned char *sdata, size_t sdata_len,
+    curl_off_t valid_until, int ietf_tls_id, const char *alpn, size_t earlydata_max)
+{
+    if (shmac != NULL && shmac_len > 0) {
+        curl_persist_add_session(fetch_curl_persist, shmac, shmac_len, sdata, sdata_len, (time_t)valid_until);
+    }
+    return CURLE_OK;
+}
+#endif
+
+
+/**
+ * Load the network state kept across restarts.
+ */
+static void fetch_curl_persist_load(void)
+{
+    const char *path = nsoption_charp(network_state_file);
+    nserror res;
+
+    if (path == NULL || path[0] == '\0') {
+        return;
+    }
+
+    res = curl_persist_create(&fetch_curl_persist);
+    if (res != NSERROR_OK) {
+        return;
+    }
+
+    res = curl_persist_load(fetch_curl_persist, path, time(NULL));
+    if (res != NSERROR_OK) {
+        NSLOG(wisp, INFO, "No network state loaded from '%s' (%s)", path, messages_get_errorcode(res));
+        return;
+    }
+    NSLOG(wisp, INFO, "Loaded network state from '%s'", path);
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    /* sessions now live in the share handle until exported on exit */
+    curl_persist_each_session(fetch_curl_persist, time(NULL), fetch_curl_import_session, NULL);
+    curl_persist_clear_sessions(fetch_curl_persist);
+#endif
+}
+
+
+/**
+ * Save the network state to keep across restarts, and discard it.
+ */
+static void fetch_curl_persist_save(void)
+{
+    const char *path = nsoption_charp(network_state_file);
+    nserror res;
+
+    if (fetch_curl_persist == NULL) {
+        return;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    if (curl_easy_ssls_export(fetch_blank_curl, fetch_curl_export_session, NULL) != CURLE_OK) {
+        NSLOG(wisp, INFO, "Unable to export TLS sessions");
+    }
+#endif
+
+    if (path != NULL && path[0] != '\0') {
+        res = curl_persist_save(fetch_curl_persist, path, time(NULL));
+        if (res != NSERROR_OK) {
+            NSLOG(wisp, WARNING, "Unable to save network state to '%s'", path);
+        }
+    }
+
+    curl_persist_destroy(fetch_curl_persist);
+    fetch_curl_persist = NULL;
+}
+
+
+/**
+ * Discard every lookup ahead of a fetch.
+ */
+static void fetch_curl_dns_prefetch_finalise(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        CURL *handle = curl_dns_prefetches[i].handle;
+
+        if (handle != NULL) {
+            curl_multi_remove_handle(fetch_curl_multi, handle);
+            curl_easy_cleanup(handle);
+        }
+    }
+    curl_dns_prefetch_clear(curl_dns_prefetches);
+
+    NSLOG(wisp, INFO, "DNS prefetch: %u resolves; %u fetches followed, %u found a cached address",
+        curl_dns_prefetch_stats.resolves, curl_dns_prefetch_stats.fetches, curl_dns_prefetch_stats.cached);
+}
+
+
 /**
  * Initialise a cURL fetcher.
  */
@@ -322,32 +471,42 @@ static void fetch_curl_finalise(lwc_string *scheme)
 
     curl_fetchers_registered--;
     NSLOG(wisp, INFO, "Finalise cURL fetcher %s", lwc_string_data(scheme));
+
+    /* Free anything remaining in the cached curl handle ring */
+    while (curl_handle_ring != NULL) {
+        h = curl_handle_ring;
+        RING_REMOVE(curl_handle_ring, h);
+        lwc_string_unref(h->host);
+        curl_easy_cleanup(h->handle);
+        free(h);
+    }
+
     if (curl_fetchers_registered == 0) {
         CURLMcode codem;
         /* All the fetchers have been finalised. */
         NSLOG(wisp, INFO, "All cURL fetchers finalised, closing down cURL");
 
+        fetch_curl_persist_save();
+
+        fetch_curl_dns_prefetch_finalise();
+
         curl_easy_cleanup(fetch_blank_curl);
 
         codem = curl_multi_cleanup(fetch_curl_multi);
         if (codem != CURLM_OK)
             NSLOG(wisp, INFO, "curl_multi_cleanup failed: ignoring");
 
+        /* only released once no easy handle refers to it */
+        if (curl_share_cleanup(fetch_curl_share) != CURLSHE_OK)
+            NSLOG(wisp, INFO, "curl_share_cleanup failed: ignoring");
+        fetch_curl_share = NULL;
+
         curl_global_cleanup();
 
         NSLOG(wisp, DEBUG, "Cleaning up SSL cert chain hashmap");
         hashmap_destroy(curl_fetch_ssl_hashmap);
         curl_fetch_ssl_hashmap = NULL;
     }
-
-    /* Free anything remaining in the cached curl handle ring */
-    while (curl_handle_ring != NULL) {
-        h = curl_handle_ring;
-        RING_REMOVE(curl_handle_ring, h);
-        lwc_string_unref(h->host);
-        curl_easy_cleanup(h->handle);
-        free(h);
-    }
 }
 
 
@@ -440,7 +599,10 @@ static struct curl_fetch_info *fetch_alloc(void)
     fetch->stopped = false;
     fetch->only_2xx = false;
     fetch->downgrade_tls = false;
+    fetch->proxied = false;
+    fetch->persisted_addr = false;
     fetch->headers = NULL;
+    fetch->resolve = NULL;
     fetch->url = NULL;
     fetch->host = NULL;
     fetch->location = NULL;
@@ -493,7 +655,7 @@ static void *fetch_curl_setup(struct fetch *parent_fetch, nsurl *url, bool only_
         return NULL;
 
     NSLOG(wisp, INFO, "fetch %p, url '%s'", fetch, nsurl_access(url));
-    NSLOG(wisp, DEBUG, "PROFILER: START Fetch queue %p", fetch);
+    TRACE_ASYNC_BEGIN("curl", "queued", TRACE_ID(fetch));
 
     fetch->only_2xx = only_2xx;
     fetch->downgrade_tls = downgrade_tls;
@@ -1140,6 +1302,302 @@ static CURLcode fetch_curl_set_postdata(struct curl_fetch_info *f)
     return code;
 }
 
+/**
+ * Determine the port a URL is fetched from, without a proxy.
+ */
+static long fetch_curl_port(const nsurl *url)
+{
+    lwc_string *port;
+    long ret;
+
+    port = nsurl_get_component(url, NSURL_PORT);
+    if (port == NULL) {
+        return (nsurl_get_scheme_type(url) == NSURL_SCHEME_HTTPS) ? 443 : 80;
+    }
+
+    ret = strtol(lwc_string_data(port), NULL, 10);
+    lwc_string_unref(port);
+
+    return ret;
+}
+
+
+/**
+ * Offer cURL the address a fetch's host resolved to before a restart.
+ *
+ * Each address is offered once; cURL's shared DNS cache holds it after
+ * that, and expires it as it would any lookup.
+ */
+static void fetch_curl_set_persisted_resolve(struct curl_fetch_info *f)
+{
+#if LIBCURL_VERSION_NUM >= 0x074b00
+    /* 7.75.0 allows the "+" prefix, letting the entry time out */
+    const char *host = lwc_string_data(f->host);
+    long port = fetch_curl_port(f->url);
+    const char *addr;
+    char entry[384];
+
+    if (fetch_curl_persist == NULL || f->proxied || host[0] == '[') {
+        return;
+    }
+
+    addr = curl_persist_claim_host(fetch_curl_persist, host, port, time(NULL));
+    if (addr == NULL) {
+        return;
+    }
+
+    if (strchr(addr, ':') != NULL) {
+        snprintf(entry, sizeof entry, "+%s:%ld:[%s]", host, port, addr);
+    } else {
+        snprintf(entry, sizeof entry, "+%s:%ld:%s", host, port, addr);
+    }
+
+    f->resolve = curl_slist_append(NULL, entry);
+    f->persisted_addr = (f->resolve != NULL);
+#endif
+}
+
+
+/**
+ * Keep the address a completed fetch connected to across restarts.
+ */
+static void fetch_curl_keep_address(struct curl_fetch_info *f, CURLcode result)
+{
+    const char *host = lwc_string_data(f->host);
+    char *addr = NULL;
+    long port = 0;
+
+    if (fetch_curl_persist == NULL || f->proxied) {
+        return;
+    }
+
+    if (result == CURLE_COULDNT_CONNECT && f->persisted_addr) {
+        /* the host has moved since it was kept */
+        curl_persist_remove_host(fetch_curl_persist, host, fetch_curl_port(f->url));
+        return;
+    }
+
+    if (result != CURLE_OK || curl_easy_getinfo(f->curl_handle, CURLINFO_PRIMARY_IP, &addr) != CURLE_OK ||
+        curl_easy_getinfo(f->curl_handle, CURLINFO_PRIMARY_PORT, &port) != CURLE_OK || addr == NULL ||
+        port <= 0 || strcmp(addr, host) == 0) {
+        return;
+    }
+
+    curl_persist_add_host(fetch_curl_persist, host, port, addr, time(NULL) + PERSIST_HOST_LIFETIME);
+}
+
+
+/**
+ * Build the origin of a URL, as fetched by cURL.
+ *
+ * \return the origin, to be freed by the caller, or NULL
+ */
+static char *fetch_curl_origin(const nsurl *url)
+{
+    lwc_string *scheme = nsurl_get_component(url, NSURL_SCHEME);
+    lwc_string *host = nsurl_get_component(url, NSURL_HOST);
+    long port = fetch_curl_port(url);
+    char *origin = NULL;
+    int len;
+
+    if (scheme != NULL && host != NULL) {
+        len = snprintf(NULL, 0, "%s://%s:%ld/", lwc_string_data(scheme), lwc_string_data(host), port);
+        origin = malloc(len + 1);
+        if (origin != NULL) {
+            snprintf(origin, len + 1, "%s://%s:%ld/", lwc_string_data(scheme), lwc_string_data(host), port);
+        }
+    }
+
+    if (scheme != NULL)
+        lwc_string_unref(scheme);
+    if (host != NULL)
+        lwc_string_unref(host);
+
+    return origin;
+}
+
+
+/**
+ * Socket opener for lookups ahead of fetches.
+ *
+ * The host name has been resolved into the shared DNS cache by the time
+ * this is called, which is all that was wanted.
+ */
+static curl_socket_t fetch_curl_dns_prefetch_socket(void *clientp, curlsocktype purpose, struct curl_sockaddr *address)
+{
+    return CURL_SOCKET_BAD;
+}
+
+
+/**
+ * Start a queued lookup.
+ *
+ * The transfer is connect-only and refuses its socket, so nothing is sent;
+ * it ends once the host is resolved. Connecting ahead of a fetch would not
+ * help, as cURL never hands a connect-only connection to another transfer.
+ */
+static void fetch_curl_dns_prefetch_start(struct curl_dns_prefetch *p)
+{
+    CURLMcode codem;
+    CURL *handle;
+
+    p->state = CURL_DNS_PREFETCH_DONE;
+
+    handle = curl_easy_duphandle(fetch_blank_curl);
+    if (handle == NULL) {
+        return;
+    }
+
+    if (curl_easy_setopt(handle, CURLOPT_URL, p->origin) != CURLE_OK ||
+        curl_easy_setopt(handle, CURLOPT_CONNECT_ONLY, 1L) != CURLE_OK ||
+        curl_easy_setopt(handle, CURLOPT_SHARE, fetch_curl_share) != CURLE_OK ||
+        curl_easy_setopt(handle, CURLOPT_OPENSOCKETFUNCTION, fetch_curl_dns_prefetch_socket) != CURLE_OK) {
+        curl_easy_cleanup(handle);
+        return;
+    }
+
+    codem = curl_multi_add_handle(fetch_curl_multi, handle);
+    if (codem != CURLM_OK) {
+        curl_easy_cleanup(handle);
+        return;
+    }
+
+    NSLOG(wisp, DEBUG, "Resolving %s", p->origin);
+    curl_dns_prefetch_stats.resolves++;
+    p->handle = handle;
+    p->state = CURL_DNS_PREFETCH_ACTIVE;
+}
+
+
+/**
+ * Start any lookups queued while inside cURL.
+ */
+static void fetch_curl_dns_prefetch_start_queued(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        if (curl_dns_prefetches[i].origin != NULL && curl_dns_prefetches[i].state == CURL_DNS_PREFETCH_QUEUED) {
+            fetch_curl_dns_prefetch_start(&curl_dns_prefetches[i]);
+        }
+    }
+}
+
+
+/**
+ * Finish a lookup transfer.
+ *
+ * \param handle The cURL handle of a finished transfer.
+ * \param result The result of the transfer.
+ * \return true if the transfer was a lookup ahead of a fetch, else false.
+ */
+static bool fetch_curl_dns_prefetch_done(CURL *handle, CURLcode result)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        struct curl_dns_prefetch *p = &curl_dns_prefetches[i];
+
+        if (p->origin != NULL && p->state == CURL_DNS_PREFETCH_ACTIVE && p->handle == handle) {
+            /* the refused socket always fails the transfer */
+            NSLOG(wisp, DEBUG, "Resolved %s: %s", p->origin, curl_easy_strerror(result));
+
+            curl_multi_remove_handle(fetch_curl_multi, handle);
+            curl_easy_cleanup(handle);
+            p->handle = NULL;
+            p->state = CURL_DNS_PREFETCH_DONE;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * Resolve the host name of a URL ahead of fetches from it.
+ *
+ * \param url The URL whose origin will be fetched from.
+ * \return true if a lookup was queued else false.
+ */
+static bool fetch_curl_prefetch_dns(const nsurl *url)
+{
+    struct curl_dns_prefetch *p;
+    uint64_t now;
+    char *origin;
+
+    if (nsoption_bool(http_proxy) && nsoption_charp(http_proxy_host) != NULL) {
+        /* the proxy resolves host names */
+        return false;
+    }
+
+    origin = fetch_curl_origin(url);
+    if (origin == NULL) {
+        return false;
+    }
+
+    nsu_getmonotonic_ms(&now);
+    p = curl_dns_prefetch_queue(curl_dns_prefetches, origin, now);
+    free(origin);
+    if (p == NULL) {
+        return false;
+    }
+
+    if (!inside_curl) {
+        fetch_curl_dns_prefetch_start(p);
+    }
+
+    return true;
+}
+
+
+/**
+ * Record whether a fetch following a lookup of its host found the address
+ * in the DNS cache.
+ */
+static void fetch_curl_dns_prefetch_credit(struct curl_fetch_info *f, CURLcode result)
+{
+    char *origin;
+    uint64_t now;
+    bool cached = false;
+
+    if (result != CURLE_OK) {
+        return;
+    }
+
+    origin = fetch_curl_origin(f->url);
+    if (origin == NULL) {
+        return;
+    }
+
+    nsu_getmonotonic_ms(&now);
+    if (curl_dns_prefetch_credit(curl_dns_prefetches, origin, now) == NULL) {
+        free(origin);
+        return;
+    }
+    free(origin);
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+    /* 7.61.0 reports times in microseconds */
+    {
+        curl_off_t lookup;
+
+        if (curl_easy_getinfo(f->curl_handle, CURLINFO_NAMELOOKUP_TIME_T, &lookup) == CURLE_OK) {
+            cached = (lookup < DNS_PREFETCH_CACHED_LOOKUP);
+        }
+    }
+#endif
+
+    curl_dns_prefetch_stats.fetches++;
+    if (cached) {
+        curl_dns_prefetch_stats.cached++;
+    }
+
+    NSLOG(wisp, INFO, "Fetch %s after DNS prefetch: %s", nsurl_access(f->url),
+        cached ? "cached address" : "looked up again");
+}
+
+
 /**
  * Set options specific for a fetch.
  *
@@ -1205,16 +1663,26 @@ static CURLcode fetch_curl_set_options(struct curl_fetch_info *f)
                 nsoption_charp(http_proxy_auth_pass));
             SETOPT(CURLOPT_PROXYUSERPWD, fetch_proxy_userpwd);
         }
+        f->proxied = true;
     } else {
         SETOPT(CURLOPT_PROXY, NULL);
     }
 
+    SETOPT(CURLOPT_SHARE, fetch_curl_share);
+
+    curl_slist_free_all(f->resolve);
+    f->resolve = NULL;
+    f->persisted_addr = false;
+    fetch_curl_set_persisted_resolve(f);
+    SETOPT(CURLOPT_RESOLVE, f->resolve);
 
     if (curl_with_openssl) {
         SETOPT(CURLOPT_SSL_CIPHER_LIST, f->downgrade_tls ? CIPHER_LIST_LEGACY : CIPHER_LIST);
     }
 
-    /* Force-enable SSL session ID caching, as some distros are odd. */
+    /* Force-enable SSL session ID caching, as some distros are odd.
+     * The cache itself is held by the share handle.
+     */
     SETOPT(CURLOPT_SSL_SESSIONID_CACHE, 1L);
 
     if (urldb_get_cert_permissions(f->url)) {
@@ -1303,8 +1771,8 @@ static bool fetch_curl_start(void *vfetch)
         return false;
     }
     PERF("CURL START '%s'", nsurl_access(fetch->url));
-    NSLOG(wisp, DEBUG, "PROFILER: STOP Fetch queue %p", fetch);
-    NSLOG(wisp, DEBUG, "PROFILER: START Fetch latency %p", fetch);
+    TRACE_ASYNC_END("curl", "queued", TRACE_ID(fetch));
+    TRACE_ASYNC_BEGIN("curl", "waiting for response", TRACE_ID(fetch));
     return fetch_curl_initiate_fetch(fetch, fetch_curl_get_handle(fetch->host));
 }
 
@@ -1400,10 +1868,16 @@ static void fetch_curl_abort(void *vf)
             f->abort = true;
         } else {
             NSLOG(wisp, DEBUG, "Immediate abort");
+            if (f->profiled_response_started) {
+                TRACE_ASYNC_END("curl", "downloading", TRACE_ID(f));
+            } else {
+                TRACE_ASYNC_END("curl", "waiting for response", TRACE_ID(f));
+            }
             fetch_curl_stop(f);
             fetch_free(f->fetch_handle);
         }
     } else {
+        TRACE_ASYNC_END("curl", "queued", TRACE_ID(f));
         fetch_remove_from_queues(f->fetch_handle);
         fetch_free(f->fetch_handle);
     }
@@ -1429,6 +1903,7 @@ static void fetch_curl_free(void *vf)
     if (f->headers) {
         curl_slist_free_all(f->headers);
     }
+    curl_slist_free_all(f->resolve);
     fetch_curl_free_postdata(f->postdata);
     NSCURL_POSTDATA_FREE(f->curl_postdata);
 
@@ -1529,9 +2004,9 @@ static void fetch_curl_done(CURL *curl_handle, CURLcode result)
     NSLOG(wisp, INFO, "done %s", nsurl_access(f->url));
 
     if (f->profiled_response_started) {
-        NSLOG(wisp, DEBUG, "PROFILER: STOP Fetch download %p", f);
+        TRACE_ASYNC_END("curl", "downloading", TRACE_ID(f));
     } else {
-        NSLOG(wisp, DEBUG, "PROFILER: STOP Fetch latency %p", f);
+        TRACE_ASYNC_END("curl", "waiting for response", TRACE_ID(f));
     }
 
     if ((abort_fetch == false) && (result == CURLE_OK || ((result == CURLE_WRITE_ERROR) && (f->stopped == false)))) {
@@ -1575,6 +2050,9 @@ static void fetch_curl_done(CURL *curl_handle, CURLcode result)
         error = true;
     }
 
+    fetch_curl_keep_address(f, result);
+    fetch_curl_dns_prefetch_credit(f, result);
+
     fetch_curl_stop(f);
 
     if (f->sent_ssl_chain == false) {
@@ -1676,7 +2154,9 @@ static void fetch_curl_poll(lwc_string *scheme_ignored)
     while (curl_msg) {
         switch (curl_msg->msg) {
         case CURLMSG_DONE:
-            fetch_curl_done(curl_msg->easy_handle, curl_msg->data.result);
+            if (!fetch_curl_dns_prefetch_done(curl_msg->easy_handle, curl_msg->data.result)) {
+                fetch_curl_done(curl_msg->easy_handle, curl_msg->data.result);
+            }
             break;
         default:
             break;
@@ -1684,6 +2164,8 @@ static void fetch_curl_poll(lwc_string *scheme_ignored)
         curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
     }
     inside_curl = false;
+
+    fetch_curl_dns_prefetch_start_queued();
 }
 
 
@@ -1824,8 +2306,8 @@ static size_t fetch_curl_header(char *data, size_t size, size_t nmemb, void *_f)
     }
 
     if (f->profiled_response_started == false) {
-        NSLOG(wisp, DEBUG, "PROFILER: STOP Fetch latency %p", f);
-        NSLOG(wisp, DEBUG, "PROFILER: START Fetch download %p", f);
+        TRACE_ASYNC_END("curl", "waiting for response", TRACE_ID(f));
+        TRACE_ASYNC_BEGIN("curl", "downloading", TRACE_ID(f));
         f->profiled_response_started = true;
     }
 
@@ -1923,7 +2405,8 @@ nserror fetch_curl_register(void)
         .free = fetch_curl_free,
         .poll = fetch_curl_poll,
         .fdset = fetch_curl_fdset,
-        .finalise = fetch_curl_finalise};
+        .finalise = fetch_curl_finalise,
+        .prefetch_dns = fetch_curl_prefetch_dns};
 
 #if LIBCURL_VERSION_NUM >= 0x073800
     /* version 7.56.0 can select which SSL backend to use */
@@ -1974,6 +2457,32 @@ nserror fetch_curl_register(void)
     }
 #endif
 
+    /* Share DNS lookups, TLS sessions and connections between fetches */
+    fetch_curl_share = curl_share_init();
+    if (!fetch_curl_share) {
+        NSLOG(wisp, INFO, "curl_share_init failed.");
+        return NSERROR_INIT_FAILED;
+    }
+
+    {
+        CURLSHcode shcode;
+
+#undef SETOPT
+#define SETOPT(option, value)                                                                                          \
+    shcode = curl_share_setopt(fetch_curl_share, option, value);                                                       \
+    if (shcode != CURLSHE_OK) {                                                                                        \
+        NSLOG(wisp, ERROR, "attempting curl_share_setopt(%s, ...)", #value);                                        \
+        goto curl_share_setopt_failed;                                                                                 \
+    }
+
+        SETOPT(CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        SETOPT(CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        /* 7.57.0 can share the connection pool */
+        SETOPT(CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+
     /* Create a curl easy handle with the options that are common to all
      *  fetches.
      */
@@ -2013,6 +2522,7 @@ nserror fetch_curl_register(void)
     SETOPT(CURLOPT_CONNECTTIMEOUT, (long)nsoption_uint(curl_fetch_timeout));
     SETOPT(CURLOPT_OPENSOCKETFUNCTION, fetch_curl_socket_open);
     SETOPT(CURLOPT_CLOSESOCKETFUNCTION, fetch_curl_socket_close);
+    SETOPT(CURLOPT_SHARE, fetch_curl_share);
 
     if (nsoption_charp(ca_bundle) && strcmp(nsoption_charp(ca_bundle), "")) {
         NSLOG(wisp, INFO, "ca_bundle: '%s'", nsoption_charp(ca_bundle));
@@ -2052,6 +2562,8 @@ nserror fetch_curl_register(void)
 
     NSLOG(wisp, INFO, "cURL %slinked against openssl", curl_with_openssl ? "" : "not ");
 
+    fetch_curl_persist_load();
+
     /* cURL initialised okay, register the fetchers */
 
     data = curl_version_info(CURLVERSION_NOW);
@@ -2085,6 +2597,10 @@ curl_easy_setopt_failed:
     NSLOG(wisp, INFO, "curl_easy_setopt failed.");
     return NSERROR_INIT_FAILED;
 
+curl_share_setopt_failed:
+    NSLOG(wisp, INFO, "curl_share_setopt failed.");
+    return NSERROR_INIT_FAILED;
+
 #if LIBCURL_VERSION_NUM >= 0x071e00
 curl_multi_setopt_failed:
     NSLOG(wisp, INFO, "curl_multi_setopt failed.");
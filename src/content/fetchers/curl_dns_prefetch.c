@@ -0,0 +1,117 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Origins whose host names the cURL fetcher resolves ahead of fetches
+ * (implementation).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "content/fetchers/curl_dns_prefetch.h"
+
+
+/* exported interface documented in content/fetchers/curl_dns_prefetch.h */
+struct curl_dns_prefetch *curl_dns_prefetch_queue(struct curl_dns_prefetch *table, const char *origin, uint64_t now)
+{
+    struct curl_dns_prefetch *slot = NULL;
+    unsigned int active = 0;
+    unsigned int i;
+    char *copy;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        if (table[i].origin != NULL && table[i].state != CURL_DNS_PREFETCH_DONE) {
+            active++;
+        }
+    }
+    if (active >= CURL_DNS_PREFETCH_MAX_ACTIVE) {
+        return NULL;
+    }
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        struct curl_dns_prefetch *p = &table[i];
+
+        if (p->origin == NULL) {
+            if (slot == NULL || slot->origin != NULL) {
+                slot = p;
+            }
+            continue;
+        }
+        if (strcmp(p->origin, origin) == 0) {
+            if (p->state != CURL_DNS_PREFETCH_DONE || now - p->time < CURL_DNS_PREFETCH_REPEAT_TIME) {
+                /* already resolved, or being resolved */
+                return NULL;
+            }
+            slot = p;
+            break;
+        }
+        if (p->state == CURL_DNS_PREFETCH_DONE && (slot == NULL || (slot->origin != NULL && p->time < slot->time))) {
+            slot = p;
+        }
+    }
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    copy = strdup(origin);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    free(slot->origin);
+    slot->origin = copy;
+    slot->state = CURL_DNS_PREFETCH_QUEUED;
+    slot->credited = false;
+    slot->handle = NULL;
+    slot->time = now;
+
+    return slot;
+}
+
+
+/* exported interface documented in content/fetchers/curl_dns_prefetch.h */
+struct curl_dns_prefetch *curl_dns_prefetch_credit(struct curl_dns_prefetch *table, const char *origin, uint64_t now)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        struct curl_dns_prefetch *p = &table[i];
+
+        if (p->origin != NULL && p->state == CURL_DNS_PREFETCH_DONE && !p->credited &&
+            now - p->time < CURL_DNS_PREFETCH_CREDIT_TIME && strcmp(p->origin, origin) == 0) {
+            p->credited = true;
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* exported interface documented in content/fetchers/curl_dns_prefetch.h */
+void curl_dns_prefetch_clear(struct curl_dns_prefetch *table)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        free(table[i].origin);
+    }
+    memset(table, 0, CURL_DNS_PREFETCH_SLOTS * sizeof(*table));
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Origins whose host names the cURL fetcher resolves ahead of fetches
+ * (interface).
+ *
+ * Each origin is resolved at most once in a while, and only a few are
+ * resolved at once. Nothing here depends on cURL; the fetcher runs the
+ * lookups and records their progress in the table.
+ */
+
+#ifndef WISP_CONTENT_FETCHERS_CURL_DNS_PREFETCH_H
+#define WISP_CONTENT_FETCHERS_CURL_DNS_PREFETCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of origins remembered */
+#define CURL_DNS_PREFETCH_SLOTS 32
+
+/** Maximum number of lookups queued or in progress at once */
+#define CURL_DNS_PREFETCH_MAX_ACTIVE 4
+
+/** Time before an origin is resolved again / ms */
+#define CURL_DNS_PREFETCH_REPEAT_TIME 10000
+
+/** Time a lookup is credited to the next fetch from its origin / ms */
+#define CURL_DNS_PREFETCH_CREDIT_TIME 30000
+
+/** State of a lookup */
+enum curl_dns_prefetch_state {
+    CURL_DNS_PREFETCH_QUEUED, /**< Waiting to be started */
+    CURL_DNS_PREFETCH_ACTIVE, /**< Lookup in progress */
+    CURL_DNS_PREFETCH_DONE, /**< Finished, awaiting a fetch to credit */
+};
+
+/** Origin resolved ahead of a fetch */
+struct curl_dns_prefetch {
+    char *origin; /**< Origin URL, or NULL if the slot is unused */
+    enum curl_dns_prefetch_state state; /**< State of the lookup */
+    bool credited; /**< A fetch from the origin has been credited */
+    void *handle; /**< The fetcher's transfer while active */
+    uint64_t time; /**< When the lookup was requested / ms */
+};
+
+/**
+ * Queue the host name of an origin to be resolved
+ *
+ * Origins resolved within CURL_DNS_PREFETCH_REPEAT_TIME, or still being
+ * resolved, are not queued again, and nothing is queued while
+ * CURL_DNS_PREFETCH_MAX_ACTIVE lookups are queued or in progress. When the
+ * table is full the oldest finished lookup is forgotten.
+ *
+ * \param table   Table of CURL_DNS_PREFETCH_SLOTS entries
+ * \param origin  The origin, which is copied
+ * \param now     The current time / ms
+ * \return the queued entry, or NULL if nothing was queued
+ */
+struct curl_dns_prefetch *curl_dns_prefetch_queue(struct curl_dns_prefetch *table, const char *origin, uint64_t now);
+
+/**
+ * Find the lookup to credit to a fetch from an origin
+ *
+ * Each finished lookup is found once, within
+ * CURL_DNS_PREFETCH_CREDIT_TIME of being requested.
+ *
+ * \param table   Table of CURL_DNS_PREFETCH_SLOTS entries
+ * \param origin  The origin fetched from
+ * \param now     The current time / ms
+ * \return the entry, now marked credited, or NULL if there is none
+ */
+struct curl_dns_prefetch *curl_dns_prefetch_credit(struct curl_dns_prefetch *table, const char *origin, uint64_t now);
+
+/**
+ * Forget every origin
+ *
+ * Transfers of active lookups must already have been cleaned up.
+ *
+ * \param table  Table of CURL_DNS_PREFETCH_SLOTS entries
+ */
+void curl_dns_prefetch_clear(struct curl_dns_prefetch *table);
+
+#endif
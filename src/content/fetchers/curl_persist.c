@@ -0,0 +1,487 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Network state kept by the cURL fetcher across restarts (implementation).
+ *
+ * The state file is text, one record per line after a version line:
+ *
+ *     wisp-netstate 1
+ *     host <expires> <port> <host> <address>
+ *     tls <expires> <hex key> <hex ticket>
+ *
+ * Times are seconds since the epoch.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+#include <wisp/utils/ascii.h>
+
+#include "content/fetchers/curl_persist.h"
+
+/** First line of a state file */
+#define CURL_PERSIST_VERSION "wisp-netstate 1"
+
+/** Largest state file read */
+#define CURL_PERSIST_MAX_FILE (4 * 1024 * 1024)
+
+/** Longest host name kept, including the terminator */
+#define HOST_SIZE 256
+
+/** Longest numeric address kept, including the terminator */
+#define ADDR_SIZE 48
+
+/** Resolved host address */
+struct persist_host {
+    char host[HOST_SIZE]; /**< Host name, empty if the slot is unused */
+    long port; /**< Port */
+    char addr[ADDR_SIZE]; /**< Numeric address */
+    time_t expires; /**< When the record expires */
+    bool claimed; /**< Already handed to the fetcher */
+};
+
+/** TLS session */
+struct persist_session {
+    uint8_t *key; /**< Session key, NULL if the slot is unused */
+    size_t key_len; /**< Length of key */
+    uint8_t *data; /**< Session ticket */
+    size_t data_len; /**< Length of data */
+    time_t expires; /**< When the session expires */
+};
+
+/** Network state */
+struct curl_persist {
+    struct persist_host hosts[CURL_PERSIST_MAX_HOSTS];
+    struct persist_session sessions[CURL_PERSIST_MAX_SESSIONS];
+};
+
+
+/**
+ * Find the slot for a host, or the best slot to put it in
+ */
+static struct persist_host *find_host(struct curl_persist *persist, const char *host, long port)
+{
+    struct persist_host *victim = NULL;
+    unsigned int i;
+
+    for (i = 0; i < CURL_PERSIST_MAX_HOSTS; i++) {
+        struct persist_host *h = &persist->hosts[i];
+
+        if (h->host[0] == '\0') {
+            if (victim == NULL || victim->host[0] != '\0') {
+                victim = h;
+            }
+        } else if (h->port == port && strcmp(h->host, host) == 0) {
+            return h;
+        } else if (victim == NULL || (victim->host[0] != '\0' && h->expires < victim->expires)) {
+            victim = h;
+        }
+    }
+
+    return victim;
+}
+
+
+/**
+ * Find the slot for a session, or the best slot to put it in
+ */
+static struct persist_session *find_session(struct curl_persist *persist, const uint8_t *key, size_t key_len)
+{
+    struct persist_session *victim = NULL;
+    unsigned int i;
+
+    for (i = 0; i < CURL_PERSIST_MAX_SESSIONS; i++) {
+        struct persist_session *s = &persist->sessions[i];
+
+        if (s->key == NULL) {
+            if (victim == NULL || victim->key != NULL) {
+                victim = s;
+            }
+        } else if (s->key_len == key_len && memcmp(s->key, key, key_len) == 0) {
+            return s;
+        } else if (victim == NULL || (victim->key != NULL && s->expires < victim->expires)) {
+            victim = s;
+        }
+    }
+
+    return victim;
+}
+
+
+static void free_session(struct persist_session *s)
+{
+    free(s->key);
+    free(s->data);
+    memset(s, 0, sizeof(*s));
+}
+
+
+/**
+ * Decode a hex string in place
+ *
+ * \return the number of bytes decoded, or 0 if the string is not hex
+ */
+static size_t hex_decode(char *hex)
+{
+    size_t len = strlen(hex);
+    size_t i;
+
+    if (len == 0 || (len & 1) != 0) {
+        return 0;
+    }
+
+    for (i = 0; i < len / 2; i++) {
+        int hi = ascii_hex_to_value(hex[i * 2]);
+        int lo = ascii_hex_to_value(hex[i * 2 + 1]);
+
+        if (hi < 0 || lo < 0) {
+            return 0;
+        }
+        ((uint8_t *)hex)[i] = (uint8_t)((hi << 4) | lo);
+    }
+
+    return len / 2;
+}
+
+
+static bool hex_write(FILE *fp, const uint8_t *data, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (fprintf(fp, "%02x", data[i]) != 2) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Add the record on one line of a state file
+ *
+ * Lines which are malformed or expired are skipped.
+ */
+static void load_line(struct curl_persist *persist, char *line, time_t now)
+{
+    char *field[5];
+    char *save = NULL;
+    unsigned int count = 0;
+    char *end;
+    time_t expires;
+    char *tok;
+
+    for (tok = strtok_r(line, " ", &save); tok != NULL && count < 5; tok = strtok_r(NULL, " ", &save)) {
+        field[count++] = tok;
+    }
+    if (count < 4 || tok != NULL) {
+        return;
+    }
+
+    expires = (time_t)strtoll(field[1], &end, 10);
+    if (*end != '\0' || expires <= now) {
+        return;
+    }
+
+    if (count == 5 && strcmp(field[0], "host") == 0) {
+        long port = strtol(field[2], &end, 10);
+
+        if (*end == '\0' && port > 0 && port < 65536) {
+            curl_persist_add_host(persist, field[3], port, field[4], expires);
+        }
+    } else if (count == 4 && strcmp(field[0], "tls") == 0) {
+        size_t key_len = hex_decode(field[2]);
+        size_t data_len = hex_decode(field[3]);
+
+        if (key_len != 0 && data_len != 0) {
+            curl_persist_add_session(
+                persist, (uint8_t *)field[2], key_len, (uint8_t *)field[3], data_len, expires);
+        }
+    }
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+nserror curl_persist_create(struct curl_persist **persist_out)
+{
+    struct curl_persist *persist;
+
+    persist = calloc(1, sizeof(*persist));
+    if (persist == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    *persist_out = persist;
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+void curl_persist_destroy(struct curl_persist *persist)
+{
+    if (persist == NULL) {
+        return;
+    }
+
+    curl_persist_clear_sessions(persist);
+    free(persist);
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+nserror curl_persist_load(struct curl_persist *persist, const char *path, time_t now)
+{
+    FILE *fp;
+    char *buf;
+    size_t len;
+    char *line;
+    char *next;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NSERROR_NOT_FOUND;
+    }
+
+    buf = malloc(CURL_PERSIST_MAX_FILE + 1);
+    if (buf == NULL) {
+        fclose(fp);
+        return NSERROR_NOMEM;
+    }
+
+    len = fread(buf, 1, CURL_PERSIST_MAX_FILE + 1, fp);
+    fclose(fp);
+    if (len > CURL_PERSIST_MAX_FILE) {
+        free(buf);
+        return NSERROR_INVALID;
+    }
+    buf[len] = '\0';
+
+    next = strchr(buf, '\n');
+    if (next == NULL || (size_t)(next - buf) != strlen(CURL_PERSIST_VERSION) ||
+        strncmp(buf, CURL_PERSIST_VERSION, next - buf) != 0) {
+        free(buf);
+        return NSERROR_INVALID;
+    }
+
+    for (line = next + 1; *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        } else {
+            /* a truncated final line is not trusted */
+            break;
+        }
+        load_line(persist, line, now);
+    }
+
+    free(buf);
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+nserror curl_persist_save(const struct curl_persist *persist, const char *path, time_t now)
+{
+    size_t path_len = strlen(path);
+    char *tmp;
+    int fd;
+    FILE *fp;
+    bool ok;
+    unsigned int i;
+
+    tmp = malloc(path_len + 5);
+    if (tmp == NULL) {
+        return NSERROR_SAVE_FAILED;
+    }
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", 5);
+
+    /* The state holds TLS session tickets, so only the user may read
+     * it. A stale file would keep its mode through O_TRUNC. */
+    remove(tmp);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        free(tmp);
+        return NSERROR_SAVE_FAILED;
+    }
+#ifdef _WIN32
+    _setmode(fd, _O_BINARY);
+#endif
+
+    fp = fdopen(fd, "wb");
+    if (fp == NULL) {
+        close(fd);
+        remove(tmp);
+        free(tmp);
+        return NSERROR_SAVE_FAILED;
+    }
+
+    ok = fprintf(fp, "%s\n", CURL_PERSIST_VERSION) > 0;
+
+    for (i = 0; ok && i < CURL_PERSIST_MAX_HOSTS; i++) {
+        const struct persist_host *h = &persist->hosts[i];
+
+        if (h->host[0] != '\0' && h->expires > now) {
+            ok = fprintf(fp, "host %lld %ld %s %s\n", (long long)h->expires, h->port, h->host, h->addr) > 0;
+        }
+    }
+
+    for (i = 0; ok && i < CURL_PERSIST_MAX_SESSIONS; i++) {
+        const struct persist_session *s = &persist->sessions[i];
+
+        if (s->key != NULL && s->expires > now) {
+            ok = fprintf(fp, "tls %lld ", (long long)s->expires) > 0 && hex_write(fp, s->key, s->key_len) &&
+                 fputc(' ', fp) != EOF && hex_write(fp, s->data, s->data_len) && fputc('\n', fp) != EOF;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    if (ok && rename(tmp, path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(tmp);
+    }
+
+    free(tmp);
+    return ok ? NSERROR_OK : NSERROR_SAVE_FAILED;
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+nserror curl_persist_add_host(struct curl_persist *persist, const char *host, long port, const char *addr,
+    time_t expires)
+{
+    struct persist_host *h;
+    size_t host_len = strlen(host);
+    size_t addr_len = strlen(addr);
+
+    if (host_len == 0 || host_len >= HOST_SIZE || addr_len == 0 || addr_len >= ADDR_SIZE ||
+        strpbrk(host, " \n") != NULL || strpbrk(addr, " \n") != NULL) {
+        return NSERROR_BAD_PARAMETER;
+    }
+
+    h = find_host(persist, host, port);
+    memcpy(h->host, host, host_len + 1);
+    memcpy(h->addr, addr, addr_len + 1);
+    h->port = port;
+    h->expires = expires;
+    h->claimed = false;
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+void curl_persist_remove_host(struct curl_persist *persist, const char *host, long port)
+{
+    struct persist_host *h = find_host(persist, host, port);
+
+    if (h->host[0] != '\0' && h->port == port && strcmp(h->host, host) == 0) {
+        memset(h, 0, sizeof(*h));
+    }
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+const char *curl_persist_claim_host(struct curl_persist *persist, const char *host, long port, time_t now)
+{
+    struct persist_host *h = find_host(persist, host, port);
+
+    if (h->host[0] == '\0' || h->port != port || strcmp(h->host, host) != 0 || h->claimed || h->expires <= now) {
+        return NULL;
+    }
+
+    h->claimed = true;
+    return h->addr;
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+nserror curl_persist_add_session(struct curl_persist *persist, const uint8_t *key, size_t key_len,
+    const uint8_t *data, size_t data_len, time_t expires)
+{
+    struct persist_session *s;
+    uint8_t *key_copy;
+    uint8_t *data_copy;
+
+    if (key_len == 0 || key_len > CURL_PERSIST_MAX_SESSION_SIZE || data_len == 0 ||
+        data_len > CURL_PERSIST_MAX_SESSION_SIZE) {
+        return NSERROR_BAD_PARAMETER;
+    }
+
+    key_copy = malloc(key_len);
+    data_copy = malloc(data_len);
+    if (key_copy == NULL || data_copy == NULL) {
+        free(key_copy);
+        free(data_copy);
+        return NSERROR_NOMEM;
+    }
+    memcpy(key_copy, key, key_len);
+    memcpy(data_copy, data, data_len);
+
+    s = find_session(persist, key, key_len);
+    free_session(s);
+    s->key = key_copy;
+    s->key_len = key_len;
+    s->data = data_copy;
+    s->data_len = data_len;
+    s->expires = expires;
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+void curl_persist_clear_sessions(struct curl_persist *persist)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_PERSIST_MAX_SESSIONS; i++) {
+        free_session(&persist->sessions[i]);
+    }
+}
+
+
+/* exported interface documented in content/fetchers/curl_persist.h */
+void curl_persist_each_session(const struct curl_persist *persist, time_t now, curl_persist_session_cb cb, void *pw)
+{
+    unsigned int i;
+
+    for (i = 0; i < CURL_PERSIST_MAX_SESSIONS; i++) {
+        const struct persist_session *s = &persist->sessions[i];
+
+        if (s->key != NULL && s->expires > now) {
+            cb(s->key, s->key_len, s->data, s->data_len, pw);
+        }
+    }
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Network state kept by the cURL fetcher across restarts (interface).
+ *
+ * Resolved host addresses and TLS session tickets are held with the time
+ * they expire and written to a small file on exit, so the first fetches
+ * after a restart can skip the DNS lookup and resume the TLS session.
+ * Nothing here depends on cURL; the fetcher moves records to and from its
+ * share handle.
+ */
+
+#ifndef WISP_CONTENT_FETCHERS_CURL_PERSIST_H
+#define WISP_CONTENT_FETCHERS_CURL_PERSIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <wisp/utils/errors.h>
+
+/** Maximum number of host addresses kept */
+#define CURL_PERSIST_MAX_HOSTS 256
+
+/** Maximum number of TLS sessions kept */
+#define CURL_PERSIST_MAX_SESSIONS 64
+
+/** Maximum size of a TLS session key or ticket / bytes */
+#define CURL_PERSIST_MAX_SESSION_SIZE 16384
+
+struct curl_persist;
+
+/**
+ * Callback for each TLS session kept
+ *
+ * \param key       The session key
+ * \param key_len   Length of \a key
+ * \param data      The session ticket
+ * \param data_len  Length of \a data
+ * \param pw        The private word passed to curl_persist_each_session()
+ */
+typedef void (*curl_persist_session_cb)(
+    const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len, void *pw);
+
+/**
+ * Create an empty set of network state
+ *
+ * \param persist_out  Updated to the new state
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion
+ */
+nserror curl_persist_create(struct curl_persist **persist_out);
+
+/**
+ * Destroy a set of network state
+ *
+ * \param persist  The state
+ */
+void curl_persist_destroy(struct curl_persist *persist);
+
+/**
+ * Add the records in a state file
+ *
+ * Records which have expired, and files which are not recognised, are
+ * ignored.
+ *
+ * \param persist  The state
+ * \param path     Path of the state file
+ * \param now      The current time
+ * \return NSERROR_OK on success, NSERROR_NOT_FOUND if the file could not be
+ *         read or NSERROR_INVALID if it is not a state file
+ */
+nserror curl_persist_load(struct curl_persist *persist, const char *path, time_t now);
+
+/**
+ * Write the unexpired records to a state file
+ *
+ * The file is replaced atomically.
+ *
+ * \param persist  The state
+ * \param path     Path of the state file
+ * \param now      The current time
+ * \return NSERROR_OK on success or NSERROR_SAVE_FAILED on error
+ */
+nserror curl_persist_save(const struct curl_persist *persist, const char *path, time_t now);
+
+/**
+ * Record the address a host resolved to
+ *
+ * Any record for the same host and port is replaced. When the state is
+ * full the record expiring soonest is dropped.
+ *
+ * \param persist  The state
+ * \param host     The host name
+ * \param port     The port
+ * \param addr     The numeric address
+ * \param expires  When the record expires
+ * \return NSERROR_OK on success or NSERROR_BAD_PARAMETER if the record is
+ *         too large to keep
+ */
+nserror curl_persist_add_host(struct curl_persist *persist, const char *host, long port, const char *addr,
+    time_t expires);
+
+/**
+ * Forget the address recorded for a host
+ *
+ * \param persist  The state
+ * \param host     The host name
+ * \param port     The port
+ */
+void curl_persist_remove_host(struct curl_persist *persist, const char *host, long port);
+
+/**
+ * Take the address recorded for a host, if not already taken
+ *
+ * Each record is handed out once, as the fetcher's own DNS cache holds the
+ * address after that. The record is still written out by
+ * curl_persist_save() until it expires.
+ *
+ * \param persist  The state
+ * \param host     The host name
+ * \param port     The port
+ * \param now      The current time
+ * \return the numeric address, or NULL if there is none to take
+ */
+const char *curl_persist_claim_host(struct curl_persist *persist, const char *host, long port, time_t now);
+
+/**
+ * Record a TLS session
+ *
+ * Any session with the same key is replaced. When the state is full the
+ * session expiring soonest is dropped.
+ *
+ * \param persist   The state
+ * \param key       The session key
+ * \param key_len   Length of \a key
+ * \param data      The session ticket
+ * \param data_len  Length of \a data
+ * \param expires   When the session expires
+ * \return NSERROR_OK on success, NSERROR_BAD_PARAMETER if the session is
+ *         too large to keep or NSERROR_NOMEM on memory exhaustion
+ */
+nserror curl_persist_add_session(struct curl_persist *persist, const uint8_t *key, size_t key_len,
+    const uint8_t *data, size_t data_len, time_t expires);
+
+/**
+ * Forget every TLS session
+ *
+ * \param persist  The state
+ */
+void curl_persist_clear_sessions(struct curl_persist *persist);
+
+/**
+ * Call a function for each unexpired TLS session
+ *
+ * \param persist  The state
+ * \param now      The current time
+ * \param cb       The function to call
+ * \param pw       Private word for \a cb
+ */
+void curl_persist_each_session(const struct curl_persist *persist, time_t now, curl_persist_session_cb cb, void *pw);
+
+#endif
@@ -30,6 +30,8 @@
 #include <wisp/utils/messages.h>
 #include <wisp/utils/utils.h>
 #include "utils/http.h"
+#include "utils/phase.h"
+#include "utils/trace.h"
 #include "content/content_factory.h"
 #include "desktop/system_colour.h"
 
@@ -246,12 +248,15 @@ static bool nscss_process_data(struct content *c, const char *data, unsigned int
 {
     nscss_content *css = (nscss_content *)c;
     css_error error;
+    enum phase previous;
 
     NSLOG(wisp, INFO, "Processing CSS data: %u bytes for %p", size, c);
-    NSLOG(wisp, DEBUG, "PROFILER: START CSS parsing %p", c);
 
+    TRACE_BEGIN_ARG("css", "parse chunk", "bytes", size);
+    previous = phase_enter(PHASE_PARSE);
     error = nscss_process_css_data(&css->data, data, size);
-    NSLOG(wisp, DEBUG, "PROFILER: STOP CSS parsing %p", c);
+    phase_leave(previous);
+    TRACE_END("css", "parse chunk");
     if (error != CSS_OK && error != CSS_NEEDDATA) {
         NSLOG(wisp, ERROR, "nscss_process_css_data failed: %d", error);
         content_broadcast_error(c, NSERROR_CSS, NULL);
@@ -304,8 +309,13 @@ bool nscss_convert(struct content *c)
 static css_error nscss_convert_css_data(struct content_css_data *c)
 {
     css_error error;
+    enum phase previous;
 
+    TRACE_BEGIN("css", "parse completed");
+    previous = phase_enter(PHASE_PARSE);
     error = css_stylesheet_data_done(c->sheet);
+    phase_leave(previous);
+    TRACE_END("css", "parse completed");
 
     /* Process pending imports */
     if (error == CSS_IMPORTS_PENDING) {
@@ -376,6 +386,7 @@ nserror nscss_clone(const struct content *old, struct content **newc)
     nscss_content *new_css;
     const uint8_t *data;
     size_t size;
+    size_t offset = 0;
     nserror error;
 
     new_css = calloc(1, sizeof(nscss_content));
@@ -397,12 +408,12 @@ nserror nscss_clone(const struct content *old, struct content **newc)
         return error;
     }
 
-    data = content__get_source_data(&new_css->base, &size);
-    if (size > 0) {
+    while ((data = content__get_source_run(&new_css->base, offset, &size)) != NULL) {
         if (nscss_process_data(&new_css->base, (char *)data, (unsigned int)size) == false) {
             content_destroy(&new_css->base);
             return NSERROR_CLONE_FAILED;
         }
+        offset += size;
     }
 
     if (old->status == CONTENT_STATUS_READY || old->status == CONTENT_STATUS_DONE) {
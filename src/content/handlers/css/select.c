@@ -17,15 +17,20 @@
  */
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
 #include <wisp/plot_style.h>
 #include <wisp/url_db.h>
+#include <wisp/utils/ascii.h>
 #include <wisp/utils/corestrings.h>
 #include <wisp/utils/log.h>
 #include <wisp/utils/nsoption.h>
 #include <wisp/utils/nsurl.h>
+#include "utils/phase.h"
+#include "utils/trace.h"
 #include "desktop/system_colour.h"
 
 #include "content/handlers/css/hints.h"
@@ -218,17 +223,17 @@ static void nscss_dom_user_data_handler(
 }
 
 /**
- * Get style selection results for an element
+ * Select and compose the computed styles for an element
  *
  * \param ctx             CSS selection context
  * \param n               Element to select for
  * \param media           Permitted media types
- * \param unit_unit_len_ctx    Unit length conversion context
+ * \param unit_len_ctx    Unit length conversion context
  * \param inline_style    Inline style associated with element, or NULL
  * \return Pointer to selection results (containing computed styles),
  *         or NULL on failure
  */
-css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n, const css_media *media,
+static css_select_results *nscss_select_style(nscss_select_ctx *ctx, dom_node *n, const css_media *media,
     const css_unit_ctx *unit_len_ctx, const css_stylesheet *inline_style)
 {
     css_computed_style *composed;
@@ -291,6 +296,32 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n, const cs
     return styles;
 }
 
+/**
+ * Get style selection results for an element
+ *
+ * \param ctx             CSS selection context
+ * \param n               Element to select for
+ * \param media           Permitted media types
+ * \param unit_unit_len_ctx    Unit length conversion context
+ * \param inline_style    Inline style associated with element, or NULL
+ * \return Pointer to selection results (containing computed styles),
+ *         or NULL on failure
+ */
+css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n, const css_media *media,
+    const css_unit_ctx *unit_len_ctx, const css_stylesheet *inline_style)
+{
+    css_select_results *styles;
+    enum phase previous;
+
+    TRACE_BEGIN("css", "select style");
+    previous = phase_enter(PHASE_STYLE);
+    styles = nscss_select_style(ctx, n, media, unit_len_ctx, inline_style);
+    phase_leave(previous);
+    TRACE_END("css", "select style");
+
+    return styles;
+}
+
 /**
  * Get a blank style
  *
@@ -1192,6 +1223,251 @@ css_error node_is_root(void *pw, void *node, bool *match)
     return CSS_OK;
 }
 
+/**
+ * Number of siblings a count must step over before the parent's element
+ * children are indexed. Short sibling lists are cheaper to walk.
+ */
+#define SIBLING_INDEX_THRESHOLD 32
+
+/**
+ * Position of an element among its parent's element children
+ */
+struct nscss_sibling_slot {
+    dom_node *node; /**< Element child, or NULL if the slot is unused */
+    uint32_t index; /**< Element children before this one */
+    uint32_t name_index; /**< Children with the same name before this one */
+    uint32_t name_count; /**< Children with the same name in total */
+};
+
+/**
+ * Index of a parent's element children, stored as user data on the parent
+ * so nth-child and similar selectors do not walk the sibling list of every
+ * child they are matched against.
+ */
+struct nscss_sibling_index {
+    uint32_t generation; /**< Child list generation that was indexed */
+    uint32_t count; /**< Number of element children */
+    uint32_t mask; /**< Number of slots, less one */
+    struct nscss_sibling_slot slots[]; /**< Children, hashed by address */
+};
+
+/**
+ * Name of an element child, used while building a sibling index
+ */
+struct nscss_sibling_name {
+    dom_string *name; /**< Element name, or NULL if the slot is unused */
+    uint32_t count; /**< Children seen with this name */
+};
+
+/* Handler for sibling indices, stored as libdom node user data */
+static void nscss_sibling_index_user_data_handler(
+    dom_node_operation operation, dom_string *key, void *data, struct dom_node *src, struct dom_node *dst)
+{
+    if (operation == DOM_NODE_DELETED && data != NULL) {
+        free(data);
+    }
+}
+
+static inline uint32_t nscss_sibling_hash(const dom_node *node)
+{
+    uintptr_t p = (uintptr_t)node;
+
+    return (uint32_t)((p >> 4) ^ (p >> 20)) * 2654435761u;
+}
+
+static uint32_t nscss_sibling_name_hash(const dom_string *name)
+{
+    const char *data = dom_string_data(name);
+    size_t len = dom_string_byte_length(name);
+    uint32_t hash = 0x811c9dc5;
+
+    while (len-- > 0) {
+        hash ^= (uint8_t)ascii_to_lower(*data++);
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/**
+ * Find an element in a sibling index
+ *
+ * \param index  Sibling index of the element's parent
+ * \param node   Element to find
+ * \return the element's slot, or NULL if it is not in the index
+ */
+static const struct nscss_sibling_slot *
+nscss_sibling_index_find(const struct nscss_sibling_index *index, const dom_node *node)
+{
+    uint32_t i = nscss_sibling_hash(node) & index->mask;
+
+    while (index->slots[i].node != NULL) {
+        if (index->slots[i].node == node)
+            return &index->slots[i];
+        i = (i + 1) & index->mask;
+    }
+
+    return NULL;
+}
+
+/**
+ * Index the element children of a node
+ *
+ * \param parent      Node whose children to index
+ * \param generation  Current child list generation of the document
+ * \return the new index, or NULL on failure
+ */
+static struct nscss_sibling_index *nscss_sibling_index_create(dom_node *parent, uint32_t generation)
+{
+    struct nscss_sibling_index *index = NULL;
+    struct nscss_sibling_name *names = NULL;
+    dom_node *child, *next;
+    dom_node_type type;
+    uint32_t count = 0;
+    uint32_t size = 2;
+    uint32_t i;
+    dom_exception exc;
+
+    /* Count the element children */
+    exc = dom_node_get_first_child(parent, &child);
+    while (exc == DOM_NO_ERR && child != NULL) {
+        exc = dom_node_get_node_type(child, &type);
+        if (exc == DOM_NO_ERR && type == DOM_ELEMENT_NODE)
+            count++;
+        exc = dom_node_get_next_sibling(child, &next);
+        dom_node_unref(child);
+        child = next;
+    }
+    if (exc != DOM_NO_ERR)
+        return NULL;
+
+    /* Keep the tables at most half full */
+    while (size < count * 2)
+        size *= 2;
+
+    index = calloc(1, sizeof(*index) + size * sizeof(index->slots[0]));
+    names = calloc(size, sizeof(*names));
+    if (index == NULL || names == NULL) {
+        free(index);
+        free(names);
+        return NULL;
+    }
+    index->generation = generation;
+    index->count = count;
+    index->mask = size - 1;
+
+    /* Record each element's position, overall and among those of the
+     * same name. name_count holds the name's table slot until the totals
+     * are known. */
+    count = 0;
+    exc = dom_node_get_first_child(parent, &child);
+    while (exc == DOM_NO_ERR && child != NULL) {
+        exc = dom_node_get_node_type(child, &type);
+        if (exc == DOM_NO_ERR && type == DOM_ELEMENT_NODE && count < index->count) {
+            struct nscss_sibling_slot *slot;
+            dom_string *name = NULL;
+            uint32_t n;
+
+            exc = dom_node_get_node_name(child, &name);
+            if (exc != DOM_NO_ERR || name == NULL) {
+                dom_node_unref(child);
+                exc = DOM_NO_MEM_ERR;
+                break;
+            }
+
+            n = nscss_sibling_name_hash(name) & index->mask;
+            while (names[n].name != NULL && !dom_string_caseless_isequal(names[n].name, name))
+                n = (n + 1) & index->mask;
+            if (names[n].name == NULL)
+                names[n].name = dom_string_ref(name);
+            dom_string_unref(name);
+
+            i = nscss_sibling_hash(child) & index->mask;
+            while (index->slots[i].node != NULL)
+                i = (i + 1) & index->mask;
+            slot = &index->slots[i];
+            slot->node = child;
+            slot->index = count++;
+            slot->name_index = names[n].count++;
+            slot->name_count = n;
+        }
+        exc = dom_node_get_next_sibling(child, &next);
+        dom_node_unref(child);
+        child = next;
+    }
+
+    for (i = 0; i < size; i++) {
+        if (exc == DOM_NO_ERR && index->slots[i].node != NULL)
+            index->slots[i].name_count = names[index->slots[i].name_count].count;
+        if (names[i].name != NULL)
+            dom_string_unref(names[i].name);
+    }
+    free(names);
+
+    if (exc != DOM_NO_ERR) {
+        free(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+/**
+ * Find an element's position among its siblings from its parent's index
+ *
+ * \param node    Element to find
+ * \param parent  Parent of the element
+ * \param index   Updated to the parent's index, if it is current
+ * \return the element's slot, or NULL if the parent has no current index
+ */
+static const struct nscss_sibling_slot *
+nscss_sibling_lookup(dom_node *node, dom_node *parent, const struct nscss_sibling_index **index)
+{
+    struct nscss_sibling_index *data = NULL;
+    uint32_t generation;
+    dom_exception exc;
+
+    exc = dom_node_get_user_data(parent, corestring_dom___ns_key_sibling_index_node_data, (void *)&data);
+    if (exc != DOM_NO_ERR || data == NULL)
+        return NULL;
+
+    exc = dom_node_get_child_list_generation(parent, &generation);
+    if (exc != DOM_NO_ERR || data->generation != generation)
+        return NULL;
+
+    *index = data;
+    return nscss_sibling_index_find(data, node);
+}
+
+/**
+ * Replace the sibling index of a node
+ *
+ * \param parent  Node whose children to index
+ */
+static void nscss_sibling_index_update(dom_node *parent)
+{
+    struct nscss_sibling_index *index;
+    void *old_index = NULL;
+    uint32_t generation;
+    dom_exception exc;
+
+    if (dom_node_get_child_list_generation(parent, &generation) != DOM_NO_ERR)
+        return;
+
+    index = nscss_sibling_index_create(parent, generation);
+    if (index == NULL)
+        return;
+
+    exc = dom_node_set_user_data(parent, corestring_dom___ns_key_sibling_index_node_data, index,
+        nscss_sibling_index_user_data_handler, &old_index);
+    if (exc != DOM_NO_ERR) {
+        free(index);
+        return;
+    }
+
+    free(old_index);
+}
+
 static int node_count_siblings_check(dom_node *node, bool check_name, dom_string *name)
 {
     dom_node_type type;
@@ -1238,14 +1514,35 @@ static int node_count_siblings_check(dom_node *node, bool check_name, dom_string
  */
 css_error node_count_siblings(void *pw, void *n, bool same_name, bool after, int32_t *count)
 {
+    const struct nscss_sibling_index *index = NULL;
+    const struct nscss_sibling_slot *slot = NULL;
+    dom_node *parent = NULL;
+    uint32_t walked = 0;
     int32_t cnt = 0;
     dom_exception exc;
     dom_string *node_name = NULL;
 
+    /* Answer from the parent's index of its children, if it has one */
+    exc = dom_node_get_parent_node(n, &parent);
+    if (exc == DOM_NO_ERR && parent != NULL) {
+        slot = nscss_sibling_lookup(n, parent, &index);
+        if (slot != NULL) {
+            if (same_name) {
+                *count = after ? slot->name_count - slot->name_index - 1 : slot->name_index;
+            } else {
+                *count = after ? index->count - slot->index - 1 : slot->index;
+            }
+            dom_node_unref(parent);
+            return CSS_OK;
+        }
+    }
+
     if (same_name) {
         dom_node *node = n;
         exc = dom_node_get_node_name(node, &node_name);
         if ((exc != DOM_NO_ERR) || (node_name == NULL)) {
+            if (parent != NULL)
+                dom_node_unref(parent);
             return CSS_NOMEM;
         }
     }
@@ -1263,6 +1560,7 @@ css_error node_count_siblings(void *pw, void *n, bool same_name, bool after, int
             node = next;
 
             cnt += node_count_siblings_check(node, same_name, node_name);
+            walked++;
         } while (node != NULL);
     } else {
         dom_node *node = dom_node_ref(n);
@@ -1277,6 +1575,7 @@ css_error node_count_siblings(void *pw, void *n, bool same_name, bool after, int
             node = next;
 
             cnt += node_count_siblings_check(node, same_name, node_name);
+            walked++;
 
         } while (node != NULL);
     }
@@ -1285,6 +1584,14 @@ css_error node_count_siblings(void *pw, void *n, bool same_name, bool after, int
         dom_string_unref(node_name);
     }
 
+    /* Long sibling lists are likely to be counted again for the other
+     * children, so index them */
+    if (parent != NULL) {
+        if (walked > SIBLING_INDEX_THRESHOLD)
+            nscss_sibling_index_update(parent);
+        dom_node_unref(parent);
+    }
+
     *count = cnt;
     return CSS_OK;
 }
@@ -40,6 +40,8 @@
 #include <wisp/utils/utf8.h>
 #include <nsutils/time.h>
 #include "utils/talloc.h"
+#include "utils/phase.h"
+#include "utils/trace.h"
 #include "utils/utils.h"
 #include "content/handlers/css/select.h"
 #include <wctype.h>
@@ -54,6 +56,27 @@
 #include "content/handlers/html/box_special.h"
 #include "content/handlers/html/object.h"
 
+/**
+ * Size of the blocks boxes and their strings are carved out of. Most box
+ * trees are built and freed as a whole so bump allocation from a pool
+ * avoids a malloc per box.
+ */
+#define BOX_POOL_SIZE (64 * 1024)
+
+/**
+ * Number of parsed style attributes kept during box tree construction.
+ * Generated pages often repeat one style attribute on many elements.
+ */
+#define BOX_INLINE_STYLE_CACHE_SIZE 64
+
+/**
+ * Stylesheet parsed from a style attribute
+ */
+struct box_inline_style {
+    dom_string *text; /**< Attribute value, or NULL if the slot is unused */
+    css_stylesheet *sheet; /**< Stylesheet parsed from text */
+};
+
 /**
  * Context for box tree construction
  */
@@ -67,6 +90,9 @@ struct box_construct_ctx {
     box_construct_complete_cb cb; /**< Callback to invoke on completion */
 
     int *bctx; /**< talloc context */
+
+    /** Recently parsed style attributes, indexed by hash */
+    struct box_inline_style inline_styles[BOX_INLINE_STYLE_CACHE_SIZE];
 };
 
 /**
@@ -180,9 +206,9 @@ static void box_extract_properties(dom_node *n, struct box_construct_props *prop
 
             if (parent_box != NULL) {
                 props->parent_style = parent_box->style;
-                props->href = parent_box->href;
-                props->target = parent_box->target;
-                props->title = parent_box->title;
+                props->href = box_extra(parent_box)->href;
+                props->target = box_extra(parent_box)->target;
+                props->title = box_extra(parent_box)->title;
 
                 dom_node_unref(parent_node);
                 break;
@@ -235,24 +261,80 @@ static void box_extract_properties(dom_node *n, struct box_construct_props *prop
 }
 
 
+/**
+ * Get the stylesheet for a style attribute.
+ *
+ * Elements with the same style attribute share a single parse of it while
+ * the box tree is constructed.
+ *
+ * \param  ctx  box construction context
+ * \param  s    value of the style attribute
+ * \return  the stylesheet, owned by ctx, or NULL on memory exhaustion
+ */
+static css_stylesheet *box_get_inline_style(struct box_construct_ctx *ctx, dom_string *s)
+{
+    html_content *c = ctx->content;
+    struct box_inline_style *entry;
+    css_stylesheet *sheet;
+
+    entry = &ctx->inline_styles[dom_string_hash(s) % BOX_INLINE_STYLE_CACHE_SIZE];
+    if (entry->text != NULL && dom_string_isequal(entry->text, s))
+        return entry->sheet;
+
+    sheet = nscss_create_inline_style((const uint8_t *)dom_string_data(s), dom_string_byte_length(s), c->encoding,
+        nsurl_access(c->base_url), c->quirks != DOM_DOCUMENT_QUIRKS_MODE_NONE);
+    if (sheet == NULL)
+        return NULL;
+
+    if (entry->text != NULL) {
+        dom_string_unref(entry->text);
+        css_stylesheet_destroy(entry->sheet);
+    }
+    entry->text = dom_string_ref(s);
+    entry->sheet = sheet;
+
+    return sheet;
+}
+
+
+/**
+ * Destroy a box construction context.
+ *
+ * \param  ctx  box construction context
+ */
+static void box_construct_ctx_destroy(struct box_construct_ctx *ctx)
+{
+    unsigned int i;
+
+    for (i = 0; i < BOX_INLINE_STYLE_CACHE_SIZE; i++) {
+        if (ctx->inline_styles[i].text != NULL) {
+            dom_string_unref(ctx->inline_styles[i].text);
+            css_stylesheet_destroy(ctx->inline_styles[i].sheet);
+        }
+    }
+
+    free(ctx);
+}
+
+
 /**
  * Get the style for an element.
  *
- * \param  c               content of type CONTENT_HTML that is being processed
+ * \param  ctx             box construction context
  * \param  parent_style    style at this point in xml tree, or NULL for root
  * \param  root_style      root node's style, or NULL for root
  * \param  n               node in xml tree
  * \return  the new style, or NULL on memory exhaustion
  */
-static css_select_results *box_get_style(
-    html_content *c, const css_computed_style *parent_style, const css_computed_style *root_style, dom_node *n)
+static css_select_results *box_get_style(struct box_construct_ctx *ctx, const css_computed_style *parent_style,
+    const css_computed_style *root_style, dom_node *n)
 {
+    html_content *c = ctx->content;
     dom_string *s = NULL;
     css_stylesheet *inline_style = NULL;
-    css_select_results *styles;
-    nscss_select_ctx ctx;
+    nscss_select_ctx select_ctx;
 
-    /* Firstly, construct inline stylesheet, if any */
+    /* Firstly, find the inline stylesheet, if any */
     if (nsoption_bool(author_level_css)) {
         dom_exception err;
         err = dom_element_get_attribute(n, corestring_dom_style, &s);
@@ -262,8 +344,7 @@ static css_select_results *box_get_style(
     }
 
     if (s != NULL) {
-        inline_style = nscss_create_inline_style((const uint8_t *)dom_string_data(s), dom_string_byte_length(s),
-            c->encoding, nsurl_access(c->base_url), c->quirks != DOM_DOCUMENT_QUIRKS_MODE_NONE);
+        inline_style = box_get_inline_style(ctx, s);
 
         dom_string_unref(s);
 
@@ -272,21 +353,15 @@ static css_select_results *box_get_style(
     }
 
     /* Populate selection context */
-    ctx.ctx = c->select_ctx;
-    ctx.quirks = (c->quirks == DOM_DOCUMENT_QUIRKS_MODE_FULL);
-    ctx.base_url = c->base_url;
-    ctx.universal = c->universal;
-    ctx.root_style = root_style;
-    ctx.parent_style = parent_style;
+    select_ctx.ctx = c->select_ctx;
+    select_ctx.quirks = (c->quirks == DOM_DOCUMENT_QUIRKS_MODE_FULL);
+    select_ctx.base_url = c->base_url;
+    select_ctx.universal = c->universal;
+    select_ctx.root_style = root_style;
+    select_ctx.parent_style = parent_style;
 
     /* Select style for element */
-    styles = nscss_get_style(&ctx, n, &c->media, &c->unit_len_ctx, inline_style);
-
-    /* No longer need inline style */
-    if (inline_style != NULL)
-        css_stylesheet_destroy(inline_style);
-
-    return styles;
+    return nscss_get_style(&select_ctx, n, &c->media, &c->unit_len_ctx, inline_style);
 }
 
 
@@ -874,7 +949,7 @@ static bool box_construct_element(struct box_construct_ctx *ctx, bool *convert_c
         root_style = ctx->root_box->style;
     }
 
-    styles = box_get_style(ctx->content, props.parent_style, root_style, ctx->n);
+    styles = box_get_style(ctx, props.parent_style, root_style, ctx->n);
     if (styles == NULL)
         return false;
 
@@ -1025,11 +1100,11 @@ static bool box_construct_element(struct box_construct_ctx *ctx, bool *convert_c
         box->style = NULL;
 
         /* Free associated gadget, if any. This handles both formless controls
-         * and controls in a form's list. form_free_control sets box->gadget
-         * to NULL via control->box->gadget = NULL. */
-        if (box->gadget != NULL) {
-            form_free_control(box->gadget);
-            box->gadget = NULL;
+         * and controls in a form's list. form_free_control clears the
+         * box's gadget via control->box. */
+        if (box_extra(box)->gadget != NULL) {
+            form_free_control(box->extra->gadget);
+            box->extra->gadget = NULL;
         }
 
         /* Can't do this, because the lifetimes of boxes and gadgets
@@ -1276,8 +1351,10 @@ static void box_construct_element_after(dom_node *n, html_content *content)
             box_add_child(props.containing_block, props.inline_container);
         }
 
-        inline_end = box_create(NULL, box->style, false, box->href, box->target, box->title,
-            box->id == NULL ? NULL : lwc_string_ref(box->id), content->bctx);
+        const struct box_extra *extra = box_extra(box);
+
+        inline_end = box_create(NULL, box->style, false, extra->href, extra->target, extra->title,
+            extra->id == NULL ? NULL : lwc_string_ref(extra->id), content->bctx);
         if (inline_end != NULL) {
             inline_end->type = BOX_INLINE_END;
 
@@ -1724,9 +1801,11 @@ static void convert_xml_to_box(void *p)
     bool convert_children;
     uint32_t num_processed = 0;
     uint64_t start_time, now_time;
+    enum phase previous;
 
     nsu_getmonotonic_ms(&start_time);
-    NSLOG(wisp, DEBUG, "PROFILER: START Box construction slice %p", ctx);
+    TRACE_BEGIN("html", "box construction slice");
+    previous = phase_enter(PHASE_BOX);
 
     do {
         convert_children = true;
@@ -1735,12 +1814,13 @@ static void convert_xml_to_box(void *p)
 
         if (box_construct_element(ctx, &convert_children) == false) {
             NSLOG(wisp, WARNING, "box_construct_element failed");
+            phase_leave(previous);
+            TRACE_END("html", "box construction slice");
             ctx->cb(ctx->content, false);
             dom_node_unref(ctx->n);
             if (ctx->root_box != NULL)
                 box_free(ctx->root_box);
-            free(ctx);
-            NSLOG(wisp, DEBUG, "PROFILER: STOP Box construction slice %p", ctx);
+            box_construct_ctx_destroy(ctx);
             return;
         }
 
@@ -1754,12 +1834,13 @@ static void convert_xml_to_box(void *p)
             err = dom_node_get_node_type(next, &type);
             if (err != DOM_NO_ERR) {
                 NSLOG(wisp, WARNING, "dom_node_get_node_type failed");
+                phase_leave(previous);
+                TRACE_END("html", "box construction slice");
                 ctx->cb(ctx->content, false);
                 dom_node_unref(next);
                 if (ctx->root_box != NULL)
                     box_free(ctx->root_box);
-                free(ctx);
-                NSLOG(wisp, DEBUG, "PROFILER: STOP Box construction slice %p", ctx);
+                box_construct_ctx_destroy(ctx);
                 return;
             }
 
@@ -1770,12 +1851,13 @@ static void convert_xml_to_box(void *p)
                 ctx->n = next;
                 if (box_construct_text(ctx) == false) {
                     NSLOG(wisp, WARNING, "box_construct_text failed");
+                    phase_leave(previous);
+                    TRACE_END("html", "box construction slice");
                     ctx->cb(ctx->content, false);
                     dom_node_unref(ctx->n);
                     if (ctx->root_box != NULL)
                         box_free(ctx->root_box);
-                    free(ctx);
-                    NSLOG(wisp, DEBUG, "PROFILER: STOP Box construction slice %p", ctx);
+                    box_construct_ctx_destroy(ctx);
                     return;
                 }
             }
@@ -1799,6 +1881,8 @@ static void convert_xml_to_box(void *p)
             /** \todo Remove box_normalise_block */
             if (box_normalise_block(&root, ctx->root_box, (struct html_content *)ctx->content) == false) {
                 NSLOG(wisp, WARNING, "box_normalise_block failed");
+                phase_leave(previous);
+                TRACE_END("html", "box construction slice");
                 ctx->cb(ctx->content, false);
                 if (ctx->root_box != NULL)
                     box_free(ctx->root_box);
@@ -1806,13 +1890,14 @@ static void convert_xml_to_box(void *p)
                 ctx->content->layout = root.children;
                 ctx->content->layout->parent = NULL;
 
+                phase_leave(previous);
+                TRACE_END("html", "box construction slice");
                 ctx->cb(ctx->content, true);
             }
 
             assert(ctx->n == NULL);
 
-            free(ctx);
-            NSLOG(wisp, DEBUG, "PROFILER: STOP Box construction slice %p", ctx);
+            box_construct_ctx_destroy(ctx);
             return;
         }
 
@@ -1826,7 +1911,8 @@ static void convert_xml_to_box(void *p)
         }
     } while (true);
 
-    NSLOG(wisp, DEBUG, "PROFILER: STOP Box construction slice %p", ctx);
+    phase_leave(previous);
+    TRACE_END("html", "box construction slice");
     /* More work to do: schedule a continuation */
     guit->misc->schedule(0, (void *)convert_xml_to_box, ctx);
 }
@@ -1840,8 +1926,8 @@ nserror dom_to_box(dom_node *n, html_content *c, box_construct_complete_cb cb, v
     assert(box_conversion_context != NULL);
 
     if (c->bctx == NULL) {
-        /* create a context allocation for this box tree */
-        c->bctx = talloc_zero(0, int);
+        /* create a pool allocation for this box tree */
+        c->bctx = talloc_pool(NULL, BOX_POOL_SIZE);
         if (c->bctx == NULL) {
             return NSERROR_NOMEM;
         }
@@ -1857,6 +1943,7 @@ nserror dom_to_box(dom_node *n, html_content *c, box_construct_complete_cb cb, v
     ctx->root_box = NULL;
     ctx->cb = cb;
     ctx->bctx = c->bctx;
+    memset(ctx->inline_styles, 0, sizeof(ctx->inline_styles));
 
     *box_conversion_context = ctx;
 
@@ -1876,7 +1963,7 @@ nserror cancel_dom_to_box(void *box_conversion_context)
     }
 
     dom_node_unref(ctx->n);
-    free(ctx);
+    box_construct_ctx_destroy(ctx);
 
     return NSERROR_OK;
 }
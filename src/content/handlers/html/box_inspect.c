@@ -608,7 +608,7 @@ struct box *box_find_by_id(struct box *box, lwc_string *id)
     struct box *a, *b;
     bool m;
 
-    if (box->id != NULL && lwc_string_isequal(id, box->id, &m) == lwc_error_ok && m == true) {
+    if (box_extra(box)->id != NULL && lwc_string_isequal(id, box_extra(box)->id, &m) == lwc_error_ok && m == true) {
         return box;
     }
 
@@ -734,21 +734,21 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
     if (box->object) {
         fprintf(stream, "(object '%s') ", nsurl_access(hlcache_handle_get_url(box->object)));
     }
-    if (box->iframe) {
+    if (box_extra(box)->iframe) {
         fprintf(stream, "(iframe) ");
     }
-    if (box->gadget)
+    if (box_extra(box)->gadget)
         fprintf(stream, "(gadget) ");
     if (style && box->style)
         nscss_dump_computed_style(stream, box->style);
-    if (box->href)
-        fprintf(stream, " -> '%s'", nsurl_access(box->href));
-    if (box->target)
-        fprintf(stream, " |%s|", box->target);
-    if (box->title)
-        fprintf(stream, " [%s]", box->title);
-    if (box->id)
-        fprintf(stream, " ID:%s", lwc_string_data(box->id));
+    if (box_extra(box)->href)
+        fprintf(stream, " -> '%s'", nsurl_access(box_extra(box)->href));
+    if (box_extra(box)->target)
+        fprintf(stream, " |%s|", box_extra(box)->target);
+    if (box_extra(box)->title)
+        fprintf(stream, " [%s]", box_extra(box)->title);
+    if (box_extra(box)->id)
+        fprintf(stream, " ID:%s", lwc_string_data(box_extra(box)->id));
     if (box->type == BOX_INLINE || box->type == BOX_INLINE_END)
         fprintf(stream, " inline_end %p", box->inline_end);
     if (box->float_children)
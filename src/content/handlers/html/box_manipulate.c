@@ -35,6 +35,7 @@
 #include <wisp/utils/log.h>
 #include <wisp/utils/nsurl.h>
 #include "utils/talloc.h"
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -43,6 +44,7 @@
 #include <wisp/content/handlers/html/interaction.h>
 #include <wisp/content/handlers/html/private.h>
 #include "content/handlers/html/box_manipulate.h"
+#include "content/handlers/html/stacking.h"
 
 
 /**
@@ -66,17 +68,24 @@ static int box_talloc_destructor(void *ptr)
         b->styles = NULL;
     }
 
-    if (!(b->flags & CLONE) && b->href != NULL)
-        nsurl_unref(b->href);
+    /* clones share the rarely used data of the box they were made from */
+    if (!(b->flags & CLONE) && b->extra != NULL) {
+        if (b->extra->href != NULL)
+            nsurl_unref(b->extra->href);
 
-    if (!(b->flags & CLONE) && b->id != NULL) {
-        lwc_string_unref(b->id);
+        if (b->extra->id != NULL)
+            lwc_string_unref(b->extra->id);
     }
 
     if (!(b->flags & CLONE) && b->node != NULL) {
         dom_node_unref(b->node);
     }
 
+    if (!(b->flags & CLONE)) {
+        free(b->flex_cache);
+        stacking_node_destroy(b->stacking);
+    }
+
     if (b->scroll_x != NULL) {
         data = scrollbar_get_data(b->scroll_x);
         scrollbar_destroy(b->scroll_x);
@@ -89,9 +98,9 @@ static int box_talloc_destructor(void *ptr)
         free(data);
     }
 
-    if (!(b->flags & CLONE) && b->gadget != NULL) {
-        form_free_control(b->gadget);
-        b->gadget = NULL;
+    if (!(b->flags & CLONE) && b->extra != NULL && b->extra->gadget != NULL) {
+        form_free_control(b->extra->gadget);
+        b->extra->gadget = NULL;
     }
 
 
@@ -111,6 +120,12 @@ struct box *box_create(css_select_results *styles, css_computed_style *style, bo
         return 0;
     }
 
+    box->extra = NULL;
+    if ((href != NULL || target != NULL || title != NULL || id != NULL) && box_extra_alloc(box) == NULL) {
+        talloc_free(box);
+        return 0;
+    }
+
     talloc_set_destructor(box, (int (*)(struct box *))box_talloc_destructor);
 
     box->type = BOX_INLINE;
@@ -132,9 +147,6 @@ struct box *box_create(css_select_results *styles, css_computed_style *style, bo
     box->text = NULL;
     box->length = 0;
     box->space = 0;
-    box->href = (href == NULL) ? NULL : nsurl_ref(href);
-    box->target = target;
-    box->title = title;
     box->columns = 1;
     box->rows = 1;
     box->start_column = 0;
@@ -147,24 +159,39 @@ struct box *box_create(css_select_results *styles, css_computed_style *style, bo
     box->float_children = NULL;
     box->float_container = NULL;
     box->abs_containing_block = NULL;
+    box->flex_cache = NULL;
+    box->stacking = NULL;
     box->next_float = NULL;
     box->cached_place_below_level = 0;
     box->list_value = 1;
     box->list_marker = NULL;
     box->col = NULL;
-    box->gadget = NULL;
-    box->usemap = NULL;
-    box->id = id;
     box->background = NULL;
     box->object = NULL;
-    box->object_params = NULL;
-    box->iframe = NULL;
     box->node = NULL;
 
+    if (box->extra != NULL) {
+        box->extra->href = (href == NULL) ? NULL : nsurl_ref(href);
+        box->extra->target = target;
+        box->extra->title = title;
+        box->extra->id = id;
+    }
+
     return box;
 }
 
 
+/* Exported function documented in html/box_manipulate.h */
+struct box_extra *box_extra_alloc(struct box *box)
+{
+    if (box->extra == NULL) {
+        box->extra = talloc_zero(box, struct box_extra);
+    }
+
+    return box->extra;
+}
+
+
 /* Exported function documented in html/box.h */
 void box_add_child(struct box *parent, struct box *child)
 {
@@ -274,8 +301,8 @@ void box_free(struct box *box)
 void box_free_box(struct box *box)
 {
     if (!(box->flags & CLONE)) {
-        if (box->gadget)
-            form_free_control(box->gadget);
+        if (box_extra(box)->gadget)
+            form_free_control(box_extra(box)->gadget);
         if (box->scroll_x != NULL)
             scrollbar_destroy(box->scroll_x);
         if (box->scroll_y != NULL)
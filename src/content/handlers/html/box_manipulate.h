@@ -46,6 +46,17 @@ struct box *box_create(css_select_results *styles, css_computed_style *style, bo
     const char *target, const char *title, lwc_string *id, void *context);
 
 
+/**
+ * Get the rarely used data of a box for changing it.
+ *
+ * The data is allocated the first time it is needed and freed with the box.
+ *
+ * \param  box  box to get the data of
+ * \return  the box's data, or NULL on memory exhaustion
+ */
+struct box_extra *box_extra_alloc(struct box *box);
+
+
 /**
  * Add a child to a box tree node.
  *
@@ -196,7 +196,7 @@ static bool box_normalise_table_row(struct box *row, const struct box *root, str
             if (style == NULL)
                 return false;
 
-            cell = box_create(NULL, style, true, row->href, row->target, NULL, NULL, c->bctx);
+            cell = box_create(NULL, style, true, box_extra(row)->href, box_extra(row)->target, NULL, NULL, c->bctx);
             if (cell == NULL) {
                 css_computed_style_destroy(style);
                 return false;
@@ -327,7 +327,8 @@ box_normalise_table_row_group(struct box *row_group, const struct box *root, str
             if (style == NULL)
                 return false;
 
-            row = box_create(NULL, style, true, row_group->href, row_group->target, NULL, NULL, c->bctx);
+            row = box_create(
+                NULL, style, true, box_extra(row_group)->href, box_extra(row_group)->target, NULL, NULL, c->bctx);
             if (row == NULL) {
                 css_computed_style_destroy(style);
                 return false;
@@ -401,7 +402,8 @@ box_normalise_table_row_group(struct box *row_group, const struct box *root, str
             return false;
         }
 
-        row = box_create(NULL, style, true, row_group->href, row_group->target, NULL, NULL, c->bctx);
+        row = box_create(
+            NULL, style, true, box_extra(row_group)->href, box_extra(row_group)->target, NULL, NULL, c->bctx);
         if (row == NULL) {
             css_computed_style_destroy(style);
             return false;
@@ -515,7 +517,8 @@ box_normalise_table_spans(struct box *table, const struct box *root, struct span
                     if (style == NULL)
                         return false;
 
-                    cell = box_create(NULL, style, true, table_row->href, table_row->target, NULL, NULL, c->bctx);
+                    cell = box_create(NULL, style, true, box_extra(table_row)->href, box_extra(table_row)->target, NULL,
+                        NULL, c->bctx);
                     if (cell == NULL) {
                         css_computed_style_destroy(style);
                         return false;
@@ -632,7 +635,8 @@ static bool box_normalise_table(struct box *table, const struct box *root, html_
                 return false;
             }
 
-            row_group = box_create(NULL, style, true, table->href, table->target, NULL, NULL, c->bctx);
+            row_group = box_create(
+                NULL, style, true, box_extra(table)->href, box_extra(table)->target, NULL, NULL, c->bctx);
             if (row_group == NULL) {
                 css_computed_style_destroy(style);
                 free(col_info.spans);
@@ -716,7 +720,8 @@ static bool box_normalise_table(struct box *table, const struct box *root, html_
             return false;
         }
 
-        row_group = box_create(NULL, style, true, table->href, table->target, NULL, NULL, c->bctx);
+        row_group = box_create(
+            NULL, style, true, box_extra(table)->href, box_extra(table)->target, NULL, NULL, c->bctx);
         if (row_group == NULL) {
             css_computed_style_destroy(style);
             free(col_info.spans);
@@ -731,7 +736,8 @@ static bool box_normalise_table(struct box *table, const struct box *root, html_
             return false;
         }
 
-        row = box_create(NULL, style, true, row_group->href, row_group->target, NULL, NULL, c->bctx);
+        row = box_create(
+            NULL, style, true, box_extra(row_group)->href, box_extra(row_group)->target, NULL, NULL, c->bctx);
         if (row == NULL) {
             css_computed_style_destroy(style);
             box_free(row_group);
@@ -826,8 +832,8 @@ static bool box_normalise_flex(struct box *flex_container, const struct box *roo
             if (style == NULL)
                 return false;
 
-            implied_flex_item = box_create(
-                NULL, style, true, flex_container->href, flex_container->target, NULL, NULL, c->bctx);
+            implied_flex_item = box_create(NULL, style, true, box_extra(flex_container)->href,
+                box_extra(flex_container)->target, NULL, NULL, c->bctx);
             if (implied_flex_item == NULL) {
                 css_computed_style_destroy(style);
                 return false;
@@ -893,8 +899,8 @@ static bool box_normalise_flex(struct box *flex_container, const struct box *roo
             if (style == NULL)
                 return false;
 
-            implied_flex_item = box_create(
-                NULL, style, true, flex_container->href, flex_container->target, NULL, NULL, c->bctx);
+            implied_flex_item = box_create(NULL, style, true, box_extra(flex_container)->href,
+                box_extra(flex_container)->target, NULL, NULL, c->bctx);
             if (implied_flex_item == NULL) {
                 css_computed_style_destroy(style);
                 return false;
@@ -992,8 +998,8 @@ static bool box_normalise_grid(struct box *grid_container, const struct box *roo
             if (style == NULL)
                 return false;
 
-            implied_grid_item = box_create(
-                NULL, style, true, grid_container->href, grid_container->target, NULL, NULL, c->bctx);
+            implied_grid_item = box_create(NULL, style, true, box_extra(grid_container)->href,
+                box_extra(grid_container)->target, NULL, NULL, c->bctx);
             if (implied_grid_item == NULL) {
                 css_computed_style_destroy(style);
                 return false;
@@ -1086,8 +1092,8 @@ static bool box_normalise_grid(struct box *grid_container, const struct box *roo
             if (style == NULL)
                 return false;
 
-            implied_grid_item = box_create(
-                NULL, style, true, grid_container->href, grid_container->target, NULL, NULL, c->bctx);
+            implied_grid_item = box_create(NULL, style, true, box_extra(grid_container)->href,
+                box_extra(grid_container)->target, NULL, NULL, c->bctx);
             if (implied_grid_item == NULL) {
                 css_computed_style_destroy(style);
                 return false;
@@ -1365,7 +1371,8 @@ bool box_normalise_block(struct box *block, const struct box *root, html_content
             if (style == NULL)
                 return false;
 
-            table = box_create(NULL, style, true, block->href, block->target, NULL, NULL, c->bctx);
+            table = box_create(
+                NULL, style, true, box_extra(block)->href, box_extra(block)->target, NULL, NULL, c->bctx);
             if (table == NULL) {
                 css_computed_style_destroy(style);
                 return false;
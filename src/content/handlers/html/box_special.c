@@ -560,7 +560,7 @@ static bool box_input_text(html_content *html, struct box *box, struct dom_node
     if (!inline_container)
         return false;
     inline_container->type = BOX_INLINE_CONTAINER;
-    inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0, html->bctx);
+    inline_box = box_create(NULL, box->style, false, 0, 0, box_extra(box)->title, 0, html->bctx);
     if (!inline_box)
         return false;
     inline_box->type = BOX_TEXT;
@@ -668,6 +668,11 @@ static bool box_a(dom_node *n, html_content *content, struct box *box, bool *con
     nsurl *url;
     dom_string *s;
     dom_exception err;
+    struct box_extra *extra;
+
+    extra = box_extra_alloc(box);
+    if (extra == NULL)
+        return false;
 
     err = dom_element_get_attribute(n, corestring_dom_href, &s);
     if (err == DOM_NO_ERR && s != NULL) {
@@ -676,9 +681,9 @@ static bool box_a(dom_node *n, html_content *content, struct box *box, bool *con
         if (!ok)
             return false;
         if (url) {
-            if (box->href != NULL)
-                nsurl_unref(box->href);
-            box->href = url;
+            if (extra->href != NULL)
+                nsurl_unref(extra->href);
+            extra->href = url;
         }
     }
 
@@ -694,10 +699,10 @@ static bool box_a(dom_node *n, html_content *content, struct box *box, bool *con
         if (err == DOM_NO_ERR) {
             /* name replaces existing id
              * TODO: really? */
-            if (box->id != NULL)
-                lwc_string_unref(box->id);
+            if (extra->id != NULL)
+                lwc_string_unref(extra->id);
 
-            box->id = lwc_name;
+            extra->id = lwc_name;
         }
     }
 
@@ -705,20 +710,20 @@ static bool box_a(dom_node *n, html_content *content, struct box *box, bool *con
     err = dom_element_get_attribute(n, corestring_dom_target, &s);
     if (err == DOM_NO_ERR && s != NULL) {
         if (dom_string_caseless_lwc_isequal(s, corestring_lwc__blank))
-            box->target = "_blank";
+            extra->target = "_blank";
         else if (dom_string_caseless_lwc_isequal(s, corestring_lwc__top))
-            box->target = "_top";
+            extra->target = "_top";
         else if (dom_string_caseless_lwc_isequal(s, corestring_lwc__parent))
-            box->target = "_parent";
+            extra->target = "_parent";
         else if (dom_string_caseless_lwc_isequal(s, corestring_lwc__self))
             /* the default may have been overridden by a
              * <base target=...>, so this is different to 0 */
-            box->target = "_self";
+            extra->target = "_self";
         else {
             /* 6.16 says that frame names must begin with [a-zA-Z]
              * This doesn't match reality, so just take anything */
-            box->target = talloc_strdup(content->bctx, dom_string_data(s));
-            if (!box->target) {
+            extra->target = talloc_strdup(content->bctx, dom_string_data(s));
+            if (!extra->target) {
                 dom_string_unref(s);
                 return false;
             }
@@ -770,7 +775,9 @@ static bool box_button(dom_node *n, html_content *content, struct box *box, bool
         return false;
 
     gadget->html = content;
-    box->gadget = gadget;
+    if (box_extra_alloc(box) == NULL)
+        return false;
+    box->extra->gadget = gadget;
     box->flags |= IS_REPLACED;
     gadget->box = box;
 
@@ -923,7 +930,9 @@ static bool box_embed(dom_node *n, html_content *content, struct box *box, bool
 
     dom_namednodemap_unref(attrs);
 
-    box->object_params = params;
+    if (box_extra_alloc(box) == NULL)
+        return false;
+    box->extra->object_params = params;
 
     /* start fetch */
     box->flags |= IS_REPLACED;
@@ -1004,6 +1013,12 @@ static bool box_iframe(dom_node *n, html_content *content, struct box *box, bool
         return true;
     }
 
+    /* the browser window for the iframe is recorded in the box */
+    if (box_extra_alloc(box) == NULL) {
+        nsurl_unref(url);
+        return false;
+    }
+
     /* create a new iframe */
     iframe = talloc(content->bctx, struct content_html_iframe);
     if (iframe == NULL) {
@@ -1298,10 +1313,12 @@ static bool box_image(dom_node *n, html_content *content, struct box *box, bool
     }
 
     /* imagemap associated with this image */
-    if (!box_get_attribute(n, "usemap", content->bctx, &box->usemap))
+    if (box_extra_alloc(box) == NULL)
         return false;
-    if (box->usemap && box->usemap[0] == '#')
-        box->usemap++;
+    if (!box_get_attribute(n, "usemap", content->bctx, &box->extra->usemap))
+        return false;
+    if (box->extra->usemap && box->extra->usemap[0] == '#')
+        box->extra->usemap++;
 
     /* Try srcset first for responsive image selection */
     url = NULL;
@@ -1365,7 +1382,9 @@ static bool box_input(dom_node *n, html_content *content, struct box *box, bool
         return false;
     }
 
-    box->gadget = gadget;
+    if (box_extra_alloc(box) == NULL)
+        return false;
+    box->extra->gadget = gadget;
     box->flags |= IS_REPLACED;
     gadget->box = box;
     gadget->html = content;
@@ -1409,17 +1428,17 @@ static bool box_input(dom_node *n, html_content *content, struct box *box, bool
 
         inline_container->type = BOX_INLINE_CONTAINER;
 
-        inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0, content->bctx);
+        inline_box = box_create(NULL, box->style, false, 0, 0, box_extra(box)->title, 0, content->bctx);
         if (inline_box == NULL)
             goto no_memory;
 
         inline_box->type = BOX_TEXT;
 
-        if (box->gadget->value != NULL)
-            inline_box->text = talloc_strdup(content->bctx, box->gadget->value);
-        else if (box->gadget->type == GADGET_SUBMIT)
+        if (box_extra(box)->gadget->value != NULL)
+            inline_box->text = talloc_strdup(content->bctx, box_extra(box)->gadget->value);
+        else if (box_extra(box)->gadget->type == GADGET_SUBMIT)
             inline_box->text = talloc_strdup(content->bctx, messages_get("Form_Submit"));
-        else if (box->gadget->type == GADGET_RESET)
+        else if (box_extra(box)->gadget->type == GADGET_RESET)
             inline_box->text = talloc_strdup(content->bctx, messages_get("Form_Reset"));
         else
             inline_box->text = talloc_strdup(content->bctx, "Button");
@@ -1506,10 +1525,12 @@ static bool box_object(dom_node *n, html_content *content, struct box *box, bool
     if (box->style && ns_computed_display(box->style, box_is_root(n)) == CSS_DISPLAY_NONE)
         return true;
 
-    if (box_get_attribute(n, "usemap", content->bctx, &box->usemap) == false)
+    if (box_extra_alloc(box) == NULL)
         return false;
-    if (box->usemap && box->usemap[0] == '#')
-        box->usemap++;
+    if (box_get_attribute(n, "usemap", content->bctx, &box->extra->usemap) == false)
+        return false;
+    if (box->extra->usemap && box->extra->usemap[0] == '#')
+        box->extra->usemap++;
 
     params = talloc(content->bctx, struct object_params);
     if (params == NULL)
@@ -1697,7 +1718,9 @@ static bool box_object(dom_node *n, html_content *content, struct box *box, bool
         c = next;
     }
 
-    box->object_params = params;
+    if (box_extra_alloc(box) == NULL)
+        return false;
+    box->extra->object_params = params;
 
     /* start fetch (MIME type is ok or not specified) */
     box->flags |= IS_REPLACED;
@@ -1826,8 +1849,12 @@ static bool box_select(dom_node *n, html_content *content, struct box *box, bool
         return true;
     }
 
+    if (box_extra_alloc(box) == NULL) {
+        form_free_control(gadget);
+        return false;
+    }
     box->type = BOX_INLINE_BLOCK;
-    box->gadget = gadget;
+    box->extra->gadget = gadget;
     box->flags |= IS_REPLACED;
     gadget->box = box;
 
@@ -1835,7 +1862,7 @@ static bool box_select(dom_node *n, html_content *content, struct box *box, bool
     if (inline_container == NULL)
         goto no_memory;
     inline_container->type = BOX_INLINE_CONTAINER;
-    inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0, content->bctx);
+    inline_box = box_create(NULL, box->style, false, 0, 0, box_extra(box)->title, 0, content->bctx);
     if (inline_box == NULL)
         goto no_memory;
     inline_box->type = BOX_TEXT;
@@ -1874,13 +1901,15 @@ no_memory:
 static bool box_textarea(dom_node *n, html_content *content, struct box *box, bool *convert_children)
 {
     /* Get the form_control for the DOM node */
-    box->gadget = html_forms_get_control_for_node(content->forms, n);
-    if (box->gadget == NULL)
+    if (box_extra_alloc(box) == NULL)
+        return false;
+    box->extra->gadget = html_forms_get_control_for_node(content->forms, n);
+    if (box->extra->gadget == NULL)
         return false;
 
     box->flags |= IS_REPLACED;
-    box->gadget->html = content;
-    box->gadget->box = box;
+    box_extra(box)->gadget->html = content;
+    box_extra(box)->gadget->box = box;
 
     if (!box_input_text(content, box, n))
         return false;
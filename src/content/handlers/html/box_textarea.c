@@ -42,9 +42,9 @@
 
 nserror box_textarea_keypress(html_content *html, struct box *box, uint32_t key)
 {
-    struct form_control *gadget = box->gadget;
+    struct form_control *gadget = box_extra(box)->gadget;
     struct textarea *ta = gadget->data.text.ta;
-    struct form *form = box->gadget->form;
+    struct form *form = box_extra(box)->gadget->form;
     struct content *c = (struct content *)html;
     nserror res = NSERROR_OK;
 
@@ -230,7 +230,7 @@ bool box_textarea_create_textarea(html_content *html, struct box *box, struct do
     };
     bool read_only = false;
     bool disabled = false;
-    struct form_control *gadget = box->gadget;
+    struct form_control *gadget = box_extra(box)->gadget;
     const char *text;
 
     assert(gadget != NULL);
@@ -25,6 +25,9 @@
 #include <string.h>
 
 #include <wisp/content/content.h>
+#include <wisp/content/fetch.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/misc.h>
 #include <wisp/utils/ascii.h>
 #include <wisp/utils/config.h>
 #include <wisp/utils/corestrings.h>
@@ -140,6 +143,34 @@ static bool html_process_inserted_img(html_content *htmlc, dom_node *node)
 }
 
 
+/**
+ * Act on resource hints in a link relation
+ *
+ * The host of a dns-prefetch, preconnect or preload hint is resolved
+ * ahead of fetches from it. No connection is opened for preconnect hints,
+ * as the fetcher could not reuse it, and preload hints fetch nothing.
+ * Hints for the document's own origin are ignored as its host is known.
+ *
+ * \param c The html content containing the link
+ * \param rel The link relation
+ * \param href The link target
+ */
+static void html_process_resource_hint(html_content *c, lwc_string *rel, nsurl *href)
+{
+    const char *rel_s = lwc_string_data(rel);
+
+    if (nsoption_bool(dns_prefetch) == false ||
+        nsurl_compare(href, content_get_url(&c->base), NSURL_SCHEME | NSURL_HOST | NSURL_PORT)) {
+        return;
+    }
+
+    if ((strcasestr(rel_s, "dns-prefetch") != NULL) || (strcasestr(rel_s, "preconnect") != NULL) ||
+        (strcasestr(rel_s, "preload") != NULL)) {
+        fetch_prefetch_dns(href);
+    }
+}
+
+
 /**
  * process a LINK element being inserted into the DOM
  *
@@ -190,6 +221,8 @@ static bool html_process_inserted_link(html_content *c, dom_node *node)
         return false;
     }
 
+    html_process_resource_hint(c, link.rel, link.href);
+
     /* look for optional properties -- we don't care if internment fails */
 
     exc = dom_element_get_attribute(node, corestring_dom_hreflang, &atr_string);
@@ -561,10 +594,10 @@ static void html_texty_element_update(html_content *htmlc, dom_node *node)
     if (box == NULL) {
         return; /* No Box (yet?) so no gadget to update */
     }
-    if (box->gadget == NULL) {
+    if (box_extra(box)->gadget == NULL) {
         return; /* No gadget yet (under construction perhaps?) */
     }
-    form_gadget_sync_with_dom(box->gadget);
+    form_gadget_sync_with_dom(box_extra(box)->gadget);
     /* And schedule a redraw for the box */
     html__redraw_a_box(htmlc, box);
 }
@@ -685,53 +718,107 @@ static void dom_default_action_DOMNodeInsertedIntoDocument_cb(struct dom_event *
 
 
 /**
- * callback for DOMSubtreeModified end type
+ * Deal with the content of a node having been modified.
+ *
+ * \param htmlc The html content containing the DOM
+ * \param node The DOM node whose children, attributes or text changed
  */
-static void dom_default_action_DOMSubtreeModified_cb(struct dom_event *evt, void *pw)
+static void html_process_modified_node(html_content *htmlc, dom_node *node)
 {
-    dom_event_target *node;
     dom_node_type type;
     dom_exception exc;
-    html_content *htmlc = pw;
 
-    exc = dom_event_get_target(evt, &node);
-    if ((exc == DOM_NO_ERR) && (node != NULL)) {
-        if (htmlc->title == (dom_node *)node) {
-            /* Node is our title node */
-            html_process_title(htmlc, (dom_node *)node);
-            dom_node_unref(node);
-            return;
-        }
+    if (htmlc->title == node) {
+        /* Node is our title node */
+        html_process_title(htmlc, node);
+        return;
+    }
 
-        exc = dom_node_get_node_type(node, &type);
-        if ((exc == DOM_NO_ERR) && (type == DOM_ELEMENT_NODE)) {
-            /* an element node has been modified */
-            dom_html_element_type tag_type;
+    exc = dom_node_get_node_type(node, &type);
+    if ((exc == DOM_NO_ERR) && (type == DOM_ELEMENT_NODE)) {
+        /* an element node has been modified */
+        dom_html_element_type tag_type;
 
-            exc = dom_html_element_get_tag_type(node, &tag_type);
-            if (exc != DOM_NO_ERR) {
-                tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
+        exc = dom_html_element_get_tag_type(node, &tag_type);
+        if (exc != DOM_NO_ERR) {
+            tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
+        }
+
+        switch (tag_type) {
+        case DOM_HTML_ELEMENT_TYPE_STYLE:
+            if (nsoption_bool(author_level_css)) {
+                html_css_update_style(htmlc, node);
             }
+            break;
+        case DOM_HTML_ELEMENT_TYPE_TEXTAREA:
+        case DOM_HTML_ELEMENT_TYPE_INPUT:
+            html_texty_element_update(htmlc, node);
+            [[fallthrough]];
+        default:
+            break;
+        }
+    }
+}
 
-            switch (tag_type) {
-            case DOM_HTML_ELEMENT_TYPE_STYLE:
-                if (nsoption_bool(author_level_css)) {
-                    html_css_update_style(htmlc, (dom_node *)node);
-                }
-                break;
-            case DOM_HTML_ELEMENT_TYPE_TEXTAREA:
-            case DOM_HTML_ELEMENT_TYPE_INPUT:
-                html_texty_element_update(htmlc, (dom_node *)node);
-                [[fallthrough]];
-            default:
-                break;
+
+/**
+ * callback receiving a batch of DOM mutation records
+ *
+ * Replaces a DOMSubtreeModified default action per change. Each modified
+ * node is processed once per run of records naming it, with the node in
+ * its state at the end of the batch.
+ */
+static void html_dom_mutation_records_cb(dom_document *doc, const dom_mutation_record *rec, uint32_t count, void *pw)
+{
+    html_content *htmlc = pw;
+    dom_node *previous = NULL;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        dom_node *node;
+
+        if (rec[i].type == DOM_MUTATION_RECORD_CHARACTER_DATA) {
+            /* the text changed, its parent element is what cares */
+            if (dom_node_get_parent_node(rec[i].target, &node) != DOM_NO_ERR || node == NULL) {
+                continue;
             }
+            /* the record holds a reference to the text node which
+             * holds its parent alive */
+            dom_node_unref(node);
+        } else {
+            node = rec[i].target;
         }
-        dom_node_unref(node);
+
+        if (node != previous) {
+            html_process_modified_node(htmlc, node);
+            previous = node;
+        }
+    }
+}
+
+
+/**
+ * scheduled callback delivering the pending DOM mutation records
+ */
+static void html_dom_mutation_checkpoint_cb(void *pw)
+{
+    html_content *htmlc = pw;
+
+    if (htmlc->document != NULL) {
+        dom_document_flush_mutation_records(htmlc->document);
     }
 }
 
 
+/**
+ * callback for the first DOM mutation record of a batch being queued
+ */
+static void html_dom_mutation_pending_cb(dom_document *doc, void *pw)
+{
+    guit->misc->schedule(0, html_dom_mutation_checkpoint_cb, pw);
+}
+
+
 /**
  * callback for default action finished
  */
@@ -744,7 +831,7 @@ static void dom_default_action_finished_cb(struct dom_event *evt, void *pw)
 }
 
 
-/* exported interface documented in html/dom_event.c */
+/* exported interface documented in html/dom_event.h */
 dom_default_action_callback html_dom_event_fetcher(dom_string *type, dom_default_action_phase phase, void **pw)
 {
     NSLOG(wisp, DEEPDEBUG, "phase:%d type:%s", phase, dom_string_data(type));
@@ -754,11 +841,42 @@ dom_default_action_callback html_dom_event_fetcher(dom_string *type, dom_default
             return dom_default_action_DOMNodeInserted_cb;
         } else if (dom_string_isequal(type, corestring_dom_DOMNodeInsertedIntoDocument)) {
             return dom_default_action_DOMNodeInsertedIntoDocument_cb;
-        } else if (dom_string_isequal(type, corestring_dom_DOMSubtreeModified)) {
-            return dom_default_action_DOMSubtreeModified_cb;
         }
     } else if (phase == DOM_DEFAULT_ACTION_FINISHED) {
         return dom_default_action_finished_cb;
     }
     return NULL;
 }
+
+
+/* exported interface documented in html/dom_event.h */
+nserror html_dom_mutation_observe(html_content *htmlc)
+{
+    dom_exception exc;
+
+    exc = dom_document_set_mutation_observer(
+        htmlc->document, html_dom_mutation_records_cb, html_dom_mutation_pending_cb, htmlc);
+    if (exc != DOM_NO_ERR) {
+        return NSERROR_DOM;
+    }
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/dom_event.h */
+void html_dom_mutation_unobserve(html_content *htmlc)
+{
+    guit->misc->schedule(-1, html_dom_mutation_checkpoint_cb, htmlc);
+
+    if (htmlc->document != NULL) {
+        dom_document_set_mutation_observer(htmlc->document, NULL, NULL, NULL);
+    }
+}
+
+
+/* exported interface documented in html/dom_event.h */
+void html_dom_mutation_checkpoint(html_content *htmlc)
+{
+    guit->misc->schedule(-1, html_dom_mutation_checkpoint_cb, htmlc);
+    html_dom_mutation_checkpoint_cb(htmlc);
+}
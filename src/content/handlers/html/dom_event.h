@@ -31,13 +31,41 @@
  * dom_default_action_phase from events/document_event.h
  *
  * The principle events are:
- *   DOMSubtreeModified
- *   DOMAttrModified
  *   DOMNodeInserted
  *   DOMNodeInsertedIntoDocument
  *
+ * Modifications to existing nodes are delivered in batches of mutation
+ * records instead, see html_dom_mutation_observe().
+ *
  * @return callback function pointer or NULL for none
  */
 dom_default_action_callback html_dom_event_fetcher(dom_string *type, dom_default_action_phase phase, void **pw);
 
+/**
+ * Start observing the mutation records of an html content's document
+ *
+ * Records are delivered from a scheduled callback soon after the first one
+ * of a batch is queued, or by html_dom_mutation_checkpoint().
+ *
+ * \param htmlc The html content whose document is observed
+ * \return NSERROR_OK on success else appropriate error code
+ */
+nserror html_dom_mutation_observe(struct html_content *htmlc);
+
+/**
+ * Stop observing the mutation records of an html content's document
+ *
+ * Any records not yet delivered are discarded.
+ *
+ * \param htmlc The html content whose document is observed
+ */
+void html_dom_mutation_unobserve(struct html_content *htmlc);
+
+/**
+ * Deliver the pending mutation records of an html content's document now
+ *
+ * \param htmlc The html content whose document is observed
+ */
+void html_dom_mutation_checkpoint(struct html_content *htmlc);
+
 #endif
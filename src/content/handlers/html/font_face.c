@@ -21,6 +21,7 @@
  * Web font (font-face) loading implementation.
  */
 
+#include <nsutils/time.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,25 +33,43 @@
 #include <wisp/content/llcache.h>
 #include <wisp/desktop/gui_internal.h>
 #include <wisp/layout.h>
+#include <wisp/misc.h>
 #include <wisp/wisp.h>
 #include <wisp/utils/errors.h>
 #include <wisp/utils/log.h>
 #include <wisp/utils/nsurl.h>
 
 #include "content/handlers/html/font_face.h"
+#include "content/handlers/html/object.h"
+#include "desktop/measure_cache.h"
 
-/** Maximum number of concurrent font downloads */
-#define MAX_FONT_DOWNLOADS 32
+/** Block period for font-display auto and block (ms) */
+static const uint64_t font_block_period_long = 3000;
+
+/** Block period for font-display fallback and optional (ms) */
+static const uint64_t font_block_period_short = 100;
+
+/** Swap period for font-display fallback (ms) */
+static const uint64_t font_swap_period_fallback = 3000;
+
+/** A content using a face which is still downloading */
+struct font_waiter {
+    struct html_content *c;
+    struct font_waiter *next;
+};
 
 /** Structure to track a font download */
 struct font_download {
     struct font_variant_id variant;
     llcache_handle *handle; /**< Fetch handle */
-    bool in_use; /**< Whether this slot is in use */
+    css_font_display display; /**< font-display policy of the face */
+    uint64_t start_ms; /**< Monotonic time the fetch was started */
+    struct font_waiter *waiters; /**< Contents using this face */
+    struct font_download *next;
 };
 
-/** Global array of font downloads */
-static struct font_download font_downloads[MAX_FONT_DOWNLOADS];
+/** List of in-progress font downloads */
+static struct font_download *font_downloads = NULL;
 
 /** Set of loaded font variants (simple linked list) */
 struct loaded_font {
@@ -60,35 +79,127 @@ struct loaded_font {
 
 static struct loaded_font *loaded_fonts = NULL;
 
-/** Count of pending font downloads */
-static int pending_font_count = 0;
-
-/** Callback to invoke when all fonts finish downloading */
-static html_font_face_done_cb font_done_callback = NULL;
-
-/** Current HTML content waiting for fonts (for proceed_to_done callback) */
-static struct html_content *font_waiting_content = NULL;
-
 /* Forward declaration */
 extern void html_finish_conversion(struct html_content *htmlc);
 
 /**
- * Check if all fonts have finished and invoke callback if set.
+ * Get the block period of a font-display policy.
+ *
+ * During the block period text using the face is held back so the
+ * content does not lay out with fallback fonts.
  */
-static void check_fonts_done(void)
+static uint64_t font_display_block_period(css_font_display display)
 {
-    if (pending_font_count == 0 && font_done_callback != NULL) {
-        NSLOG(wisp, INFO, "All font downloads complete, invoking callback");
-        font_done_callback();
+    switch (display) {
+    case CSS_FONT_DISPLAY_SWAP:
+        return 0;
+    case CSS_FONT_DISPLAY_FALLBACK:
+    case CSS_FONT_DISPLAY_OPTIONAL:
+        return font_block_period_short;
+    case CSS_FONT_DISPLAY_AUTO:
+    case CSS_FONT_DISPLAY_BLOCK:
+    default:
+        return font_block_period_long;
     }
-    /* Notify content that fonts are done so it can continue box conversion */
-    if (pending_font_count == 0 && font_waiting_content != NULL) {
-        struct html_content *c = font_waiting_content;
-        NSLOG(wisp, INFO, "All fonts loaded, resuming box conversion for %p", c);
+}
+
+/**
+ * Check whether a face which just arrived may still replace the
+ * fallback font it was laid out with.
+ */
+static bool font_download_may_swap(const struct font_download *dl, uint64_t now_ms)
+{
+    uint64_t elapsed = now_ms - dl->start_ms;
+
+    switch (dl->display) {
+    case CSS_FONT_DISPLAY_OPTIONAL:
+        return elapsed <= font_block_period_short;
+    case CSS_FONT_DISPLAY_FALLBACK:
+        return elapsed <= font_block_period_short + font_swap_period_fallback;
+    default:
+        return true;
+    }
+}
+
+/**
+ * Scheduled callback ending the font block period of a content.
+ *
+ * Box conversion proceeds with fallback fonts for any faces that
+ * are still downloading.
+ */
+static void font_block_timeout(void *p)
+{
+    struct html_content *c = p;
+
+    if (c->font_wait_start_ms != 0) {
+        NSLOG(wisp, INFO, "Font block period over for %p, laying out with %u fonts pending", c,
+            c->font_pending_count);
+        c->font_block_deadline_ms = 0;
         html_finish_conversion(c);
     }
 }
 
+/**
+ * Notify the contents using a face that its download has finished.
+ *
+ * \param dl The finished download.
+ * \param loaded true if the face was loaded, false if the fetch failed.
+ */
+static void font_download_notify(struct font_download *dl, bool loaded)
+{
+    struct font_waiter *waiter;
+    struct font_waiter *next;
+    uint64_t now_ms;
+
+    nsu_getmonotonic_ms(&now_ms);
+
+    for (waiter = dl->waiters; waiter != NULL; waiter = next) {
+        struct html_content *c = waiter->c;
+        next = waiter->next;
+
+        c->font_pending_count--;
+
+        if (c->font_wait_start_ms != 0) {
+            /* Still in the block period, resume once nothing is
+             * left to wait for */
+            if (c->font_pending_count == 0) {
+                NSLOG(wisp, INFO, "All fonts loaded, resuming box conversion for %p", c);
+                guit->misc->schedule(-1, font_block_timeout, c);
+                c->font_block_deadline_ms = 0;
+                html_finish_conversion(c);
+            }
+        } else if (loaded && c->had_initial_layout && font_download_may_swap(dl, now_ms)) {
+            /* Laid out with a fallback font, swap the face in */
+            NSLOG(wisp, INFO, "Font '%s' arrived late, relayout of %p", dl->variant.family_name, c);
+            if (c->pending_reformat == false) {
+                c->pending_reformat = true;
+                guit->misc->schedule(0, html_deferred_reformat, c);
+            }
+        }
+
+        free(waiter);
+    }
+    dl->waiters = NULL;
+}
+
+/**
+ * Remove a download from the list and free it.
+ */
+static void font_download_free(struct font_download *dl)
+{
+    struct font_download **link;
+
+    for (link = &font_downloads; *link != NULL; link = &(*link)->next) {
+        if (*link == dl) {
+            *link = dl->next;
+            break;
+        }
+    }
+
+    free(dl->variant.family_name);
+    free(dl);
+}
+
 /**
  * Check if two font variant identities match.
  */
@@ -117,9 +228,10 @@ static bool is_variant_loaded(const struct font_variant_id *id)
  */
 static bool is_variant_pending(const struct font_variant_id *id)
 {
-    for (int i = 0; i < MAX_FONT_DOWNLOADS; i++) {
-        if (font_downloads[i].in_use && font_downloads[i].variant.family_name != NULL &&
-            font_variant_match(&font_downloads[i].variant, id)) {
+    struct font_download *dl;
+
+    for (dl = font_downloads; dl != NULL; dl = dl->next) {
+        if (font_variant_match(&dl->variant, id)) {
             return true;
         }
     }
@@ -150,25 +262,13 @@ static void mark_font_loaded(const struct font_variant_id *id)
     }
 }
 
-/**
- * Find a free download slot
- */
-static struct font_download *find_free_slot(void)
-{
-    for (int i = 0; i < MAX_FONT_DOWNLOADS; i++) {
-        if (!font_downloads[i].in_use) {
-            return &font_downloads[i];
-        }
-    }
-    return NULL;
-}
-
 /**
  * Callback for font file fetch (llcache)
  */
 static nserror font_fetch_callback(llcache_handle *handle, const llcache_event *event, void *pw)
 {
     struct font_download *dl = pw;
+    bool loaded = false;
 
     switch (event->type) {
     case LLCACHE_EVENT_DONE: {
@@ -180,46 +280,34 @@ static nserror font_fetch_callback(llcache_handle *handle, const llcache_event *
         if (data != NULL && size > 0) {
             NSLOG(wisp, INFO, "Font '%s' downloaded (%zu bytes)", dl->variant.family_name, size);
 
-            /* Load the font into the system via frontend table */
+            /* Load the font into the system via frontend table; the
+             * measurement cache discards results measured without it */
             nserror err = NSERROR_NOT_IMPLEMENTED;
-            if (guit != NULL && guit->layout != NULL && guit->layout->load_font_data != NULL) {
-                err = guit->layout->load_font_data(&dl->variant, data, size);
+            if (guit != NULL && guit->layout != NULL) {
+                err = measure_cache_layout_table.load_font_data(&dl->variant, data, size);
             }
             if (err == NSERROR_OK) {
                 mark_font_loaded(&dl->variant);
+                loaded = true;
             }
         }
-
-        /* Clean up */
-        llcache_handle_release(handle);
-        free(dl->variant.family_name);
-        dl->variant.family_name = NULL;
-        dl->handle = NULL;
-        dl->in_use = false;
-
-        /* Decrement pending count and check if all done */
-        pending_font_count--;
-        check_fonts_done();
         break;
     }
 
     case LLCACHE_EVENT_ERROR:
         NSLOG(wisp, WARNING, "Failed to download font '%s': %s", dl->variant.family_name, event->data.error.msg);
-        llcache_handle_release(handle);
-        free(dl->variant.family_name);
-        dl->variant.family_name = NULL;
-        dl->handle = NULL;
-        dl->in_use = false;
-
-        /* Decrement pending count and check if all done */
-        pending_font_count--;
-        check_fonts_done();
         break;
 
     default:
-        break;
+        return NSERROR_OK;
     }
 
+    /* Clean up */
+    llcache_handle_release(handle);
+
+    font_download_notify(dl, loaded);
+    font_download_free(dl);
+
     return NSERROR_OK;
 }
 
@@ -230,42 +318,41 @@ static nserror font_fetch_callback(llcache_handle *handle, const llcache_event *
  * \param font_url  Absolute URL of font file
  * \param base_url  Base URL for referer header (may be NULL)
  */
-static nserror fetch_font_url(const struct font_variant_id *id, nsurl *font_url, nsurl *base_url)
+static nserror fetch_font_url(
+    const struct font_variant_id *id, css_font_display display, nsurl *font_url, nsurl *base_url)
 {
     struct font_download *dl;
     nserror err;
 
-    /* Find a free slot */
-    dl = find_free_slot();
+    dl = calloc(1, sizeof(struct font_download));
     if (dl == NULL) {
-        NSLOG(wisp, WARNING, "No free font download slots");
         return NSERROR_NOMEM;
     }
 
     /* Set up the download */
     dl->variant.family_name = strdup(id->family_name);
     if (dl->variant.family_name == NULL) {
+        free(dl);
         return NSERROR_NOMEM;
     }
-    dl->in_use = true;
     dl->variant.weight = id->weight;
     dl->variant.style = id->style;
+    dl->display = display;
+    nsu_getmonotonic_ms(&dl->start_ms);
 
-    NSLOG(wisp, INFO, "Fetching font '%s' (weight=%d style=%d) from %s", id->family_name, id->weight, id->style,
-        nsurl_access(font_url));
+    NSLOG(wisp, INFO, "Fetching font '%s' (weight=%d style=%d display=%d) from %s", id->family_name, id->weight,
+        id->style, display, nsurl_access(font_url));
+
+    dl->next = font_downloads;
+    font_downloads = dl;
 
     /* Start the fetch using llcache (raw bytes, no content handler needed) */
     err = llcache_handle_retrieve(font_url, 0, base_url, NULL, font_fetch_callback, dl, &dl->handle);
     if (err != NSERROR_OK) {
-        free(dl->variant.family_name);
-        dl->variant.family_name = NULL;
-        dl->in_use = false;
+        font_download_free(dl);
         return err;
     }
 
-    /* Increment pending download count */
-    pending_font_count++;
-
     return NSERROR_OK;
 }
 
@@ -361,7 +448,7 @@ nserror html_font_face_process(const css_font_face *font_face, const char *base_
         }
 
         /* Fetch the font */
-        err = fetch_font_url(&vid, font_url, base);
+        err = fetch_font_url(&vid, css_font_face_font_display(font_face), font_url, base);
         nsurl_unref(font_url);
 
         if (err == NSERROR_OK) {
@@ -373,24 +460,129 @@ nserror html_font_face_process(const css_font_face *font_face, const char *base_
     return NSERROR_OK;
 }
 
+/**
+ * Check whether a content's own stylesheets declare the face a download
+ * is fetching.
+ *
+ * Downloads are shared by every content, so one started for another
+ * content's stylesheets must not hold this content's layout back.
+ *
+ * \param dl The download.
+ * \param c The content.
+ * \param select_ctx The content's selection context.
+ * \return true if the content has an applicable \@font-face rule for the face.
+ */
+static bool
+font_download_requested_by(const struct font_download *dl, struct html_content *c, css_select_ctx *select_ctx)
+{
+    css_select_font_faces_results *faces = NULL;
+    lwc_string *family;
+    bool requested = false;
+    uint32_t i;
+
+    if (lwc_intern_string(dl->variant.family_name, strlen(dl->variant.family_name), &family) != lwc_error_ok) {
+        return false;
+    }
+
+    if (css_select_font_faces(select_ctx, &c->media, &c->unit_len_ctx, family, &faces) == CSS_OK && faces != NULL) {
+        for (i = 0; i < faces->n_font_faces; i++) {
+            if (css_font_face_font_weight(faces->font_faces[i]) == dl->variant.weight &&
+                css_font_face_font_style(faces->font_faces[i]) == dl->variant.style) {
+                requested = true;
+                break;
+            }
+        }
+        css_select_font_faces_results_destroy(faces);
+    }
+
+    lwc_string_unref(family);
+
+    return requested;
+}
+
 /* Exported function documented in font_face.h */
 nserror html_font_face_init(struct html_content *c, css_select_ctx *select_ctx)
 {
-    /* Store the content so we can notify it when fonts complete */
-    font_waiting_content = c;
-    (void)select_ctx;
+    struct font_download *dl;
+    struct font_waiter *waiter;
+    uint64_t deadline_ms;
+
+    /* Conversion may restart, drop the waiters already registered */
+    html_font_face_fini(c);
 
-    NSLOG(wisp, INFO, "Font-face system initialized for content %p", c);
+    /* Register interest in the faces still downloading which this
+     * content's stylesheets declare, so it is told when each arrives */
+    c->font_block_deadline_ms = 0;
+    if (select_ctx == NULL) {
+        return NSERROR_OK;
+    }
+    for (dl = font_downloads; dl != NULL; dl = dl->next) {
+        if (!font_download_requested_by(dl, c, select_ctx)) {
+            continue;
+        }
+
+        waiter = malloc(sizeof(struct font_waiter));
+        if (waiter == NULL) {
+            return NSERROR_NOMEM;
+        }
+        waiter->c = c;
+        waiter->next = dl->waiters;
+        dl->waiters = waiter;
+        c->font_pending_count++;
+
+        deadline_ms = dl->start_ms + font_display_block_period(dl->display);
+        if (deadline_ms > c->font_block_deadline_ms) {
+            c->font_block_deadline_ms = deadline_ms;
+        }
+    }
+
+    NSLOG(wisp, INFO, "Font-face system initialized for content %p (%u fonts pending)", c, c->font_pending_count);
     return NSERROR_OK;
 }
 
+/* Exported function documented in font_face.h */
+bool html_font_face_should_block(struct html_content *c)
+{
+    uint64_t now_ms;
+
+    if (c->font_pending_count == 0 || c->font_block_deadline_ms == 0) {
+        return false;
+    }
+
+    nsu_getmonotonic_ms(&now_ms);
+    if (now_ms >= c->font_block_deadline_ms) {
+        return false;
+    }
+
+    /* Resume with fallback fonts if the faces do not arrive in time */
+    guit->misc->schedule(c->font_block_deadline_ms - now_ms, font_block_timeout, c);
+
+    return true;
+}
+
 /* Exported function documented in font_face.h */
 nserror html_font_face_fini(struct html_content *c)
 {
-    /* Clear the waiting content if it matches */
-    if (font_waiting_content == c) {
-        font_waiting_content = NULL;
+    struct font_download *dl;
+    struct font_waiter **link;
+    struct font_waiter *waiter;
+
+    guit->misc->schedule(-1, font_block_timeout, c);
+
+    for (dl = font_downloads; dl != NULL; dl = dl->next) {
+        link = &dl->waiters;
+        while (*link != NULL) {
+            waiter = *link;
+            if (waiter->c == c) {
+                *link = waiter->next;
+                free(waiter);
+            } else {
+                link = &waiter->next;
+            }
+        }
     }
+    c->font_pending_count = 0;
+
     return NSERROR_OK;
 }
 
@@ -407,22 +599,3 @@ bool html_font_face_is_available(const char *family_name)
 
     return false;
 }
-
-
-/* Exported function documented in font_face.h */
-void html_font_face_set_done_callback(html_font_face_done_cb cb)
-{
-    font_done_callback = cb;
-}
-
-/* Exported function documented in font_face.h */
-bool html_font_face_has_pending(void)
-{
-    return pending_font_count > 0;
-}
-
-/* Get pending font count for logging */
-int html_font_face_pending_count(void)
-{
-    return pending_font_count;
-}
@@ -31,7 +31,16 @@ struct html_content;
 struct nsurl;
 
 /**
- * Process font-face rules from the selection context and start fetching fonts.
+ * Register an HTML content as a user of the fonts currently downloading.
+ *
+ * Only faces declared by an applicable \@font-face rule in the content's
+ * own stylesheets are waited on; downloads started for other contents
+ * are ignored. The content is notified as each of its faces arrives: while it is still
+ * held in the font block period box conversion resumes once all its
+ * faces are present, afterwards a relayout is scheduled for faces
+ * whose font-display policy still allows them to be swapped in.
+ *
+ * Calling this again replaces the content's earlier registration.
  *
  * \param c          HTML content with loaded stylesheets
  * \param select_ctx CSS selection context with all stylesheets
@@ -39,6 +48,18 @@ struct nsurl;
  */
 nserror html_font_face_init(struct html_content *c, css_select_ctx *select_ctx);
 
+/**
+ * Check whether box conversion should wait for web fonts.
+ *
+ * Returns true while the content is inside the font-display block
+ * period of a face it is waiting on. A timeout is scheduled so that
+ * conversion resumes with fallback fonts when the period ends.
+ *
+ * \param c HTML content
+ * \return true if conversion should be delayed, false to proceed
+ */
+bool html_font_face_should_block(struct html_content *c);
+
 /**
  * Free font-face resources for an HTML content.
  *
@@ -71,31 +92,5 @@ nserror html_font_face_process(const css_font_face *font_face, const char *base_
  * in include/neosurf/layout.h. Frontends MUST implement this table entry.
  * Do NOT define a function named html_font_face_load_data - it will not be called.
  */
-/**
- * Callback invoked when all pending font downloads have completed.
- * This can be used to trigger a page redraw (FOUT strategy).
- */
-typedef void (*html_font_face_done_cb)(void);
-
-/**
- * Set the callback to invoke when all pending font downloads complete.
- *
- * \param cb Callback function (or NULL to unset)
- */
-void html_font_face_set_done_callback(html_font_face_done_cb cb);
-
-/**
- * Check if there are any pending font downloads.
- *
- * \return true if fonts are still downloading, false otherwise
- */
-bool html_font_face_has_pending(void);
-
-/**
- * Get the count of pending font downloads (for logging).
- *
- * \return number of fonts still downloading
- */
-int html_font_face_pending_count(void);
 
 #endif /* NETSURF_HTML_FONT_FACE_H */
@@ -1324,8 +1324,8 @@ void form_free_control(struct form_control *control)
         dom_string_unref(control->node_value);
     }
 
-    if (control->box != NULL) {
-        control->box->gadget = NULL;
+    if (control->box != NULL && control->box->extra != NULL) {
+        control->box->extra->gadget = NULL;
     }
 
     free(control);
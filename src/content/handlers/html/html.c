@@ -50,10 +50,13 @@
 #include <wisp/utils/utils.h>
 #include "utils/http.h"
 #include "utils/libdom.h"
+#include "utils/phase.h"
+#include "utils/trace.h"
 #include "utils/talloc.h"
 #include "content/content_factory.h"
 #include "content/handlers/javascript/js.h"
 #include "content/textsearch.h"
+#include "desktop/measure_cache.h"
 #include "desktop/scrollbar.h"
 #include "desktop/selection.h"
 
@@ -76,6 +79,9 @@
 
 #define CHUNK 4096
 
+/** Estimated bytes of DOM per byte of document source */
+#define HTML_DOM_SOURCE_RATIO 4
+
 /* Change these to 1 to cause a dump to stderr of the frameset or box
  * when the trees have been built.
  */
@@ -274,6 +280,10 @@ static void html_box_convert_done(html_content *c, bool success)
         c->parser = NULL;
     }
 
+    /* Estimate the memory held by the converted document, the box tree
+     * plus a DOM of a few times the size of its source */
+    c->base.size = talloc_total_size(c->bctx) + content__get_source_length(&c->base) * HTML_DOM_SOURCE_RATIO;
+
     PERF("DOM to box conversion DONE");
     content_set_ready(&c->base);
 
@@ -491,16 +501,23 @@ void html_finish_conversion(html_content *htmlc)
 
     /* Register this content for font completion callback (only on first call) */
     if (htmlc->font_wait_start_ms == 0) {
-        html_font_face_init(htmlc, htmlc->select_ctx);
+        error = html_font_face_init(htmlc, htmlc->select_ctx);
+        if (error != NSERROR_OK) {
+            dom_node_unref(html);
+            content_broadcast_error(&htmlc->base, error, NULL);
+            content_set_error(&htmlc->base);
+            return;
+        }
     }
 
-    /* Wait for fonts before starting box conversion to avoid FOUT */
-    if (html_font_face_has_pending()) {
+    /* Wait for fonts during their font-display block period to avoid
+     * FOUT; later arrivals are swapped in by relayout */
+    if (html_font_face_should_block(htmlc)) {
         /* Store timestamp on first delay */
         if (htmlc->font_wait_start_ms == 0) {
             nsu_getmonotonic_ms(&htmlc->font_wait_start_ms);
-            NSLOG(wisp, INFO, "Delaying box conversion - waiting for %d pending fonts (started at %llu ms)",
-                html_font_face_pending_count(), htmlc->font_wait_start_ms);
+            NSLOG(wisp, INFO, "Delaying box conversion - waiting for %u pending fonts (started at %llu ms)",
+                htmlc->font_pending_count, htmlc->font_wait_start_ms);
         }
         dom_node_unref(html);
         /* Will be called again when fonts complete */
@@ -512,7 +529,7 @@ void html_finish_conversion(html_content *htmlc)
         uint64_t now_ms;
         nsu_getmonotonic_ms(&now_ms);
         uint64_t delay_ms = now_ms - htmlc->font_wait_start_ms;
-        NSLOG(wisp, INFO, "Fonts ready! Box conversion delayed by %llu ms", delay_ms);
+        NSLOG(wisp, INFO, "Box conversion delayed by %llu ms for fonts", delay_ms);
         htmlc->font_wait_start_ms = 0; /* Reset for next time */
     }
 
@@ -588,6 +605,7 @@ static nserror html_create_html_data(html_content *c, const http_parameter *para
     c->title = NULL;
     c->bctx = NULL;
     c->layout = NULL;
+    c->layout_scratch = NULL;
     c->background_colour = NS_TRANSPARENT;
     c->stylesheet_count = 0;
     c->stylesheets = NULL;
@@ -603,7 +621,7 @@ static nserror html_create_html_data(html_content *c, const http_parameter *para
     c->frameset = NULL;
     c->iframe = NULL;
     c->page = NULL;
-    c->font_func = guit->layout;
+    c->font_func = &measure_cache_layout_table;
     c->drag_type = HTML_DRAG_NONE;
     c->drag_owner.no_owner = true;
     c->selection_type = HTML_SELECTION_NONE;
@@ -704,6 +722,11 @@ static nserror html_create_html_data(html_content *c, const http_parameter *para
 
     assert(old_node_data == NULL);
 
+    nerror = html_dom_mutation_observe(c);
+    if (nerror != NSERROR_OK) {
+        NSLOG(wisp, WARNING, "Unable to observe DOM mutations (err: %d)", nerror);
+    }
+
     return NSERROR_OK;
 }
 
@@ -753,14 +776,22 @@ static nserror html_create(const content_handler *handler, lwc_string *imime_typ
 }
 
 
+/**
+ * Get a run of the source of an html content for reparsing.
+ */
+static const uint8_t *html_source_run(void *ctx, size_t offset, size_t *len)
+{
+    return content__get_source_run(ctx, offset, len);
+}
+
+
 static nserror html_process_encoding_change(struct content *c, const char *data, unsigned int size)
 {
     html_content *html = (html_content *)c;
     dom_hubbub_parser_params parse_params;
     dom_hubbub_error error;
     const char *encoding;
-    const uint8_t *source_data;
-    size_t source_size;
+    nserror err;
 
     NSLOG(wisp, ERROR, ">>> html_process_encoding_change called for content %p, parser=%p", c, html->parser);
 
@@ -787,6 +818,7 @@ static nserror html_process_encoding_change(struct content *c, const char *data,
     html->parser = NULL;
 
     if (html->document != NULL) {
+        html_dom_mutation_unobserve(html);
         dom_node_unref(html->document);
     }
 
@@ -821,13 +853,16 @@ static nserror html_process_encoding_change(struct content *c, const char *data,
         }
     }
 
-    source_data = content__get_source_data(c, &source_size);
+    err = html_dom_mutation_observe(html);
+    if (err != NSERROR_OK) {
+        NSLOG(wisp, WARNING, "Unable to observe DOM mutations (err: %d)", err);
+    }
 
     /* Reprocess all the data.  This is safe because
      * the encoding is now specified at parser start which means
      * it cannot be changed again.
      */
-    error = dom_hubbub_parser_parse_chunk(html->parser, source_data, source_size);
+    error = libdom_hubbub_parse_runs(html->parser, html_source_run, c);
 
     return libdom_hubbub_error_to_nserror(error);
 }
@@ -842,6 +877,7 @@ static bool html_process_data(struct content *c, const char *data, unsigned int
     html_content *html = (html_content *)c;
     dom_hubbub_error dom_ret;
     nserror err = NSERROR_OK; /* assume its all going to be ok */
+    enum phase previous;
 
     if (html->parser == NULL) {
         /* Parser may be NULL because:
@@ -862,6 +898,9 @@ static bool html_process_data(struct content *c, const char *data, unsigned int
         return false;
     }
 
+    TRACE_BEGIN_ARG("html", "parse chunk", "bytes", size);
+    previous = phase_enter(PHASE_PARSE);
+
     dom_ret = dom_hubbub_parser_parse_chunk(html->parser, (const uint8_t *)data, size);
 
     err = libdom_hubbub_error_to_nserror(dom_ret);
@@ -871,6 +910,9 @@ static bool html_process_data(struct content *c, const char *data, unsigned int
         err = html_process_encoding_change(c, data, size);
     }
 
+    phase_leave(previous);
+    TRACE_END("html", "parse chunk");
+
     /* broadcast the error if necessary */
     if (err != NSERROR_OK && err != NSERROR_PAUSED) {
         content_broadcast_error(c, err, NULL);
@@ -984,6 +1026,7 @@ bool html_begin_conversion(html_content *htmlc)
     dom_exception exc; /* returned by libdom functions */
     dom_string *node_name = NULL;
     dom_hubbub_error error;
+    enum phase previous;
 
     /* The act of completing the parse can result in additional data
      * being flushed through the parser. This may result in new style or
@@ -1001,7 +1044,11 @@ bool html_begin_conversion(html_content *htmlc)
         PERF("html_begin_conversion: completing parse (active=%d, scripts_active=%d)", htmlc->base.active,
             htmlc->scripts_active);
         /* complete parsing */
+        TRACE_BEGIN("html", "parse completed");
+        previous = phase_enter(PHASE_PARSE);
         error = dom_hubbub_parser_completed(htmlc->parser);
+        phase_leave(previous);
+        TRACE_END("html", "parse completed");
         PERF("html_begin_conversion: parse completed, error=%d (active=%d, scripts_active=%d)", error,
             htmlc->base.active, htmlc->scripts_active);
         if (error == DOM_HUBBUB_HUBBUB_ERR_PAUSED) {
@@ -1027,6 +1074,9 @@ bool html_begin_conversion(html_content *htmlc)
             return false;
         }
         htmlc->parse_completed = true;
+
+        /* Catch up with nodes the parser modified before converting */
+        html_dom_mutation_checkpoint(htmlc);
     }
 
     PERF(
@@ -1239,6 +1289,7 @@ static void html_reformat(struct content *c, int width, int height)
     uint64_t ms_before;
     uint64_t ms_after;
     uint64_t ms_interval;
+    enum phase previous;
 
     /* If the layout is NULL (e.g. during conversion restart), we cannot
      * reflow. Just return OK and wait for the conversion to complete.
@@ -1265,7 +1316,8 @@ static void html_reformat(struct content *c, int width, int height)
 
     nsu_getmonotonic_ms(&ms_before);
 
-    NSLOG(wisp, DEBUG, "PROFILER: START HTML layout %p", c);
+    TRACE_BEGIN("html", "reformat");
+    previous = phase_enter(PHASE_LAYOUT);
 
     htmlc->reflowing = true;
     static int reformat_count = 0;
@@ -1297,7 +1349,8 @@ static void html_reformat(struct content *c, int width, int height)
     htmlc->reflowing = false;
     htmlc->had_initial_layout = true;
 
-    NSLOG(wisp, DEBUG, "PROFILER: STOP HTML layout %p", c);
+    phase_leave(previous);
+    TRACE_END("html", "reformat");
 
     /* calculate next reflow time at three times what it took to reflow */
     nsu_getmonotonic_ms(&ms_after);
@@ -1403,6 +1456,11 @@ static void html_free_layout(html_content *htmlc)
     }
     htmlc->layout = NULL;
 
+    if (htmlc->layout_scratch != NULL) {
+        talloc_free(htmlc->layout_scratch);
+        htmlc->layout_scratch = NULL;
+    }
+
     /* Clear the CSS selection context when freeing the layout.
      * The select_ctx is semantically tied to the layout - it was used
      * to build this specific box tree. When we free the layout (either
@@ -1433,6 +1491,7 @@ static void html_destroy(struct content *c)
     guit->misc->schedule(-1, html_resume_conversion_cb, html);
     guit->misc->schedule(-1, script_resume_conversion_cb, html);
     guit->misc->schedule(-1, html_deferred_reformat, html);
+    html_dom_mutation_unobserve(html);
 
     /* If we're still converting a layout, cancel it */
     if (html->box_conversion_context != NULL) {
@@ -1635,7 +1694,7 @@ static void html_clear_selection(struct content *c)
         assert(html->selection_owner.none == true);
         break;
     case HTML_SELECTION_TEXTAREA:
-        textarea_clear_selection(html->selection_owner.textarea->gadget->data.text.ta);
+        textarea_clear_selection(box_extra(html->selection_owner.textarea)->gadget->data.text.ta);
         break;
     case HTML_SELECTION_SELF:
         assert(html->selection_owner.none == false);
@@ -1664,7 +1723,7 @@ static char *html_get_selection(struct content *c)
 
     switch (html->selection_type) {
     case HTML_SELECTION_TEXTAREA:
-        return textarea_get_selection(html->selection_owner.textarea->gadget->data.text.ta);
+        return textarea_get_selection(box_extra(html->selection_owner.textarea)->gadget->data.text.ta);
     case HTML_SELECTION_SELF:
         assert(html->selection_owner.none == false);
         return selection_get_copy(html->sel);
@@ -1709,9 +1768,9 @@ static nserror html_get_contextual_content(struct content *c, int x, int y, stru
             continue;
         }
 
-        if (box->iframe) {
-            float scale = browser_window_get_scale(box->iframe);
-            browser_window_get_features(box->iframe, (x - box_x) * scale, (y - box_y) * scale, data);
+        if (box_extra(box)->iframe) {
+            float scale = browser_window_get_scale(box_extra(box)->iframe);
+            browser_window_get_features(box_extra(box)->iframe, (x - box_x) * scale, (y - box_y) * scale, data);
         }
 
         if (box->object)
@@ -1720,22 +1779,22 @@ static nserror html_get_contextual_content(struct content *c, int x, int y, stru
         if (box->object)
             data->object = box->object;
 
-        if (box->href) {
-            data->link = box->href;
+        if (box_extra(box)->href) {
+            data->link = box_extra(box)->href;
             data->link_title = box->text;
             data->link_title_length = box->length;
         }
 
-        if (box->usemap) {
+        if (box_extra(box)->usemap) {
             const char *target = NULL;
-            nsurl *url = imagemap_get(html, box->usemap, box_x, box_y, x, y, &target);
+            nsurl *url = imagemap_get(html, box_extra(box)->usemap, box_x, box_y, x, y, &target);
             /* Box might have imagemap, but no actual link area
              * at point */
             if (url != NULL)
                 data->link = url;
         }
-        if (box->gadget) {
-            switch (box->gadget->type) {
+        if (box_extra(box)->gadget) {
+            switch (box_extra(box)->gadget->type) {
             case GADGET_TEXTBOX:
             case GADGET_TEXTAREA:
             case GADGET_PASSWORD:
@@ -1784,19 +1843,19 @@ static bool html_scroll_at_point(struct content *c, int x, int y, int scrx, int
             continue;
 
         /* Pass into iframe */
-        if (box->iframe) {
-            float scale = browser_window_get_scale(box->iframe);
+        if (box_extra(box)->iframe) {
+            struct browser_window *iframe = box_extra(box)->iframe;
+            float scale = browser_window_get_scale(iframe);
 
-            if (browser_window_scroll_at_point(box->iframe, (x - box_x) * scale, (y - box_y) * scale, scrx, scry) ==
-                true)
+            if (browser_window_scroll_at_point(iframe, (x - box_x) * scale, (y - box_y) * scale, scrx, scry) == true)
                 return true;
         }
 
         /* Pass into textarea widget */
-        if (box->gadget &&
-            (box->gadget->type == GADGET_TEXTAREA || box->gadget->type == GADGET_PASSWORD ||
-                box->gadget->type == GADGET_TEXTBOX) &&
-            textarea_scroll(box->gadget->data.text.ta, scrx, scry) == true)
+        if (box_extra(box)->gadget &&
+            (box_extra(box)->gadget->type == GADGET_TEXTAREA || box_extra(box)->gadget->type == GADGET_PASSWORD ||
+                box_extra(box)->gadget->type == GADGET_TEXTBOX) &&
+            textarea_scroll(box_extra(box)->gadget->data.text.ta, scrx, scry) == true)
             return true;
 
         /* Pass into object */
@@ -1873,8 +1932,9 @@ static void html__set_file_gadget_filename(struct content *c, struct form_contro
     form_gadget_update_value(gadget, utf8_fn);
 
     /* corestring_dom___ns_key_file_name_node_data */
-    if (dom_node_set_user_data((dom_node *)file_box->gadget->node, corestring_dom___ns_key_file_name_node_data,
-            strdup(fn), html__dom_user_data_handler, &oldfile) == DOM_NO_ERR) {
+    if (dom_node_set_user_data((dom_node *)box_extra(file_box)->gadget->node,
+            corestring_dom___ns_key_file_name_node_data, strdup(fn), html__dom_user_data_handler,
+            &oldfile) == DOM_NO_ERR) {
         if (oldfile != NULL)
             free(oldfile);
     }
@@ -1915,16 +1975,17 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
         if (box->style && css_computed_visibility(box->style) == CSS_VISIBILITY_HIDDEN)
             continue;
 
-        if (box->iframe) {
-            float scale = browser_window_get_scale(box->iframe);
-            return browser_window_drop_file_at_point(box->iframe, (x - box_x) * scale, (y - box_y) * scale, file);
+        if (box_extra(box)->iframe) {
+            struct browser_window *iframe = box_extra(box)->iframe;
+            float scale = browser_window_get_scale(iframe);
+            return browser_window_drop_file_at_point(iframe, (x - box_x) * scale, (y - box_y) * scale, file);
         }
 
         if (box->object && content_drop_file_at_point(box->object, x - box_x, y - box_y, file) == true)
             return true;
 
-        if (box->gadget) {
-            switch (box->gadget->type) {
+        if (box_extra(box)->gadget) {
+            switch (box_extra(box)->gadget->type) {
             case GADGET_FILE:
                 file_box = box;
                 break;
@@ -1952,7 +2013,7 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
     /* Handle the drop */
     if (file_box) {
         /* File dropped on file input */
-        html__set_file_gadget_filename(c, file_box->gadget, file);
+        html__set_file_gadget_filename(c, box_extra(file_box)->gadget, file);
 
     } else {
         /* File dropped on text input */
@@ -2025,10 +2086,10 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 
         /* Simulate a click over the input box, to place caret */
         box_coords(text_box, &bx, &by);
-        textarea_mouse_action(text_box->gadget->data.text.ta, BROWSER_MOUSE_PRESS_1, x - bx, y - by);
+        textarea_mouse_action(box_extra(text_box)->gadget->data.text.ta, BROWSER_MOUSE_PRESS_1, x - bx, y - by);
 
         /* Paste the file as text */
-        textarea_drop_text(text_box->gadget->data.text.ta, utf8_buff, size);
+        textarea_drop_text(box_extra(text_box)->gadget->data.text.ta, utf8_buff, size);
 
         free(utf8_buff);
     }
@@ -2399,6 +2460,22 @@ static bool html_saw_insecure_objects(struct content *c)
     return false;
 }
 
+/**
+ * Determine if an unused html content may be kept for history navigation
+ *
+ * Closing the content destroys its javascript thread, so documents with
+ * scripts are converted afresh to run them again.
+ *
+ * \param c The content to check
+ * \return true if the content may be restored
+ */
+static bool html_is_retainable(const struct content *c)
+{
+    const html_content *htmlc = (const html_content *)c;
+
+    return (htmlc->aborted == false) && (htmlc->scripts_count == 0);
+}
+
 /**
  * Compute the type of a content
  *
@@ -2545,6 +2622,7 @@ static const content_handler html_content_handler = {
     .textselection_copy = html_textselection_copy,
     .textselection_get_end = html_textselection_get_end,
     .no_share = true,
+    .is_retainable = html_is_retainable,
 };
 
 
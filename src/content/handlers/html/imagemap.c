@@ -34,6 +34,7 @@
 #include <wisp/content/hlcache.h>
 #include <wisp/utils/corestrings.h>
 #include <wisp/utils/log.h>
+#include "utils/trace.h"
 
 #include <wisp/content/handlers/html/box.h>
 #include <wisp/content/handlers/html/private.h>
@@ -570,11 +571,11 @@ nserror imagemap_extract(html_content *c)
     uint32_t maybe_maps;
     nserror ret = NSERROR_OK;
 
-    NSLOG(wisp, DEBUG, "PROFILER: START imagemap_extract %p", c);
+    TRACE_BEGIN("html", "imagemap extract");
 
     exc = dom_document_get_elements_by_tag_name(c->document, corestring_dom_map, &nlist);
     if (exc != DOM_NO_ERR) {
-        NSLOG(wisp, DEBUG, "PROFILER: STOP imagemap_extract %p", c);
+        TRACE_END("html", "imagemap extract");
         return NSERROR_DOM;
     }
 
@@ -643,7 +644,7 @@ nserror imagemap_extract(html_content *c)
 
 out_nlist:
     dom_nodelist_unref(nlist);
-    NSLOG(wisp, DEBUG, "PROFILER: STOP imagemap_extract %p", c);
+    TRACE_END("html", "imagemap extract");
     return ret;
 }
 
@@ -32,6 +32,7 @@
 
 #include <wisp/browser_window.h>
 #include <wisp/content.h>
+#include <wisp/content/fetch.h>
 #include <wisp/content/hlcache.h>
 #include <wisp/desktop/gui_internal.h>
 #include <wisp/desktop/textarea.h>
@@ -59,6 +60,7 @@
 #include "content/handlers/html/box_textarea.h"
 #include "content/handlers/html/font.h"
 #include "content/handlers/html/imagemap.h"
+#include "content/handlers/html/stacking.h"
 
 /**
  * Get pointer shape for given box
@@ -69,6 +71,7 @@
 
 static browser_pointer_shape get_pointer_shape(struct box *box, bool imagemap)
 {
+    const struct form_control *gadget = box_extra(box)->gadget;
     browser_pointer_shape pointer;
     css_computed_style *style;
     enum css_cursor_e cursor;
@@ -86,13 +89,12 @@ static browser_pointer_shape get_pointer_shape(struct box *box, bool imagemap)
 
     switch (cursor) {
     case CSS_CURSOR_AUTO:
-        if (box->href || (box->gadget && (box->gadget->type == GADGET_IMAGE || box->gadget->type == GADGET_SUBMIT)) ||
+        if (box_extra(box)->href || (gadget && (gadget->type == GADGET_IMAGE || gadget->type == GADGET_SUBMIT)) ||
             imagemap) {
             /* link */
             pointer = BROWSER_POINTER_POINT;
-        } else if (box->gadget &&
-            (box->gadget->type == GADGET_TEXTBOX || box->gadget->type == GADGET_PASSWORD ||
-                box->gadget->type == GADGET_TEXTAREA)) {
+        } else if (gadget &&
+            (gadget->type == GADGET_TEXTBOX || gadget->type == GADGET_PASSWORD || gadget->type == GADGET_TEXTAREA)) {
             /* text input */
             pointer = BROWSER_POINTER_CARET;
         } else {
@@ -455,12 +457,12 @@ mouse_action_drag_textarea(html_content *html, struct browser_window *bw, browse
 
     box = html->drag_owner.textarea;
 
-    assert(box->gadget != NULL);
-    assert(box->gadget->type == GADGET_TEXTAREA || box->gadget->type == GADGET_PASSWORD ||
-        box->gadget->type == GADGET_TEXTBOX);
+    assert(box_extra(box)->gadget != NULL);
+    assert(box_extra(box)->gadget->type == GADGET_TEXTAREA || box_extra(box)->gadget->type == GADGET_PASSWORD ||
+        box_extra(box)->gadget->type == GADGET_TEXTBOX);
 
     box_coords(box, &box_x, &box_y);
-    textarea_mouse_action(box->gadget->data.text.ta, mouse, x - box_x, y - box_y);
+    textarea_mouse_action(box_extra(box)->gadget->data.text.ta, mouse, x - box_x, y - box_y);
 
     /* TODO: Set appropriate statusbar message */
     return NSERROR_OK;
@@ -559,6 +561,32 @@ struct mouse_action_state {
 };
 
 
+/**
+ * Determine if a box is painted as part of another box's stack.
+ *
+ * \param top  box painted topmost at a point
+ * \param box  box to test
+ * \return true if box is top, an ancestor of it or a descendant of it
+ */
+static bool html_box_in_stack(const struct box *top, const struct box *box)
+{
+    const struct box *b;
+
+    for (b = top; b != NULL; b = b->parent) {
+        if (b == box) {
+            return true;
+        }
+    }
+    for (b = box->parent; b != NULL; b = b->parent) {
+        if (b == top) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
 /**
  * iterate the box tree for deepest node at coordinates
  *
@@ -597,6 +625,7 @@ struct mouse_action_state {
 static nserror get_mouse_action_node(html_content *html, int x, int y, struct mouse_action_state *man)
 {
     struct box *box;
+    struct box *top;
     int box_x = 0;
     int box_y = 0;
 
@@ -614,7 +643,15 @@ static nserror get_mouse_action_node(html_content *html, int x, int y, struct mo
     box_x = box->margin[LEFT];
     box_y = box->margin[TOP];
 
+    /* boxes outside the topmost stacking context at the point are
+     * painted below it, whatever their document order */
+    top = stacking_box_at_point(box, x, y);
+
     do {
+        if ((top != NULL) && !html_box_in_stack(top, box)) {
+            goto next_box;
+        }
+
         /* skip hidden boxes */
         if ((box->style != NULL) && (css_computed_visibility(box->style) == CSS_VISIBILITY_HIDDEN)) {
             goto next_box;
@@ -634,35 +671,35 @@ static nserror get_mouse_action_node(html_content *html, int x, int y, struct mo
             }
         }
 
-        if (box->iframe) {
-            man->iframe = box->iframe;
+        if (box_extra(box)->iframe) {
+            man->iframe = box_extra(box)->iframe;
         }
 
-        if (box->href) {
-            man->link.url = box->href;
-            man->link.target = box->target;
+        if (box_extra(box)->href) {
+            man->link.url = box_extra(box)->href;
+            man->link.target = box_extra(box)->target;
             man->link.box = box;
             man->link.is_imagemap = false;
         }
 
-        if (box->usemap) {
-            man->link.url = imagemap_get(html, box->usemap, box_x, box_y, x, y, &man->link.target);
+        if (box_extra(box)->usemap) {
+            man->link.url = imagemap_get(html, box_extra(box)->usemap, box_x, box_y, x, y, &man->link.target);
             man->link.box = box;
             man->link.is_imagemap = true;
         }
 
-        if (box->gadget) {
-            man->gadget.control = box->gadget;
+        if (box_extra(box)->gadget) {
+            man->gadget.control = box_extra(box)->gadget;
             man->gadget.box = box;
             man->gadget.box_x = box_x;
             man->gadget.box_y = box_y;
-            if (box->gadget->form) {
-                man->gadget.target = box->gadget->form->target;
+            if (box_extra(box)->gadget->form) {
+                man->gadget.target = box_extra(box)->gadget->form->target;
             }
         }
 
-        if (box->title) {
-            man->title = box->title;
+        if (box_extra(box)->title) {
+            man->title = box_extra(box)->title;
         }
 
         man->result.pointer = get_pointer_shape(box, false);
@@ -976,6 +1013,14 @@ static nserror link_mouse_action(html_content *html, struct browser_window *bw,
 
     mas->result.pointer = get_pointer_shape(mas->link.box, mas->link.is_imagemap);
 
+    if (nsoption_bool(dns_prefetch) && !nsurl_compare(mas->link.url, content_get_url((struct content *)html),
+                                           NSURL_SCHEME | NSURL_HOST | NSURL_PORT)) {
+        /* the link leads off site, so resolve its host while it is
+         * hovered; repeats are ignored by the fetcher
+         */
+        fetch_prefetch_dns(mas->link.url);
+    }
+
     if (mouse & BROWSER_MOUSE_CLICK_1 && mouse & BROWSER_MOUSE_MOD_1) {
         /* force download of link */
         browser_window_navigate(
@@ -1559,7 +1604,7 @@ void html_set_selection(
             if (same_type && html->selection_owner.textarea == selection_owner.textarea)
                 break;
             box = html->selection_owner.textarea;
-            textarea_clear_selection(box->gadget->data.text.ta);
+            textarea_clear_selection(box_extra(box)->gadget->data.text.ta);
             break;
         case HTML_SELECTION_CONTENT:
             if (same_type && html->selection_owner.content == selection_owner.content)
@@ -58,6 +58,7 @@
 #include <wisp/utils/nsurl.h>
 #include <wisp/utils/utils.h>
 #include "utils/talloc.h"
+#include "utils/trace.h"
 #include "desktop/scrollbar.h"
 
 #include <wisp/content/handlers/html/box.h>
@@ -70,9 +71,13 @@
 #include "content/handlers/html/layout.h"
 #include "content/handlers/html/layout_grid.h"
 #include "content/handlers/html/layout_internal.h"
+#include "content/handlers/html/stacking.h"
 #include "content/handlers/html/table.h"
 #include <svgtiny.h>
 
+/** Size of the blocks per-pass layout scratch data is carved out of */
+#define LAYOUT_SCRATCH_POOL_SIZE (16 * 1024)
+
 /** Array of per-side access functions for computed style margins. */
 const css_len_func margin_funcs[4] = {
     [TOP] = css_computed_margin_top,
@@ -716,11 +721,13 @@ static struct box *layout_minmax_line(struct box *first, int *line_min, int *lin
 
                 /* If it's a select element, we must use the
                  * width of the widest option text */
-                if (b->parent->parent->gadget && b->parent->parent->gadget->type == GADGET_SELECT) {
+                const struct form_control *select = box_extra(b->parent->parent)->gadget;
+
+                if (select && select->type == GADGET_SELECT) {
                     int opt_maxwidth = 0;
                     struct form_option *o;
 
-                    for (o = b->parent->parent->gadget->data.select.items; o; o = o->next) {
+                    for (o = select->data.select.items; o; o = o->next) {
                         int opt_width;
                         font_func->width(&fstyle, o->text, strlen(o->text), &opt_width);
 
@@ -977,9 +984,9 @@ layout_minmax_block(struct box *block, const struct gui_layout_table *font_func,
         block->flags |= NEED_MIN;
     }
 
-    if (block->gadget &&
-        (block->gadget->type == GADGET_TEXTBOX || block->gadget->type == GADGET_PASSWORD ||
-            block->gadget->type == GADGET_FILE || block->gadget->type == GADGET_TEXTAREA) &&
+    if (box_extra(block)->gadget &&
+        (box_extra(block)->gadget->type == GADGET_TEXTBOX || box_extra(block)->gadget->type == GADGET_PASSWORD ||
+            box_extra(block)->gadget->type == GADGET_FILE || box_extra(block)->gadget->type == GADGET_TEXTAREA) &&
         block->style) {
         /* For text inputs, use intrinsic width (10em ≈ 20 chars) for minmax:
          * - Always when width is AUTO
@@ -1002,7 +1009,8 @@ layout_minmax_block(struct box *block, const struct gui_layout_table *font_func,
         }
     }
 
-    if (block->gadget && (block->gadget->type == GADGET_RADIO || block->gadget->type == GADGET_CHECKBOX) &&
+    if (box_extra(block)->gadget &&
+        (box_extra(block)->gadget->type == GADGET_RADIO || box_extra(block)->gadget->type == GADGET_CHECKBOX) &&
         block->style && wtype == CSS_WIDTH_AUTO) {
         css_fixed size = INTTOFIX(1);
         css_unit unit = CSS_UNIT_EM;
@@ -2686,7 +2694,7 @@ static void layout_float_find_dimensions(
     if (margin[RIGHT] == AUTO)
         margin[RIGHT] = 0;
 
-    if (box->gadget == NULL) {
+    if (box_extra(box)->gadget == NULL) {
         padding[RIGHT] += scrollbar_width_y;
         padding[BOTTOM] += scrollbar_width_x;
     }
@@ -2696,9 +2704,9 @@ static void layout_float_find_dimensions(
          * See 10.3.6 and 10.6.2 */
         layout_get_object_dimensions(
             unit_len_ctx, box, &width, &height, min_width, max_width, min_height, max_height, available_width);
-    } else if (box->gadget &&
-        (box->gadget->type == GADGET_TEXTBOX || box->gadget->type == GADGET_PASSWORD ||
-            box->gadget->type == GADGET_FILE || box->gadget->type == GADGET_TEXTAREA)) {
+    } else if (box_extra(box)->gadget &&
+        (box_extra(box)->gadget->type == GADGET_TEXTBOX || box_extra(box)->gadget->type == GADGET_PASSWORD ||
+            box_extra(box)->gadget->type == GADGET_FILE || box_extra(box)->gadget->type == GADGET_TEXTAREA)) {
         css_fixed size = 0;
         css_unit unit = CSS_UNIT_EM;
 
@@ -2706,18 +2714,18 @@ static void layout_float_find_dimensions(
          * that don't shrink to fit contained text. */
         assert(box->style);
 
-        if (box->gadget->type == GADGET_TEXTBOX || box->gadget->type == GADGET_PASSWORD ||
-            box->gadget->type == GADGET_FILE) {
+        if (box_extra(box)->gadget->type == GADGET_TEXTBOX || box_extra(box)->gadget->type == GADGET_PASSWORD ||
+            box_extra(box)->gadget->type == GADGET_FILE) {
             if (width == AUTO) {
                 size = INTTOFIX(10);
                 width = FIXTOINT(css_unit_len2device_px(box->style, unit_len_ctx, size, unit));
             }
-            if (box->gadget->type == GADGET_FILE && height == AUTO) {
+            if (box_extra(box)->gadget->type == GADGET_FILE && height == AUTO) {
                 size = FLTTOFIX(1.5);
                 height = FIXTOINT(css_unit_len2device_px(box->style, unit_len_ctx, size, unit));
             }
         }
-        if (box->gadget->type == GADGET_TEXTAREA) {
+        if (box_extra(box)->gadget->type == GADGET_TEXTAREA) {
             if (width == AUTO) {
                 size = INTTOFIX(10);
                 width = FIXTOINT(css_unit_len2device_px(box->style, unit_len_ctx, size, unit));
@@ -2959,7 +2967,7 @@ static bool layout_line(struct box *first, int *width, int *y, int cx, int cy, s
     /* get minimum line height from containing block.
      * this is the line-height if there are text children and also in the
      * case of an initially empty text input */
-    if (has_text_children || first->parent->parent->gadget)
+    if (has_text_children || box_extra(first->parent->parent)->gadget)
         used_height = height = line_height(&content->unit_len_ctx, first->parent->parent->style);
     else
         /* inline containers with no text are usually for layout and
@@ -3064,11 +3072,13 @@ static bool layout_line(struct box *first, int *width, int *y, int cx, int cy, s
 
                 /* If it's a select element, we must use the
                  * width of the widest option text */
-                if (b->parent->parent->gadget && b->parent->parent->gadget->type == GADGET_SELECT) {
+                const struct form_control *select = box_extra(b->parent->parent)->gadget;
+
+                if (select && select->type == GADGET_SELECT) {
                     int opt_maxwidth = 0;
                     struct form_option *o;
 
-                    for (o = b->parent->parent->gadget->data.select.items; o; o = o->next) {
+                    for (o = select->data.select.items; o; o = o->next) {
                         int opt_width;
                         font_func->width(&fstyle, o->text, strlen(o->text), &opt_width);
 
@@ -3333,7 +3343,7 @@ static bool layout_line(struct box *first, int *width, int *y, int cx, int cy, s
         x = x_previous;
 
         if (!no_wrap && (split_box->type == BOX_INLINE || split_box->type == BOX_TEXT) && !split_box->object &&
-            !(split_box->flags & REPLACE_DIM) && !(split_box->flags & IFRAME) && !split_box->gadget &&
+            !(split_box->flags & REPLACE_DIM) && !(split_box->flags & IFRAME) && !box_extra(split_box)->gadget &&
             split_box->text) {
 
             font_plot_style_from_css(&content->unit_len_ctx, split_box->style, &fstyle);
@@ -3642,7 +3652,8 @@ bool layout_block_context(struct box *block, int viewport_height, html_content *
     }
 
     /* special case if the block contains an radio button or checkbox */
-    if (block->gadget && (block->gadget->type == GADGET_RADIO || block->gadget->type == GADGET_CHECKBOX)) {
+    if (box_extra(block)->gadget &&
+        (box_extra(block)->gadget->type == GADGET_RADIO || box_extra(block)->gadget->type == GADGET_CHECKBOX)) {
         /* form checkbox or radio button
          * if width or height is AUTO, set it to 1em */
         gadget_unit = CSS_UNIT_EM;
@@ -4015,7 +4026,7 @@ bool layout_block_context(struct box *block, int viewport_height, html_content *
         }
 
         /* Advance to next box. */
-        if (box->type == BOX_BLOCK && !box->object && !(box->iframe) && box->children) {
+        if (box->type == BOX_BLOCK && !box->object && !(box_extra(box)->iframe) && box->children) {
             /* Down into children. */
 
             if (box == margin_collapse) {
@@ -4193,15 +4204,15 @@ bool layout_block_context(struct box *block, int viewport_height, html_content *
         layout_apply_minmax_height(&content->unit_len_ctx, block, NULL);
     }
 
-    if (block->gadget &&
-        (block->gadget->type == GADGET_TEXTAREA || block->gadget->type == GADGET_PASSWORD ||
-            block->gadget->type == GADGET_TEXTBOX)) {
+    if (box_extra(block)->gadget &&
+        (box_extra(block)->gadget->type == GADGET_TEXTAREA || box_extra(block)->gadget->type == GADGET_PASSWORD ||
+            box_extra(block)->gadget->type == GADGET_TEXTBOX)) {
         plot_font_style_t fstyle;
         int ta_width = block->padding[LEFT] + block->width + block->padding[RIGHT];
         int ta_height = block->padding[TOP] + block->height + block->padding[BOTTOM];
         font_plot_style_from_css(&content->unit_len_ctx, block->style, &fstyle);
         fstyle.background = NS_TRANSPARENT;
-        textarea_set_layout(block->gadget->data.text.ta, &fstyle, ta_width, ta_height, block->padding[TOP],
+        textarea_set_layout(box_extra(block)->gadget->data.text.ta, &fstyle, ta_width, ta_height, block->padding[TOP],
             block->padding[RIGHT], block->padding[BOTTOM], block->padding[LEFT]);
     }
 
@@ -5500,13 +5511,13 @@ static void layout_calculate_descendant_bboxes(const css_unit_ctx *unit_len_ctx,
             box->descendant_y1 = obj_height;
     }
 
-    if (box->iframe != NULL) {
+    if (box_extra(box)->iframe != NULL) {
         int x, y;
         box_coords(box, &x, &y);
 
-        browser_window_set_position(box->iframe, x, y);
-        browser_window_set_dimensions(box->iframe, box->width, box->height);
-        browser_window_reformat(box->iframe, true, box->width, box->height);
+        browser_window_set_position(box_extra(box)->iframe, x, y);
+        browser_window_set_dimensions(box_extra(box)->iframe, box->width, box->height);
+        browser_window_reformat(box_extra(box)->iframe, true, box->width, box->height);
     }
 
     if (box->type == BOX_INLINE || box->type == BOX_TEXT)
@@ -5739,8 +5750,18 @@ bool layout_document(html_content *content, int width, int height)
     bool ret;
     struct box *doc = content->layout;
     const struct gui_layout_table *font_func = content->font_func;
+    struct flex_cache_stats flex_stats;
 
-    NSLOG(wisp, DEBUG, "PROFILER: START layout_document %p", content);
+    TRACE_BEGIN("html", "layout document");
+
+    /* nothing laid out in an earlier pass may be reused */
+    layout_flex_cache_reset();
+
+    /* scratch data is carved out of a pool kept between passes, failing
+     * to create it just leaves layout allocating from the heap */
+    if (content->layout_scratch == NULL) {
+        content->layout_scratch = talloc_pool(NULL, LAYOUT_SCRATCH_POOL_SIZE);
+    }
 
     NSLOG(layout, DEBUG, "Doing layout to %ix%i of %s", width, height, nsurl_access(content_get_url(&content->base)));
 
@@ -5778,7 +5799,19 @@ bool layout_document(html_content *content, int width, int height)
     layout_calculate_descendant_bboxes(&content->unit_len_ctx, doc);
     layout_log_final_box_heights(&content->unit_len_ctx, doc);
 
-    NSLOG(wisp, DEBUG, "PROFILER: STOP layout_document %p", content);
+    if (stacking_tree_build(doc) != NSERROR_OK) {
+        NSLOG(layout, WARNING, "No memory for stacking contexts, z-index ignored");
+    }
+
+    layout_flex_cache_get_stats(&flex_stats);
+    NSLOG(layout, DEBUG, "flex items: %u laid out, %u from cache", flex_stats.layouts, flex_stats.hits);
+
+    /* anything left over from the pass is no longer needed */
+    if (content->layout_scratch != NULL) {
+        talloc_free_children(content->layout_scratch);
+    }
+
+    TRACE_END("html", "layout document");
 
     return ret;
 }
@@ -36,6 +36,7 @@
 #include <wisp/utils/corestrings.h>
 #include <wisp/utils/log.h>
 #include <wisp/utils/utils.h>
+#include "utils/talloc.h"
 
 #include <wisp/content/handlers/html/box.h>
 #include <wisp/content/handlers/html/box_inspect.h>
@@ -135,6 +136,45 @@ struct flex_ctx {
     bool needs_two_pass; /**< True if any item has % flex-basis in column flex */
 };
 
+/**
+ * Constraints a flex item is laid out with
+ */
+struct flex_layout_key {
+    unsigned int generation; /**< Cache generation, 0 if key is unused */
+    int available_width; /**< Available width passed to layout */
+    int width; /**< Item box width on entry */
+    int height; /**< Item box height on entry */
+    bool stretched; /**< Item height was set by cross-axis stretch */
+};
+
+/**
+ * Dimensions a flex item was given by laying it out
+ */
+struct flex_layout_result {
+    struct flex_layout_key key; /**< Constraints of the layout */
+    int width;
+    int height;
+    int margin[4];
+    int padding[4];
+    int border[4]; /**< Border widths */
+    bool stretched; /**< HEIGHT_STRETCHED flag after layout */
+};
+
+/**
+ * Layout cache of a flex item, see layout_flex_item()
+ */
+struct flex_layout_cache {
+    struct flex_layout_result state; /**< Layout the descendants currently reflect */
+    struct flex_layout_result measured; /**< Dimensions from the layout before that */
+    struct flex_layout_key last; /**< Constraints most recently asked for */
+};
+
+/** Current flex item layout cache generation, never 0 */
+static unsigned int layout_flex_generation = 1;
+
+/** Flex item layout cache statistics for the current generation */
+static struct flex_cache_stats layout_flex_cache_stats;
+
 /**
  * Destroy a flex layout context
  *
@@ -143,9 +183,9 @@ struct flex_ctx {
 static void layout_flex_ctx__destroy(struct flex_ctx *ctx)
 {
     if (ctx != NULL) {
-        free(ctx->item.data);
-        free(ctx->line.data);
-        free(ctx);
+        talloc_free(ctx->item.data);
+        talloc_free(ctx->line.data);
+        talloc_free(ctx);
     }
 }
 
@@ -160,21 +200,23 @@ static struct flex_ctx *layout_flex_ctx__create(html_content *content, const str
 {
     struct flex_ctx *ctx;
 
-    ctx = calloc(1, sizeof(*ctx));
+    /* only direct children of the pool are carved out of it, so
+     * everything hangs off the pool rather than the context */
+    ctx = talloc_zero(content->layout_scratch, struct flex_ctx);
     if (ctx == NULL) {
         return NULL;
     }
     ctx->line.alloc = 1;
 
     ctx->item.count = box_count_children(flex);
-    ctx->item.data = calloc(ctx->item.count, sizeof(*ctx->item.data));
+    ctx->item.data = talloc_zero_array(content->layout_scratch, struct flex_item_data, ctx->item.count);
     if (ctx->item.data == NULL) {
         layout_flex_ctx__destroy(ctx);
         return NULL;
     }
 
     ctx->line.alloc = 1;
-    ctx->line.data = calloc(ctx->line.alloc, sizeof(*ctx->line.data));
+    ctx->line.data = talloc_zero_array(content->layout_scratch, struct flex_line_data, ctx->line.alloc);
     if (ctx->line.data == NULL) {
         layout_flex_ctx__destroy(ctx);
         return NULL;
@@ -677,17 +719,16 @@ static void layout_flex__two_pass_resolve(struct flex_ctx *ctx, struct box *flex
 }
 
 /**
- * Perform layout on a flex item
+ * Lay out a flex item's box and its descendants, bypassing the cache
  *
  * \param[in] ctx              Flex layout context
- * \param[in] item             Item to lay out
+ * \param[in] b                Box of item to lay out
  * \param[in] available_width  Available width for item in pixels
  * \return true on success false on failure
  */
-static bool layout_flex_item(const struct flex_ctx *ctx, const struct flex_item_data *item, int available_width)
+static bool layout_flex__item_layout(const struct flex_ctx *ctx, struct box *b, int available_width)
 {
     bool success;
-    struct box *b = item->box;
 
     switch (b->type) {
     case BOX_BLOCK:
@@ -721,6 +762,230 @@ static bool layout_flex_item(const struct flex_ctx *ctx, const struct flex_item_
     return success;
 }
 
+
+/**
+ * Get a flex item's layout cache, creating it if necessary
+ *
+ * \param[in] b  Box of item
+ * \return the cache or NULL on allocation failure
+ */
+static struct flex_layout_cache *layout_flex__item_cache(struct box *b)
+{
+    if (b->flex_cache == NULL) {
+        b->flex_cache = calloc(1, sizeof(struct flex_layout_cache));
+    }
+    return b->flex_cache;
+}
+
+/**
+ * Make the key for laying out a flex item with its current constraints
+ *
+ * \param[in]  b                Box of item
+ * \param[in]  available_width  Available width for item in pixels
+ * \param[out] key              Updated with the key
+ */
+static void layout_flex__item_key(const struct box *b, int available_width, struct flex_layout_key *key)
+{
+    key->generation = layout_flex_generation;
+    key->available_width = available_width;
+    key->width = b->width;
+    key->height = b->height;
+    key->stretched = (b->flags & HEIGHT_STRETCHED) != 0;
+}
+
+static inline bool layout_flex__key_eq(const struct flex_layout_key *a, const struct flex_layout_key *b)
+{
+    return a->generation == b->generation && a->available_width == b->available_width && a->width == b->width &&
+        a->height == b->height && a->stretched == b->stretched;
+}
+
+/**
+ * Record the dimensions a flex item was given by a layout
+ *
+ * \param[in]  b       Box of item, after layout
+ * \param[in]  key     Constraints the layout was performed with
+ * \param[out] result  Updated with key and dimensions of b
+ */
+static void layout_flex__result_save(
+    const struct box *b, const struct flex_layout_key *key, struct flex_layout_result *result)
+{
+    result->key = *key;
+    result->width = b->width;
+    result->height = b->height;
+    for (int i = 0; i < 4; i++) {
+        result->margin[i] = b->margin[i];
+        result->padding[i] = b->padding[i];
+        result->border[i] = b->border[i].width;
+    }
+    result->stretched = (b->flags & HEIGHT_STRETCHED) != 0;
+}
+
+/**
+ * Give a flex item the dimensions recorded from an earlier layout
+ *
+ * \param[in] b       Box of item
+ * \param[in] result  Recorded dimensions
+ */
+static void layout_flex__result_restore(struct box *b, const struct flex_layout_result *result)
+{
+    b->width = result->width;
+    b->height = result->height;
+    for (int i = 0; i < 4; i++) {
+        b->margin[i] = result->margin[i];
+        b->padding[i] = result->padding[i];
+        b->border[i].width = result->border[i];
+    }
+    if (result->stretched) {
+        b->flags |= HEIGHT_STRETCHED;
+    } else {
+        b->flags &= ~HEIGHT_STRETCHED;
+    }
+}
+
+/**
+ * Lay out a flex item and record the result in its cache
+ *
+ * \param[in] ctx    Flex layout context
+ * \param[in] b      Box of item to lay out
+ * \param[in] cache  The item's layout cache
+ * \param[in] key    Constraints the item is being laid out with
+ * \return true on success false on failure
+ */
+static bool layout_flex__item_relayout(
+    const struct flex_ctx *ctx, struct box *b, struct flex_layout_cache *cache, const struct flex_layout_key *key)
+{
+    layout_flex_cache_stats.layouts++;
+    if (!layout_flex__item_layout(ctx, b, key->available_width)) {
+        cache->state.key.generation = 0;
+        cache->measured.key.generation = 0;
+        return false;
+    }
+
+    /* Keep the previous layout's dimensions; the placement pass often
+     * asks for them again after the measurement pass. */
+    cache->measured = cache->state;
+    layout_flex__result_save(b, key, &cache->state);
+
+    /* Dimensions are only reusable when the item resolved its own height;
+     * otherwise the caller derives it from the item's descendants. */
+    if (cache->measured.height == AUTO) {
+        cache->measured.key.generation = 0;
+    }
+
+    return true;
+}
+
+/**
+ * Perform layout on a flex item
+ *
+ * Flex layout lays each item out several times with the constraints of
+ * the measurement and placement passes, and nested flex containers do the
+ * same for each of those, so without care the work grows exponentially
+ * with nesting depth.
+ *
+ * If the item's descendants were last laid out with the same constraints
+ * nothing is done beyond restoring the item's dimensions. If the item was
+ * measured with these constraints before but its descendants have since
+ * been laid out differently, only the recorded dimensions are restored;
+ * layout_flex__item_commit() brings the descendants up to date once the
+ * item's final constraints are known.
+ *
+ * \param[in] ctx              Flex layout context
+ * \param[in] item             Item to lay out
+ * \param[in] available_width  Available width for item in pixels
+ * \return true on success false on failure
+ */
+static bool layout_flex_item(const struct flex_ctx *ctx, const struct flex_item_data *item, int available_width)
+{
+    struct box *b = item->box;
+    struct flex_layout_cache *cache;
+    struct flex_layout_key key;
+
+    cache = layout_flex__item_cache(b);
+    if (cache == NULL) {
+        layout_flex_cache_stats.layouts++;
+        return layout_flex__item_layout(ctx, b, available_width);
+    }
+
+    layout_flex__item_key(b, available_width, &key);
+    cache->last = key;
+
+    if (layout_flex__key_eq(&key, &cache->state.key)) {
+        layout_flex_cache_stats.hits++;
+        layout_flex__result_restore(b, &cache->state);
+        return true;
+    }
+
+    if (layout_flex__key_eq(&key, &cache->measured.key)) {
+        layout_flex_cache_stats.hits++;
+        layout_flex__result_restore(b, &cache->measured);
+        return true;
+    }
+
+    return layout_flex__item_relayout(ctx, b, cache, &key);
+}
+
+/**
+ * Ensure a flex item's descendants reflect its final constraints
+ *
+ * The item's own position and dimensions, as adjusted by the flex
+ * algorithm after layout, are preserved.
+ *
+ * \param[in] ctx   Flex layout context
+ * \param[in] item  Item to update
+ * \return true on success false on failure
+ */
+static bool layout_flex__item_commit(const struct flex_ctx *ctx, const struct flex_item_data *item)
+{
+    struct box *b = item->box;
+    struct flex_layout_cache *cache = b->flex_cache;
+    struct flex_layout_result placed;
+    int x = b->x;
+    int y = b->y;
+    bool success;
+
+    if (cache == NULL || cache->last.generation != layout_flex_generation ||
+        layout_flex__key_eq(&cache->last, &cache->state.key)) {
+        return true;
+    }
+
+    layout_flex__result_save(b, &cache->last, &placed);
+
+    b->width = cache->last.width;
+    b->height = cache->last.height;
+    if (cache->last.stretched) {
+        b->flags |= HEIGHT_STRETCHED;
+    } else {
+        b->flags &= ~HEIGHT_STRETCHED;
+    }
+
+    NSLOG(flex, DEEPDEBUG, "box %p: relayout to match final constraints", b);
+
+    success = layout_flex__item_relayout(ctx, b, cache, &cache->last);
+
+    layout_flex__result_restore(b, &placed);
+    b->x = x;
+    b->y = y;
+
+    return success;
+}
+
+/* exported interface documented in html/layout_internal.h */
+void layout_flex_cache_reset(void)
+{
+    layout_flex_generation++;
+    if (layout_flex_generation == 0) {
+        layout_flex_generation = 1;
+    }
+    layout_flex_cache_stats = (struct flex_cache_stats){0};
+}
+
+/* exported interface documented in html/layout_internal.h */
+void layout_flex_cache_get_stats(struct flex_cache_stats *stats)
+{
+    *stats = layout_flex_cache_stats;
+}
+
 /**
  * Calculate an item's base and target main sizes.
  *
@@ -1052,7 +1317,7 @@ static bool layout_flex_ctx__ensure_line(struct flex_ctx *ctx)
         return true;
     }
 
-    temp = realloc(ctx->line.data, sizeof(*ctx->line.data) * line_alloc);
+    temp = talloc_realloc(ctx->content->layout_scratch, ctx->line.data, struct flex_line_data, line_alloc);
     if (temp == NULL) {
         return false;
     }
@@ -2026,6 +2291,15 @@ bool layout_flex(struct box *flex, int available_width, html_content *content)
 
     layout_flex__place_lines(ctx);
 
+    /* Items whose final dimensions came from the layout cache may have
+     * descendants laid out for other constraints. */
+    for (size_t i = 0; i < ctx->item.count; i++) {
+        if (!layout_flex__item_commit(ctx, &ctx->item.data[i])) {
+            success = false;
+            goto cleanup;
+        }
+    }
+
     if (flex->height == AUTO) {
         flex->height = ctx->horizontal ? ctx->cross_size : ctx->main_size;
     }
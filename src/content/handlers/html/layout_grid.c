@@ -53,6 +53,7 @@
 #include <wisp/utils/corestrings.h>
 #include <wisp/utils/log.h>
 #include <wisp/utils/utils.h>
+#include "utils/talloc.h"
 #include "content/handlers/html/layout_grid.h"
 #include "content/handlers/html/layout_internal.h"
 
@@ -104,15 +105,18 @@ static grid_placement_phase_t get_placement_phase(int col_start, int row_start)
 }
 
 /**
- * Ensure row_heights array has capacity for at least required_row + 1 elements.
- * Grows the array by doubling capacity as needed.
+ * Ensure the per-row arrays have capacity for at least required_row + 1 elements.
+ * Grows the arrays by doubling capacity as needed.
  *
+ * \param scratch          talloc context the arrays are allocated from
  * \param row_heights      Pointer to the row_heights array pointer
+ * \param row_done         Pointer to the row_first_item_done array pointer
  * \param capacity         Pointer to current capacity
  * \param required_row     The row index that must be accessible
  * \return true on success, false on allocation failure
  */
-static bool ensure_row_capacity(int **row_heights, int *capacity, int required_row)
+static bool
+ensure_row_capacity(const void *scratch, int **row_heights, bool **row_done, int *capacity, int required_row)
 {
     if (required_row < *capacity) {
         return true; /* Already have capacity */
@@ -123,15 +127,21 @@ static bool ensure_row_capacity(int **row_heights, int *capacity, int required_r
         new_cap *= 2;
     }
 
-    int *new_rows = realloc(*row_heights, new_cap * sizeof(int));
+    int *new_rows = talloc_realloc(scratch, *row_heights, int, new_cap);
     if (!new_rows) {
         return false;
     }
-
     /* Zero-initialize the new elements */
     memset(new_rows + *capacity, 0, (new_cap - *capacity) * sizeof(int));
-
     *row_heights = new_rows;
+
+    bool *new_done = talloc_realloc(scratch, *row_done, bool, new_cap);
+    if (!new_done) {
+        return false;
+    }
+    memset(new_done + *capacity, 0, (new_cap - *capacity) * sizeof(bool));
+    *row_done = new_done;
+
     *capacity = new_cap;
     return true;
 }
@@ -141,12 +151,15 @@ static bool ensure_row_capacity(int **row_heights, int *capacity, int required_r
  *
  * Reads the computed row track values and populates the row_heights array.
  *
+ * \param scratch            talloc context the arrays are allocated from
  * \param style              Grid container computed style
  * \param row_heights        Pointer to row heights array pointer
+ * \param row_done           Pointer to the row_first_item_done array pointer
  * \param row_heights_capacity Pointer to array capacity
  * \return true on success, false on allocation failure
  */
-static bool init_row_heights_from_css(const css_computed_style *style, int **row_heights, int *row_heights_capacity)
+static bool init_row_heights_from_css(const void *scratch, const css_computed_style *style, int **row_heights,
+    bool **row_done, int *row_heights_capacity)
 {
     if (style == NULL) {
         return true;
@@ -165,7 +178,7 @@ static bool init_row_heights_from_css(const css_computed_style *style, int **row
     NSLOG(layout, WARNING, "GRID LAYOUT: initializing %d row tracks from CSS", n_row_tracks);
 
     for (int32_t i = 0; i < n_row_tracks; i++) {
-        if (!ensure_row_capacity(row_heights, row_heights_capacity, i)) {
+        if (!ensure_row_capacity(scratch, row_heights, row_done, row_heights_capacity, i)) {
             return false;
         }
 
@@ -425,11 +438,11 @@ void layout_minmax_grid(struct box *grid, const struct gui_layout_table *font_fu
     num_cols = layout_grid_get_column_count(grid);
 
     /* Allocate per-column min/max arrays */
-    col_min = calloc(num_cols, sizeof(int));
-    col_max = calloc(num_cols, sizeof(int));
+    col_min = talloc_zero_array(content->layout_scratch, int, num_cols);
+    col_max = talloc_zero_array(content->layout_scratch, int, num_cols);
     if (!col_min || !col_max) {
-        free(col_min);
-        free(col_max);
+        talloc_free(col_min);
+        talloc_free(col_max);
         grid->min_width.value = 0;
         grid->max_width = 0;
         return;
@@ -526,8 +539,8 @@ void layout_minmax_grid(struct box *grid, const struct gui_layout_table *font_fu
         max += (num_cols - 1) * gap_px;
     }
 
-    free(col_min);
-    free(col_max);
+    talloc_free(col_min);
+    talloc_free(col_max);
 
     /* Ensure max >= min */
     if (max < min)
@@ -695,6 +708,13 @@ static void layout_grid_compute_tracks(struct box *grid, int available_width, in
 
 bool layout_grid(struct box *grid, int available_width, html_content *content)
 {
+    void *scratch = content->layout_scratch;
+    int *col_widths = NULL;
+    int *row_heights = NULL;
+    bool *row_first_item_done = NULL;
+    bool *occupied = NULL;
+    struct grid_item_cache *item_cache = NULL;
+    bool ret = false;
     struct box *child;
     int grid_width = available_width;
     int grid_height = 0;
@@ -706,13 +726,10 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
     NSLOG(layout, WARNING, "GRID LAYOUT: grid=%p avail_w=%d num_cols=%d children=%p", grid, available_width, num_cols,
         grid->children);
 
-    int *col_widths; /* Array allocated locally */
-
-    /* Just use stack for small col counts or VLA/malloc */
-    /* VLA is risky for stack size. Malloc is safer. */
-    col_widths = malloc(sizeof(int) * num_cols);
+    /* Per-pass arrays come from the layout scratch pool */
+    col_widths = talloc_array(scratch, int, num_cols);
     if (!col_widths)
-        return false;
+        goto cleanup;
 
     /* Get Gap for layout positioning */
     int gap_px = 0;
@@ -736,26 +753,22 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
 
     /* Dynamic row heights array - starts at 100, grows as needed */
     int row_heights_capacity = 100;
-    int *row_heights = calloc(row_heights_capacity, sizeof(int));
+    row_heights = talloc_zero_array(scratch, int, row_heights_capacity);
     if (!row_heights) {
-        free(col_widths);
-        return false;
+        goto cleanup;
     }
 
     /* Track if any row needs re-stretch (height increased after first item in row) */
-    bool *row_first_item_done = calloc(row_heights_capacity, sizeof(bool));
+    row_first_item_done = talloc_zero_array(scratch, bool, row_heights_capacity);
     bool needs_pass3 = false;
     if (!row_first_item_done) {
-        free(col_widths);
-        free(row_heights);
-        return false;
+        goto cleanup;
     }
 
     /* Initialize row heights from CSS grid-template-rows */
-    if (!init_row_heights_from_css(grid->style, &row_heights, &row_heights_capacity)) {
-        free(col_widths);
-        free(row_heights);
-        return false;
+    if (!init_row_heights_from_css(
+            scratch, grid->style, &row_heights, &row_first_item_done, &row_heights_capacity)) {
+        goto cleanup;
     }
 
     /* CSS Grid spec §8: Read grid-auto-flow to determine placement
@@ -786,15 +799,12 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
      * We use a simple bitmap: occupied[row * num_cols + col]
      */
     bool is_dense = (auto_flow == CSS_GRID_AUTO_FLOW_ROW_DENSE || auto_flow == CSS_GRID_AUTO_FLOW_COLUMN_DENSE);
-    bool *occupied = NULL;
     int occupied_max_rows = row_heights_capacity; /* Use same capacity */
 
     /* Always allocate occupied grid for 3-phase placement */
-    occupied = calloc(occupied_max_rows * num_cols, sizeof(bool));
+    occupied = talloc_zero_array(scratch, bool, occupied_max_rows * num_cols);
     if (!occupied) {
-        free(col_widths);
-        free(row_heights);
-        return false;
+        goto cleanup;
     }
     NSLOG(
         layout, INFO, "GRID LAYOUT: allocated %dx%d occupation grid (dense=%d)", num_cols, occupied_max_rows, is_dense);
@@ -806,15 +816,10 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
     }
 
     /* Allocate item cache to avoid re-parsing CSS in pass 3 */
-    struct grid_item_cache *item_cache = NULL;
     if (item_count > 0) {
-        item_cache = calloc(item_count, sizeof(struct grid_item_cache));
+        item_cache = talloc_zero_array(scratch, struct grid_item_cache, item_count);
         if (!item_cache) {
-            free(occupied);
-            free(row_first_item_done);
-            free(row_heights);
-            free(col_widths);
-            return false;
+            goto cleanup;
         }
     }
     int cache_idx = 0;
@@ -1040,17 +1045,13 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
                 child->type == BOX_INLINE_FLEX || child->type == BOX_GRID || child->type == BOX_INLINE_GRID) {
                 child->float_container = grid;
                 if (!layout_block_context(child, -1, content)) {
-                    free(col_widths);
-                    free(row_heights);
-                    return false;
+                    goto cleanup;
                 }
                 child->float_container = NULL;
             } else if (child->type == BOX_TABLE) {
                 child->float_container = grid;
                 if (!layout_table(child, child_width, content)) {
-                    free(col_widths);
-                    free(row_heights);
-                    return false;
+                    goto cleanup;
                 }
                 child->float_container = NULL;
             }
@@ -1068,10 +1069,8 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
                 child->border[BOTTOM].width, total_height, row_span, height_per_row);
 
             for (int r = item_row; r < item_row + row_span; r++) {
-                if (!ensure_row_capacity(&row_heights, &row_heights_capacity, r)) {
-                    free(col_widths);
-                    free(row_heights);
-                    return false;
+                if (!ensure_row_capacity(scratch, &row_heights, &row_first_item_done, &row_heights_capacity, r)) {
+                    goto cleanup;
                 }
                 if (height_per_row > row_heights[r]) {
                     NSLOG(layout, WARNING, "GRID ROW_HEIGHT UPDATE: row[%d] %d -> %d (from child %p)", r,
@@ -1364,10 +1363,13 @@ bool layout_grid(struct box *grid, int available_width, html_content *content)
         grid->width = intrinsic_width;
     }
 
-    free(item_cache);
-    free(row_first_item_done);
-    free(occupied);
-    free(row_heights);
-    free(col_widths);
-    return true;
+    ret = true;
+
+cleanup:
+    talloc_free(item_cache);
+    talloc_free(row_first_item_done);
+    talloc_free(occupied);
+    talloc_free(row_heights);
+    talloc_free(col_widths);
+    return ret;
 }
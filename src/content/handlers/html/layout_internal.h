@@ -70,6 +70,30 @@ bool layout_table(struct box *table, int available_width, struct html_content *c
  */
 bool layout_flex(struct box *flex, int available_width, struct html_content *content);
 
+/**
+ * Flex item layout cache statistics.
+ */
+struct flex_cache_stats {
+    unsigned int layouts; /**< flex items actually laid out */
+    unsigned int hits; /**< flex item layouts answered from the cache */
+};
+
+/**
+ * Start a new flex item layout cache generation.
+ *
+ * Must be called before each layout pass so nothing cached in an earlier
+ * pass, before the box tree or its styles changed, is reused. Also resets
+ * the cache statistics.
+ */
+void layout_flex_cache_reset(void);
+
+/**
+ * Get flex item layout cache statistics for the current generation.
+ *
+ * \param[out] stats updated with the statistics
+ */
+void layout_flex_cache_get_stats(struct flex_cache_stats *stats);
+
 /**
  * Redistribute auto margin space for a column flex container.
  *
@@ -165,7 +189,7 @@ static inline bool lh__box_is_object(const struct box *b)
 /** Layout helper: Check whether box is replaced. */
 static inline bool lh__box_is_replace(const struct box *b)
 {
-    return b->gadget || lh__box_is_object(b);
+    return box_extra(b)->gadget || lh__box_is_object(b);
 }
 
 /** Layout helper: Check for CSS border on given side. */
@@ -192,7 +192,7 @@ static nserror html_object_callback(hlcache_handle *object, const hlcache_event
     switch (event->type) {
     case CONTENT_MSG_LOADING:
         if (c->base.status != CONTENT_STATUS_LOADING && c->bw != NULL)
-            content_open(object, c->bw, &c->base, box->object_params);
+            content_open(object, c->bw, &c->base, box_extra(box)->object_params);
         break;
 
     case CONTENT_MSG_READY:
@@ -307,6 +307,14 @@ static nserror html_object_callback(hlcache_handle *object, const hlcache_event
         break;
 
     case CONTENT_MSG_ERROR:
+        /* forget an object which was shown while partly decoded */
+        if (box->object == object) {
+            box->object = NULL;
+        }
+        if (box->background == object) {
+            box->background = NULL;
+        }
+
         hlcache_handle_release(object);
 
         o->content = NULL;
@@ -335,6 +343,16 @@ static nserror html_object_callback(hlcache_handle *object, const hlcache_event
             if (!box_visible(box))
                 break;
 
+            if (object != (o->background ? box->background : box->object)) {
+                /* A partly decoded image is drawn as it arrives only where
+                 * doing so cannot change the layout.
+                 */
+                if (!o->background && !(box->flags & REPLACE_DIM))
+                    break;
+
+                html_object_done(box, object, o->background);
+            }
+
             box_coords(box, &x, &y);
 
             if (object == box->background) {
@@ -718,7 +736,7 @@ nserror html_object_open_objects(html_content *html, struct browser_window *bw)
         if (content_get_type(object->content) == CONTENT_NONE)
             continue;
 
-        content_open(object->content, bw, &html->base, object->box->object_params);
+        content_open(object->content, bw, &html->base, box_extra(object->box)->object_params);
     }
     return NSERROR_OK;
 }
@@ -55,6 +55,8 @@
 #include <wisp/utils/messages.h>
 #include <wisp/utils/nsoption.h>
 #include <wisp/utils/utils.h>
+#include "utils/phase.h"
+#include "utils/trace.h"
 #include "content/textsearch.h"
 #include "desktop/browser_private.h"
 #include "desktop/scrollbar.h"
@@ -630,8 +632,8 @@ static bool html_redraw_file(int x, int y, int width, int height, struct box *bo
     font_plot_style_from_css(unit_len_ctx, box->style, &fstyle);
     fstyle.background = background_colour;
 
-    if (box->gadget->value) {
-        text = box->gadget->value;
+    if (box_extra(box)->gadget->value) {
+        text = box_extra(box)->gadget->value;
     } else {
         text = messages_get("Form_Drop");
     }
@@ -1653,75 +1655,309 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
     const struct redraw_context *ctx);
 
 /**
- * Render children with negative z-index before parent's background.
+ * Compute the CSS transform of a box.
  *
- * This function collects children with negative z-index and renders them
- * BEFORE the parent's background is drawn, per CSS stacking order spec.
+ * \param  box     box to compute the transform of
+ * \param  box_x   x coordinate of the box, before scaling
+ * \param  box_y   y coordinate of the box, before scaling
+ * \param  matrix  updated with the transform, left as identity if none
+ * \return true if the box has a transform other than identity
+ */
+static bool html_redraw_box_transform(const struct box *box, int box_x, int box_y, float matrix[6])
+{
+    uint32_t transform_count = 0;
+    const css_transform_function *transform_functions = NULL;
+    uint8_t transform_type;
+
+    if (box->style == NULL) {
+        return false;
+    }
+
+    transform_type = css_computed_transform(box->style, &transform_count, &transform_functions);
+
+    /* Only apply transform if this box owns a DOM node - prevents child boxes
+     * sharing the parent's style from having the transform applied again */
+    if (transform_type != CSS_TRANSFORM_FUNCTIONS || transform_count == 0 || transform_functions == NULL ||
+        box->node == NULL) {
+        return false;
+    }
+
+    /* CSS Transforms spec says:
+     * 1. Start with identity matrix
+     * 2. Translate by transform-origin
+     * 3. Multiply by each transform function left-to-right
+     * 4. Translate by negated transform-origin
+     *
+     * Matrix format: [a, b, c, d, tx, ty] where:
+     * | a  c  tx |
+     * | b  d  ty |
+     * | 0  0  1  |
+     */
+    float cx = box_x + box->width / 2.0f; /* transform-origin default: center */
+    float cy = box_y + box->height / 2.0f;
+
+    /* Build composed transform matrix M (starting with identity, no pre-translate) */
+    for (uint32_t i = 0; i < transform_count; i++) {
+        const css_transform_function *func = &transform_functions[i];
+        float val1 = FIXTOFLT(func->value1);
+        float val2 = FIXTOFLT(func->value2);
+
+        /* Note: Percentage conversion depends on the transform function type.
+         * For translate functions:
+         *   - translateX(%) uses width
+         *   - translateY(%) uses height
+         *   - translate(x%, y%) uses width for x, height for y
+         * Other functions handle percentages within their case blocks.
+         */
+
+        switch (func->type) {
+        case CSS_TRANSFORM_FUNC_TRANSLATE: {
+            /* M' = M * T(tx,ty) -- right multiply by translation */
+            float tx = val1, ty = val2;
+            if (func->unit1 == CSS_UNIT_PCT)
+                tx = (val1 / 100.0f) * box->width;
+            if (func->unit2 == CSS_UNIT_PCT)
+                ty = (val2 / 100.0f) * box->height;
+            matrix[4] += tx * matrix[0] + ty * matrix[2];
+            matrix[5] += tx * matrix[1] + ty * matrix[3];
+            break;
+        }
+        case CSS_TRANSFORM_FUNC_TRANSLATEX: {
+            float tx = val1;
+            if (func->unit1 == CSS_UNIT_PCT)
+                tx = (val1 / 100.0f) * box->width;
+            matrix[4] += tx * matrix[0];
+            matrix[5] += tx * matrix[1];
+            break;
+        }
+        case CSS_TRANSFORM_FUNC_TRANSLATEY: {
+            float ty = val1;
+            if (func->unit1 == CSS_UNIT_PCT)
+                ty = (val1 / 100.0f) * box->height; /* Use HEIGHT for translateY */
+            matrix[4] += ty * matrix[2];
+            matrix[5] += ty * matrix[3];
+            break;
+        }
+        case CSS_TRANSFORM_FUNC_SCALE: {
+            /* M' = M * S(sx,sy) -- right multiply by scale */
+            float sx = val1;
+            float sy = (func->value2 == 0) ? sx : val2;
+            matrix[0] *= sx;
+            matrix[1] *= sx;
+            matrix[2] *= sy;
+            matrix[3] *= sy;
+            /* tx, ty unchanged when multiplying by pure scale from right */
+            break;
+        }
+        case CSS_TRANSFORM_FUNC_SCALEX:
+            matrix[0] *= val1;
+            matrix[1] *= val1;
+            break;
+        case CSS_TRANSFORM_FUNC_SCALEY:
+            matrix[2] *= val1;
+            matrix[3] *= val1;
+            break;
+        case CSS_TRANSFORM_FUNC_ROTATE: {
+            /* M' = M * R(θ) -- right multiply by rotation */
+            float rad = val1 * M_PI / 180.0f;
+            float cos_a = cosf(rad), sin_a = sinf(rad);
+            float a = matrix[0], b = matrix[1], c = matrix[2], d = matrix[3];
+            matrix[0] = a * cos_a + c * sin_a;
+            matrix[1] = b * cos_a + d * sin_a;
+            matrix[2] = c * cos_a - a * sin_a;
+            matrix[3] = d * cos_a - b * sin_a;
+            /* tx, ty unchanged when multiplying by pure rotation from right */
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    /* Apply transform-origin wrap: Final = T(cx,cy) * M * T(-cx,-cy)
+     * This computes to: tx' = tx + cx*(1-a) - cy*c, ty' = ty + cy*(1-d) - cx*b */
+    float a = matrix[0], b = matrix[1], c = matrix[2], d = matrix[3];
+    matrix[4] += cx * (1.0f - a) - cy * c;
+    matrix[5] += cy * (1.0f - d) - cx * b;
+
+    /* Check if the matrix has any non-identity transform */
+    bool is_identity = (matrix[0] == 1.0f && matrix[1] == 0.0f && matrix[2] == 0.0f && matrix[3] == 1.0f &&
+        matrix[4] == 0.0f && matrix[5] == 0.0f);
+
+    return !is_identity;
+}
+
+/**
+ * Find where to draw a box listed in a stacking context.
+ *
+ * The offsets recorded when the stacking context tree was built are taken
+ * from layout; scrolling of the boxes in between is applied here.
+ *
+ * \param  root      box establishing the stacking context
+ * \param  box       box listed in the stacking context, or one in between
+ * \param  x_record  recorded offset of box's parent
+ * \param  y_record  recorded offset of box's parent
+ * \param  x_offset  coordinate of root's children
+ * \param  y_offset  coordinate of root's children
+ * \param  x_parent  updated to coordinate of box's parent
+ * \param  y_parent  updated to coordinate of box's parent
+ */
+static void html_redraw_stacked_parent(const struct box *root, const struct box *box, int x_record, int y_record,
+    int x_offset, int y_offset, int *x_parent, int *y_parent)
+{
+    const struct box *b = box;
+
+    *x_parent = x_offset + x_record;
+    *y_parent = y_offset + y_record;
+
+    for (;;) {
+        b = (b->type == BOX_FLOAT_LEFT || b->type == BOX_FLOAT_RIGHT) ? b->float_container : b->parent;
+        if (b == NULL || b == root) {
+            break;
+        }
+        *x_parent -= scrollbar_get_offset(b->scroll_x);
+        *y_parent -= scrollbar_get_offset(b->scroll_y);
+    }
+}
+
+/**
+ * Reapply the clips and transforms of the boxes between a stacking context
+ * and a box listed in it.
+ *
+ * Those boxes are not drawing the listed box, so their clip rectangles and
+ * transforms are applied here, outermost first, as html_redraw_box() would
+ * have for its children.
+ *
+ * \param  node        stacking node of root
+ * \param  index       innermost clipping or transformed box, or -1
+ * \param  root        box establishing the stacking context
+ * \param  x_offset    coordinate of root's children
+ * \param  y_offset    coordinate of root's children
+ * \param  clip        clip rectangle, updated with the boxes' clips
+ * \param  scale       scale for redraw
+ * \param  data        redraw data
+ * \param  transforms  incremented for each transform pushed
+ * \param  ctx         current redraw context
+ */
+static void html_redraw_stacked_ancestors(const struct stacking_node *node, int index, const struct box *root,
+    int x_offset, int y_offset, struct rect *clip, float scale, const struct content_redraw_data *data,
+    unsigned int *transforms, const struct redraw_context *ctx)
+{
+    const struct stacking_ancestor *ancestor;
+    const struct box *box;
+    float matrix[6] = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+    enum css_overflow_e overflow_x, overflow_y;
+    bool positioned;
+    int x_parent, y_parent, x, y;
+
+    if (index < 0) {
+        return;
+    }
+
+    ancestor = &node->ancestors[index];
+    box = ancestor->box;
+    html_redraw_stacked_ancestors(node, ancestor->parent, root, x_offset, y_offset, clip, scale, data, transforms, ctx);
+
+    html_redraw_stacked_parent(
+        root, box, ancestor->x_parent, ancestor->y_parent, x_offset, y_offset, &x_parent, &y_parent);
+
+    if (ctx->plot->push_transform != NULL &&
+        html_redraw_box_transform(box, x_parent + box->x, y_parent + box->y, matrix)) {
+        if (ctx->plot->push_transform(ctx, matrix) == NSERROR_OK) {
+            (*transforms)++;
+            /* children of a transformed box keep the incoming clip */
+            return;
+        }
+    }
+
+    overflow_x = css_computed_overflow_x(box->style);
+    overflow_y = css_computed_overflow_y(box->style);
+    if ((overflow_x == CSS_OVERFLOW_VISIBLE && overflow_y == CSS_OVERFLOW_VISIBLE) ||
+        (box->type != BOX_BLOCK && box->type != BOX_INLINE_BLOCK && box->type != BOX_TABLE_CELL &&
+            box->object == NULL)) {
+        return;
+    }
+
+    if (box->abs_containing_block != NULL && data != NULL) {
+        box_coords((struct box *)box, &x, &y);
+        x += data->x;
+        y += data->y;
+    } else {
+        x = x_parent + box->x;
+        y = y_parent + box->y;
+    }
+
+    /* clip to the border box, as html_redraw_box() does */
+    positioned = (css_computed_position(box->style) != CSS_POSITION_STATIC);
+    if (positioned || overflow_x != CSS_OVERFLOW_VISIBLE) {
+        int x0 = (x - box->border[LEFT].width) * scale;
+        int x1 = (x + box->padding[LEFT] + box->width + box->padding[RIGHT] + box->border[RIGHT].width) * scale;
+        clip->x0 = max(clip->x0, x0);
+        clip->x1 = min(clip->x1, x1);
+    }
+    if (positioned || overflow_y != CSS_OVERFLOW_VISIBLE) {
+        int y0 = (y - box->border[TOP].width) * scale;
+        int y1 = (y + box->padding[TOP] + box->height + box->padding[BOTTOM] + box->border[BOTTOM].width) * scale;
+        clip->y0 = max(clip->y0, y0);
+        clip->y1 = min(clip->y1, y1);
+    }
+}
+
+/**
+ * Draw the boxes listed in one layer of a stacking context.
  *
  * \param  html      html content
- * \param  box       box to render negative z-index children of
- * \param  x_parent  coordinate of parent box
- * \param  y_parent  coordinate of parent box
+ * \param  root      box establishing the stacking context
+ * \param  layer     sorted boxes to draw
+ * \param  x_offset  coordinate of root's children
+ * \param  y_offset  coordinate of root's children
  * \param  clip      clip rectangle
  * \param  scale     scale for redraw
- * \param  current_background_color  background colour
+ * \param  current_background_color  background colour under root
  * \param  data      redraw data
- * \param  ctx       redraw context
+ * \param  ctx       current redraw context
  * \return true if successful, false otherwise
  */
-static bool html_redraw_negative_zindex_children(const html_content *html, struct box *box, int x_parent, int y_parent,
-    const struct rect *clip, float scale, colour current_background_color, const struct content_redraw_data *data,
-    const struct redraw_context *ctx)
+static bool html_redraw_stacked_layer(const html_content *html, const struct box *root,
+    const struct stacking_context *layer, int x_offset, int y_offset, const struct rect *clip, float scale,
+    colour current_background_color, const struct content_redraw_data *data, const struct redraw_context *ctx)
 {
-    struct box *c;
-    int x_offset, y_offset;
-    struct stacking_context negative_zindex;
+    const struct zindex_entry *entry;
+    struct rect entry_clip;
+    unsigned int transforms;
+    bool ok = true;
     size_t i;
+    int x_parent, y_parent;
 
-    /* Only process if this box doesn't create a stacking context itself */
-    if (box_creates_stacking_context(box)) {
-        return true; /* Stacking context isolates children */
-    }
-
-    x_offset = x_parent + box->x - scrollbar_get_offset(box->scroll_x);
-    y_offset = y_parent + box->y - scrollbar_get_offset(box->scroll_y);
+    for (i = 0; i < layer->count && ok; i++) {
+        entry = &layer->entries[i];
+        entry_clip = *clip;
+        transforms = 0;
+        html_redraw_stacked_ancestors(
+            root->stacking, entry->ancestor, root, x_offset, y_offset, &entry_clip, scale, data, &transforms, ctx);
 
-    stacking_context_init(&negative_zindex);
-
-    /* Collect only negative z-index children */
-    for (c = box->children; c; c = c->next) {
-        if (c->type == BOX_FLOAT_LEFT || c->type == BOX_FLOAT_RIGHT) {
-            continue;
+        if (entry_clip.x0 < entry_clip.x1 && entry_clip.y0 < entry_clip.y1) {
+            html_redraw_stacked_parent(
+                root, entry->box, entry->x_parent, entry->y_parent, x_offset, y_offset, &x_parent, &y_parent);
+            ok = html_redraw_box(
+                html, entry->box, x_parent, y_parent, &entry_clip, scale, current_background_color, data, ctx);
         }
-        int32_t z = box_get_z_index(c);
-        if (z != Z_INDEX_AUTO && z < 0) {
-            if (!stacking_context_add(&negative_zindex, c, z, x_offset, y_offset)) {
-                stacking_context_fini(&negative_zindex);
-                return true; /* Fallback: let normal path handle
-                              */
-            }
-        }
-    }
 
-    /* Render negative z-index children sorted */
-    if (negative_zindex.count > 0) {
-        stacking_context_sort(&negative_zindex);
-        for (i = 0; i < negative_zindex.count; i++) {
-            if (!html_redraw_box(html, negative_zindex.entries[i].box, negative_zindex.entries[i].x_parent,
-                    negative_zindex.entries[i].y_parent, clip, scale, current_background_color, data, ctx)) {
-                stacking_context_fini(&negative_zindex);
-                return false;
-            }
+        while (transforms-- > 0) {
+            ctx->plot->pop_transform(ctx);
         }
     }
 
-    stacking_context_fini(&negative_zindex);
-    return true;
+    return ok;
 }
 
 /**
  * Draw the various children of a box.
  *
+ * Children with an explicit z-index are drawn by the box establishing the
+ * stacking context they belong to, from the stacking context tree built
+ * after layout. If building that failed they are drawn in document order.
+ *
  * \param  html	     html content
  * \param  box	     box to draw children of
  * \param  x_parent  coordinate of parent box
@@ -1739,18 +1975,11 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
 {
     struct box *c;
     int x_offset, y_offset;
-    struct stacking_context negative_zindex; /* z-index < 0 */
-    struct stacking_context positive_zindex; /* z-index >= 0 */
-    size_t i;
-    bool render_ok = true;
+    bool stacked = (html->layout->stacking != NULL);
 
     x_offset = x_parent + box->x - scrollbar_get_offset(box->scroll_x);
     y_offset = y_parent + box->y - scrollbar_get_offset(box->scroll_y);
 
-    /* Initialize separate stacking contexts for negative and positive */
-    stacking_context_init(&negative_zindex);
-    stacking_context_init(&positive_zindex);
-
     /*
      * CSS 2.1 Stacking Order:
      * 1. Background and borders of the stacking context root
@@ -1760,110 +1989,44 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
      * 5. In-flow, non-positioned inline descendants
      * 6. z-index: 0 stacking contexts and positioned descendants
      * 7. Positive z-index stacking contexts (sorted)
+     *
+     * Our background and borders have already been drawn.
      */
 
-    /* Pass 1: Collect positioned descendants, split by z-index sign */
-    for (c = box->children; c; c = c->next) {
-        if (c->type == BOX_FLOAT_LEFT || c->type == BOX_FLOAT_RIGHT) {
-            continue;
-        }
-        int32_t z = box_get_z_index(c);
-        if (z != Z_INDEX_AUTO) {
-            /* Collect into appropriate list based on z-index sign
-             */
-            struct stacking_context *ctx_ptr = (z < 0) ? &negative_zindex : &positive_zindex;
-            if (!stacking_context_add(ctx_ptr, c, z, x_offset, y_offset)) {
-                goto fallback;
-            }
-        } else {
-            /* Recurse into children to find positioned descendants
-             */
-            if (!stacking_context_collect_subtree(&negative_zindex, &positive_zindex, c, x_offset, y_offset)) {
-                goto fallback;
-            }
-        }
-    }
-    for (c = box->float_children; c; c = c->next_float) {
-        int32_t z = box_get_z_index(c);
-        if (z != Z_INDEX_AUTO) {
-            struct stacking_context *ctx_ptr = (z < 0) ? &negative_zindex : &positive_zindex;
-            if (!stacking_context_add(ctx_ptr, c, z, x_offset, y_offset)) {
-                goto fallback;
-            }
-        } else {
-            if (!stacking_context_collect_subtree(&negative_zindex, &positive_zindex, c, x_offset, y_offset)) {
-                goto fallback;
-            }
-        }
+    if (stacked && box->stacking != NULL &&
+        !html_redraw_stacked_layer(html, box, &box->stacking->negative, x_offset, y_offset, clip, scale,
+            current_background_color, data, ctx)) {
+        return false;
     }
 
-    /* NOTE: Pass 2 (negative z-index) removed - negative z-index elements
-     * are now rendered by html_redraw_negative_zindex_children() before
-     * the parent's background is drawn, per CSS 2.1 stacking order. */
-
-    /* Pass 2: Render in-flow children (z-index: auto) */
     for (c = box->children; c; c = c->next) {
         if (c->type == BOX_FLOAT_LEFT || c->type == BOX_FLOAT_RIGHT) {
             continue;
         }
-        int32_t z = box_get_z_index(c);
-        if (z != Z_INDEX_AUTO) {
-            continue; /* Already in deferred list */
+        if (stacked && box_get_z_index(c) != Z_INDEX_AUTO) {
+            continue; /* Drawn by its stacking context */
         }
         if (!html_redraw_box(html, c, x_offset, y_offset, clip, scale, current_background_color, data, ctx)) {
-            render_ok = false;
-            goto cleanup;
+            return false;
         }
     }
 
-    /* Pass 3: Render floats */
     for (c = box->float_children; c; c = c->next_float) {
-        int32_t z = box_get_z_index(c);
-        if (z != Z_INDEX_AUTO) {
-            continue; /* Already in deferred list */
+        if (stacked && box_get_z_index(c) != Z_INDEX_AUTO) {
+            continue; /* Drawn by its stacking context */
         }
         if (!html_redraw_box(html, c, x_offset, y_offset, clip, scale, current_background_color, data, ctx)) {
-            render_ok = false;
-            goto cleanup;
+            return false;
         }
     }
 
-    /* Pass 4: Render positive z-index elements (on top of in-flow content)
-     */
-    if (positive_zindex.count > 0) {
-        stacking_context_sort(&positive_zindex);
-        for (i = 0; i < positive_zindex.count; i++) {
-            if (!html_redraw_box(html, positive_zindex.entries[i].box, positive_zindex.entries[i].x_parent,
-                    positive_zindex.entries[i].y_parent, clip, scale, current_background_color, data, ctx)) {
-                render_ok = false;
-                goto cleanup;
-            }
-        }
+    if (stacked && box->stacking != NULL &&
+        !html_redraw_stacked_layer(html, box, &box->stacking->positive, x_offset, y_offset, clip, scale,
+            current_background_color, data, ctx)) {
+        return false;
     }
-    goto cleanup;
 
-fallback:
-    /* Allocation failed - render in document order as fallback */
-    stacking_context_fini(&negative_zindex);
-    stacking_context_fini(&positive_zindex);
-    for (c = box->children; c; c = c->next) {
-        if (c->type != BOX_FLOAT_LEFT && c->type != BOX_FLOAT_RIGHT) {
-            if (!html_redraw_box(html, c, x_offset, y_offset, clip, scale, current_background_color, data, ctx)) {
-                return false;
-            }
-        }
-    }
-    for (c = box->float_children; c; c = c->next_float) {
-        if (!html_redraw_box(html, c, x_offset, y_offset, clip, scale, current_background_color, data, ctx)) {
-            return false;
-        }
-    }
     return true;
-
-cleanup:
-    stacking_context_fini(&negative_zindex);
-    stacking_context_fini(&positive_zindex);
-    return render_ok;
 }
 
 /**
@@ -1896,6 +2059,7 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
     int x_scrolled, y_scrolled;
     struct rect viewport_clip;
     struct box *bg_box = NULL;
+    const struct form_control *gadget = box_extra(box)->gadget;
     css_computed_clip_rect css_rect;
     enum css_overflow_e overflow_x = CSS_OVERFLOW_VISIBLE;
     enum css_overflow_e overflow_y = CSS_OVERFLOW_VISIBLE;
@@ -1914,126 +2078,9 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
         overflow_x = css_computed_overflow_x(box->style);
         overflow_y = css_computed_overflow_y(box->style);
 
-        /* Check for CSS transform and apply if available */
-        uint32_t transform_count = 0;
-        const css_transform_function *transform_functions = NULL;
-        uint8_t transform_type = css_computed_transform(box->style, &transform_count, &transform_functions);
-
-
-        if (transform_type == CSS_TRANSFORM_FUNCTIONS && transform_count > 0 && transform_functions != NULL &&
-            ctx->plot->push_transform != NULL && box->node != NULL) {
-            /* Only apply transform if this box owns a DOM node - prevents child boxes
-             * sharing the parent's style from having the transform applied again */
-
-            /* CSS Transforms spec says:
-             * 1. Start with identity matrix
-             * 2. Translate by transform-origin
-             * 3. Multiply by each transform function left-to-right
-             * 4. Translate by negated transform-origin
-             *
-             * Matrix format: [a, b, c, d, tx, ty] where:
-             * | a  c  tx |
-             * | b  d  ty |
-             * | 0  0  1  |
-             */
-            /* Use transform_matrix from function scope */
-            int box_x = x_parent + box->x;
-            int box_y = y_parent + box->y;
-            float cx = box_x + box->width / 2.0f; /* transform-origin default: center */
-            float cy = box_y + box->height / 2.0f;
-
-            /* Build composed transform transform_matrix M (starting with identity, no pre-translate) */
-            for (uint32_t i = 0; i < transform_count; i++) {
-                const css_transform_function *func = &transform_functions[i];
-                float val1 = FIXTOFLT(func->value1);
-                float val2 = FIXTOFLT(func->value2);
-
-                /* Note: Percentage conversion depends on the transform function type.
-                 * For translate functions:
-                 *   - translateX(%) uses width
-                 *   - translateY(%) uses height
-                 *   - translate(x%, y%) uses width for x, height for y
-                 * Other functions handle percentages within their case blocks.
-                 */
-
-                switch (func->type) {
-                case CSS_TRANSFORM_FUNC_TRANSLATE: {
-                    /* M' = M * T(tx,ty) -- right multiply by translation */
-                    float tx = val1, ty = val2;
-                    if (func->unit1 == CSS_UNIT_PCT)
-                        tx = (val1 / 100.0f) * box->width;
-                    if (func->unit2 == CSS_UNIT_PCT)
-                        ty = (val2 / 100.0f) * box->height;
-                    transform_matrix[4] += tx * transform_matrix[0] + ty * transform_matrix[2];
-                    transform_matrix[5] += tx * transform_matrix[1] + ty * transform_matrix[3];
-                    break;
-                }
-                case CSS_TRANSFORM_FUNC_TRANSLATEX: {
-                    float tx = val1;
-                    if (func->unit1 == CSS_UNIT_PCT)
-                        tx = (val1 / 100.0f) * box->width;
-                    transform_matrix[4] += tx * transform_matrix[0];
-                    transform_matrix[5] += tx * transform_matrix[1];
-                    break;
-                }
-                case CSS_TRANSFORM_FUNC_TRANSLATEY: {
-                    float ty = val1;
-                    if (func->unit1 == CSS_UNIT_PCT)
-                        ty = (val1 / 100.0f) * box->height; /* Use HEIGHT for translateY */
-                    transform_matrix[4] += ty * transform_matrix[2];
-                    transform_matrix[5] += ty * transform_matrix[3];
-                    break;
-                }
-                case CSS_TRANSFORM_FUNC_SCALE: {
-                    /* M' = M * S(sx,sy) -- right multiply by scale */
-                    float sx = val1;
-                    float sy = (func->value2 == 0) ? sx : val2;
-                    transform_matrix[0] *= sx;
-                    transform_matrix[1] *= sx;
-                    transform_matrix[2] *= sy;
-                    transform_matrix[3] *= sy;
-                    /* tx, ty unchanged when multiplying by pure scale from right */
-                    break;
-                }
-                case CSS_TRANSFORM_FUNC_SCALEX:
-                    transform_matrix[0] *= val1;
-                    transform_matrix[1] *= val1;
-                    break;
-                case CSS_TRANSFORM_FUNC_SCALEY:
-                    transform_matrix[2] *= val1;
-                    transform_matrix[3] *= val1;
-                    break;
-                case CSS_TRANSFORM_FUNC_ROTATE: {
-                    /* M' = M * R(θ) -- right multiply by rotation */
-                    float rad = val1 * M_PI / 180.0f;
-                    float cos_a = cosf(rad), sin_a = sinf(rad);
-                    float a = transform_matrix[0], b = transform_matrix[1], c = transform_matrix[2],
-                          d = transform_matrix[3];
-                    transform_matrix[0] = a * cos_a + c * sin_a;
-                    transform_matrix[1] = b * cos_a + d * sin_a;
-                    transform_matrix[2] = c * cos_a - a * sin_a;
-                    transform_matrix[3] = d * cos_a - b * sin_a;
-                    /* tx, ty unchanged when multiplying by pure rotation from right */
-                    break;
-                }
-                default:
-                    break;
-                }
-            }
-
-            /* Apply transform-origin wrap: Final = T(cx,cy) * M * T(-cx,-cy)
-             * This computes to: tx' = tx + cx*(1-a) - cy*c, ty' = ty + cy*(1-d) - cx*b */
-            float a = transform_matrix[0], b = transform_matrix[1], c = transform_matrix[2], d = transform_matrix[3];
-            transform_matrix[4] += cx * (1.0f - a) - cy * c;
-            transform_matrix[5] += cy * (1.0f - d) - cx * b;
-
-            /* Check if the transform_matrix has any non-identity transform */
-            bool is_identity = (transform_matrix[0] == 1.0f && transform_matrix[1] == 0.0f &&
-                transform_matrix[2] == 0.0f && transform_matrix[3] == 1.0f && transform_matrix[4] == 0.0f &&
-                transform_matrix[5] == 0.0f);
-
-            /* Mark that we need a transform, but don't push yet - wait until after early bailouts */
-            need_transform = !is_identity;
+        /* Check for CSS transform, but don't push it yet - wait until after early bailouts */
+        if (ctx->plot->push_transform != NULL) {
+            need_transform = html_redraw_box_transform(box, x_parent + box->x, y_parent + box->y, transform_matrix);
         }
     }
 
@@ -2216,7 +2263,7 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
     if (html_redraw_printing) {
         if (r.y1 > html_redraw_printing_border) {
             if (r.y1 - r.y0 <= html_redraw_printing_border &&
-                (box->type == BOX_TEXT || box->type == BOX_TABLE_CELL || box->object || box->gadget)) {
+                (box->type == BOX_TEXT || box->type == BOX_TABLE_CELL || box->object || gadget)) {
                 /*remember the highest of all points from the
                 not printed elements*/
                 if (r.y0 < html_redraw_printing_top_cropped)
@@ -2314,19 +2361,6 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
         }
     }
 
-    /* CSS 2.1: Render children with negative z-index BEFORE parent's
-     * background. This only applies if this box doesn't create its own
-     * stacking context. */
-    if (!html_redraw_negative_zindex_children(
-            html, box, x_parent, y_parent, &r, scale, current_background_color, data, ctx)) {
-        {
-            {
-                result = false;
-                goto cleanup;
-            }
-        }
-    }
-
     /* background colour and image for block level content and replaced
      * inlines */
 
@@ -2338,9 +2372,10 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
      * for BOX_TEXT it's in an inline */
     if (bg_box && bg_box->type != BOX_BR && bg_box->type != BOX_TEXT && bg_box->type != BOX_INLINE_END &&
         (bg_box->type != BOX_INLINE || bg_box->object || bg_box->flags & IFRAME || box->flags & REPLACE_DIM ||
-            (bg_box->gadget != NULL &&
-                (bg_box->gadget->type == GADGET_TEXTAREA || bg_box->gadget->type == GADGET_TEXTBOX ||
-                    bg_box->gadget->type == GADGET_PASSWORD)))) {
+            (box_extra(bg_box)->gadget != NULL &&
+                (box_extra(bg_box)->gadget->type == GADGET_TEXTAREA ||
+                    box_extra(bg_box)->gadget->type == GADGET_TEXTBOX ||
+                    box_extra(bg_box)->gadget->type == GADGET_PASSWORD)))) {
         const char *tag = "";
         const char *cls = "";
         dom_string *name = NULL;
@@ -2490,9 +2525,9 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
     /* borders for block level content and replaced inlines */
     if (box->style && box->type != BOX_TEXT && box->type != BOX_INLINE_END &&
         (box->type != BOX_INLINE || box->object || box->flags & IFRAME || box->flags & REPLACE_DIM ||
-            (box->gadget != NULL &&
-                (box->gadget->type == GADGET_TEXTAREA || box->gadget->type == GADGET_TEXTBOX ||
-                    box->gadget->type == GADGET_PASSWORD))) &&
+            (gadget != NULL &&
+                (gadget->type == GADGET_TEXTAREA || gadget->type == GADGET_TEXTBOX ||
+                    gadget->type == GADGET_PASSWORD))) &&
         (border_top || border_right || border_bottom || border_left)) {
         /* Compute unscaled box position for border drawing.
          * For normal boxes: x_parent + box->x
@@ -2921,27 +2956,27 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
                 goto cleanup;
             }
         }
-    } else if (box->iframe) {
+    } else if (box_extra(box)->iframe) {
         /* Offset is passed to browser window redraw unscaled */
-        browser_window_redraw(box->iframe, x + padding_left, y + padding_top, &r, ctx);
+        browser_window_redraw(box_extra(box)->iframe, x + padding_left, y + padding_top, &r, ctx);
 
-    } else if (box->gadget && box->gadget->type == GADGET_CHECKBOX) {
-        if (!html_redraw_checkbox(x + padding_left, y + padding_top, width, height, box->gadget->selected, ctx)) {
+    } else if (gadget && gadget->type == GADGET_CHECKBOX) {
+        if (!html_redraw_checkbox(x + padding_left, y + padding_top, width, height, gadget->selected, ctx)) {
             {
                 result = false;
                 goto cleanup;
             }
         }
 
-    } else if (box->gadget && box->gadget->type == GADGET_RADIO) {
-        if (!html_redraw_radio(x + padding_left, y + padding_top, width, height, box->gadget->selected, ctx)) {
+    } else if (gadget && gadget->type == GADGET_RADIO) {
+        if (!html_redraw_radio(x + padding_left, y + padding_top, width, height, gadget->selected, ctx)) {
             {
                 result = false;
                 goto cleanup;
             }
         }
 
-    } else if (box->gadget && box->gadget->type == GADGET_FILE) {
+    } else if (gadget && gadget->type == GADGET_FILE) {
         if (!html_redraw_file(x + padding_left, y + padding_top, width, height, box, scale, current_background_color,
                 &html->unit_len_ctx, ctx)) {
             {
@@ -2950,10 +2985,9 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
             }
         }
 
-    } else if (box->gadget &&
-        (box->gadget->type == GADGET_TEXTAREA || box->gadget->type == GADGET_PASSWORD ||
-            box->gadget->type == GADGET_TEXTBOX)) {
-        textarea_redraw(box->gadget->data.text.ta, x, y, current_background_color, scale, &r, ctx);
+    } else if (gadget &&
+        (gadget->type == GADGET_TEXTAREA || gadget->type == GADGET_PASSWORD || gadget->type == GADGET_TEXTBOX)) {
+        textarea_redraw(gadget->data.text.ta, x, y, current_background_color, scale, &r, ctx);
 
     } else if (box->text) {
         if (!html_redraw_text_box(html, box, x, y, &r, scale, current_background_color, ctx)) {
@@ -3039,7 +3073,7 @@ bool html_redraw_box(const html_content *html, struct box *box, int x_parent, in
     /* scrollbars */
     if (((box->style && box->type != BOX_BR && box->type != BOX_TABLE && box->type != BOX_INLINE &&
              box->type != BOX_FLEX && box->type != BOX_INLINE_FLEX && box->type != BOX_GRID &&
-             box->type != BOX_INLINE_GRID && (box->gadget == NULL || box->gadget->type != GADGET_TEXTAREA) &&
+             box->type != BOX_INLINE_GRID && (gadget == NULL || gadget->type != GADGET_TEXTAREA) &&
              (overflow_x == CSS_OVERFLOW_SCROLL || overflow_x == CSS_OVERFLOW_AUTO ||
                  overflow_y == CSS_OVERFLOW_SCROLL || overflow_y == CSS_OVERFLOW_AUTO)) ||
             (box->object && content_get_type(box->object) == CONTENT_HTML)) &&
@@ -3107,6 +3141,7 @@ bool html_redraw(
     struct box *box;
     bool result = true;
     bool select, select_only;
+    enum phase previous;
     /* The layout can be NULL if we are in the process of rebuilding it */
     if (html->layout == NULL)
         return true;
@@ -3116,7 +3151,8 @@ bool html_redraw(
         .fill_colour = data->background_colour,
     };
 
-    NSLOG(wisp, DEBUG, "PROFILER: START HTML redraw %p", c);
+    TRACE_BEGIN("html", "redraw");
+    previous = phase_enter(PHASE_REDRAW);
 
     box = html->layout;
 
@@ -3157,6 +3193,7 @@ bool html_redraw(
             html->visible_select_menu, data->x + menu_x, data->y + menu_y, data->scale, clip, ctx);
     }
 
-    NSLOG(wisp, DEBUG, "PROFILER: STOP HTML redraw %p", c);
+    phase_leave(previous);
+    TRACE_END("html", "redraw");
     return result;
 }
@@ -39,6 +39,7 @@
 #include <wisp/utils/corestrings.h>
 #include <wisp/utils/log.h>
 #include <wisp/utils/messages.h>
+#include "utils/trace.h"
 #include "content/content_factory.h"
 #include "content/handlers/javascript/js.h"
 
@@ -639,7 +640,7 @@ dom_hubbub_error html_process_script(void *ctx, dom_node *node)
     }
 
     NSLOG(wisp, INFO, "html_process_script: content %p parser %p node %p", c, c->parser, node);
-    NSLOG(wisp, DEBUG, "PROFILER: START JS execute %p", node);
+    TRACE_BEGIN("js", "process script");
 
     exc = dom_element_get_attribute(node, corestring_dom_type, &mimetype);
     if (exc != DOM_NO_ERR || mimetype == NULL) {
@@ -658,7 +659,7 @@ dom_hubbub_error html_process_script(void *ctx, dom_node *node)
     }
 
     dom_string_unref(mimetype);
-    NSLOG(wisp, DEBUG, "PROFILER: STOP JS execute %p", node);
+    TRACE_END("js", "process script");
 
     return err;
 }
@@ -21,11 +21,13 @@
  * CSS z-index stacking context utilities implementation.
  */
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #include <wisp/content/handlers/html/box.h>
+#include <wisp/content/handlers/html/box_inspect.h>
 #include <wisp/utils/utils.h>
 #include "content/handlers/html/stacking.h"
 
@@ -133,6 +135,7 @@ bool stacking_context_add(struct stacking_context *ctx, struct box *box, int32_t
     ctx->entries[ctx->count].z_index = z_index;
     ctx->entries[ctx->count].x_parent = x_parent;
     ctx->entries[ctx->count].y_parent = y_parent;
+    ctx->entries[ctx->count].ancestor = -1;
     ctx->count++;
 
     return true;
@@ -158,49 +161,340 @@ void stacking_context_fini(struct stacking_context *ctx)
 }
 
 /* See stacking.h for documentation */
-bool stacking_context_collect_subtree(struct stacking_context *negative_ctx, struct stacking_context *positive_ctx,
-    struct box *box, int x_parent, int y_parent)
+void stacking_node_destroy(struct stacking_node *node)
+{
+    if (node == NULL) {
+        return;
+    }
+    stacking_context_fini(&node->negative);
+    stacking_context_fini(&node->positive);
+    free(node->ancestors);
+    free(node);
+}
+
+/**
+ * Drop the stacking node of a box.
+ *
+ * Split text shares the node of the box it was split from, so only the
+ * original box frees it.
+ *
+ * \param box  Box to drop the stacking node of
+ */
+static void stacking_node_release(struct box *box)
+{
+    if (!(box->flags & CLONE)) {
+        stacking_node_destroy(box->stacking);
+    }
+    box->stacking = NULL;
+}
+
+/* See stacking.h for documentation */
+void stacking_tree_destroy(struct box *root)
 {
     struct box *c;
-    int x_offset, y_offset;
 
-    if (box == NULL) {
+    stacking_node_release(root);
+
+    for (c = root->children; c; c = c->next) {
+        stacking_tree_destroy(c);
+    }
+}
+
+/**
+ * Determine if a box clips or transforms its descendants.
+ *
+ * \param box  Box to check
+ * \return true if the box has overflow other than visible or a transform
+ */
+static bool stacking_box_clips_or_transforms(const struct box *box)
+{
+    uint32_t count = 0;
+    const css_transform_function *functions = NULL;
+
+    if (box->style == NULL) {
+        return false;
+    }
+
+    if (box->parent != NULL && (css_computed_overflow_x(box->style) != CSS_OVERFLOW_VISIBLE ||
+                                   css_computed_overflow_y(box->style) != CSS_OVERFLOW_VISIBLE)) {
         return true;
     }
 
-    /* Calculate this box's position */
-    x_offset = x_parent + box->x;
-    y_offset = y_parent + box->y;
+    /* As when drawing, only the box owning the element is transformed */
+    return box->node != NULL && css_computed_transform(box->style, &count, &functions) == CSS_TRANSFORM_FUNCTIONS &&
+        count > 0 && functions != NULL;
+}
+
+/**
+ * Record a clipping or transformed box in a stacking node.
+ *
+ * \param node      Stacking node
+ * \param box       The clipping or transformed box
+ * \param x_parent  X offset of box's parent within the stacking context
+ * \param y_parent  Y offset of box's parent within the stacking context
+ * \param parent    Index of the next clipping or transformed box out, or -1
+ * \return index of the record, or -1 on allocation failure
+ */
+static int
+stacking_node_add_ancestor(struct stacking_node *node, const struct box *box, int x_parent, int y_parent, int parent)
+{
+    struct stacking_ancestor *ancestor;
+
+    if (node->ancestor_count >= node->ancestor_capacity) {
+        size_t new_capacity = (node->ancestor_capacity == 0) ? 16 : node->ancestor_capacity * 2;
+        struct stacking_ancestor *new_ancestors;
+        if (new_capacity > INT_MAX) {
+            return -1;
+        }
+        new_ancestors = realloc(node->ancestors, new_capacity * sizeof(*new_ancestors));
+        if (new_ancestors == NULL) {
+            return -1;
+        }
+        node->ancestors = new_ancestors;
+        node->ancestor_capacity = new_capacity;
+    }
+
+    ancestor = &node->ancestors[node->ancestor_count];
+    ancestor->box = box;
+    ancestor->x_parent = x_parent;
+    ancestor->y_parent = y_parent;
+    ancestor->parent = parent;
+
+    return (int)node->ancestor_count++;
+}
+
+static bool stacking_node_build(struct box *root);
+static bool
+stacking_node_collect(struct stacking_node *node, struct box *box, int x_parent, int y_parent, int ancestor);
+
+/**
+ * Collect a box into a stacking context, or descend into it.
+ *
+ * \param node      Stacking node to collect into
+ * \param c         Box to collect
+ * \param x_parent  X offset of c's parent within the stacking context
+ * \param y_parent  Y offset of c's parent within the stacking context
+ * \param ancestor  Innermost clipping or transformed box above c, or -1
+ * \return true on success, false on allocation failure
+ */
+static bool stacking_node_collect_box(struct stacking_node *node, struct box *c, int x_parent, int y_parent,
+    int ancestor)
+{
+    struct stacking_context *layer;
+    int32_t z = box_get_z_index(c);
 
-    /* Check if this box has explicit z-index */
-    int32_t z = box_get_z_index(box);
     if (z != Z_INDEX_AUTO) {
-        /* Collect into appropriate list based on z-index sign */
-        struct stacking_context *ctx = (z < 0) ? negative_ctx : positive_ctx;
-        if (!stacking_context_add(ctx, box, z, x_parent, y_parent)) {
-            return false; /* Allocation failed */
+        layer = (z < 0) ? &node->negative : &node->positive;
+        if (!stacking_context_add(layer, c, z, x_parent, y_parent)) {
+            return false;
+        }
+        layer->entries[layer->count - 1].ancestor = ancestor;
+        return stacking_node_build(c);
+    }
+
+    stacking_node_release(c);
+
+    if (stacking_box_clips_or_transforms(c)) {
+        ancestor = stacking_node_add_ancestor(node, c, x_parent, y_parent, ancestor);
+        if (ancestor < 0) {
+            return false;
         }
-        /* Don't recurse into this subtree - it will be rendered
-         * separately when we render this deferred element */
-        return true;
     }
 
-    /* Recurse into children to find positioned descendants */
+    return stacking_node_collect(node, c, x_parent + c->x, y_parent + c->y, ancestor);
+}
+
+/**
+ * Collect the boxes with explicit z-index painted in a stacking context.
+ *
+ * Descends through boxes with z-index auto, dropping any stacking node left
+ * on them by an earlier layout and recording those which clip or transform,
+ * and builds the nested stacking context of each box it collects.
+ *
+ * \param node      Stacking node to collect into
+ * \param box       Box whose children to collect from
+ * \param x_parent  X offset of box's children within the stacking context
+ * \param y_parent  Y offset of box's children within the stacking context
+ * \param ancestor  Innermost clipping or transformed box, box included, or -1
+ * \return true on success, false on allocation failure
+ */
+static bool
+stacking_node_collect(struct stacking_node *node, struct box *box, int x_parent, int y_parent, int ancestor)
+{
+    struct box *c;
+
     for (c = box->children; c; c = c->next) {
         if (c->type == BOX_FLOAT_LEFT || c->type == BOX_FLOAT_RIGHT) {
-            continue; /* Handle floats separately */
+            /* Reached through the float container */
+            continue;
         }
-        if (!stacking_context_collect_subtree(negative_ctx, positive_ctx, c, x_offset, y_offset)) {
+        if (!stacking_node_collect_box(node, c, x_parent, y_parent, ancestor)) {
             return false;
         }
     }
 
-    /* Also check float children */
     for (c = box->float_children; c; c = c->next_float) {
-        if (!stacking_context_collect_subtree(negative_ctx, positive_ctx, c, x_offset, y_offset)) {
+        if (!stacking_node_collect_box(node, c, x_parent, y_parent, ancestor)) {
             return false;
         }
     }
 
     return true;
 }
+
+/**
+ * Build the stacking node of a box establishing a stacking context.
+ *
+ * \param root  Box establishing the stacking context
+ * \return true on success, false on allocation failure
+ */
+static bool stacking_node_build(struct box *root)
+{
+    struct stacking_node *node = root->stacking;
+
+    if (root->flags & CLONE) {
+        stacking_node_release(root);
+        return true;
+    }
+
+    if (node == NULL) {
+        node = calloc(1, sizeof(*node));
+        if (node == NULL) {
+            return false;
+        }
+        root->stacking = node;
+    } else {
+        /* Keep the storage of the previous layout */
+        node->negative.count = 0;
+        node->positive.count = 0;
+        node->ancestor_count = 0;
+    }
+
+    if (!stacking_node_collect(node, root, 0, 0, -1)) {
+        return false;
+    }
+
+    stacking_context_sort(&node->negative);
+    stacking_context_sort(&node->positive);
+
+    return true;
+}
+
+/* See stacking.h for documentation */
+nserror stacking_tree_build(struct box *root)
+{
+    if (!stacking_node_build(root)) {
+        stacking_tree_destroy(root);
+        return NSERROR_NOMEM;
+    }
+    return NSERROR_OK;
+}
+
+
+/**
+ * Determine if a point lies over a box or its visible overflow.
+ *
+ * \param box  box to test
+ * \param x    point relative to box
+ * \param y    point relative to box
+ * \return true if the point is within the box's area
+ */
+static bool stacking_box_area_contains(const struct box *box, int x, int y)
+{
+    if (x >= -box->border[LEFT].width &&
+        x < box->padding[LEFT] + box->width + box->padding[RIGHT] + box->border[RIGHT].width &&
+        y >= -box->border[TOP].width &&
+        y < box->padding[TOP] + box->height + box->padding[BOTTOM] + box->border[BOTTOM].width) {
+        return true;
+    }
+
+    if (box->style != NULL && (css_computed_overflow_x(box->style) != CSS_OVERFLOW_VISIBLE ||
+                                  css_computed_overflow_y(box->style) != CSS_OVERFLOW_VISIBLE)) {
+        return false;
+    }
+
+    return box->descendant_x0 <= x && x < box->descendant_x1 && box->descendant_y0 <= y && y < box->descendant_y1;
+}
+
+/**
+ * Determine if a point is clipped away from a box by its ancestors.
+ *
+ * Applies the overflow clip html_redraw_box() sets up for the children of
+ * each ancestor, so a stacked box scrolled or clipped out of view does not
+ * take the pointer from the content drawn where it would have been.
+ *
+ * \param box  box to test
+ * \param x    point to test, in global document coordinates
+ * \param y    point to test, in global document coordinates
+ * \return true if an ancestor clips the point away
+ */
+static bool stacking_box_clipped(const struct box *box, int x, int y)
+{
+    const struct box *a;
+
+    for (a = box->parent; a != NULL && a->parent != NULL; a = a->parent) {
+        enum css_overflow_e overflow_x, overflow_y;
+        bool positioned;
+        int a_x, a_y;
+
+        if (a->style == NULL) {
+            continue;
+        }
+        overflow_x = css_computed_overflow_x(a->style);
+        overflow_y = css_computed_overflow_y(a->style);
+        if ((overflow_x == CSS_OVERFLOW_VISIBLE && overflow_y == CSS_OVERFLOW_VISIBLE) ||
+            (a->type != BOX_BLOCK && a->type != BOX_INLINE_BLOCK && a->type != BOX_TABLE_CELL && a->object == NULL)) {
+            continue;
+        }
+
+        box_coords((struct box *)a, &a_x, &a_y);
+        positioned = (css_computed_position(a->style) != CSS_POSITION_STATIC);
+        if ((positioned || overflow_x != CSS_OVERFLOW_VISIBLE) &&
+            (x < a_x - a->border[LEFT].width ||
+                x >= a_x + a->padding[LEFT] + a->width + a->padding[RIGHT] + a->border[RIGHT].width)) {
+            return true;
+        }
+        if ((positioned || overflow_y != CSS_OVERFLOW_VISIBLE) &&
+            (y < a_y - a->border[TOP].width ||
+                y >= a_y + a->padding[TOP] + a->height + a->padding[BOTTOM] + a->border[BOTTOM].width)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* See stacking.h for documentation */
+struct box *stacking_box_at_point(struct box *root, int x, int y)
+{
+    const struct stacking_node *node = root->stacking;
+    size_t i;
+
+    if (node == NULL) {
+        return NULL;
+    }
+
+    for (i = node->positive.count; i > 0; i--) {
+        struct box *b = node->positive.entries[i - 1].box;
+        struct box *found;
+        int box_x, box_y;
+
+        found = stacking_box_at_point(b, x, y);
+        if (found != NULL) {
+            return found;
+        }
+
+        /* a hidden box, such as a closed menu, lets the pointer through
+         * to whatever is painted below it */
+        if (css_computed_visibility(b->style) == CSS_VISIBILITY_HIDDEN) {
+            continue;
+        }
+
+        box_coords(b, &box_x, &box_y);
+        if (stacking_box_area_contains(b, x - box_x, y - box_y) && !stacking_box_clipped(b, x, y)) {
+            return b;
+        }
+    }
+
+    return NULL;
+}
@@ -28,6 +28,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <wisp/utils/errors.h>
+
 struct box;
 
 /** Value indicating z-index: auto */
@@ -74,6 +76,7 @@ struct zindex_entry {
     int32_t z_index;
     int x_parent;
     int y_parent;
+    int ancestor; /**< innermost clipping or transformed ancestor, or -1 */
 };
 
 /**
@@ -119,21 +122,82 @@ void stacking_context_sort(struct stacking_context *ctx);
 void stacking_context_fini(struct stacking_context *ctx);
 
 /**
- * Recursively collect positioned elements with explicit z-index from subtree.
+ * Box between a stacking context and its entries which clips or
+ * transforms its descendants.
+ *
+ * Such boxes have z-index auto, so the entries below them are drawn by
+ * the stacking context rather than from within the box; their clip and
+ * transform are applied again, outermost first, before drawing an entry.
+ */
+struct stacking_ancestor {
+    const struct box *box; /**< the clipping or transformed box */
+    int x_parent; /**< offset of the box's parent, as for entries */
+    int y_parent;
+    int parent; /**< next clipping or transformed box out, or -1 */
+};
+
+/**
+ * Node of the stacking context tree.
+ *
+ * Attached to the layout root and to every box with an explicit z-index.
+ * Lists the descendants with an explicit z-index which are painted in this
+ * stacking context, that is those not inside a nested one. Each list is
+ * sorted by z-index, boxes with equal z-index staying in document order.
+ *
+ * Entry offsets are those of the entry's parent relative to the origin of
+ * the stacking context box's children, without any scrolling applied.
+ * Each entry refers to the innermost box between it and the stacking
+ * context box which clips or transforms it, and those boxes link outwards
+ * to the stacking context box.
+ */
+struct stacking_node {
+    struct stacking_context negative; /**< z-index < 0 */
+    struct stacking_context positive; /**< z-index >= 0 */
+    struct stacking_ancestor *ancestors; /**< clipping and transformed boxes */
+    size_t ancestor_count;
+    size_t ancestor_capacity;
+};
+
+/**
+ * Build the stacking context tree of a laid out box tree.
  *
- * This finds all descendants with z-index != auto and adds them to the
- * appropriate stacking context based on z-index sign (negative or positive).
- * It stops recursion when it finds a positioned element (which will be
- * rendered separately with its own subtree).
+ * Must be called after each layout. Nodes left over from earlier layouts
+ * are reused or freed.
  *
- * \param negative_ctx  Stacking context for z-index < 0 elements
- * \param positive_ctx  Stacking context for z-index >= 0 elements
- * \param box           Root of subtree to scan
- * \param x_parent      X offset of parent
- * \param y_parent      Y offset of parent
- * \return true on success, false on allocation failure
+ * \param root  Root of the box tree
+ * \return NSERROR_OK on success or NSERROR_NOMEM on allocation failure, in
+ *         which case the tree has no stacking nodes at all
+ */
+nserror stacking_tree_build(struct box *root);
+
+/**
+ * Free every stacking node in a box tree.
+ *
+ * \param root  Root of the box tree
+ */
+void stacking_tree_destroy(struct box *root);
+
+/**
+ * Find the topmost box with an explicit z-index at a point.
+ *
+ * Searches the stacking context tree built after layout from the top
+ * layer down, so no part of the box tree needs to be rescanned or sorted.
+ * Only stacking contexts painted above the in-flow content of their parent
+ * context are considered. Boxes with visibility hidden, and points clipped
+ * away by the overflow of a box's ancestors, are passed over.
+ *
+ * \param root  box establishing the stacking context to search
+ * \param x     point to find, in global document coordinates
+ * \param y     point to find, in global document coordinates
+ * \return box painted topmost at the point, or NULL if that is in-flow content
+ */
+struct box *stacking_box_at_point(struct box *root, int x, int y);
+
+/**
+ * Free a stacking node.
+ *
+ * \param node  Node to free, may be NULL
  */
-bool stacking_context_collect_subtree(struct stacking_context *negative_ctx, struct stacking_context *positive_ctx,
-    struct box *box, int x_parent, int y_parent);
+void stacking_node_destroy(struct stacking_node *node);
 
 #endif /* NEOSURF_HTML_STACKING_H */
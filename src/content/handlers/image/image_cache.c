@@ -27,7 +27,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <nsutils/time.h>
+
 #include <wisp/bitmap.h>
+#include <wisp/content/content.h>
 #include <wisp/content/content_protected.h>
 #include <wisp/content/llcache.h>
 #include <wisp/desktop/gui_internal.h>
@@ -47,6 +50,9 @@
  */
 typedef unsigned int cache_age;
 
+/** Minimum interval between redraws of a partly decoded image (ms) */
+#define IMAGE_CACHE_PROGRESS_INTERVAL 250
+
 /**
  * Image cache entry
  */
@@ -60,6 +66,10 @@ struct image_cache_entry_s {
     struct bitmap *bitmap;
     /** routine to convert content into bitmap */
     image_cache_convert_fn *convert;
+    /** bitmap is still being decoded into and must be kept */
+    bool partial;
+    /** time the partly decoded bitmap was last redrawn (ms) */
+    uint64_t progress_time;
 
     /* Statistics for replacement algorithm */
 
@@ -179,10 +189,18 @@ static struct image_cache_entry_s *image_cache__find(const struct content *c)
 /**
  * Update the image cache statistics with an entry.
  *
+ * The entry is charged for the bitmap it actually holds, which for
+ * rasterised vector content need not be the content's intrinsic size.
+ *
  * \param centry The image cache entry to update the stats with.
  */
 static void image_cache_stats_bitmap_add(struct image_cache_entry_s *centry)
 {
+    if ((centry->bitmap != NULL) && (guit->bitmap->get_width != NULL) && (guit->bitmap->get_height != NULL)) {
+        centry->bitmap_size = (size_t)guit->bitmap->get_width(centry->bitmap) *
+            (size_t)guit->bitmap->get_height(centry->bitmap) * 4;
+    }
+
     centry->bitmap_age = image_cache->current_age;
     centry->conversion_count++;
 
@@ -302,7 +320,8 @@ static void image_cache__clean(struct image_cache_s *icache)
     while (centry != NULL) {
         if ((icache->current_age - centry->redraw_age) > icache->params.bg_clean_time) {
             /* only consider older entries, avoids active entries */
-            if ((icache->total_bitmap_size > (icache->params.limit - icache->params.hysteresis)) &&
+            if ((centry->partial == false) &&
+                (icache->total_bitmap_size > (icache->params.limit - icache->params.hysteresis)) &&
                 (rand() > (RAND_MAX / 2))) {
                 image_cache__free_bitmap(centry);
             }
@@ -477,7 +496,9 @@ void image_cache_purge_bitmaps(void)
     }
     centry = image_cache->entries;
     while (centry != NULL) {
-        image_cache__free_bitmap(centry);
+        if (centry->partial == false) {
+            image_cache__free_bitmap(centry);
+        }
         centry = centry->next;
     }
 }
@@ -509,14 +530,26 @@ nserror image_cache_add(struct content *content, struct bitmap *bitmap, image_ca
 
     centry->convert = convert;
 
+    /* a partly decoded bitmap which is not being kept is discarded */
+    if (centry->partial) {
+        centry->partial = false;
+        if (bitmap == NULL) {
+            image_cache__free_bitmap(centry);
+        }
+    }
+
     /* set bitmap entry if one is passed, free extant one if present */
     if (bitmap != NULL) {
-        if (centry->bitmap != NULL) {
-            guit->bitmap->destroy(centry->bitmap);
+        if (centry->bitmap == bitmap) {
+            /* the partly decoded bitmap is now complete */
+        } else if (centry->bitmap != NULL) {
+            image_cache__free_bitmap(centry);
+            centry->bitmap = bitmap;
+            image_cache_stats_bitmap_add(centry);
         } else {
+            centry->bitmap = bitmap;
             image_cache_stats_bitmap_add(centry);
         }
-        centry->bitmap = bitmap;
     } else {
         /* no bitmap, check to see if we should speculatively convert */
         if ((centry->convert != NULL) && (image_cache_speculate(content) == true)) {
@@ -534,6 +567,75 @@ nserror image_cache_add(struct content *content, struct bitmap *bitmap, image_ca
     return NSERROR_OK;
 }
 
+/* exported interface documented in image_cache.h */
+nserror image_cache_add_partial(struct content *content, struct bitmap *bitmap)
+{
+    struct image_cache_entry_s *centry;
+
+    assert(image_cache__find(content) == NULL);
+
+    image_cache->current_age++;
+
+    centry = calloc(1, sizeof(struct image_cache_entry_s));
+    if (centry == NULL) {
+        return NSERROR_NOMEM;
+    }
+    image_cache__link(centry);
+    centry->content = content;
+    centry->bitmap_size = content->width * content->height * 4llu;
+    centry->bitmap = bitmap;
+    centry->partial = true;
+
+    NSLOG(wisp, INFO, "centry %p, content %p, partial bitmap %p", centry, content, bitmap);
+
+    image_cache_stats_bitmap_add(centry);
+
+    /* The first rows are shown as soon as they are decoded */
+    nsu_getmonotonic_ms(&centry->progress_time);
+    centry->progress_time -= IMAGE_CACHE_PROGRESS_INTERVAL;
+
+    return NSERROR_OK;
+}
+
+/* exported interface documented in image_cache.h */
+bool image_cache_progress_due(const struct content *content)
+{
+    struct image_cache_entry_s *centry;
+    uint64_t now;
+
+    centry = image_cache__find(content);
+    if ((centry == NULL) || (centry->partial == false)) {
+        return false;
+    }
+
+    nsu_getmonotonic_ms(&now);
+
+    return (now - centry->progress_time) >= IMAGE_CACHE_PROGRESS_INTERVAL;
+}
+
+/* exported interface documented in image_cache.h */
+void image_cache_progress(struct content *content)
+{
+    struct image_cache_entry_s *centry;
+    union content_msg_data data;
+
+    centry = image_cache__find(content);
+    if ((centry == NULL) || (centry->partial == false)) {
+        return;
+    }
+
+    nsu_getmonotonic_ms(&centry->progress_time);
+
+    guit->bitmap->modified(centry->bitmap);
+
+    data.redraw.x = 0;
+    data.redraw.y = 0;
+    data.redraw.width = content->width;
+    data.redraw.height = content->height;
+
+    content_broadcast(content, CONTENT_MSG_REDRAW, &data);
+}
+
 /* exported interface documented in image_cache.h */
 nserror image_cache_remove(struct content *content)
 {
@@ -79,6 +79,38 @@ void image_cache_purge_bitmaps(void);
  */
 nserror image_cache_add(struct content *content, struct bitmap *bitmap, image_cache_convert_fn *convert);
 
+/**
+ * Add an image content whose bitmap is still being decoded.
+ *
+ * The cache owns \a bitmap from here on, but keeps it until
+ * image_cache_add() is called for the content, so the handler may go on
+ * decoding into it. Passing the same bitmap to image_cache_add() keeps the
+ * decoded image; passing NULL discards it.
+ *
+ * \param content The content handle used as a key, with its size set
+ * \param bitmap A bitmap created with BITMAP_CLEAR
+ * \return A netsurf error code.
+ */
+nserror image_cache_add_partial(struct content *content, struct bitmap *bitmap);
+
+/**
+ * Determine if a partly decoded image is due to be redrawn.
+ *
+ * Redraws are throttled so slow connections delivering many small chunks
+ * do not cause a redraw per chunk.
+ *
+ * \param content The content being decoded
+ * \return true if image_cache_progress() should be called.
+ */
+bool image_cache_progress_due(const struct content *content);
+
+/**
+ * Redraw the bitmap of a partly decoded image.
+ *
+ * \param content The content being decoded
+ */
+void image_cache_progress(struct content *content);
+
 nserror image_cache_remove(struct content *content);
 
 
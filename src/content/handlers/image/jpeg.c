@@ -27,6 +27,7 @@
 #include <setjmp.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <wisp/bitmap.h>
 #include <wisp/content/content.h>
@@ -58,6 +59,47 @@ static char nsjpeg_error_buffer[JMSG_LENGTH_MAX];
 
 static unsigned char nsjpeg_eoi[] = {0xff, JPEG_EOI};
 
+/** Progress of decoding a jpeg as its data arrives */
+enum nsjpeg_state {
+    NSJPEG_IDLE = 0, /**< no data seen, decoder not created */
+    NSJPEG_HEADER, /**< reading the header */
+    NSJPEG_START, /**< starting decompression */
+    NSJPEG_OUTPUT_START, /**< waiting for a new scan to output */
+    NSJPEG_SCANLINES, /**< reading scanlines into the bitmap */
+    NSJPEG_OUTPUT_END, /**< finishing an output pass */
+    NSJPEG_FINISH, /**< finishing decompression */
+    NSJPEG_DONE, /**< bitmap fully decoded, decoder destroyed */
+    NSJPEG_STOPPED, /**< not decoding as data arrives, decoder destroyed */
+};
+
+/**
+ * Data source which suspends the decoder when it runs out of data.
+ *
+ * The bytes the decoder has not yet consumed are kept, as it backs up to
+ * the start of the unit it was reading when it suspends.
+ */
+struct nsjpeg_source {
+    struct jpeg_source_mgr pub; /**< libjpeg source manager */
+    uint8_t *buffer; /**< unconsumed data */
+    size_t buffer_size; /**< allocated size of buffer */
+    size_t skip; /**< bytes to skip from data not yet received */
+    bool eoi; /**< all data received; end the image at buffer end */
+};
+
+typedef struct nsjpeg_content {
+    struct content base; /**< base content type */
+
+    enum nsjpeg_state state; /**< progressive decode state */
+    struct jpeg_decompress_struct cinfo; /**< decoder */
+    struct jpeg_error_mgr jerr; /**< decoder error handler */
+    jmp_buf setjmp_buffer; /**< decoder fatal error exit */
+    struct nsjpeg_source source; /**< decoder data source */
+
+    struct bitmap *bitmap; /**< bitmap being decoded into */
+    uint8_t *pixels; /**< bitmap buffer */
+    size_t rowstride; /**< bitmap rowstride */
+} nsjpeg_content;
+
 /**
  * Content create entry point.
  */
@@ -65,20 +107,20 @@ static nserror nsjpeg_create(const content_handler *handler, lwc_string *imime_t
     const struct http_parameter *params, llcache_handle *llcache, const char *fallback_charset, bool quirks,
     struct content **c)
 {
-    struct content *jpeg;
+    nsjpeg_content *jpeg;
     nserror error;
 
-    jpeg = calloc(1, sizeof(struct content));
+    jpeg = calloc(1, sizeof(nsjpeg_content));
     if (jpeg == NULL)
         return NSERROR_NOMEM;
 
-    error = content__init(jpeg, handler, imime_type, params, llcache, fallback_charset, quirks);
+    error = content__init(&jpeg->base, handler, imime_type, params, llcache, fallback_charset, quirks);
     if (error != NSERROR_OK) {
         free(jpeg);
         return error;
     }
 
-    *c = jpeg;
+    *c = (struct content *)jpeg;
 
     return NSERROR_OK;
 }
@@ -129,6 +171,91 @@ static void nsjpeg_term_source(j_decompress_ptr cinfo)
 }
 
 
+/**
+ * Suspending JPEG data source manager: fill the input buffer.
+ *
+ * Suspends the decoder until more data arrives, unless all the data has
+ * been received, when the data is treated as truncated.
+ */
+static boolean nsjpeg_fill_input_buffer_suspend(j_decompress_ptr cinfo)
+{
+    struct nsjpeg_source *src = (struct nsjpeg_source *)cinfo->src;
+
+    if (src->eoi) {
+        return nsjpeg_fill_input_buffer(cinfo);
+    }
+
+    return FALSE;
+}
+
+
+/**
+ * Suspending JPEG data source manager: skip num_bytes worth of data.
+ *
+ * Data beyond that received so far is skipped as it arrives.
+ */
+static void nsjpeg_skip_input_data_suspend(j_decompress_ptr cinfo, long num_bytes)
+{
+    struct nsjpeg_source *src = (struct nsjpeg_source *)cinfo->src;
+
+    if (num_bytes <= 0) {
+        return;
+    }
+
+    if (src->pub.bytes_in_buffer < (size_t)num_bytes) {
+        src->skip += num_bytes - src->pub.bytes_in_buffer;
+        src->pub.next_input_byte += src->pub.bytes_in_buffer;
+        src->pub.bytes_in_buffer = 0;
+    } else {
+        src->pub.next_input_byte += num_bytes;
+        src->pub.bytes_in_buffer -= num_bytes;
+    }
+}
+
+
+/**
+ * Add newly received data to a suspending data source.
+ *
+ * \param src The data source
+ * \param data The new data
+ * \param size The length of \a data
+ * \return true on success or false on memory exhaustion
+ */
+static bool nsjpeg__source_append(struct nsjpeg_source *src, const uint8_t *data, size_t size)
+{
+    size_t avail = src->pub.bytes_in_buffer;
+    size_t skip;
+
+    skip = min(src->skip, size);
+    src->skip -= skip;
+    data += skip;
+    size -= skip;
+
+    /* move the unconsumed data to the start of the buffer */
+    if (avail > 0) {
+        memmove(src->buffer, src->pub.next_input_byte, avail);
+    }
+
+    if (avail + size > src->buffer_size) {
+        uint8_t *buffer = realloc(src->buffer, avail + size);
+        if (buffer == NULL) {
+            return false;
+        }
+        src->buffer = buffer;
+        src->buffer_size = avail + size;
+    }
+
+    if (size > 0) {
+        memcpy(src->buffer + avail, data, size);
+    }
+
+    src->pub.next_input_byte = src->buffer;
+    src->pub.bytes_in_buffer = avail + size;
+
+    return true;
+}
+
+
 /**
  * Error output handler for JPEG library.
  *
@@ -160,16 +287,20 @@ static void nsjpeg_error_exit(j_common_ptr cinfo)
 
 /**
  * Convert scan lines from CMYK to core client bitmap layout.
+ *
+ * \return true when all scan lines are read, false if the decoder suspended.
  */
-static inline void nsjpeg__decode_cmyk(struct jpeg_decompress_struct *cinfo, uint8_t *volatile pixels, size_t rowstride)
+static inline bool nsjpeg__decode_cmyk(struct jpeg_decompress_struct *cinfo, uint8_t *volatile pixels, size_t rowstride)
 {
     int width = cinfo->output_width * 4;
 
-    do {
+    while (cinfo->output_scanline != cinfo->output_height) {
         JSAMPROW scanlines[1] = {
             [0] = (JSAMPROW)(pixels + rowstride * cinfo->output_scanline),
         };
-        jpeg_read_scanlines(cinfo, scanlines, 1);
+        if (jpeg_read_scanlines(cinfo, scanlines, 1) == 0) {
+            return false;
+        }
 
         for (int i = width - 4; 0 <= i; i -= 4) {
             /* Trivial inverse CMYK -> RGBA */
@@ -189,23 +320,29 @@ static inline void nsjpeg__decode_cmyk(struct jpeg_decompress_struct *cinfo, uin
             scanlines[0][i + bitmap_layout.a] = 0xff;
 #undef DIV255
         }
-    } while (cinfo->output_scanline != cinfo->output_height);
+    }
+
+    return true;
 }
 
 /**
  * Convert scan lines from CMYK to core client bitmap layout.
+ *
+ * \return true when all scan lines are read, false if the decoder suspended.
  */
-static inline void nsjpeg__decode_rgb(struct jpeg_decompress_struct *cinfo, uint8_t *volatile pixels, size_t rowstride)
+static inline bool nsjpeg__decode_rgb(struct jpeg_decompress_struct *cinfo, uint8_t *volatile pixels, size_t rowstride)
 {
 #if RGB_RED != 0 || RGB_GREEN != 1 || RGB_BLUE != 2 || RGB_PIXELSIZE != 4
     int width = cinfo->output_width;
 #endif
 
-    do {
+    while (cinfo->output_scanline != cinfo->output_height) {
         JSAMPROW scanlines[1] = {
             [0] = (JSAMPROW)(pixels + rowstride * cinfo->output_scanline),
         };
-        jpeg_read_scanlines(cinfo, scanlines, 1);
+        if (jpeg_read_scanlines(cinfo, scanlines, 1) == 0) {
+            return false;
+        }
 
 #if RGB_RED != 0 || RGB_GREEN != 1 || RGB_BLUE != 2 || RGB_PIXELSIZE != 4
         /* Missmatch between configured libjpeg pixel format and
@@ -220,21 +357,89 @@ static inline void nsjpeg__decode_rgb(struct jpeg_decompress_struct *cinfo, uint
             scanlines[0][i * 4 + bitmap_layout.a] = 0xff;
         }
 #endif
-    } while (cinfo->output_scanline != cinfo->output_height);
+    }
+
+    return true;
 }
 
 /**
  * Convert scan lines from CMYK to core client bitmap layout.
+ *
+ * \return true when all scan lines are read, false if the decoder suspended.
  */
-static inline void
+static inline bool
 nsjpeg__decode_client_fmt(struct jpeg_decompress_struct *cinfo, uint8_t *volatile pixels, size_t rowstride)
 {
-    do {
+    while (cinfo->output_scanline != cinfo->output_height) {
         JSAMPROW scanlines[1] = {
             [0] = (JSAMPROW)(pixels + rowstride * cinfo->output_scanline),
         };
-        jpeg_read_scanlines(cinfo, scanlines, 1);
-    } while (cinfo->output_scanline != cinfo->output_height);
+        if (jpeg_read_scanlines(cinfo, scanlines, 1) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Read scan lines into a bitmap in the core client bitmap layout.
+ *
+ * \param cinfo The decoder, with decompression started
+ * \param pixels The bitmap buffer
+ * \param rowstride The bitmap rowstride
+ * \return true when all scan lines are read, false if the decoder suspended.
+ */
+static bool nsjpeg__decode_scanlines(struct jpeg_decompress_struct *cinfo, uint8_t *volatile pixels, size_t rowstride)
+{
+    switch (cinfo->out_color_space) {
+    case JCS_CMYK:
+        return nsjpeg__decode_cmyk(cinfo, pixels, rowstride);
+
+    case JCS_RGB:
+        return nsjpeg__decode_rgb(cinfo, pixels, rowstride);
+
+    default:
+        return nsjpeg__decode_client_fmt(cinfo, pixels, rowstride);
+    }
+}
+
+/**
+ * Set the decoder output parameters for the core client bitmap layout.
+ *
+ * \param cinfo The decoder, with the header read
+ * \return true on success or false if the bitmap layout is not supported.
+ */
+static bool nsjpeg__set_output_format(struct jpeg_decompress_struct *cinfo)
+{
+    if (cinfo->jpeg_color_space == JCS_CMYK || cinfo->jpeg_color_space == JCS_YCCK) {
+        cinfo->out_color_space = JCS_CMYK;
+    } else {
+#ifdef JCS_ALPHA_EXTENSIONS
+        switch (bitmap_fmt.layout) {
+        case BITMAP_LAYOUT_R8G8B8A8:
+            cinfo->out_color_space = JCS_EXT_RGBA;
+            break;
+        case BITMAP_LAYOUT_B8G8R8A8:
+            cinfo->out_color_space = JCS_EXT_BGRA;
+            break;
+        case BITMAP_LAYOUT_A8R8G8B8:
+            cinfo->out_color_space = JCS_EXT_ARGB;
+            break;
+        case BITMAP_LAYOUT_A8B8G8R8:
+            cinfo->out_color_space = JCS_EXT_ABGR;
+            break;
+        default:
+            NSLOG(wisp, ERROR, "Unexpected bitmap format: %u", bitmap_fmt.layout);
+            return false;
+        }
+#else
+        cinfo->out_color_space = JCS_RGB;
+#endif
+    }
+    cinfo->dct_method = JDCT_ISLOW;
+
+    return true;
 }
 
 /**
@@ -283,33 +488,10 @@ static struct bitmap *jpeg_cache_convert(struct content *c)
     jpeg_read_header(&cinfo, TRUE);
 
     /* set output processing parameters */
-    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) {
-        cinfo.out_color_space = JCS_CMYK;
-    } else {
-#ifdef JCS_ALPHA_EXTENSIONS
-        switch (bitmap_fmt.layout) {
-        case BITMAP_LAYOUT_R8G8B8A8:
-            cinfo.out_color_space = JCS_EXT_RGBA;
-            break;
-        case BITMAP_LAYOUT_B8G8R8A8:
-            cinfo.out_color_space = JCS_EXT_BGRA;
-            break;
-        case BITMAP_LAYOUT_A8R8G8B8:
-            cinfo.out_color_space = JCS_EXT_ARGB;
-            break;
-        case BITMAP_LAYOUT_A8B8G8R8:
-            cinfo.out_color_space = JCS_EXT_ABGR;
-            break;
-        default:
-            NSLOG(wisp, ERROR, "Unexpected bitmap format: %u", bitmap_fmt.layout);
-            jpeg_destroy_decompress(&cinfo);
-            return NULL;
-        }
-#else
-        cinfo.out_color_space = JCS_RGB;
-#endif
+    if (nsjpeg__set_output_format(&cinfo) == false) {
+        jpeg_destroy_decompress(&cinfo);
+        return NULL;
     }
-    cinfo.dct_method = JDCT_ISLOW;
 
     /* commence the decompression, output parameters now valid */
     jpeg_start_decompress(&cinfo);
@@ -333,19 +515,7 @@ static struct bitmap *jpeg_cache_convert(struct content *c)
     /* Convert scanlines from jpeg into bitmap */
     rowstride = guit->bitmap->get_rowstride(bitmap);
 
-    switch (cinfo.out_color_space) {
-    case JCS_CMYK:
-        nsjpeg__decode_cmyk(&cinfo, pixels, rowstride);
-        break;
-
-    case JCS_RGB:
-        nsjpeg__decode_rgb(&cinfo, pixels, rowstride);
-        break;
-
-    default:
-        nsjpeg__decode_client_fmt(&cinfo, pixels, rowstride);
-        break;
-    }
+    nsjpeg__decode_scanlines(&cinfo, pixels, rowstride);
 
     guit->bitmap->modified(bitmap);
 
@@ -356,9 +526,12 @@ static struct bitmap *jpeg_cache_convert(struct content *c)
 }
 
 /**
- * Convert a CONTENT_JPEG for display.
+ * Read the size of a CONTENT_JPEG from its header.
+ *
+ * \return true on success or false, with an error broadcast, if the header
+ *         is not valid.
  */
-static bool nsjpeg_convert(struct content *c)
+static bool nsjpeg__read_size(struct content *c)
 {
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_mgr jerr;
@@ -368,7 +541,6 @@ static bool nsjpeg_convert(struct content *c)
     union content_msg_data msg_data;
     const uint8_t *data;
     size_t size;
-    char *title;
 
     /* check image header is valid and get width/height */
     data = content__get_source_data(c, &size);
@@ -403,7 +575,247 @@ static bool nsjpeg_convert(struct content *c)
 
     jpeg_destroy_decompress(&cinfo);
 
-    image_cache_add(c, NULL, jpeg_cache_convert);
+    return true;
+}
+
+
+/**
+ * Stop decoding a jpeg as its data arrives, freeing the decoder.
+ *
+ * Any bitmap already decoded into is kept.
+ */
+static void nsjpeg__stop(nsjpeg_content *jpeg_c, enum nsjpeg_state state)
+{
+    if ((jpeg_c->state != NSJPEG_IDLE) && (jpeg_c->state < NSJPEG_DONE)) {
+        jpeg_destroy_decompress(&jpeg_c->cinfo);
+    }
+
+    free(jpeg_c->source.buffer);
+    jpeg_c->source.buffer = NULL;
+    jpeg_c->source.buffer_size = 0;
+
+    jpeg_c->state = state;
+}
+
+/**
+ * Create the bitmap a jpeg is decoded into as its data arrives.
+ *
+ * \return true on success or false if the bitmap could not be created.
+ */
+static bool nsjpeg__create_bitmap(nsjpeg_content *jpeg_c)
+{
+    struct content *c = &jpeg_c->base;
+
+    /* cleared so the rows not yet received are transparent */
+    jpeg_c->bitmap = guit->bitmap->create(c->width, c->height, BITMAP_CLEAR);
+    if (jpeg_c->bitmap == NULL) {
+        return false;
+    }
+
+    jpeg_c->pixels = guit->bitmap->get_buffer(jpeg_c->bitmap);
+    if ((jpeg_c->pixels == NULL) || (image_cache_add_partial(c, jpeg_c->bitmap) != NSERROR_OK)) {
+        guit->bitmap->destroy(jpeg_c->bitmap);
+        jpeg_c->bitmap = NULL;
+        return false;
+    }
+
+    jpeg_c->rowstride = guit->bitmap->get_rowstride(jpeg_c->bitmap);
+
+    return true;
+}
+
+/**
+ * Decode as much of a jpeg as the data received so far allows.
+ *
+ * Baseline images are decoded a scan line at a time. Progressive images
+ * are read in buffered image mode and an output pass is made over the
+ * bitmap when a new scan has arrived and a redraw is due.
+ *
+ * Must be called with the decoder fatal error exit set up.
+ */
+static void nsjpeg__decode(nsjpeg_content *jpeg_c)
+{
+    struct content *c = &jpeg_c->base;
+    struct jpeg_decompress_struct *cinfo = &jpeg_c->cinfo;
+    int ret;
+
+    for (;;) {
+        switch (jpeg_c->state) {
+        case NSJPEG_HEADER:
+            if (jpeg_read_header(cinfo, TRUE) == JPEG_SUSPENDED) {
+                return;
+            }
+
+            if (nsjpeg__set_output_format(cinfo) == false) {
+                nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+                return;
+            }
+            jpeg_calc_output_dimensions(cinfo);
+
+            c->width = cinfo->output_width;
+            c->height = cinfo->output_height;
+            c->size += c->width * c->height * 4;
+
+            /* see if progressive decoding should continue */
+            if (image_cache_speculate(c) == false) {
+                nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+                return;
+            }
+
+            cinfo->buffered_image = jpeg_has_multiple_scans(cinfo);
+            jpeg_c->state = NSJPEG_START;
+            break;
+
+        case NSJPEG_START:
+            if (jpeg_start_decompress(cinfo) == FALSE) {
+                return;
+            }
+
+            if (nsjpeg__create_bitmap(jpeg_c) == false) {
+                nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+                return;
+            }
+
+            jpeg_c->state = cinfo->buffered_image ? NSJPEG_OUTPUT_START : NSJPEG_SCANLINES;
+            break;
+
+        case NSJPEG_OUTPUT_START:
+            /* absorb all available input so the pass shows the latest scan */
+            do {
+                ret = jpeg_consume_input(cinfo);
+            } while ((ret != JPEG_SUSPENDED) && (ret != JPEG_REACHED_EOI));
+
+            if (jpeg_input_complete(cinfo) == FALSE) {
+                if (cinfo->input_scan_number == cinfo->output_scan_number) {
+                    /* nothing new to show */
+                    return;
+                }
+                if (image_cache_progress_due(c) == false) {
+                    return;
+                }
+            }
+
+            if (jpeg_start_output(cinfo, cinfo->input_scan_number) == FALSE) {
+                return;
+            }
+            jpeg_c->state = NSJPEG_SCANLINES;
+            break;
+
+        case NSJPEG_SCANLINES:
+            if (nsjpeg__decode_scanlines(cinfo, jpeg_c->pixels, jpeg_c->rowstride) == false) {
+                return;
+            }
+            jpeg_c->state = cinfo->buffered_image ? NSJPEG_OUTPUT_END : NSJPEG_FINISH;
+            break;
+
+        case NSJPEG_OUTPUT_END:
+            if (jpeg_finish_output(cinfo) == FALSE) {
+                return;
+            }
+            jpeg_c->state = jpeg_input_complete(cinfo) ? NSJPEG_FINISH : NSJPEG_OUTPUT_START;
+            break;
+
+        case NSJPEG_FINISH:
+            if (jpeg_finish_decompress(cinfo) == FALSE) {
+                return;
+            }
+            nsjpeg__stop(jpeg_c, NSJPEG_DONE);
+            return;
+
+        default:
+            return;
+        }
+    }
+}
+
+/**
+ * Process data for a CONTENT_JPEG as it arrives.
+ */
+static bool nsjpeg_process_data(struct content *c, const char *data, unsigned int size)
+{
+    nsjpeg_content *jpeg_c = (nsjpeg_content *)c;
+
+    if (jpeg_c->state >= NSJPEG_DONE) {
+        return true;
+    }
+
+    /* handler for fatal errors during decompression */
+    if (setjmp(jpeg_c->setjmp_buffer)) {
+        /* keep whatever was decoded before the error */
+        nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+        return true;
+    }
+
+    if (jpeg_c->state == NSJPEG_IDLE) {
+        jpeg_c->cinfo.err = jpeg_std_error(&jpeg_c->jerr);
+        jpeg_c->jerr.error_exit = nsjpeg_error_exit;
+        jpeg_c->jerr.output_message = nsjpeg_error_log;
+        jpeg_c->cinfo.client_data = &jpeg_c->setjmp_buffer;
+        jpeg_create_decompress(&jpeg_c->cinfo);
+        jpeg_c->state = NSJPEG_HEADER;
+
+        jpeg_c->source.pub.init_source = nsjpeg_init_source;
+        jpeg_c->source.pub.fill_input_buffer = nsjpeg_fill_input_buffer_suspend;
+        jpeg_c->source.pub.skip_input_data = nsjpeg_skip_input_data_suspend;
+        jpeg_c->source.pub.resync_to_restart = jpeg_resync_to_restart;
+        jpeg_c->source.pub.term_source = nsjpeg_term_source;
+        jpeg_c->cinfo.src = &jpeg_c->source.pub;
+    }
+
+    if (nsjpeg__source_append(&jpeg_c->source, (const uint8_t *)data, size) == false) {
+        nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+        return true;
+    }
+
+    nsjpeg__decode(jpeg_c);
+
+    /* show the scan lines decoded so far */
+    if (image_cache_progress_due(c)) {
+        image_cache_progress(c);
+    }
+
+    return true;
+}
+
+/**
+ * Complete decoding a jpeg which was decoded as its data arrived.
+ *
+ * \return true if the bitmap is complete or false if there is none.
+ */
+static bool nsjpeg__finish_decode(nsjpeg_content *jpeg_c)
+{
+    if ((jpeg_c->state != NSJPEG_IDLE) && (jpeg_c->state < NSJPEG_DONE)) {
+        if (setjmp(jpeg_c->setjmp_buffer)) {
+            nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+        } else {
+            /* a truncated image ends where its data does */
+            jpeg_c->source.eoi = true;
+            nsjpeg__decode(jpeg_c);
+            nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+        }
+    }
+
+    return jpeg_c->bitmap != NULL;
+}
+
+/**
+ * Convert a CONTENT_JPEG for display.
+ */
+static bool nsjpeg_convert(struct content *c)
+{
+    nsjpeg_content *jpeg_c = (nsjpeg_content *)c;
+    char *title;
+
+    if (nsjpeg__finish_decode(jpeg_c)) {
+        /* hand the bitmap decoded as data arrived to the cache */
+        guit->bitmap->set_opaque(jpeg_c->bitmap, true);
+        guit->bitmap->modified(jpeg_c->bitmap);
+        image_cache_add(c, jpeg_c->bitmap, jpeg_cache_convert);
+    } else if (nsjpeg__read_size(c)) {
+        image_cache_add(c, NULL, jpeg_cache_convert);
+    } else {
+        return false;
+    }
 
     /* set title text */
     title = messages_get_buff("JPEGTitle", nsurl_access_leaf(llcache_handle_get_url(c->llcache)), c->width, c->height);
@@ -419,42 +831,63 @@ static bool nsjpeg_convert(struct content *c)
     return true;
 }
 
-
 /**
  * Clone content.
  */
 static nserror nsjpeg_clone(const struct content *old, struct content **newc)
 {
-    struct content *jpeg_c;
+    nsjpeg_content *jpeg_c;
     nserror error;
+    const uint8_t *data;
+    size_t size;
 
-    jpeg_c = calloc(1, sizeof(struct content));
+    jpeg_c = calloc(1, sizeof(nsjpeg_content));
     if (jpeg_c == NULL)
         return NSERROR_NOMEM;
 
-    error = content__clone(old, jpeg_c);
+    error = content__clone(old, &jpeg_c->base);
     if (error != NSERROR_OK) {
-        content_destroy(jpeg_c);
+        content_destroy(&jpeg_c->base);
         return error;
     }
 
-    /* re-convert if the content is ready */
     if ((old->status == CONTENT_STATUS_READY) || (old->status == CONTENT_STATUS_DONE)) {
-        if (nsjpeg_convert(jpeg_c) == false) {
-            content_destroy(jpeg_c);
+        /* re-convert if the content is ready */
+        if (nsjpeg_convert(&jpeg_c->base) == false) {
+            content_destroy(&jpeg_c->base);
             return NSERROR_CLONE_FAILED;
         }
+    } else {
+        /* catch up with the data received so far */
+        data = content__get_source_data(&jpeg_c->base, &size);
+        if (size > 0) {
+            nsjpeg_process_data(&jpeg_c->base, (const char *)data, size);
+        }
     }
 
-    *newc = jpeg_c;
+    *newc = (struct content *)jpeg_c;
 
     return NSERROR_OK;
 }
 
+/**
+ * Destroy a CONTENT_JPEG.
+ */
+static void nsjpeg_destroy(struct content *c)
+{
+    nsjpeg_content *jpeg_c = (nsjpeg_content *)c;
+
+    /* the fetch was abandoned before the image was complete */
+    nsjpeg__stop(jpeg_c, NSJPEG_STOPPED);
+
+    image_cache_destroy(c);
+}
+
 static const content_handler nsjpeg_content_handler = {
     .create = nsjpeg_create,
+    .process_data = nsjpeg_process_data,
     .data_complete = nsjpeg_convert,
-    .destroy = image_cache_destroy,
+    .destroy = nsjpeg_destroy,
     .redraw = image_cache_redraw,
     .clone = nsjpeg_clone,
     .get_internal = image_cache_get_internal,
@@ -65,6 +65,9 @@ static unsigned int interlace_start[8] = {0, 16, 0, 8, 0, 4, 0};
 static unsigned int interlace_step[8] = {28, 28, 12, 12, 4, 4, 0};
 static unsigned int interlace_row_start[8] = {0, 0, 4, 0, 2, 0, 1};
 static unsigned int interlace_row_step[8] = {8, 8, 8, 4, 4, 2, 2};
+/* size of the block each pixel covers until later passes fill it in */
+static unsigned int interlace_block_width[8] = {8, 4, 4, 2, 2, 1, 1};
+static unsigned int interlace_block_height[8] = {8, 8, 4, 4, 2, 2, 1};
 
 /** Callbak error numbers*/
 enum nspng_cberr {
@@ -195,13 +198,21 @@ static void info_callback(png_structp png_s, png_infop info)
         longjmp(png_jmpbuf(png_s), CBERR_NOPRE);
     }
 
-    /* Claim the required memory for the converted PNG */
-    png_c->bitmap = guit->bitmap->create(width, height, BITMAP_NONE);
+    /* Claim the required memory for the converted PNG, cleared so the
+     * rows not yet received are transparent while it is shown partially
+     */
+    png_c->bitmap = guit->bitmap->create(width, height, BITMAP_CLEAR);
     if (png_c->bitmap == NULL) {
         /* Failed to create bitmap skip pre-conversion */
         longjmp(png_jmpbuf(png_s), CBERR_NOPRE);
     }
 
+    if (image_cache_add_partial((struct content *)png_c, png_c->bitmap) != NSERROR_OK) {
+        guit->bitmap->destroy(png_c->bitmap);
+        png_c->bitmap = NULL;
+        longjmp(png_jmpbuf(png_s), CBERR_NOPRE);
+    }
+
     png_c->rowstride = guit->bitmap->get_rowstride(png_c->bitmap);
     png_c->bpp = sizeof(uint32_t);
 
@@ -214,6 +225,35 @@ static void info_callback(png_structp png_s, png_infop info)
         png_c->rowbytes);
 }
 
+/**
+ * Spread the pixels of an early interlace pass over the blocks later passes
+ * will fill in, so a partly received image is shown coarsely rather than as
+ * scattered dots.
+ */
+static void nspng_fill_interlace_blocks(nspng_content *png_c, unsigned char *row, png_uint_32 row_num, int pass)
+{
+    size_t rowbytes = png_c->rowbytes;
+    size_t block_bytes = interlace_block_width[pass] * png_c->bpp;
+    unsigned int block_rows = interlace_block_height[pass];
+    size_t dst_off, span, x;
+    unsigned int r;
+
+    if (row_num + block_rows > (png_uint_32)png_c->base.height) {
+        block_rows = png_c->base.height - row_num;
+    }
+
+    for (dst_off = interlace_start[pass]; dst_off < rowbytes; dst_off += interlace_step[pass] + 4) {
+        span = min(block_bytes, rowbytes - dst_off);
+
+        for (x = png_c->bpp; x < span; x += png_c->bpp) {
+            memcpy(row + dst_off + x, row + dst_off, png_c->bpp);
+        }
+        for (r = 1; r < block_rows; r++) {
+            memcpy(row + (png_c->rowstride * r) + dst_off, row + dst_off, span);
+        }
+    }
+}
+
 static void row_callback(png_structp png_s, png_bytep new_row, png_uint_32 row_num, int pass)
 {
     nspng_content *png_c = png_get_progressive_ptr(png_s);
@@ -258,6 +298,10 @@ static void row_callback(png_structp png_s, png_bytep new_row, png_uint_32 row_n
             row[dst_off++] = new_row[src_off++];
             row[dst_off++] = new_row[src_off++];
         }
+
+        if (interlace_block_width[pass] > 1 || interlace_block_height[pass] > 1) {
+            nspng_fill_interlace_blocks(png_c, row, row_num, pass);
+        }
     } else {
         /* Do a fast memcpy of the row data */
         memcpy(row, new_row, rowbytes);
@@ -344,6 +388,11 @@ static bool nspng_process_data(struct content *c, const char *data, unsigned int
     switch (setjmp(png_jmpbuf(png_c->png))) {
     case CBERR_NONE: /* direct return */
         png_process_data(png_c->png, png_c->info, (uint8_t *)data, size);
+
+        /* show the rows decoded so far */
+        if (image_cache_progress_due(c)) {
+            image_cache_progress(c);
+        }
         break;
 
     case CBERR_NOPRE: /* not going to progressive convert */
@@ -614,12 +663,24 @@ static nserror nspng_clone(const struct content *old_c, struct content **new_c)
     return NSERROR_OK;
 }
 
+static void nspng_destroy(struct content *c)
+{
+    nspng_content *png_c = (nspng_content *)c;
+
+    /* the fetch was abandoned before the image was complete */
+    if (png_c->png != NULL) {
+        png_destroy_read_struct(&png_c->png, &png_c->info, 0);
+    }
+
+    image_cache_destroy(c);
+}
+
 static const content_handler nspng_content_handler = {
     .create = nspng_create,
     .process_data = nspng_process_data,
     .data_complete = nspng_convert,
     .clone = nspng_clone,
-    .destroy = image_cache_destroy,
+    .destroy = nspng_destroy,
     .redraw = image_cache_redraw,
     .get_internal = image_cache_get_internal,
     .type = image_cache_content_type,
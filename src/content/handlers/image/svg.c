@@ -29,6 +29,7 @@
 
 #include <svgtiny.h>
 
+#include <wisp/bitmap.h>
 #include <wisp/content.h>
 #include <wisp/content/content_protected.h>
 #include <wisp/desktop/gui_internal.h>
@@ -38,10 +39,21 @@
 #include <wisp/utils/messages.h>
 #include <wisp/utils/nsurl.h>
 #include <wisp/utils/utils.h>
+#include "utils/trace.h"
 #include "content/content_factory.h"
 
+#include "content/handlers/image/image.h"
+#include "content/handlers/image/image_cache.h"
 #include "content/handlers/image/svg.h"
 
+/**
+ * Largest raster (in pixels) the SVG bitmap cache will create.
+ *
+ * Bigger diagrams are always plotted as vectors so a single SVG
+ * cannot take a disproportionate share of the image cache budget.
+ */
+static const int svg_raster_max_pixels = 2048 * 2048;
+
 /**
  * Render a dashed line as a series of filled rectangles.
  *
@@ -490,6 +502,10 @@ typedef struct svg_content {
     bool has_intrinsic_dimensions; /**< True if SVG has explicit width/height attrs */
     int ratio_width; /**< viewBox/intrinsic width for aspect ratio */
     int ratio_height; /**< viewBox/intrinsic height for aspect ratio */
+
+    bool raster_cached; /**< True if registered with the image cache */
+    int raster_width; /**< Width the cached raster is rendered at */
+    int raster_height; /**< Height the cached raster is rendered at */
 } svg_content;
 
 
@@ -650,6 +666,12 @@ static void svg_reformat(struct content *c, int width, int height)
 
     c->width = svg->diagram->width;
     c->height = svg->diagram->height;
+
+    /* Shapes were re-parsed so any cached raster is stale */
+    if (svg->raster_cached) {
+        image_cache_remove(c);
+        svg->raster_cached = false;
+    }
 }
 
 
@@ -703,7 +725,7 @@ static bool svg_redraw_internal(svg_content *svg, int x, int y, int width, int h
     transform[4] = x;
     transform[5] = y;
 
-    NSLOG(wisp, DEBUG, "PROFILER: START SVG rendering %p", svg);
+    TRACE_BEGIN("image", "svg redraw");
     NSLOG(wisp, INFO, "SVG redraw start: url=%s clip=%d,%d..%d,%d limit=%u", url_str, clip->x0, clip->y0, clip->x1,
         clip->y1, SVG_COMBO_FLUSH_LIMIT);
 
@@ -719,6 +741,7 @@ static bool svg_redraw_internal(svg_content *svg, int x, int y, int width, int h
     if (max_path_len > 0) {
         scaled = malloc(sizeof(float) * max_path_len);
         if (scaled == NULL) {
+            TRACE_END("image", "svg redraw");
             return false;
         }
     }
@@ -1037,6 +1060,7 @@ static bool svg_redraw_internal(svg_content *svg, int x, int y, int width, int h
                                 free(scaled);
                             if (combo)
                                 free(combo);
+                            TRACE_END("image", "svg redraw");
                             return false;
                         }
                         combo = nbuf;
@@ -1164,7 +1188,7 @@ static bool svg_redraw_internal(svg_content *svg, int x, int y, int width, int h
         free(scaled);
     if (combo)
         free(combo);
-    NSLOG(wisp, DEBUG, "PROFILER: STOP SVG rendering %p", svg);
+    TRACE_END("image", "svg redraw");
     return ok;
 }
 
@@ -1220,6 +1244,101 @@ static bool svg_redraw_tiled_internal(
 }
 
 
+/**
+ * Redraw callback used to rasterise the diagram into a bitmap.
+ *
+ * \param ctx The raster redraw context set up by the frontend.
+ * \param pw The svg content being rasterised.
+ * \return true on success else false.
+ */
+static bool svg_raster_plot(const struct redraw_context *ctx, void *pw)
+{
+    svg_content *svg = pw;
+    struct rect clip = {0, 0, svg->raster_width, svg->raster_height};
+
+    return svg_redraw_internal(svg, 0, 0, svg->raster_width, svg->raster_height, &clip, ctx, NS_TRANSPARENT, 0);
+}
+
+
+/**
+ * Image cache conversion callback producing the SVG raster.
+ *
+ * \param c The svg content to rasterise.
+ * \return The rendered bitmap or NULL on error.
+ */
+static struct bitmap *svg_raster_convert(struct content *c)
+{
+    svg_content *svg = (svg_content *)c;
+    struct bitmap *bitmap;
+    nserror res;
+
+    bitmap = guit->bitmap->create(svg->raster_width, svg->raster_height, BITMAP_CLEAR);
+    if (bitmap == NULL) {
+        return NULL;
+    }
+
+    res = guit->bitmap->render_plot(bitmap, svg_raster_plot, svg);
+    if (res != NSERROR_OK) {
+        guit->bitmap->destroy(bitmap);
+        return NULL;
+    }
+    guit->bitmap->modified(bitmap);
+
+    NSLOG(wisp, DEBUG, "SVG rasterised %p at %dx%d", svg, svg->raster_width, svg->raster_height);
+
+    return bitmap;
+}
+
+
+/**
+ * Obtain a cached raster of the diagram at the given size.
+ *
+ * The raster is only used when the plotter has asked for vector
+ * content to be rasterised, the frontend can plot into bitmaps and
+ * the requested size is reasonable. The bitmap is held by the image
+ * cache so it shares that cache's memory budget and may be discarded
+ * and regenerated at any time.
+ *
+ * \param svg The svg content.
+ * \param width The width to render at.
+ * \param height The height to render at.
+ * \param ctx The current redraw context.
+ * \return The raster or NULL if the diagram should be plotted as vectors.
+ */
+static struct bitmap *svg_raster_get(svg_content *svg, int width, int height, const struct redraw_context *ctx)
+{
+    if ((ctx->plot->option_raster_vectors == false) || (ctx->plot->bitmap == NULL) || (guit->bitmap == NULL) ||
+        (guit->bitmap->render_plot == NULL)) {
+        return NULL;
+    }
+
+    if ((width <= 0) || (height <= 0) || (width > svg_raster_max_pixels / height)) {
+        return NULL;
+    }
+
+    if (svg->diagram->shape_count == 0) {
+        return NULL;
+    }
+
+    /* The cache holds a single raster per content, keyed by size */
+    if (svg->raster_cached && ((svg->raster_width != width) || (svg->raster_height != height))) {
+        image_cache_remove(&svg->base);
+        svg->raster_cached = false;
+    }
+
+    if (svg->raster_cached == false) {
+        svg->raster_width = width;
+        svg->raster_height = height;
+        if (image_cache_add(&svg->base, NULL, svg_raster_convert) != NSERROR_OK) {
+            return NULL;
+        }
+        svg->raster_cached = true;
+    }
+
+    return image_cache_get_bitmap(&svg->base);
+}
+
+
 /**
  * Redraw a CONTENT_SVG.
  */
@@ -1229,6 +1348,7 @@ static bool svg_redraw(
     svg_content *svg = (svg_content *)c;
     nsurl *u = content_get_url(c);
     const char *us = u ? nsurl_access(u) : "(inline)";
+    struct bitmap *bitmap;
 
     NSLOG(wisp, WARNING,
         "SVGDIAG svg_redraw ENTRY: url=%s data={x=%d y=%d w=%d h=%d} "
@@ -1244,6 +1364,13 @@ static bool svg_redraw(
         return true;
     }
 
+    /* Tiled and repeated plots of the same size blit one raster
+     * rather than replaying every path of the diagram. */
+    bitmap = svg_raster_get(svg, data->width, data->height, ctx);
+    if (bitmap != NULL) {
+        return image_bitmap_plot(bitmap, data, clip, ctx);
+    }
+
     if ((data->repeat_x == false) && (data->repeat_y == false)) {
         return svg_redraw_internal(
             svg, data->x, data->y, data->width, data->height, clip, ctx, data->background_colour, 0);
@@ -1261,6 +1388,9 @@ static void svg_destroy(struct content *c)
 {
     svg_content *svg = (svg_content *)c;
 
+    if (svg->raster_cached)
+        image_cache_remove(c);
+
     if (svg->diagram != NULL)
         svgtiny_free(svg->diagram);
 }
@@ -44,6 +44,23 @@
 
 #include "webp.h"
 
+/** Progress of decoding a webp as its data arrives */
+enum webp_state {
+    WEBP_HEADER = 0, /**< waiting for the image features */
+    WEBP_DECODING, /**< incremental decoder is running */
+    WEBP_DONE, /**< bitmap fully decoded, decoder destroyed */
+    WEBP_STOPPED, /**< not decoding as data arrives, decoder destroyed */
+};
+
+typedef struct webp_content {
+    struct content base; /**< base content type */
+
+    enum webp_state state; /**< incremental decode state */
+    WebPIDecoder *idec; /**< incremental decoder */
+    struct bitmap *bitmap; /**< bitmap being decoded into */
+    bool has_alpha; /**< image has an alpha channel */
+} webp_content;
+
 /**
  * Content create entry point.
  *
@@ -52,21 +69,21 @@
 static nserror webp_create(const content_handler *handler, lwc_string *imime_type, const struct http_parameter *params,
     llcache_handle *llcache, const char *fallback_charset, bool quirks, struct content **c)
 {
-    struct content *webp_c; /* webp content object */
+    webp_content *webp_c; /* webp content object */
     nserror res;
 
-    webp_c = calloc(1, sizeof(struct content));
+    webp_c = calloc(1, sizeof(webp_content));
     if (webp_c == NULL) {
         return NSERROR_NOMEM;
     }
 
-    res = content__init(webp_c, handler, imime_type, params, llcache, fallback_charset, quirks);
+    res = content__init(&webp_c->base, handler, imime_type, params, llcache, fallback_charset, quirks);
     if (res != NSERROR_OK) {
         free(webp_c);
         return res;
     }
 
-    *c = webp_c;
+    *c = (struct content *)webp_c;
 
     return NSERROR_OK;
 }
@@ -180,6 +197,147 @@ static struct bitmap *webp_cache_convert(struct content *c)
     return bitmap;
 }
 
+/**
+ * Stop decoding a webp as its data arrives, freeing the decoder.
+ */
+static void webp__stop(webp_content *webp_c, enum webp_state state)
+{
+    if (webp_c->idec != NULL) {
+        WebPIDelete(webp_c->idec);
+        webp_c->idec = NULL;
+    }
+    webp_c->state = state;
+}
+
+/**
+ * Start decoding a webp as its data arrives.
+ *
+ * Only images the decoder can write straight into a bitmap in the client
+ * format are decoded incrementally; the rest are left to
+ * webp_cache_convert() once all the data is available.
+ *
+ * \param webp_c The webp content object
+ * \param data The data received so far
+ * \param size The length of \a data
+ */
+static void webp__start(webp_content *webp_c, const uint8_t *data, size_t size)
+{
+    struct content *c = &webp_c->base;
+    WebPBitstreamFeatures webpfeatures;
+    WEBP_CSP_MODE mode;
+    VP8StatusCode webpres;
+    uint8_t *pixels;
+    size_t rowstride;
+
+    webpres = WebPGetFeatures(data, size, &webpfeatures);
+    if (webpres == VP8_STATUS_NOT_ENOUGH_DATA) {
+        return;
+    }
+    if ((webpres != VP8_STATUS_OK) || webpfeatures.has_animation) {
+        webp__stop(webp_c, WEBP_STOPPED);
+        return;
+    }
+
+    switch (bitmap_fmt.layout) {
+    case BITMAP_LAYOUT_R8G8B8A8:
+        mode = bitmap_fmt.pma ? MODE_rgbA : MODE_RGBA;
+        break;
+    case BITMAP_LAYOUT_B8G8R8A8:
+        mode = bitmap_fmt.pma ? MODE_bgrA : MODE_BGRA;
+        break;
+    case BITMAP_LAYOUT_A8R8G8B8:
+        mode = bitmap_fmt.pma ? MODE_Argb : MODE_ARGB;
+        break;
+    default:
+        webp__stop(webp_c, WEBP_STOPPED);
+        return;
+    }
+
+    c->width = webpfeatures.width;
+    c->height = webpfeatures.height;
+    c->size += c->width * c->height * 4;
+    webp_c->has_alpha = (webpfeatures.has_alpha != 0);
+
+    /* see if progressive decoding should continue */
+    if (image_cache_speculate(c) == false) {
+        webp__stop(webp_c, WEBP_STOPPED);
+        return;
+    }
+
+    /* cleared so the rows not yet received are transparent */
+    webp_c->bitmap = guit->bitmap->create(c->width, c->height, BITMAP_CLEAR);
+    if (webp_c->bitmap == NULL) {
+        webp__stop(webp_c, WEBP_STOPPED);
+        return;
+    }
+
+    pixels = guit->bitmap->get_buffer(webp_c->bitmap);
+    if ((pixels == NULL) || (image_cache_add_partial(c, webp_c->bitmap) != NSERROR_OK)) {
+        guit->bitmap->destroy(webp_c->bitmap);
+        webp_c->bitmap = NULL;
+        webp__stop(webp_c, WEBP_STOPPED);
+        return;
+    }
+
+    rowstride = guit->bitmap->get_rowstride(webp_c->bitmap);
+
+    webp_c->idec = WebPINewRGB(mode, pixels, rowstride * c->height, rowstride);
+    if (webp_c->idec == NULL) {
+        webp__stop(webp_c, WEBP_STOPPED);
+        return;
+    }
+
+    webp_c->state = WEBP_DECODING;
+}
+
+/**
+ * Process data for the webp content as it arrives.
+ *
+ * \param c The webp content object
+ * \param data The new data
+ * \param size The length of \a data
+ * \return true, as failing to decode incrementally is not an error
+ */
+static bool webp_process_data(struct content *c, const char *data, unsigned int size)
+{
+    webp_content *webp_c = (webp_content *)c;
+    VP8StatusCode webpres;
+
+    if (webp_c->state == WEBP_HEADER) {
+        const uint8_t *source_data;
+        size_t source_size;
+
+        /* the features are at the start of the source, which already
+         * holds this data
+         */
+        source_data = content__get_source_data(c, &source_size);
+        webp__start(webp_c, source_data, source_size);
+        if (webp_c->state != WEBP_DECODING) {
+            return true;
+        }
+        webpres = WebPIAppend(webp_c->idec, source_data, source_size);
+    } else if (webp_c->state == WEBP_DECODING) {
+        webpres = WebPIAppend(webp_c->idec, (const uint8_t *)data, size);
+    } else {
+        return true;
+    }
+
+    if (webpres == VP8_STATUS_OK) {
+        webp__stop(webp_c, WEBP_DONE);
+    } else if (webpres != VP8_STATUS_SUSPENDED) {
+        NSLOG(wisp, INFO, "WebPIAppend failed:%p %d", c, webpres);
+        webp__stop(webp_c, WEBP_STOPPED);
+        return true;
+    }
+
+    /* show the rows decoded so far */
+    if (image_cache_progress_due(c)) {
+        image_cache_progress(c);
+    }
+
+    return true;
+}
+
 /**
  * Convert the webp source data content.
  *
@@ -192,12 +350,31 @@ static struct bitmap *webp_cache_convert(struct content *c)
  */
 static bool webp_convert(struct content *c)
 {
+    webp_content *webp_c = (webp_content *)c;
     int res;
     const uint8_t *data;
     size_t data_size;
     int width;
     int height;
 
+    if (webp_c->state == WEBP_DONE) {
+        /* hand the bitmap decoded as data arrived to the cache */
+        guit->bitmap->set_opaque(webp_c->bitmap, !webp_c->has_alpha);
+        guit->bitmap->modified(webp_c->bitmap);
+        image_cache_add(c, webp_c->bitmap, webp_cache_convert);
+
+        content_set_ready(c);
+        content_set_done(c);
+
+        return true;
+    }
+
+    /* a truncated or undecodable image is left to the full decoder and
+     * any partly decoded bitmap is discarded by the cache
+     */
+    webp__stop(webp_c, WEBP_STOPPED);
+    webp_c->bitmap = NULL;
+
     data = content__get_source_data(c, &data_size);
 
     res = WebPGetInfo(data, data_size, &width, &height);
@@ -223,37 +400,54 @@ static bool webp_convert(struct content *c)
  */
 static nserror webp_clone(const struct content *old, struct content **new_c)
 {
-    struct content *webp_c; /* cloned webp content */
+    webp_content *webp_c; /* cloned webp content */
     nserror res;
 
-    webp_c = calloc(1, sizeof(struct content));
+    webp_c = calloc(1, sizeof(webp_content));
     if (webp_c == NULL) {
         return NSERROR_NOMEM;
     }
 
-    res = content__clone(old, webp_c);
+    res = content__clone(old, &webp_c->base);
     if (res != NSERROR_OK) {
-        content_destroy(webp_c);
+        content_destroy(&webp_c->base);
         return res;
     }
 
-    /* re-convert if the content is ready */
     if ((old->status == CONTENT_STATUS_READY) || (old->status == CONTENT_STATUS_DONE)) {
-        if (webp_convert(webp_c) == false) {
-            content_destroy(webp_c);
+        /* re-convert if the content is ready */
+        if (webp_convert(&webp_c->base) == false) {
+            content_destroy(&webp_c->base);
             return NSERROR_CLONE_FAILED;
         }
+    } else if (content__get_source_length(&webp_c->base) > 0) {
+        /* catch up with the data received so far */
+        webp_process_data(&webp_c->base, NULL, 0);
     }
 
-    *new_c = webp_c;
+    *new_c = (struct content *)webp_c;
 
     return NSERROR_OK;
 }
 
+/**
+ * Destroy the webp content.
+ */
+static void webp_destroy(struct content *c)
+{
+    webp_content *webp_c = (webp_content *)c;
+
+    /* the fetch was abandoned before the image was complete */
+    webp__stop(webp_c, WEBP_STOPPED);
+
+    image_cache_destroy(c);
+}
+
 static const content_handler webp_content_handler = {
     .create = webp_create,
+    .process_data = webp_process_data,
     .data_complete = webp_convert,
-    .destroy = image_cache_destroy,
+    .destroy = webp_destroy,
     .redraw = image_cache_redraw,
     .clone = webp_clone,
     .get_internal = image_cache_get_internal,
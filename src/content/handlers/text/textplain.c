@@ -531,6 +531,7 @@ static nserror textplain_clone(const struct content *old, struct content **newc)
     nserror error;
     const uint8_t *data;
     size_t size;
+    size_t offset = 0;
 
     text = calloc(1, sizeof(textplain_content));
     if (text == NULL)
@@ -549,12 +550,12 @@ static nserror textplain_clone(const struct content *old, struct content **newc)
         return error;
     }
 
-    data = content__get_source_data(&text->base, &size);
-    if (size > 0) {
+    while ((data = content__get_source_run(&text->base, offset, &size)) != NULL) {
         if (textplain_process_data(&text->base, (const char *)data, size) == false) {
             content_destroy(&text->base);
             return NSERROR_NOMEM;
         }
+        offset += size;
     }
 
     if (old->status == CONTENT_STATUS_READY || old->status == CONTENT_STATUS_DONE) {
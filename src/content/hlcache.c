@@ -39,7 +39,7 @@
 #include <wisp/content/llcache.h>
 #include "content/mimesniff.h"
 // Note, this is *ONLY* so that we can abort cleanly during shutdown of the
-// cache
+// cache and size the contents kept for history navigation
 #include <wisp/content/content_protected.h>
 #include "content/content_factory.h"
 
@@ -63,6 +63,8 @@ struct hlcache_retrieval_ctx {
 
     bool migrate_target; /**< Whether this context is the migration target
                           */
+
+    uint64_t digest; /**< Digest of the source of a buffer retrieval, or 0 */
 };
 
 /** High-level cache handle */
@@ -73,10 +75,30 @@ struct hlcache_handle {
     void *pw; /**< Client data */
 };
 
+/** Indexes of the high-level cache entries */
+enum hlcache_index_type {
+    HLCACHE_INDEX_OBJECT, /**< Keyed by low-level object identity */
+    HLCACHE_INDEX_URL, /**< Keyed by hash of content URL */
+    HLCACHE_INDEX_DIGEST, /**< Keyed by digest of buffer source data */
+    HLCACHE_INDEX_COUNT
+};
+
+/** Hash index of high-level cache entries */
+struct hlcache_index {
+    hlcache_entry **buckets; /**< Chains of entries, size is a power of 2 */
+    size_t size; /**< Number of buckets */
+    size_t count; /**< Number of entries indexed */
+};
+
 /** Entry in high-level cache */
 struct hlcache_entry {
     struct content *content; /**< Pointer to associated content */
 
+    uint32_t released; /**< Release serial of the last handle released */
+
+    uint64_t key[HLCACHE_INDEX_COUNT]; /**< Index keys, 0 if not indexed */
+    hlcache_entry *chain[HLCACHE_INDEX_COUNT]; /**< Next entry in index bucket */
+
     hlcache_entry *next; /**< Next sibling */
     hlcache_entry *prev; /**< Previous sibling */
 };
@@ -94,9 +116,22 @@ struct hlcache_s {
     /** Ring of retrieval contexts */
     hlcache_retrieval_ctx *retrieval_ctx_ring;
 
+    /** Serial stamped on entries as their handles are released */
+    uint32_t release_serial;
+
+    /** Estimated size of the unused contents kept by the last clean */
+    size_t retained_size;
+
+    /** Indexes of the content list */
+    struct hlcache_index index[HLCACHE_INDEX_COUNT];
+
     /* statistics */
     unsigned int hit_count;
     unsigned int miss_count;
+    unsigned int restore_count;
+    unsigned int buffer_hit_count;
+    unsigned int buffer_miss_count;
+    unsigned int buffer_collision_count;
 };
 
 /** high level cache state */
@@ -108,12 +143,228 @@ static struct hlcache_s *hlcache = NULL;
  ******************************************************************************/
 
 
+/**
+ * Find the bucket of an index holding a key
+ *
+ * \param index  The index
+ * \param key    The key
+ * \return The bucket number
+ */
+static size_t hlcache_index_bucket(const struct hlcache_index *index, uint64_t key)
+{
+    /* Fibonacci hashing spreads pointers and digests alike */
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (index->size - 1);
+}
+
+/**
+ * Add an entry to an index
+ *
+ * The index grows once it holds more entries than buckets. If that fails
+ * the entry is still added, the chains just get longer.
+ *
+ * \param type   The index to add to
+ * \param entry  The entry to add
+ * \param key    The non-zero key of the entry
+ */
+static void hlcache_index_insert(enum hlcache_index_type type, hlcache_entry *entry, uint64_t key)
+{
+    struct hlcache_index *index = &hlcache->index[type];
+    size_t bucket;
+
+    assert(key != 0);
+
+    if (index->count >= index->size) {
+        size_t size = (index->size == 0) ? 64 : index->size * 2;
+        hlcache_entry **buckets = calloc(size, sizeof(*buckets));
+
+        if (buckets != NULL) {
+            size_t old_size = index->size;
+            hlcache_entry **old_buckets = index->buckets;
+
+            index->buckets = buckets;
+            index->size = size;
+
+            for (bucket = 0; bucket < old_size; bucket++) {
+                hlcache_entry *e, *next;
+
+                for (e = old_buckets[bucket]; e != NULL; e = next) {
+                    size_t b = hlcache_index_bucket(index, e->key[type]);
+
+                    next = e->chain[type];
+                    e->chain[type] = buckets[b];
+                    buckets[b] = e;
+                }
+            }
+            free(old_buckets);
+        } else if (index->size == 0) {
+            return;
+        }
+    }
+
+    bucket = hlcache_index_bucket(index, key);
+    entry->key[type] = key;
+    entry->chain[type] = index->buckets[bucket];
+    index->buckets[bucket] = entry;
+    index->count++;
+}
+
+/**
+ * Remove an entry from an index it may be in
+ *
+ * \param type   The index to remove from
+ * \param entry  The entry to remove
+ */
+static void hlcache_index_remove(enum hlcache_index_type type, hlcache_entry *entry)
+{
+    struct hlcache_index *index = &hlcache->index[type];
+    hlcache_entry **link;
+
+    if (entry->key[type] == 0)
+        return;
+
+    link = &index->buckets[hlcache_index_bucket(index, entry->key[type])];
+    while (*link != NULL && *link != entry)
+        link = &(*link)->chain[type];
+
+    if (*link != NULL) {
+        *link = entry->chain[type];
+        index->count--;
+    }
+
+    entry->key[type] = 0;
+    entry->chain[type] = NULL;
+}
+
+/**
+ * Find the first entry of an index which may have a key
+ *
+ * Further candidates follow on the entry's chain; callers must check the
+ * key of each entry.
+ *
+ * \param type  The index to search
+ * \param key   The key to find
+ * \return The first entry in the key's bucket, or NULL if there are none
+ */
+static hlcache_entry *hlcache_index_first(enum hlcache_index_type type, uint64_t key)
+{
+    struct hlcache_index *index = &hlcache->index[type];
+
+    if (index->size == 0)
+        return NULL;
+
+    return index->buckets[hlcache_index_bucket(index, key)];
+}
+
+/**
+ * Compute the URL index key of a URL
+ */
+static inline uint64_t hlcache_url_key(const nsurl *url)
+{
+    /* Keep the key non-zero whatever the hash */
+    return (1ull << 32) | nsurl_hash(url);
+}
+
+/**
+ * Add a new entry to the content list and the indexes
+ *
+ * \param entry   The entry, with its content set
+ * \param digest  Digest of the buffer the content was retrieved from, or 0
+ */
+static void hlcache_entry_insert(hlcache_entry *entry, uint64_t digest)
+{
+    const llcache_handle *llcache = content_get_llcache_handle(entry->content);
+    enum hlcache_index_type type;
+
+    entry->released = 0;
+    entry->prev = NULL;
+    entry->next = hlcache->content_list;
+    if (hlcache->content_list != NULL)
+        hlcache->content_list->prev = entry;
+    hlcache->content_list = entry;
+
+    for (type = 0; type < HLCACHE_INDEX_COUNT; type++) {
+        entry->key[type] = 0;
+        entry->chain[type] = NULL;
+    }
+
+    if (llcache != NULL) {
+        hlcache_index_insert(HLCACHE_INDEX_OBJECT, entry, llcache_handle_get_object_id(llcache));
+        hlcache_index_insert(HLCACHE_INDEX_URL, entry, hlcache_url_key(llcache_handle_get_url(llcache)));
+    }
+    if (digest != 0)
+        hlcache_index_insert(HLCACHE_INDEX_DIGEST, entry, digest);
+}
+
+
+/**
+ * Remove an entry from the cache and destroy its content
+ *
+ * \param entry  The entry to destroy
+ */
+static void hlcache_entry_destroy(hlcache_entry *entry)
+{
+    /* Remove entry from cache */
+    if (entry->prev == NULL)
+        hlcache->content_list = entry->next;
+    else
+        entry->prev->next = entry->next;
+
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+
+    hlcache_index_remove(HLCACHE_INDEX_OBJECT, entry);
+    hlcache_index_remove(HLCACHE_INDEX_URL, entry);
+    hlcache_index_remove(HLCACHE_INDEX_DIGEST, entry);
+
+    /* Destroy content */
+    content_destroy(entry->content);
+
+    /* Destroy entry */
+    free(entry);
+}
+
+/**
+ * Estimate the memory held by an unused content
+ *
+ * \param entry  The entry holding the content
+ * \return The estimated size in bytes
+ */
+static size_t hlcache_entry_size(hlcache_entry *entry)
+{
+    return entry->content->size + content__get_source_length(entry->content);
+}
+
+/**
+ * Order entries most recently released first
+ */
+static int hlcache_entry_released_cmp(const void *a, const void *b)
+{
+    const hlcache_entry *ea = *(const hlcache_entry *const *)a;
+    const hlcache_entry *eb = *(const hlcache_entry *const *)b;
+    /* The difference stays ordered across serial wrap-around */
+    int32_t delta = (int32_t)(eb->released - ea->released);
+
+    return (delta > 0) - (delta < 0);
+}
+
 /**
  * Attempt to clean the cache
+ *
+ * Unused contents are destroyed, except for those that can be restored on
+ * history navigation. The most recently released of those are kept for as
+ * long as they fit in the retention budget.
+ *
+ * \todo Retained contents whose source data has gone stale can never be
+ * restored, they should be purged ahead of fresh ones.
  */
 static void hlcache_clean(void *force_clean_flag)
 {
     hlcache_entry *entry, *next;
+    hlcache_entry **retained = NULL;
+    size_t retained_count = 0;
+    size_t retained_alloc = 0;
+    size_t retained_size = 0;
+    size_t idx;
     bool force_clean = (force_clean_flag != NULL);
 
     for (entry = hlcache->content_list; entry != NULL; entry = next) {
@@ -133,28 +384,43 @@ static void hlcache_clean(void *force_clean_flag)
             content_set_error(entry->content);
         }
 
-        /** \todo This is over-zealous: all unused contents
-         * will be immediately destroyed. Ideally, we want to
-         * purge all unused contents that are using stale
-         * source data, and enough fresh contents such that
-         * the cache fits in the configured cache size limit.
-         */
-
-        /* Remove entry from cache */
-        if (entry->prev == NULL)
-            hlcache->content_list = entry->next;
-        else
-            entry->prev->next = entry->next;
+        /* Candidates for retention are sized up once all are known */
+        if ((force_clean == false) && (hlcache->params.retain_limit > 0) && content_is_retainable(entry->content)) {
+            if (retained_count == retained_alloc) {
+                size_t alloc = (retained_alloc == 0) ? 16 : retained_alloc * 2;
+                hlcache_entry **tmp = realloc(retained, alloc * sizeof(*retained));
+                if (tmp != NULL) {
+                    retained = tmp;
+                    retained_alloc = alloc;
+                }
+            }
+            if (retained_count < retained_alloc) {
+                retained[retained_count++] = entry;
+                continue;
+            }
+        }
 
-        if (entry->next != NULL)
-            entry->next->prev = entry->prev;
+        hlcache_entry_destroy(entry);
+    }
 
-        /* Destroy content */
-        content_destroy(entry->content);
+    /* Keep the most recently used contents that fit in the budget */
+    if (retained_count > 1) {
+        qsort(retained, retained_count, sizeof(*retained), hlcache_entry_released_cmp);
+    }
+    for (idx = 0; idx < retained_count; idx++) {
+        size_t size = hlcache_entry_size(retained[idx]);
 
-        /* Destroy entry */
-        free(entry);
+        if (retained_size + size <= hlcache->params.retain_limit) {
+            retained_size += size;
+        } else {
+            /* Evict this and everything less recently used */
+            for (; idx < retained_count; idx++) {
+                hlcache_entry_destroy(retained[idx]);
+            }
+        }
     }
+    free(retained);
+    hlcache->retained_size = retained_size;
 
     /* Attempt to clean the llcache */
     llcache_clean(false);
@@ -228,22 +494,34 @@ static nserror hlcache_find_content(hlcache_retrieval_ctx *ctx, lwc_string *effe
     hlcache_entry *entry;
     hlcache_event event;
     nserror error = NSERROR_OK;
+    uint64_t object = llcache_handle_get_object_id(ctx->llcache);
 
-    /* Search list of cached contents for a suitable one */
-    for (entry = hlcache->content_list; entry != NULL; entry = entry->next) {
+    /* Search cached contents of the same low-level object for a suitable
+     * one */
+    for (entry = hlcache_index_first(HLCACHE_INDEX_OBJECT, object); entry != NULL;
+         entry = entry->chain[HLCACHE_INDEX_OBJECT]) {
         hlcache_handle entry_handle = {entry, NULL, NULL};
         const llcache_handle *entry_llcache;
 
-        if (entry->content == NULL)
+        if (entry->key[HLCACHE_INDEX_OBJECT] != object || entry->content == NULL)
             continue;
 
         /* Ignore contents in the error state */
         if (content_get_status(&entry_handle) == CONTENT_STATUS_ERROR)
             continue;
 
-        /* Ensure that content is shareable */
-        if (content_is_shareable(entry->content) == false)
-            continue;
+        /* Ensure that content is shareable, or is an unused content
+         * being restored by history navigation */
+        if (content_is_shareable(entry->content) == false) {
+            if ((ctx->flags & HLCACHE_RETRIEVE_RESTORE) == 0)
+                continue;
+
+            if (content_count_users(entry->content) != 0)
+                continue;
+
+            if (content_is_retainable(entry->content) == false)
+                continue;
+        }
 
         /* Ensure that quirks mode is acceptable */
         if (content_matches_quirks(entry->content, ctx->child.quirks) == false)
@@ -274,11 +552,7 @@ static nserror hlcache_find_content(hlcache_retrieval_ctx *ctx, lwc_string *effe
         }
 
         /* Insert into cache */
-        entry->prev = NULL;
-        entry->next = hlcache->content_list;
-        if (hlcache->content_list != NULL)
-            hlcache->content_list->prev = entry;
-        hlcache->content_list = entry;
+        hlcache_entry_insert(entry, ctx->digest);
 
         /* Signal to caller that we created a content */
         error = NSERROR_NEED_DATA;
@@ -288,6 +562,11 @@ static nserror hlcache_find_content(hlcache_retrieval_ctx *ctx, lwc_string *effe
         /* Found a suitable content: no longer need low-level handle */
         llcache_handle_release(ctx->llcache);
         hlcache->hit_count++;
+
+        if (content_is_shareable(entry->content) == false) {
+            NSLOG(wisp, INFO, "Restoring retained content %p", entry->content);
+            hlcache->restore_count++;
+        }
     }
 
     /* Associate handle with content */
@@ -643,7 +922,13 @@ void hlcache_finalise(void)
         hlcache->retrieval_ctx_ring = NULL;
     }
 
-    NSLOG(wisp, INFO, "hit/miss %d/%d", hlcache->hit_count, hlcache->miss_count);
+    NSLOG(wisp, INFO, "hit/miss %d/%d, %d restored", hlcache->hit_count, hlcache->miss_count, hlcache->restore_count);
+    NSLOG(wisp, INFO, "buffer hit/miss %d/%d, %d digest collisions", hlcache->buffer_hit_count,
+        hlcache->buffer_miss_count, hlcache->buffer_collision_count);
+
+    free(hlcache->index[HLCACHE_INDEX_OBJECT].buckets);
+    free(hlcache->index[HLCACHE_INDEX_URL].buckets);
+    free(hlcache->index[HLCACHE_INDEX_DIGEST].buckets);
 
     /* De-schedule ourselves */
     guit->misc->schedule(-1, hlcache_clean, NULL);
@@ -667,11 +952,14 @@ nserror hlcache_handle_retrieve(nsurl *url, uint32_t flags, nsurl *referer, llca
 
     /* Optimization: Check if content is already in hlcache */
     if (post == NULL && (flags & LLCACHE_RETRIEVE_FORCE_FETCH) == 0) {
+        uint64_t key = hlcache_url_key(url);
         hlcache_entry *entry;
-        for (entry = hlcache->content_list; entry != NULL; entry = entry->next) {
+
+        for (entry = hlcache_index_first(HLCACHE_INDEX_URL, key); entry != NULL;
+             entry = entry->chain[HLCACHE_INDEX_URL]) {
             hlcache_handle entry_handle = {entry, NULL, NULL};
 
-            if (entry->content == NULL)
+            if (entry->key[HLCACHE_INDEX_URL] != key || entry->content == NULL)
                 continue;
 
             /* Ignore contents in the error state */
@@ -844,6 +1132,7 @@ nserror hlcache_handle_release(hlcache_handle *handle)
 {
     if (handle->entry != NULL) {
         content_remove_user(handle->entry->content, hlcache_content_callback, handle);
+        handle->entry->released = ++hlcache->release_serial;
     } else {
         RING_ITERATE_START(struct hlcache_retrieval_ctx, hlcache->retrieval_ctx_ring, ictx)
         {
@@ -941,11 +1230,7 @@ nserror hlcache_handle_abort(hlcache_handle *handle)
 
         entry->content = clone;
         handle->entry = entry;
-        entry->prev = NULL;
-        entry->next = hlcache->content_list;
-        if (hlcache->content_list != NULL)
-            hlcache->content_list->prev = entry;
-        hlcache->content_list = entry;
+        hlcache_entry_insert(entry, 0);
 
         c = clone;
     }
@@ -994,17 +1279,147 @@ nsurl *hlcache_handle_get_url(const hlcache_handle *handle)
     return result;
 }
 
+/** Primes of the buffer digest */
+#define HLCACHE_DIGEST_P1 0x9E3779B185EBCA87ull
+#define HLCACHE_DIGEST_P2 0xC2B2AE3D27D4EB4Full
+#define HLCACHE_DIGEST_P3 0x165667B19E3779F9ull
+#define HLCACHE_DIGEST_P4 0x85EBCA77C2B2AE63ull
+#define HLCACHE_DIGEST_P5 0x27D4EB2F165667C5ull
+
+static inline uint64_t hlcache_digest_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hlcache_digest_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hlcache_digest_round(uint64_t acc, uint64_t input)
+{
+    acc += input * HLCACHE_DIGEST_P2;
+    acc = hlcache_digest_rotl(acc, 31);
+    return acc * HLCACHE_DIGEST_P1;
+}
+
+static inline uint64_t hlcache_digest_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= hlcache_digest_round(0, val);
+    return acc * HLCACHE_DIGEST_P1 + HLCACHE_DIGEST_P4;
+}
+
 /**
- * FNV-1a hash for generating content-based synthetic URLs.
+ * Compute the digest of a buffer retrieved for inline content
+ *
+ * This is XXH64 with a zero seed, which consumes 32 bytes per iteration
+ * across four independent lanes. Words are read in host order since the
+ * digest never leaves the cache.
+ *
+ * \param data  The buffer
+ * \param len   The length of the buffer
+ * \return The digest, never 0
  */
-static uint32_t hlcache_fnv1a(const uint8_t *data, size_t len)
+static uint64_t hlcache_buffer_digest(const uint8_t *data, size_t len)
 {
-    uint32_t hash = 0x811c9dc5u; /* FNV offset basis */
-    for (size_t i = 0; i < len; i++) {
-        hash ^= data[i];
-        hash *= 0x01000193u; /* FNV prime */
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = HLCACHE_DIGEST_P1 + HLCACHE_DIGEST_P2;
+        uint64_t v2 = HLCACHE_DIGEST_P2;
+        uint64_t v3 = 0;
+        uint64_t v4 = -HLCACHE_DIGEST_P1;
+
+        do {
+            v1 = hlcache_digest_round(v1, hlcache_digest_read64(p));
+            v2 = hlcache_digest_round(v2, hlcache_digest_read64(p + 8));
+            v3 = hlcache_digest_round(v3, hlcache_digest_read64(p + 16));
+            v4 = hlcache_digest_round(v4, hlcache_digest_read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        h = hlcache_digest_rotl(v1, 1) + hlcache_digest_rotl(v2, 7) + hlcache_digest_rotl(v3, 12) +
+            hlcache_digest_rotl(v4, 18);
+        h = hlcache_digest_merge(h, v1);
+        h = hlcache_digest_merge(h, v2);
+        h = hlcache_digest_merge(h, v3);
+        h = hlcache_digest_merge(h, v4);
+    } else {
+        h = HLCACHE_DIGEST_P5;
+    }
+
+    h += (uint64_t)len;
+
+    for (; end - p >= 8; p += 8) {
+        h ^= hlcache_digest_round(0, hlcache_digest_read64(p));
+        h = hlcache_digest_rotl(h, 27) * HLCACHE_DIGEST_P1 + HLCACHE_DIGEST_P4;
     }
-    return hash;
+    if (end - p >= 4) {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w));
+        h ^= (uint64_t)w * HLCACHE_DIGEST_P1;
+        h = hlcache_digest_rotl(h, 23) * HLCACHE_DIGEST_P2 + HLCACHE_DIGEST_P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (uint64_t)*p * HLCACHE_DIGEST_P5;
+        h = hlcache_digest_rotl(h, 11) * HLCACHE_DIGEST_P1;
+    }
+
+    h ^= h >> 33;
+    h *= HLCACHE_DIGEST_P2;
+    h ^= h >> 29;
+    h *= HLCACHE_DIGEST_P3;
+    h ^= h >> 32;
+
+    /* Zero marks entries which are not indexed */
+    return (h != 0) ? h : 1;
+}
+
+/**
+ * Find a cached content converted from the same buffer
+ *
+ * \param data            The buffer
+ * \param len             The length of the buffer
+ * \param digest          The digest of the buffer
+ * \param accepted_types  Accepted content types
+ * \return The entry of a suitable content, or NULL if there is none
+ */
+static hlcache_entry *
+hlcache_find_buffer(const uint8_t *data, size_t len, uint64_t digest, content_type accepted_types)
+{
+    hlcache_entry *entry;
+
+    for (entry = hlcache_index_first(HLCACHE_INDEX_DIGEST, digest); entry != NULL;
+         entry = entry->chain[HLCACHE_INDEX_DIGEST]) {
+        hlcache_handle entry_handle = {entry, NULL, NULL};
+        const uint8_t *source;
+        size_t source_len;
+
+        if (entry->key[HLCACHE_INDEX_DIGEST] != digest || entry->content == NULL)
+            continue;
+
+        if (content_get_status(&entry_handle) == CONTENT_STATUS_ERROR)
+            continue;
+
+        if ((content_get_type(&entry_handle) & accepted_types) == 0)
+            continue;
+
+        /* Digests can collide, so the source must match exactly */
+        source = content__get_source_data(entry->content, &source_len);
+        if (source == NULL || source_len != len || memcmp(source, data, len) != 0) {
+            hlcache->buffer_collision_count++;
+            continue;
+        }
+
+        return entry;
+    }
+
+    return NULL;
 }
 
 /* See hlcache.h for documentation */
@@ -1017,73 +1432,63 @@ nserror hlcache_handle_retrieve_buffer(const uint8_t *data, size_t len, const ch
     nserror error;
     nsurl *url = NULL;
     char url_buf[64];
+    uint64_t digest;
 
     assert(data != NULL);
     assert(len > 0);
     assert(cb != NULL);
 
-    /* Generate a content-hash URL for deduplication */
-    uint32_t hash = hlcache_fnv1a(data, len);
-    snprintf(url_buf, sizeof(url_buf), "wisp-inline://svg-%08x-%zu", hash, len);
-    error = nsurl_create(url_buf, &url);
-    if (error != NSERROR_OK)
-        return error;
-
-    /* Check for existing content with the same URL (dedup) */
-    for (entry = hlcache->content_list; entry != NULL; entry = entry->next) {
-        hlcache_handle entry_handle = {entry, NULL, NULL};
-
-        if (entry->content == NULL)
-            continue;
-
-        if (content_get_status(&entry_handle) == CONTENT_STATUS_ERROR)
-            continue;
+    digest = hlcache_buffer_digest(data, len);
 
-        if (nsurl_compare(hlcache_handle_get_url(&entry_handle), url, NSURL_COMPLETE)) {
-
-            if ((content_get_type(&entry_handle) & accepted_types) == 0)
-                continue;
+    entry = hlcache_find_buffer(data, len, digest, accepted_types);
+    if (entry != NULL) {
+        /* Cache hit — reuse existing content */
+        hlcache_handle *handle;
+        content_status status;
+        hlcache_event event;
 
-            /* Cache hit — reuse existing content */
-            NSLOG(wisp, DEBUG, "BUFFER: cache HIT (dedup) '%s'", url_buf);
+        NSLOG(wisp, DEBUG, "BUFFER: cache HIT (dedup) %016" PRIx64 "-%zu", digest, len);
+        hlcache->buffer_hit_count++;
 
-            hlcache_handle *handle = calloc(1, sizeof(hlcache_handle));
-            if (handle == NULL) {
-                nsurl_unref(url);
-                return NSERROR_NOMEM;
-            }
-
-            handle->entry = entry;
-            handle->cb = cb;
-            handle->pw = pw;
+        handle = calloc(1, sizeof(hlcache_handle));
+        if (handle == NULL)
+            return NSERROR_NOMEM;
 
-            if (content_add_user(entry->content, hlcache_content_callback, handle) == false) {
-                free(handle);
-                nsurl_unref(url);
-                return NSERROR_NOMEM;
-            }
+        handle->entry = entry;
+        handle->cb = cb;
+        handle->pw = pw;
 
-            *result = handle;
-            nsurl_unref(url);
+        if (content_add_user(entry->content, hlcache_content_callback, handle) == false) {
+            free(handle);
+            return NSERROR_NOMEM;
+        }
 
-            /* Fire state catch-up callbacks */
-            content_status status = content_get_status(handle);
-            hlcache_event event;
-            if (status == CONTENT_STATUS_DONE) {
-                event.type = CONTENT_MSG_LOADING;
-                handle->cb(handle, &event, handle->pw);
-                event.type = CONTENT_MSG_READY;
-                handle->cb(handle, &event, handle->pw);
-                event.type = CONTENT_MSG_DONE;
-                handle->cb(handle, &event, handle->pw);
-            }
+        *result = handle;
 
-            return NSERROR_OK;
+        /* Fire state catch-up callbacks */
+        status = content_get_status(handle);
+        if (status == CONTENT_STATUS_DONE) {
+            event.type = CONTENT_MSG_LOADING;
+            handle->cb(handle, &event, handle->pw);
+            event.type = CONTENT_MSG_READY;
+            handle->cb(handle, &event, handle->pw);
+            event.type = CONTENT_MSG_DONE;
+            handle->cb(handle, &event, handle->pw);
         }
+
+        return NSERROR_OK;
     }
 
+    /* Generate a content-hash URL; the low-level cache also uses it for
+     * deduplication, checking the data as well */
+    snprintf(url_buf, sizeof(url_buf), "wisp-inline://svg-%016" PRIx64 "-%zu", digest, len);
+    error = nsurl_create(url_buf, &url);
+    if (error != NSERROR_OK)
+        return error;
+
     /* Cache miss — create new content via synthetic llcache entry */
     NSLOG(wisp, DEBUG, "BUFFER: cache MISS '%s'", url_buf);
+    hlcache->buffer_miss_count++;
 
     ctx = calloc(1, sizeof(hlcache_retrieval_ctx));
     if (ctx == NULL) {
@@ -1113,6 +1518,7 @@ nserror hlcache_handle_retrieve_buffer(const uint8_t *data, size_t len, const ch
 
     ctx->flags = HLCACHE_RETRIEVE_SNIFF_TYPE;
     ctx->accepted_types = accepted_types;
+    ctx->digest = digest;
     ctx->handle->cb = cb;
     ctx->handle->pw = pw;
 
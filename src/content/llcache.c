@@ -46,8 +46,10 @@
 #include <wisp/utils/nsoption.h>
 #include <wisp/utils/nsurl.h>
 #include <wisp/utils/utils.h>
+#include "utils/chunkbuf.h"
 #include "utils/http.h"
 #include "utils/time.h"
+#include "utils/trace.h"
 #include <wisp/ns_inttypes.h>
 #include "wisp/misc.h"
 
@@ -144,6 +146,8 @@ typedef struct {
     time_t expires; /**< Expires: response header */
     int age; /**< Age: response header */
     int max_age; /**< Max-Age Cache-control parameter */
+    int stale_while_revalidate; /**< Stale-While-Revalidate Cache-control parameter */
+    int stale_if_error; /**< Stale-If-Error Cache-control parameter */
     llcache_validate no_cache; /**< No-Cache Cache-control parameter */
     char *etag; /**< Etag: response header */
     time_t last_modified; /**< Last-Modified: response header */
@@ -172,10 +176,8 @@ struct llcache_object {
 
     nsurl *url; /**< Post-redirect URL for object */
 
-    /** \todo We need a generic dynamic buffer object */
-    uint8_t *source_data; /**< Source data for object */
+    struct chunkbuf source; /**< Source data for object, if held */
     size_t source_len; /**< Byte length of source data */
-    size_t source_alloc; /**< Allocated size of source buffer */
 
     struct cert_chain *chain; /**< Certificate chain from the fetch */
 
@@ -192,6 +194,9 @@ struct llcache_object {
     uint32_t candidate_count; /**< Count of objects this is a
                                * candidate for
                                */
+    bool background; /**< Whether this object revalidates its
+                      * candidate while the candidate is used
+                      */
 
     llcache_header *headers; /**< Fetch headers */
     size_t num_headers; /**< Number of fetch headers */
@@ -260,6 +265,9 @@ struct llcache_s {
      * Total number of milliseconds taken to write to backing store.
      */
     uint64_t total_elapsed;
+
+    /** Retrieval statistics */
+    struct llcache_stats stats;
 };
 
 /** low level cache state */
@@ -590,6 +598,14 @@ static nserror llcache_fetch_parse_cache_control(llcache_object *object, char *v
         object->cache.max_age = http_cache_control_max_age(cc);
     }
 
+    if (http_cache_control_has_stale_while_revalidate(cc)) {
+        object->cache.stale_while_revalidate = http_cache_control_stale_while_revalidate(cc);
+    }
+
+    if (http_cache_control_has_stale_if_error(cc)) {
+        object->cache.stale_if_error = http_cache_control_stale_if_error(cc);
+    }
+
     http_cache_control_destroy(cc);
 
     return NSERROR_OK;
@@ -693,6 +709,8 @@ static inline void llcache_invalidate_cache_control_data(llcache_object *object)
 
     object->cache.age = INVALID_AGE;
     object->cache.max_age = INVALID_AGE;
+    object->cache.stale_while_revalidate = INVALID_AGE;
+    object->cache.stale_if_error = INVALID_AGE;
 }
 
 /**
@@ -1016,13 +1034,7 @@ static nserror llcache_object_destroy(llcache_object *object)
 
     cert_chain_free(object->chain);
 
-    if (object->source_data != NULL) {
-        if (object->store_state == LLCACHE_STATE_DISC) {
-            guit->llcache->release(object->url, BACKING_STORE_NONE);
-        } else {
-            free(object->source_data);
-        }
-    }
+    chunkbuf_release(&object->source);
 
     nsurl_unref(object->url);
 
@@ -1077,32 +1089,44 @@ static nserror llcache_object_add_to_list(llcache_object *object, llcache_object
 }
 
 /**
- * Determine the remaining lifetime of a cache object using the
+ * Determine the current age and freshness lifetime of a cache object
  *
  * \param cd cache control data.
- * \return The length of time remaining for the object or 0 if expired.
+ * \param current_age Updated to the current age of the object.
+ * \param freshness_lifetime Updated to the freshness lifetime of the object.
  */
-static int llcache_object_rfc2616_remaining_lifetime(const llcache_cache_control *cd)
+static void llcache_object_rfc2616_age(const llcache_cache_control *cd, int *current_age, int *freshness_lifetime)
 {
-    int current_age, freshness_lifetime;
     time_t now = time(NULL);
 
     /* Calculate staleness of cached object as per RFC 2616 13.2.3/13.2.4 */
-    current_age = max(0, (cd->res_time - cd->date));
-    current_age = max(current_age, (cd->age == INVALID_AGE) ? 0 : cd->age);
-    current_age += cd->res_time - cd->req_time + now - cd->res_time;
+    *current_age = max(0, (cd->res_time - cd->date));
+    *current_age = max(*current_age, (cd->age == INVALID_AGE) ? 0 : cd->age);
+    *current_age += cd->res_time - cd->req_time + now - cd->res_time;
 
     /* Determine freshness lifetime of this object */
     if (cd->max_age != INVALID_AGE) {
-        freshness_lifetime = cd->max_age;
+        *freshness_lifetime = cd->max_age;
     } else if (cd->expires != 0) {
-        freshness_lifetime = cd->expires - cd->date;
+        *freshness_lifetime = cd->expires - cd->date;
     } else if (cd->last_modified != 0) {
-        freshness_lifetime = (now - cd->last_modified) / 10;
+        *freshness_lifetime = (now - cd->last_modified) / 10;
     } else {
-        freshness_lifetime = 0;
+        *freshness_lifetime = 0;
     }
+}
 
+/**
+ * Determine the remaining lifetime of a cache object using the
+ *
+ * \param cd cache control data.
+ * \return The length of time remaining for the object or 0 if expired.
+ */
+static int llcache_object_rfc2616_remaining_lifetime(const llcache_cache_control *cd)
+{
+    int current_age, freshness_lifetime;
+
+    llcache_object_rfc2616_age(cd, &current_age, &freshness_lifetime);
     NSLOG(llcache, DEBUG, "%d:%d", freshness_lifetime, current_age);
 
     if ((cd->no_cache == LLCACHE_VALIDATE_FRESH) && (freshness_lifetime > current_age)) {
@@ -1144,6 +1168,50 @@ static bool llcache_object_is_fresh(const llcache_object *object)
         ((remaining_lifetime > 0) || (object->fetch.state != LLCACHE_FETCH_COMPLETE)));
 }
 
+/**
+ * Determine if a stale object is within a period it may still be used for
+ *
+ * RFC 5861 lets a response say how long after it becomes stale it may be
+ * used while it is revalidated (stale-while-revalidate) or when
+ * revalidation fails (stale-if-error).
+ *
+ * \param cd         cache control data.
+ * \param allowance  Seconds the object may be used for once stale, or
+ *                   INVALID_AGE if there is no such period.
+ * \return true if the object is within \a allowance seconds of going stale.
+ */
+static bool llcache_object_within_stale_allowance(const llcache_cache_control *cd, int allowance)
+{
+    int current_age, freshness_lifetime;
+
+    if (allowance == INVALID_AGE || cd->no_cache == LLCACHE_VALIDATE_ALWAYS) {
+        return false;
+    }
+
+    llcache_object_rfc2616_age(cd, &current_age, &freshness_lifetime);
+
+    return (current_age - freshness_lifetime) < allowance;
+}
+
+/**
+ * Determine if a stale object may be used while it is revalidated
+ *
+ * \param object  Object to consider
+ * \return true if object may be used while a revalidation runs in the
+ *         background, false if it must be revalidated first
+ */
+static bool llcache_object_is_usable_stale(const llcache_object *object)
+{
+    const llcache_cache_control *cd = &object->cache;
+
+    /* An explicit reload must see the revalidated object */
+    if (cd->no_cache != LLCACHE_VALIDATE_FRESH || object->fetch.state != LLCACHE_FETCH_COMPLETE) {
+        return false;
+    }
+
+    return llcache_object_within_stale_allowance(cd, cd->stale_while_revalidate);
+}
+
 /**
  * Clone an object's cache data
  *
@@ -1192,6 +1260,12 @@ static nserror llcache_object_clone_cache_data(llcache_object *source, llcache_o
     if (source->cache.max_age != INVALID_AGE)
         destination->cache.max_age = source->cache.max_age;
 
+    if (source->cache.stale_while_revalidate != INVALID_AGE)
+        destination->cache.stale_while_revalidate = source->cache.stale_while_revalidate;
+
+    if (source->cache.stale_if_error != INVALID_AGE)
+        destination->cache.stale_if_error = source->cache.stale_if_error;
+
     if (source->cache.no_cache != LLCACHE_VALIDATE_FRESH)
         destination->cache.no_cache = source->cache.no_cache;
 
@@ -1221,6 +1295,19 @@ static nserror llcache_object_remove_from_list(llcache_object *object, llcache_o
     return NSERROR_OK;
 }
 
+/**
+ * Release source data retrieved from the persistent store
+ *
+ * \param pw  The URL of the object the data was retrieved for
+ */
+static void llcache_release_persisted_data(void *pw)
+{
+    nsurl *url = pw;
+
+    guit->llcache->release(url, BACKING_STORE_NONE);
+    nsurl_unref(url);
+}
+
 /**
  * Retrieve source data for an object from persistent store if necessary.
  *
@@ -1233,8 +1320,12 @@ static nserror llcache_object_remove_from_list(llcache_object *object, llcache_o
  */
 static nserror llcache_retrieve_persisted_data(llcache_object *object)
 {
+    uint8_t *data;
+    size_t len;
+    nserror ret;
+
     /* ensure the source data is present if necessary */
-    if ((object->source_data != NULL) || (object->store_state != LLCACHE_STATE_DISC)) {
+    if (chunkbuf_held(&object->source) || (object->store_state != LLCACHE_STATE_DISC)) {
         /* source data does not require retrieving from
          * persistent store.
          */
@@ -1242,10 +1333,22 @@ static nserror llcache_retrieve_persisted_data(llcache_object *object)
     }
 
     /* Source data for the object may be in the persistent store */
-    NSLOG(wisp, DEBUG, "PROFILER: START Cache retrieve %p", object);
-    nserror ret = guit->llcache->fetch(object->url, BACKING_STORE_NONE, &object->source_data, &object->source_len);
-    NSLOG(wisp, DEBUG, "PROFILER: STOP Cache retrieve %p", object);
-    return ret;
+    TRACE_BEGIN("llcache", "backing store retrieve");
+    ret = guit->llcache->fetch(object->url, BACKING_STORE_NONE, &data, &len);
+    TRACE_END("llcache", "backing store retrieve");
+    if (ret != NSERROR_OK) {
+        return ret;
+    }
+
+    /* The store owns the data, so refer to it rather than copying */
+    ret = chunkbuf_wrap(&object->source, data, len, llcache_release_persisted_data, nsurl_ref(object->url));
+    if (ret != NSERROR_OK) {
+        llcache_release_persisted_data(object->url);
+        return ret;
+    }
+    object->source_len = len;
+
+    return NSERROR_OK;
 }
 
 /**
@@ -1671,9 +1774,6 @@ skip_ssl_certificates:
     /* update object on successful parse of metadata  */
     object->source_len = source_length;
 
-    /** \todo really not sure this is right, nothing is allocated here? */
-    object->source_alloc = metadatalen;
-
     object->cache.req_time = request_time;
     object->cache.res_time = response_time;
     object->cache.fin_time = completion_time;
@@ -1801,6 +1901,63 @@ static nserror llcache_object_fetch_persistent(
     return NSERROR_OK;
 }
 
+/**
+ * Revalidate a stale object without making its users wait
+ *
+ * As for a blocking revalidation, a conditional fetch is made for a new
+ * object with the stale object as its candidate, but the new object has no
+ * users. A 304 response refreshes the stale object's cache data and any
+ * other response becomes the newest object for the URL. Until then the
+ * stale object continues to be handed out.
+ *
+ * \param stale           Stale object to revalidate
+ * \param flags           Fetch flags
+ * \param referer         Referring URL, or NULL if none
+ * \param redirect_count  Number of redirects followed so far
+ * \param hsts_in_use     Whether HSTS applies to this fetch
+ * \return NSERROR_OK on success or if the object is already being
+ *         revalidated, appropriate error otherwise
+ */
+static nserror llcache_object_revalidate_in_background(
+    llcache_object *stale, uint32_t flags, nsurl *referer, uint32_t redirect_count, bool hsts_in_use)
+{
+    nserror error;
+    llcache_object *obj;
+
+    if (stale->candidate_count > 0) {
+        /* A revalidation is already under way */
+        return NSERROR_OK;
+    }
+
+    error = llcache_object_new(stale->url, &obj);
+    if (error != NSERROR_OK)
+        return error;
+
+    /* Clone candidate's cache data */
+    error = llcache_object_clone_cache_data(stale, obj, true);
+    if (error != NSERROR_OK) {
+        llcache_object_destroy(obj);
+        return error;
+    }
+
+    stale->candidate_count++;
+    obj->candidate = stale;
+    obj->background = true;
+
+    error = llcache_object_fetch(obj, flags, referer, NULL, redirect_count, hsts_in_use);
+    if (error != NSERROR_OK) {
+        stale->candidate_count--;
+        llcache_object_destroy(obj);
+        return error;
+    }
+
+    NSLOG(llcache, DEBUG, "Revalidating %p in background (%p)", stale, obj);
+
+    llcache_object_add_to_list(obj, &llcache->cached_objects);
+
+    return NSERROR_OK;
+}
+
 /**
  * Retrieve a potentially cached object
  *
@@ -1818,6 +1975,8 @@ static nserror llcache_object_retrieve_from_cache(nsurl *url, uint32_t flags, ns
 {
     nserror error;
     llcache_object *obj, *newest = NULL;
+    bool fresh = false;
+    bool usable_stale = false;
 
     NSLOG(llcache, DEBUG, "Searching cache for %s flags:%" PRIx32 " referer:%s post:%p", nsurl_access(url), flags,
         referer == NULL ? "" : nsurl_access(referer), post);
@@ -1825,6 +1984,13 @@ static nserror llcache_object_retrieve_from_cache(nsurl *url, uint32_t flags, ns
     /* Search for the most recently fetched matching object */
     for (obj = llcache->cached_objects; obj != NULL; obj = obj->next) {
 
+        /* Until a background revalidation has a response of its
+         * own, users are given the stale object it revalidates
+         */
+        if (obj->background && obj->candidate != NULL) {
+            continue;
+        }
+
         if ((newest == NULL || obj->cache.req_time > newest->cache.req_time) &&
             nsurl_compare(obj->url, url, NSURL_COMPLETE) == true) {
             newest = obj;
@@ -1859,9 +2025,16 @@ static nserror llcache_object_retrieve_from_cache(nsurl *url, uint32_t flags, ns
          */
     }
 
-    if ((newest != NULL) && (llcache_object_is_fresh(newest))) {
-        /* Found a suitable object, and it's still fresh */
-        NSLOG(llcache, DEBUG, "Found fresh %p", newest);
+    if (newest != NULL) {
+        fresh = llcache_object_is_fresh(newest);
+        usable_stale = !fresh && llcache_object_is_usable_stale(newest);
+    }
+
+    if (fresh || usable_stale) {
+        /* Found a suitable object, and it's still fresh or may be
+         * used while it is revalidated
+         */
+        NSLOG(llcache, DEBUG, "Found %s %p", fresh ? "fresh" : "usable stale", newest);
 
         /* The client needs to catch up with the object's state.
          * This will occur the next time that llcache_poll is called.
@@ -1873,6 +2046,18 @@ static nserror llcache_object_retrieve_from_cache(nsurl *url, uint32_t flags, ns
             /* source data was successfully retrieved from
              * persistent store
              */
+            if (usable_stale) {
+                /* The stale object is still usable if the
+                 * revalidation cannot be started
+                 */
+                error = llcache_object_revalidate_in_background(newest, flags, referer, redirect_count,
+                    hsts_in_use);
+                if (error != NSERROR_OK) {
+                    NSLOG(llcache, INFO, "Unable to revalidate %p in background", newest);
+                }
+            }
+
+            llcache->stats.hits++;
             *result = newest;
 
             return NSERROR_OK;
@@ -1928,6 +2113,7 @@ static nserror llcache_object_retrieve_from_cache(nsurl *url, uint32_t flags, ns
             /* Add new object to cache */
             llcache_object_add_to_list(obj, &llcache->cached_objects);
 
+            llcache->stats.revalidations++;
             *result = obj;
 
             return NSERROR_OK;
@@ -1958,6 +2144,7 @@ static nserror llcache_object_retrieve_from_cache(nsurl *url, uint32_t flags, ns
     /* Add new object to cache */
     llcache_object_add_to_list(obj, &llcache->cached_objects);
 
+    llcache->stats.misses++;
     *result = obj;
 
     return NSERROR_OK;
@@ -2021,6 +2208,8 @@ static nserror llcache_object_retrieve(nsurl *url, uint32_t flags, nsurl *refere
 
         /* Add new object to uncached list */
         llcache_object_add_to_list(obj, &llcache->uncached_objects);
+
+        llcache->stats.uncacheable++;
     } else {
         error = llcache_object_retrieve_from_cache(
             defragmented_url, flags, referer, post, redirect_count, hsts_in_use, &obj);
@@ -2364,6 +2553,100 @@ static nserror llcache_fetch_notmodified(llcache_object *object, llcache_object
     return NSERROR_OK;
 }
 
+/**
+ * Fall back to a stale candidate when its revalidation fails
+ *
+ * If the candidate's stale-if-error period has not passed, users are moved
+ * to it as for a 304 Not Modified response, but its cache data is left
+ * alone so it is revalidated again when next retrieved.
+ *
+ * \param object       Object being fetched
+ * \param replacement  Pointer to location to receive replacement object
+ * \return true if the users were moved to the candidate, false if the
+ *         failure must be reported to them
+ */
+static bool llcache_fetch_stale_if_error(llcache_object *object, llcache_object **replacement)
+{
+    llcache_object *candidate = object->candidate;
+    llcache_object_user *user, *next;
+
+    if ((candidate == NULL) ||
+        !llcache_object_within_stale_allowance(&candidate->cache, candidate->cache.stale_if_error)) {
+        return false;
+    }
+
+    NSLOG(llcache, INFO, "Revalidation of %s failed, using stale %p", nsurl_access(object->url), candidate);
+
+    /* Move user(s) to candidate content */
+    for (user = object->users; user != NULL; user = next) {
+        next = user->next;
+
+        llcache_object_remove_user(object, user);
+        llcache_object_add_user(candidate, user);
+    }
+
+    /* Candidate is no longer a candidate for us */
+    candidate->candidate_count--;
+    object->candidate = NULL;
+
+    /* Ensure fetch has stopped */
+    if (object->fetch.fetch != NULL) {
+        fetch_abort(object->fetch.fetch);
+        object->fetch.fetch = NULL;
+    }
+
+    /* Invalidate our cache-control data */
+    llcache_invalidate_cache_control_data(object);
+
+    /* Mark it complete */
+    object->fetch.state = LLCACHE_FETCH_COMPLETE;
+
+    *replacement = candidate;
+
+    return true;
+}
+
+/** Largest source buffer allocated up front from a Content-Length header */
+#define LLCACHE_PRESIZE_LIMIT (16 * 1024 * 1024)
+
+/**
+ * Determine the expected length of an object's source data
+ *
+ * Only an unencoded body is expected to be as long as the Content-Length
+ * header says, and the length is limited so a bogus header cannot make
+ * the cache allocate an unreasonable amount of memory.
+ *
+ * \param object  Object being fetched
+ * \return the expected length in bytes, or 0 if unknown
+ */
+static size_t llcache_object_expected_length(const llcache_object *object)
+{
+    const char *length = NULL;
+    unsigned long long value;
+    char *end;
+    size_t i;
+
+    for (i = 0; i < object->num_headers; i++) {
+        if (strcasecmp(object->headers[i].name, "Content-Encoding") == 0) {
+            return 0;
+        }
+        if (strcasecmp(object->headers[i].name, "Content-Length") == 0) {
+            length = object->headers[i].value;
+        }
+    }
+
+    if (length == NULL) {
+        return 0;
+    }
+
+    value = strtoull(length, &end, 10);
+    if (end == length || value > LLCACHE_PRESIZE_LIMIT) {
+        return 0;
+    }
+
+    return (size_t)value;
+}
+
 /**
  * Process a chunk of fetched data
  *
@@ -2374,6 +2657,8 @@ static nserror llcache_fetch_notmodified(llcache_object *object, llcache_object
  */
 static nserror llcache_fetch_process_data(llcache_object *object, const uint8_t *data, size_t len)
 {
+    nserror error;
+
     if (object->fetch.state != LLCACHE_FETCH_DATA) {
         /**
          * \note
@@ -2390,6 +2675,15 @@ static nserror llcache_fetch_process_data(llcache_object *object, const uint8_t
          *    object expiration time.
          */
         long http_code = fetch_http_code(object->fetch.fetch);
+        llcache_object *replacement;
+
+        /* A server error while revalidating may be answered with
+         * the stale candidate instead (RFC 5861 section 4)
+         */
+        if ((http_code == 500 || http_code == 502 || http_code == 503 || http_code == 504) &&
+            llcache_fetch_stale_if_error(object, &replacement)) {
+            return NSERROR_OK;
+        }
 
         if ((http_code != 200 && http_code != 203) ||
             (nsurl_has_component(object->url, NSURL_QUERY) &&
@@ -2405,21 +2699,22 @@ static nserror llcache_fetch_process_data(llcache_object *object, const uint8_t
         }
 
         object->fetch.state = LLCACHE_FETCH_DATA;
-    }
 
-    /* Resize source buffer if it's too small */
-    if (object->source_len + len >= object->source_alloc) {
-        const size_t new_len = object->source_len + len + 64 * 1024;
-        uint8_t *temp = realloc(object->source_data, new_len);
-        if (temp == NULL)
-            return NSERROR_NOMEM;
+        /* Size the source buffer for the whole body up front */
+        if (!chunkbuf_held(&object->source)) {
+            size_t expected = llcache_object_expected_length(object);
 
-        object->source_data = temp;
-        object->source_alloc = new_len;
+            if (expected > 0) {
+                /* Merely a hint, so carry on without it */
+                (void)chunkbuf_reserve(&object->source, expected);
+            }
+        }
     }
 
     /* Append this data chunk to source buffer */
-    memcpy(object->source_data + object->source_len, data, len);
+    error = chunkbuf_append(&object->source, data, len);
+    if (error != NSERROR_OK)
+        return error;
     object->source_len += len;
 
     return NSERROR_OK;
@@ -2587,6 +2882,7 @@ static nserror llcache_fetch_ssl_error(llcache_object *object)
 static nserror llcache_fetch_timeout(llcache_object *object)
 {
     llcache_event event;
+    llcache_object *replacement;
 
     /* The fetch has already been cleaned up by the fetcher but
      * we would like to retry if we can.
@@ -2600,6 +2896,10 @@ static nserror llcache_fetch_timeout(llcache_object *object)
     object->fetch.state = LLCACHE_FETCH_COMPLETE;
     object->fetch.fetch = NULL;
 
+    if (llcache_fetch_stale_if_error(object, &replacement)) {
+        return NSERROR_OK;
+    }
+
     /* Release candidate, if any */
     if (object->candidate != NULL) {
         object->candidate->candidate_count--;
@@ -2695,6 +2995,8 @@ static nserror build_candidate_list(struct llcache_object ***lst_out, int *lst_l
 static nserror write_backing_store(struct llcache_object *object, size_t *written_out, unsigned long *elapsed)
 {
     nserror ret;
+    uint8_t *data;
+    size_t datalen;
     uint8_t *metadata;
     size_t metadatasize;
     uint64_t startms = 0;
@@ -2702,12 +3004,26 @@ static nserror write_backing_store(struct llcache_object *object, size_t *writte
 
     nsu_getmonotonic_ms(&startms);
 
-    /* put object data in backing store */
-    ret = guit->llcache->store(object->url, BACKING_STORE_NONE, object->source_data, object->source_len);
+    /* put object data in backing store, which takes ownership of a
+     * single allocation, and keep referring to it from there */
+    data = chunkbuf_detach(&object->source, &datalen);
+    if (data == NULL) {
+        return NSERROR_NOMEM;
+    }
+    ret = guit->llcache->store(object->url, BACKING_STORE_NONE, data, datalen);
     if (ret != NSERROR_OK) {
         /* unable to put source data in backing store */
+        if (chunkbuf_wrap(&object->source, data, datalen, free, data) != NSERROR_OK) {
+            free(data);
+            object->source_len = 0;
+        }
         return ret;
     }
+    if (chunkbuf_wrap(&object->source, data, datalen, llcache_release_persisted_data, nsurl_ref(object->url)) !=
+        NSERROR_OK) {
+        /* the data can be fetched back from the store when needed */
+        llcache_release_persisted_data(object->url);
+    }
 
     ret = llcache_serialise_metadata(object, &metadata, &metadatasize);
     if (ret != NSERROR_OK) {
@@ -2945,18 +3261,11 @@ static void llcache_fetch_callback(const fetch_msg *msg, void *p)
     case FETCH_FINISHED:
         /* Finished fetching */
         {
-            uint8_t *temp;
-
             object->fetch.state = LLCACHE_FETCH_COMPLETE;
             object->fetch.fetch = NULL;
 
             /* Shrink source buffer to required size */
-            temp = realloc(object->source_data, object->source_len);
-            /* If source_len is 0, then temp may be NULL */
-            if (temp != NULL || object->source_len == 0) {
-                object->source_data = temp;
-                object->source_alloc = object->source_len;
-            }
+            chunkbuf_trim(&object->source);
 
             llcache_object_cache_update(object);
 
@@ -2981,6 +3290,11 @@ static void llcache_fetch_callback(const fetch_msg *msg, void *p)
         object->fetch.state = LLCACHE_FETCH_COMPLETE;
         object->fetch.fetch = NULL;
 
+        /* A stale candidate may be used instead */
+        if (llcache_fetch_stale_if_error(object, &object)) {
+            break;
+        }
+
         /* Release candidate, if any */
         if (object->candidate != NULL) {
             object->candidate->candidate_count--;
@@ -3294,26 +3608,39 @@ static nserror llcache_object_notify_users(llcache_object *object)
             object->source_len > handle->bytes) {
             size_t orig_handle_read;
 
-            /* Construct HAD_DATA event */
-            event.type = LLCACHE_EVENT_HAD_DATA;
-            event.data.data.buf = object->source_data + handle->bytes;
-            event.data.data.len = object->source_len - handle->bytes;
-
-            /* Update record of last byte emitted */
-            if (object->fetch.flags & LLCACHE_RETRIEVE_STREAM_DATA) {
-                /* Streaming, so reset to zero to
-                 * minimise amount of cached source data.
-                 * Additionally, we don't support replay
-                 * when streaming. */
-                orig_handle_read = 0;
-                handle->bytes = object->source_len = 0;
-            } else {
-                orig_handle_read = handle->bytes;
-                handle->bytes = object->source_len;
-            }
+            /* Emit a HAD_DATA event for each contiguous run of
+             * source data, without copying it */
+            do {
+                event.type = LLCACHE_EVENT_HAD_DATA;
+                event.data.data.buf = chunkbuf_get_run(&object->source, handle->bytes, &event.data.data.len);
+                if (event.data.data.buf == NULL) {
+                    /* Source data went missing */
+                    error = NSERROR_NOMEM;
+                    break;
+                }
+
+                /* Update record of last byte emitted */
+                if (object->fetch.flags & LLCACHE_RETRIEVE_STREAM_DATA) {
+                    /* Streaming, so discard the run once it
+                     * has been emitted to minimise amount of
+                     * cached source data. Additionally, we
+                     * don't support replay when streaming. */
+                    orig_handle_read = 0;
+                    handle->bytes = 0;
+                } else {
+                    orig_handle_read = handle->bytes;
+                    handle->bytes += event.data.data.len;
+                }
+
+                /* Emit event */
+                error = handle->cb(handle, &event, handle->pw);
+
+                if (object->fetch.flags & LLCACHE_RETRIEVE_STREAM_DATA) {
+                    object->source_len -= event.data.data.len;
+                    chunkbuf_consume_run(&object->source);
+                }
+            } while (error == NSERROR_OK && !user->queued_for_delete && object->source_len > handle->bytes);
 
-            /* Emit event */
-            error = handle->cb(handle, &event, handle->pw);
             if (user->queued_for_delete) {
                 next_user = user->next;
                 llcache_object_remove_user(object, user);
@@ -3405,16 +3732,13 @@ static nserror llcache_object_snapshot(llcache_object *object, llcache_object **
     if (error != NSERROR_OK)
         return error;
 
-    newobj->source_alloc = newobj->source_len = object->source_len;
-
-    if (object->source_len > 0) {
-        newobj->source_data = malloc(newobj->source_alloc);
-        if (newobj->source_data == NULL) {
-            llcache_object_destroy(newobj);
-            return NSERROR_NOMEM;
-        }
-        memcpy(newobj->source_data, object->source_data, newobj->source_len);
+    /* The snapshot shares the source data rather than copying it */
+    error = chunkbuf_clone(&object->source, &newobj->source);
+    if (error != NSERROR_OK) {
+        llcache_object_destroy(newobj);
+        return error;
     }
+    newobj->source_len = object->source_len;
 
     if (object->num_headers > 0) {
         newobj->headers = calloc(object->num_headers, sizeof(llcache_header));
@@ -3464,7 +3788,7 @@ static inline uint32_t total_object_size(llcache_object *object)
     tot = sizeof(*object);
     tot += nsurl_length(object->url);
 
-    if (object->source_data != NULL) {
+    if (chunkbuf_held(&object->source)) {
         tot += object->source_len;
     }
 
@@ -3566,14 +3890,16 @@ void llcache_clean(bool purge)
     }
 
 
-    /* Stale cacheable objects with no users or pending fetches */
+    /* Stale cacheable objects with no users or pending fetches,
+     * other than those which may still be used while revalidated
+     */
     for (object = llcache->cached_objects; object != NULL; object = next) {
         next = object->next;
 
         remaining_lifetime = llcache_object_rfc2616_remaining_lifetime(&object->cache);
 
         if ((object->users == NULL) && (object->candidate_count == 0) && (object->fetch.fetch == NULL) &&
-            (remaining_lifetime <= 0)) {
+            (remaining_lifetime <= 0) && !llcache_object_is_usable_stale(object)) {
             /* object is stale */
             NSLOG(llcache, DEBUG,
                 "discarding stale cacheable object with no "
@@ -3610,9 +3936,7 @@ void llcache_clean(bool purge)
         next = object->next;
         if ((object->users == NULL) && (object->candidate_count == 0) && (object->fetch.fetch == NULL) &&
             (object->store_state == LLCACHE_STATE_DISC)) {
-            guit->llcache->release(object->url, BACKING_STORE_NONE);
-
-            object->source_data = NULL;
+            chunkbuf_release(&object->source);
 
             llcache_size -= object->source_len;
 
@@ -3627,7 +3951,7 @@ void llcache_clean(bool purge)
     for (object = llcache->cached_objects; ((limit < llcache_size) && (object != NULL)); object = next) {
         next = object->next;
         if ((object->users == NULL) && (object->candidate_count == 0) && (object->fetch.fetch == NULL) &&
-            (object->store_state == LLCACHE_STATE_DISC) && (object->source_data == NULL)) {
+            (object->store_state == LLCACHE_STATE_DISC) && !chunkbuf_held(&object->source)) {
             NSLOG(llcache, DEBUG, "discarding backed object len:%" PRIsizet " age:%ld (%p) %s", object->source_len,
                 (long)(time(NULL) - object->last_used), object, nsurl_access(object->url));
 
@@ -3661,6 +3985,16 @@ void llcache_clean(bool purge)
     NSLOG(llcache, DEBUG, "Size: %" PRIu32 " (limit: %" PRIu32 ")", llcache_size, limit);
 }
 
+/* Exported interface documented in content/llcache.h */
+void llcache_get_stats(struct llcache_stats *stats)
+{
+    if (llcache == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = llcache->stats;
+}
+
 /* Exported interface documented in content/llcache.h */
 nserror llcache_initialise(const struct llcache_parameters *prm)
 {
@@ -3967,14 +4301,36 @@ nsurl *llcache_handle_get_url(const llcache_handle *handle)
 const uint8_t *llcache_handle_get_source_data(const llcache_handle *handle, size_t *size)
 {
     if (handle->object != NULL) {
+        const uint8_t *data;
+
         (void)llcache_retrieve_persisted_data(handle->object);
-        *size = handle->object->source_len;
-        return handle->object->source_data;
+        data = chunkbuf_flatten(&handle->object->source);
+        if (data != NULL) {
+            *size = handle->object->source_len;
+            return data;
+        }
     }
     *size = 0;
     return NULL;
 }
 
+/* See llcache.h for documentation */
+size_t llcache_handle_get_source_length(const llcache_handle *handle)
+{
+    return handle->object != NULL ? handle->object->source_len : 0;
+}
+
+/* See llcache.h for documentation */
+const uint8_t *llcache_handle_get_source_run(const llcache_handle *handle, size_t offset, size_t *len)
+{
+    if (handle->object != NULL) {
+        (void)llcache_retrieve_persisted_data(handle->object);
+        return chunkbuf_get_run(&handle->object->source, offset, len);
+    }
+    *len = 0;
+    return NULL;
+}
+
 /* See llcache.h for documentation */
 const char *llcache_handle_get_header(const llcache_handle *handle, const char *key)
 {
@@ -3999,6 +4355,12 @@ bool llcache_handle_references_same_object(const llcache_handle *a, const llcach
     return a->object == b->object;
 }
 
+/* See llcache.h for documentation */
+uintptr_t llcache_handle_get_object_id(const llcache_handle *handle)
+{
+    return (uintptr_t)handle->object;
+}
+
 /* See llcache.h for documentation */
 nserror llcache_handle_retrieve_buffer(nsurl *url, const uint8_t *data, size_t len, const char *mime_type,
     llcache_handle_callback cb, void *pw, llcache_handle **result)
@@ -4012,9 +4374,17 @@ nserror llcache_handle_retrieve_buffer(nsurl *url, const uint8_t *data, size_t l
     assert(len > 0);
     assert(mime_type != NULL);
 
-    /* Check for existing object with the same URL (dedup) */
+    /* Check for an existing object with the same URL and data (dedup).
+     * The URL is derived from a hash of the data, so the data is compared
+     * too in case of a collision. */
     for (object = llcache->uncached_objects; object != NULL; object = object->next) {
-        if (nsurl_compare(object->url, url, NSURL_COMPLETE))
+        const uint8_t *source;
+
+        if (!nsurl_compare(object->url, url, NSURL_COMPLETE) || object->source_len != len)
+            continue;
+
+        source = chunkbuf_flatten(&object->source);
+        if (source != NULL && memcmp(source, data, len) == 0)
             break;
     }
 
@@ -4044,14 +4414,15 @@ nserror llcache_handle_retrieve_buffer(nsurl *url, const uint8_t *data, size_t l
             return error;
 
         /* Copy source data into the object */
-        object->source_data = malloc(len);
-        if (object->source_data == NULL) {
+        error = chunkbuf_reserve(&object->source, len);
+        if (error == NSERROR_OK) {
+            error = chunkbuf_append(&object->source, data, len);
+        }
+        if (error != NSERROR_OK) {
             llcache_object_destroy(object);
-            return NSERROR_NOMEM;
+            return error;
         }
-        memcpy(object->source_data, data, len);
         object->source_len = len;
-        object->source_alloc = len;
 
         /* Inject Content-Type header */
         header_len = strlen("Content-Type: ") + strlen(mime_type);
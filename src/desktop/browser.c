@@ -28,6 +28,8 @@
 #include <wisp/utils/log.h>
 #include <wisp/utils/utils.h>
 
+#include "desktop/measure_cache.h"
+
 /* exported interface documented in netsurf/browser.h */
 nserror browser_set_dpi(int dpi)
 {
@@ -36,7 +38,12 @@ nserror browser_set_dpi(int dpi)
         dpi = min(max(dpi, 72), 250);
         NSLOG(wisp, INFO, "Clamping invalid DPI %d to %d", bad, dpi);
     }
-    nscss_screen_dpi = INTTOFIX(dpi);
+    if (nscss_screen_dpi != INTTOFIX(dpi)) {
+        /* frontends size fonts for the screen, so cached text
+         * measurements no longer hold */
+        nscss_screen_dpi = INTTOFIX(dpi);
+        measure_cache_flush();
+    }
 
     return NSERROR_OK;
 }
@@ -46,3 +53,11 @@ int browser_get_dpi(void)
 {
     return FIXTOINT(nscss_screen_dpi);
 }
+
+/* exported interface documented in netsurf/browser.h */
+void browser_font_options_changed(void)
+{
+    /* frontends map generic families onto the faces named in the
+     * font options, so cached text measurements no longer hold */
+    measure_cache_flush();
+}
@@ -28,15 +28,18 @@
 #include <string.h>
 #include <time.h>
 
+#include <wisp/content/content.h>
 #include <wisp/content/hlcache.h>
 #include <wisp/utils/corestrings.h>
 #include <wisp/utils/log.h>
+#include <wisp/utils/nsoption.h>
 #include <wisp/utils/utils.h>
 #include "content/urldb.h"
 #include "wisp/bitmap.h"
 #include "wisp/browser_window.h"
 #include "wisp/content.h"
 #include "wisp/layout.h"
+#include "wisp/misc.h"
 #include "wisp/window.h"
 
 #include <wisp/desktop/browser_history.h>
@@ -44,6 +47,335 @@
 #include "desktop/browser_private.h"
 #include "desktop/local_history_private.h"
 
+/** Time to wait after a page changes before rendering its thumbnail / ms */
+#define THUMBNAIL_RENDER_DELAY 500
+
+/** Times to wait for a page to finish before giving up on its thumbnail */
+#define THUMBNAIL_RENDER_ATTEMPTS 60
+
+/** Bytes per thumbnail pixel */
+#define THUMBNAIL_PIXEL 4
+
+/** Decoded thumbnails of all windows, most recently used first */
+static struct history_page *decoded_first;
+
+/** Least recently used decoded thumbnail */
+static struct history_page *decoded_last;
+
+/** Memory used by decoded thumbnails */
+static size_t decoded_size;
+
+
+/**
+ * Get the size of a thumbnail bitmap's pixel buffer
+ *
+ * \param bitmap The bitmap
+ * \return the size of the buffer in bytes
+ */
+static size_t browser_window_history__bitmap_size(struct bitmap *bitmap)
+{
+    return guit->bitmap->get_rowstride(bitmap) * guit->bitmap->get_height(bitmap);
+}
+
+
+/**
+ * Compress thumbnail pixels
+ *
+ * Each control byte below 128 is followed by that many plus one literal
+ * pixels. Otherwise it is followed by a single pixel repeated the control
+ * byte less 126 times.
+ *
+ * \param data     Pixels to compress
+ * \param size     Size of the pixels in bytes, a multiple of the pixel size
+ * \param out      Updated to the compressed data on success
+ * \param out_len  Updated to the length of the compressed data on success
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror browser_window_history__compress(const uint8_t *data, size_t size, uint8_t **out, size_t *out_len)
+{
+    size_t count = size / THUMBNAIL_PIXEL;
+    size_t i = 0;
+    uint8_t *buf;
+    uint8_t *o;
+    uint8_t *shrunk;
+
+    buf = malloc(size + count / 128 + 1);
+    if (buf == NULL) {
+        return NSERROR_NOMEM;
+    }
+    o = buf;
+
+#define PIXEL(n) (data + (n) * THUMBNAIL_PIXEL)
+    while (i < count) {
+        size_t n = 1;
+
+        while (i + n < count && n < 129 && memcmp(PIXEL(i), PIXEL(i + n), THUMBNAIL_PIXEL) == 0) {
+            n++;
+        }
+
+        if (n > 1) {
+            *o++ = (uint8_t)(n + 126);
+            memcpy(o, PIXEL(i), THUMBNAIL_PIXEL);
+            o += THUMBNAIL_PIXEL;
+        } else {
+            /* Take literals up to the start of the next run */
+            while (i + n < count && n < 128 &&
+                !(i + n + 1 < count && memcmp(PIXEL(i + n), PIXEL(i + n + 1), THUMBNAIL_PIXEL) == 0)) {
+                n++;
+            }
+
+            *o++ = (uint8_t)(n - 1);
+            memcpy(o, PIXEL(i), n * THUMBNAIL_PIXEL);
+            o += n * THUMBNAIL_PIXEL;
+        }
+
+        i += n;
+    }
+#undef PIXEL
+
+    *out_len = o - buf;
+
+    shrunk = realloc(buf, *out_len + 1);
+    if (shrunk != NULL) {
+        buf = shrunk;
+    }
+
+    *out = buf;
+
+    return NSERROR_OK;
+}
+
+
+/**
+ * Decompress thumbnail pixels
+ *
+ * \param in      Compressed data
+ * \param in_len  Length of compressed data
+ * \param data    Buffer to decompress the pixels into
+ * \param size    Size of the buffer, which must be exactly filled
+ * \return NSERROR_OK on success, NSERROR_INVALID if the data does not fit
+ */
+static nserror browser_window_history__decompress(const uint8_t *in, size_t in_len, uint8_t *data, size_t size)
+{
+    const uint8_t *end = in + in_len;
+    size_t used = 0;
+    size_t n;
+
+    while (in < end) {
+        uint8_t c = *in++;
+
+        if (c < 128) {
+            n = (c + 1) * THUMBNAIL_PIXEL;
+            if ((size_t)(end - in) < n || size - used < n) {
+                return NSERROR_INVALID;
+            }
+            memcpy(data + used, in, n);
+            in += n;
+        } else {
+            n = (c - 126) * THUMBNAIL_PIXEL;
+            if ((size_t)(end - in) < THUMBNAIL_PIXEL || size - used < n) {
+                return NSERROR_INVALID;
+            }
+            for (size_t i = 0; i < n; i += THUMBNAIL_PIXEL) {
+                memcpy(data + used + i, in, THUMBNAIL_PIXEL);
+            }
+            in += THUMBNAIL_PIXEL;
+        }
+
+        used += n;
+    }
+
+    return (used == size) ? NSERROR_OK : NSERROR_INVALID;
+}
+
+
+/**
+ * Remove a page from the list of decoded thumbnails
+ *
+ * \param page The page
+ */
+static void browser_window_history__decoded_unlink(struct history_page *page)
+{
+    if (page->decoded_prev != NULL) {
+        page->decoded_prev->decoded_next = page->decoded_next;
+    } else {
+        decoded_first = page->decoded_next;
+    }
+    if (page->decoded_next != NULL) {
+        page->decoded_next->decoded_prev = page->decoded_prev;
+    } else {
+        decoded_last = page->decoded_prev;
+    }
+    page->decoded_prev = NULL;
+    page->decoded_next = NULL;
+}
+
+
+/**
+ * Add a page to the front of the list of decoded thumbnails
+ *
+ * \param page The page
+ */
+static void browser_window_history__decoded_link(struct history_page *page)
+{
+    page->decoded_prev = NULL;
+    page->decoded_next = decoded_first;
+    if (decoded_first != NULL) {
+        decoded_first->decoded_prev = page;
+    } else {
+        decoded_last = page;
+    }
+    decoded_first = page;
+}
+
+
+/**
+ * Destroy a page's decoded thumbnail, keeping any compressed copy
+ *
+ * \param page The page
+ */
+static void browser_window_history__thumbnail_release(struct history_page *page)
+{
+    if (page->bitmap == NULL) {
+        return;
+    }
+
+    browser_window_history__decoded_unlink(page);
+
+    decoded_size -= browser_window_history__bitmap_size(page->bitmap);
+    guit->bitmap->destroy(page->bitmap);
+    page->bitmap = NULL;
+}
+
+
+/**
+ * Give a page a decoded thumbnail, destroying the least recently used
+ * decoded thumbnails of other pages to keep within the memory limit
+ *
+ * \param page    The page, which must not have a decoded thumbnail
+ * \param bitmap  The decoded thumbnail
+ */
+static void browser_window_history__thumbnail_set(struct history_page *page, struct bitmap *bitmap)
+{
+    size_t size = browser_window_history__bitmap_size(bitmap);
+    size_t limit = nsoption_uint(history_thumbnail_size);
+
+    while (decoded_last != NULL && decoded_size + size > limit) {
+        browser_window_history__thumbnail_release(decoded_last);
+    }
+
+    page->bitmap = bitmap;
+    browser_window_history__decoded_link(page);
+    decoded_size += size;
+}
+
+
+/**
+ * Destroy a page's thumbnail, both decoded and compressed
+ *
+ * \param page The page
+ */
+static void browser_window_history__thumbnail_free(struct history_page *page)
+{
+    browser_window_history__thumbnail_release(page);
+    free(page->thumbnail);
+    page->thumbnail = NULL;
+    page->thumbnail_len = 0;
+}
+
+
+/**
+ * Render the thumbnail of the history entry waiting for one
+ *
+ * The entry is only rendered if the window is still showing its page.
+ *
+ * \param bw The browser window
+ */
+static void browser_window_history__render(struct browser_window *bw)
+{
+    struct history_entry *entry = bw->history->render;
+    struct bitmap *bitmap;
+    nserror ret;
+
+    bw->history->render = NULL;
+
+    if (entry == NULL || bw->current_content == NULL ||
+        !nsurl_compare(entry->page.url, hlcache_handle_get_url(bw->current_content), NSURL_COMPLETE)) {
+        return;
+    }
+
+    NSLOG(wisp, DEBUG, "Creating thumbnail for %s", nsurl_access(entry->page.url));
+
+    bitmap = guit->bitmap->create(LOCAL_HISTORY_WIDTH, LOCAL_HISTORY_HEIGHT, BITMAP_CLEAR | BITMAP_OPAQUE);
+    if (bitmap == NULL) {
+        return;
+    }
+
+    ret = guit->bitmap->render(bitmap, bw->current_content);
+    if (ret != NSERROR_OK) {
+        /* Thumbnail render failed, keep any previous one */
+        NSLOG(wisp, WARNING, "Thumbnail render failed");
+        guit->bitmap->destroy(bitmap);
+        return;
+    }
+
+    browser_window_history__thumbnail_free(&entry->page);
+
+    /* Without a compressed copy the thumbnail is lost once evicted */
+    ret = browser_window_history__compress(guit->bitmap->get_buffer(bitmap),
+        browser_window_history__bitmap_size(bitmap), &entry->page.thumbnail, &entry->page.thumbnail_len);
+    if (ret != NSERROR_OK) {
+        NSLOG(wisp, WARNING, "Unable to compress thumbnail");
+    }
+
+    browser_window_history__thumbnail_set(&entry->page, bitmap);
+}
+
+
+/**
+ * Scheduled callback rendering a window's pending thumbnail once its
+ * content is done
+ *
+ * \param p The browser window
+ */
+static void browser_window_history__render_cb(void *p)
+{
+    struct browser_window *bw = p;
+    content_status status;
+
+    if (bw->current_content != NULL) {
+        status = content_get_status(bw->current_content);
+        if (status == CONTENT_STATUS_ERROR) {
+            /* The page will never be done, keep any previous thumbnail */
+            bw->history->render = NULL;
+            return;
+        }
+        if (status != CONTENT_STATUS_DONE) {
+            if (++bw->history->render_attempts >= THUMBNAIL_RENDER_ATTEMPTS) {
+                NSLOG(wisp, INFO, "Page not done, rendering its thumbnail anyway");
+            } else {
+                guit->misc->schedule(THUMBNAIL_RENDER_DELAY, browser_window_history__render_cb, bw);
+                return;
+            }
+        }
+    }
+
+    browser_window_history__render(bw);
+}
+
+
+/**
+ * Arrange for the current entry's thumbnail to be rendered when idle
+ *
+ * \param bw The browser window
+ */
+static void browser_window_history__schedule_render(struct browser_window *bw)
+{
+    bw->history->render = bw->history->current;
+    bw->history->render_attempts = 0;
+    guit->misc->schedule(THUMBNAIL_RENDER_DELAY, browser_window_history__render_cb, bw);
+}
+
 /**
  * Clone a history entry
  *
@@ -93,22 +425,12 @@ static struct history_entry *browser_window_history__clone_entry(struct history
         }
     }
 
-    if (entry->page.bitmap == NULL) {
-        new_entry->page.bitmap = NULL;
-    } else {
-        /* create a new bitmap and copy original into it */
-        unsigned char *bmsrc_data;
-        unsigned char *bmdst_data;
-        size_t bmsize;
-
-        new_entry->page.bitmap = guit->bitmap->create(LOCAL_HISTORY_WIDTH, LOCAL_HISTORY_HEIGHT, BITMAP_OPAQUE);
-
-        if (new_entry->page.bitmap != NULL) {
-            bmsrc_data = guit->bitmap->get_buffer(entry->page.bitmap);
-            bmdst_data = guit->bitmap->get_buffer(new_entry->page.bitmap);
-            bmsize = guit->bitmap->get_rowstride(new_entry->page.bitmap) *
-                guit->bitmap->get_height(new_entry->page.bitmap);
-            memcpy(bmdst_data, bmsrc_data, bmsize);
+    /* copy the compressed thumbnail, it is decoded when needed */
+    if (entry->page.thumbnail != NULL) {
+        new_entry->page.thumbnail = malloc(entry->page.thumbnail_len);
+        if (new_entry->page.thumbnail != NULL) {
+            memcpy(new_entry->page.thumbnail, entry->page.thumbnail, entry->page.thumbnail_len);
+            new_entry->page.thumbnail_len = entry->page.thumbnail_len;
         }
     }
 
@@ -128,9 +450,7 @@ static struct history_entry *browser_window_history__clone_entry(struct history
                 lwc_string_unref(new_entry->page.frag_id);
             }
             free(new_entry->page.title);
-            if (entry->page.bitmap != NULL) {
-                guit->bitmap->destroy(entry->page.bitmap);
-            }
+            free(new_entry->page.thumbnail);
             free(new_entry);
             return NULL;
         }
@@ -171,9 +491,7 @@ static void browser_window_history__free_entry(struct history_entry *entry)
             lwc_string_unref(entry->page.frag_id);
         }
         free(entry->page.title);
-        if (entry->page.bitmap != NULL) {
-            guit->bitmap->destroy(entry->page.bitmap);
-        }
+        browser_window_history__thumbnail_free(&entry->page);
         free(entry);
     }
 }
@@ -314,6 +632,9 @@ nserror browser_window_history_clone(const struct browser_window *existing, stru
     clone->history = new_history;
     memcpy(new_history, existing->history, sizeof *new_history);
 
+    /* the clone renders thumbnails of its own pages */
+    new_history->render = NULL;
+
     new_history->start = browser_window_history__clone_entry(new_history, new_history->start);
     if (!new_history->start) {
         NSLOG(wisp, INFO, "Insufficient memory to clone history");
@@ -332,7 +653,6 @@ nserror browser_window_history_add(struct browser_window *bw, struct hlcache_han
     struct history *history;
     struct history_entry *entry;
     char *title;
-    nserror ret;
 
     assert(bw);
     assert(bw->history);
@@ -357,18 +677,11 @@ nserror browser_window_history_add(struct browser_window *bw, struct hlcache_han
     entry->page.title = title;
     entry->page.scroll_x = 0.0f;
     entry->page.scroll_y = 0.0f;
-
-    /* create thumbnail for localhistory view */
-    NSLOG(wisp, DEBUG, "Creating thumbnail for %s", nsurl_access(entry->page.url));
-
-    entry->page.bitmap = guit->bitmap->create(LOCAL_HISTORY_WIDTH, LOCAL_HISTORY_HEIGHT, BITMAP_CLEAR | BITMAP_OPAQUE);
-    if (entry->page.bitmap != NULL) {
-        ret = guit->bitmap->render(entry->page.bitmap, content);
-        if (ret != NSERROR_OK) {
-            /* Thumbnail render failed */
-            NSLOG(wisp, WARNING, "Thumbnail render failed");
-        }
-    }
+    entry->page.bitmap = NULL;
+    entry->page.thumbnail = NULL;
+    entry->page.thumbnail_len = 0;
+    entry->page.decoded_prev = NULL;
+    entry->page.decoded_next = NULL;
 
     /* insert into tree */
     entry->back = history->current;
@@ -390,6 +703,9 @@ nserror browser_window_history_add(struct browser_window *bw, struct hlcache_han
     }
     history->current = entry;
 
+    /* thumbnail for the local history view, kept off the navigation path */
+    browser_window_history__schedule_render(bw);
+
     browser_window_history__layout(history);
 
     return NSERROR_OK;
@@ -422,9 +738,7 @@ nserror browser_window_history_update(struct browser_window *bw, struct hlcache_
     free(history->current->page.title);
     history->current->page.title = title;
 
-    if (history->current->page.bitmap != NULL) {
-        guit->bitmap->render(history->current->page.bitmap, content);
-    }
+    browser_window_history__schedule_render(bw);
 
     if ((bw->window != NULL) && guit->window->get_scroll(bw->window, &sx, &sy)) {
         int content_height = content_get_height(content);
@@ -472,6 +786,8 @@ void browser_window_history_destroy(struct browser_window *bw)
     if (bw->history == NULL)
         return;
 
+    guit->misc->schedule(-1, browser_window_history__render_cb, bw);
+
     browser_window_history__free_entry(bw->history->start);
     free(bw->history);
 
@@ -537,10 +853,11 @@ nserror browser_window_history_get_thumbnail(struct browser_window *bw, struct b
         return NSERROR_INVALID;
     }
 
-    if (bw->history->current->page.bitmap == NULL) {
+    browser_window_history_render_thumbnail(bw);
+
+    bitmap = browser_window_history_entry_bitmap(bw->history->current);
+    if (bitmap == NULL) {
         bitmap = content_get_bitmap(bw->current_content);
-    } else {
-        bitmap = bw->history->current->page.bitmap;
     }
 
     *bitmap_out = bitmap;
@@ -548,6 +865,54 @@ nserror browser_window_history_get_thumbnail(struct browser_window *bw, struct b
     return NSERROR_OK;
 }
 
+/* exported interface documented in desktop/browser_private.h */
+void browser_window_history_render_thumbnail(struct browser_window *bw)
+{
+    if (bw->history == NULL || bw->history->render == NULL) {
+        return;
+    }
+
+    guit->misc->schedule(-1, browser_window_history__render_cb, bw);
+    browser_window_history__render(bw);
+}
+
+
+/* exported interface documented in desktop/browser_private.h */
+struct bitmap *browser_window_history_entry_bitmap(struct history_entry *entry)
+{
+    struct history_page *page = &entry->page;
+    struct bitmap *bitmap;
+
+    if (page->bitmap != NULL) {
+        /* Now the most recently used */
+        browser_window_history__decoded_unlink(page);
+        browser_window_history__decoded_link(page);
+        return page->bitmap;
+    }
+
+    if (page->thumbnail == NULL) {
+        return NULL;
+    }
+
+    bitmap = guit->bitmap->create(LOCAL_HISTORY_WIDTH, LOCAL_HISTORY_HEIGHT, BITMAP_OPAQUE);
+    if (bitmap == NULL) {
+        return NULL;
+    }
+
+    if (browser_window_history__decompress(page->thumbnail, page->thumbnail_len, guit->bitmap->get_buffer(bitmap),
+            browser_window_history__bitmap_size(bitmap)) != NSERROR_OK) {
+        /* Rendered at another size */
+        guit->bitmap->destroy(bitmap);
+        return NULL;
+    }
+    guit->bitmap->modified(bitmap);
+
+    browser_window_history__thumbnail_set(page, bitmap);
+
+    return bitmap;
+}
+
+
 /* exported interface documented in desktop/browser_history.h */
 nserror browser_window_history_go(struct browser_window *bw, struct history_entry *entry, bool new_window)
 {
@@ -580,7 +945,8 @@ nserror browser_window_history_go(struct browser_window *bw, struct history_entr
             browser_window_history_update(bw, bw->current_content);
         }
         history->current = entry;
-        error = browser_window_navigate(bw, url, NULL, BW_NAVIGATE_NO_TERMINAL_HISTORY_UPDATE, NULL, NULL, NULL);
+        error = browser_window_navigate(
+            bw, url, NULL, BW_NAVIGATE_NO_TERMINAL_HISTORY_UPDATE | BW_NAVIGATE_RESTORE, NULL, NULL, NULL);
     }
 
     nsurl_unref(url);
@@ -41,7 +41,11 @@ struct history_page {
     struct nsurl *url; /**< Page URL, never NULL. */
     lwc_string *frag_id; /** Fragment identifier, or NULL. */
     char *title; /**< Page title, never NULL. */
-    struct bitmap *bitmap; /**< Thumbnail bitmap, or NULL. */
+    struct bitmap *bitmap; /**< Decoded thumbnail bitmap, or NULL. */
+    uint8_t *thumbnail; /**< Compressed thumbnail pixels, or NULL. */
+    size_t thumbnail_len; /**< Length of compressed thumbnail. */
+    struct history_page *decoded_prev; /**< More recently used decoded thumbnail. */
+    struct history_page *decoded_next; /**< Less recently used decoded thumbnail. */
     float scroll_x; /**< Scroll X offset when visited */
     float scroll_y; /**< Scroll Y offset when visited */
 };
@@ -74,6 +78,10 @@ struct history {
     int width;
     /** Height of layout. */
     int height;
+    /** Entry whose thumbnail is to be rendered when idle, or NULL. */
+    struct history_entry *render;
+    /** Number of times the render has waited for the page to finish. */
+    unsigned int render_attempts;
 };
 
 /**
@@ -376,12 +384,33 @@ nserror browser_window_history_add(struct browser_window *bw, struct hlcache_han
 /**
  * Update the thumbnail and scroll offsets for the current entry.
  *
+ * The thumbnail is rendered later, once the content is done and the
+ * window has been left alone for a while.
+ *
  * \param bw The browser window to update the history within.
  * \param content content for current entry
  * \return NSERROR_OK or error code on faliure.
  */
 nserror browser_window_history_update(struct browser_window *bw, struct hlcache_handle *content);
 
+/**
+ * Render the current entry's thumbnail now if it is waiting to be rendered
+ *
+ * \param bw The browser window with the history.
+ */
+void browser_window_history_render_thumbnail(struct browser_window *bw);
+
+/**
+ * Get the thumbnail bitmap of a history entry
+ *
+ * Thumbnails are kept compressed and decoded on demand, so the bitmap is
+ * only valid until the next call.
+ *
+ * \param entry The history entry.
+ * \return the thumbnail bitmap, or NULL if the entry has none.
+ */
+struct bitmap *browser_window_history_entry_bitmap(struct history_entry *entry);
+
 /**
  * Retrieve the stored scroll offsets for the current history entry
  *
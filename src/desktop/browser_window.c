@@ -48,6 +48,7 @@
 #include <wisp/window.h>
 #include "content/content_debug.h"
 #include "content/urldb.h"
+#include "utils/trace.h"
 
 #include <wisp/content/handlers/html/box.h>
 #include <wisp/content/handlers/html/form_internal.h>
@@ -63,6 +64,7 @@
 #include "desktop/browser_private.h"
 #include "desktop/frames.h"
 #include "desktop/knockout.h"
+#include "desktop/measure_cache.h"
 #include "desktop/scrollbar.h"
 #include "desktop/theme.h"
 
@@ -828,19 +830,8 @@ static nserror browser_window_content_ready(struct browser_window *bw)
          *  history_update will either explode or overwrite the node
          *  for the previous URL.
          *
-         * We call it after, rather than before urldb_add_url because
-         *  history_add calls bitmap render, which tries to register
-         *  the thumbnail with urldb.  That thumbnail registration
-         *  fails if the url doesn't exist in urldb already, and only
-         *  urldb-registered thumbnails get freed.  So if we called
-         *  history_add before urldb_add_url we would leak thumbnails
-         *  for all newly visited URLs.  With the history_add call
-         *  after, we only leak the thumbnails when urldb does not add
-         *  the URL.
-         *
-         * Also, since browser_window_history_add can create a
-         *  thumbnail (content_redraw), we need to do it after
-         *  content_reformat.
+         * The thumbnail for the entry is rendered later, once the
+         *  content is done and the window is idle.
          */
         browser_window_history_add(bw, bw->current_content, bw->frag_id);
     }
@@ -2362,8 +2353,6 @@ bool browser_window_redraw(
     struct rect content_clip;
     nserror res;
 
-    NSLOG(wisp, DEBUG, "PROFILER: START Browser window redraw %p", bw);
-
     if (bw == NULL) {
         NSLOG(wisp, INFO, "NULL browser window");
         return false;
@@ -2378,6 +2367,8 @@ bool browser_window_redraw(
         return (ctx->plot->rectangle(ctx, plot_style_fill_white, clip) == NSERROR_OK);
     }
 
+    TRACE_BEGIN("desktop", "browser window redraw");
+
     /* Browser window has content OR children (frames) */
     if ((bw->window != NULL) && (ctx->plot->option_knockout)) {
         /* Root browser window: start knockout */
@@ -2434,6 +2425,7 @@ bool browser_window_redraw(
             knockout_plot_end(ctx);
         }
 
+        TRACE_END("desktop", "browser window redraw");
         return plot_ok;
     }
 
@@ -2530,7 +2522,7 @@ bool browser_window_redraw(
         knockout_plot_end(ctx);
     }
 
-    NSLOG(wisp, DEBUG, "PROFILER: STOP Browser window redraw %p", bw);
+    TRACE_END("desktop", "browser window redraw");
     return plot_ok;
 }
 
@@ -3243,6 +3235,11 @@ static nserror navigate_internal_real(struct browser_window *bw, struct browser_
         fetch_flags |= HLCACHE_RETRIEVE_MAY_DOWNLOAD;
     }
 
+    /* History navigation may restore a retained content */
+    if ((params->flags & BW_NAVIGATE_RESTORE) && !fetch_is_post) {
+        fetch_flags |= HLCACHE_RETRIEVE_RESTORE;
+    }
+
     res = hlcache_handle_retrieve(params->url, fetch_flags | HLCACHE_RETRIEVE_SNIFF_TYPE, params->referrer,
         fetch_is_post ? &post : NULL, browser_window_callback, bw, params->parent_charset != NULL ? &child : NULL,
         CONTENT_ANY, &c);
@@ -3977,6 +3974,12 @@ nserror browser_window_set_scale(struct browser_window *bw, float scale, bool ab
         scale = SCALE_MAXIMUM;
     }
 
+    if (fabs(bw->scale - scale) >= 0.0001) {
+        /* frontends which hint text for the size it is drawn at
+         * measure it differently at a new scale */
+        measure_cache_flush();
+    }
+
     res = browser_window_set_scale_internal(bw, scale);
     if (res == NSERROR_OK) {
         browser_window_recalculate_frameset(bw);
@@ -4273,7 +4276,7 @@ nserror browser_window__reload_current_parameters(struct browser_window *bw)
         bw->current_parameters.url = nsurl_ref(corestring_nsurl_about_blank);
     }
 
-    bw->current_parameters.flags &= ~BW_NAVIGATE_HISTORY;
+    bw->current_parameters.flags &= ~(BW_NAVIGATE_HISTORY | BW_NAVIGATE_RESTORE);
     bw->internal_nav = false;
 
     browser_window__free_fetch_parameters(&bw->loading_parameters);
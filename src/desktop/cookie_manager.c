@@ -672,6 +672,9 @@ static nserror cookie_manager_tree_node_folder_cb(struct treeview_node_msg msg,
 
     case TREE_MSG_NODE_LAUNCH:
         break;
+
+    case TREE_MSG_NODE_POPULATE:
+        break;
     }
 
     return NSERROR_OK;
@@ -694,6 +697,9 @@ static nserror cookie_manager_tree_node_entry_cb(struct treeview_node_msg msg, v
 
     case TREE_MSG_NODE_LAUNCH:
         break;
+
+    case TREE_MSG_NODE_POPULATE:
+        break;
     }
     return NSERROR_OK;
 }
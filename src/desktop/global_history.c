@@ -36,6 +36,9 @@
 #define N_DAYS 28
 #define N_SEC_PER_DAY (60 * 60 * 24)
 
+/** Initial number of buckets in the URL index */
+#define GH_INDEX_INITIAL 256
+
 enum global_history_folders {
     GH_TODAY = 0,
     GH_YESTERDAY,
@@ -54,6 +57,7 @@ enum global_history_fields { GH_TITLE, GH_URL, GH_LAST_VISIT, GH_VISITS, GH_PERI
 
 struct global_history_folder {
     treeview_node *folder;
+    bool deferred; /**< Entries not yet added to the treeview */
     struct treeview_field_data data;
 };
 
@@ -76,11 +80,115 @@ struct global_history_entry {
     treeview_node *entry;
     struct global_history_entry *next;
     struct global_history_entry *prev;
+    struct global_history_entry *hash_next; /**< Next in index bucket */
 
     struct treeview_field_data data[N_FIELDS - 1];
 };
 struct global_history_entry *gh_list[N_DAYS];
 
+/**
+ * Index of global history entries by URL
+ *
+ * Starts out using a static bucket array, so indexing an entry can't fail.
+ */
+static struct global_history_entry *gh_index_initial[GH_INDEX_INITIAL];
+static struct {
+    struct global_history_entry **buckets;
+    uint32_t size; /**< Number of buckets, a power of two */
+    uint32_t count; /**< Number of entries indexed */
+} gh_index = {gh_index_initial, GH_INDEX_INITIAL, 0};
+
+
+/**
+ * Get the index bucket for a URL
+ *
+ * \param url   The URL
+ * \param size  Number of buckets in the index
+ * \return the bucket number
+ */
+static inline uint32_t global_history_index_bucket(nsurl *url, uint32_t size)
+{
+    uint32_t h = nsurl_hash(url);
+
+    /* The URL hash is an xor of its components' hashes; mix it so the
+     * low bits are usable */
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+
+    return h & (size - 1);
+}
+
+
+/**
+ * Add an entry to the URL index
+ *
+ * \param e  The entry to add
+ */
+static void global_history_index_insert(struct global_history_entry *e)
+{
+    struct global_history_entry **buckets;
+    struct global_history_entry *next;
+    uint32_t size;
+    uint32_t i;
+    uint32_t b;
+
+    if (gh_index.count >= gh_index.size) {
+        /* Grow the index; if that fails the chains just get longer */
+        size = gh_index.size * 2;
+        buckets = calloc(size, sizeof(*buckets));
+        if (buckets != NULL) {
+            for (i = 0; i < gh_index.size; i++) {
+                while (gh_index.buckets[i] != NULL) {
+                    next = gh_index.buckets[i];
+                    gh_index.buckets[i] = next->hash_next;
+                    b = global_history_index_bucket(next->url, size);
+                    next->hash_next = buckets[b];
+                    buckets[b] = next;
+                }
+            }
+            if (gh_index.buckets != gh_index_initial) {
+                free(gh_index.buckets);
+            }
+            gh_index.buckets = buckets;
+            gh_index.size = size;
+        }
+    }
+
+    b = global_history_index_bucket(e->url, gh_index.size);
+    e->hash_next = gh_index.buckets[b];
+    gh_index.buckets[b] = e;
+    gh_index.count++;
+}
+
+
+/**
+ * Remove an entry from the URL index
+ *
+ * \param e  The entry to remove
+ */
+static void global_history_index_remove(struct global_history_entry *e)
+{
+    struct global_history_entry **prev;
+
+    prev = &gh_index.buckets[global_history_index_bucket(e->url, gh_index.size)];
+    while (*prev != NULL) {
+        if (*prev == e) {
+            *prev = e->hash_next;
+            gh_index.count--;
+            break;
+        }
+        prev = &(*prev)->hash_next;
+    }
+
+    if (gh_index.count == 0 && gh_index.buckets != gh_index_initial) {
+        /* Empty, so return to the static buckets */
+        free(gh_index.buckets);
+        gh_index.buckets = gh_index_initial;
+        gh_index.size = GH_INDEX_INITIAL;
+    }
+}
+
 
 /**
  * Find an entry in the global history
@@ -90,19 +198,15 @@ struct global_history_entry *gh_list[N_DAYS];
  */
 static struct global_history_entry *global_history_find(nsurl *url)
 {
-    int i;
     struct global_history_entry *e;
 
-    for (i = 0; i < N_DAYS; i++) {
-        e = gh_list[i];
-
-        while (e != NULL) {
-            if (nsurl_compare(e->url, url, NSURL_COMPLETE) == true) {
-                /* Got a match */
-                return e;
-            }
-            e = e->next;
+    e = gh_index.buckets[global_history_index_bucket(url, gh_index.size)];
+    while (e != NULL) {
+        if (nsurl_compare(e->url, url, NSURL_COMPLETE) == true) {
+            /* Got a match */
+            return e;
         }
+        e = e->hash_next;
     }
 
     /* No match found */
@@ -110,6 +214,77 @@ static struct global_history_entry *global_history_find(nsurl *url)
 }
 
 
+/**
+ * Sort a list of global history entries, most recent first
+ *
+ * Only the next links are followed and set.
+ *
+ * \param list  First entry of the list to sort
+ * \return first entry of the sorted list
+ */
+static struct global_history_entry *global_history_sort_list(struct global_history_entry *list)
+{
+    struct global_history_entry *slow, *fast;
+    struct global_history_entry *a, *b;
+    struct global_history_entry *head = NULL;
+    struct global_history_entry **tail = &head;
+
+    if (list == NULL || list->next == NULL) {
+        return list;
+    }
+
+    /* Split the list in half */
+    slow = list;
+    fast = list->next;
+    while (fast != NULL && fast->next != NULL) {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    b = slow->next;
+    slow->next = NULL;
+
+    a = global_history_sort_list(list);
+    b = global_history_sort_list(b);
+
+    /* Merge.  Lists are built by prepending entries as they're loaded,
+     * so ties go to the later half to keep equal times in load order. */
+    while (a != NULL && b != NULL) {
+        if (a->t > b->t) {
+            *tail = a;
+            a = a->next;
+        } else {
+            *tail = b;
+            b = b->next;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = (a != NULL) ? a : b;
+
+    return head;
+}
+
+
+/**
+ * Sort the entries loaded into each global history slot
+ */
+static void global_history_sort_entries(void)
+{
+    struct global_history_entry *prev;
+    struct global_history_entry *e;
+    int i;
+
+    for (i = 0; i < N_DAYS; i++) {
+        gh_list[i] = global_history_sort_list(gh_list[i]);
+
+        prev = NULL;
+        for (e = gh_list[i]; e != NULL; e = e->next) {
+            e->prev = prev;
+            prev = e;
+        }
+    }
+}
+
+
 /**
  * Initialise the treeview directories
  *
@@ -121,6 +296,7 @@ static nserror global_history_create_dir(enum global_history_folders f)
     nserror err;
     treeview_node *relation = NULL;
     enum treeview_relationship rel = TREE_REL_FIRST_CHILD;
+    treeview_node_options_flags flags;
     const char *label;
     int i;
 
@@ -179,43 +355,72 @@ static nserror global_history_create_dir(enum global_history_folders f)
         }
     }
 
+    /* While loading, only today's entries are added to the treeview
+     * straight away.  Older folders get theirs when first needed. */
+    if (gh_ctx.built) {
+        flags = TREE_OPTION_NONE;
+        gh_ctx.folders[f].deferred = false;
+    } else if (f == GH_TODAY) {
+        flags = TREE_OPTION_SUPPRESS_RESIZE | TREE_OPTION_SUPPRESS_REDRAW;
+        gh_ctx.folders[f].deferred = false;
+    } else {
+        flags = TREE_OPTION_SUPPRESS_RESIZE | TREE_OPTION_SUPPRESS_REDRAW | TREE_OPTION_DEFERRED_DIR;
+        gh_ctx.folders[f].deferred = true;
+    }
+
     gh_ctx.folders[f].data.field = gh_ctx.fields[N_FIELDS - 1].field;
     gh_ctx.folders[f].data.value = label;
     gh_ctx.folders[f].data.value_len = strlen(label);
     err = treeview_create_node_folder(gh_ctx.tree, &gh_ctx.folders[f].folder, relation, rel, &gh_ctx.folders[f].data,
-        &gh_ctx.folders[f],
-        gh_ctx.built ? TREE_OPTION_NONE : TREE_OPTION_SUPPRESS_RESIZE | TREE_OPTION_SUPPRESS_REDRAW);
+        &gh_ctx.folders[f], flags);
 
     return err;
 }
 
 
 /**
- * Get the treeview folder for history entires in a particular slot
+ * Get the folder for history entries in a particular slot
  *
- * \param parent	Updated to parent folder.
- * \param slot		Global history slot of entry we want folder node for
- * \return NSERROR_OK on success, appropriate error otherwise
+ * \param slot		Global history slot
+ * \return the folder, or GH_N_FOLDERS if the slot is invalid
  */
-static inline nserror global_history_get_parent_treeview_node(treeview_node **parent, int slot)
+static inline enum global_history_folders global_history_slot_folder(int slot)
 {
-    int folder_index;
-    struct global_history_folder *f;
-    nserror err;
+    if (slot < 0) {
+        return GH_N_FOLDERS;
 
-    if (slot < 7) {
-        folder_index = slot;
+    } else if (slot < 7) {
+        return slot;
 
     } else if (slot < 14) {
-        folder_index = GH_LAST_WEEK;
+        return GH_LAST_WEEK;
 
     } else if (slot < 21) {
-        folder_index = GH_2_WEEKS_AGO;
+        return GH_2_WEEKS_AGO;
 
     } else if (slot < N_DAYS) {
-        folder_index = GH_3_WEEKS_AGO;
+        return GH_3_WEEKS_AGO;
+    }
 
-    } else {
+    return GH_N_FOLDERS;
+}
+
+
+/**
+ * Get the treeview folder for history entires in a particular slot
+ *
+ * \param parent	Updated to parent folder.
+ * \param slot		Global history slot of entry we want folder node for
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static inline nserror global_history_get_parent_treeview_node(struct global_history_folder **parent, int slot)
+{
+    enum global_history_folders folder_index;
+    struct global_history_folder *f;
+    nserror err;
+
+    folder_index = global_history_slot_folder(slot);
+    if (folder_index == GH_N_FOLDERS) {
         /* Slot value is invalid */
         return NSERROR_BAD_PARAMETER;
     }
@@ -231,8 +436,8 @@ static inline nserror global_history_get_parent_treeview_node(treeview_node **pa
         }
     }
 
-    /* Return the parent treeview folder */
-    *parent = f->folder;
+    /* Return the parent folder */
+    *parent = f;
     return NSERROR_OK;
 }
 
@@ -299,13 +504,18 @@ static nserror global_history_entry_insert(struct global_history_entry *e, int s
 {
     nserror err;
 
-    treeview_node *parent;
+    struct global_history_folder *parent;
     err = global_history_get_parent_treeview_node(&parent, slot);
     if (err != NSERROR_OK) {
         return err;
     }
 
-    err = treeview_create_node_entry(gh_ctx.tree, &(e->entry), parent, TREE_REL_FIRST_CHILD, e->data, e,
+    if (parent->deferred) {
+        /* Added when the folder is populated */
+        return NSERROR_OK;
+    }
+
+    err = treeview_create_node_entry(gh_ctx.tree, &(e->entry), parent->folder, TREE_REL_FIRST_CHILD, e->data, e,
         gh_ctx.built ? TREE_OPTION_NONE : TREE_OPTION_SUPPRESS_RESIZE | TREE_OPTION_SUPPRESS_REDRAW);
     if (err != NSERROR_OK) {
         return err;
@@ -354,7 +564,16 @@ static nserror global_history_add_entry_internal(nsurl *url, int slot, const str
         return err;
     }
 
-    if (gh_list[slot] == NULL) {
+    global_history_index_insert(e);
+
+    if (!got_treeview) {
+        /* Loading; the lists are sorted once everything is in */
+        e->next = gh_list[slot];
+        if (e->next != NULL)
+            e->next->prev = e;
+        gh_list[slot] = e;
+
+    } else if (gh_list[slot] == NULL) {
         /* list empty */
         gh_list[slot] = e;
 
@@ -425,6 +644,8 @@ static void global_history_delete_entry_internal(struct global_history_entry *e)
         e->next->prev = e->prev;
     }
 
+    global_history_index_remove(e);
+
     if (e->user_delete) {
         /* User requested delete, so delete from urldb too. */
         urldb_reset_url_visit_data(e->url);
@@ -440,6 +661,66 @@ static void global_history_delete_entry_internal(struct global_history_entry *e)
     free(e);
 }
 
+
+/**
+ * Delete a global history entry that isn't in the treeview
+ *
+ * If that leaves the entry's folder empty, the folder is deleted too.
+ *
+ * \param e		Entry to delete
+ */
+static void global_history_delete_deferred_entry(struct global_history_entry *e)
+{
+    enum global_history_folders f = global_history_slot_folder(e->slot);
+    int i;
+
+    global_history_delete_entry_internal(e);
+
+    for (i = 0; i < N_DAYS; i++) {
+        if (gh_list[i] != NULL && global_history_slot_folder(i) == f) {
+            return;
+        }
+    }
+
+    if (gh_ctx.folders[f].folder != NULL) {
+        treeview_delete_node(
+            gh_ctx.tree, gh_ctx.folders[f].folder, TREE_OPTION_SUPPRESS_REDRAW | TREE_OPTION_SUPPRESS_RESIZE);
+    }
+}
+
+
+/**
+ * Add the entries of a deferred folder to the treeview
+ *
+ * \param f		The folder being populated
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror global_history_populate_folder(enum global_history_folders f)
+{
+    struct global_history_entry *e;
+    nserror err;
+    int i;
+
+    for (i = 0; i < N_DAYS; i++) {
+        if (gh_list[i] == NULL || global_history_slot_folder(i) != f) {
+            continue;
+        }
+
+        /* Insert in reverse order; find last */
+        for (e = gh_list[i]; e->next != NULL; e = e->next)
+            ;
+
+        for (; e != NULL; e = e->prev) {
+            err = global_history_entry_insert(e, i);
+            if (err != NSERROR_OK) {
+                return err;
+            }
+        }
+    }
+
+    return NSERROR_OK;
+}
+
 /**
  * Internal routine to actually perform global history addition
  *
@@ -474,8 +755,11 @@ static bool global_history_add_entry(nsurl *url, const struct url_data *data)
 
         /* Delete any existing entry for this URL */
         e = global_history_find(url);
-        if (e != NULL) {
+        if (e != NULL && e->entry != NULL) {
             treeview_delete_node(gh_ctx.tree, e->entry, TREE_OPTION_SUPPRESS_REDRAW | TREE_OPTION_SUPPRESS_RESIZE);
+        } else if (e != NULL) {
+            /* Entry is in a folder that hasn't been populated */
+            global_history_delete_deferred_entry(e);
         }
     }
 
@@ -594,6 +878,22 @@ static nserror global_history_init_entries(void)
     for (i = 0; i < N_DAYS; i++) {
         struct global_history_entry *l = NULL;
         struct global_history_entry *e = gh_list[i];
+        struct global_history_folder *f;
+
+        if (e == NULL) {
+            continue;
+        }
+
+        /* Make sure the slot has a folder */
+        err = global_history_get_parent_treeview_node(&f, i);
+        if (err != NSERROR_OK) {
+            return err;
+        }
+
+        if (f->deferred) {
+            /* Entries are added when the folder is populated */
+            continue;
+        }
 
         /* Insert in reverse order; find last */
         while (e != NULL) {
@@ -618,10 +918,12 @@ static nserror global_history_init_entries(void)
 static nserror global_history_tree_node_folder_cb(struct treeview_node_msg msg, void *data)
 {
     struct global_history_folder *f = data;
+    nserror ret = NSERROR_OK;
 
     switch (msg.msg) {
     case TREE_MSG_NODE_DELETE:
         f->folder = NULL;
+        f->deferred = false;
         break;
 
     case TREE_MSG_NODE_EDIT:
@@ -629,9 +931,14 @@ static nserror global_history_tree_node_folder_cb(struct treeview_node_msg msg,
 
     case TREE_MSG_NODE_LAUNCH:
         break;
+
+    case TREE_MSG_NODE_POPULATE:
+        f->deferred = false;
+        ret = global_history_populate_folder(f - gh_ctx.folders);
+        break;
     }
 
-    return NSERROR_OK;
+    return ret;
 }
 
 static nserror global_history_tree_node_entry_cb(struct treeview_node_msg msg, void *data)
@@ -663,6 +970,9 @@ static nserror global_history_tree_node_entry_cb(struct treeview_node_msg msg, v
 
         ret = browser_window_create(flags, e->url, NULL, existing, NULL);
     } break;
+
+    case TREE_MSG_NODE_POPULATE:
+        break;
     }
     return ret;
 }
@@ -699,6 +1009,7 @@ nserror global_history_init(void *core_window_handle)
 
     /* Load the entries */
     urldb_iterate_entries(global_history_add_entry);
+    global_history_sort_entries();
 
     /* Create the global history treeview */
     err = treeview_create(&gh_ctx.tree, &gh_tree_cb_t, N_FIELDS, gh_ctx.fields, core_window_handle,
@@ -754,6 +1065,13 @@ nserror global_history_fini(void)
     err = treeview_destroy(gh_ctx.tree);
     gh_ctx.tree = NULL;
 
+    /* Destroy any entries from folders that were never populated */
+    for (i = 0; i < N_DAYS; i++) {
+        while (gh_list[i] != NULL) {
+            global_history_delete_entry_internal(gh_list[i]);
+        }
+    }
+
     /* Free global history treeview entry fields */
     for (i = 0; i < N_FIELDS; i++)
         if (gh_ctx.fields[i].field != NULL)
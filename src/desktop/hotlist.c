@@ -498,6 +498,9 @@ static nserror hotlist_tree_node_folder_cb(struct treeview_node_msg msg, void *d
 
     case TREE_MSG_NODE_LAUNCH:
         break;
+
+    case TREE_MSG_NODE_POPULATE:
+        break;
     }
 
     return NSERROR_OK;
@@ -573,6 +576,9 @@ static nserror hotlist_tree_node_entry_cb(struct treeview_node_msg msg, void *da
 
         err = browser_window_create(flags, e->url, NULL, existing, NULL);
     } break;
+
+    case TREE_MSG_NODE_POPULATE:
+        break;
     }
     return err;
 }
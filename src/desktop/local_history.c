@@ -140,6 +140,7 @@ static nserror redraw_entry(struct history *history, struct history_entry *entry
 
     plot_style_t *pstyle;
     plot_font_style_t *pfstyle;
+    struct bitmap *bitmap;
     struct rect rect;
     nserror res;
 
@@ -153,8 +154,9 @@ static nserror redraw_entry(struct history *history, struct history_entry *entry
     }
 
     /* Only attempt to plot bitmap if it is present */
-    if (entry->page.bitmap != NULL) {
-        res = ctx->plot->bitmap(ctx, entry->page.bitmap, entry->x + x, entry->y + y, LOCAL_HISTORY_WIDTH,
+    bitmap = browser_window_history_entry_bitmap(entry);
+    if (bitmap != NULL) {
+        res = ctx->plot->bitmap(ctx, bitmap, entry->x + x, entry->y + y, LOCAL_HISTORY_WIDTH,
             LOCAL_HISTORY_HEIGHT, 0xffffff, 0);
         if (res != NSERROR_OK) {
             return res;
@@ -341,6 +343,9 @@ nserror local_history_redraw(
         return NSERROR_OK;
     }
 
+    /* The current page's thumbnail may still be waiting for an idle moment */
+    browser_window_history_render_thumbnail(session->bw);
+
     ctx->plot->clip(ctx, &r);
     ctx->plot->rectangle(ctx, &pstyle_bg, &r);
 
@@ -0,0 +1,450 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Text measurement cache implementation.
+ *
+ * The cache is a fixed size direct mapped table. Each slot holds one
+ * measurement keyed on the operation, the metric affecting parts of the
+ * font style (colours are ignored), the font family list, the text and,
+ * for position and split, the x coordinate asked about. A colliding
+ * measurement simply replaces the slot's previous occupant so memory use
+ * is bounded by the table size and the maximum cached text length.
+ *
+ * Where a frontend splits or positions within text depends on details
+ * the cache cannot see, so those results are only reused for the same x.
+ * As the available width changes on every resize, the reuse across
+ * reflows comes from the widths of words, which are keyed on the text and
+ * style alone.
+ *
+ * Font family names are interned strings so the family list is compared
+ * by pointer, and a reference is held on each for the life of the entry.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libwapcaplet/libwapcaplet.h>
+
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/layout.h>
+#include <wisp/ns_inttypes.h>
+#include <wisp/plot_style.h>
+#include <wisp/utils/log.h>
+
+#include "desktop/measure_cache.h"
+
+/** Number of slots in the cache, must be a power of two */
+static const unsigned int measure_cache_slots = 4096;
+
+/** Longest text, in bytes, that will be cached */
+static const size_t measure_cache_max_length = 256;
+
+/** Most font families an entry can record */
+#define MEASURE_CACHE_MAX_FAMILIES 4
+
+/** Measurement operation an entry records */
+enum measure_op {
+    MEASURE_OP_NONE = 0, /**< Slot is empty */
+    MEASURE_OP_WIDTH,
+    MEASURE_OP_POSITION,
+    MEASURE_OP_SPLIT,
+};
+
+/** A single cached measurement */
+struct measure_entry {
+    uint32_t hash; /**< hash of the key */
+    enum measure_op op; /**< operation the result is for */
+
+    /* metric affecting parts of the font style */
+    lwc_string *families[MEASURE_CACHE_MAX_FAMILIES]; /**< NULL terminated unless full */
+    plot_font_generic_family_t family;
+    plot_style_fixed size;
+    int weight;
+    plot_font_flags_t flags;
+    int letter_spacing;
+
+    int x; /**< x coordinate for position and split */
+    char *string; /**< copy of the measured text */
+    size_t length; /**< length of text in bytes */
+
+    int result_x; /**< width, or actual_x for position and split */
+    size_t char_offset; /**< char_offset for position and split */
+};
+
+/** The cache table, NULL when the cache is not initialised */
+static struct measure_entry *measure_cache;
+
+/** Statistics since initialisation */
+static struct measure_cache_stats measure_stats;
+
+
+/**
+ * Release the resources held by a cache entry and mark it empty.
+ *
+ * \param entry The entry to clear
+ */
+static void measure_entry_clear(struct measure_entry *entry)
+{
+    unsigned int i;
+
+    if (entry->op == MEASURE_OP_NONE) {
+        return;
+    }
+
+    for (i = 0; i < MEASURE_CACHE_MAX_FAMILIES && entry->families[i] != NULL; i++) {
+        lwc_string_unref(entry->families[i]);
+    }
+    free(entry->string);
+    memset(entry, 0, sizeof(*entry));
+}
+
+
+/**
+ * Compute the hash of a measurement key.
+ *
+ * \param op The measurement operation
+ * \param fstyle The font style
+ * \param string The text
+ * \param length Length of text in bytes
+ * \param x The x coordinate, zero for width
+ * \param[out] hash Updated with the key hash
+ * \return true if the key may be cached, false if it must bypass the cache
+ */
+static bool measure_key_hash(enum measure_op op, const plot_font_style_t *fstyle, const char *string, size_t length,
+    int x, uint32_t *hash)
+{
+    uint32_t h = 2166136261u; /* FNV-1a */
+    unsigned int nfamilies = 0;
+    size_t i;
+
+    if (length > measure_cache_max_length) {
+        return false;
+    }
+
+    if (fstyle->families != NULL) {
+        while (fstyle->families[nfamilies] != NULL) {
+            if (nfamilies == MEASURE_CACHE_MAX_FAMILIES) {
+                return false;
+            }
+            h = (h ^ (uint32_t)(uintptr_t)fstyle->families[nfamilies]) * 16777619u;
+            nfamilies++;
+        }
+    }
+
+    for (i = 0; i < length; i++) {
+        h = (h ^ (uint8_t)string[i]) * 16777619u;
+    }
+
+    h = (h ^ (uint32_t)op) * 16777619u;
+    h = (h ^ (uint32_t)fstyle->family) * 16777619u;
+    h = (h ^ (uint32_t)fstyle->size) * 16777619u;
+    h = (h ^ (uint32_t)fstyle->weight) * 16777619u;
+    h = (h ^ (uint32_t)fstyle->flags) * 16777619u;
+    h = (h ^ (uint32_t)fstyle->letter_spacing) * 16777619u;
+    h = (h ^ (uint32_t)x) * 16777619u;
+
+    *hash = h;
+    return true;
+}
+
+
+/**
+ * Find the slot for a measurement key.
+ *
+ * \param hash The key hash
+ * \return The slot the key maps to
+ */
+static inline struct measure_entry *measure_slot(uint32_t hash)
+{
+    return &measure_cache[hash & (measure_cache_slots - 1)];
+}
+
+
+/**
+ * Check whether a cache entry holds the result for a measurement key.
+ */
+static bool measure_entry_match(const struct measure_entry *entry, uint32_t hash, enum measure_op op,
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x)
+{
+    unsigned int i;
+
+    if (entry->op != op || entry->hash != hash || entry->length != length || entry->x != x ||
+        entry->family != fstyle->family || entry->size != fstyle->size || entry->weight != fstyle->weight ||
+        entry->flags != fstyle->flags || entry->letter_spacing != fstyle->letter_spacing) {
+        return false;
+    }
+
+    for (i = 0; i < MEASURE_CACHE_MAX_FAMILIES; i++) {
+        lwc_string *family = (fstyle->families != NULL) ? fstyle->families[i] : NULL;
+        if (entry->families[i] != family) {
+            return false;
+        }
+        if (family == NULL) {
+            break;
+        }
+    }
+
+    return length == 0 || memcmp(entry->string, string, length) == 0;
+}
+
+
+/**
+ * Store a measurement in its slot, replacing any previous occupant.
+ *
+ * Allocation failure leaves the slot empty; the measurement will simply
+ * be made again next time.
+ */
+static void measure_entry_store(struct measure_entry *entry, uint32_t hash, enum measure_op op,
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, int result_x, size_t char_offset)
+{
+    unsigned int i;
+
+    if (entry->op != MEASURE_OP_NONE) {
+        measure_stats.evictions++;
+        measure_entry_clear(entry);
+    }
+
+    entry->string = malloc(length + 1);
+    if (entry->string == NULL) {
+        return;
+    }
+    if (length > 0) {
+        memcpy(entry->string, string, length);
+    }
+    entry->string[length] = '\0';
+    entry->length = length;
+
+    for (i = 0; i < MEASURE_CACHE_MAX_FAMILIES; i++) {
+        lwc_string *family = (fstyle->families != NULL) ? fstyle->families[i] : NULL;
+        if (family == NULL) {
+            break;
+        }
+        entry->families[i] = lwc_string_ref(family);
+    }
+
+    entry->hash = hash;
+    entry->op = op;
+    entry->family = fstyle->family;
+    entry->size = fstyle->size;
+    entry->weight = fstyle->weight;
+    entry->flags = fstyle->flags;
+    entry->letter_spacing = fstyle->letter_spacing;
+    entry->x = x;
+    entry->result_x = result_x;
+    entry->char_offset = char_offset;
+}
+
+
+/**
+ * Measure the width of a string, consulting the cache first.
+ *
+ * \param[in] fstyle plot style for this text
+ * \param[in] string UTF-8 string to measure
+ * \param[in] length length of string, in bytes
+ * \param[out] width updated to width of string[0..length)
+ * \return NSERROR_OK and width updated or appropriate error code
+ */
+static nserror measure_cache_width(const plot_font_style_t *fstyle, const char *string, size_t length, int *width)
+{
+    struct measure_entry *entry;
+    uint32_t hash;
+    nserror res;
+
+    if (measure_cache == NULL || !measure_key_hash(MEASURE_OP_WIDTH, fstyle, string, length, 0, &hash)) {
+        measure_stats.bypass++;
+        return guit->layout->width(fstyle, string, length, width);
+    }
+
+    entry = measure_slot(hash);
+    if (measure_entry_match(entry, hash, MEASURE_OP_WIDTH, fstyle, string, length, 0)) {
+        measure_stats.hits++;
+        *width = entry->result_x;
+        return NSERROR_OK;
+    }
+
+    measure_stats.misses++;
+    res = guit->layout->width(fstyle, string, length, width);
+    if (res == NSERROR_OK) {
+        measure_entry_store(entry, hash, MEASURE_OP_WIDTH, fstyle, string, length, 0, *width, 0);
+    }
+    return res;
+}
+
+
+/**
+ * Perform a position or split measurement, consulting the cache first.
+ *
+ * \param op Which of position or split to perform
+ * \param fn The frontend function for the operation
+ * \param[in] fstyle style for this text
+ * \param[in] string UTF-8 string to measure
+ * \param[in] length length of string, in bytes
+ * \param[in] x coordinate to search for or width available
+ * \param[out] char_offset updated to offset in string
+ * \param[out] actual_x updated to x coordinate of char_offset
+ * \return NSERROR_OK and outputs updated or appropriate error code
+ */
+static nserror measure_cache_offset(enum measure_op op,
+    nserror (*fn)(const plot_font_style_t *, const char *, size_t, int, size_t *, int *),
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, size_t *char_offset, int *actual_x)
+{
+    struct measure_entry *entry;
+    uint32_t hash;
+    nserror res;
+
+    if (measure_cache == NULL || !measure_key_hash(op, fstyle, string, length, x, &hash)) {
+        measure_stats.bypass++;
+        return fn(fstyle, string, length, x, char_offset, actual_x);
+    }
+
+    entry = measure_slot(hash);
+    if (measure_entry_match(entry, hash, op, fstyle, string, length, x)) {
+        measure_stats.hits++;
+        *char_offset = entry->char_offset;
+        *actual_x = entry->result_x;
+        return NSERROR_OK;
+    }
+
+    measure_stats.misses++;
+    res = fn(fstyle, string, length, x, char_offset, actual_x);
+    if (res == NSERROR_OK) {
+        measure_entry_store(entry, hash, op, fstyle, string, length, x, *actual_x, *char_offset);
+    }
+    return res;
+}
+
+
+/**
+ * Find the position in a string where an x coordinate falls, consulting
+ * the cache first.
+ */
+static nserror measure_cache_position(const plot_font_style_t *fstyle, const char *string, size_t length, int x,
+    size_t *char_offset, int *actual_x)
+{
+    return measure_cache_offset(
+        MEASURE_OP_POSITION, guit->layout->position, fstyle, string, length, x, char_offset, actual_x);
+}
+
+
+/**
+ * Find where to split a string to make it fit a width, consulting the
+ * cache first.
+ */
+static nserror measure_cache_split(const plot_font_style_t *fstyle, const char *string, size_t length, int x,
+    size_t *char_offset, int *actual_x)
+{
+    return measure_cache_offset(
+        MEASURE_OP_SPLIT, guit->layout->split, fstyle, string, length, x, char_offset, actual_x);
+}
+
+
+/**
+ * Load font data via the frontend, discarding measurements made before
+ * the font was available.
+ */
+static nserror measure_cache_load_font_data(const struct font_variant_id *id, const uint8_t *data, size_t size)
+{
+    nserror res;
+
+    if (guit->layout->load_font_data == NULL) {
+        return NSERROR_NOT_IMPLEMENTED;
+    }
+
+    res = guit->layout->load_font_data(id, data, size);
+    if (res == NSERROR_OK) {
+        measure_cache_flush();
+    }
+    return res;
+}
+
+
+/* exported interface documented in desktop/measure_cache.h */
+const struct gui_layout_table measure_cache_layout_table = {
+    .width = measure_cache_width,
+    .position = measure_cache_position,
+    .split = measure_cache_split,
+    .load_font_data = measure_cache_load_font_data,
+};
+
+
+/* exported interface documented in desktop/measure_cache.h */
+nserror measure_cache_init(void)
+{
+    if (measure_cache != NULL) {
+        return NSERROR_OK;
+    }
+
+    measure_cache = calloc(measure_cache_slots, sizeof(struct measure_entry));
+    if (measure_cache == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    memset(&measure_stats, 0, sizeof(measure_stats));
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in desktop/measure_cache.h */
+nserror measure_cache_fini(void)
+{
+    uint64_t lookups;
+
+    if (measure_cache == NULL) {
+        return NSERROR_OK;
+    }
+
+    lookups = measure_stats.hits + measure_stats.misses;
+    NSLOG(wisp, INFO,
+        "text measurement cache: %" PRIu64 " hits, %" PRIu64 " misses (%" PRIu64 "%%), %" PRIu64 " bypassed, %" PRIu64
+        " evicted",
+        measure_stats.hits, measure_stats.misses, (lookups > 0) ? (measure_stats.hits * 100) / lookups : 0,
+        measure_stats.bypass, measure_stats.evictions);
+
+    measure_cache_flush();
+    free(measure_cache);
+    measure_cache = NULL;
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in desktop/measure_cache.h */
+void measure_cache_flush(void)
+{
+    unsigned int i;
+
+    if (measure_cache == NULL) {
+        return;
+    }
+
+    for (i = 0; i < measure_cache_slots; i++) {
+        measure_entry_clear(&measure_cache[i]);
+    }
+}
+
+
+/* exported interface documented in desktop/measure_cache.h */
+void measure_cache_get_stats(struct measure_cache_stats *stats)
+{
+    *stats = measure_stats;
+}
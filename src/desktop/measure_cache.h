@@ -0,0 +1,85 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Text measurement cache (interface).
+ *
+ * Layout asks the frontend to measure the same runs of text with the same
+ * style many times over while a page reflows. The measurement cache sits
+ * between the core and the frontend layout table and remembers the results
+ * so every frontend benefits without having to implement its own cache.
+ */
+
+#ifndef _WISP_DESKTOP_MEASURE_CACHE_H_
+#define _WISP_DESKTOP_MEASURE_CACHE_H_
+
+#include <stdint.h>
+
+#include <wisp/layout.h>
+
+/**
+ * Measurement cache statistics.
+ */
+struct measure_cache_stats {
+    uint64_t hits; /**< lookups answered from the cache */
+    uint64_t misses; /**< lookups forwarded to the frontend and stored */
+    uint64_t bypass; /**< lookups forwarded without being cacheable */
+    uint64_t evictions; /**< stored entries displaced by a newer one */
+};
+
+/**
+ * Initialise the measurement cache.
+ *
+ * Until this is called, or after it fails, the cache layout table
+ * forwards every request straight to the frontend.
+ *
+ * \return NSERROR_OK on success or NSERROR_NOMEM on allocation failure
+ */
+nserror measure_cache_init(void);
+
+/**
+ * Finalise the measurement cache, logging its statistics.
+ *
+ * \return NSERROR_OK
+ */
+nserror measure_cache_fini(void);
+
+/**
+ * Discard every cached measurement.
+ *
+ * Must be called whenever the fonts available to the frontend change,
+ * for example once a web font has been loaded, and whenever the frontend
+ * would measure the same text differently, for example after the screen
+ * DPI, the page scale or the font preferences change.
+ */
+void measure_cache_flush(void);
+
+/**
+ * Retrieve measurement cache statistics.
+ *
+ * \param[out] stats updated with the counts since initialisation
+ */
+void measure_cache_get_stats(struct measure_cache_stats *stats);
+
+/**
+ * Layout table which memoises the frontend layout table.
+ */
+extern const struct gui_layout_table measure_cache_layout_table;
+
+#endif
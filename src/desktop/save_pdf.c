@@ -146,6 +146,7 @@ static const struct plotter_table pdf_plotters = {
     .bitmap = pdf_plot_bitmap_tile,
     .path = pdf_plot_path,
     .option_knockout = false,
+    .option_raster_vectors = true,
 };
 
 const struct printer pdf_printer = {&pdf_plotters, pdf_begin, pdf_next_page, pdf_end};
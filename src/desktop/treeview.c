@@ -24,6 +24,7 @@
 
 #include <wisp/utils/config.h>
 
+#include <ctype.h>
 #include <string.h>
 
 #include <wisp/content/handlers/css/utils.h>
@@ -56,6 +57,16 @@
  */
 #define REDRAW_MAX 8000
 
+/**
+ * Number of children a node needs before an index of their offsets is kept.
+ */
+#define TREEVIEW_CHILD_INDEX_MIN 32
+
+/**
+ * Number of trigram buckets in a treeview's search index.
+ */
+#define TREEVIEW_SEARCH_BUCKETS 4096
+
 
 /**
  * Treeview handling global context
@@ -113,6 +124,7 @@ enum treeview_node_flags {
     TV_NFLAGS_SELECTED = (1 << 1), /**< Whether node is selected */
     TV_NFLAGS_SPECIAL = (1 << 2), /**< Render as special node */
     TV_NFLAGS_MATCHED = (1 << 3), /**< Whether node matches search */
+    TV_NFLAGS_DEFERRED = (1 << 4), /**< Whether folder awaits its children */
 };
 
 
@@ -122,6 +134,31 @@ enum treeview_node_flags {
 enum treeview_target_pos { TV_TARGET_ABOVE, TV_TARGET_INSIDE, TV_TARGET_BELOW, TV_TARGET_NONE };
 
 
+/**
+ * Offset of a child within its parent
+ */
+struct treeview_child_offset {
+    treeview_node *node; /**< The child */
+    int y; /**< Offset of child's top from the top of the first child */
+    int row; /**< Number of rows before child, from the first child */
+};
+
+
+/**
+ * Offsets of a node's children
+ *
+ * Lets the child at a position be found by binary search, rather than by
+ * walking every child.  Only built for nodes with many children, and built
+ * again when it is needed after the tree's layout has changed.
+ */
+struct treeview_child_index {
+    unsigned int generation; /**< Tree layout generation of offsets */
+    unsigned int count; /**< Number of children */
+    unsigned int alloc; /**< Number of children there is space for */
+    struct treeview_child_offset *child; /**< Children, in order */
+};
+
+
 /**
  * Treeview node
  */
@@ -130,12 +167,15 @@ struct treeview_node {
     enum treeview_node_type type; /**< Node type */
 
     int height; /**< Includes height of any descendants (pixels) */
+    int rows; /**< Includes rows of any descendants shown */
     int inset; /**< Node's inset depending on tree depth (pixels) */
+    unsigned int position; /**< Index among siblings, for parent's index */
 
     treeview_node *parent; /**< parent node */
     treeview_node *prev_sib; /**< previous sibling node */
     treeview_node *next_sib; /**< next sibling node */
     treeview_node *children; /**< first child node */
+    struct treeview_child_index *index; /**< Children's offsets, or NULL */
 
     void *client_data; /**< Passed to client on node event msg callback */
 
@@ -151,6 +191,7 @@ struct treeview_node {
  */
 struct treeview_node_entry {
     treeview_node base; /**< Entry class inherits node base class */
+    uint32_t search_id; /**< Id in treeview's search index, or 0 */
     struct treeview_field fields[FLEX_ARRAY_LEN_DECL];
 };
 
@@ -210,6 +251,47 @@ struct treeview_edit {
 };
 
 
+/**
+ * Entries with a trigram that falls in a search index bucket
+ */
+struct treeview_search_bucket {
+    uint32_t *id; /**< Entry ids, in the order they were added */
+    uint32_t count; /**< Number of ids */
+    uint32_t alloc; /**< Number of ids allocated */
+    uint32_t last; /**< Last id added, so an entry is only added once */
+};
+
+
+/**
+ * An entry in a search index
+ */
+struct treeview_search_id {
+    struct treeview_node_entry *entry; /**< The entry, or NULL if gone */
+    uint32_t postings; /**< Number of buckets holding the id */
+};
+
+
+/**
+ * Trigram index of the searchable text of a treeview's entries
+ *
+ * Built by the first search that can use it, then kept up to date as
+ * entries are added, changed and deleted.  Ids are not reused, so entries
+ * that go away leave stale ids in the buckets until the index is rebuilt.
+ */
+struct treeview_search_index {
+    struct treeview_search_bucket bucket[TREEVIEW_SEARCH_BUCKETS];
+
+    struct treeview_search_id *id; /**< Entries, by id; id 0 is unused */
+    uint32_t *matched; /**< Ids of entries matched by the last search */
+    uint32_t count; /**< Number of ids given out */
+    uint32_t alloc; /**< Number of ids allocated */
+    uint32_t n_matched; /**< Number of matched ids */
+
+    uint32_t live; /**< Postings of current entries */
+    uint32_t stale; /**< Postings of entries that have gone */
+};
+
+
 /**
  * Treeview search box details
  */
@@ -218,6 +300,7 @@ struct treeview_search {
     bool active; /**< Whether the search box has focus. */
     bool search; /**< Whether we have a search term. */
     int height; /**< Current search display height. */
+    struct treeview_search_index *index; /**< Text index, or NULL */
 };
 
 
@@ -241,6 +324,11 @@ struct treeview {
 
     struct treeview_search search; /**< Treeview search box */
 
+    unsigned int generation; /**< Bumped when nodes are moved or resized */
+
+    unsigned int deferred; /**< Number of folders awaiting their children */
+    bool populating; /**< Whether a deferred folder is being populated */
+
     const struct treeview_callback_table *callbacks; /**< For node events */
 
     struct core_window *cw_h; /**< Core window handle */
@@ -493,6 +581,185 @@ static inline treeview_node *treeview_node_next(treeview_node *node, bool full)
 }
 
 
+/**
+ * Destroy a node's child index
+ *
+ * \param n Node to destroy child index of
+ */
+static void treeview__child_index_destroy(treeview_node *n)
+{
+    if (n->index != NULL) {
+        free(n->index->child);
+        free(n->index);
+        n->index = NULL;
+    }
+}
+
+
+/**
+ * Get the child index of a node, building it if it is out of date
+ *
+ * \param tree Treeview object node is in
+ * \param node Node to get child index of
+ * \return the child index, or NULL if node has too few children to need one
+ */
+static struct treeview_child_index *treeview__child_index(treeview *tree, treeview_node *node)
+{
+    struct treeview_child_index *index = node->index;
+    struct treeview_child_offset *child;
+    unsigned int count = 0;
+    treeview_node *n;
+    int row = 0;
+    int y = 0;
+
+    if (index != NULL && index->generation == tree->generation) {
+        return index;
+    }
+
+    for (n = node->children; n != NULL; n = n->next_sib) {
+        count++;
+    }
+
+    if (count < TREEVIEW_CHILD_INDEX_MIN) {
+        treeview__child_index_destroy(node);
+        return NULL;
+    }
+
+    if (index == NULL) {
+        index = calloc(1, sizeof(*index));
+        if (index == NULL) {
+            return NULL;
+        }
+        node->index = index;
+    }
+
+    if (index->alloc < count) {
+        child = realloc(index->child, count * sizeof(*child));
+        if (child == NULL) {
+            return NULL;
+        }
+        index->child = child;
+        index->alloc = count;
+    }
+
+    count = 0;
+    for (n = node->children; n != NULL; n = n->next_sib) {
+        index->child[count].node = n;
+        index->child[count].y = y;
+        index->child[count].row = row;
+        n->position = count++;
+
+        y += n->height;
+        row += n->rows;
+    }
+
+    index->count = count;
+    index->generation = tree->generation;
+
+    return index;
+}
+
+
+/**
+ * Find the child of a node at an offset from the top of its first child
+ *
+ * \param[in]  tree   Treeview object node is in
+ * \param[in]  node   Node to find child of
+ * \param[in]  offset Offset from the top of node's first child
+ * \param[out] y      Updated to the offset of the child's top
+ * \param[out] row    Updated to the number of rows before the child
+ * \return the child, or NULL if offset is beyond node's children
+ */
+static treeview_node *treeview__child_at(treeview *tree, treeview_node *node, int offset, int *y, int *row)
+{
+    struct treeview_child_index *index;
+    treeview_node *n;
+    unsigned int lo, hi, mid;
+
+    index = treeview__child_index(tree, node);
+    if (index == NULL) {
+        *y = 0;
+        *row = 0;
+        for (n = node->children; n != NULL; n = n->next_sib) {
+            if (offset < *y + n->height) {
+                return n;
+            }
+            *y += n->height;
+            *row += n->rows;
+        }
+        return NULL;
+    }
+
+    /* Find the last child starting at or above offset */
+    lo = 0;
+    hi = index->count;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (index->child[mid].y <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    n = index->child[lo].node;
+    if (offset >= index->child[lo].y + n->height) {
+        return NULL;
+    }
+
+    *y = index->child[lo].y;
+    *row = index->child[lo].row;
+    return n;
+}
+
+
+/**
+ * Find the row at an offset from the top of a treeview's first row
+ *
+ * \param[in]  tree   Treeview object
+ * \param[in]  offset Offset from the top of the first row
+ * \param[out] y      Updated to the offset of the row's top
+ * \param[out] row    Updated to the number of rows before the row
+ * \return node for the row, or NULL if there's no row at offset
+ */
+static treeview_node *treeview__row_at(treeview *tree, int offset, int *y, int *row)
+{
+    treeview_node *n = tree->root;
+    treeview_node *child;
+    int child_y;
+    int child_row;
+    int h;
+
+    *y = 0;
+    *row = 0;
+
+    if (offset < 0) {
+        return NULL;
+    }
+
+    while ((n->flags & TV_NFLAGS_EXPANDED) && n->children != NULL) {
+        child = treeview__child_at(tree, n, offset - *y, &child_y, &child_row);
+        if (child == NULL) {
+            return NULL;
+        }
+        *y += child_y;
+        *row += child_row;
+
+        h = (child->type == TREE_NODE_ENTRY) ? child->height : tree_g.line_height;
+        if (offset < *y + h) {
+            return child;
+        }
+
+        /* In child's descendants */
+        *y += h;
+        *row += 1;
+        n = child;
+    }
+
+    return NULL;
+}
+
+
 /**
  * Find node at given y-position
  *
@@ -502,24 +769,13 @@ static inline treeview_node *treeview_node_next(treeview_node *node, bool full)
  */
 static treeview_node *treeview_y_node(treeview *tree, int target_y)
 {
-    int y = treeview__get_search_height(tree);
-    treeview_node *n;
+    int y;
+    int row;
 
     assert(tree != NULL);
     assert(tree->root != NULL);
 
-    n = treeview_node_next(tree->root, false);
-
-    while (n != NULL) {
-        int h = (n->type == TREE_NODE_ENTRY) ? n->height : tree_g.line_height;
-        if (target_y >= y && target_y < y + h)
-            return n;
-        y += h;
-
-        n = treeview_node_next(n, false);
-    }
-
-    return NULL;
+    return treeview__row_at(tree, target_y - treeview__get_search_height(tree), &y, &row);
 }
 
 
@@ -528,25 +784,52 @@ static treeview_node *treeview_y_node(treeview *tree, int target_y)
  *
  * \param tree Treeview object to delete node from
  * \param node Node to get position of
- * \return node's y position
+ * \return node's y position, or the bottom of the tree if node isn't shown
  */
-static int treeview_node_y(const treeview *tree, const treeview_node *node)
+static int treeview_node_y(treeview *tree, const treeview_node *node)
 {
-    treeview_node *n;
-    int y = treeview__get_search_height(tree);
+    struct treeview_child_index *index;
+    const treeview_node *n;
+    int bottom;
+    int y = 0;
 
     assert(tree != NULL);
     assert(tree->root != NULL);
 
-    n = treeview_node_next(tree->root, false);
+    bottom = treeview__get_search_height(tree) + tree->root->height;
 
-    while (n != NULL && n != node) {
-        y += (n->type == TREE_NODE_ENTRY) ? n->height : tree_g.line_height;
+    if (node == NULL || node == tree->root) {
+        return bottom;
+    }
 
-        n = treeview_node_next(n, false);
+    for (n = node; n->parent != NULL; n = n->parent) {
+        if (!(n->parent->flags & TV_NFLAGS_EXPANDED)) {
+            return bottom;
+        }
+
+        /* Offset from first sibling */
+        index = treeview__child_index(tree, n->parent);
+        if (index != NULL) {
+            y += index->child[n->position].y;
+        } else {
+            const treeview_node *sib;
+            for (sib = n->prev_sib; sib != NULL; sib = sib->prev_sib) {
+                y += sib->height;
+            }
+        }
+
+        if (n->parent->parent != NULL) {
+            /* Parent's own row */
+            y += tree_g.line_height;
+        }
     }
 
-    return y;
+    if (n != tree->root) {
+        /* Not in the tree */
+        return bottom;
+    }
+
+    return treeview__get_search_height(tree) + y;
 }
 
 
@@ -556,7 +839,7 @@ static int treeview_node_y(const treeview *tree, const treeview_node *node)
  * \param[in] tree  The treeview to scroll.
  * \param[in] node  The treeview node to scroll to visibility.
  */
-static inline void treeview__cw_scroll_to_node(const struct treeview *tree, const struct treeview_node *node)
+static inline void treeview__cw_scroll_to_node(struct treeview *tree, const struct treeview_node *node)
 {
     struct rect r = {
         .x0 = 0,
@@ -577,7 +860,7 @@ static inline void treeview__cw_scroll_to_node(const struct treeview *tree, cons
  * \param[in] tree  Tree to redraw from node in.
  * \param[in] node  Node to redraw from.
  */
-static void treeview__redraw_from_node(const treeview *tree, const treeview_node *node)
+static void treeview__redraw_from_node(treeview *tree, const treeview_node *node)
 {
     struct rect r = {
         .x0 = 0,
@@ -732,6 +1015,296 @@ static nserror treeview_walk_internal(treeview *tree, treeview_node *root, enum
 }
 
 
+/**
+ * Have the client create the children of deferred folders
+ *
+ * \param tree  Treeview object
+ * \param node  Node to populate, along with any folders below it
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror treeview__populate(treeview *tree, treeview_node *node)
+{
+    struct treeview_node_msg msg;
+    treeview_node *child;
+    bool populating;
+    nserror err;
+
+    if (tree->deferred == 0) {
+        return NSERROR_OK;
+    }
+
+    if (node->flags & TV_NFLAGS_DEFERRED) {
+        node->flags &= ~TV_NFLAGS_DEFERRED;
+        tree->deferred--;
+
+        msg.msg = TREE_MSG_NODE_POPULATE;
+
+        populating = tree->populating;
+        tree->populating = true;
+        err = tree->callbacks->folder(msg, node->client_data);
+        tree->populating = populating;
+        if (err != NSERROR_OK) {
+            return err;
+        }
+    }
+
+    for (child = node->children; child != NULL; child = child->next_sib) {
+        if (child->type == TREE_NODE_FOLDER) {
+            err = treeview__populate(tree, child);
+            if (err != NSERROR_OK) {
+                return err;
+            }
+        }
+    }
+
+    return NSERROR_OK;
+}
+
+
+/**
+ * Get the search index bucket for a trigram
+ *
+ * Case is folded the same way as strcasestr does it.
+ *
+ * \param t Text of trigram
+ * \return the bucket number
+ */
+static inline uint32_t treeview__search_bucket(const char *t)
+{
+    uint32_t h = ((uint32_t)tolower((unsigned char)t[0]) << 16) | ((uint32_t)tolower((unsigned char)t[1]) << 8) |
+        (uint32_t)tolower((unsigned char)t[2]);
+
+    return ((h * 2654435761u) >> 16) % TREEVIEW_SEARCH_BUCKETS;
+}
+
+
+/**
+ * Add the trigrams of some text to a search index
+ *
+ * \param index Search index
+ * \param id    Id of the entry the text belongs to
+ * \param text  The text, or NULL
+ * \param len   Byte length of text
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror
+treeview__search_index_text(struct treeview_search_index *index, uint32_t id, const char *text, size_t len)
+{
+    struct treeview_search_bucket *b;
+    uint32_t *ids;
+    uint32_t alloc;
+    size_t i;
+
+    if (text == NULL) {
+        return NSERROR_OK;
+    }
+
+    for (i = 0; i + 3 <= len; i++) {
+        b = &index->bucket[treeview__search_bucket(text + i)];
+        if (b->last == id) {
+            /* Entry already in bucket */
+            continue;
+        }
+
+        if (b->count == b->alloc) {
+            alloc = (b->alloc == 0) ? 8 : b->alloc * 2;
+            ids = realloc(b->id, alloc * sizeof(*ids));
+            if (ids == NULL) {
+                return NSERROR_NOMEM;
+            }
+            b->id = ids;
+            b->alloc = alloc;
+        }
+
+        b->id[b->count++] = id;
+        b->last = id;
+
+        index->id[id].postings++;
+        index->live++;
+    }
+
+    return NSERROR_OK;
+}
+
+
+/**
+ * Add an entry to a treeview's search index
+ *
+ * \param tree Treeview with a search index
+ * \param e    Entry to add
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror treeview__search_index_add(treeview *tree, struct treeview_node_entry *e)
+{
+    struct treeview_search_index *index = tree->search.index;
+    struct treeview_search_id *ids;
+    uint32_t *matched;
+    uint32_t alloc;
+    uint32_t id;
+    nserror err;
+    int i;
+
+    if (index->count == index->alloc) {
+        alloc = index->alloc * 2;
+
+        ids = realloc(index->id, alloc * sizeof(*ids));
+        if (ids == NULL) {
+            return NSERROR_NOMEM;
+        }
+        index->id = ids;
+
+        matched = realloc(index->matched, alloc * sizeof(*matched));
+        if (matched == NULL) {
+            return NSERROR_NOMEM;
+        }
+        index->matched = matched;
+
+        index->alloc = alloc;
+    }
+
+    id = index->count++;
+    index->id[id].entry = e;
+    index->id[id].postings = 0;
+    e->search_id = id;
+
+    /* An updated entry keeps its match until the next search */
+    if (e->base.flags & TV_NFLAGS_MATCHED) {
+        index->matched[index->n_matched++] = id;
+    }
+
+    err = treeview__search_index_text(index, id, e->base.text.data, e->base.text.len);
+
+    for (i = 0; err == NSERROR_OK && i < tree->n_fields - 1; i++) {
+        if (tree->fields[i + 1].flags & TREE_FLAG_SEARCHABLE) {
+            err = treeview__search_index_text(index, id, e->fields[i].value.data, e->fields[i].value.len);
+        }
+    }
+
+    return err;
+}
+
+
+/**
+ * Remove an entry from a treeview's search index, if it has one
+ *
+ * \param tree Treeview entry is in
+ * \param e    Entry to remove
+ */
+static void treeview__search_index_remove(treeview *tree, struct treeview_node_entry *e)
+{
+    struct treeview_search_index *index = tree->search.index;
+    struct treeview_search_id *id;
+
+    if (index == NULL || e->search_id == 0) {
+        return;
+    }
+
+    id = &index->id[e->search_id];
+    id->entry = NULL;
+    index->live -= id->postings;
+    index->stale += id->postings;
+
+    e->search_id = 0;
+}
+
+
+/**
+ * Destroy a treeview's search index, if it has one
+ *
+ * \param tree Treeview to destroy search index of
+ */
+static void treeview__search_index_destroy(treeview *tree)
+{
+    struct treeview_search_index *index = tree->search.index;
+    uint32_t i;
+
+    if (index == NULL) {
+        return;
+    }
+
+    for (i = 1; i < index->count; i++) {
+        if (index->id[i].entry != NULL) {
+            index->id[i].entry->search_id = 0;
+        }
+    }
+
+    for (i = 0; i < TREEVIEW_SEARCH_BUCKETS; i++) {
+        free(index->bucket[i].id);
+    }
+
+    free(index->id);
+    free(index->matched);
+    free(index);
+
+    tree->search.index = NULL;
+}
+
+
+/**
+ * Treewalk node callback for building a search index.
+ *
+ * \param[in]     n              Current node.
+ * \param[in]     ctx            Treeview being indexed.
+ * \param[in,out] skip_children  Flag to allow children to be skipped.
+ * \param[in,out] end            Flag to allow iteration to be finished early.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror treeview__search_index_build_cb(treeview_node *n, void *ctx, bool *skip_children, bool *end)
+{
+    treeview *tree = ctx;
+
+    if (n->type != TREE_NODE_ENTRY) {
+        return NSERROR_OK;
+    }
+
+    /* Matches are tracked by the index from now on */
+    n->flags &= ~TV_NFLAGS_MATCHED;
+
+    return treeview__search_index_add(tree, (struct treeview_node_entry *)n);
+}
+
+
+/**
+ * Build a search index for a treeview
+ *
+ * \param tree Treeview to build search index for
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror treeview__search_index_build(treeview *tree)
+{
+    struct treeview_search_index *index;
+    nserror err;
+
+    index = calloc(1, sizeof(*index));
+    if (index == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    index->alloc = 64;
+    index->id = malloc(index->alloc * sizeof(*index->id));
+    index->matched = malloc(index->alloc * sizeof(*index->matched));
+    if (index->id == NULL || index->matched == NULL) {
+        free(index->id);
+        free(index->matched);
+        free(index);
+        return NSERROR_NOMEM;
+    }
+
+    /* Id 0 means not indexed */
+    index->count = 1;
+
+    tree->search.index = index;
+
+    err = treeview_walk_internal(
+        tree, tree->root, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE, NULL, treeview__search_index_build_cb, tree);
+    if (err != NSERROR_OK) {
+        treeview__search_index_destroy(tree);
+    }
+
+    return err;
+}
+
+
 /**
  * Data used when doing a treeview walk for search.
  */
@@ -743,6 +1316,35 @@ struct treeview_search_walk_data {
 };
 
 
+/**
+ * Check whether an entry matches a search
+ *
+ * \param[in] tree  Treeview entry is in.
+ * \param[in] n     Entry node.
+ * \param[in] text  String being searched for.
+ * \return true iff the entry's searchable text contains the string.
+ */
+static bool treeview__search_match(treeview *tree, treeview_node *n, const char *text)
+{
+    struct treeview_node_entry *entry = (struct treeview_node_entry *)n;
+
+    for (int i = 0; i < tree->n_fields - 1; i++) {
+        struct treeview_field *ef = &(tree->fields[i + 1]);
+        if (ef->flags & TREE_FLAG_SEARCHABLE) {
+            if (strcasestr(entry->fields[i].value.data, text) != NULL) {
+                return true;
+            }
+        }
+    }
+
+    if (strcasestr(n->text.data, text) != NULL) {
+        return true;
+    }
+
+    return false;
+}
+
+
 /**
  * Treewalk node callback for handling search.
  *
@@ -755,6 +1357,7 @@ struct treeview_search_walk_data {
 static nserror treeview__search_walk_cb(treeview_node *n, void *ctx, bool *skip_children, bool *end)
 {
     struct treeview_search_walk_data *sw = ctx;
+    struct treeview_search_index *index = sw->tree->search.index;
 
     /* only entry nodes can be searched */
     if (n->type != TREE_NODE_ENTRY) {
@@ -767,28 +1370,74 @@ static nserror treeview__search_walk_cb(treeview_node *n, void *ctx, bool *skip_
         return NSERROR_OK;
     }
 
-    struct treeview_node_entry *entry = (struct treeview_node_entry *)n;
-    bool matched = false;
+    if (treeview__search_match(sw->tree, n, sw->text)) {
+        n->flags |= TV_NFLAGS_MATCHED;
+        sw->window_height += n->height;
+        if (index != NULL) {
+            index->matched[index->n_matched++] = ((struct treeview_node_entry *)n)->search_id;
+        }
+    } else {
+        n->flags &= ~TV_NFLAGS_MATCHED;
+    }
 
-    for (int i = 0; i < sw->tree->n_fields; i++) {
-        struct treeview_field *ef = &(sw->tree->fields[i + 1]);
-        if (ef->flags & TREE_FLAG_SEARCHABLE) {
-            if (strcasestr(entry->fields[i].value.data, sw->text) != NULL) {
-                matched = true;
-                break;
-            }
+    return NSERROR_OK;
+}
+
+
+/**
+ * Search treeview for text, using its search index.
+ *
+ * \param[in]     tree  Treeview to search.
+ * \param[in,out] sw    Search details, updated with height of matches.
+ * \return NSERROR_OK on success, appropriate error otherwise.
+ */
+static nserror treeview__search_indexed(treeview *tree, struct treeview_search_walk_data *sw)
+{
+    struct treeview_search_index *index = tree->search.index;
+    struct treeview_search_bucket *b = NULL;
+    struct treeview_search_bucket *c;
+    struct treeview_search_id *id;
+    treeview_node *n;
+    uint32_t i;
+
+    /* Forget the last search's matches */
+    for (i = 0; i < index->n_matched; i++) {
+        id = &index->id[index->matched[i]];
+        if (id->entry != NULL) {
+            id->entry->base.flags &= ~TV_NFLAGS_MATCHED;
         }
     }
+    index->n_matched = 0;
 
-    if (!matched && strcasestr(n->text.data, sw->text) != NULL) {
-        matched = true;
+    if (sw->len == 0) {
+        return NSERROR_OK;
+
+    } else if (sw->len < 3) {
+        /* Too short for a trigram; check every entry */
+        return treeview_walk_internal(
+            tree, tree->root, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE, NULL, treeview__search_walk_cb, sw);
     }
 
-    if (matched) {
-        n->flags |= TV_NFLAGS_MATCHED;
-        sw->window_height += n->height;
-    } else {
-        n->flags &= ~TV_NFLAGS_MATCHED;
+    /* Only entries with the search string's rarest trigram can match */
+    for (i = 0; i + 3 <= sw->len; i++) {
+        c = &index->bucket[treeview__search_bucket(sw->text + i)];
+        if (b == NULL || c->count < b->count) {
+            b = c;
+        }
+    }
+
+    for (i = 0; i < b->count; i++) {
+        id = &index->id[b->id[i]];
+        if (id->entry == NULL) {
+            continue;
+        }
+
+        n = &id->entry->base;
+        if (treeview__search_match(tree, n, sw->text)) {
+            n->flags |= TV_NFLAGS_MATCHED;
+            sw->window_height += n->height;
+            index->matched[index->n_matched++] = b->id[i];
+        }
     }
 
     return NSERROR_OK;
@@ -827,8 +1476,28 @@ static nserror treeview__search(treeview *tree, const char *text, unsigned int l
         return NSERROR_OK;
     }
 
-    err = treeview_walk_internal(
-        tree, tree->root, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE, NULL, treeview__search_walk_cb, &sw);
+    /* Everything must exist to be searched */
+    err = treeview__populate(tree, tree->root);
+    if (err != NSERROR_OK) {
+        return err;
+    }
+
+    if (tree->search.index != NULL && tree->search.index->stale > tree->search.index->live) {
+        /* Mostly stale; start again */
+        treeview__search_index_destroy(tree);
+    }
+
+    if (tree->search.index == NULL) {
+        /* Without an index every entry is checked */
+        treeview__search_index_build(tree);
+    }
+
+    if (tree->search.index != NULL) {
+        err = treeview__search_indexed(tree, &sw);
+    } else {
+        err = treeview_walk_internal(
+            tree, tree->root, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE, NULL, treeview__search_walk_cb, &sw);
+    }
     if (err != NSERROR_OK) {
         return err;
     }
@@ -975,8 +1644,9 @@ static void treeview__search_update_display(treeview *tree)
     const char *string;
     unsigned int len;
 
-    if (tree->search.search == false) {
-        /* No active search to update view for. */
+    if (tree->search.search == false || tree->populating) {
+        /* No active search to update view for, or a folder is being
+         * populated and the search will be updated once it's done. */
         return;
     }
 
@@ -1008,7 +1678,9 @@ static nserror treeview_create_node_root(treeview_node **root)
     n->type = TREE_NODE_ROOT;
 
     n->height = 0;
+    n->rows = 0;
     n->inset = tree_g.window_padding - tree_g.step_width;
+    n->position = 0;
 
     n->text.data = NULL;
     n->text.len = 0;
@@ -1018,6 +1690,7 @@ static nserror treeview_create_node_root(treeview_node **root)
     n->next_sib = NULL;
     n->prev_sib = NULL;
     n->children = NULL;
+    n->index = NULL;
 
     n->client_data = NULL;
 
@@ -1089,6 +1762,8 @@ treeview_insert_node(treeview *tree, treeview_node *a, treeview_node *b, enum tr
 
     assert(a->parent != NULL);
 
+    tree->generation++;
+
     a->inset = a->parent->inset + tree_g.step_width;
     if (a->children != NULL) {
         treeview_walk_internal(
@@ -1097,16 +1772,17 @@ treeview_insert_node(treeview *tree, treeview_node *a, treeview_node *b, enum tr
 
     if (a->parent->flags & TV_NFLAGS_EXPANDED) {
         int height = a->height;
+        int rows = a->rows;
         /* Parent is expanded, so inserted node will be visible and
          * affect layout */
         if (a->text.width == 0) {
             guit->layout->width(&plot_style_odd.text, a->text.data, a->text.len, &(a->text.width));
         }
 
-        do {
-            a->parent->height += height;
-            a = a->parent;
-        } while (a->parent != NULL);
+        for (a = a->parent; a != NULL && (a->flags & TV_NFLAGS_EXPANDED); a = a->parent) {
+            a->height += height;
+            a->rows += rows;
+        }
     }
 }
 
@@ -1135,7 +1811,14 @@ nserror treeview_create_node_folder(treeview *tree, treeview_node **folder, tree
     n->flags = (flags & TREE_OPTION_SPECIAL_DIR) ? TV_NFLAGS_SPECIAL : TV_NFLAGS_NONE;
     n->type = TREE_NODE_FOLDER;
 
+    if (flags & TREE_OPTION_DEFERRED_DIR) {
+        n->flags |= TV_NFLAGS_DEFERRED;
+        tree->deferred++;
+    }
+
     n->height = tree_g.line_height;
+    n->rows = 1;
+    n->position = 0;
 
     n->text.data = field->value;
     n->text.len = field->value_len;
@@ -1145,6 +1828,7 @@ nserror treeview_create_node_folder(treeview *tree, treeview_node **folder, tree
     n->next_sib = NULL;
     n->prev_sib = NULL;
     n->children = NULL;
+    n->index = NULL;
 
     n->client_data = data;
 
@@ -1259,6 +1943,14 @@ treeview_update_node_entry(treeview *tree, treeview_node *entry, const struct tr
         }
     }
 
+    if (tree->search.index != NULL) {
+        /* Index the new text */
+        treeview__search_index_remove(tree, e);
+        if (treeview__search_index_add(tree, e) != NSERROR_OK) {
+            treeview__search_index_destroy(tree);
+        }
+    }
+
     treeview__search_update_display(tree);
 
     /* Redraw */
@@ -1304,8 +1996,11 @@ nserror treeview_create_node_entry(treeview *tree, treeview_node **entry, treevi
 
     n->flags = TV_NFLAGS_NONE;
     n->type = TREE_NODE_ENTRY;
+    e->search_id = 0;
 
     n->height = tree_g.line_height;
+    n->rows = 1;
+    n->position = 0;
 
     assert(fields != NULL);
     assert(fields[0].field != NULL);
@@ -1318,6 +2013,7 @@ nserror treeview_create_node_entry(treeview *tree, treeview_node **entry, treevi
     n->next_sib = NULL;
     n->prev_sib = NULL;
     n->children = NULL;
+    n->index = NULL;
 
     n->client_data = data;
 
@@ -1332,6 +2028,11 @@ nserror treeview_create_node_entry(treeview *tree, treeview_node **entry, treevi
 
     treeview_insert_node(tree, n, relation, rel);
 
+    if (tree->search.index != NULL && treeview__search_index_add(tree, e) != NSERROR_OK) {
+        /* Searches will check every entry until it's rebuilt */
+        treeview__search_index_destroy(tree);
+    }
+
     if (n->parent->flags & TV_NFLAGS_EXPANDED) {
         /* Inform front end of change in dimensions */
         if (!(flags & TREE_OPTION_SUPPRESS_RESIZE))
@@ -1411,6 +2112,7 @@ nserror treeview_walk(treeview *tree, treeview_node *root, treeview_walk_cb ente
     void *ctx, enum treeview_node_type type)
 {
     struct treeview_walk_ctx tw = {.enter_cb = enter_cb, .leave_cb = leave_cb, .ctx = ctx, .type = type};
+    nserror err;
 
     assert(tree != NULL);
     assert(tree->root != NULL);
@@ -1418,6 +2120,12 @@ nserror treeview_walk(treeview *tree, treeview_node *root, treeview_walk_cb ente
     if (root == NULL)
         root = tree->root;
 
+    err = treeview__populate(tree, root);
+    if (err != NSERROR_OK) {
+        return err;
+    }
+    treeview__search_update_display(tree);
+
     return treeview_walk_internal(tree, root, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE,
         (leave_cb != NULL) ? treeview_walk_bwd_cb : NULL, (enter_cb != NULL) ? treeview_walk_fwd_cb : NULL, &tw);
 }
@@ -1426,11 +2134,14 @@ nserror treeview_walk(treeview *tree, treeview_node *root, treeview_walk_cb ente
 /**
  * Unlink a treeview node
  *
+ * \param tree Treeview object node is in
  * \param n Node to unlink
  * \return true iff ancestor heights need to be reduced
  */
-static inline bool treeview_unlink_node(treeview_node *n)
+static inline bool treeview_unlink_node(treeview *tree, treeview_node *n)
 {
+    tree->generation++;
+
     /* Unlink node from tree */
     if (n->parent != NULL && n->parent->children == n) {
         /* Node is a first child */
@@ -1555,6 +2266,7 @@ static void treeview_edit_done(treeview *tree)
 struct treeview_node_delete {
     treeview *tree;
     int h_reduction;
+    int r_reduction;
     bool user_interaction;
 };
 
@@ -1572,12 +2284,18 @@ static nserror treeview_delete_node_walk_cb(treeview_node *n, void *ctx, bool *e
 
     assert(n->children == NULL);
 
-    if (treeview_unlink_node(n))
+    if (treeview_unlink_node(nd->tree, n)) {
         nd->h_reduction += (n->type == TREE_NODE_ENTRY) ? n->height : tree_g.line_height;
+        nd->r_reduction++;
+    }
+
+    if (n->flags & TV_NFLAGS_DEFERRED)
+        nd->tree->deferred--;
 
     /* Handle any special treatment */
     switch (n->type) {
     case TREE_NODE_ENTRY:
+        treeview__search_index_remove(nd->tree, (struct treeview_node_entry *)n);
         nd->tree->callbacks->entry(msg, n->client_data);
         break;
 
@@ -1598,6 +2316,7 @@ static nserror treeview_delete_node_walk_cb(treeview_node *n, void *ctx, bool *e
     }
 
     /* Free the node */
+    treeview__child_index_destroy(n);
     free(n);
 
     return NSERROR_OK;
@@ -1626,12 +2345,31 @@ treeview_delete_node_internal(treeview *tree, treeview_node *n, bool interaction
 {
     nserror err;
     treeview_node *p = n->parent;
-    struct treeview_node_delete nd = {.tree = tree, .h_reduction = 0, .user_interaction = interaction};
+    int h;
+    int rows;
+    struct treeview_node_delete nd = {
+        .tree = tree, .h_reduction = 0, .r_reduction = 0, .user_interaction = interaction};
 
     if (interaction && (tree->flags & TREEVIEW_NO_DELETES)) {
         return NSERROR_OK;
     }
 
+    /* Clients keep track of a deferred folder's contents through its
+     * children, so create them to have them deleted too.  The root is
+     * only deleted when the treeview is destroyed, which is left to the
+     * client to tidy up after. */
+    if (n != tree->root) {
+        err = treeview__populate(tree, n);
+        if (err != NSERROR_OK) {
+            return err;
+        }
+    }
+
+    /* Expanded descendants of a contracted folder were never counted in
+     * its height, so take what the node contributes to its ancestors */
+    h = n->height;
+    rows = n->rows;
+
     /* Delete any children first */
     err = treeview_walk_internal(tree, n, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE, treeview_delete_node_walk_cb, NULL, &nd);
     if (err != NSERROR_OK) {
@@ -1649,12 +2387,13 @@ treeview_delete_node_internal(treeview *tree, treeview_node *n, bool interaction
     n = p;
     /* Reduce ancestor heights */
     while (n != NULL && n->flags & TV_NFLAGS_EXPANDED) {
-        n->height -= nd.h_reduction;
+        n->height -= h;
+        n->rows -= rows;
         n = n->parent;
     }
 
     /* Inform front end of change in dimensions */
-    if (tree->root != NULL && p != NULL && p->flags & TV_NFLAGS_EXPANDED && nd.h_reduction > 0 &&
+    if (tree->root != NULL && p != NULL && p->flags & TV_NFLAGS_EXPANDED && h > 0 &&
         !(flags & TREE_OPTION_SUPPRESS_RESIZE)) {
         treeview__cw_update_size(tree, -1, tree->root->height);
     }
@@ -1681,7 +2420,8 @@ static nserror treeview_delete_empty_nodes(treeview *tree, bool interaction)
     treeview_node *node, *child, *parent, *next_sibling, *p;
     bool abort = false;
     nserror err;
-    struct treeview_node_delete nd = {.tree = tree, .h_reduction = 0, .user_interaction = interaction};
+    struct treeview_node_delete nd = {
+        .tree = tree, .h_reduction = 0, .r_reduction = 0, .user_interaction = interaction};
 
     assert(tree != NULL);
     assert(tree->root != NULL);
@@ -1702,7 +2442,7 @@ static nserror treeview_delete_empty_nodes(treeview *tree, bool interaction)
              * with a next sibling. */
 
             while (node->parent != NULL && next_sibling == NULL) {
-                if (node->type == TREE_NODE_FOLDER && node->children == NULL) {
+                if (node->type == TREE_NODE_FOLDER && node->children == NULL && !(node->flags & TV_NFLAGS_DEFERRED)) {
                     /* Delete node */
                     p = node->parent;
                     err = treeview_delete_node_walk_cb(node, &nd, &abort);
@@ -1713,9 +2453,11 @@ static nserror treeview_delete_empty_nodes(treeview *tree, bool interaction)
                     /* Reduce ancestor heights */
                     while (p != NULL && p->flags & TV_NFLAGS_EXPANDED) {
                         p->height -= nd.h_reduction;
+                        p->rows -= nd.r_reduction;
                         p = p->parent;
                     }
                     nd.h_reduction = 0;
+                    nd.r_reduction = 0;
                 }
                 node = parent;
                 parent = node->parent;
@@ -1725,7 +2467,7 @@ static nserror treeview_delete_empty_nodes(treeview *tree, bool interaction)
             if (node->parent == NULL)
                 break;
 
-            if (node->type == TREE_NODE_FOLDER && node->children == NULL) {
+            if (node->type == TREE_NODE_FOLDER && node->children == NULL && !(node->flags & TV_NFLAGS_DEFERRED)) {
                 /* Delete node */
                 p = node->parent;
                 err = treeview_delete_node_walk_cb(node, &nd, &abort);
@@ -1736,9 +2478,11 @@ static nserror treeview_delete_empty_nodes(treeview *tree, bool interaction)
                 /* Reduce ancestor heights */
                 while (p != NULL && p->flags & TV_NFLAGS_EXPANDED) {
                     p->height -= nd.h_reduction;
+                    p->rows -= nd.r_reduction;
                     p = p->parent;
                 }
                 nd.h_reduction = 0;
+                nd.r_reduction = 0;
             }
             node = next_sibling;
         }
@@ -1916,6 +2660,13 @@ nserror treeview_create(treeview **treeout, const struct treeview_callback_table
     tree->edit.textarea = NULL;
     tree->edit.node = NULL;
 
+    tree->generation = 1;
+
+    tree->deferred = 0;
+    tree->populating = false;
+
+    tree->search.index = NULL;
+
     if (flags & TREEVIEW_SEARCHABLE) {
         tree->search.textarea = treeview__create_textarea(tree, 600, tree_g.line_height,
             nscolours[NSCOLOUR_TEXT_INPUT_BG], nscolours[NSCOLOUR_TEXT_INPUT_BG], nscolours[NSCOLOUR_TEXT_INPUT_FG],
@@ -1978,6 +2729,7 @@ nserror treeview_destroy(treeview *tree)
         tree->search.search = false;
         textarea_destroy(tree->search.textarea);
     }
+    treeview__search_index_destroy(tree);
 
     /* Destroy nodes */
     treeview_delete_node_internal(tree, tree->root, false, TREE_OPTION_SUPPRESS_RESIZE | TREE_OPTION_SUPPRESS_REDRAW);
@@ -2008,6 +2760,8 @@ static nserror treeview_node_expand_internal(treeview *tree, treeview_node *node
     struct treeview_node_entry *e;
     int additional_height_folders = 0;
     int additional_height_entries = 0;
+    int additional_rows = 0;
+    nserror err;
     int i;
 
     assert(tree != NULL);
@@ -2021,6 +2775,11 @@ static nserror treeview_node_expand_internal(treeview *tree, treeview_node *node
 
     switch (node->type) {
     case TREE_NODE_FOLDER:
+        err = treeview__populate(tree, node);
+        if (err != NSERROR_OK) {
+            return err;
+        }
+
         child = node->children;
         if (child == NULL) {
             /* Allow expansion of empty folders */
@@ -2033,6 +2792,7 @@ static nserror treeview_node_expand_internal(treeview *tree, treeview_node *node
             }
 
             additional_height_folders += child->height;
+            additional_rows += child->rows;
 
             child = child->next_sib;
         } while (child != NULL);
@@ -2066,10 +2826,12 @@ static nserror treeview_node_expand_internal(treeview *tree, treeview_node *node
 
     /* Update the node */
     node->flags |= TV_NFLAGS_EXPANDED;
+    tree->generation++;
 
     /* And node heights */
     for (struct treeview_node *n = node; (n != NULL) && (n->flags & TV_NFLAGS_EXPANDED); n = n->parent) {
         n->height += additional_height_entries + additional_height_folders;
+        n->rows += additional_rows;
     }
 
     if (tree->search.search && node->type == TREE_NODE_ENTRY && node->flags & TV_NFLAGS_MATCHED) {
@@ -2124,6 +2886,7 @@ static nserror treeview_node_contract_cb(treeview_node *n, void *ctx, bool *end)
     struct treeview_contract_data *data = ctx;
     int h_reduction_folder = 0;
     int h_reduction_entry = 0;
+    int r_reduction = 0;
 
     assert(n != NULL);
     assert(n->type != TREE_NODE_ROOT);
@@ -2139,6 +2902,7 @@ static nserror treeview_node_contract_cb(treeview_node *n, void *ctx, bool *end)
     switch (n->type) {
     case TREE_NODE_FOLDER:
         h_reduction_folder = n->height - tree_g.line_height;
+        r_reduction = n->rows - 1;
         break;
 
     case TREE_NODE_ENTRY:
@@ -2153,7 +2917,9 @@ static nserror treeview_node_contract_cb(treeview_node *n, void *ctx, bool *end)
     assert(h_reduction_folder + h_reduction_entry >= 0);
     for (struct treeview_node *node = n; (node != NULL) && (node->flags & TV_NFLAGS_EXPANDED); node = node->parent) {
         node->height -= h_reduction_folder + h_reduction_entry;
+        node->rows -= r_reduction;
     }
+    data->tree->generation++;
 
     if (data->tree->search.search) {
         data->tree->search.height -= h_reduction_entry;
@@ -2320,6 +3086,13 @@ nserror treeview_expand(treeview *tree, bool only_folders)
     data.tree = tree;
     data.only_folders = only_folders;
 
+    /* The walk doesn't see children created as it expands folders */
+    res = treeview__populate(tree, tree->root);
+    if (res != NSERROR_OK) {
+        return res;
+    }
+    treeview__search_update_display(tree);
+
     res = treeview_walk_internal(
         tree, tree->root, TREEVIEW_WALK_MODE_LOGICAL_COMPLETE, NULL, treeview_expand_cb, &data);
     if (res == NSERROR_OK) {
@@ -2354,14 +3127,15 @@ static void treeview_redraw_tree(treeview *tree, const int x, const int y, int *
     enum treeview_resource_id res = TREE_RES_CONTENT;
     int baseline = (tree_g.line_height * 3 + 2) / 4;
     plot_font_style_t *infotext_style;
-    treeview_node *root = tree->root;
-    treeview_node *node = tree->root;
+    treeview_node *node;
     int render_y = *render_y_in_out;
     plot_font_style_t *text_style;
     plot_style_t *bg_style;
     int sel_min, sel_max;
     uint32_t count = 0;
     struct rect rect;
+    int node_y;
+    int row;
     int inset;
     int x0;
 
@@ -2373,36 +3147,25 @@ static void treeview_redraw_tree(treeview *tree, const int x, const int y, int *
         sel_max = tree->drag.prev.y;
     }
 
-    while (node != NULL) {
+    /* Start from the first row that reaches the clip region */
+    node = treeview__row_at(tree, r->y0 - 1 - render_y, &node_y, &row);
+    if (node != NULL) {
+        render_y += node_y;
+        count = row;
+    } else if (r->y0 - 1 < render_y) {
+        node = treeview_node_next(tree->root, false);
+    } else {
+        /* Everything is above clip region */
+        render_y += tree->root->height;
+    }
+
+    for (; node != NULL; node = treeview_node_next(node, false)) {
         struct treeview_node_entry *entry;
         struct bitmap *furniture;
         bool invert_selection;
-        treeview_node *next;
         int height;
         int i;
 
-        next = (node->flags & TV_NFLAGS_EXPANDED) ? node->children : NULL;
-
-        if (next != NULL) {
-            /* down to children */
-            node = next;
-        } else {
-            /* No children.  As long as we're not at the root,
-             * go to next sibling if present, or nearest ancestor
-             * with a next sibling. */
-
-            while (node != root && node->next_sib == NULL) {
-                node = node->parent;
-            }
-
-            if (node == root)
-                break;
-
-            node = node->next_sib;
-        }
-
-        assert(node != NULL);
-        assert(node != root);
         assert(node->type == TREE_NODE_FOLDER || node->type == TREE_NODE_ENTRY);
 
         count++;
@@ -2918,17 +3681,21 @@ static nserror treeview_node_selection_walk_cb(treeview_node *n, void *ctx, bool
         if (n->flags & TV_NFLAGS_SELECTED) {
             treeview_node *p = n->parent;
             int h = 0;
+            int rows = 0;
 
             if (n == sw->data.yank.fixed) {
                 break;
             }
 
-            if (treeview_unlink_node(n))
+            if (treeview_unlink_node(sw->tree, n)) {
                 h = n->height;
+                rows = n->rows;
+            }
 
             /* Reduce ancestor heights */
             while (p != NULL && p->flags & TV_NFLAGS_EXPANDED) {
                 p->height -= h;
+                p->rows -= rows;
                 p = p->parent;
             }
             if (sw->data.yank.prev == NULL) {
@@ -61,7 +61,8 @@ typedef enum {
     TREE_OPTION_NONE = (0), /* No flags set */
     TREE_OPTION_SPECIAL_DIR = (1 << 0), /* Special folder */
     TREE_OPTION_SUPPRESS_RESIZE = (1 << 1), /* Suppress callback */
-    TREE_OPTION_SUPPRESS_REDRAW = (1 << 2) /* Suppress callback */
+    TREE_OPTION_SUPPRESS_REDRAW = (1 << 2), /* Suppress callback */
+    TREE_OPTION_DEFERRED_DIR = (1 << 3) /* Folder populated on demand */
 } treeview_node_options_flags;
 
 /**
@@ -82,7 +83,8 @@ typedef enum {
 enum treeview_msg {
     TREE_MSG_NODE_DELETE, /**< Node to be deleted */
     TREE_MSG_NODE_EDIT, /**< Node to be edited */
-    TREE_MSG_NODE_LAUNCH /**< Node to be launched */
+    TREE_MSG_NODE_LAUNCH, /**< Node to be launched */
+    TREE_MSG_NODE_POPULATE /**< Folder's children to be created */
 };
 
 
@@ -213,6 +215,8 @@ nserror treeview_cw_detach(treeview *tree);
  * Destroy a treeview object
  *
  * Will emit folder and entry deletion msg callbacks for all nodes in treeview.
+ * Folders created with TREE_OPTION_DEFERRED_DIR that were never populated are
+ * not populated first, so their clients must free any entries held back.
  *
  * \param tree Treeview object to destroy
  * \return NSERROR_OK on success, appropriate error otherwise
@@ -255,6 +259,12 @@ treeview_get_relation(treeview *tree, treeview_node **relation, enum treeview_re
  * Field name must match name past in treeview_create fields[N-1].
  *
  * If relation is NULL, will insert as child of root node.
+ *
+ * If flags has TREE_OPTION_DEFERRED_DIR set, the folder's contents are not
+ * created up front.  The folder callback gets a TREE_MSG_NODE_POPULATE
+ * message the first time the children are needed, for example when the
+ * folder is expanded, searched, walked or deleted, and should create them
+ * then.
  */
 nserror treeview_create_node_folder(treeview *tree, treeview_node **folder, treeview_node *relation,
     enum treeview_relationship rel, const struct treeview_field_data *field, void *data,
@@ -334,6 +344,8 @@ typedef nserror (*treeview_walk_cb)(void *ctx, void *node_data, enum treeview_no
  * Note, if deleting returned node in enter_cb, the walk must be terminated by
  * setting abort to true.
  *
+ * Any deferred folders under root are populated before the walk starts.
+ *
  * \param tree		Treeview object to walk
  * \param root		Root node to walk tree from (or NULL for tree root)
  * \param enter_cb	Function to call on entering nodes, or NULL
@@ -32,6 +32,7 @@
 #include <wisp/ns_inttypes.h>
 #include <wisp/utils/config.h>
 #include <wisp/utils/corestrings.h>
+#include <wisp/utils/file.h>
 #include <wisp/utils/log.h>
 #include <wisp/utils/messages.h>
 #include <wisp/utils/nsoption.h>
@@ -39,6 +40,7 @@
 #include <wisp/utils/utf8.h>
 #include <utils/errors.h>
 #include "utils/nscolour.h"
+#include "utils/trace.h"
 #include "utils/useragent.h"
 #include "content/content_factory.h"
 #include "content/fetchers.h"
@@ -56,6 +58,7 @@
 #include <wisp/desktop/searchweb.h>
 #include <wisp/misc.h>
 #include <wisp/wisp.h>
+#include "desktop/measure_cache.h"
 #include "desktop/system_colour.h"
 
 
@@ -133,6 +136,7 @@ nserror wisp_init(const char *store_path)
 #endif
 
     NSLOG(wisp, INFO, "wisp_init: start");
+    TRACE_THREAD_NAME("main");
     /* corestrings init */
     NSLOG(wisp, INFO, "init corestrings");
     ret = corestrings_init();
@@ -167,6 +171,9 @@ nserror wisp_init(const char *store_path)
         NSLOG(wisp, INFO, "Setting minimum memory cache size %" PRIsizet, hlcache_parameters.llcache.limit);
     }
 
+    /* keep unused pages for history navigation */
+    hlcache_parameters.retain_limit = nsoption_uint(retained_content_size);
+
     /* Set up the max attempts made to fetch a timing out resource */
     hlcache_parameters.llcache.fetch_attempts = nsoption_uint(max_retried_fetches);
 
@@ -198,6 +205,13 @@ nserror wisp_init(const char *store_path)
         return ret;
     }
 
+    /* text measurement cache */
+    ret = measure_cache_init();
+    if (ret != NSERROR_OK) {
+        NSLOG(wisp, ERROR, "measure_cache_init failed (%s)", messages_get_errorcode(ret));
+        return ret;
+    }
+
     /* content handler initialisation */
     NSLOG(wisp, INFO, "init CSS");
     ret = nscss_init();
@@ -229,6 +243,16 @@ nserror wisp_init(const char *store_path)
 
     setlocale(LC_ALL, "");
 
+    /* keep the fetchers' network state alongside the backing store */
+    if (hlcache_parameters.llcache.store.path != NULL) {
+        char *state_path = NULL;
+
+        if (wisp_mkpath(&state_path, NULL, 2, hlcache_parameters.llcache.store.path, "NetworkState") ==
+            NSERROR_OK) {
+            nsoption_setnull_charp(network_state_file, state_path);
+        }
+    }
+
     /* initialise the fetchers */
     NSLOG(wisp, INFO, "init fetchers");
     ret = fetcher_init();
@@ -310,6 +334,8 @@ void wisp_exit(void)
     /* Clean up after content handlers */
     content_factory_fini();
 
+    measure_cache_fini();
+
     NSLOG(wisp, INFO, "Closing utf8");
     utf8_finalise();
 
@@ -331,5 +357,15 @@ void wisp_exit(void)
     lwc_iterate_strings(wisp_lwc_iterator, &lwc_count);
     NSLOG(wisp, INFO, "Remaining lwc strings count: %u", lwc_count);
 
+#ifdef WISP_TRACE_ENABLED
+    if (nsoption_charp(trace_file) != NULL) {
+        NSLOG(wisp, INFO, "Writing trace to %s", nsoption_charp(trace_file));
+        if (trace_dump(nsoption_charp(trace_file)) != NSERROR_OK) {
+            NSLOG(wisp, WARNING, "Unable to write trace to %s", nsoption_charp(trace_file));
+        }
+    }
+    trace_finalise();
+#endif
+
     NSLOG(wisp, INFO, "Exited successfully");
 }
@@ -0,0 +1,85 @@
+/*
+ * Box construction stubs for tests which select styles for elements the
+ * way box construction does, without building a box tree.
+ *
+ * Elements have no presentational hints, system colours are not known
+ * and no URL has been visited.  Messages are their keys.  The box tree,
+ * special element and object functions are never reached by style
+ * selection and fail if called, and there is no frontend.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libcss/libcss.h>
+#include <wisp/utils/errors.h>
+#include <wisp/content/handlers/html/box.h>
+#include <wisp/content/handlers/html/form_internal.h>
+#include <wisp/content/handlers/html/private.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/url_db.h>
+#include "content/handlers/css/hints.h"
+#include "content/handlers/html/box_manipulate.h"
+#include "content/handlers/html/box_normalise.h"
+#include "content/handlers/html/box_special.h"
+#include "content/handlers/html/object.h"
+#include "desktop/system_colour.h"
+
+static struct wisp_table stub_gui_table;
+struct wisp_table *guit = &stub_gui_table;
+
+const char *messages_get(const char *key)
+{
+    return key;
+}
+
+css_error node_presentational_hint(void *pw, void *node, uint32_t *nhints, css_hint **hints)
+{
+    *nhints = 0;
+    *hints = NULL;
+    return CSS_OK;
+}
+
+css_error ns_system_colour(void *pw, lwc_string *name, css_color *colour)
+{
+    return CSS_INVALID;
+}
+
+const struct url_data *urldb_get_url_data(struct nsurl *url)
+{
+    return NULL;
+}
+
+struct box *box_create(css_select_results *styles, css_computed_style *style, bool style_owned, struct nsurl *href,
+    const char *target, const char *title, lwc_string *id, void *context)
+{
+    return NULL;
+}
+
+void box_add_child(struct box *parent, struct box *child)
+{
+}
+
+void box_free(struct box *box)
+{
+}
+
+bool box_normalise_block(struct box *block, const struct box *root, struct html_content *c)
+{
+    return false;
+}
+
+bool convert_special_elements(dom_node *node, html_content *content, struct box *box, bool *convert_children)
+{
+    return false;
+}
+
+bool html_fetch_object(
+    struct html_content *c, struct nsurl *url, struct box *box, content_type permitted_types, bool background)
+{
+    return false;
+}
+
+void form_free_control(struct form_control *control)
+{
+}
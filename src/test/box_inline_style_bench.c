@@ -0,0 +1,289 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Style attribute cache benchmark.
+ *
+ * Selects styles for a document of elements with style attributes, as box
+ * construction does.  Attributes are drawn from a set of a few hundred,
+ * favouring some, as generated pages repeat them; every tenth element has
+ * an attribute of its own.  The same selections are run once with a fresh
+ * construction context per element, parsing every attribute as box
+ * construction did before the cache, and once through a single context.
+ * The time per thousand elements and the cache hit rate are reported.
+ * Pass the number of elements and distinct attributes to model other
+ * pages:
+ *
+ *   box_inline_style_bench 30000
+ *   box_inline_style_bench 30000 -styles 2000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "utils/corestrings.h"
+
+#include "content/handlers/html/box_construct.c"
+
+static html_content bench_html;
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+/**
+ * Read a monotonic clock in nanoseconds.
+ */
+static uint64_t bench_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static css_error bench_resolve_url(void *pw, const char *base, lwc_string *rel, lwc_string **abs)
+{
+    *abs = lwc_string_ref(rel);
+    return CSS_OK;
+}
+
+/**
+ * Drop what libcss kept of the elements' last selections, so that each run
+ * selects from scratch.
+ */
+static void bench_forget_selections(dom_element **elements, int count)
+{
+    /* only the version is looked at when node data is deleted */
+    static css_select_handler handler = {.handler_version = CSS_SELECT_HANDLER_VERSION_1};
+    int i;
+
+    for (i = 0; i < count; i++) {
+        void *data = NULL;
+
+        dom_node_set_user_data(elements[i], corestring_dom___ns_key_libcss_node_data, NULL, NULL, &data);
+        if (data != NULL) {
+            css_libcss_node_data_handler(&handler, CSS_NODE_DELETED, NULL, elements[i], NULL, data);
+        }
+    }
+}
+
+/**
+ * Create a document of elements with style attributes.
+ *
+ * \param elements Updated with the elements
+ * \param count Number of elements
+ * \param styles Number of distinct shared attributes
+ * \return The document, or NULL on failure
+ */
+static dom_document *bench_document_create(dom_element **elements, int count, int styles)
+{
+    unsigned int seed = 1;
+    dom_document *doc;
+    dom_element *root;
+    dom_string *tag;
+    dom_node *r;
+    char style[96];
+    int i;
+
+    if (dom_implementation_create_document(DOM_IMPLEMENTATION_HTML, NULL, NULL, NULL, NULL, NULL, &doc) !=
+            DOM_NO_ERR ||
+        dom_string_create((const uint8_t *)"html", 4, &tag) != DOM_NO_ERR) {
+        return NULL;
+    }
+    dom_document_create_element(doc, tag, &root);
+    dom_string_unref(tag);
+    dom_node_append_child(doc, root, &r);
+    dom_node_unref(r);
+
+    dom_string_create((const uint8_t *)"div", 3, &tag);
+    for (i = 0; i < count; i++) {
+        dom_string *value;
+        unsigned int j;
+
+        seed = seed * 1103515245 + 12345;
+        if (i % 10 == 9) {
+            j = styles + i;
+        } else {
+            /* squaring a uniform value favours the first attributes */
+            j = (seed >> 8) % styles;
+            j = (unsigned long)j * j / styles;
+        }
+        snprintf(style, sizeof(style), "display: inline-block; width: %upx; padding: 2px %upx; color: #%06x", j % 500,
+            j % 7, j * 2654435761u % 0xffffff);
+
+        dom_document_create_element(doc, tag, &elements[i]);
+        dom_node_append_child(root, elements[i], &r);
+        dom_node_unref(r);
+        dom_string_create((const uint8_t *)style, strlen(style), &value);
+        dom_element_set_attribute(elements[i], corestring_dom_style, value);
+        dom_string_unref(value);
+    }
+    dom_string_unref(tag);
+    dom_node_unref(root);
+
+    return doc;
+}
+
+/**
+ * Select styles for every element.
+ *
+ * \param name Name to report the run as
+ * \param elements The elements
+ * \param count Number of elements
+ * \param shared Whether to share one construction context
+ * \return true on success, false on failure
+ */
+static bool bench_run(const char *name, dom_element **elements, int count, bool shared)
+{
+    struct box_construct_ctx *ctx = NULL;
+    unsigned int hits = 0;
+    uint64_t start, end;
+    int i;
+
+    bench_forget_selections(elements, count);
+
+    start = bench_clock();
+    for (i = 0; i < count; i++) {
+        css_select_results *styles;
+
+        if (ctx == NULL) {
+            ctx = calloc(1, sizeof(*ctx));
+            if (ctx == NULL) {
+                return false;
+            }
+            ctx->content = &bench_html;
+        } else {
+            dom_string *s;
+
+            dom_element_get_attribute(elements[i], corestring_dom_style, &s);
+            if (s != NULL) {
+                struct box_inline_style *entry = &ctx->inline_styles[dom_string_hash(s) % BOX_INLINE_STYLE_CACHE_SIZE];
+                hits += (entry->text != NULL && dom_string_isequal(entry->text, s));
+                dom_string_unref(s);
+            }
+        }
+
+        styles = box_get_style(ctx, NULL, NULL, (dom_node *)elements[i]);
+        if (styles == NULL) {
+            box_construct_ctx_destroy(ctx);
+            return false;
+        }
+        css_select_results_destroy(styles);
+
+        if (!shared) {
+            box_construct_ctx_destroy(ctx);
+            ctx = NULL;
+        }
+    }
+    end = bench_clock();
+
+    if (ctx != NULL) {
+        box_construct_ctx_destroy(ctx);
+    }
+
+    printf("%s: %.3f ms per 1000 elements, hit rate %.1f%%\n", name, (double)(end - start) / 1000 / count,
+        100.0 * hits / count);
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    static const char author_css[] = "div { color: blue; margin: 1px }";
+    css_stylesheet_params params = {
+        .params_version = CSS_STYLESHEET_PARAMS_VERSION_2,
+        .level = CSS_LEVEL_DEFAULT,
+        .charset = "UTF-8",
+        .url = "http://example.com/",
+        .resolve = bench_resolve_url,
+    };
+    css_stylesheet *sheet;
+    dom_element **elements;
+    dom_document *doc;
+    int count = 30000;
+    int styles = 300;
+    bool ok;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-styles") == 0 && i + 1 < argc) {
+            styles = atoi(argv[++i]);
+        } else {
+            count = atoi(argv[i]);
+        }
+    }
+    if (count <= 0 || styles <= 0) {
+        fprintf(stderr, "Usage: %s [elements] [-styles n]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    elements = calloc(count, sizeof(*elements));
+    if (elements == NULL || corestrings_init() != NSERROR_OK || nsoption_init(NULL, NULL, NULL) != NSERROR_OK ||
+        nsurl_create("http://example.com/", &bench_html.base_url) != NSERROR_OK ||
+        lwc_intern_string("*", 1, &bench_html.universal) != lwc_error_ok ||
+        css_stylesheet_create(&params, &sheet) != CSS_OK) {
+        fprintf(stderr, "Unable to initialise\n");
+        return EXIT_FAILURE;
+    }
+    css_stylesheet_append_data(sheet, (const uint8_t *)author_css, strlen(author_css));
+    css_stylesheet_data_done(sheet);
+    css_select_ctx_create(&bench_html.select_ctx);
+    css_select_ctx_append_sheet(bench_html.select_ctx, sheet, CSS_ORIGIN_AUTHOR, NULL);
+
+    bench_html.encoding = "UTF-8";
+    bench_html.quirks = DOM_DOCUMENT_QUIRKS_MODE_NONE;
+    bench_html.media.type = CSS_MEDIA_SCREEN;
+    bench_html.unit_len_ctx.viewport_width = INTTOFIX(800);
+    bench_html.unit_len_ctx.viewport_height = INTTOFIX(600);
+    bench_html.unit_len_ctx.font_size_default = INTTOFIX(16);
+    bench_html.unit_len_ctx.device_dpi = INTTOFIX(96);
+
+    doc = bench_document_create(elements, count, styles);
+    if (doc == NULL) {
+        fprintf(stderr, "Unable to create document\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("elements: %d, %d shared style attributes\n", count, styles);
+    ok = bench_run("uncached", elements, count, false) && bench_run("cached", elements, count, true);
+
+    for (i = 0; i < count; i++) {
+        dom_node_unref(elements[i]);
+    }
+    dom_node_unref(doc);
+    free(elements);
+    css_select_ctx_destroy(bench_html.select_ctx);
+    css_stylesheet_destroy(sheet);
+    lwc_string_unref(bench_html.universal);
+    nsurl_unref(bench_html.base_url);
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+
+    if (!ok) {
+        fprintf(stderr, "Style selection failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the style attribute cache of box construction.
+ *
+ * Elements with style attributes which repeat, which differ only in their
+ * whitespace and which fall into the same cache slot are given styles
+ * through one box construction context.  Each style must match the one
+ * selected through a fresh context, which parses the element's attribute
+ * anew as box construction did before the cache.  Computed styles are
+ * interned by libcss, so equal styles are the same pointer.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/corestrings.h"
+
+#include "content/handlers/html/box_construct.c"
+
+/** Number of elements in the test document */
+#define TEST_ELEMENTS 600
+
+/** Number of style attributes found for each cache slot */
+#define TEST_COLLISIONS 4
+
+static const char test_author_css[] = "div { color: blue; margin: 1px } div.wide { width: 50% }";
+
+static html_content test_html;
+static dom_document *test_doc;
+static dom_element *test_root;
+static dom_element *test_elements[TEST_ELEMENTS];
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+static css_error test_resolve_url(void *pw, const char *base, lwc_string *rel, lwc_string **abs)
+{
+    *abs = lwc_string_ref(rel);
+    return CSS_OK;
+}
+
+/** Deterministic pseudo random numbers */
+static unsigned int test_seed = 1;
+
+static unsigned int test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return (test_seed >> 16) & 0x7fff;
+}
+
+static dom_string *test_string(const char *s)
+{
+    dom_string *str;
+
+    ck_assert_int_eq(dom_string_create((const uint8_t *)s, strlen(s), &str), DOM_NO_ERR);
+    return str;
+}
+
+/**
+ * Set the style attribute of a test element
+ *
+ * \param n Index of the element
+ * \param style The attribute value, or NULL to remove it
+ */
+static void test_set_style(unsigned int n, const char *style)
+{
+    dom_string *value;
+
+    if (style == NULL) {
+        ck_assert_int_eq(dom_element_remove_attribute(test_elements[n], corestring_dom_style), DOM_NO_ERR);
+        return;
+    }
+    value = test_string(style);
+    ck_assert_int_eq(dom_element_set_attribute(test_elements[n], corestring_dom_style, value), DOM_NO_ERR);
+    dom_string_unref(value);
+}
+
+/**
+ * Drop what libcss kept of an element's last selection, so that the next
+ * selection for it starts afresh.
+ *
+ * \param e The element
+ */
+static void test_forget_selection(dom_element *e)
+{
+    /* only the version is looked at when node data is deleted */
+    static css_select_handler handler = {.handler_version = CSS_SELECT_HANDLER_VERSION_1};
+    void *data = NULL;
+
+    ck_assert_int_eq(
+        dom_node_set_user_data(e, corestring_dom___ns_key_libcss_node_data, NULL, NULL, &data), DOM_NO_ERR);
+    if (data != NULL) {
+        ck_assert_int_eq(css_libcss_node_data_handler(&handler, CSS_NODE_DELETED, NULL, e, NULL, data), CSS_OK);
+    }
+}
+
+static struct box_construct_ctx *test_ctx_create(void)
+{
+    struct box_construct_ctx *ctx = calloc(1, sizeof(*ctx));
+
+    ck_assert(ctx != NULL);
+    ctx->content = &test_html;
+    return ctx;
+}
+
+/**
+ * Check styles selected through a context match those selected by
+ * parsing each element's style attribute anew.
+ *
+ * \param ctx The context
+ * \param count Number of elements to check
+ */
+static void check_styles(struct box_construct_ctx *ctx, unsigned int count)
+{
+    unsigned int n;
+    int pseudo;
+
+    for (n = 0; n < count; n++) {
+        struct box_construct_ctx *fresh = test_ctx_create();
+        css_select_results *cached;
+        css_select_results *uncached;
+
+        test_forget_selection(test_elements[n]);
+        cached = box_get_style(ctx, NULL, NULL, (dom_node *)test_elements[n]);
+        test_forget_selection(test_elements[n]);
+        uncached = box_get_style(fresh, NULL, NULL, (dom_node *)test_elements[n]);
+        ck_assert(cached != NULL);
+        ck_assert(uncached != NULL);
+
+        for (pseudo = 0; pseudo < CSS_PSEUDO_ELEMENT_COUNT; pseudo++) {
+            ck_assert_msg(cached->styles[pseudo] == uncached->styles[pseudo], "element %u pseudo element %d differs",
+                n, pseudo);
+        }
+
+        css_select_results_destroy(cached);
+        css_select_results_destroy(uncached);
+        box_construct_ctx_destroy(fresh);
+    }
+}
+
+/**
+ * Get the cache slot of a style attribute
+ */
+static unsigned int test_slot(const char *style)
+{
+    dom_string *s = test_string(style);
+    unsigned int slot = dom_string_hash(s) % BOX_INLINE_STYLE_CACHE_SIZE;
+
+    dom_string_unref(s);
+    return slot;
+}
+
+
+static void inline_style_setup(void)
+{
+    css_stylesheet_params params = {
+        .params_version = CSS_STYLESHEET_PARAMS_VERSION_2,
+        .level = CSS_LEVEL_DEFAULT,
+        .charset = "UTF-8",
+        .url = "http://example.com/",
+        .resolve = test_resolve_url,
+    };
+    css_stylesheet *sheet;
+    dom_string *tag;
+    dom_node *r;
+    unsigned int n;
+
+    ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+    ck_assert_int_eq(nsoption_init(NULL, NULL, NULL), NSERROR_OK);
+
+    memset(&test_html, 0, sizeof(test_html));
+    test_html.encoding = "UTF-8";
+    test_html.quirks = DOM_DOCUMENT_QUIRKS_MODE_NONE;
+    ck_assert_int_eq(nsurl_create("http://example.com/", &test_html.base_url), NSERROR_OK);
+    ck_assert_int_eq(lwc_intern_string("*", 1, &test_html.universal), lwc_error_ok);
+    test_html.media.type = CSS_MEDIA_SCREEN;
+    test_html.unit_len_ctx.viewport_width = INTTOFIX(800);
+    test_html.unit_len_ctx.viewport_height = INTTOFIX(600);
+    test_html.unit_len_ctx.font_size_default = INTTOFIX(16);
+    test_html.unit_len_ctx.device_dpi = INTTOFIX(96);
+
+    ck_assert_int_eq(css_stylesheet_create(&params, &sheet), CSS_OK);
+    css_stylesheet_append_data(sheet, (const uint8_t *)test_author_css, strlen(test_author_css));
+    ck_assert_int_eq(css_stylesheet_data_done(sheet), CSS_OK);
+    ck_assert_int_eq(css_select_ctx_create(&test_html.select_ctx), CSS_OK);
+    ck_assert_int_eq(css_select_ctx_append_sheet(test_html.select_ctx, sheet, CSS_ORIGIN_AUTHOR, NULL), CSS_OK);
+
+    ck_assert_int_eq(
+        dom_implementation_create_document(DOM_IMPLEMENTATION_HTML, NULL, NULL, NULL, NULL, NULL, &test_doc),
+        DOM_NO_ERR);
+    tag = test_string("html");
+    ck_assert_int_eq(dom_document_create_element(test_doc, tag, &test_root), DOM_NO_ERR);
+    ck_assert_int_eq(dom_node_append_child(test_doc, test_root, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    dom_string_unref(tag);
+
+    tag = test_string("div");
+    for (n = 0; n < TEST_ELEMENTS; n++) {
+        ck_assert_int_eq(dom_document_create_element(test_doc, tag, &test_elements[n]), DOM_NO_ERR);
+        ck_assert_int_eq(dom_node_append_child(test_root, test_elements[n], &r), DOM_NO_ERR);
+        dom_node_unref(r);
+    }
+    dom_string_unref(tag);
+}
+
+static void inline_style_teardown(void)
+{
+    const css_stylesheet *sheet;
+    unsigned int n;
+
+    for (n = 0; n < TEST_ELEMENTS; n++) {
+        dom_node_unref(test_elements[n]);
+    }
+    dom_node_unref(test_root);
+    dom_node_unref(test_doc);
+
+    ck_assert_int_eq(css_select_ctx_get_sheet(test_html.select_ctx, 0, &sheet), CSS_OK);
+    css_select_ctx_destroy(test_html.select_ctx);
+    css_stylesheet_destroy((css_stylesheet *)sheet);
+    lwc_string_unref(test_html.universal);
+    nsurl_unref(test_html.base_url);
+
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+}
+
+
+START_TEST(inline_style_repeated_test)
+{
+    static const char *styles[] = {
+        "color: red",
+        "color: red",
+        "color:red",
+        " color: red ",
+        "color: red; margin: 2px",
+        "width: 10px",
+        "",
+        NULL,
+        "color: red",
+        "width: 10px",
+    };
+    struct box_construct_ctx *ctx = test_ctx_create();
+    css_stylesheet *sheet;
+    dom_string *s;
+    unsigned int n;
+
+    for (n = 0; n < sizeof(styles) / sizeof(styles[0]); n++) {
+        test_set_style(n, styles[n]);
+    }
+    check_styles(ctx, sizeof(styles) / sizeof(styles[0]));
+
+    /* an equal attribute reuses the parse, even from another string */
+    s = test_string("color: red");
+    sheet = box_get_inline_style(ctx, s);
+    ck_assert(sheet != NULL);
+    dom_string_unref(s);
+    s = test_string("color: red");
+    ck_assert(box_get_inline_style(ctx, s) == sheet);
+    dom_string_unref(s);
+
+    box_construct_ctx_destroy(ctx);
+}
+END_TEST
+
+START_TEST(inline_style_colliding_test)
+{
+    char colliding[TEST_COLLISIONS][32];
+    unsigned int found = 0;
+    unsigned int slot = 0;
+    struct box_construct_ctx *ctx = test_ctx_create();
+    dom_string *s;
+    unsigned int i, n;
+
+    /* widths whose attributes share the cache slot of the first */
+    for (i = 1; found < TEST_COLLISIONS; i++) {
+        char style[32];
+
+        snprintf(style, sizeof(style), "width: %upx", i);
+        if (found == 0) {
+            slot = test_slot(style);
+        } else if (test_slot(style) != slot) {
+            continue;
+        }
+        strcpy(colliding[found++], style);
+    }
+
+    /* alternate between them, so each displaces another */
+    for (n = 0; n < 64; n++) {
+        test_set_style(n, colliding[(n * 3 + n / 5) % TEST_COLLISIONS]);
+    }
+    check_styles(ctx, 64);
+
+    /* the slot holds the last attribute given a style */
+    s = test_string(colliding[(63 * 3 + 63 / 5) % TEST_COLLISIONS]);
+    ck_assert(ctx->inline_styles[slot].text != NULL);
+    ck_assert(dom_string_isequal(ctx->inline_styles[slot].text, s));
+    dom_string_unref(s);
+
+    box_construct_ctx_destroy(ctx);
+}
+END_TEST
+
+START_TEST(inline_style_page_test)
+{
+    struct box_construct_ctx *ctx = test_ctx_create();
+    char style[64];
+    unsigned int n;
+
+    /* more distinct attributes than the cache holds, a few used often */
+    for (n = 0; n < TEST_ELEMENTS; n++) {
+        unsigned int r = test_rand();
+
+        switch (r % 8) {
+        case 0:
+            test_set_style(n, NULL);
+            continue;
+        case 1:
+            snprintf(style, sizeof(style), "margin-left: %upx; color: #%06x", r % 300, r * 77);
+            break;
+        default:
+            snprintf(style, sizeof(style), "padding: %upx; display: %s", r % 5, (r & 8) ? "inline" : "block");
+            break;
+        }
+        test_set_style(n, style);
+    }
+    check_styles(ctx, TEST_ELEMENTS);
+
+    /* the attributes change under the context */
+    for (n = 0; n < TEST_ELEMENTS; n += 3) {
+        snprintf(style, sizeof(style), "padding: %upx", n % 7);
+        test_set_style(n, style);
+    }
+    check_styles(ctx, TEST_ELEMENTS);
+
+    box_construct_ctx_destroy(ctx);
+}
+END_TEST
+
+
+static Suite *inline_style_suite(void)
+{
+    Suite *s = suite_create("box_inline_style");
+    TCase *tc = tcase_create("Cache");
+
+    tcase_add_checked_fixture(tc, inline_style_setup, inline_style_teardown);
+    tcase_add_test(tc, inline_style_repeated_test);
+    tcase_add_test(tc, inline_style_colliding_test);
+    tcase_add_test(tc, inline_style_page_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = inline_style_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
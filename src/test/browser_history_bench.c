@@ -0,0 +1,163 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Browser history navigation latency benchmark.
+ *
+ * Navigates a window through a series of pages, adding each to its history
+ * and updating the entry as the page loads, as the browser window does.
+ * The same navigations are run once rendering each thumbnail straight
+ * away, as history did before thumbnails were deferred, and once leaving
+ * the thumbnail to the scheduled render.  The time spent on the navigation
+ * path is reported for both, along with the deferred render time and the
+ * size of the compressed thumbnails.  Thumbnail renders are a stub which
+ * takes a fixed time; pass the cost in microseconds to model a faster or
+ * slower frontend:
+ *
+ *   browser_history_bench 500
+ *   browser_history_bench 500 -cost 2000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/browser_window.h>
+#include <wisp/content.h>
+#include <wisp/desktop/browser_history.h>
+#include <wisp/utils/corestrings.h>
+#include <wisp/utils/nsoption.h>
+#include "desktop/browser_private.h"
+
+#include "test/browser_history_stubs.h"
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+/**
+ * Navigate a window through a series of pages.
+ *
+ * \param name Name to report the run as
+ * \param bw The window
+ * \param navigations Number of pages
+ * \param deferred Whether to leave thumbnails to the scheduled render
+ * \return NSERROR_OK on success, or the error which stopped the run
+ */
+static nserror bench_run(const char *name, struct browser_window *bw, int navigations, bool deferred)
+{
+    uint64_t path = 0;
+    uint64_t idle = 0;
+    uint64_t start;
+    size_t compressed = 0;
+    char url[64];
+    nserror res;
+    int i;
+
+    stub_render_count = 0;
+
+    for (i = 0; i < navigations; i++) {
+        snprintf(url, sizeof(url), "http://example.com/%s/%d", name, i);
+        if (stub_content_url != NULL) {
+            nsurl_unref(stub_content_url);
+        }
+        res = nsurl_create(url, &stub_content_url);
+        if (res != NSERROR_OK) {
+            return res;
+        }
+
+        /* the page loads, then finishes */
+        start = stub_clock();
+        stub_content_status = CONTENT_STATUS_READY;
+        res = browser_window_history_add(bw, stub_content, NULL);
+        if (res == NSERROR_OK) {
+            stub_content_status = CONTENT_STATUS_DONE;
+            res = browser_window_history_update(bw, stub_content);
+        }
+        if (res == NSERROR_OK && !deferred) {
+            browser_window_history_render_thumbnail(bw);
+        }
+        path += stub_clock() - start;
+        if (res != NSERROR_OK) {
+            return res;
+        }
+
+        start = stub_clock();
+        stub_schedule_run();
+        idle += stub_clock() - start;
+
+        compressed += bw->history->current->page.thumbnail_len;
+    }
+
+    printf("%s: %.3f ms per navigation, %.3f ms deferred, %u renders, %zu bytes per thumbnail\n", name,
+        (double)path / 1000000 / navigations, (double)idle / 1000000 / navigations, stub_render_count,
+        compressed / navigations);
+
+    return NSERROR_OK;
+}
+
+int main(int argc, char **argv)
+{
+    struct browser_window bw;
+    int navigations = 200;
+    nserror res;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-cost") == 0 && i + 1 < argc) {
+            stub_render_cost = strtoull(argv[++i], NULL, 10) * 1000;
+        } else {
+            navigations = atoi(argv[i]);
+        }
+    }
+    if (navigations <= 0) {
+        fprintf(stderr, "Usage: %s [navigations] [-cost us]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (stub_render_cost == 0) {
+        stub_render_cost = 1000000;
+    }
+
+    if (corestrings_init() != NSERROR_OK || nsoption_init(NULL, NULL, NULL) != NSERROR_OK) {
+        fprintf(stderr, "Unable to initialise\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("navigations: %d, thumbnail render cost %llu us\n", navigations,
+        (unsigned long long)stub_render_cost / 1000);
+
+    memset(&bw, 0, sizeof(bw));
+    bw.current_content = stub_content;
+    res = browser_window_history_create(&bw);
+    if (res == NSERROR_OK) {
+        res = bench_run("synchronous", &bw, navigations, false);
+    }
+    if (bw.history != NULL) {
+        browser_window_history_destroy(&bw);
+    }
+
+    if (res == NSERROR_OK) {
+        res = browser_window_history_create(&bw);
+    }
+    if (res == NSERROR_OK) {
+        res = bench_run("deferred", &bw, navigations, true);
+    }
+    if (bw.history != NULL) {
+        browser_window_history_destroy(&bw);
+    }
+
+    if (stub_content_url != NULL) {
+        nsurl_unref(stub_content_url);
+    }
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+
+    if (res != NSERROR_OK) {
+        fprintf(stderr, "Navigation failed: error %d\n", res);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
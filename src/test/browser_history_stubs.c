@@ -0,0 +1,284 @@
+/*
+ * Browser history stubs for tests which drive the history tree and its
+ * thumbnails without a frontend or any content.
+ *
+ * Bitmaps are plain buffers, and rendering one paints a page of flat
+ * blocks, as most pages are, taking a set time.  Scheduled callbacks wait
+ * until the test runs them.  There is one content, whose status and URL
+ * the test sets.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <wisp/bitmap.h>
+#include <wisp/browser_window.h>
+#include <wisp/content.h>
+#include <wisp/content/content.h>
+#include <wisp/content/handlers/css/utils.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/misc.h>
+#include <wisp/utils/errors.h>
+#include "desktop/browser_private.h"
+
+#include "test/browser_history_stubs.h"
+
+/** Most callbacks which may be scheduled at once */
+#define STUB_SCHEDULE_MAX 16
+
+css_fixed nscss_screen_dpi = F_90;
+
+/** Stub content handle */
+struct hlcache_handle {
+    int unused;
+};
+
+static struct hlcache_handle stub_handle;
+
+struct hlcache_handle *stub_content = &stub_handle;
+content_status stub_content_status = CONTENT_STATUS_DONE;
+nsurl *stub_content_url;
+unsigned int stub_render_count;
+uint64_t stub_render_cost;
+
+
+/* exported interface documented in test/browser_history_stubs.h */
+uint64_t stub_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+/** Scheduled callback */
+struct stub_callback {
+    void (*callback)(void *p);
+    void *p;
+};
+
+static struct stub_callback stub_scheduled[STUB_SCHEDULE_MAX];
+static unsigned int stub_scheduled_count;
+
+static nserror stub_schedule(int t, void (*callback)(void *p), void *p)
+{
+    unsigned int i;
+
+    /* a callback is only ever scheduled once, as frontends do */
+    for (i = 0; i < stub_scheduled_count; i++) {
+        if (stub_scheduled[i].callback == callback && stub_scheduled[i].p == p) {
+            stub_scheduled[i] = stub_scheduled[--stub_scheduled_count];
+            break;
+        }
+    }
+
+    if (t < 0) {
+        return NSERROR_OK;
+    }
+    if (stub_scheduled_count == STUB_SCHEDULE_MAX) {
+        return NSERROR_NOMEM;
+    }
+    stub_scheduled[stub_scheduled_count].callback = callback;
+    stub_scheduled[stub_scheduled_count].p = p;
+    stub_scheduled_count++;
+
+    return NSERROR_OK;
+}
+
+/* exported interface documented in test/browser_history_stubs.h */
+unsigned int stub_schedule_pending(void)
+{
+    return stub_scheduled_count;
+}
+
+/* exported interface documented in test/browser_history_stubs.h */
+void stub_schedule_run(void)
+{
+    struct stub_callback run[STUB_SCHEDULE_MAX];
+    unsigned int count = stub_scheduled_count;
+    unsigned int i;
+
+    memcpy(run, stub_scheduled, sizeof(run));
+    stub_scheduled_count = 0;
+
+    for (i = 0; i < count; i++) {
+        run[i].callback(run[i].p);
+    }
+}
+
+static struct gui_misc_table stub_misc_table = {
+    .schedule = stub_schedule,
+};
+
+
+/** Stub bitmap */
+struct stub_bitmap {
+    int width;
+    int height;
+    unsigned char *data;
+};
+
+static void *stub_bitmap_create(int width, int height, enum gui_bitmap_flags flags)
+{
+    struct stub_bitmap *b = malloc(sizeof(*b));
+
+    if (b == NULL) {
+        return NULL;
+    }
+    b->width = width;
+    b->height = height;
+    b->data = calloc(width * height, 4);
+    if (b->data == NULL) {
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void stub_bitmap_destroy(void *bitmap)
+{
+    struct stub_bitmap *b = bitmap;
+
+    if (b != NULL) {
+        free(b->data);
+        free(b);
+    }
+}
+
+static unsigned char *stub_bitmap_get_buffer(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->data;
+}
+
+static size_t stub_bitmap_get_rowstride(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->width * 4;
+}
+
+static int stub_bitmap_get_width(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->width;
+}
+
+static int stub_bitmap_get_height(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->height;
+}
+
+static void stub_bitmap_modified(void *bitmap)
+{
+}
+
+static nserror stub_bitmap_render(struct bitmap *bitmap, struct hlcache_handle *content)
+{
+    struct stub_bitmap *b = (struct stub_bitmap *)bitmap;
+    uint64_t start = stub_clock();
+    int x, y;
+
+    stub_render_count++;
+
+    /* a header, lines of text and a margin, shaded by the render count */
+    for (y = 0; y < b->height; y++) {
+        for (x = 0; x < b->width; x++) {
+            unsigned char *p = b->data + (y * b->width + x) * 4;
+            bool ink = (y < b->height / 8) || (x > 8 && y % 6 < 2 && (x / 5 + y) % 7 != 0);
+
+            p[0] = ink ? 0x20 : 0xff;
+            p[1] = ink ? (unsigned char)stub_render_count : 0xff;
+            p[2] = ink ? 0x60 : 0xff;
+            p[3] = 0xff;
+        }
+    }
+
+    while (stub_clock() - start < stub_render_cost) {
+        /* spin */
+    }
+
+    return NSERROR_OK;
+}
+
+static struct gui_bitmap_table stub_bitmap_table = {
+    .create = stub_bitmap_create,
+    .destroy = stub_bitmap_destroy,
+    .get_buffer = stub_bitmap_get_buffer,
+    .get_rowstride = stub_bitmap_get_rowstride,
+    .get_width = stub_bitmap_get_width,
+    .get_height = stub_bitmap_get_height,
+    .modified = stub_bitmap_modified,
+    .render = stub_bitmap_render,
+};
+
+
+static struct wisp_table stub_gui_table = {
+    .misc = &stub_misc_table,
+    .bitmap = &stub_bitmap_table,
+};
+struct wisp_table *guit = &stub_gui_table;
+
+
+struct nsurl *hlcache_handle_get_url(const struct hlcache_handle *handle)
+{
+    return stub_content_url;
+}
+
+content_status content_get_status(struct hlcache_handle *h)
+{
+    return stub_content_status;
+}
+
+const char *content_get_title(struct hlcache_handle *h)
+{
+    return "Title";
+}
+
+int content_get_width(struct hlcache_handle *h)
+{
+    return 800;
+}
+
+int content_get_height(struct hlcache_handle *h)
+{
+    return 600;
+}
+
+struct bitmap *content_get_bitmap(struct hlcache_handle *h)
+{
+    return NULL;
+}
+
+nserror browser_window_create(enum browser_window_create_flags flags, struct nsurl *url, struct nsurl *referrer,
+    struct browser_window *existing, struct browser_window **bw)
+{
+    return NSERROR_OK;
+}
+
+nserror browser_window_navigate(struct browser_window *bw, struct nsurl *url, struct nsurl *referrer,
+    enum browser_window_nav_flags flags, char *post_urlenc, struct fetch_multipart_data *post_multipart,
+    struct hlcache_handle *parent)
+{
+    return NSERROR_OK;
+}
+
+nserror browser_window__reload_current_parameters(struct browser_window *bw)
+{
+    return NSERROR_OK;
+}
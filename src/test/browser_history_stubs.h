@@ -0,0 +1,58 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ */
+
+/**
+ * \file
+ *
+ * Interface to the browser history stubs.
+ *
+ * These stand in for the frontend and the content of a browser window so
+ * that the history tree and its thumbnails can be driven without either.
+ */
+
+#ifndef WISP_TEST_BROWSER_HISTORY_STUBS_H
+#define WISP_TEST_BROWSER_HISTORY_STUBS_H
+
+#include <stdint.h>
+
+#include <wisp/content_type.h>
+#include <wisp/utils/nsurl.h>
+
+struct hlcache_handle;
+
+/** The one content there is, shown in every window */
+extern struct hlcache_handle *stub_content;
+
+/** Status the content reports */
+extern content_status stub_content_status;
+
+/** URL the content reports, set by the test */
+extern nsurl *stub_content_url;
+
+/** Number of thumbnails rendered */
+extern unsigned int stub_render_count;
+
+/** Time each thumbnail render takes, in nanoseconds */
+extern uint64_t stub_render_cost;
+
+/**
+ * Read a monotonic clock in nanoseconds.
+ */
+uint64_t stub_clock(void);
+
+/**
+ * Get the number of scheduled callbacks waiting to run.
+ */
+unsigned int stub_schedule_pending(void);
+
+/**
+ * Run the scheduled callbacks which are waiting, as if their time had come.
+ *
+ * Callbacks they schedule wait for the next run.
+ */
+void stub_schedule_run(void);
+
+#endif
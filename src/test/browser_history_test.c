@@ -0,0 +1,388 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for browser history thumbnails.
+ *
+ * Thumbnail pixels are run length compressed and decompressed again for
+ * flat, random and mixed data, with runs and literals either side of the
+ * longest a control byte holds.  Corrupt and mis-sized data must be
+ * refused.  The deferred render of a window's thumbnail must wait for its
+ * page to finish, give up on a page which fails, and not wait forever on a
+ * page which never finishes.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/corestrings.h"
+
+#include "desktop/browser_history.c"
+
+#include "test/browser_history_stubs.h"
+
+/** Most pixels of test data */
+#define TEST_PIXELS 1024
+
+static struct browser_window *test_bw;
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+
+/** Deterministic pseudo random numbers */
+static unsigned int test_seed = 1;
+
+static unsigned int test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return (test_seed >> 16) & 0x7fff;
+}
+
+/**
+ * Set a pixel of test data
+ *
+ * \param data The pixels
+ * \param n Index of the pixel
+ * \param value Value of the pixel
+ */
+static void test_pixel(uint8_t *data, size_t n, unsigned int value)
+{
+    data[n * THUMBNAIL_PIXEL] = value;
+    data[n * THUMBNAIL_PIXEL + 1] = value >> 8;
+    data[n * THUMBNAIL_PIXEL + 2] = 0x55;
+    data[n * THUMBNAIL_PIXEL + 3] = 0xff;
+}
+
+/**
+ * Check pixels survive compression, and that the compressed data only
+ * decompresses into a buffer of the right size and only when complete.
+ *
+ * \param data The pixels
+ * \param count Number of pixels
+ */
+static void check_round_trip(const uint8_t *data, size_t count)
+{
+    size_t size = count * THUMBNAIL_PIXEL;
+    uint8_t *out = malloc(size + THUMBNAIL_PIXEL);
+    uint8_t *comp;
+    size_t comp_len;
+
+    ck_assert(out != NULL);
+    ck_assert_int_eq(browser_window_history__compress(data, size, &comp, &comp_len), NSERROR_OK);
+    ck_assert_uint_le(comp_len, size + count / 128 + 1);
+
+    memset(out, 0xaa, size);
+    ck_assert_int_eq(browser_window_history__decompress(comp, comp_len, out, size), NSERROR_OK);
+    ck_assert(memcmp(out, data, size) == 0);
+
+    ck_assert_int_eq(
+        browser_window_history__decompress(comp, comp_len, out, size + THUMBNAIL_PIXEL), NSERROR_INVALID);
+    ck_assert_int_eq(
+        browser_window_history__decompress(comp, comp_len, out, size - THUMBNAIL_PIXEL), NSERROR_INVALID);
+    ck_assert_int_eq(browser_window_history__decompress(comp, comp_len - 1, out, size), NSERROR_INVALID);
+
+    free(comp);
+    free(out);
+}
+
+START_TEST(history_rle_flat_test)
+{
+    static const size_t counts[] = {1, 2, 128, 129, 130, 258, 259, TEST_PIXELS};
+    static const uint8_t expect[] = {255, 7, 0, 0x55, 0xff, 0, 7, 0, 0x55, 0xff};
+    uint8_t data[TEST_PIXELS * THUMBNAIL_PIXEL];
+    uint8_t *comp;
+    size_t comp_len;
+    size_t i;
+
+    for (i = 0; i < TEST_PIXELS; i++) {
+        test_pixel(data, i, 7);
+    }
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        check_round_trip(data, counts[i]);
+    }
+
+    /* the longest run, then a single pixel as a literal */
+    ck_assert_int_eq(browser_window_history__compress(data, 130 * THUMBNAIL_PIXEL, &comp, &comp_len), NSERROR_OK);
+    ck_assert_uint_eq(comp_len, sizeof(expect));
+    ck_assert(memcmp(comp, expect, sizeof(expect)) == 0);
+    free(comp);
+
+    /* a flat thumbnail is a run per 129 pixels */
+    ck_assert_int_eq(
+        browser_window_history__compress(data, TEST_PIXELS * THUMBNAIL_PIXEL, &comp, &comp_len), NSERROR_OK);
+    ck_assert_uint_eq(comp_len, (TEST_PIXELS + 128) / 129 * (1 + THUMBNAIL_PIXEL));
+    free(comp);
+}
+END_TEST
+
+START_TEST(history_rle_random_test)
+{
+    static const size_t counts[] = {1, 127, 128, 129, 256, 257, TEST_PIXELS};
+    uint8_t data[TEST_PIXELS * THUMBNAIL_PIXEL];
+    uint8_t *comp;
+    size_t comp_len;
+    size_t i;
+
+    /* no two neighbouring pixels alike */
+    for (i = 0; i < TEST_PIXELS; i++) {
+        test_pixel(data, i, i * 2 + (test_rand() & 1));
+    }
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        check_round_trip(data, counts[i]);
+    }
+
+    /* all literals, a control byte per 128 pixels */
+    ck_assert_int_eq(
+        browser_window_history__compress(data, TEST_PIXELS * THUMBNAIL_PIXEL, &comp, &comp_len), NSERROR_OK);
+    ck_assert_uint_eq(comp_len, TEST_PIXELS * THUMBNAIL_PIXEL + TEST_PIXELS / 128);
+    free(comp);
+}
+END_TEST
+
+START_TEST(history_rle_mixed_test)
+{
+    uint8_t data[TEST_PIXELS * THUMBNAIL_PIXEL];
+    unsigned int value = 0;
+    size_t i, j, n;
+    int pass;
+
+    for (pass = 0; pass < 50; pass++) {
+        /* runs of every length around those a control byte holds */
+        for (i = 0; i < TEST_PIXELS;) {
+            switch (test_rand() % 4) {
+            case 0:
+                n = 1;
+                break;
+            case 1:
+                n = 2 + test_rand() % 3;
+                break;
+            default:
+                n = 125 + test_rand() % 8;
+                break;
+            }
+            if (n > TEST_PIXELS - i) {
+                n = TEST_PIXELS - i;
+            }
+            value += 1 + test_rand() % 2;
+            for (j = 0; j < n; j++) {
+                test_pixel(data, i++, (test_rand() % 3 == 0) ? value + 0x100 : value);
+            }
+        }
+        check_round_trip(data, 1 + test_rand() % TEST_PIXELS);
+        check_round_trip(data, TEST_PIXELS);
+    }
+}
+END_TEST
+
+START_TEST(history_rle_corrupt_test)
+{
+    static const uint8_t overrun_run[] = {255, 1, 2, 3, 4};
+    static const uint8_t short_run[] = {128, 1, 2};
+    static const uint8_t short_literal[] = {1, 1, 2, 3, 4, 5};
+    uint8_t out[8 * THUMBNAIL_PIXEL];
+
+    /* 129 pixels do not fit in 8 */
+    ck_assert_int_eq(
+        browser_window_history__decompress(overrun_run, sizeof(overrun_run), out, sizeof(out)), NSERROR_INVALID);
+    ck_assert_int_eq(
+        browser_window_history__decompress(short_run, sizeof(short_run), out, 2 * THUMBNAIL_PIXEL), NSERROR_INVALID);
+    ck_assert_int_eq(browser_window_history__decompress(short_literal, sizeof(short_literal), out,
+                         2 * THUMBNAIL_PIXEL),
+        NSERROR_INVALID);
+    ck_assert_int_eq(browser_window_history__decompress(NULL, 0, out, sizeof(out)), NSERROR_INVALID);
+}
+END_TEST
+
+
+static void history_setup(void)
+{
+    ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+    ck_assert_int_eq(nsoption_init(NULL, NULL, NULL), NSERROR_OK);
+    ck_assert_int_eq(nsurl_create("http://example.com/", &stub_content_url), NSERROR_OK);
+
+    stub_content_status = CONTENT_STATUS_DONE;
+    stub_render_count = 0;
+
+    test_bw = calloc(1, sizeof(*test_bw));
+    ck_assert(test_bw != NULL);
+    test_bw->current_content = stub_content;
+    ck_assert_int_eq(browser_window_history_create(test_bw), NSERROR_OK);
+}
+
+static void history_teardown(void)
+{
+    browser_window_history_destroy(test_bw);
+    free(test_bw);
+    ck_assert_uint_eq(stub_schedule_pending(), 0);
+    ck_assert(decoded_first == NULL);
+    ck_assert_uint_eq(decoded_size, 0);
+
+    nsurl_unref(stub_content_url);
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+}
+
+/**
+ * Navigate the test window to a page
+ *
+ * \param url The page's URL
+ */
+static void test_navigate(const char *url)
+{
+    nsurl_unref(stub_content_url);
+    ck_assert_int_eq(nsurl_create(url, &stub_content_url), NSERROR_OK);
+    ck_assert_int_eq(browser_window_history_add(test_bw, stub_content, NULL), NSERROR_OK);
+}
+
+START_TEST(history_render_done_test)
+{
+    stub_content_status = CONTENT_STATUS_READY;
+    test_navigate("http://example.com/a");
+
+    /* nothing is rendered on the navigation path */
+    ck_assert_uint_eq(stub_render_count, 0);
+    ck_assert_uint_eq(stub_schedule_pending(), 1);
+
+    /* updates while the page loads wait for the one render */
+    ck_assert_int_eq(browser_window_history_update(test_bw, stub_content), NSERROR_OK);
+    ck_assert_int_eq(browser_window_history_update(test_bw, stub_content), NSERROR_OK);
+    ck_assert_uint_eq(stub_schedule_pending(), 1);
+    stub_schedule_run();
+    ck_assert_uint_eq(stub_render_count, 0);
+    ck_assert_uint_eq(stub_schedule_pending(), 1);
+
+    stub_content_status = CONTENT_STATUS_DONE;
+    stub_schedule_run();
+    ck_assert_uint_eq(stub_render_count, 1);
+    ck_assert_uint_eq(stub_schedule_pending(), 0);
+    ck_assert(test_bw->history->render == NULL);
+    ck_assert(test_bw->history->current->page.bitmap != NULL);
+    ck_assert(test_bw->history->current->page.thumbnail != NULL);
+}
+END_TEST
+
+START_TEST(history_render_error_test)
+{
+    stub_content_status = CONTENT_STATUS_LOADING;
+    test_navigate("http://example.com/a");
+
+    stub_schedule_run();
+    stub_schedule_run();
+    ck_assert_uint_eq(stub_schedule_pending(), 1);
+
+    /* a page which fails is never rendered and stops the polling */
+    stub_content_status = CONTENT_STATUS_ERROR;
+    stub_schedule_run();
+    ck_assert_uint_eq(stub_schedule_pending(), 0);
+    ck_assert_uint_eq(stub_render_count, 0);
+    ck_assert(test_bw->history->render == NULL);
+    ck_assert(test_bw->history->current->page.thumbnail == NULL);
+}
+END_TEST
+
+START_TEST(history_render_bounded_test)
+{
+    unsigned int runs = 0;
+
+    stub_content_status = CONTENT_STATUS_READY;
+    test_navigate("http://example.com/a");
+
+    /* a page which never finishes is rendered as it is, once */
+    while (stub_schedule_pending() > 0) {
+        ck_assert_uint_lt(runs, THUMBNAIL_RENDER_ATTEMPTS);
+        stub_schedule_run();
+        runs++;
+    }
+    ck_assert_uint_eq(runs, THUMBNAIL_RENDER_ATTEMPTS);
+    ck_assert_uint_eq(stub_render_count, 1);
+    ck_assert(test_bw->history->render == NULL);
+
+    /* the next page gets its own attempts */
+    test_navigate("http://example.com/b");
+    runs = 0;
+    while (stub_schedule_pending() > 0) {
+        stub_schedule_run();
+        runs++;
+    }
+    ck_assert_uint_eq(runs, THUMBNAIL_RENDER_ATTEMPTS);
+    ck_assert_uint_eq(stub_render_count, 2);
+}
+END_TEST
+
+START_TEST(history_render_evicted_test)
+{
+    struct history_entry *first;
+    size_t size;
+    uint8_t *pixels;
+
+    test_navigate("http://example.com/a");
+    stub_schedule_run();
+    first = test_bw->history->current;
+    ck_assert(first->page.bitmap != NULL);
+    size = browser_window_history__bitmap_size(first->page.bitmap);
+    pixels = malloc(size);
+    ck_assert(pixels != NULL);
+    memcpy(pixels, guit->bitmap->get_buffer(first->page.bitmap), size);
+
+    /* room for one decoded thumbnail, so the second evicts the first */
+    nsoption_set_uint(history_thumbnail_size, size);
+    test_navigate("http://example.com/b");
+    stub_schedule_run();
+    ck_assert_uint_eq(stub_render_count, 2);
+    ck_assert(first->page.bitmap == NULL);
+    ck_assert(first->page.thumbnail != NULL);
+    ck_assert_uint_lt(first->page.thumbnail_len, size / 4);
+
+    /* decoding it again gives back the rendered pixels */
+    ck_assert(browser_window_history_entry_bitmap(first) != NULL);
+    ck_assert(memcmp(guit->bitmap->get_buffer(first->page.bitmap), pixels, size) == 0);
+    ck_assert(test_bw->history->current->page.bitmap == NULL);
+    ck_assert_uint_eq(decoded_size, size);
+
+    free(pixels);
+}
+END_TEST
+
+
+static Suite *browser_history_suite(void)
+{
+    Suite *s = suite_create("browser_history");
+    TCase *tc_rle = tcase_create("Compression");
+    TCase *tc_render = tcase_create("Render");
+
+    tcase_add_test(tc_rle, history_rle_flat_test);
+    tcase_add_test(tc_rle, history_rle_random_test);
+    tcase_add_test(tc_rle, history_rle_mixed_test);
+    tcase_add_test(tc_rle, history_rle_corrupt_test);
+    suite_add_tcase(s, tc_rle);
+
+    tcase_add_checked_fixture(tc_render, history_setup, history_teardown);
+    tcase_add_test(tc_render, history_render_done_test);
+    tcase_add_test(tc_render, history_render_error_test);
+    tcase_add_test(tc_render, history_render_bounded_test);
+    tcase_add_test(tc_render, history_render_evicted_test);
+    suite_add_tcase(s, tc_render);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = browser_history_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for chunked byte buffers.
+ *
+ * Checks that appended bytes read back the same whether iterated by run or
+ * flattened, that shared blocks are never written through or handed over,
+ * and that wrapped bytes are released once nothing refers to them.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/chunkbuf.h"
+
+/** Size of the chunks appended, as a fetcher might deliver them */
+#define CHUNK_SIZE 16384
+
+static unsigned int released;
+
+static void release_cb(void *pw)
+{
+    released++;
+}
+
+static void fill(uint8_t *data, size_t len, size_t offset)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        data[i] = (uint8_t)((offset + i) * 7);
+    }
+}
+
+/**
+ * Check a buffer holds the pattern from fill(), iterating by run
+ *
+ * \return the number of runs
+ */
+static unsigned int check_runs(const struct chunkbuf *buf, size_t len)
+{
+    uint8_t *expect = malloc(len);
+    const uint8_t *data;
+    size_t offset = 0;
+    size_t run;
+    unsigned int runs = 0;
+
+    ck_assert(expect != NULL);
+    fill(expect, len, 0);
+
+    while ((data = chunkbuf_get_run(buf, offset, &run)) != NULL) {
+        ck_assert_uint_gt(run, 0);
+        ck_assert_uint_le(offset + run, len);
+        ck_assert(memcmp(data, expect + offset, run) == 0);
+        offset += run;
+        runs++;
+    }
+    ck_assert_uint_eq(offset, len);
+    ck_assert_uint_eq(run, 0);
+
+    free(expect);
+    return runs;
+}
+
+
+/**
+ * Appending many chunks uses few blocks and never moves earlier bytes.
+ */
+START_TEST(chunkbuf_append_test)
+{
+    struct chunkbuf buf = {0};
+    uint8_t chunk[CHUNK_SIZE];
+    const uint8_t *first;
+    const uint8_t *flat;
+    size_t run;
+    size_t len = 0;
+    int i;
+
+    ck_assert(!chunkbuf_held(&buf));
+    ck_assert(chunkbuf_flatten(&buf) == NULL);
+    ck_assert(chunkbuf_get_run(&buf, 0, &run) == NULL);
+
+    for (i = 0; i < 1000; i++) {
+        fill(chunk, sizeof(chunk), len);
+        ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+        len += sizeof(chunk);
+    }
+    ck_assert(chunkbuf_held(&buf));
+    ck_assert_uint_eq(buf.len, len);
+
+    first = chunkbuf_get_run(&buf, 0, &run);
+    fill(chunk, 10, len);
+    ck_assert_int_eq(chunkbuf_append(&buf, chunk, 10), NSERROR_OK);
+    len += 10;
+    ck_assert(chunkbuf_get_run(&buf, 0, &run) == first);
+
+    ck_assert_uint_lt(check_runs(&buf, len), 16);
+
+    flat = chunkbuf_flatten(&buf);
+    ck_assert(flat != NULL);
+    ck_assert_uint_eq(check_runs(&buf, len), 1);
+    ck_assert(chunkbuf_flatten(&buf) == flat);
+
+    chunkbuf_release(&buf);
+    ck_assert(!chunkbuf_held(&buf));
+    ck_assert_uint_eq(buf.len, 0);
+}
+END_TEST
+
+
+/**
+ * A reservation is filled without further blocks and trimmed to fit.
+ */
+START_TEST(chunkbuf_reserve_test)
+{
+    struct chunkbuf buf = {0};
+    uint8_t chunk[CHUNK_SIZE];
+    size_t len = 0;
+    int i;
+
+    ck_assert_int_eq(chunkbuf_reserve(&buf, 100 * CHUNK_SIZE), NSERROR_OK);
+    ck_assert(chunkbuf_held(&buf));
+    ck_assert_uint_eq(buf.len, 0);
+    ck_assert_uint_eq(check_runs(&buf, 0), 0);
+
+    for (i = 0; i < 90; i++) {
+        fill(chunk, sizeof(chunk), len);
+        ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+        len += sizeof(chunk);
+    }
+    ck_assert_uint_eq(buf.count, 1);
+
+    chunkbuf_trim(&buf);
+    ck_assert_uint_eq(check_runs(&buf, len), 1);
+
+    /* appending after a trim starts a new block */
+    fill(chunk, sizeof(chunk), len);
+    ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+    len += sizeof(chunk);
+    ck_assert_uint_eq(check_runs(&buf, len), 2);
+
+    chunkbuf_release(&buf);
+}
+END_TEST
+
+
+/**
+ * Clones share blocks but appending to either leaves the other unchanged.
+ */
+START_TEST(chunkbuf_clone_test)
+{
+    struct chunkbuf buf = {0};
+    struct chunkbuf clone;
+    uint8_t chunk[100];
+    const uint8_t *data;
+    size_t run;
+
+    fill(chunk, sizeof(chunk), 0);
+    ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+    ck_assert_int_eq(chunkbuf_clone(&buf, &clone), NSERROR_OK);
+    ck_assert(chunkbuf_get_run(&clone, 0, &run) == chunkbuf_get_run(&buf, 0, &run));
+
+    /* the clone writes into the shared block's spare space */
+    fill(chunk, sizeof(chunk), 100);
+    ck_assert_int_eq(chunkbuf_append(&clone, chunk, sizeof(chunk)), NSERROR_OK);
+    ck_assert_uint_eq(check_runs(&clone, 200), 1);
+
+    /* so the original must not */
+    memset(chunk, 0xff, sizeof(chunk));
+    ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+    ck_assert_uint_eq(check_runs(&clone, 200), 1);
+    data = chunkbuf_get_run(&buf, 100, &run);
+    ck_assert(data != NULL);
+    ck_assert_uint_eq(run, 100);
+    ck_assert_uint_eq(data[0], 0xff);
+
+    /* flattening one does not disturb the other */
+    ck_assert(chunkbuf_flatten(&buf) != NULL);
+    chunkbuf_release(&buf);
+    ck_assert_uint_eq(check_runs(&clone, 200), 1);
+
+    chunkbuf_release(&clone);
+}
+END_TEST
+
+
+/**
+ * Wrapped bytes are read in place and released with the last reference.
+ */
+START_TEST(chunkbuf_wrap_test)
+{
+    struct chunkbuf buf = {0};
+    struct chunkbuf clone;
+    uint8_t data[64];
+    uint8_t next;
+    size_t run;
+
+    released = 0;
+    fill(data, sizeof(data), 0);
+    ck_assert_int_eq(chunkbuf_wrap(&buf, data, sizeof(data), release_cb, NULL), NSERROR_OK);
+    ck_assert(chunkbuf_get_run(&buf, 0, &run) == data);
+    ck_assert(chunkbuf_flatten(&buf) == data);
+
+    ck_assert_int_eq(chunkbuf_clone(&buf, &clone), NSERROR_OK);
+    chunkbuf_release(&buf);
+    ck_assert_uint_eq(released, 0);
+
+    /* appending never writes into wrapped bytes */
+    fill(&next, 1, sizeof(data));
+    ck_assert_int_eq(chunkbuf_append(&clone, &next, 1), NSERROR_OK);
+    ck_assert_uint_eq(check_runs(&clone, sizeof(data) + 1), 2);
+
+    chunkbuf_release(&clone);
+    ck_assert_uint_eq(released, 1);
+}
+END_TEST
+
+
+/**
+ * Detaching hands over an unshared block and copies a shared one.
+ */
+START_TEST(chunkbuf_detach_test)
+{
+    struct chunkbuf buf = {0};
+    struct chunkbuf clone;
+    uint8_t chunk[CHUNK_SIZE];
+    const uint8_t *flat;
+    uint8_t *data;
+    size_t len;
+
+    ck_assert(chunkbuf_detach(&buf, &len) == NULL);
+
+    fill(chunk, sizeof(chunk), 0);
+    ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+    ck_assert_int_eq(chunkbuf_clone(&buf, &clone), NSERROR_OK);
+
+    data = chunkbuf_detach(&buf, &len);
+    ck_assert(data != NULL);
+    ck_assert(data != chunkbuf_get_run(&clone, 0, &len));
+    ck_assert_uint_eq(len, sizeof(chunk));
+    ck_assert(memcmp(data, chunk, len) == 0);
+    ck_assert(!chunkbuf_held(&buf));
+    free(data);
+
+    /* once unshared and exactly sized, the block itself is handed over */
+    chunkbuf_trim(&clone);
+    flat = chunkbuf_flatten(&clone);
+    data = chunkbuf_detach(&clone, &len);
+    ck_assert(data == flat);
+    ck_assert_uint_eq(len, sizeof(chunk));
+    ck_assert(memcmp(data, chunk, len) == 0);
+    free(data);
+}
+END_TEST
+
+
+/**
+ * Consuming runs as they arrive reuses the last block.
+ */
+START_TEST(chunkbuf_consume_test)
+{
+    struct chunkbuf buf = {0};
+    uint8_t chunk[CHUNK_SIZE];
+    const uint8_t *first;
+    const uint8_t *data;
+    size_t run;
+    int i;
+
+    fill(chunk, sizeof(chunk), 0);
+    ck_assert_int_eq(chunkbuf_reserve(&buf, 2 * CHUNK_SIZE), NSERROR_OK);
+    ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+    first = chunkbuf_get_run(&buf, 0, &run);
+
+    for (i = 0; i < 100; i++) {
+        data = chunkbuf_get_run(&buf, 0, &run);
+        ck_assert(data == first);
+        ck_assert_uint_eq(run, sizeof(chunk));
+        chunkbuf_consume_run(&buf);
+        ck_assert_uint_eq(buf.len, 0);
+        ck_assert(chunkbuf_get_run(&buf, 0, &run) == NULL);
+        ck_assert_int_eq(chunkbuf_append(&buf, chunk, sizeof(chunk)), NSERROR_OK);
+    }
+    ck_assert_uint_eq(buf.count, 1);
+
+    chunkbuf_release(&buf);
+}
+END_TEST
+
+
+static Suite *chunkbuf_suite(void)
+{
+    Suite *s = suite_create("chunkbuf");
+    TCase *tc = tcase_create("Buffer");
+
+    tcase_add_test(tc, chunkbuf_append_test);
+    tcase_add_test(tc, chunkbuf_reserve_test);
+    tcase_add_test(tc, chunkbuf_clone_test);
+    tcase_add_test(tc, chunkbuf_wrap_test);
+    tcase_add_test(tc, chunkbuf_detach_test);
+    tcase_add_test(tc, chunkbuf_consume_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = chunkbuf_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
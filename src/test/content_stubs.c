@@ -10,6 +10,13 @@
 
 static struct nsurl *stub_url;
 
+/* Source data returned for every content, set by tests that need it */
+const uint8_t *content_stubs_source_data;
+size_t content_stubs_source_size;
+
+/* The handler most recently registered with the content factory */
+const struct content_handler *content_stubs_handler;
+
 /* Stub guit for tests - layout is NULL so svg.c will use approximation */
 static struct wisp_table stub_gui_table = {0};
 struct wisp_table *guit = &stub_gui_table;
@@ -72,8 +79,8 @@ const uint8_t *content__get_source_data(struct content *c, size_t *size)
 {
     (void)c;
     if (size)
-        *size = 0;
-    return NULL;
+        *size = content_stubs_source_size;
+    return content_stubs_source_data;
 }
 
 struct nsurl *content_get_url(struct content *c)
@@ -97,7 +104,7 @@ struct nsurl *content_get_url(struct content *c)
 nserror content_factory_register_handler(const char *mime_type, const struct content_handler *handler)
 {
     (void)mime_type;
-    (void)handler;
+    content_stubs_handler = handler;
     return NSERROR_OK;
 }
 
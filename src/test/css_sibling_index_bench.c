@@ -0,0 +1,352 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Sibling index benchmark.
+ *
+ * Selects styles for every row of a long zebra striped table, whose rows
+ * are matched by nth-child and nth-last-of-type selectors, with whitespace
+ * between the rows and a script element every fifty rows as generated
+ * pages have.  The selections are run once counting siblings by walking
+ * them, as selection did before the index, once through the index, and
+ * once more after a row has been inserted and another removed, so the
+ * index is rebuilt.  The time per pass is reported and the styles of the
+ * passes must match.  Pass the number of rows to model other tables:
+ *
+ *   css_sibling_index_bench 5000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <wisp/utils/corestrings.h>
+
+#include "content/handlers/css/select.c"
+
+static const char bench_css[] = "tr:nth-child(odd) { background-color: #eee }"
+                                "tr:nth-child(even) { background-color: #fff }"
+                                "tr:nth-last-of-type(-n+3) { font-weight: bold }"
+                                "tr:first-child { color: red }";
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+/**
+ * Read a monotonic clock in nanoseconds.
+ */
+static uint64_t bench_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static css_error bench_resolve_url(void *pw, const char *base, lwc_string *rel, lwc_string **abs)
+{
+    *abs = lwc_string_ref(rel);
+    return CSS_OK;
+}
+
+/**
+ * Count a node's siblings by walking them, as selection did before the
+ * sibling index.
+ */
+static css_error bench_walk_siblings(void *pw, void *n, bool same_name, bool after, int32_t *count)
+{
+    dom_string *node_name = NULL;
+    dom_node *node = dom_node_ref(n);
+    dom_node *next;
+    int32_t cnt = 0;
+
+    if (same_name && (dom_node_get_node_name(node, &node_name) != DOM_NO_ERR || node_name == NULL)) {
+        dom_node_unref(node);
+        return CSS_NOMEM;
+    }
+
+    do {
+        if (after) {
+            dom_node_get_next_sibling(node, &next);
+        } else {
+            dom_node_get_previous_sibling(node, &next);
+        }
+        dom_node_unref(node);
+        node = next;
+        cnt += node_count_siblings_check(node, same_name, node_name);
+    } while (node != NULL);
+
+    if (node_name != NULL) {
+        dom_string_unref(node_name);
+    }
+
+    *count = cnt;
+    return CSS_OK;
+}
+
+/**
+ * Drop what libcss kept of the rows' last selections, so that each pass
+ * selects from scratch.
+ */
+static void bench_forget_selections(dom_element **rows, int count)
+{
+    /* only the version is looked at when node data is deleted */
+    static css_select_handler handler = {.handler_version = CSS_SELECT_HANDLER_VERSION_1};
+    int i;
+
+    for (i = 0; i < count; i++) {
+        void *data = NULL;
+
+        dom_node_set_user_data(rows[i], corestring_dom___ns_key_libcss_node_data, NULL, NULL, &data);
+        if (data != NULL) {
+            css_libcss_node_data_handler(&handler, CSS_NODE_DELETED, NULL, rows[i], NULL, data);
+        }
+    }
+}
+
+/**
+ * Append a row to a table body, with whitespace before it.
+ *
+ * \param doc The document
+ * \param tbody The table body
+ * \param name Element name of the row
+ * \return The row, or NULL on failure
+ */
+static dom_element *bench_append_row(dom_document *doc, dom_element *tbody, const char *name)
+{
+    dom_element *row = NULL;
+    dom_text *text;
+    dom_string *str;
+    dom_node *r;
+
+    if (dom_string_create((const uint8_t *)"\n  ", 3, &str) != DOM_NO_ERR) {
+        return NULL;
+    }
+    if (dom_document_create_text_node(doc, str, &text) == DOM_NO_ERR) {
+        dom_node_append_child(tbody, text, &r);
+        dom_node_unref(r);
+        dom_node_unref(text);
+    }
+    dom_string_unref(str);
+
+    if (dom_string_create((const uint8_t *)name, strlen(name), &str) != DOM_NO_ERR) {
+        return NULL;
+    }
+    if (dom_document_create_element(doc, str, &row) == DOM_NO_ERR) {
+        dom_node_append_child(tbody, row, &r);
+        dom_node_unref(r);
+    }
+    dom_string_unref(str);
+
+    return row;
+}
+
+/**
+ * Create a document with a long table.
+ *
+ * \param rows Updated with the rows
+ * \param count Number of rows
+ * \param[out] tbody_out Updated with the table body
+ * \return The document, or NULL on failure
+ */
+static dom_document *bench_document_create(dom_element **rows, int count, dom_element **tbody_out)
+{
+    static const char *path[] = {"html", "body", "table", "tbody"};
+    dom_document *doc;
+    dom_node *parent;
+    dom_node *r;
+    unsigned int i;
+    int n;
+
+    if (dom_implementation_create_document(DOM_IMPLEMENTATION_HTML, NULL, NULL, NULL, NULL, NULL, &doc) !=
+        DOM_NO_ERR) {
+        return NULL;
+    }
+    parent = dom_node_ref(doc);
+    for (i = 0; i < sizeof(path) / sizeof(path[0]); i++) {
+        dom_element *e;
+        dom_string *tag;
+
+        dom_string_create((const uint8_t *)path[i], strlen(path[i]), &tag);
+        dom_document_create_element(doc, tag, &e);
+        dom_string_unref(tag);
+        dom_node_append_child(parent, e, &r);
+        dom_node_unref(r);
+        dom_node_unref(parent);
+        parent = (dom_node *)e;
+    }
+
+    for (n = 0; n < count; n++) {
+        if (n % 50 == 49) {
+            dom_node_unref(bench_append_row(doc, (dom_element *)parent, "script"));
+        }
+        rows[n] = bench_append_row(doc, (dom_element *)parent, "tr");
+        if (rows[n] == NULL) {
+            dom_node_unref(parent);
+            dom_node_unref(doc);
+            return NULL;
+        }
+    }
+    *tbody_out = (dom_element *)parent;
+
+    return doc;
+}
+
+/**
+ * Select styles for every row.
+ *
+ * \param name Name to report the pass as
+ * \param ctx Selection context
+ * \param media Media to select for
+ * \param unit_len_ctx Unit length conversion context
+ * \param rows The rows
+ * \param count Number of rows
+ * \param styles Updated with each row's style, or compared with it if set
+ * \return true on success, false on failure or if a style differs
+ */
+static bool bench_run(const char *name, nscss_select_ctx *ctx, const css_media *media,
+    const css_unit_ctx *unit_len_ctx, dom_element **rows, int count, css_select_results **styles)
+{
+    uint64_t start, end;
+    bool same = true;
+    int i;
+
+    bench_forget_selections(rows, count);
+
+    start = bench_clock();
+    for (i = 0; i < count; i++) {
+        css_select_results *results = nscss_get_style(ctx, (dom_node *)rows[i], media, unit_len_ctx, NULL);
+
+        if (results == NULL) {
+            return false;
+        }
+        if (styles[i] == NULL) {
+            styles[i] = results;
+        } else {
+            same = same && results->styles[CSS_PSEUDO_ELEMENT_NONE] == styles[i]->styles[CSS_PSEUDO_ELEMENT_NONE];
+            css_select_results_destroy(results);
+        }
+    }
+    end = bench_clock();
+
+    printf("%s: %.3f ms per pass, %.3f us per row\n", name, (double)(end - start) / 1000000,
+        (double)(end - start) / 1000 / count);
+
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    css_stylesheet_params params = {
+        .params_version = CSS_STYLESHEET_PARAMS_VERSION_2,
+        .level = CSS_LEVEL_DEFAULT,
+        .charset = "UTF-8",
+        .url = "http://example.com/",
+        .resolve = bench_resolve_url,
+    };
+    css_media media = {.type = CSS_MEDIA_SCREEN};
+    css_unit_ctx unit_len_ctx = {
+        .viewport_width = INTTOFIX(800),
+        .viewport_height = INTTOFIX(600),
+        .font_size_default = INTTOFIX(16),
+        .device_dpi = INTTOFIX(96),
+    };
+    nscss_select_ctx ctx = {0};
+    css_select_results **styles;
+    css_stylesheet *sheet;
+    dom_element **rows;
+    dom_element *tbody, *row;
+    dom_document *doc;
+    dom_node *r;
+    int count = 5000;
+    bool ok;
+    int i;
+
+    if (argc > 1) {
+        count = atoi(argv[1]);
+    }
+    if (count < 3) {
+        fprintf(stderr, "Usage: %s [rows]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    rows = calloc(count, sizeof(*rows));
+    styles = calloc(count, sizeof(*styles));
+    if (rows == NULL || styles == NULL || corestrings_init() != NSERROR_OK ||
+        nsoption_init(NULL, NULL, NULL) != NSERROR_OK ||
+        nsurl_create("http://example.com/", &ctx.base_url) != NSERROR_OK ||
+        lwc_intern_string("*", 1, &ctx.universal) != lwc_error_ok || css_stylesheet_create(&params, &sheet) != CSS_OK) {
+        fprintf(stderr, "Unable to initialise\n");
+        return EXIT_FAILURE;
+    }
+    css_stylesheet_append_data(sheet, (const uint8_t *)bench_css, strlen(bench_css));
+    css_stylesheet_data_done(sheet);
+    css_select_ctx_create(&ctx.ctx);
+    css_select_ctx_append_sheet(ctx.ctx, sheet, CSS_ORIGIN_AUTHOR, NULL);
+
+    doc = bench_document_create(rows, count, &tbody);
+    if (doc == NULL) {
+        fprintf(stderr, "Unable to create document\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("rows: %d\n", count);
+    selection_handler.node_count_siblings = bench_walk_siblings;
+    ok = bench_run("walk", &ctx, &media, &unit_len_ctx, rows, count, styles);
+    selection_handler.node_count_siblings = node_count_siblings;
+    ok = ok && bench_run("index", &ctx, &media, &unit_len_ctx, rows, count, styles);
+
+    /* insert a row before the middle one and remove it again, leaving the
+     * rows as they were but the index out of date */
+    row = bench_append_row(doc, tbody, "tr");
+    dom_node_insert_before(tbody, row, rows[count / 2], &r);
+    dom_node_unref(r);
+    dom_node_remove_child(tbody, row, &r);
+    dom_node_unref(r);
+    dom_node_unref(row);
+    ok = ok && bench_run("index after edits", &ctx, &media, &unit_len_ctx, rows, count, styles);
+
+    for (i = 0; i < count; i++) {
+        if (styles[i] != NULL) {
+            css_select_results_destroy(styles[i]);
+        }
+        dom_node_unref(rows[i]);
+    }
+    dom_node_unref(tbody);
+    dom_node_unref(doc);
+    free(styles);
+    free(rows);
+    css_select_ctx_destroy(ctx.ctx);
+    css_stylesheet_destroy(sheet);
+    lwc_string_unref(ctx.universal);
+    nsurl_unref(ctx.base_url);
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+
+    if (!ok) {
+        fprintf(stderr, "Style selection failed or differed between passes\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,464 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the sibling index of CSS selection.
+ *
+ * Children are inserted into, removed from and moved about a long list of
+ * table rows with text, comments and other elements between them.  After
+ * each change every row's position, counted from either end with and
+ * without the name filter, must match a walk of its siblings.  Element
+ * names are matched without regard to case, as selection matches them.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/utils/corestrings.h>
+
+#include "content/handlers/css/select.c"
+
+/** Number of children the test list starts with */
+#define TEST_CHILDREN 120
+
+/** Number of random changes made to the list */
+#define TEST_CHANGES 300
+
+static dom_document *test_doc;
+static dom_element *test_parent;
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+/** Deterministic pseudo random numbers */
+static unsigned int test_seed = 1;
+
+static unsigned int test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return (test_seed >> 16) & 0x7fff;
+}
+
+static dom_string *test_string(const char *s)
+{
+    dom_string *str;
+
+    ck_assert_int_eq(dom_string_create((const uint8_t *)s, strlen(s), &str), DOM_NO_ERR);
+    return str;
+}
+
+/**
+ * Create a child to put in the test list
+ *
+ * \param kind Selects an element name, or a text or comment node
+ * \return the new node, which the caller owns
+ */
+static dom_node *test_child_create(unsigned int kind)
+{
+    static const char *names[] = {"tr", "TR", "script", "template"};
+    dom_string *str;
+    dom_node *node;
+
+    switch (kind % 7) {
+    case 4:
+    case 5:
+        str = test_string("\n  ");
+        ck_assert_int_eq(dom_document_create_text_node(test_doc, str, (dom_text **)&node), DOM_NO_ERR);
+        break;
+    case 6:
+        str = test_string(" row ");
+        ck_assert_int_eq(dom_document_create_comment(test_doc, str, (dom_comment **)&node), DOM_NO_ERR);
+        break;
+    default:
+        /* rows are the most common element, and their names differ in
+         * case, which the document keeps */
+        str = test_string(names[kind % 7 < 2 ? kind % 2 : (kind / 7) % 4]);
+        ck_assert_int_eq(dom_document_create_element(test_doc, str, (dom_element **)&node), DOM_NO_ERR);
+        break;
+    }
+    dom_string_unref(str);
+
+    return node;
+}
+
+/**
+ * Get a child of the test list
+ *
+ * \param n Position of the child
+ * \return the child, which the caller owns, or NULL if there is none
+ */
+static dom_node *test_child(unsigned int n)
+{
+    dom_node *child, *next;
+
+    ck_assert_int_eq(dom_node_get_first_child(test_parent, &child), DOM_NO_ERR);
+    while (child != NULL && n-- > 0) {
+        ck_assert_int_eq(dom_node_get_next_sibling(child, &next), DOM_NO_ERR);
+        dom_node_unref(child);
+        child = next;
+    }
+
+    return child;
+}
+
+static unsigned int test_child_count(void)
+{
+    dom_nodelist *children;
+    uint32_t count;
+
+    ck_assert_int_eq(dom_node_get_child_nodes(test_parent, &children), DOM_NO_ERR);
+    ck_assert_int_eq(dom_nodelist_get_length(children, &count), DOM_NO_ERR);
+    dom_nodelist_unref(children);
+
+    return count;
+}
+
+/**
+ * Insert a child into the test list
+ *
+ * \param child The child, which may already be in the list
+ * \param n Position to insert it before, or past the end to append it
+ */
+static void test_insert(dom_node *child, unsigned int n)
+{
+    dom_node *before = test_child(n);
+    dom_node *r;
+
+    ck_assert_int_eq(dom_node_insert_before(test_parent, child, before, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    if (before != NULL) {
+        dom_node_unref(before);
+    }
+}
+
+static void test_remove(unsigned int n)
+{
+    dom_node *child = test_child(n);
+    dom_node *r;
+
+    ck_assert(child != NULL);
+    ck_assert_int_eq(dom_node_remove_child(test_parent, child, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    dom_node_unref(child);
+}
+
+/**
+ * Count an element's siblings by walking them.
+ *
+ * \param node The element
+ * \param same_name Only count elements with the same name
+ * \param after Count the siblings after the element instead of before
+ * \return the count
+ */
+static int32_t test_walk(dom_node *node, bool same_name, bool after)
+{
+    dom_string *name, *other;
+    dom_node *sibling, *next;
+    dom_node_type type;
+    int32_t count = 0;
+
+    ck_assert_int_eq(dom_node_get_node_name(node, &name), DOM_NO_ERR);
+    sibling = dom_node_ref(node);
+    for (;;) {
+        if (after) {
+            ck_assert_int_eq(dom_node_get_next_sibling(sibling, &next), DOM_NO_ERR);
+        } else {
+            ck_assert_int_eq(dom_node_get_previous_sibling(sibling, &next), DOM_NO_ERR);
+        }
+        dom_node_unref(sibling);
+        sibling = next;
+        if (sibling == NULL) {
+            break;
+        }
+
+        ck_assert_int_eq(dom_node_get_node_type(sibling, &type), DOM_NO_ERR);
+        if (type != DOM_ELEMENT_NODE) {
+            continue;
+        }
+        if (same_name) {
+            ck_assert_int_eq(dom_node_get_node_name(sibling, &other), DOM_NO_ERR);
+            if (dom_string_caseless_isequal(name, other)) {
+                count++;
+            }
+            dom_string_unref(other);
+        } else {
+            count++;
+        }
+    }
+    dom_string_unref(name);
+
+    return count;
+}
+
+/**
+ * Check whether the test list has an index for its current children
+ */
+static bool test_indexed(void)
+{
+    const struct nscss_sibling_index *index = NULL;
+    dom_node *first = test_child(0);
+    bool indexed;
+
+    ck_assert(first != NULL);
+    nscss_sibling_lookup(first, (dom_node *)test_parent, &index);
+    dom_node_unref(first);
+    indexed = (index != NULL);
+
+    return indexed;
+}
+
+/**
+ * Check every element of the test list is counted as a walk counts it.
+ */
+static void check_counts(void)
+{
+    dom_node *child, *next;
+    dom_node_type type;
+    unsigned int n = 0;
+    int variant;
+
+    ck_assert_int_eq(dom_node_get_first_child(test_parent, &child), DOM_NO_ERR);
+    while (child != NULL) {
+        ck_assert_int_eq(dom_node_get_node_type(child, &type), DOM_NO_ERR);
+        for (variant = 0; type == DOM_ELEMENT_NODE && variant < 4; variant++) {
+            bool same_name = variant & 1;
+            bool after = variant & 2;
+            int32_t count = -1;
+
+            ck_assert_int_eq(node_count_siblings(NULL, child, same_name, after, &count), CSS_OK);
+            ck_assert_msg(count == test_walk(child, same_name, after),
+                "child %u, same name %d, after %d: %d, expected %d", n, same_name, after, count,
+                test_walk(child, same_name, after));
+        }
+        ck_assert_int_eq(dom_node_get_next_sibling(child, &next), DOM_NO_ERR);
+        dom_node_unref(child);
+        child = next;
+        n++;
+    }
+}
+
+
+static void sibling_index_setup(void)
+{
+    dom_string *tag;
+    dom_element *table;
+    dom_node *r;
+    unsigned int n;
+
+    ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+
+    ck_assert_int_eq(
+        dom_implementation_create_document(DOM_IMPLEMENTATION_XML, NULL, NULL, NULL, NULL, NULL, &test_doc),
+        DOM_NO_ERR);
+    tag = test_string("table");
+    ck_assert_int_eq(dom_document_create_element(test_doc, tag, &table), DOM_NO_ERR);
+    ck_assert_int_eq(dom_node_append_child(test_doc, table, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    dom_string_unref(tag);
+
+    tag = test_string("tbody");
+    ck_assert_int_eq(dom_document_create_element(test_doc, tag, &test_parent), DOM_NO_ERR);
+    ck_assert_int_eq(dom_node_append_child(table, test_parent, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    dom_node_unref(table);
+    dom_string_unref(tag);
+
+    for (n = 0; n < TEST_CHILDREN; n++) {
+        dom_node *child = test_child_create(n);
+
+        ck_assert_int_eq(dom_node_append_child(test_parent, child, &r), DOM_NO_ERR);
+        dom_node_unref(r);
+        dom_node_unref(child);
+    }
+}
+
+static void sibling_index_teardown(void)
+{
+    dom_node_unref(test_parent);
+    dom_node_unref(test_doc);
+
+    corestrings_fini();
+}
+
+
+/**
+ * A long list is indexed once counted, and a short one is not.
+ */
+START_TEST(sibling_index_build_test)
+{
+    ck_assert(!test_indexed());
+    check_counts();
+    ck_assert(test_indexed());
+
+    while (test_child_count() > SIBLING_INDEX_THRESHOLD / 2) {
+        test_remove(0);
+    }
+    check_counts();
+    ck_assert(!test_indexed());
+}
+END_TEST
+
+/**
+ * Children inserted at either end and in the middle are counted.
+ */
+START_TEST(sibling_index_insert_test)
+{
+    unsigned int n;
+
+    check_counts();
+    for (n = 0; n < 14; n++) {
+        dom_node *child = test_child_create(n * 3);
+        unsigned int count = test_child_count();
+        unsigned int at[] = {0, count / 2, count, 1};
+
+        test_insert(child, at[n % 4]);
+        dom_node_unref(child);
+        ck_assert(!test_indexed());
+        check_counts();
+        ck_assert(test_indexed());
+    }
+}
+END_TEST
+
+/**
+ * Children removed from either end and from the middle are not counted.
+ */
+START_TEST(sibling_index_remove_test)
+{
+    unsigned int n;
+
+    check_counts();
+    for (n = 0; n < 14; n++) {
+        unsigned int count = test_child_count();
+        unsigned int at[] = {0, count / 2, count - 1, 1};
+
+        test_remove(at[n % 4]);
+        ck_assert(!test_indexed());
+        check_counts();
+    }
+}
+END_TEST
+
+/**
+ * Children moved within the list, swapped and replaced are counted at
+ * their new positions.
+ */
+START_TEST(sibling_index_reorder_test)
+{
+    dom_node *child, *other, *r;
+    unsigned int count = test_child_count();
+    unsigned int n;
+
+    check_counts();
+
+    /* move children to the front, the back and past each other */
+    for (n = 0; n < 8; n++) {
+        child = test_child((n * 37) % count);
+        test_insert(child, (n & 1) ? 0 : count);
+        dom_node_unref(child);
+        check_counts();
+    }
+
+    /* swap the first and last children */
+    child = test_child(0);
+    other = test_child(count - 1);
+    test_insert(other, 0);
+    test_insert(child, count);
+    dom_node_unref(other);
+    dom_node_unref(child);
+    check_counts();
+
+    /* replace a row with an element of another name */
+    child = test_child(count / 2);
+    other = test_child_create(2 + 7 * 2);
+    ck_assert_int_eq(dom_node_replace_child(test_parent, other, child, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    dom_node_unref(other);
+    dom_node_unref(child);
+    check_counts();
+}
+END_TEST
+
+/**
+ * Counts match a walk throughout a long series of random changes, some of
+ * them to other child lists in the document.
+ */
+START_TEST(sibling_index_random_test)
+{
+    dom_node *child, *r;
+    dom_element *row;
+    unsigned int n;
+
+    ck_assert_int_eq(dom_node_get_last_child(test_parent, (dom_node **)&row), DOM_NO_ERR);
+
+    for (n = 0; n < TEST_CHANGES; n++) {
+        unsigned int count = test_child_count();
+
+        switch (test_rand() % 4) {
+        case 0:
+            child = test_child_create(test_rand());
+            test_insert(child, test_rand() % (count + 1));
+            dom_node_unref(child);
+            break;
+        case 1:
+            if (count > 1) {
+                test_remove(test_rand() % count);
+            }
+            break;
+        case 2:
+            child = test_child(test_rand() % count);
+            test_insert(child, test_rand() % (count + 1));
+            dom_node_unref(child);
+            break;
+        default:
+            /* change a child list outside the test list */
+            child = test_child_create(0);
+            ck_assert_int_eq(dom_node_append_child(row, child, &r), DOM_NO_ERR);
+            dom_node_unref(r);
+            dom_node_unref(child);
+            break;
+        }
+        check_counts();
+    }
+
+    dom_node_unref(row);
+}
+END_TEST
+
+
+static Suite *sibling_index_suite(void)
+{
+    Suite *s = suite_create("css_sibling_index");
+    TCase *tc = tcase_create("Index");
+
+    tcase_add_checked_fixture(tc, sibling_index_setup, sibling_index_teardown);
+    tcase_add_test(tc, sibling_index_build_test);
+    tcase_add_test(tc, sibling_index_insert_test);
+    tcase_add_test(tc, sibling_index_remove_test);
+    tcase_add_test(tc, sibling_index_reorder_test);
+    tcase_add_test(tc, sibling_index_random_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = sibling_index_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the origins the cURL fetcher resolves ahead of fetches.
+ *
+ * Stands in for the fetcher by queueing origins and moving their lookups
+ * through starting and finishing, as it does when it runs them.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "content/fetchers/curl_dns_prefetch.h"
+
+/** Time the tests start at / ms */
+#define NOW ((uint64_t)1000000)
+
+static struct curl_dns_prefetch table[CURL_DNS_PREFETCH_SLOTS];
+
+static void table_setup(void)
+{
+    memset(table, 0, sizeof(table));
+}
+
+static void table_teardown(void)
+{
+    curl_dns_prefetch_clear(table);
+}
+
+static const char *test_origin(unsigned int n)
+{
+    static char origin[64];
+
+    snprintf(origin, sizeof(origin), "https://host%u.example:443/", n);
+    return origin;
+}
+
+/** Count the entries for an origin */
+static unsigned int count_origin(const char *origin)
+{
+    unsigned int count = 0;
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        if (table[i].origin != NULL && strcmp(table[i].origin, origin) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/** Queue an origin and finish its lookup at once */
+static struct curl_dns_prefetch *queue_done(const char *origin, uint64_t now)
+{
+    struct curl_dns_prefetch *p = curl_dns_prefetch_queue(table, origin, now);
+
+    ck_assert(p != NULL);
+    p->state = CURL_DNS_PREFETCH_DONE;
+    return p;
+}
+
+
+/**
+ * An origin is not queued again while it is queued, being resolved, or
+ * recently resolved, and is queued in the same slot once that has passed.
+ */
+START_TEST(curl_dns_prefetch_dedup_test)
+{
+    struct curl_dns_prefetch *p, *q;
+
+    p = curl_dns_prefetch_queue(table, test_origin(1), NOW);
+    ck_assert(p != NULL);
+    ck_assert_str_eq(p->origin, test_origin(1));
+    ck_assert_int_eq(p->state, CURL_DNS_PREFETCH_QUEUED);
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(1), NOW) == NULL);
+
+    p->state = CURL_DNS_PREFETCH_ACTIVE;
+    p->handle = p;
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(1), NOW + CURL_DNS_PREFETCH_REPEAT_TIME * 2) == NULL);
+
+    p->state = CURL_DNS_PREFETCH_DONE;
+    p->handle = NULL;
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(1), NOW + CURL_DNS_PREFETCH_REPEAT_TIME - 1) == NULL);
+
+    /* other origins, including another port on the same host, are queued */
+    ck_assert(curl_dns_prefetch_queue(table, "https://host1.example:8443/", NOW) != NULL);
+    ck_assert(curl_dns_prefetch_queue(table, "http://host1.example:80/", NOW) != NULL);
+
+    q = curl_dns_prefetch_queue(table, test_origin(1), NOW + CURL_DNS_PREFETCH_REPEAT_TIME);
+    ck_assert(q == p);
+    ck_assert_int_eq(q->state, CURL_DNS_PREFETCH_QUEUED);
+    ck_assert_uint_eq(count_origin(test_origin(1)), 1);
+}
+END_TEST
+
+/**
+ * No more than CURL_DNS_PREFETCH_MAX_ACTIVE lookups are queued or in
+ * progress at once, wherever they are in the table.
+ */
+START_TEST(curl_dns_prefetch_budget_test)
+{
+    struct curl_dns_prefetch *p[CURL_DNS_PREFETCH_MAX_ACTIVE];
+    unsigned int i;
+
+    /* a finished lookup ahead of the active ones in the table */
+    queue_done(test_origin(0), NOW);
+
+    for (i = 0; i < CURL_DNS_PREFETCH_MAX_ACTIVE; i++) {
+        p[i] = curl_dns_prefetch_queue(table, test_origin(i + 1), NOW);
+        ck_assert(p[i] != NULL);
+        if (i % 2 == 1) {
+            p[i]->state = CURL_DNS_PREFETCH_ACTIVE;
+        }
+    }
+
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(100), NOW) == NULL);
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(0), NOW + CURL_DNS_PREFETCH_REPEAT_TIME) == NULL);
+
+    /* finishing one lookup makes room for one more */
+    p[1]->state = CURL_DNS_PREFETCH_DONE;
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(100), NOW) != NULL);
+    ck_assert(curl_dns_prefetch_queue(table, test_origin(101), NOW) == NULL);
+    ck_assert_uint_eq(count_origin(test_origin(101)), 0);
+}
+END_TEST
+
+/**
+ * When every slot is taken the oldest finished lookup is forgotten.
+ */
+START_TEST(curl_dns_prefetch_full_test)
+{
+    struct curl_dns_prefetch *oldest = NULL;
+    struct curl_dns_prefetch *p;
+    unsigned int i;
+
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        /* the oldest is in the middle of the table */
+        uint64_t when = NOW + ((i + CURL_DNS_PREFETCH_SLOTS / 2) % CURL_DNS_PREFETCH_SLOTS) * 10;
+
+        p = queue_done(test_origin(i), when);
+        if (when == NOW) {
+            oldest = p;
+        }
+    }
+    ck_assert(oldest != NULL);
+
+    p = curl_dns_prefetch_queue(table, test_origin(1000), NOW + 1000);
+    ck_assert(p == oldest);
+    ck_assert_uint_eq(count_origin(test_origin(CURL_DNS_PREFETCH_SLOTS / 2)), 0);
+    for (i = 0; i < CURL_DNS_PREFETCH_SLOTS; i++) {
+        ck_assert(table[i].origin != NULL);
+    }
+}
+END_TEST
+
+/**
+ * Each finished lookup is credited to one fetch from its origin, for a
+ * while after it was requested.
+ */
+START_TEST(curl_dns_prefetch_credit_test)
+{
+    struct curl_dns_prefetch *p;
+
+    p = curl_dns_prefetch_queue(table, test_origin(1), NOW);
+    ck_assert(p != NULL);
+    ck_assert(curl_dns_prefetch_credit(table, test_origin(1), NOW + 10) == NULL);
+    p->state = CURL_DNS_PREFETCH_ACTIVE;
+    ck_assert(curl_dns_prefetch_credit(table, test_origin(1), NOW + 10) == NULL);
+    p->state = CURL_DNS_PREFETCH_DONE;
+
+    ck_assert(curl_dns_prefetch_credit(table, test_origin(2), NOW + 10) == NULL);
+    ck_assert(curl_dns_prefetch_credit(table, test_origin(1), NOW + 10) == p);
+    ck_assert(p->credited);
+    ck_assert(curl_dns_prefetch_credit(table, test_origin(1), NOW + 20) == NULL);
+
+    queue_done(test_origin(2), NOW);
+    ck_assert(curl_dns_prefetch_credit(table, test_origin(2), NOW + CURL_DNS_PREFETCH_CREDIT_TIME) == NULL);
+}
+END_TEST
+
+
+static Suite *curl_dns_prefetch_suite(void)
+{
+    Suite *s = suite_create("curl_dns_prefetch");
+    TCase *tc = tcase_create("Table");
+
+    tcase_add_checked_fixture(tc, table_setup, table_teardown);
+    tcase_add_test(tc, curl_dns_prefetch_dedup_test);
+    tcase_add_test(tc, curl_dns_prefetch_budget_test);
+    tcase_add_test(tc, curl_dns_prefetch_full_test);
+    tcase_add_test(tc, curl_dns_prefetch_credit_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = curl_dns_prefetch_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
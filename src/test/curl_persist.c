@@ -0,0 +1,275 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the network state the cURL fetcher keeps across restarts.
+ *
+ * Stands in for a server and a restart by recording host addresses and TLS
+ * sessions, saving them, and loading them into fresh state as the fetcher
+ * does at registration.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "content/fetchers/curl_persist.h"
+
+/** Time the tests pretend it is */
+#define NOW ((time_t)1700000000)
+
+static char state_path[64];
+
+static void state_setup(void)
+{
+    snprintf(state_path, sizeof(state_path), "/tmp/curlpersist%d", (int)getpid());
+}
+
+static void state_teardown(void)
+{
+    remove(state_path);
+}
+
+static void write_state(const char *text)
+{
+    FILE *fp = fopen(state_path, "wb");
+
+    ck_assert(fp != NULL);
+    ck_assert_uint_eq(fwrite(text, 1, strlen(text), fp), strlen(text));
+    ck_assert_int_eq(fclose(fp), 0);
+}
+
+/** Sessions seen by count_session() */
+struct session_count {
+    unsigned int count;
+    size_t bytes;
+};
+
+static void count_session(const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len, void *pw)
+{
+    struct session_count *sc = pw;
+
+    ck_assert_uint_eq(data[0], key[0]);
+    sc->count++;
+    sc->bytes += key_len + data_len;
+}
+
+
+/**
+ * Records saved before a restart are available after it, apart from those
+ * which expired in between.
+ */
+START_TEST(curl_persist_roundtrip_test)
+{
+    struct curl_persist *persist;
+    struct session_count sc = {0};
+    uint8_t key[32];
+    uint8_t data[1000];
+
+    ck_assert_int_eq(curl_persist_create(&persist), NSERROR_OK);
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.com", 443, "192.0.2.1", NOW + 600), NSERROR_OK);
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.net", 443, "2001:db8::1", NOW + 10), NSERROR_OK);
+
+    memset(key, 0xa5, sizeof(key));
+    memset(data, 0xa5, sizeof(data));
+    ck_assert_int_eq(curl_persist_add_session(persist, key, sizeof(key), data, sizeof(data), NOW + 600), NSERROR_OK);
+    memset(key, 0x5a, sizeof(key));
+    memset(data, 0x5a, sizeof(data));
+    ck_assert_int_eq(curl_persist_add_session(persist, key, sizeof(key), data, sizeof(data), NOW + 10), NSERROR_OK);
+
+    ck_assert_int_eq(curl_persist_save(persist, state_path, NOW), NSERROR_OK);
+    curl_persist_destroy(persist);
+
+    /* restart after some records have expired */
+    ck_assert_int_eq(curl_persist_create(&persist), NSERROR_OK);
+    ck_assert_int_eq(curl_persist_load(persist, state_path, NOW + 60), NSERROR_OK);
+
+    ck_assert_str_eq(curl_persist_claim_host(persist, "example.com", 443, NOW + 60), "192.0.2.1");
+    ck_assert(curl_persist_claim_host(persist, "example.net", 443, NOW + 60) == NULL);
+
+    curl_persist_each_session(persist, NOW + 60, count_session, &sc);
+    ck_assert_uint_eq(sc.count, 1);
+    ck_assert_uint_eq(sc.bytes, sizeof(key) + sizeof(data));
+
+    curl_persist_destroy(persist);
+}
+END_TEST
+
+
+/**
+ * The saved state holds session tickets, so only the user may read it,
+ * even when a stale temporary file readable by others is in the way.
+ */
+START_TEST(curl_persist_mode_test)
+{
+    struct curl_persist *persist;
+    char tmp[sizeof(state_path) + 4];
+    struct stat st;
+    FILE *fp;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", state_path);
+    fp = fopen(tmp, "wb");
+    ck_assert(fp != NULL);
+    ck_assert_int_eq(fclose(fp), 0);
+    ck_assert_int_eq(chmod(tmp, 0644), 0);
+
+    ck_assert_int_eq(curl_persist_create(&persist), NSERROR_OK);
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.com", 443, "192.0.2.1", NOW + 600), NSERROR_OK);
+    ck_assert_int_eq(curl_persist_save(persist, state_path, NOW), NSERROR_OK);
+    curl_persist_destroy(persist);
+
+    ck_assert_int_eq(stat(state_path, &st), 0);
+    ck_assert_uint_eq(st.st_mode & 0777, 0600);
+    ck_assert_int_ne(stat(tmp, &st), 0);
+}
+END_TEST
+
+
+/**
+ * Host addresses are handed out once, per port, until replaced or removed.
+ */
+START_TEST(curl_persist_claim_test)
+{
+    struct curl_persist *persist;
+
+    ck_assert_int_eq(curl_persist_create(&persist), NSERROR_OK);
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.com", 443, "192.0.2.1", NOW + 600), NSERROR_OK);
+
+    ck_assert(curl_persist_claim_host(persist, "example.com", 80, NOW) == NULL);
+    ck_assert(curl_persist_claim_host(persist, "example.com", 443, NOW + 600) == NULL);
+    ck_assert_str_eq(curl_persist_claim_host(persist, "example.com", 443, NOW), "192.0.2.1");
+    ck_assert(curl_persist_claim_host(persist, "example.com", 443, NOW) == NULL);
+
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.com", 443, "192.0.2.2", NOW + 600), NSERROR_OK);
+    ck_assert_str_eq(curl_persist_claim_host(persist, "example.com", 443, NOW), "192.0.2.2");
+
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.com", 443, "192.0.2.3", NOW + 600), NSERROR_OK);
+    curl_persist_remove_host(persist, "example.com", 443);
+    ck_assert(curl_persist_claim_host(persist, "example.com", 443, NOW) == NULL);
+
+    ck_assert_int_eq(curl_persist_add_host(persist, "bad host", 443, "192.0.2.1", NOW + 600), NSERROR_BAD_PARAMETER);
+    ck_assert_int_eq(curl_persist_add_host(persist, "example.com", 443, "", NOW + 600), NSERROR_BAD_PARAMETER);
+
+    curl_persist_destroy(persist);
+}
+END_TEST
+
+
+/**
+ * Full state drops the records expiring soonest.
+ */
+START_TEST(curl_persist_full_test)
+{
+    struct curl_persist *persist;
+    struct session_count sc = {0};
+    char host[32];
+    uint8_t key[4];
+    int i;
+
+    ck_assert_int_eq(curl_persist_create(&persist), NSERROR_OK);
+
+    for (i = 0; i < CURL_PERSIST_MAX_HOSTS + 10; i++) {
+        snprintf(host, sizeof(host), "host%d.example", i);
+        ck_assert_int_eq(curl_persist_add_host(persist, host, 443, "192.0.2.1", NOW + 100 + i), NSERROR_OK);
+    }
+    ck_assert(curl_persist_claim_host(persist, "host9.example", 443, NOW) == NULL);
+    ck_assert(curl_persist_claim_host(persist, "host10.example", 443, NOW) != NULL);
+    snprintf(host, sizeof(host), "host%d.example", CURL_PERSIST_MAX_HOSTS + 9);
+    ck_assert(curl_persist_claim_host(persist, host, 443, NOW) != NULL);
+
+    for (i = 0; i < CURL_PERSIST_MAX_SESSIONS + 10; i++) {
+        memset(key, i, sizeof(key));
+        ck_assert_int_eq(curl_persist_add_session(persist, key, sizeof(key), key, sizeof(key), NOW + 100 + i),
+            NSERROR_OK);
+    }
+    curl_persist_each_session(persist, NOW, count_session, &sc);
+    ck_assert_uint_eq(sc.count, CURL_PERSIST_MAX_SESSIONS);
+
+    curl_persist_destroy(persist);
+}
+END_TEST
+
+
+/**
+ * Files which are not state files are rejected, and malformed records in a
+ * state file are skipped.
+ */
+START_TEST(curl_persist_malformed_test)
+{
+    struct curl_persist *persist;
+    struct session_count sc = {0};
+
+    ck_assert_int_eq(curl_persist_create(&persist), NSERROR_OK);
+
+    ck_assert_int_eq(curl_persist_load(persist, state_path, NOW), NSERROR_NOT_FOUND);
+
+    write_state("");
+    ck_assert_int_eq(curl_persist_load(persist, state_path, NOW), NSERROR_INVALID);
+
+    write_state("wisp-netstate 2\nhost 1700000600 443 example.com 192.0.2.1\n");
+    ck_assert_int_eq(curl_persist_load(persist, state_path, NOW), NSERROR_INVALID);
+
+    write_state("wisp-netstate 1\n"
+                "host 1700000600 443 example.com\n"
+                "host 1700000600 443 example.com 192.0.2.1 extra\n"
+                "host 1700000600 0 example.com 192.0.2.1\n"
+                "host 17000006x0 443 example.com 192.0.2.1\n"
+                "tls 1700000600 a5a5 a5a\n"
+                "tls 1700000600 a5a5 zz\n"
+                "unknown 1700000600 a5a5 a5a5\n"
+                "\n"
+                "host 1700000600 443 example.org 192.0.2.7\n"
+                "tls 1700000600 a5a5 a5a5a5\n"
+                "host 1700000600 443 example.net 192.0.2.8");
+    ck_assert_int_eq(curl_persist_load(persist, state_path, NOW), NSERROR_OK);
+
+    ck_assert(curl_persist_claim_host(persist, "example.com", 443, NOW) == NULL);
+    ck_assert_str_eq(curl_persist_claim_host(persist, "example.org", 443, NOW), "192.0.2.7");
+    /* the final line has no terminator so may be truncated */
+    ck_assert(curl_persist_claim_host(persist, "example.net", 443, NOW) == NULL);
+
+    curl_persist_each_session(persist, NOW, count_session, &sc);
+    ck_assert_uint_eq(sc.count, 1);
+    ck_assert_uint_eq(sc.bytes, 5);
+
+    curl_persist_destroy(persist);
+}
+END_TEST
+
+
+static Suite *curl_persist_suite(void)
+{
+    Suite *s = suite_create("curl_persist");
+    TCase *tc = tcase_create("State");
+
+    tcase_add_checked_fixture(tc, state_setup, state_teardown);
+    tcase_add_test(tc, curl_persist_roundtrip_test);
+    tcase_add_test(tc, curl_persist_mode_test);
+    tcase_add_test(tc, curl_persist_claim_test);
+    tcase_add_test(tc, curl_persist_full_test);
+    tcase_add_test(tc, curl_persist_malformed_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = curl_persist_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for batched DOM mutation records.
+ *
+ * Builds documents through libdom directly and checks the records delivered
+ * to the document's mutation observer, that mutation events are only
+ * created when something would see them, and that insertion events seen
+ * only by default actions are reused.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dom/dom.h>
+
+/** Records seen by the observer */
+static struct {
+    dom_mutation_record_type type;
+    dom_mutation_type change;
+    struct dom_node *target;
+    struct dom_node *node;
+} seen[64];
+static unsigned int seen_count;
+static unsigned int batches;
+static unsigned int pending;
+
+/** Default actions run */
+static unsigned int inserted_actions;
+static unsigned int modified_actions;
+
+/** Default action lookups */
+static unsigned int lookups;
+
+/** Distinct insertion events seen by the default action */
+static struct dom_event *events[8];
+static unsigned int event_count;
+
+/** Insertion event the default action keeps a reference to */
+static struct dom_event *retained;
+static bool retain;
+
+static void records_cb(struct dom_document *doc, const dom_mutation_record *rec, uint32_t count, void *pw)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        ck_assert_uint_lt(seen_count, 64);
+        seen[seen_count].type = rec[i].type;
+        seen[seen_count].change = rec[i].change;
+        seen[seen_count].target = rec[i].target;
+        seen[seen_count].node = rec[i].node;
+        seen_count++;
+    }
+    batches++;
+}
+
+static void pending_cb(struct dom_document *doc, void *pw)
+{
+    pending++;
+}
+
+static void inserted_cb(struct dom_event *evt, void *pw)
+{
+    inserted_actions++;
+}
+
+static void distinct_cb(struct dom_event *evt, void *pw)
+{
+    dom_event_target *target;
+    unsigned int i;
+
+    /* the event is fully initialised for each insertion */
+    ck_assert_int_eq(dom_event_get_target(evt, &target), DOM_NO_ERR);
+    ck_assert_ptr_nonnull(target);
+    dom_node_unref(target);
+
+    for (i = 0; i < event_count; i++) {
+        if (events[i] == evt)
+            break;
+    }
+    if (i == event_count) {
+        ck_assert_uint_lt(event_count, 8);
+        events[event_count++] = evt;
+    }
+
+    if (retain && retained == NULL) {
+        dom_event_ref(evt);
+        retained = evt;
+    }
+}
+
+static void modified_cb(struct dom_event *evt, void *pw)
+{
+    modified_actions++;
+}
+
+static void listener_cb(struct dom_event *evt, void *pw)
+{
+    (*(unsigned int *)pw)++;
+}
+
+static bool type_is(dom_string *type, const char *name)
+{
+    return dom_string_byte_length(type) == strlen(name) && memcmp(dom_string_data(type), name, strlen(name)) == 0;
+}
+
+/* Only the insertion default action is wanted */
+static dom_default_action_callback fetcher(dom_string *type, dom_default_action_phase phase, void **pw)
+{
+    if (phase == DOM_DEFAULT_ACTION_END && type_is(type, "DOMNodeInserted")) {
+        return inserted_cb;
+    }
+    return NULL;
+}
+
+/* Only the insertion default action is wanted, and tracks the events */
+static dom_default_action_callback distinct_fetcher(dom_string *type, dom_default_action_phase phase, void **pw)
+{
+    if (phase == DOM_DEFAULT_ACTION_END && type_is(type, "DOMNodeInserted")) {
+        return distinct_cb;
+    }
+    return NULL;
+}
+
+/* Every modification default action is wanted */
+static dom_default_action_callback modified_fetcher(dom_string *type, dom_default_action_phase phase, void **pw)
+{
+    if (phase == DOM_DEFAULT_ACTION_END && type_is(type, "DOMSubtreeModified")) {
+        return modified_cb;
+    }
+    return NULL;
+}
+
+/* No default action is wanted, but every lookup is counted */
+static dom_default_action_callback counting_fetcher(dom_string *type, dom_default_action_phase phase, void **pw)
+{
+    lookups++;
+    return NULL;
+}
+
+static dom_string *make_string(const char *s)
+{
+    dom_string *str;
+    ck_assert_int_eq(dom_string_create((const uint8_t *)s, strlen(s), &str), DOM_NO_ERR);
+    return str;
+}
+
+static dom_document *create_document(dom_events_default_action_fetcher daf)
+{
+    dom_document *doc;
+
+    seen_count = 0;
+    batches = 0;
+    pending = 0;
+    inserted_actions = 0;
+    modified_actions = 0;
+    lookups = 0;
+    event_count = 0;
+    retained = NULL;
+    retain = false;
+
+    ck_assert_int_eq(dom_implementation_create_document(DOM_IMPLEMENTATION_HTML, NULL, NULL, NULL, daf, NULL, &doc),
+        DOM_NO_ERR);
+    return doc;
+}
+
+static dom_element *append_element(dom_document *doc, dom_node *parent, const char *name)
+{
+    dom_string *tag = make_string(name);
+    dom_element *e;
+    dom_node *r;
+
+    ck_assert_int_eq(dom_document_create_element(doc, tag, &e), DOM_NO_ERR);
+    ck_assert_int_eq(dom_node_append_child(parent, e, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    dom_string_unref(tag);
+
+    return e;
+}
+
+
+/**
+ * Records are queued in order and delivered together on flush.
+ */
+START_TEST(mutation_record_batch_test)
+{
+    dom_document *doc = create_document(fetcher);
+    dom_string *cls = make_string("class");
+    dom_string *val = make_string("x");
+    dom_string *txt = make_string("hello");
+    dom_element *body, *e;
+    dom_text *t;
+    dom_node *r;
+
+    dom_document_set_mutation_observer(doc, records_cb, pending_cb, NULL);
+
+    body = append_element(doc, (dom_node *)doc, "body");
+    e = append_element(doc, (dom_node *)body, "div");
+    ck_assert_int_eq(dom_element_set_attribute(e, cls, val), DOM_NO_ERR);
+    ck_assert_int_eq(dom_document_create_text_node(doc, txt, &t), DOM_NO_ERR);
+    ck_assert_int_eq(dom_node_append_child(e, t, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    ck_assert_int_eq(dom_characterdata_append_data(t, txt), DOM_NO_ERR);
+
+    /* nothing is delivered until the checkpoint */
+    ck_assert_uint_eq(pending, 1);
+    ck_assert_uint_eq(batches, 0);
+
+    dom_document_flush_mutation_records(doc);
+    ck_assert_uint_eq(batches, 1);
+    ck_assert_uint_eq(seen_count, 5);
+
+    ck_assert_int_eq(seen[0].type, DOM_MUTATION_RECORD_CHILD_LIST);
+    ck_assert(seen[0].target == (struct dom_node *)doc);
+    ck_assert(seen[0].node == (struct dom_node *)body);
+    ck_assert_int_eq(seen[0].change, DOM_MUTATION_ADDITION);
+
+    ck_assert_int_eq(seen[1].type, DOM_MUTATION_RECORD_CHILD_LIST);
+    ck_assert(seen[1].target == (struct dom_node *)body);
+
+    ck_assert_int_eq(seen[2].type, DOM_MUTATION_RECORD_ATTRIBUTES);
+    ck_assert(seen[2].target == (struct dom_node *)e);
+    ck_assert_int_eq(seen[2].change, DOM_MUTATION_ADDITION);
+
+    ck_assert_int_eq(seen[3].type, DOM_MUTATION_RECORD_CHILD_LIST);
+    ck_assert(seen[3].node == (struct dom_node *)t);
+
+    ck_assert_int_eq(seen[4].type, DOM_MUTATION_RECORD_CHARACTER_DATA);
+    ck_assert(seen[4].target == (struct dom_node *)t);
+
+    /* the insertion default action still ran for each insertion,
+     * including the attribute node */
+    ck_assert_uint_eq(inserted_actions, 4);
+
+    /* an empty flush delivers nothing, a new change starts a new batch */
+    dom_document_flush_mutation_records(doc);
+    ck_assert_uint_eq(batches, 1);
+    ck_assert_int_eq(dom_element_remove_attribute(e, cls), DOM_NO_ERR);
+    ck_assert_uint_eq(pending, 2);
+    dom_document_flush_mutation_records(doc);
+    ck_assert_uint_eq(batches, 2);
+    ck_assert_uint_eq(seen_count, 6);
+    ck_assert_int_eq(seen[5].change, DOM_MUTATION_REMOVAL);
+
+    dom_node_unref(t);
+    dom_node_unref(e);
+    dom_node_unref(body);
+    dom_string_unref(txt);
+    dom_string_unref(val);
+    dom_string_unref(cls);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+/**
+ * Removing the observer discards queued records and stops queueing.
+ */
+START_TEST(mutation_record_unobserve_test)
+{
+    dom_document *doc = create_document(fetcher);
+    dom_element *body;
+
+    dom_document_set_mutation_observer(doc, records_cb, pending_cb, NULL);
+    body = append_element(doc, (dom_node *)doc, "body");
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+
+    dom_document_set_mutation_observer(doc, NULL, NULL, NULL);
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    dom_document_flush_mutation_records(doc);
+
+    ck_assert_uint_eq(pending, 1);
+    ck_assert_uint_eq(batches, 0);
+    ck_assert_uint_eq(inserted_actions, 3);
+
+    dom_node_unref(body);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+/**
+ * Mutation events still reach default actions and listeners that want them.
+ */
+START_TEST(mutation_record_events_test)
+{
+    dom_document *doc = create_document(modified_fetcher);
+    dom_string *type = make_string("DOMNodeInserted");
+    dom_event_listener *listener;
+    unsigned int heard = 0;
+    dom_element *body;
+
+    body = append_element(doc, (dom_node *)doc, "body");
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(modified_actions, 2);
+
+    ck_assert_int_eq(dom_event_listener_create(listener_cb, &heard, &listener), DOM_NO_ERR);
+    ck_assert_int_eq(dom_event_target_add_event_listener(body, type, listener, false), DOM_NO_ERR);
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(heard, 1);
+    ck_assert_uint_eq(modified_actions, 3);
+
+    ck_assert_int_eq(dom_event_target_remove_event_listener(body, type, listener, false), DOM_NO_ERR);
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(heard, 1);
+
+    dom_event_listener_unref(listener);
+    dom_string_unref(type);
+    dom_node_unref(body);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+/**
+ * The child list generation changes only when a child list does.
+ */
+START_TEST(mutation_record_generation_test)
+{
+    dom_document *doc = create_document(NULL);
+    dom_string *cls = make_string("class");
+    dom_string *val = make_string("x");
+    dom_element *body, *p;
+    dom_node *r;
+    uint32_t before, after;
+
+    body = append_element(doc, (dom_node *)doc, "body");
+    p = append_element(doc, (dom_node *)body, "p");
+
+    ck_assert_int_eq(dom_node_get_child_list_generation(p, &before), DOM_NO_ERR);
+    ck_assert_int_eq(dom_element_set_attribute(p, cls, val), DOM_NO_ERR);
+    ck_assert_int_eq(dom_node_get_child_list_generation(body, &after), DOM_NO_ERR);
+    ck_assert_uint_eq(before, after);
+
+    dom_node_unref(append_element(doc, (dom_node *)p, "span"));
+    ck_assert_int_eq(dom_node_get_child_list_generation(body, &after), DOM_NO_ERR);
+    ck_assert_uint_ne(before, after);
+
+    before = after;
+    ck_assert_int_eq(dom_node_remove_child(body, p, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    ck_assert_int_eq(dom_node_get_child_list_generation(body, &after), DOM_NO_ERR);
+    ck_assert_uint_ne(before, after);
+
+    dom_node_unref(p);
+    dom_node_unref(body);
+    dom_string_unref(val);
+    dom_string_unref(cls);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+/**
+ * An adopted node keeps its mutation event listeners, and they still
+ * count towards creating mutation events.
+ */
+START_TEST(mutation_record_adopt_test)
+{
+    dom_document *doc = create_document(NULL);
+    dom_string *type = make_string("DOMNodeInserted");
+    dom_event_listener *listener;
+    unsigned int heard = 0;
+    dom_element *body, *div;
+    dom_node *adopted, *r;
+
+    body = append_element(doc, (dom_node *)doc, "body");
+    div = append_element(doc, (dom_node *)body, "div");
+    dom_node_unref(append_element(doc, (dom_node *)div, "p"));
+
+    ck_assert_int_eq(dom_event_listener_create(listener_cb, &heard, &listener), DOM_NO_ERR);
+    ck_assert_int_eq(dom_event_target_add_event_listener(div, type, listener, false), DOM_NO_ERR);
+
+    ck_assert_int_eq(dom_document_adopt_node(doc, div, &adopted), DOM_NO_ERR);
+    ck_assert_ptr_nonnull(adopted);
+    dom_node_unref(div);
+    ck_assert_int_eq(dom_node_append_child(body, adopted, &r), DOM_NO_ERR);
+    dom_node_unref(r);
+    heard = 0;
+
+    /* no default action wants the event, only the moved listener */
+    dom_node_unref(append_element(doc, adopted, "p"));
+    ck_assert_uint_eq(heard, 1);
+
+    ck_assert_int_eq(dom_event_target_remove_event_listener(adopted, type, listener, false), DOM_NO_ERR);
+    dom_node_unref(append_element(doc, adopted, "p"));
+    ck_assert_uint_eq(heard, 1);
+
+    dom_event_listener_unref(listener);
+    dom_string_unref(type);
+    dom_node_unref(adopted);
+    dom_node_unref(body);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+/**
+ * Listeners stop counting towards creating mutation events when their node
+ * is destroyed, and only when a removal actually removes them.
+ */
+START_TEST(mutation_record_listener_release_test)
+{
+    dom_document *doc = create_document(counting_fetcher);
+    dom_string *type = make_string("DOMNodeInserted");
+    dom_string *tag = make_string("div");
+    dom_event_listener *listener, *other;
+    unsigned int heard = 0;
+    unsigned int before;
+    dom_element *body, *e;
+
+    body = append_element(doc, (dom_node *)doc, "body");
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+
+    ck_assert_int_eq(dom_event_listener_create(listener_cb, &heard, &listener), DOM_NO_ERR);
+    ck_assert_int_eq(dom_event_listener_create(listener_cb, &heard, &other), DOM_NO_ERR);
+
+    /* a listener on a node destroyed without ever being removed */
+    ck_assert_int_eq(dom_document_create_element(doc, tag, &e), DOM_NO_ERR);
+    ck_assert_int_eq(dom_event_target_add_event_listener(e, type, listener, false), DOM_NO_ERR);
+    dom_node_unref(e);
+
+    /* no events are created, so the default actions are not looked up */
+    before = lookups;
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(lookups, before);
+
+    /* removing a listener which was never added leaves the count alone */
+    ck_assert_int_eq(dom_event_target_add_event_listener(body, type, listener, false), DOM_NO_ERR);
+    ck_assert_int_eq(dom_event_target_remove_event_listener(body, type, other, false), DOM_NO_ERR);
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(heard, 1);
+
+    ck_assert_int_eq(dom_event_target_remove_event_listener(body, type, listener, false), DOM_NO_ERR);
+    before = lookups;
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(heard, 1);
+    ck_assert_uint_eq(lookups, before);
+
+    dom_event_listener_unref(other);
+    dom_event_listener_unref(listener);
+    dom_string_unref(tag);
+    dom_string_unref(type);
+    dom_node_unref(body);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+/**
+ * Insertion events seen only by default actions reuse one event, unless
+ * something keeps a reference to it or a listener may see it.
+ */
+START_TEST(mutation_record_event_reuse_test)
+{
+    dom_document *doc = create_document(distinct_fetcher);
+    dom_string *type = make_string("DOMNodeInserted");
+    dom_event_listener *listener;
+    unsigned int heard = 0;
+    dom_element *body;
+    dom_string *name;
+
+    body = append_element(doc, (dom_node *)doc, "body");
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(event_count, 1);
+
+    /* a retained event is left alone and another is used */
+    retain = true;
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_ptr_nonnull(retained);
+    ck_assert_uint_eq(event_count, 2);
+    ck_assert_int_eq(dom_event_get_type(retained, &name), DOM_NO_ERR);
+    ck_assert(type_is(name, "DOMNodeInserted"));
+    dom_string_unref(name);
+    dom_event_unref(retained);
+
+    /* while a listener may see them every event is a new one */
+    retain = false;
+    ck_assert_int_eq(dom_event_listener_create(listener_cb, &heard, &listener), DOM_NO_ERR);
+    ck_assert_int_eq(dom_event_target_add_event_listener(body, type, listener, false), DOM_NO_ERR);
+    dom_node_unref(append_element(doc, (dom_node *)body, "p"));
+    ck_assert_uint_eq(heard, 1);
+    ck_assert_int_eq(dom_event_target_remove_event_listener(body, type, listener, false), DOM_NO_ERR);
+
+    dom_event_listener_unref(listener);
+    dom_string_unref(type);
+    dom_node_unref(body);
+    dom_node_unref(doc);
+}
+END_TEST
+
+
+static Suite *dom_mutation_record_suite(void)
+{
+    Suite *s = suite_create("DOM mutation records");
+    TCase *tc = tcase_create("Queue");
+
+    tcase_add_test(tc, mutation_record_batch_test);
+    tcase_add_test(tc, mutation_record_unobserve_test);
+    tcase_add_test(tc, mutation_record_events_test);
+    tcase_add_test(tc, mutation_record_generation_test);
+    tcase_add_test(tc, mutation_record_adopt_test);
+    tcase_add_test(tc, mutation_record_listener_release_test);
+    tcase_add_test(tc, mutation_record_event_reuse_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = dom_mutation_record_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,551 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the global history.
+ *
+ * The global history and the real treeview are driven against a stub URL
+ * database.  The URL index is checked against a scan of the day lists as
+ * entries are added, revisited and removed.  Loading is checked to leave
+ * every day list sorted with only today's entries in the treeview, and
+ * folders held back at load are checked to be populated when they are
+ * expanded, searched or deleted.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/utils/nsoption.h>
+#include "utils/corestrings.h"
+
+#include "desktop/global_history.c"
+
+/** Most URLs the stub URL database holds */
+#define TEST_URLS 1200
+
+/** Stub URL database */
+static struct {
+    nsurl *url[TEST_URLS];
+    struct url_data data[TEST_URLS];
+    unsigned int count;
+} test_urldb;
+
+/** Number of URLs whose visit data was reset */
+static unsigned int visit_resets;
+
+/** Start of today, as the global history works it out */
+static time_t test_today;
+
+void urldb_iterate_entries(bool (*callback)(nsurl *url, const struct url_data *data))
+{
+    unsigned int i;
+
+    for (i = 0; i < test_urldb.count; i++) {
+        if (!callback(test_urldb.url[i], &test_urldb.data[i])) {
+            break;
+        }
+    }
+}
+
+const struct url_data *urldb_get_url_data(nsurl *url)
+{
+    unsigned int i;
+
+    for (i = 0; i < test_urldb.count; i++) {
+        if (nsurl_compare(test_urldb.url[i], url, NSURL_COMPLETE)) {
+            return &test_urldb.data[i];
+        }
+    }
+    return NULL;
+}
+
+void urldb_reset_url_visit_data(nsurl *url)
+{
+    visit_resets++;
+}
+
+const char *messages_get(const char *key)
+{
+    return key;
+}
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+nserror browser_window_create(enum browser_window_create_flags flags, nsurl *url, nsurl *referrer,
+    struct browser_window *existing, struct browser_window **bw)
+{
+    return NSERROR_OK;
+}
+
+
+/**
+ * Put a URL in the stub URL database
+ *
+ * \param days_ago Number of days before today it was last visited
+ * \param second Second into the day it was last visited
+ * \return the URL's index in the stub URL database
+ */
+static unsigned int test_urldb_add(int days_ago, int second)
+{
+    unsigned int i = test_urldb.count++;
+    char url[64];
+
+    ck_assert_uint_lt(i, TEST_URLS);
+
+    snprintf(url, sizeof(url), "http://www.example.com/page%u.html", i);
+    ck_assert_int_eq(nsurl_create(url, &test_urldb.url[i]), NSERROR_OK);
+
+    test_urldb.data[i].title = NULL;
+    test_urldb.data[i].visits = 1;
+    test_urldb.data[i].last_visit = test_today - (time_t)days_ago * N_SEC_PER_DAY + second;
+    test_urldb.data[i].type = CONTENT_HTML;
+
+    return i;
+}
+
+/**
+ * Visit a URL in the stub URL database again, today
+ *
+ * \param i The URL's index in the stub URL database
+ * \param second Second into today it was visited
+ */
+static void test_revisit(unsigned int i, int second)
+{
+    test_urldb.data[i].visits++;
+    test_urldb.data[i].last_visit = test_today + second;
+    ck_assert_int_eq(global_history_add(test_urldb.url[i]), NSERROR_OK);
+}
+
+/**
+ * Find an entry by scanning every day list
+ */
+static struct global_history_entry *linear_find(nsurl *url)
+{
+    struct global_history_entry *e;
+    int i;
+
+    for (i = 0; i < N_DAYS; i++) {
+        for (e = gh_list[i]; e != NULL; e = e->next) {
+            if (nsurl_compare(e->url, url, NSURL_COMPLETE)) {
+                return e;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Check the URL index finds what a scan of the day lists finds for every
+ * URL in the stub URL database, and holds nothing else
+ */
+static void check_index(void)
+{
+    struct global_history_entry *e;
+    unsigned int entries = 0;
+    unsigned int i;
+
+    for (i = 0; i < test_urldb.count; i++) {
+        ck_assert_ptr_eq(global_history_find(test_urldb.url[i]), linear_find(test_urldb.url[i]));
+    }
+
+    for (i = 0; i < N_DAYS; i++) {
+        for (e = gh_list[i]; e != NULL; e = e->next) {
+            entries++;
+        }
+    }
+    ck_assert_uint_eq(gh_index.count, entries);
+}
+
+/**
+ * Check every day list is most recent first, with consistent links
+ */
+static void check_lists(void)
+{
+    struct global_history_entry *e;
+    int i;
+
+    for (i = 0; i < N_DAYS; i++) {
+        for (e = gh_list[i]; e != NULL; e = e->next) {
+            ck_assert_int_eq(e->slot, i);
+            if (e->prev == NULL) {
+                ck_assert_ptr_eq(gh_list[i], e);
+            } else {
+                ck_assert_ptr_eq(e->prev->next, e);
+                ck_assert_int_ge(e->prev->t, e->t);
+            }
+        }
+    }
+}
+
+/**
+ * Check whether a folder's entries are all in the treeview, or none are
+ */
+static void check_folder_populated(enum global_history_folders f, bool populated)
+{
+    struct global_history_entry *e;
+    int i;
+
+    ck_assert(gh_ctx.folders[f].deferred == !populated);
+
+    for (i = 0; i < N_DAYS; i++) {
+        if (global_history_slot_folder(i) != f) {
+            continue;
+        }
+        for (e = gh_list[i]; e != NULL; e = e->next) {
+            ck_assert((e->entry != NULL) == populated);
+        }
+    }
+}
+
+/** Entries seen by a treeview walk, in order */
+struct walk_entries {
+    struct global_history_entry *e[TEST_URLS];
+    unsigned int count;
+};
+
+static nserror walk_entry_cb(void *ctx, void *node_data, enum treeview_node_type type, bool *abort)
+{
+    struct walk_entries *w = ctx;
+
+    w->e[w->count++] = node_data;
+    return NSERROR_OK;
+}
+
+
+static void global_history_setup(void)
+{
+    struct tm *full_time;
+    time_t t;
+
+    ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+    ck_assert_int_eq(nsoption_init(NULL, NULL, NULL), NSERROR_OK);
+
+    /* Work out the start of today the way the global history does */
+    t = time(NULL);
+    full_time = localtime(&t);
+    full_time->tm_sec = 0;
+    full_time->tm_min = 0;
+    full_time->tm_hour = 0;
+    test_today = mktime(full_time);
+
+    test_urldb.count = 0;
+    visit_resets = 0;
+}
+
+static void global_history_teardown(void)
+{
+    unsigned int i;
+
+    ck_assert_int_eq(global_history_fini(), NSERROR_OK);
+
+    /* Every entry is gone and the index is back to its static buckets */
+    ck_assert_uint_eq(gh_index.count, 0);
+    ck_assert_ptr_eq(gh_index.buckets, gh_index_initial);
+
+    for (i = 0; i < test_urldb.count; i++) {
+        nsurl_unref(test_urldb.url[i]);
+    }
+
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+}
+
+
+/**
+ * Loading sorts each day, indexes every entry and adds only today's
+ * entries to the treeview.
+ */
+START_TEST(global_history_load_test)
+{
+    unsigned int too_old;
+    int f;
+
+    /* Out of order, as urldb iterates by host */
+    test_urldb_add(0, 100);
+    test_urldb_add(3, 500);
+    test_urldb_add(0, 300);
+    test_urldb_add(10, 100);
+    test_urldb_add(3, 40000);
+    test_urldb_add(1, 7000);
+    too_old = test_urldb_add(40, 100);
+    test_urldb_add(0, 200);
+    test_urldb_add(10, 3600);
+    test_urldb_add(20, 100);
+    test_urldb_add(1, 6000);
+    test_urldb_add(27, 100);
+    test_urldb_add(3, 500);
+
+    ck_assert_int_eq(global_history_init(NULL), NSERROR_OK);
+
+    check_lists();
+    check_index();
+    ck_assert_uint_eq(gh_index.count, test_urldb.count - 1);
+    ck_assert_ptr_null(global_history_find(test_urldb.url[too_old]));
+
+    ck_assert_int_eq(gh_list[0]->t, test_today + 300);
+    ck_assert_int_eq(gh_list[3]->t, test_today - 3 * N_SEC_PER_DAY + 40000);
+
+    /* Only today's folder has its entries; the rest are held back */
+    check_folder_populated(GH_TODAY, true);
+    for (f = GH_YESTERDAY; f < GH_N_FOLDERS; f++) {
+        if (gh_ctx.folders[f].folder != NULL) {
+            check_folder_populated(f, false);
+        }
+    }
+    ck_assert_ptr_nonnull(gh_ctx.folders[GH_3_DAYS_AGO].folder);
+    ck_assert_ptr_null(gh_ctx.folders[GH_2_DAYS_AGO].folder);
+}
+END_TEST
+
+
+/**
+ * The URL index finds what a scan of the day lists finds as entries are
+ * added, revisited and removed, including while the index grows and
+ * shrinks back.
+ */
+START_TEST(global_history_index_test)
+{
+    struct global_history_entry *e;
+    unsigned int added;
+    unsigned int i;
+
+    ck_assert_int_eq(global_history_init(NULL), NSERROR_OK);
+
+    for (i = 0; i < 1000; i++) {
+        added = test_urldb_add(0, i);
+        ck_assert_int_eq(global_history_add(test_urldb.url[added]), NSERROR_OK);
+    }
+    check_index();
+    ck_assert_uint_eq(gh_index.count, 1000);
+    ck_assert_uint_gt(gh_index.size, GH_INDEX_INITIAL);
+
+    /* Revisiting replaces the entry */
+    for (i = 0; i < 1000; i += 3) {
+        test_revisit(i, 2000 + i);
+        e = global_history_find(test_urldb.url[i]);
+        ck_assert_ptr_nonnull(e);
+        ck_assert_int_eq(e->t, test_today + 2000 + i);
+    }
+    check_lists();
+    check_index();
+    ck_assert_uint_eq(gh_index.count, 1000);
+
+    /* Remove every other entry */
+    for (i = 0; i < 1000; i += 2) {
+        e = global_history_find(test_urldb.url[i]);
+        ck_assert_ptr_nonnull(e);
+        ck_assert_int_eq(treeview_delete_node(gh_ctx.tree, e->entry, TREE_OPTION_NONE), NSERROR_OK);
+        ck_assert_ptr_null(global_history_find(test_urldb.url[i]));
+    }
+    check_index();
+    ck_assert_uint_eq(gh_index.count, 500);
+
+    /* Remove the rest */
+    for (i = 1; i < 1000; i += 2) {
+        e = global_history_find(test_urldb.url[i]);
+        ck_assert_ptr_nonnull(e);
+        ck_assert_int_eq(treeview_delete_node(gh_ctx.tree, e->entry, TREE_OPTION_NONE), NSERROR_OK);
+    }
+    check_index();
+    ck_assert_uint_eq(gh_index.count, 0);
+    ck_assert_ptr_eq(gh_index.buckets, gh_index_initial);
+
+    /* Deleted by the client, not the user */
+    ck_assert_uint_eq(visit_resets, 0);
+}
+END_TEST
+
+
+/**
+ * Expanding a held back folder adds its entries to the treeview in the
+ * order they had when every folder was filled at startup.
+ */
+START_TEST(global_history_expand_test)
+{
+    struct walk_entries *w = calloc(1, sizeof(*w));
+    struct global_history_entry *e;
+    unsigned int n = 0;
+    int i;
+
+    test_urldb_add(0, 100);
+    for (i = 0; i < 6; i++) {
+        test_urldb_add(8, 1000 * i);
+        test_urldb_add(12, 1000 * i);
+        test_urldb_add(10, 1000 * i);
+    }
+    test_urldb_add(20, 100);
+
+    ck_assert_int_eq(global_history_init(NULL), NSERROR_OK);
+    check_folder_populated(GH_LAST_WEEK, false);
+
+    ck_assert_int_eq(treeview_node_expand(gh_ctx.tree, gh_ctx.folders[GH_LAST_WEEK].folder), NSERROR_OK);
+    check_folder_populated(GH_LAST_WEEK, true);
+    check_folder_populated(GH_2_WEEKS_AGO, false);
+
+    /* Each slot inserts its entries at the top of the folder in turn */
+    ck_assert_int_eq(treeview_walk(gh_ctx.tree, gh_ctx.folders[GH_LAST_WEEK].folder, walk_entry_cb, NULL, w,
+                         TREE_NODE_ENTRY),
+        NSERROR_OK);
+    for (i = 13; i >= 7; i--) {
+        for (e = gh_list[i]; e != NULL; e = e->next) {
+            ck_assert_uint_lt(n, w->count);
+            ck_assert_ptr_eq(w->e[n++], e);
+        }
+    }
+    ck_assert_uint_eq(n, w->count);
+    ck_assert_uint_eq(n, 18);
+
+    /* Expanding again adds nothing */
+    ck_assert_int_eq(treeview_node_contract(gh_ctx.tree, gh_ctx.folders[GH_LAST_WEEK].folder), NSERROR_OK);
+    ck_assert_int_eq(treeview_node_expand(gh_ctx.tree, gh_ctx.folders[GH_LAST_WEEK].folder), NSERROR_OK);
+    w->count = 0;
+    ck_assert_int_eq(treeview_walk(gh_ctx.tree, gh_ctx.folders[GH_LAST_WEEK].folder, walk_entry_cb, NULL, w,
+                         TREE_NODE_ENTRY),
+        NSERROR_OK);
+    ck_assert_uint_eq(w->count, 18);
+
+    check_index();
+    free(w);
+}
+END_TEST
+
+
+/**
+ * Searching populates every held back folder, so their entries can be
+ * matched.
+ */
+START_TEST(global_history_search_test)
+{
+    int f;
+
+    test_urldb_add(0, 100);
+    test_urldb_add(1, 100);
+    test_urldb_add(5, 100);
+    test_urldb_add(9, 100);
+    test_urldb_add(16, 100);
+    test_urldb_add(23, 100);
+
+    ck_assert_int_eq(global_history_init(NULL), NSERROR_OK);
+    check_folder_populated(GH_YESTERDAY, false);
+
+    ck_assert_int_eq(treeview_set_search_string(gh_ctx.tree, "page"), NSERROR_OK);
+
+    for (f = GH_TODAY; f < GH_N_FOLDERS; f++) {
+        if (gh_ctx.folders[f].folder != NULL) {
+            check_folder_populated(f, true);
+        }
+    }
+    check_index();
+
+    ck_assert_int_eq(treeview_set_search_string(gh_ctx.tree, NULL), NSERROR_OK);
+}
+END_TEST
+
+
+/**
+ * Deleting a held back folder populates it first, so its entries are
+ * deleted with it.
+ */
+START_TEST(global_history_delete_test)
+{
+    unsigned int kept, gone[3];
+
+    kept = test_urldb_add(0, 100);
+    gone[0] = test_urldb_add(4, 100);
+    gone[1] = test_urldb_add(4, 200);
+    gone[2] = test_urldb_add(4, 300);
+    test_urldb_add(15, 100);
+
+    ck_assert_int_eq(global_history_init(NULL), NSERROR_OK);
+    check_folder_populated(GH_4_DAYS_AGO, false);
+
+    ck_assert_int_eq(treeview_delete_node(gh_ctx.tree, gh_ctx.folders[GH_4_DAYS_AGO].folder, TREE_OPTION_NONE),
+        NSERROR_OK);
+
+    ck_assert_ptr_null(gh_ctx.folders[GH_4_DAYS_AGO].folder);
+    ck_assert_ptr_null(gh_list[4]);
+    ck_assert_ptr_null(global_history_find(test_urldb.url[gone[0]]));
+    ck_assert_ptr_null(global_history_find(test_urldb.url[gone[1]]));
+    ck_assert_ptr_null(global_history_find(test_urldb.url[gone[2]]));
+    ck_assert_ptr_nonnull(global_history_find(test_urldb.url[kept]));
+    check_index();
+
+    /* The other held back folder is untouched */
+    check_folder_populated(GH_2_WEEKS_AGO, false);
+}
+END_TEST
+
+
+/**
+ * Revisiting a page from a held back folder moves its entry to today
+ * without populating the folder, and the folder goes once it's empty.
+ */
+START_TEST(global_history_revisit_deferred_test)
+{
+    unsigned int a, b;
+    struct global_history_entry *e;
+
+    test_urldb_add(0, 100);
+    a = test_urldb_add(2, 100);
+    b = test_urldb_add(2, 200);
+
+    ck_assert_int_eq(global_history_init(NULL), NSERROR_OK);
+    check_folder_populated(GH_2_DAYS_AGO, false);
+
+    test_revisit(a, 500);
+    e = global_history_find(test_urldb.url[a]);
+    ck_assert_ptr_nonnull(e);
+    ck_assert_int_eq(e->slot, 0);
+    ck_assert_ptr_nonnull(e->entry);
+    ck_assert_ptr_nonnull(gh_ctx.folders[GH_2_DAYS_AGO].folder);
+    check_folder_populated(GH_2_DAYS_AGO, false);
+
+    test_revisit(b, 600);
+    ck_assert_ptr_null(gh_ctx.folders[GH_2_DAYS_AGO].folder);
+    ck_assert_ptr_null(gh_list[2]);
+
+    check_lists();
+    check_index();
+    ck_assert_uint_eq(gh_index.count, 3);
+}
+END_TEST
+
+
+static Suite *global_history_suite(void)
+{
+    Suite *s = suite_create("global_history");
+    TCase *tc = tcase_create("History");
+
+    tcase_add_checked_fixture(tc, global_history_setup, global_history_teardown);
+    tcase_add_test(tc, global_history_load_test);
+    tcase_add_test(tc, global_history_index_test);
+    tcase_add_test(tc, global_history_expand_test);
+    tcase_add_test(tc, global_history_search_test);
+    tcase_add_test(tc, global_history_delete_test);
+    tcase_add_test(tc, global_history_revisit_deferred_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = global_history_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,638 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the high level cache.
+ *
+ * The real high level cache is driven against stub low level cache and
+ * content implementations which count conversions, so content sharing,
+ * buffer deduplication and reuse of retained contents by history
+ * navigation can be checked to avoid reconverting.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/content/hlcache.h>
+#include <wisp/content/llcache.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/misc.h>
+#include <wisp/utils/messages.h>
+#include <wisp/utils/utils.h>
+#include "content/content_factory.h"
+#include "content/mimesniff.h"
+#include "utils/corestrings.h"
+
+/** Size of each converted test content */
+#define PAGE_SIZE 1000
+
+/** Number of contents converted */
+static unsigned int conversions;
+
+/** Number of contents destroyed */
+static unsigned int destroyed;
+
+/** Number of CONTENT_MSG_DONE events delivered to handles */
+static unsigned int done_events;
+
+/** Generation of the fetched objects, bumped to make them stale */
+static unsigned int object_generation;
+
+/** Whether new contents may be shared between users */
+static bool shareable;
+
+/** Scheduled background clean */
+static void (*scheduled_clean)(void *p);
+
+/* Stub low level cache */
+
+struct llcache_handle {
+    nsurl *url;
+    unsigned int object;
+    uint8_t *data;
+    size_t len;
+    llcache_handle_callback cb;
+    void *pw;
+};
+
+/** Low level handle waiting for its headers */
+static llcache_handle *fetching;
+
+nserror llcache_initialise(const struct llcache_parameters *parameters)
+{
+    return NSERROR_OK;
+}
+
+void llcache_finalise(void)
+{
+}
+
+void llcache_clean(bool purge)
+{
+}
+
+nserror llcache_handle_retrieve(nsurl *url, uint32_t flags, nsurl *referer, const llcache_post_data *post,
+    llcache_handle_callback cb, void *pw, llcache_handle **result)
+{
+    llcache_handle *h = calloc(1, sizeof(*h));
+
+    ck_assert(h != NULL);
+    h->url = nsurl_ref(url);
+    h->object = object_generation;
+    h->cb = cb;
+    h->pw = pw;
+
+    fetching = h;
+    *result = h;
+
+    return NSERROR_OK;
+}
+
+nserror llcache_handle_retrieve_buffer(nsurl *url, const uint8_t *data, size_t len, const char *mime_type,
+    llcache_handle_callback cb, void *pw, llcache_handle **result)
+{
+    llcache_handle *h;
+
+    llcache_handle_retrieve(url, 0, NULL, NULL, cb, pw, &h);
+    h->data = malloc(len);
+    ck_assert(h->data != NULL);
+    memcpy(h->data, data, len);
+    h->len = len;
+
+    *result = h;
+
+    return NSERROR_OK;
+}
+
+nserror llcache_handle_change_callback(llcache_handle *handle, llcache_handle_callback cb, void *pw)
+{
+    handle->cb = cb;
+    handle->pw = pw;
+    return NSERROR_OK;
+}
+
+nserror llcache_handle_release(llcache_handle *handle)
+{
+    if (fetching == handle)
+        fetching = NULL;
+    nsurl_unref(handle->url);
+    free(handle->data);
+    free(handle);
+    return NSERROR_OK;
+}
+
+nserror llcache_handle_clone(llcache_handle *handle, llcache_handle **result)
+{
+    return llcache_handle_retrieve(handle->url, 0, NULL, NULL, handle->cb, handle->pw, result);
+}
+
+nserror llcache_handle_abort(llcache_handle *handle)
+{
+    return NSERROR_OK;
+}
+
+nserror llcache_handle_force_stream(llcache_handle *handle)
+{
+    return NSERROR_OK;
+}
+
+nsurl *llcache_handle_get_url(const llcache_handle *handle)
+{
+    return handle->url;
+}
+
+const char *llcache_handle_get_header(const llcache_handle *handle, const char *key)
+{
+    return "text/html";
+}
+
+bool llcache_handle_references_same_object(const llcache_handle *a, const llcache_handle *b)
+{
+    return nsurl_compare(a->url, b->url, NSURL_COMPLETE) && a->object == b->object;
+}
+
+uintptr_t llcache_handle_get_object_id(const llcache_handle *handle)
+{
+    return (uintptr_t)nsurl_hash(handle->url) * 31 + handle->object + 1;
+}
+
+/* Stub content factory and contents */
+
+struct test_content {
+    struct content base;
+    uint32_t users;
+};
+
+static bool test_is_retainable(const struct content *c)
+{
+    return true;
+}
+
+static const content_handler test_handler = {
+    .is_retainable = test_is_retainable,
+    .no_share = true,
+};
+
+static const content_handler test_shared_handler = {
+    .is_retainable = test_is_retainable,
+};
+
+nserror mimesniff_compute_effective_type(const char *content_type_header, const uint8_t *data, size_t len,
+    bool sniff_allowed, bool image_only, lwc_string **effective_type)
+{
+    if (lwc_intern_string("text/html", SLEN("text/html"), effective_type) != lwc_error_ok)
+        return NSERROR_NOMEM;
+    return NSERROR_OK;
+}
+
+content_type content_factory_type_from_mime_type(lwc_string *mime_type)
+{
+    return CONTENT_HTML;
+}
+
+struct content *content_factory_create_content(
+    struct llcache_handle *llcache, const char *fallback_charset, bool quirks, lwc_string *effective_type)
+{
+    struct test_content *tc = calloc(1, sizeof(*tc));
+
+    ck_assert(tc != NULL);
+    tc->base.handler = shareable ? &test_shared_handler : &test_handler;
+    tc->base.llcache = llcache;
+    tc->base.status = CONTENT_STATUS_DONE;
+    tc->base.size = PAGE_SIZE;
+    conversions++;
+
+    return &tc->base;
+}
+
+bool content_add_user(struct content *c,
+    void (*callback)(struct content *c, content_msg msg, const union content_msg_data *data, void *pw), void *pw)
+{
+    ((struct test_content *)c)->users++;
+    return true;
+}
+
+void content_remove_user(struct content *c,
+    void (*callback)(struct content *c, content_msg msg, const union content_msg_data *data, void *pw), void *ctx)
+{
+    ((struct test_content *)c)->users--;
+}
+
+uint32_t content_count_users(struct content *c)
+{
+    return ((struct test_content *)c)->users;
+}
+
+void content_destroy(struct content *c)
+{
+    llcache_handle_release(c->llcache);
+    free(c);
+    destroyed++;
+}
+
+content_status content_get_status(struct hlcache_handle *h)
+{
+    return hlcache_handle_get_content(h)->status;
+}
+
+content_status content__get_status(struct content *c)
+{
+    return c->status;
+}
+
+content_type content_get_type(struct hlcache_handle *h)
+{
+    return CONTENT_HTML;
+}
+
+struct nsurl *content_get_url(struct content *c)
+{
+    return llcache_handle_get_url(c->llcache);
+}
+
+const struct llcache_handle *content_get_llcache_handle(struct content *c)
+{
+    return c->llcache;
+}
+
+const uint8_t *content__get_source_data(struct content *c, size_t *size)
+{
+    *size = c->llcache->len;
+    return c->llcache->data;
+}
+
+size_t content__get_source_length(struct content *c)
+{
+    return c->llcache->len;
+}
+
+bool content_is_shareable(struct content *c)
+{
+    return !c->handler->no_share;
+}
+
+bool content_is_retainable(struct content *c)
+{
+    return c->status == CONTENT_STATUS_DONE && c->handler->is_retainable(c);
+}
+
+bool content_matches_quirks(struct content *c, bool quirks)
+{
+    return true;
+}
+
+nserror content_abort(struct content *c)
+{
+    return NSERROR_OK;
+}
+
+void content_set_error(struct content *c)
+{
+    c->status = CONTENT_STATUS_ERROR;
+}
+
+struct content *content_clone(struct content *c)
+{
+    return NULL;
+}
+
+const char *messages_get(const char *key)
+{
+    return key;
+}
+
+/* Stub frontend */
+
+static nserror test_schedule(int t, void (*callback)(void *p), void *p)
+{
+    scheduled_clean = (t < 0) ? NULL : callback;
+    return NSERROR_OK;
+}
+
+static struct gui_misc_table test_misc_table = {
+    .schedule = test_schedule,
+};
+
+static struct wisp_table test_table = {
+    .misc = &test_misc_table,
+};
+
+struct wisp_table *guit = &test_table;
+
+
+static nserror handle_cb(hlcache_handle *handle, const hlcache_event *event, void *pw)
+{
+    if (event->type == CONTENT_MSG_DONE)
+        done_events++;
+    return NSERROR_OK;
+}
+
+static void hlcache_setup(size_t retain_limit)
+{
+    struct hlcache_parameters params = {
+        .bg_clean_time = 5000,
+        .retain_limit = retain_limit,
+    };
+
+    conversions = 0;
+    destroyed = 0;
+    done_events = 0;
+    object_generation = 0;
+    shareable = false;
+
+    ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+    ck_assert_int_eq(hlcache_initialise(&params), NSERROR_OK);
+}
+
+static void hlcache_teardown(void)
+{
+    hlcache_finalise();
+
+    /* Every converted content, retained or not, is gone */
+    ck_assert_uint_eq(destroyed, conversions);
+
+    corestrings_fini();
+}
+
+/**
+ * Deliver the headers of the pending low level fetch, if any
+ */
+static void fetch_headers(void)
+{
+    if (fetching != NULL) {
+        llcache_handle *llh = fetching;
+        llcache_event event = {
+            .type = LLCACHE_EVENT_HAD_HEADERS,
+        };
+
+        fetching = NULL;
+        llh->cb(llh, &event, llh->pw);
+    }
+}
+
+/**
+ * Fetch a page as a browser window would, delivering its headers
+ */
+static hlcache_handle *visit(const char *url, uint32_t flags)
+{
+    hlcache_handle *h;
+    nsurl *nu;
+
+    ck_assert_int_eq(nsurl_create(url, &nu), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_retrieve(nu, flags, NULL, NULL, handle_cb, NULL, NULL, CONTENT_HTML, &h),
+        NSERROR_OK);
+    nsurl_unref(nu);
+
+    fetch_headers();
+
+    ck_assert(hlcache_handle_get_content(h) != NULL);
+    return h;
+}
+
+/**
+ * Retrieve an inline buffer as the HTML object code would
+ */
+static hlcache_handle *inline_buffer(const char *data)
+{
+    hlcache_handle *h;
+
+    ck_assert_int_eq(hlcache_handle_retrieve_buffer((const uint8_t *)data, strlen(data), "image/svg+xml", handle_cb,
+                         NULL, NULL, CONTENT_HTML, &h),
+        NSERROR_OK);
+
+    fetch_headers();
+
+    ck_assert(hlcache_handle_get_content(h) != NULL);
+    return h;
+}
+
+static void run_clean(void)
+{
+    ck_assert(scheduled_clean != NULL);
+    scheduled_clean(NULL);
+}
+
+
+/**
+ * Shareable contents are found by URL and by low level object, however many
+ * contents are cached.
+ */
+START_TEST(index_share_test)
+{
+    hlcache_handle *h[300];
+    char url[64];
+    unsigned int i;
+
+    hlcache_setup(0);
+    shareable = true;
+
+    for (i = 0; i < 300; i++) {
+        snprintf(url, sizeof(url), "http://example.com/%u", i);
+        h[i] = visit(url, 0);
+    }
+    ck_assert_uint_eq(conversions, 300);
+
+    for (i = 0; i < 300; i++) {
+        hlcache_handle *again;
+
+        snprintf(url, sizeof(url), "http://example.com/%u", i);
+        again = visit(url, (i & 1) ? LLCACHE_RETRIEVE_FORCE_FETCH : 0);
+        ck_assert(hlcache_handle_get_content(again) == hlcache_handle_get_content(h[i]));
+        ck_assert_int_eq(hlcache_handle_release(again), NSERROR_OK);
+    }
+    ck_assert_uint_eq(conversions, 300);
+
+    /* A changed object is not shared */
+    object_generation++;
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/7", LLCACHE_RETRIEVE_FORCE_FETCH)),
+        NSERROR_OK);
+    ck_assert_uint_eq(conversions, 301);
+
+    for (i = 0; i < 300; i++) {
+        ck_assert_int_eq(hlcache_handle_release(h[i]), NSERROR_OK);
+    }
+    hlcache_teardown();
+}
+END_TEST
+
+
+/**
+ * Identical inline buffers share a content, different ones do not.
+ */
+START_TEST(index_buffer_test)
+{
+    static const char svg_a[] = "<svg xmlns='http://www.w3.org/2000/svg'><rect width='10' height='10'/></svg>";
+    static const char svg_b[] = "<svg xmlns='http://www.w3.org/2000/svg'><rect width='10' height='20'/></svg>";
+    hlcache_handle *a1, *a2, *b;
+
+    hlcache_setup(0);
+
+    a1 = inline_buffer(svg_a);
+    a2 = inline_buffer(svg_a);
+    b = inline_buffer(svg_b);
+    ck_assert_uint_eq(conversions, 2);
+    ck_assert(hlcache_handle_get_content(a1) == hlcache_handle_get_content(a2));
+    ck_assert(hlcache_handle_get_content(a1) != hlcache_handle_get_content(b));
+    ck_assert_uint_eq(done_events, 3);
+
+    /* Short buffers take the digest's tail path */
+    ck_assert_int_eq(hlcache_handle_release(inline_buffer("<svg/>")), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_release(inline_buffer("<svg />")), NSERROR_OK);
+    ck_assert_uint_eq(conversions, 4);
+
+    ck_assert_int_eq(hlcache_handle_release(a1), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_release(a2), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_release(b), NSERROR_OK);
+    hlcache_teardown();
+}
+END_TEST
+
+
+/**
+ * Going back to a released page reuses its converted content.
+ */
+START_TEST(retain_back_test)
+{
+    hlcache_handle *a, *b;
+    struct content *ca;
+
+    hlcache_setup(16 * PAGE_SIZE);
+
+    a = visit("http://example.com/a", 0);
+    ca = hlcache_handle_get_content(a);
+    ck_assert_int_eq(hlcache_handle_release(a), NSERROR_OK);
+
+    b = visit("http://example.com/b", 0);
+    run_clean();
+    ck_assert_uint_eq(conversions, 2);
+    ck_assert_uint_eq(destroyed, 0);
+
+    ck_assert_int_eq(hlcache_handle_release(b), NSERROR_OK);
+    done_events = 0;
+    a = visit("http://example.com/a", HLCACHE_RETRIEVE_RESTORE);
+    ck_assert_uint_eq(conversions, 2);
+    ck_assert(hlcache_handle_get_content(a) == ca);
+    ck_assert_uint_eq(done_events, 1);
+
+    ck_assert_int_eq(hlcache_handle_release(a), NSERROR_OK);
+    hlcache_teardown();
+}
+END_TEST
+
+
+/**
+ * Retained contents are only reused for history navigation, and a content
+ * in use is never handed to a second window.
+ */
+START_TEST(retain_navigate_test)
+{
+    hlcache_handle *a, *b;
+    struct content *ca;
+
+    hlcache_setup(16 * PAGE_SIZE);
+
+    a = visit("http://example.com/a", 0);
+    ca = hlcache_handle_get_content(a);
+    ck_assert_int_eq(hlcache_handle_release(a), NSERROR_OK);
+
+    a = visit("http://example.com/a", 0);
+    ck_assert_uint_eq(conversions, 2);
+    ck_assert(hlcache_handle_get_content(a) != ca);
+
+    b = visit("http://example.com/b", 0);
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/b", HLCACHE_RETRIEVE_RESTORE)), NSERROR_OK);
+    ck_assert_uint_eq(conversions, 4);
+
+    ck_assert_int_eq(hlcache_handle_release(b), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_release(a), NSERROR_OK);
+    hlcache_teardown();
+}
+END_TEST
+
+
+/**
+ * The least recently released contents are evicted to fit the budget.
+ */
+START_TEST(retain_budget_test)
+{
+    hlcache_setup(PAGE_SIZE + PAGE_SIZE / 2);
+
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/a", 0)), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/b", 0)), NSERROR_OK);
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/c", 0)), NSERROR_OK);
+    run_clean();
+    ck_assert_uint_eq(conversions, 3);
+    ck_assert_uint_eq(destroyed, 2);
+
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/c", HLCACHE_RETRIEVE_RESTORE)), NSERROR_OK);
+    ck_assert_uint_eq(conversions, 3);
+
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/a", HLCACHE_RETRIEVE_RESTORE)), NSERROR_OK);
+    ck_assert_uint_eq(conversions, 4);
+
+    hlcache_teardown();
+}
+END_TEST
+
+
+/**
+ * Nothing is retained without a budget, or once the source has changed.
+ */
+START_TEST(retain_stale_test)
+{
+    hlcache_setup(0);
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/a", 0)), NSERROR_OK);
+    run_clean();
+    ck_assert_uint_eq(destroyed, 1);
+    hlcache_teardown();
+
+    hlcache_setup(16 * PAGE_SIZE);
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/a", 0)), NSERROR_OK);
+    run_clean();
+    ck_assert_uint_eq(destroyed, 0);
+
+    object_generation++;
+    ck_assert_int_eq(hlcache_handle_release(visit("http://example.com/a", HLCACHE_RETRIEVE_RESTORE)), NSERROR_OK);
+    ck_assert_uint_eq(conversions, 2);
+    hlcache_teardown();
+}
+END_TEST
+
+
+static Suite *hlcache_suite(void)
+{
+    Suite *s = suite_create("hlcache");
+    TCase *tc_index = tcase_create("Index");
+    TCase *tc = tcase_create("Retain");
+
+    tcase_add_test(tc_index, index_share_test);
+    tcase_add_test(tc_index, index_buffer_test);
+    suite_add_tcase(s, tc_index);
+
+    tcase_add_test(tc, retain_back_test);
+    tcase_add_test(tc, retain_navigate_test);
+    tcase_add_test(tc, retain_budget_test);
+    tcase_add_test(tc, retain_stale_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = hlcache_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the image cache's handling of partly decoded bitmaps.
+ *
+ * Checks that a partly decoded bitmap is redrawn at once and then no more
+ * often than the progress interval, that it survives purges while it is
+ * being decoded into, and that handing the same bitmap to the cache keeps
+ * it while handing no bitmap discards it.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/desktop/gui_internal.h>
+#include "content/handlers/image/image_cache.h"
+
+#include "test/image_decode_stubs.h"
+
+/** Size of the test image */
+#define TEST_WIDTH 20
+#define TEST_HEIGHT 10
+
+/** Minimum interval between redraws of a partly decoded image / ms */
+#define TEST_PROGRESS_INTERVAL 250
+
+static struct content *content;
+static struct bitmap *bitmap;
+
+static void fixture_setup(void)
+{
+    stub_image_init(1024 * 1024);
+
+    content = calloc(1, sizeof(struct content));
+    ck_assert_ptr_nonnull(content);
+    content->width = TEST_WIDTH;
+    content->height = TEST_HEIGHT;
+
+    bitmap = guit->bitmap->create(TEST_WIDTH, TEST_HEIGHT, BITMAP_CLEAR);
+    ck_assert_ptr_nonnull(bitmap);
+    ck_assert_int_eq(image_cache_add_partial(content, bitmap), NSERROR_OK);
+}
+
+static void fixture_teardown(void)
+{
+    image_cache_remove(content);
+    free(content);
+    stub_image_fini();
+}
+
+/**
+ * Get the total size of the bitmaps the image cache holds.
+ */
+static unsigned long cache_bitmap_size(void)
+{
+    char summary[64];
+
+    image_cache_snsummaryf(summary, sizeof(summary), "%c");
+    return strtoul(summary, NULL, 10);
+}
+
+
+/**
+ * The first rows are redrawn at once, and later ones once the progress
+ * interval has passed since the last redraw.
+ */
+START_TEST(image_cache_progress_throttle_test)
+{
+    ck_assert(image_cache_progress_due(content));
+    image_cache_progress(content);
+    ck_assert_uint_eq(stub_redraw_count, 1);
+
+    ck_assert(image_cache_progress_due(content) == false);
+    stub_time += TEST_PROGRESS_INTERVAL - 1;
+    ck_assert(image_cache_progress_due(content) == false);
+    stub_time += 1;
+    ck_assert(image_cache_progress_due(content));
+
+    image_cache_progress(content);
+    ck_assert_uint_eq(stub_redraw_count, 2);
+    ck_assert(image_cache_progress_due(content) == false);
+}
+END_TEST
+
+/**
+ * Complete images, and contents the cache does not hold, are not redrawn
+ * as progress.
+ */
+START_TEST(image_cache_progress_complete_test)
+{
+    struct content other = {0};
+
+    ck_assert(image_cache_progress_due(&other) == false);
+    image_cache_progress(&other);
+
+    ck_assert_int_eq(image_cache_add(content, bitmap, NULL), NSERROR_OK);
+    stub_time += TEST_PROGRESS_INTERVAL;
+    ck_assert(image_cache_progress_due(content) == false);
+    image_cache_progress(content);
+
+    ck_assert_uint_eq(stub_redraw_count, 0);
+}
+END_TEST
+
+/**
+ * Handing the partly decoded bitmap to the cache keeps it as the image.
+ */
+START_TEST(image_cache_progress_keep_test)
+{
+    ck_assert_uint_eq(cache_bitmap_size(), TEST_WIDTH * TEST_HEIGHT * 4);
+
+    ck_assert_int_eq(image_cache_add(content, bitmap, NULL), NSERROR_OK);
+
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 0);
+    ck_assert_ptr_eq(image_cache_get_bitmap(content), bitmap);
+    ck_assert_uint_eq(cache_bitmap_size(), TEST_WIDTH * TEST_HEIGHT * 4);
+}
+END_TEST
+
+/**
+ * Handing no bitmap to the cache discards the partly decoded one.
+ */
+START_TEST(image_cache_progress_discard_test)
+{
+    ck_assert_int_eq(image_cache_add(content, NULL, NULL), NSERROR_OK);
+
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 1);
+    ck_assert_ptr_null(image_cache_get_bitmap(content));
+    ck_assert_uint_eq(cache_bitmap_size(), 0);
+}
+END_TEST
+
+/**
+ * Handing a different bitmap to the cache frees the partly decoded one and
+ * charges the cache for the new one alone.
+ */
+START_TEST(image_cache_progress_replace_test)
+{
+    struct bitmap *replacement;
+
+    replacement = guit->bitmap->create(TEST_WIDTH * 2, TEST_HEIGHT, BITMAP_CLEAR);
+    ck_assert_ptr_nonnull(replacement);
+    ck_assert_int_eq(image_cache_add(content, replacement, NULL), NSERROR_OK);
+
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 1);
+    ck_assert_ptr_eq(image_cache_get_bitmap(content), replacement);
+    ck_assert_uint_eq(cache_bitmap_size(), TEST_WIDTH * 2 * TEST_HEIGHT * 4);
+
+    image_cache_remove(content);
+    ck_assert_uint_eq(cache_bitmap_size(), 0);
+}
+END_TEST
+
+/**
+ * A bitmap being decoded into survives a purge, but not once complete.
+ */
+START_TEST(image_cache_progress_purge_test)
+{
+    image_cache_purge_bitmaps();
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 0);
+    ck_assert(image_cache_progress_due(content));
+
+    ck_assert_int_eq(image_cache_add(content, bitmap, NULL), NSERROR_OK);
+    image_cache_purge_bitmaps();
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 1);
+}
+END_TEST
+
+
+static Suite *image_cache_progress_suite(void)
+{
+    Suite *s = suite_create("image_cache_progress");
+    TCase *tc = tcase_create("Partial bitmaps");
+
+    tcase_add_checked_fixture(tc, fixture_setup, fixture_teardown);
+    tcase_add_test(tc, image_cache_progress_throttle_test);
+    tcase_add_test(tc, image_cache_progress_complete_test);
+    tcase_add_test(tc, image_cache_progress_keep_test);
+    tcase_add_test(tc, image_cache_progress_discard_test);
+    tcase_add_test(tc, image_cache_progress_replace_test);
+    tcase_add_test(tc, image_cache_progress_purge_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = image_cache_progress_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,44 @@
+/*
+ * Image cache stubs for tests of image content handlers which do not
+ * exercise the cache. Nothing is ever cached so vector content is
+ * always plotted directly.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <wisp/content.h>
+#include <wisp/plotters.h>
+#include <wisp/utils/errors.h>
+#include "content/handlers/image/image.h"
+#include "content/handlers/image/image_cache.h"
+
+nserror image_cache_add(struct content *content, struct bitmap *bitmap, image_cache_convert_fn *convert)
+{
+    (void)content;
+    (void)bitmap;
+    (void)convert;
+    return NSERROR_OK;
+}
+
+nserror image_cache_remove(struct content *content)
+{
+    (void)content;
+    return NSERROR_OK;
+}
+
+struct bitmap *image_cache_get_bitmap(const struct content *c)
+{
+    (void)c;
+    return NULL;
+}
+
+bool image_bitmap_plot(
+    struct bitmap *bitmap, struct content_redraw_data *data, const struct rect *clip, const struct redraw_context *ctx)
+{
+    (void)bitmap;
+    (void)data;
+    (void)clip;
+    (void)ctx;
+    return false;
+}
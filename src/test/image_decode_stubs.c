@@ -0,0 +1,304 @@
+/*
+ * Image decode stubs for tests which feed image content handlers their
+ * data in chunks and check what they hand to the image cache.
+ *
+ * Bitmaps are plain buffers in the client format.  The clock the image
+ * cache throttles redraws by only moves when the test moves it, and
+ * redraws are counted rather than plotted.  Contents are created through
+ * the content stubs, whose source data grows as chunks are delivered.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <nsutils/time.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/content/llcache.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/misc.h>
+#include <wisp/utils/errors.h>
+#include <wisp/utils/messages.h>
+#include <wisp/utils/nsurl.h>
+#include "desktop/bitmap.h"
+#include "content/handlers/image/image.h"
+#include "content/handlers/image/image_cache.h"
+
+#include "test/image_decode_stubs.h"
+
+extern const uint8_t *content_stubs_source_data;
+extern size_t content_stubs_source_size;
+
+struct bitmap {
+    int width;
+    int height;
+    bool opaque;
+    uint8_t *buffer;
+};
+
+uint64_t stub_time;
+unsigned int stub_redraw_count;
+unsigned int stub_bitmaps_created;
+unsigned int stub_bitmaps_destroyed;
+struct bitmap *stub_bitmap_last;
+
+
+static void *stub_bitmap_create(int width, int height, enum gui_bitmap_flags flags)
+{
+    struct bitmap *bitmap = calloc(1, sizeof(*bitmap));
+
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    /* always cleared, so rows a decoder has not reached read as such */
+    bitmap->buffer = calloc((size_t)width * height, 4);
+    if (bitmap->buffer == NULL) {
+        free(bitmap);
+        return NULL;
+    }
+    bitmap->width = width;
+    bitmap->height = height;
+    bitmap->opaque = (flags & BITMAP_OPAQUE) != 0;
+
+    stub_bitmaps_created++;
+    stub_bitmap_last = bitmap;
+
+    return bitmap;
+}
+
+static void stub_bitmap_destroy(void *vbitmap)
+{
+    struct bitmap *bitmap = vbitmap;
+
+    if (bitmap == stub_bitmap_last) {
+        stub_bitmap_last = NULL;
+    }
+    stub_bitmaps_destroyed++;
+    free(bitmap->buffer);
+    free(bitmap);
+}
+
+static void stub_bitmap_set_opaque(void *bitmap, bool opaque)
+{
+    ((struct bitmap *)bitmap)->opaque = opaque;
+}
+
+static bool stub_bitmap_get_opaque(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->opaque;
+}
+
+static unsigned char *stub_bitmap_get_buffer(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->buffer;
+}
+
+static size_t stub_bitmap_get_rowstride(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->width * 4;
+}
+
+static int stub_bitmap_get_width(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->width;
+}
+
+static int stub_bitmap_get_height(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->height;
+}
+
+static void stub_bitmap_modified(void *bitmap)
+{
+    (void)bitmap;
+}
+
+static struct gui_bitmap_table stub_bitmap_table = {
+    .create = stub_bitmap_create,
+    .destroy = stub_bitmap_destroy,
+    .set_opaque = stub_bitmap_set_opaque,
+    .get_opaque = stub_bitmap_get_opaque,
+    .get_buffer = stub_bitmap_get_buffer,
+    .get_rowstride = stub_bitmap_get_rowstride,
+    .get_width = stub_bitmap_get_width,
+    .get_height = stub_bitmap_get_height,
+    .modified = stub_bitmap_modified,
+};
+
+static nserror stub_schedule(int t, void (*callback)(void *p), void *p)
+{
+    (void)t;
+    (void)callback;
+    (void)p;
+    return NSERROR_OK;
+}
+
+static struct gui_misc_table stub_misc_table = {
+    .schedule = stub_schedule,
+};
+
+
+/* The monotonic clock, which only moves when the test moves it */
+
+nsuerror nsu_getmonotonic_ms(uint64_t *current_out)
+{
+    *current_out = stub_time;
+    return NSUERROR_OK;
+}
+
+
+/* Dependencies of the handlers and the image cache */
+
+void content_broadcast(struct content *c, content_msg msg, const union content_msg_data *data)
+{
+    (void)c;
+    (void)data;
+    if (msg == CONTENT_MSG_REDRAW) {
+        stub_redraw_count++;
+    }
+}
+
+size_t content__get_source_length(struct content *c)
+{
+    (void)c;
+    return content_stubs_source_size;
+}
+
+bool content__set_title(struct content *c, const char *title)
+{
+    (void)c;
+    (void)title;
+    return true;
+}
+
+nsurl *llcache_handle_get_url(const llcache_handle *handle)
+{
+    (void)handle;
+    return NULL;
+}
+
+const char *nsurl_access_leaf(const nsurl *url)
+{
+    (void)url;
+    return "";
+}
+
+bool nsurl_has_component(const nsurl *url, nsurl_component part)
+{
+    (void)url;
+    (void)part;
+    return false;
+}
+
+lwc_string *nsurl_get_component(const nsurl *url, nsurl_component part)
+{
+    (void)url;
+    (void)part;
+    return NULL;
+}
+
+char *messages_get_buff(const char *key, ...)
+{
+    (void)key;
+    return NULL;
+}
+
+bool image_bitmap_plot(
+    struct bitmap *bitmap, struct content_redraw_data *data, const struct rect *clip, const struct redraw_context *ctx)
+{
+    (void)bitmap;
+    (void)data;
+    (void)clip;
+    (void)ctx;
+    return true;
+}
+
+
+/* exported interface documented in test/image_decode_stubs.h */
+void stub_image_init(size_t speculative_small)
+{
+    struct image_cache_parameters params = {
+        .bg_clean_time = 5000,
+        .limit = 64 * 1024 * 1024,
+        .hysteresis = 1024 * 1024,
+        .speculative_small = speculative_small,
+    };
+
+    guit->bitmap = &stub_bitmap_table;
+    guit->misc = &stub_misc_table;
+
+    stub_time = 1000000;
+    stub_redraw_count = 0;
+    stub_bitmaps_created = 0;
+    stub_bitmaps_destroyed = 0;
+    stub_bitmap_last = NULL;
+    content_stubs_source_data = NULL;
+    content_stubs_source_size = 0;
+
+    image_cache_init(&params);
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+void stub_image_fini(void)
+{
+    image_cache_fini();
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+struct content *stub_image_create(const struct content_handler *handler)
+{
+    struct content *c = NULL;
+
+    if (handler->create(handler, NULL, NULL, NULL, NULL, false, &c) != NSERROR_OK) {
+        return NULL;
+    }
+    return c;
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+void stub_image_destroy(struct content *c)
+{
+    c->handler->destroy(c);
+    free(c);
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+bool stub_image_receive(
+    struct content *c, const uint8_t *data, size_t from, size_t to, size_t chunk, unsigned int interval)
+{
+    while (from < to) {
+        size_t size = (to - from < chunk) ? to - from : chunk;
+
+        content_stubs_source_data = data;
+        content_stubs_source_size = from + size;
+        if (c->handler->process_data(c, (const char *)data + from, size) == false) {
+            return false;
+        }
+        from += size;
+        stub_time += interval;
+    }
+    return true;
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+uint32_t stub_bitmap_pixel(struct bitmap *bitmap, int x, int y)
+{
+    uint32_t pixel;
+
+    memcpy(&pixel, bitmap->buffer + (size_t)y * bitmap->width * 4 + x * 4, 4);
+    return pixel;
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+uint8_t stub_bitmap_alpha(struct bitmap *bitmap, int x, int y)
+{
+    return bitmap->buffer[(size_t)y * bitmap->width * 4 + x * 4 + bitmap_layout.a];
+}
+
+/* exported interface documented in test/image_decode_stubs.h */
+bool stub_bitmap_opaque(struct bitmap *bitmap)
+{
+    return bitmap->opaque;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ */
+
+/**
+ * \file
+ *
+ * Interface to the image decode stubs.
+ *
+ * These stand in for the frontend, the clock and the content machinery so
+ * that image content handlers and the image cache can be fed data as a
+ * fetch would deliver it.
+ */
+
+#ifndef WISP_TEST_IMAGE_DECODE_STUBS_H
+#define WISP_TEST_IMAGE_DECODE_STUBS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct bitmap;
+struct content;
+struct content_handler;
+
+/** Time the image cache reads from the monotonic clock / ms */
+extern uint64_t stub_time;
+
+/** Number of redraws broadcast by the image cache */
+extern unsigned int stub_redraw_count;
+
+/** Number of bitmaps created */
+extern unsigned int stub_bitmaps_created;
+
+/** Number of bitmaps destroyed */
+extern unsigned int stub_bitmaps_destroyed;
+
+/** The bitmap created most recently, or NULL once it is destroyed */
+extern struct bitmap *stub_bitmap_last;
+
+/**
+ * Set up the frontend tables and the image cache.
+ *
+ * \param speculative_small Size of the largest image decoded as it arrives
+ */
+void stub_image_init(size_t speculative_small);
+
+/**
+ * Finalise the image cache, freeing any bitmaps it holds.
+ */
+void stub_image_fini(void);
+
+/**
+ * Create a content for a handler, with no data received.
+ *
+ * \param handler The image content handler
+ * \return The content
+ */
+struct content *stub_image_create(const struct content_handler *handler);
+
+/**
+ * Destroy a content created by stub_image_create().
+ *
+ * \param c The content
+ */
+void stub_image_destroy(struct content *c);
+
+/**
+ * Deliver data to a content in chunks, as a fetch would.
+ *
+ * The source data of the content grows to include each chunk before the
+ * chunk is processed.
+ *
+ * \param c The content
+ * \param data All the data of the image
+ * \param from Length of \a data already delivered
+ * \param to Length of \a data delivered once this returns
+ * \param chunk Size of each chunk
+ * \param interval Time to advance the clock by after each chunk / ms
+ * \return true if every chunk was processed, false if one failed
+ */
+bool stub_image_receive(
+    struct content *c, const uint8_t *data, size_t from, size_t to, size_t chunk, unsigned int interval);
+
+/**
+ * Get the value of a pixel of a bitmap.
+ *
+ * \param bitmap The bitmap
+ * \param x Column of the pixel
+ * \param y Row of the pixel
+ * \return The pixel, with its bytes in memory order
+ */
+uint32_t stub_bitmap_pixel(struct bitmap *bitmap, int x, int y);
+
+/**
+ * Get the alpha channel of a pixel of a bitmap.
+ *
+ * \param bitmap The bitmap
+ * \param x Column of the pixel
+ * \param y Row of the pixel
+ * \return The alpha of the pixel, zero if it has not been decoded
+ */
+uint8_t stub_bitmap_alpha(struct bitmap *bitmap, int x, int y);
+
+/**
+ * Get whether a bitmap has been marked opaque.
+ *
+ * \param bitmap The bitmap
+ * \return true if the bitmap is opaque
+ */
+bool stub_bitmap_opaque(struct bitmap *bitmap);
+
+#endif
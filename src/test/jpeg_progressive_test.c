@@ -0,0 +1,442 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for decoding JPEG images as their data arrives.
+ *
+ * Feeds encoded images to the JPEG content handler in chunks and compares
+ * the partly decoded bitmap with the image decoded in one go: baseline
+ * images must gain correct rows from the top, progressive images must
+ * cover the whole bitmap before they are complete, truncated images must
+ * be finished with what arrived, and the bitmap must be handed to the
+ * image cache at the end.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jpeglib.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/utils/utils.h>
+#include "desktop/bitmap.h"
+#include "content/handlers/image/image_cache.h"
+#include "content/handlers/image/jpeg.h"
+
+#include "test/image_decode_stubs.h"
+
+extern const struct content_handler *content_stubs_handler;
+
+/** Size of the test image, not a whole number of MCUs high */
+#define TEST_WIDTH 128
+#define TEST_HEIGHT 120
+
+/** Minimum interval between redraws of a partly decoded image / ms */
+#define TEST_PROGRESS_INTERVAL 250
+
+/** Chunk sizes the images are delivered in */
+static const size_t test_chunk[] = {1, 7, 64, 4096};
+
+static const struct content_handler *handler;
+static struct content *content;
+static unsigned char *image;
+static unsigned long image_size;
+
+/** The test image decoded in one go, in the client bitmap format */
+static uint32_t reference[TEST_WIDTH * TEST_HEIGHT];
+
+
+/**
+ * Encode the test image, a gradient with some detail.
+ *
+ * \param progressive true to encode it as a progressive JPEG
+ */
+static void test_jpeg_encode(bool progressive)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    JSAMPLE row[TEST_WIDTH * 3];
+    JSAMPROW rows[1] = {row};
+    int x;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &image, &image_size);
+
+    cinfo.image_width = TEST_WIDTH;
+    cinfo.image_height = TEST_HEIGHT;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    if (progressive) {
+        jpeg_simple_progression(&cinfo);
+    }
+
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            row[x * 3 + 0] = x * 2;
+            row[x * 3 + 1] = cinfo.next_scanline * 2;
+            row[x * 3 + 2] = 0x80 + (x ^ cinfo.next_scanline);
+        }
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+}
+
+/**
+ * Decode the whole test image in one go into the reference pixels.
+ */
+static void test_jpeg_decode(void)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    JSAMPLE row[TEST_WIDTH * 3];
+    JSAMPROW rows[1] = {row};
+    int x, y;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, image, image_size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.dct_method = JDCT_ISLOW;
+    jpeg_start_decompress(&cinfo);
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        ck_assert_uint_eq(jpeg_read_scanlines(&cinfo, rows, 1), 1);
+        for (x = 0; x < TEST_WIDTH; x++) {
+            uint8_t p[4];
+
+            p[bitmap_layout.r] = row[x * 3 + 0];
+            p[bitmap_layout.g] = row[x * 3 + 1];
+            p[bitmap_layout.b] = row[x * 3 + 2];
+            p[bitmap_layout.a] = 0xff;
+            memcpy(&reference[y * TEST_WIDTH + x], p, 4);
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+}
+
+/**
+ * Encode the test image and decode it in one go.
+ */
+static void test_jpeg_create(bool progressive)
+{
+    test_jpeg_encode(progressive);
+    test_jpeg_decode();
+}
+
+/**
+ * Check the rows decoded into a bitmap are the first rows of the image
+ * and are correct, while the rest are clear.
+ *
+ * \return The number of rows decoded
+ */
+static int check_rows(struct bitmap *bitmap)
+{
+    int rows = 0;
+    int x, y;
+
+    while (rows < TEST_HEIGHT && stub_bitmap_alpha(bitmap, 0, rows) != 0) {
+        rows++;
+    }
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            if (y < rows) {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), reference[y * TEST_WIDTH + x]);
+            } else {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), 0);
+            }
+        }
+    }
+
+    return rows;
+}
+
+/**
+ * Count the pixels of a bitmap which differ from the image decoded in one
+ * go, checking every pixel has been decoded.
+ */
+static int count_differences(struct bitmap *bitmap)
+{
+    int differences = 0;
+    int x, y;
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            ck_assert_uint_eq(stub_bitmap_alpha(bitmap, x, y), 0xff);
+            if (stub_bitmap_pixel(bitmap, x, y) != reference[y * TEST_WIDTH + x]) {
+                differences++;
+            }
+        }
+    }
+
+    return differences;
+}
+
+/**
+ * Finish the content and check the decoded bitmap was handed to the image
+ * cache as the image.
+ *
+ * \param bitmap The bitmap decoded as data arrived
+ */
+static void check_handoff(struct bitmap *bitmap)
+{
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_int_eq(content->status, CONTENT_STATUS_DONE);
+
+    ck_assert_uint_eq(stub_bitmaps_created, 1);
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 0);
+    ck_assert_ptr_eq(image_cache_get_bitmap(content), bitmap);
+    ck_assert(stub_bitmap_opaque(bitmap));
+}
+
+/**
+ * Set up the image cache and create a JPEG content.
+ *
+ * \param speculative_small Size of the largest image decoded as it arrives
+ */
+static void fixture_init(size_t speculative_small)
+{
+    stub_image_init(speculative_small);
+
+    ck_assert_int_eq(nsjpeg_init(), NSERROR_OK);
+    handler = content_stubs_handler;
+    content = stub_image_create(handler);
+    ck_assert_ptr_nonnull(content);
+
+    image = NULL;
+    image_size = 0;
+}
+
+static void fixture_setup(void)
+{
+    fixture_init(1024 * 1024);
+}
+
+static void fixture_setup_large(void)
+{
+    /* too large to be decoded as it arrives */
+    fixture_init(0);
+}
+
+static void fixture_teardown(void)
+{
+    stub_image_destroy(content);
+    free(image);
+    stub_image_fini();
+}
+
+
+/**
+ * Baseline images gain rows from the top as they arrive, whatever the
+ * chunks.
+ */
+START_TEST(jpeg_progressive_baseline_test)
+{
+    struct bitmap *bitmap;
+    int rows;
+
+    test_jpeg_create(false);
+
+    ck_assert(stub_image_receive(content, image, 0, image_size / 2, test_chunk[_i], 0));
+    bitmap = stub_bitmap_last;
+    ck_assert_ptr_nonnull(bitmap);
+    rows = check_rows(bitmap);
+    ck_assert_int_gt(rows, 0);
+    ck_assert_int_lt(rows, TEST_HEIGHT);
+
+    ck_assert(stub_image_receive(content, image, image_size / 2, image_size, test_chunk[_i], 0));
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+
+    check_handoff(bitmap);
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+}
+END_TEST
+
+/**
+ * Progressive images cover the whole bitmap coarsely, then sharpen to the
+ * image decoded in one go.
+ */
+START_TEST(jpeg_progressive_scans_test)
+{
+    struct bitmap *bitmap = NULL;
+    bool coarse = false;
+    size_t received;
+
+    test_jpeg_create(true);
+
+    for (received = 0; received < image_size; received += 64) {
+        size_t end = (received + 64 < image_size) ? received + 64 : image_size;
+
+        ck_assert(stub_image_receive(content, image, received, end, 64, TEST_PROGRESS_INTERVAL));
+        bitmap = stub_bitmap_last;
+        if (bitmap != NULL && end < image_size && stub_bitmap_alpha(bitmap, TEST_WIDTH - 1, TEST_HEIGHT - 1) != 0 &&
+            count_differences(bitmap) > 0) {
+            coarse = true;
+        }
+    }
+    ck_assert(coarse);
+
+    check_handoff(bitmap);
+    ck_assert_int_eq(count_differences(bitmap), 0);
+}
+END_TEST
+
+/**
+ * A progressive image arriving faster than it may be redrawn gets no new
+ * output pass after its first until a redraw is due, and is still
+ * complete at the end.
+ */
+START_TEST(jpeg_progressive_throttle_test)
+{
+    static uint32_t first[TEST_WIDTH * TEST_HEIGHT];
+    struct bitmap *bitmap = NULL;
+    size_t received = 0;
+    int x, y;
+
+    test_jpeg_create(true);
+
+    /* the first pass covers the bitmap */
+    while (bitmap == NULL || stub_bitmap_alpha(bitmap, TEST_WIDTH - 1, TEST_HEIGHT - 1) == 0) {
+        ck_assert_uint_lt(received, image_size / 2);
+        ck_assert(stub_image_receive(content, image, received, received + 16, 16, 0));
+        received += 16;
+        bitmap = stub_bitmap_last;
+    }
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            first[y * TEST_WIDTH + x] = stub_bitmap_pixel(bitmap, x, y);
+        }
+    }
+
+    /* later scans arrive but are not shown */
+    ck_assert(stub_image_receive(content, image, received, image_size - 16, 16, 0));
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), first[y * TEST_WIDTH + x]);
+        }
+    }
+    ck_assert_uint_eq(stub_redraw_count, 1);
+
+    ck_assert(stub_image_receive(content, image, image_size - 16, image_size, 16, 0));
+    check_handoff(bitmap);
+    ck_assert_int_eq(count_differences(bitmap), 0);
+}
+END_TEST
+
+/**
+ * An image whose data ends early keeps the rows which arrived and the
+ * rest of the bitmap is filled in.
+ */
+START_TEST(jpeg_progressive_truncated_test)
+{
+    struct bitmap *bitmap;
+    int rows;
+    int x, y;
+
+    test_jpeg_create(false);
+
+    ck_assert(stub_image_receive(content, image, 0, image_size / 2, 64, 0));
+    bitmap = stub_bitmap_last;
+    ck_assert_ptr_nonnull(bitmap);
+    rows = check_rows(bitmap);
+    ck_assert_int_lt(rows, TEST_HEIGHT);
+
+    check_handoff(bitmap);
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            ck_assert_uint_eq(stub_bitmap_alpha(bitmap, x, y), 0xff);
+            if (y < rows) {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), reference[y * TEST_WIDTH + x]);
+            }
+        }
+    }
+}
+END_TEST
+
+/**
+ * An image whose data ends within its header is an error.
+ */
+START_TEST(jpeg_progressive_truncated_header_test)
+{
+    test_jpeg_create(false);
+
+    ck_assert(stub_image_receive(content, image, 0, 30, 7, 0));
+    ck_assert(content->handler->data_complete(content) == false);
+
+    ck_assert_uint_eq(stub_bitmaps_created, 0);
+    ck_assert_uint_eq(stub_redraw_count, 0);
+}
+END_TEST
+
+/**
+ * Images too large to speculate on are decoded when they are needed.
+ */
+START_TEST(jpeg_progressive_large_test)
+{
+    struct bitmap *bitmap;
+
+    test_jpeg_create(true);
+
+    ck_assert(stub_image_receive(content, image, 0, image_size, 64, TEST_PROGRESS_INTERVAL));
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_uint_eq(stub_bitmaps_created, 0);
+    ck_assert_uint_eq(stub_redraw_count, 0);
+    ck_assert_int_eq(content->width, TEST_WIDTH);
+    ck_assert_int_eq(content->height, TEST_HEIGHT);
+
+    bitmap = image_cache_get_bitmap(content);
+    ck_assert_ptr_nonnull(bitmap);
+    ck_assert_int_eq(count_differences(bitmap), 0);
+}
+END_TEST
+
+
+static Suite *jpeg_progressive_suite(void)
+{
+    Suite *s = suite_create("jpeg_progressive");
+    TCase *tc = tcase_create("Progressive");
+    TCase *tc_large = tcase_create("Large");
+
+    tcase_add_checked_fixture(tc, fixture_setup, fixture_teardown);
+    tcase_add_loop_test(tc, jpeg_progressive_baseline_test, 0, NOF_ELEMENTS(test_chunk));
+    tcase_add_test(tc, jpeg_progressive_scans_test);
+    tcase_add_test(tc, jpeg_progressive_throttle_test);
+    tcase_add_test(tc, jpeg_progressive_truncated_test);
+    tcase_add_test(tc, jpeg_progressive_truncated_header_test);
+    suite_add_tcase(s, tc);
+
+    tcase_add_checked_fixture(tc_large, fixture_setup_large, fixture_teardown);
+    tcase_add_test(tc_large, jpeg_progressive_large_test);
+    suite_add_tcase(s, tc_large);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = jpeg_progressive_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Stress test for flex item layout caching with deeply nested flex
+ * containers.
+ *
+ * Each flex container lays its items out several times while measuring and
+ * placing them, so without the flex item layout cache the number of leaf
+ * layouts grows exponentially with nesting depth. Links the real
+ * layout_flex.c with a counting layout_block_context() stub. Style creation
+ * is in a separate translation unit to avoid enum collisions.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/content/handlers/html/box.h>
+#include <wisp/content/handlers/html/private.h>
+#include <wisp/utils/errors.h>
+#include "html/layout_internal.h"
+
+#include "layout_margin_collapse_style.h"
+
+/** Nesting depth of the stress test tree */
+static const int nest_depth = 8;
+
+/** Height the leaf stub gives blocks with auto height */
+static const int leaf_height = 20;
+
+/** Number of leaf block layouts performed */
+static unsigned int leaf_layouts;
+
+/** When set every leaf layout discards the flex item layout cache */
+static bool defeat_cache;
+
+/* ========================================================================
+ * Dependencies of layout_flex.c
+ * ======================================================================== */
+
+const css_len_func margin_funcs[4] = {
+    [TOP] = css_computed_margin_top,
+    [RIGHT] = css_computed_margin_right,
+    [BOTTOM] = css_computed_margin_bottom,
+    [LEFT] = css_computed_margin_left,
+};
+
+const css_len_func padding_funcs[4] = {
+    [TOP] = css_computed_padding_top,
+    [RIGHT] = css_computed_padding_right,
+    [BOTTOM] = css_computed_padding_bottom,
+    [LEFT] = css_computed_padding_left,
+};
+
+const css_len_func border_width_funcs[4] = {
+    [TOP] = css_computed_border_top_width,
+    [RIGHT] = css_computed_border_right_width,
+    [BOTTOM] = css_computed_border_bottom_width,
+    [LEFT] = css_computed_border_left_width,
+};
+
+const css_border_style_func border_style_funcs[4] = {
+    [TOP] = css_computed_border_top_style,
+    [RIGHT] = css_computed_border_right_style,
+    [BOTTOM] = css_computed_border_bottom_style,
+    [LEFT] = css_computed_border_left_style,
+};
+
+const css_border_color_func border_color_funcs[4] = {
+    [TOP] = css_computed_border_top_color,
+    [RIGHT] = css_computed_border_right_color,
+    [BOTTOM] = css_computed_border_bottom_color,
+    [LEFT] = css_computed_border_left_color,
+};
+
+dom_string *corestring_dom_class = NULL;
+
+bool layout_grid(struct box *grid, int available_width, html_content *content)
+{
+    return true;
+}
+
+bool layout_table(struct box *table, int available_width, html_content *content)
+{
+    return true;
+}
+
+/* Leaf blocks take a fixed height of content */
+bool layout_block_context(struct box *block, int viewport_height, html_content *content)
+{
+    leaf_layouts++;
+    if (defeat_cache) {
+        layout_flex_cache_reset();
+    }
+    if (block->height == AUTO) {
+        block->height = leaf_height;
+    }
+    return true;
+}
+
+/* ========================================================================
+ * Box tree helpers
+ * ======================================================================== */
+
+static html_content *create_test_content(void)
+{
+    html_content *c = calloc(1, sizeof(html_content));
+    assert(c != NULL);
+
+    c->unit_len_ctx.viewport_width = INTTOFIX(1024);
+    c->unit_len_ctx.viewport_height = INTTOFIX(768);
+    c->unit_len_ctx.font_size_default = INTTOFIX(16);
+    c->unit_len_ctx.font_size_minimum = INTTOFIX(0);
+    c->unit_len_ctx.device_dpi = INTTOFIX(96);
+
+    return c;
+}
+
+static struct box *create_box(box_type type, css_computed_style *style)
+{
+    struct box *b = calloc(1, sizeof(struct box));
+    assert(b != NULL);
+    b->type = type;
+    b->style = style;
+    b->width = AUTO;
+    b->height = AUTO;
+    return b;
+}
+
+static void add_child(struct box *parent, struct box *child)
+{
+    child->parent = parent;
+    if (parent->children == NULL) {
+        parent->children = child;
+    } else {
+        parent->last->next = child;
+        child->prev = parent->last;
+    }
+    parent->last = child;
+}
+
+static struct box *create_leaf(void)
+{
+    css_computed_style *s = create_block_style();
+    style_set_flex_item_defaults(s);
+    return create_box(BOX_BLOCK, s);
+}
+
+/**
+ * Build a flex container nesting depth more, alternating row and column
+ * direction, each level holding a leaf, the nested container and another
+ * leaf.
+ */
+static struct box *create_nested_flex(int depth, bool column, unsigned int *leaves)
+{
+    struct box *flex = create_box(BOX_FLEX, create_flex_style(column));
+
+    add_child(flex, create_leaf());
+    if (depth > 1) {
+        add_child(flex, create_nested_flex(depth - 1, !column, leaves));
+    } else {
+        add_child(flex, create_leaf());
+        (*leaves)++;
+    }
+    add_child(flex, create_leaf());
+    *leaves += 2;
+
+    return flex;
+}
+
+static void free_box_tree(struct box *box)
+{
+    struct box *child = box->children;
+    while (child != NULL) {
+        struct box *next = child->next;
+        free_box_tree(child);
+        child = next;
+    }
+    destroy_mock_style(box->style);
+    free(box->flex_cache);
+    free(box);
+}
+
+/** Geometry of a box tree, in tree order */
+struct tree_geometry {
+    int box[256][4];
+    unsigned int count;
+};
+
+static void record_geometry(const struct box *box, struct tree_geometry *g)
+{
+    ck_assert_uint_lt(g->count, 256);
+    g->box[g->count][0] = box->x;
+    g->box[g->count][1] = box->y;
+    g->box[g->count][2] = box->width;
+    g->box[g->count][3] = box->height;
+    g->count++;
+
+    for (const struct box *child = box->children; child != NULL; child = child->next) {
+        record_geometry(child, g);
+    }
+}
+
+/**
+ * Lay out a freshly built nested flex tree.
+ *
+ * \param use_cache   false to discard the cache on every leaf layout
+ * \param geometry    updated with the resulting geometry
+ * \param stats       updated with the flex item cache statistics
+ * \return number of leaf blocks in the tree
+ */
+static unsigned int layout_nested_tree(bool use_cache, struct tree_geometry *geometry, struct flex_cache_stats *stats)
+{
+    html_content *content = create_test_content();
+    unsigned int leaves = 0;
+    struct box *root = create_nested_flex(nest_depth, false, &leaves);
+
+    root->width = 800;
+    leaf_layouts = 0;
+    defeat_cache = !use_cache;
+    layout_flex_cache_reset();
+
+    ck_assert(layout_flex(root, 800, content));
+
+    defeat_cache = false;
+    layout_flex_cache_get_stats(stats);
+    memset(geometry, 0, sizeof(*geometry));
+    record_geometry(root, geometry);
+
+    free_box_tree(root);
+    free(content);
+
+    return leaves;
+}
+
+
+/**
+ * Leaf layouts stay linear in the number of leaves with 8 deep nesting.
+ */
+START_TEST(test_nested_flex_layout_count)
+{
+    static struct tree_geometry geometry;
+    struct flex_cache_stats stats;
+    unsigned int leaves;
+
+    leaves = layout_nested_tree(true, &geometry, &stats);
+
+    printf("%d deep nested flex: %u leaves, %u leaf layouts, %u item layouts, %u cache hits\n", nest_depth, leaves,
+        leaf_layouts, stats.layouts, stats.hits);
+
+    /* the root row holds columns of leaves */
+    ck_assert_int_eq(geometry.box[0][2], 800);
+    ck_assert_int_ge(geometry.box[0][3], leaf_height * 2);
+
+    ck_assert_uint_gt(stats.hits, 0);
+    ck_assert_uint_le(leaf_layouts, leaves * 3);
+}
+END_TEST
+
+
+/**
+ * Caching does not change the layout produced.
+ */
+START_TEST(test_nested_flex_cache_transparent)
+{
+    static struct tree_geometry cached, uncached;
+    struct flex_cache_stats cached_stats, uncached_stats;
+    unsigned int cached_leaf_layouts;
+
+    layout_nested_tree(true, &cached, &cached_stats);
+    cached_leaf_layouts = leaf_layouts;
+    layout_nested_tree(false, &uncached, &uncached_stats);
+
+    printf("leaf layouts: %u cached, %u uncached\n", cached_leaf_layouts, leaf_layouts);
+
+    ck_assert_uint_lt(cached_leaf_layouts, leaf_layouts);
+    ck_assert_uint_eq(cached.count, uncached.count);
+    for (unsigned int i = 0; i < cached.count; i++) {
+        ck_assert_msg(memcmp(cached.box[i], uncached.box[i], sizeof(cached.box[i])) == 0,
+            "box %u: cached %d,%d %dx%d uncached %d,%d %dx%d", i, cached.box[i][0], cached.box[i][1], cached.box[i][2],
+            cached.box[i][3], uncached.box[i][0], uncached.box[i][1], uncached.box[i][2], uncached.box[i][3]);
+    }
+}
+END_TEST
+
+
+/**
+ * A new cache generation forgets earlier layouts.
+ */
+START_TEST(test_nested_flex_cache_reset)
+{
+    static struct tree_geometry first, second;
+    struct flex_cache_stats stats;
+
+    layout_nested_tree(true, &first, &stats);
+    ck_assert_uint_gt(stats.layouts, 0);
+
+    layout_flex_cache_reset();
+    layout_flex_cache_get_stats(&stats);
+    ck_assert_uint_eq(stats.layouts, 0);
+    ck_assert_uint_eq(stats.hits, 0);
+
+    layout_nested_tree(true, &second, &stats);
+    ck_assert_uint_eq(first.count, second.count);
+    ck_assert(memcmp(first.box, second.box, sizeof(first.box[0]) * first.count) == 0);
+}
+END_TEST
+
+
+static Suite *layout_flex_nested_suite(void)
+{
+    Suite *s = suite_create("Nested flex layout");
+    TCase *tc = tcase_create("Flex item layout cache");
+
+    tcase_add_test(tc, test_nested_flex_layout_count);
+    tcase_add_test(tc, test_nested_flex_cache_transparent);
+    tcase_add_test(tc, test_nested_flex_cache_reset);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = layout_flex_nested_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
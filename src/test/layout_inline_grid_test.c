@@ -17,15 +17,8 @@
 #include "wisp/utils/errors.h"
 #include "wisp/utils/log.h"
 
-/* Forward declare html_content to satisfy layout_internal.h */
-typedef struct html_content html_content;
-
 #include "content/handlers/html/layout_internal.h"
-
-/* Mock dependencies */
-struct html_content {
-    struct css_unit_ctx unit_len_ctx;
-};
+#include "wisp/content/handlers/html/private.h"
 
 /* Mock content/layout functions */
 bool layout_block_context(struct box *block, int viewport_height, html_content *content)
@@ -206,7 +199,8 @@ START_TEST(test_inline_grid_auto_width_fails_assert)
     grid->width = UNKNOWN_WIDTH; /* AUTO */
     grid->height = UNKNOWN_WIDTH;
 
-    struct html_content content = {0};
+    /* layout_grid() uses the real content structure */
+    static struct html_content content;
 
     /* Call layout_grid */
     /* This should calculate width.
@@ -3,7 +3,7 @@
  *
  * This file is part of Wisp.
  *
- * Style factory for margin collapse tests.
+ * Style factory for margin collapse, nested flex layout and stacking tests.
  *
  * This translation unit ONLY includes libcss internal headers.
  * It must NOT include any Wisp headers (box.h, content_type.h, etc.)
@@ -93,6 +93,17 @@ void style_set_position_absolute(css_computed_style *s)
     set_position(s, CSS_POSITION_ABSOLUTE);
 }
 
+void style_set_z_index(css_computed_style *s, int32_t z_index)
+{
+    set_position(s, CSS_POSITION_RELATIVE);
+    set_z_index(s, CSS_Z_INDEX_SET, z_index);
+}
+
+void style_set_visibility_hidden(css_computed_style *s)
+{
+    set_visibility(s, CSS_VISIBILITY_HIDDEN);
+}
+
 void style_set_border_bottom(css_computed_style *s, int width)
 {
     set_border_bottom_width(s, CSS_BORDER_WIDTH_WIDTH, (css_fixed_or_calc)INTTOFIX(width), CSS_UNIT_PX);
@@ -115,6 +126,37 @@ void style_set_min_height(css_computed_style *s, int px)
         set_min_height(s, CSS_MIN_HEIGHT_AUTO, (css_fixed_or_calc)0, CSS_UNIT_PX);
 }
 
+void style_set_flex_item_defaults(css_computed_style *s)
+{
+    set_width(s, CSS_WIDTH_AUTO, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_min_width(s, CSS_MIN_WIDTH_AUTO, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_max_width(s, CSS_MAX_WIDTH_NONE, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_min_height(s, CSS_MIN_HEIGHT_AUTO, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_max_height(s, CSS_MAX_HEIGHT_NONE, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_flex_basis(s, CSS_FLEX_BASIS_AUTO, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_flex_grow(s, CSS_FLEX_GROW_SET, 0);
+    set_flex_shrink(s, CSS_FLEX_SHRINK_SET, INTTOFIX(1));
+    set_order(s, CSS_ORDER_SET, 0);
+    set_align_self(s, CSS_ALIGN_SELF_AUTO);
+    set_box_sizing(s, CSS_BOX_SIZING_CONTENT_BOX);
+}
+
+css_computed_style *create_flex_style(bool column)
+{
+    css_computed_style *s = create_block_style();
+
+    set_display(s, CSS_DISPLAY_FLEX);
+    set_flex_direction(s, column ? CSS_FLEX_DIRECTION_COLUMN : CSS_FLEX_DIRECTION_ROW);
+    set_flex_wrap(s, CSS_FLEX_WRAP_NOWRAP);
+    set_align_items(s, CSS_ALIGN_ITEMS_STRETCH);
+    set_justify_content(s, CSS_JUSTIFY_CONTENT_FLEX_START);
+    set_column_gap(s, CSS_COLUMN_GAP_NORMAL, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    set_row_gap(s, CSS_ROW_GAP_NORMAL, (css_fixed_or_calc)0, CSS_UNIT_PX);
+    style_set_flex_item_defaults(s);
+
+    return s;
+}
+
 void destroy_mock_style(css_computed_style *s)
 {
     free(s);
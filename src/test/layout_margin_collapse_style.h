@@ -11,6 +11,9 @@
 #ifndef LAYOUT_MARGIN_COLLAPSE_STYLE_H
 #define LAYOUT_MARGIN_COLLAPSE_STYLE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include <libcss/computed.h>
 
 /**
@@ -47,6 +50,12 @@ void style_set_overflow_hidden(css_computed_style *s);
 /** Set position: absolute. */
 void style_set_position_absolute(css_computed_style *s);
 
+/** Set position: relative with an explicit z-index. */
+void style_set_z_index(css_computed_style *s, int32_t z_index);
+
+/** Set visibility: hidden. */
+void style_set_visibility_hidden(css_computed_style *s);
+
 /** Set CSS bottom border width (in px). 0 = no border. */
 void style_set_border_bottom(css_computed_style *s, int width);
 
@@ -56,6 +65,21 @@ void style_set_padding_bottom(css_computed_style *s, int px);
 /** Set CSS min-height on a style (in px). 0 = auto. */
 void style_set_min_height(css_computed_style *s, int px);
 
+/**
+ * Give a style the initial values of the flex item properties:
+ *   width:auto, min/max sizes:auto/none, flex:0 1 auto, order:0,
+ *   align-self:auto, box-sizing:content-box
+ */
+void style_set_flex_item_defaults(css_computed_style *s);
+
+/**
+ * Create a css_computed_style configured as a flex container:
+ *   display:flex, flex-direction:row or column, flex-wrap:nowrap,
+ *   align-items:stretch, justify-content:flex-start, gaps:normal,
+ *   with the flex item defaults of style_set_flex_item_defaults()
+ */
+css_computed_style *create_flex_style(bool column);
+
 /** Free a mock style created by create_block_style(). */
 void destroy_mock_style(css_computed_style *s);
 
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for feeding source data to the HTML parser in runs.
+ *
+ * Reparses a document whose meta charset changes the encoding and whose
+ * blocking script pauses the parser before the end of the source, as the
+ * html handler does, and checks the source after the script is parsed once
+ * the parser resumes.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dom/dom.h>
+
+#include <wisp/utils/errors.h>
+#include "utils/libdom.h"
+
+/** Length of the runs the source is held in */
+#define TEST_RUN_LENGTH 16
+
+/** Document in ISO-8859-1 with a blocking script in its head */
+static const char test_source[] = "<html><head>"
+                                  "<meta charset=\"iso-8859-1\">"
+                                  "<script src=\"blocking.js\"></script>"
+                                  "</head><body>"
+                                  "<p id=\"after\">caf\xe9</p>"
+                                  "</body></html>";
+
+/** Runs handed to the parser */
+static unsigned int runs;
+
+/** Scripts seen by the parser */
+static unsigned int scripts;
+
+
+static const uint8_t *source_run(void *ctx, size_t offset, size_t *len)
+{
+    size_t size = strlen(test_source);
+
+    if (offset >= size) {
+        *len = 0;
+        return NULL;
+    }
+
+    *len = size - offset;
+    if (*len > TEST_RUN_LENGTH) {
+        *len = TEST_RUN_LENGTH;
+    }
+    runs++;
+
+    return (const uint8_t *)test_source + offset;
+}
+
+/* Every script blocks the parser until it is fetched */
+static dom_hubbub_error blocking_script(void *ctx, struct dom_node *node)
+{
+    scripts++;
+    return DOM_HUBBUB_HUBBUB_ERR | HUBBUB_PAUSED;
+}
+
+static dom_hubbub_parser *create_parser(const char *enc, dom_document **doc)
+{
+    dom_hubbub_parser_params params;
+    dom_hubbub_parser *parser;
+
+    memset(&params, 0, sizeof(params));
+    params.enc = enc;
+    params.fix_enc = (enc != NULL);
+    params.enable_script = true;
+    params.script = blocking_script;
+
+    ck_assert_int_eq(dom_hubbub_parser_create(&params, &parser, doc), DOM_HUBBUB_OK);
+
+    return parser;
+}
+
+
+/**
+ * The encoding change stops the first parse, and the reparse with the new
+ * encoding carries on feeding the source after the script pauses it.
+ */
+START_TEST(libdom_parse_runs_encoding_pause_test)
+{
+    dom_hubbub_encoding_source source;
+    dom_hubbub_parser *parser;
+    dom_document *doc;
+    dom_string *id, *text;
+    dom_element *p;
+    char *encoding;
+
+    runs = 0;
+    scripts = 0;
+
+    parser = create_parser(NULL, &doc);
+    ck_assert_int_eq(libdom_hubbub_parse_runs(parser, source_run, NULL),
+        DOM_HUBBUB_HUBBUB_ERR | HUBBUB_ENCODINGCHANGE);
+    ck_assert_uint_lt(runs, (strlen(test_source) + TEST_RUN_LENGTH - 1) / TEST_RUN_LENGTH);
+    ck_assert_uint_eq(scripts, 0);
+
+    encoding = strdup(dom_hubbub_parser_get_encoding(parser, &source));
+    ck_assert_ptr_nonnull(encoding);
+    dom_hubbub_parser_destroy(parser);
+    dom_node_unref(doc);
+
+    runs = 0;
+    parser = create_parser(encoding, &doc);
+    ck_assert_int_eq(libdom_hubbub_parse_runs(parser, source_run, NULL), DOM_HUBBUB_HUBBUB_ERR | HUBBUB_PAUSED);
+    ck_assert_uint_eq(runs, (strlen(test_source) + TEST_RUN_LENGTH - 1) / TEST_RUN_LENGTH);
+    ck_assert_uint_eq(scripts, 1);
+
+    /* the script has been fetched */
+    ck_assert_int_eq(dom_hubbub_parser_pause(parser, false), DOM_HUBBUB_OK);
+    ck_assert_int_eq(dom_hubbub_parser_completed(parser), DOM_HUBBUB_OK);
+
+    ck_assert_int_eq(dom_string_create((const uint8_t *)"after", 5, &id), DOM_NO_ERR);
+    ck_assert_int_eq(dom_document_get_element_by_id(doc, id, &p), DOM_NO_ERR);
+    ck_assert_ptr_nonnull(p);
+    ck_assert_int_eq(dom_node_get_text_content(p, &text), DOM_NO_ERR);
+    ck_assert_uint_eq(dom_string_byte_length(text), 5);
+    ck_assert(memcmp(dom_string_data(text), "caf\xc3\xa9", 5) == 0);
+
+    dom_string_unref(text);
+    dom_node_unref(p);
+    dom_string_unref(id);
+    dom_hubbub_parser_destroy(parser);
+    dom_node_unref(doc);
+    free(encoding);
+}
+END_TEST
+
+
+static Suite *libdom_parse_runs_suite(void)
+{
+    Suite *s = suite_create("libdom_parse_runs");
+    TCase *tc = tcase_create("Runs");
+
+    tcase_add_test(tc, libdom_parse_runs_encoding_pause_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = libdom_parse_runs_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
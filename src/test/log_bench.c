@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Logging throughput benchmark.
+ *
+ * Logs a number of messages to a verbose log file from the calling thread,
+ * as the UI thread would, and reports how long the caller spent per
+ * message, the longest single call, how long until every message was
+ * written and how many were dropped.  Run it with and without -sync-logs
+ * to compare writing on the caller with writing on the logging thread:
+ *
+ *   log_bench 200000
+ *   log_bench 200000 -sync-logs
+ *   log_bench 200000 -split-logs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <wisp/utils/log.h>
+
+/**
+ * Read a monotonic clock in nanoseconds.
+ */
+static uint64_t bench_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = getenv("TMPDIR");
+    char path[256];
+    char *log_argv[6];
+    int log_argc = 0;
+    bool sync_logs = false;
+    bool split_logs = false;
+    int messages = 100000;
+    uint64_t start, before, after, logged, drained, longest = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-sync-logs") == 0) {
+            sync_logs = true;
+        } else if (strcmp(argv[i], "-split-logs") == 0) {
+            split_logs = true;
+        } else {
+            messages = atoi(argv[i]);
+        }
+    }
+    if (messages <= 0) {
+        fprintf(stderr, "Usage: %s [messages] [-split-logs] [-sync-logs]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+#ifdef _WIN32
+    if (dir == NULL)
+        dir = getenv("TEMP");
+    if (dir == NULL)
+        dir = ".";
+    snprintf(path, sizeof(path), "%s/wisplogbench%d.log", dir, _getpid());
+#else
+    if (dir == NULL)
+        dir = "/tmp";
+    snprintf(path, sizeof(path), "%s/wisplogbench%d.log", dir, (int)getpid());
+#endif
+
+    log_argv[log_argc++] = argv[0];
+    log_argv[log_argc++] = "-V";
+    log_argv[log_argc++] = path;
+    if (split_logs) {
+        log_argv[log_argc++] = "-split-logs";
+    }
+    if (sync_logs) {
+        log_argv[log_argc++] = "-sync-logs";
+    }
+    log_argv[log_argc] = NULL;
+
+    if (nslog_init(NULL, &log_argc, log_argv) != NSERROR_OK) {
+        fprintf(stderr, "Unable to initialise logging to %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    start = bench_clock();
+    for (i = 0; i < messages; i++) {
+        before = bench_clock();
+        NSLOG(wisp, INFO, "benchmark message %d of %d fetching %s", i, messages, "https://example.com/");
+        after = bench_clock();
+        if (after - before > longest) {
+            longest = after - before;
+        }
+    }
+    logged = bench_clock();
+
+    nslog_finalise();
+    drained = bench_clock();
+
+    remove(path);
+
+    printf("mode: %s%s\n", sync_logs ? "synchronous" : "asynchronous", split_logs ? ", split logs" : "");
+    printf("messages: %d\n", messages);
+    printf("caller time per message: %.1f ns\n", (double)(logged - start) / messages);
+    printf("longest call: %.1f us\n", (double)longest / 1000);
+    printf("time until written: %.1f ms\n", (double)(drained - start) / 1000000);
+    printf("throughput: %.0f messages/s\n", messages / ((double)(drained - start) / 1000000000));
+    printf("dropped: %llu\n", (unsigned long long)nslog_dropped());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the log message queue.
+ *
+ * Checks that messages are drained in order with their text formatted,
+ * that long text survives, that a full queue drops and counts messages
+ * unless asked to wait, and that concurrent producers lose nothing.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "utils/log_ring.h"
+
+/** Record of what was drained */
+struct drained {
+    unsigned int count;
+    int last_line;
+    bool ordered;
+    char text[1024];
+};
+
+static void drain_cb(const struct log_record *record, void *pw)
+{
+    struct drained *d = pw;
+
+    if (record->line <= d->last_line) {
+        d->ordered = false;
+    }
+    d->last_line = record->line;
+    d->count++;
+    snprintf(d->text, sizeof(d->text), "%s", record->text);
+}
+
+static bool push(struct log_ring *ring, int line, bool wait, const char *fmt, ...)
+{
+    struct log_record record = {
+        .level = 3,
+        .file = "test.c",
+        .file_len = -1,
+        .func = "push",
+        .func_len = -1,
+        .line = line,
+    };
+    va_list ap;
+    bool ret;
+
+    va_start(ap, fmt);
+    ret = log_ring_push(ring, &record, wait, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+
+/**
+ * The queue size must be a power of two.
+ */
+START_TEST(log_ring_create_test)
+{
+    struct log_ring *ring;
+
+    ck_assert_int_eq(log_ring_create(0, &ring), NSERROR_BAD_PARAMETER);
+    ck_assert_int_eq(log_ring_create(12, &ring), NSERROR_BAD_PARAMETER);
+    ck_assert_int_eq(log_ring_create(16, &ring), NSERROR_OK);
+    ck_assert(log_ring_empty(ring));
+    log_ring_destroy(ring);
+}
+END_TEST
+
+
+/**
+ * Messages are drained in order, across several laps of the queue.
+ */
+START_TEST(log_ring_order_test)
+{
+    struct drained d = {.ordered = true};
+    struct log_ring *ring;
+    int lap, i;
+
+    ck_assert_int_eq(log_ring_create(8, &ring), NSERROR_OK);
+
+    for (lap = 0; lap < 3; lap++) {
+        for (i = 0; i < 8; i++) {
+            ck_assert(push(ring, lap * 8 + i + 1, false, "message %d", lap * 8 + i + 1));
+        }
+        ck_assert_int_eq(log_ring_drain(ring, drain_cb, &d), 8);
+        ck_assert(log_ring_empty(ring));
+    }
+
+    ck_assert_int_eq(d.count, 24);
+    ck_assert(d.ordered);
+    ck_assert_str_eq(d.text, "message 24");
+    ck_assert_int_eq(log_ring_dropped(ring), 0);
+
+    log_ring_destroy(ring);
+}
+END_TEST
+
+
+/**
+ * Text too long for a slot is kept whole.
+ */
+START_TEST(log_ring_long_test)
+{
+    struct drained d = {.ordered = true};
+    struct log_ring *ring;
+    char expect[800];
+
+    memset(expect, 'x', sizeof(expect) - 1);
+    expect[sizeof(expect) - 1] = '\0';
+
+    ck_assert_int_eq(log_ring_create(4, &ring), NSERROR_OK);
+    ck_assert(push(ring, 1, false, "%s", expect));
+    /* left queued to be freed by destroy */
+    ck_assert(push(ring, 2, false, "%s", expect));
+    ck_assert_int_eq(log_ring_drain(ring, drain_cb, &d), 2);
+    ck_assert(push(ring, 3, false, "%s", expect));
+
+    ck_assert_str_eq(d.text, expect);
+    log_ring_destroy(ring);
+}
+END_TEST
+
+
+/**
+ * A full queue drops and counts messages which may not wait.
+ */
+START_TEST(log_ring_full_test)
+{
+    struct drained d = {.ordered = true};
+    struct log_ring *ring;
+    int i;
+
+    ck_assert_int_eq(log_ring_create(4, &ring), NSERROR_OK);
+
+    for (i = 0; i < 4; i++) {
+        ck_assert(push(ring, i + 1, false, "kept"));
+    }
+    ck_assert(!push(ring, 5, false, "dropped"));
+    ck_assert(!push(ring, 6, false, "dropped"));
+    ck_assert_int_eq(log_ring_dropped(ring), 2);
+
+    ck_assert_int_eq(log_ring_drain(ring, drain_cb, &d), 4);
+    ck_assert_str_eq(d.text, "kept");
+    ck_assert_int_eq(d.last_line, 4);
+
+    ck_assert(push(ring, 7, false, "after"));
+    ck_assert_int_eq(log_ring_drain(ring, drain_cb, &d), 1);
+    ck_assert_str_eq(d.text, "after");
+
+    log_ring_destroy(ring);
+}
+END_TEST
+
+
+#ifndef _WIN32
+
+#define PRODUCERS 4
+#define MESSAGES 20000
+
+static struct log_ring *shared_ring;
+
+static void *producer(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    int i;
+
+    for (i = 0; i < MESSAGES; i++) {
+        push(shared_ring, id * MESSAGES + i + 1, true, "producer %d message %d", id, i);
+    }
+    return NULL;
+}
+
+/** Per producer record of what was drained */
+struct producers_drained {
+    int last[PRODUCERS];
+    unsigned int count;
+    bool ordered;
+};
+
+static void producers_cb(const struct log_record *record, void *pw)
+{
+    struct producers_drained *d = pw;
+    int id = (record->line - 1) / MESSAGES;
+
+    if (record->line <= d->last[id]) {
+        d->ordered = false;
+    }
+    d->last[id] = record->line;
+    d->count++;
+}
+
+/**
+ * Concurrent producers which wait for space lose no messages, and each
+ * producer's messages stay in order.
+ */
+START_TEST(log_ring_producers_test)
+{
+    struct producers_drained d = {.ordered = true};
+    pthread_t threads[PRODUCERS];
+    int i;
+
+    ck_assert_int_eq(log_ring_create(64, &shared_ring), NSERROR_OK);
+
+    for (i = 0; i < PRODUCERS; i++) {
+        ck_assert_int_eq(pthread_create(&threads[i], NULL, producer, (void *)(intptr_t)i), 0);
+    }
+
+    while (d.count < PRODUCERS * MESSAGES) {
+        log_ring_drain(shared_ring, producers_cb, &d);
+    }
+
+    for (i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    ck_assert(log_ring_empty(shared_ring));
+    ck_assert_int_eq(d.count, PRODUCERS * MESSAGES);
+    ck_assert(d.ordered);
+    ck_assert_int_eq(log_ring_dropped(shared_ring), 0);
+
+    log_ring_destroy(shared_ring);
+}
+END_TEST
+
+#endif
+
+
+static Suite *log_ring_suite(void)
+{
+    Suite *s = suite_create("log_ring");
+    TCase *tc = tcase_create("Queue");
+
+    tcase_add_test(tc, log_ring_create_test);
+    tcase_add_test(tc, log_ring_order_test);
+    tcase_add_test(tc, log_ring_long_test);
+    tcase_add_test(tc, log_ring_full_test);
+#ifndef _WIN32
+    tcase_add_test(tc, log_ring_producers_test);
+#endif
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = log_ring_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
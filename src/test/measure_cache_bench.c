@@ -0,0 +1,292 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Text measurement cache reformat benchmark.
+ *
+ * Lays a long document out repeatedly, as a window being resized would,
+ * breaking lines the way inline layout does: each word is measured and a
+ * word which overflows the line is split.  The same reformats are run once
+ * straight against a mock frontend and once through the measurement cache,
+ * and the time per reformat, the number of frontend calls and the cache hit
+ * rate are reported.  The mock frontend sums per glyph advances and then
+ * spins for a fixed cost per call, standing in for the font lookup and
+ * shaping a toolkit does; pass the cost in nanoseconds to model a faster or
+ * slower frontend:
+ *
+ *   measure_cache_bench 200
+ *   measure_cache_bench 200 -cost 300
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <wisp/desktop/gui_table.h>
+#include <wisp/layout.h>
+#include <wisp/plot_style.h>
+#include <wisp/utils/errors.h>
+
+#include "desktop/measure_cache.h"
+
+/** Number of words in the document */
+#define BENCH_WORDS 20000
+
+/** Number of distinct words the document is made from */
+#define BENCH_VOCABULARY 2000
+
+/** Narrowest and widest viewport, in pixels */
+#define BENCH_MIN_WIDTH 320
+#define BENCH_MAX_WIDTH 1280
+
+/** Number of calls made to the mock frontend */
+static unsigned long mock_calls;
+
+/** Cost of each call to the mock frontend, in nanoseconds */
+static uint64_t mock_cost = 1000;
+
+/**
+ * Read a monotonic clock in nanoseconds.
+ */
+static uint64_t bench_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/**
+ * Measure a run of text the way a toolkit would.
+ *
+ * \param string The text
+ * \param length Length of text in bytes
+ * \param x Stop once this width is reached, or -1 to measure it all
+ * \param[out] char_offset Updated with the offset of the stopping glyph
+ * \return The width of the text up to the stopping glyph
+ */
+static int mock_measure(const char *string, size_t length, int x, size_t *char_offset)
+{
+    uint16_t utf16[512];
+    size_t count = length < 512 ? length : 512;
+    uint64_t start = bench_clock();
+    size_t i;
+    int width = 0;
+
+    mock_calls++;
+    for (i = 0; i < count; i++) {
+        utf16[i] = (uint8_t)string[i];
+    }
+    for (i = 0; i < count; i++) {
+        int advance = 5 + (utf16[i] * 7) % 5;
+        if (x >= 0 && width + advance > x) {
+            break;
+        }
+        width += advance;
+    }
+    *char_offset = i;
+
+    while (bench_clock() - start < mock_cost) {
+        /* spin */
+    }
+
+    return width;
+}
+
+static nserror mock_width(const plot_font_style_t *fstyle, const char *string, size_t length, int *width)
+{
+    size_t offset;
+
+    *width = mock_measure(string, length, -1, &offset);
+    return NSERROR_OK;
+}
+
+static nserror mock_position(
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, size_t *char_offset, int *actual_x)
+{
+    *actual_x = mock_measure(string, length, x, char_offset);
+    return NSERROR_OK;
+}
+
+static nserror mock_split(
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, size_t *char_offset, int *actual_x)
+{
+    *actual_x = mock_measure(string, length, x, char_offset);
+    if (*char_offset == 0 && length > 0) {
+        *char_offset = 1;
+    }
+    return NSERROR_OK;
+}
+
+static struct gui_layout_table mock_layout_table = {
+    .width = mock_width,
+    .position = mock_position,
+    .split = mock_split,
+};
+
+static struct wisp_table mock_table = {
+    .layout = &mock_layout_table,
+};
+
+struct wisp_table *guit = &mock_table;
+
+static plot_font_style_t bench_style = {
+    .family = PLOT_FONT_FAMILY_SANS_SERIF,
+    .size = 12 * PLOT_STYLE_SCALE,
+    .weight = 400,
+};
+
+/** Words of the document, pointing into the vocabulary */
+static const char *document[BENCH_WORDS];
+
+/**
+ * Build a document from a vocabulary with a skewed word frequency, as
+ * natural text has.
+ */
+static void bench_document_init(void)
+{
+    static char vocabulary[BENCH_VOCABULARY][16];
+    unsigned int seed = 1;
+    unsigned int i, j;
+
+    for (i = 0; i < BENCH_VOCABULARY; i++) {
+        unsigned int length = 2 + i % 11;
+        for (j = 0; j < length; j++) {
+            seed = seed * 1103515245 + 12345;
+            vocabulary[i][j] = 'a' + (seed >> 16) % 26;
+        }
+        vocabulary[i][length] = '\0';
+    }
+
+    for (i = 0; i < BENCH_WORDS; i++) {
+        seed = seed * 1103515245 + 12345;
+        /* squaring a uniform value favours the start of the vocabulary */
+        j = (seed >> 8) % BENCH_VOCABULARY;
+        document[i] = vocabulary[(unsigned long)j * j / BENCH_VOCABULARY];
+    }
+}
+
+/**
+ * Lay the document out at a viewport width.
+ *
+ * \param table The layout table to measure with
+ * \param available The viewport width
+ * \return The number of lines
+ */
+static unsigned int bench_reformat(const struct gui_layout_table *table, int available)
+{
+    unsigned int lines = 1;
+    int line_x = 0;
+    unsigned int i;
+
+    for (i = 0; i < BENCH_WORDS; i++) {
+        size_t length = strlen(document[i]);
+        size_t offset;
+        int width, x;
+
+        table->width(&bench_style, document[i], length, &width);
+        if (line_x + width > available) {
+            table->split(&bench_style, document[i], length, available - line_x, &offset, &x);
+            lines++;
+            line_x = 0;
+        }
+        line_x += width + 4;
+    }
+
+    return lines;
+}
+
+/**
+ * Run a series of reformats, sweeping the viewport width back and forth.
+ *
+ * \param name Name to report the run as
+ * \param table The layout table to measure with
+ * \param reformats Number of reformats
+ * \return The number of lines laid out, so the work is not optimised away
+ */
+static unsigned long bench_run(const char *name, const struct gui_layout_table *table, int reformats)
+{
+    int steps = (BENCH_MAX_WIDTH - BENCH_MIN_WIDTH) / 16;
+    unsigned long lines = 0;
+    uint64_t start, end;
+    int i;
+
+    mock_calls = 0;
+    start = bench_clock();
+    for (i = 0; i < reformats; i++) {
+        int step = i % (2 * steps);
+        if (step >= steps) {
+            step = 2 * steps - step;
+        }
+        lines += bench_reformat(table, BENCH_MIN_WIDTH + step * 16);
+    }
+    end = bench_clock();
+
+    printf("%s: %.3f ms per reformat, %.1f frontend calls per reformat\n", name,
+        (double)(end - start) / 1000000 / reformats, (double)mock_calls / reformats);
+
+    return lines;
+}
+
+int main(int argc, char **argv)
+{
+    struct measure_cache_stats stats;
+    int reformats = 100;
+    unsigned long direct_lines, cached_lines;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-cost") == 0 && i + 1 < argc) {
+            mock_cost = strtoull(argv[++i], NULL, 10);
+        } else {
+            reformats = atoi(argv[i]);
+        }
+    }
+    if (reformats <= 0) {
+        fprintf(stderr, "Usage: %s [reformats] [-cost ns]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (measure_cache_init() != NSERROR_OK) {
+        fprintf(stderr, "Unable to initialise the measurement cache\n");
+        return EXIT_FAILURE;
+    }
+    bench_document_init();
+
+    printf("reformats: %d of %d words, frontend cost %llu ns per call\n", reformats, BENCH_WORDS,
+        (unsigned long long)mock_cost);
+    direct_lines = bench_run("direct", &mock_layout_table, reformats);
+    cached_lines = bench_run("cached", &measure_cache_layout_table, reformats);
+
+    measure_cache_get_stats(&stats);
+    printf("hits: %llu, misses: %llu, bypass: %llu, evictions: %llu, hit rate: %.1f%%\n",
+        (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.bypass,
+        (unsigned long long)stats.evictions, 100.0 * stats.hits / (stats.hits + stats.misses + stats.bypass));
+
+    measure_cache_fini();
+
+    if (direct_lines != cached_lines) {
+        fprintf(stderr, "Cached layout differs: %lu lines, expected %lu\n", cached_lines, direct_lines);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Tests for the core text measurement cache.
+ *
+ * A mock frontend layout table counts how often it is asked to measure
+ * text so the tests can check the cache answers repeated measurements
+ * itself and forwards everything else.
+ */
+
+#include <libwapcaplet/libwapcaplet.h>
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <wisp/desktop/gui_table.h>
+#include <wisp/layout.h>
+#include <wisp/plot_style.h>
+#include <wisp/utils/errors.h>
+
+#include "desktop/measure_cache.h"
+
+/** Cost of a single glyph in the mock frontend, in pixels per byte */
+static const int mock_glyph_width = 7;
+
+/** Number of calls made to the mock frontend */
+static unsigned int mock_calls;
+
+static nserror mock_width(const plot_font_style_t *fstyle, const char *string, size_t length, int *width)
+{
+    mock_calls++;
+    *width = (int)length * (mock_glyph_width + fstyle->weight / 100) + (int)length * fstyle->letter_spacing;
+    return NSERROR_OK;
+}
+
+static nserror mock_position(
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, size_t *char_offset, int *actual_x)
+{
+    int glyph = mock_glyph_width + fstyle->weight / 100;
+    size_t offset = (x < 0) ? 0 : (size_t)(x / glyph);
+
+    mock_calls++;
+    if (offset > length) {
+        offset = length;
+    }
+    *char_offset = offset;
+    *actual_x = (int)offset * glyph;
+    return NSERROR_OK;
+}
+
+static nserror mock_split(
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, size_t *char_offset, int *actual_x)
+{
+    nserror res = mock_position(fstyle, string, length, x, char_offset, actual_x);
+    if (*char_offset == 0) {
+        *char_offset = 1;
+    }
+    return res;
+}
+
+static nserror mock_width_fail(const plot_font_style_t *fstyle, const char *string, size_t length, int *width)
+{
+    mock_calls++;
+    return NSERROR_INVALID;
+}
+
+static nserror mock_load_font_data(const struct font_variant_id *id, const uint8_t *data, size_t size)
+{
+    return (size > 0) ? NSERROR_OK : NSERROR_INVALID;
+}
+
+static struct gui_layout_table mock_layout_table = {
+    .width = mock_width,
+    .position = mock_position,
+    .split = mock_split,
+    .load_font_data = mock_load_font_data,
+};
+
+static struct wisp_table mock_table = {
+    .layout = &mock_layout_table,
+};
+
+struct wisp_table *guit = &mock_table;
+
+static plot_font_style_t test_style = {
+    .family = PLOT_FONT_FAMILY_SANS_SERIF,
+    .size = 12 * PLOT_STYLE_SCALE,
+    .weight = 400,
+    .foreground = 0x000000,
+    .background = 0xffffff,
+};
+
+/** Text made up of the words a paragraph is laid out from */
+static const char *test_words[] = {
+    "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog", "while", "layout", "measures", "every",
+    "word", "again", "on", "each", "reflow", "of", "the", "page",
+};
+
+static const size_t test_nwords = sizeof(test_words) / sizeof(test_words[0]);
+
+static void measure_cache_setup(void)
+{
+    mock_layout_table.width = mock_width;
+    mock_calls = 0;
+    ck_assert(measure_cache_init() == NSERROR_OK);
+}
+
+static void measure_cache_teardown(void)
+{
+    measure_cache_fini();
+}
+
+
+/**
+ * Results from the cache match those from the frontend.
+ */
+START_TEST(measure_cache_results_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    size_t offset, direct_offset;
+    int width, direct_width;
+    int x, direct_x;
+
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert(mock_width(&test_style, "hello", 5, &direct_width) == NSERROR_OK);
+    ck_assert_int_eq(width, direct_width);
+
+    ck_assert(cache->position(&test_style, "hello", 5, 23, &offset, &x) == NSERROR_OK);
+    ck_assert(mock_position(&test_style, "hello", 5, 23, &direct_offset, &direct_x) == NSERROR_OK);
+    ck_assert_uint_eq(offset, direct_offset);
+    ck_assert_int_eq(x, direct_x);
+
+    ck_assert(cache->split(&test_style, "hello", 5, 2, &offset, &x) == NSERROR_OK);
+    ck_assert_uint_eq(offset, 1);
+
+    /* answered from the cache */
+    mock_calls = 0;
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert(cache->position(&test_style, "hello", 5, 23, &offset, &x) == NSERROR_OK);
+    ck_assert_int_eq(width, direct_width);
+    ck_assert_uint_eq(offset, direct_offset);
+    ck_assert_int_eq(x, direct_x);
+    ck_assert_uint_eq(mock_calls, 0);
+}
+END_TEST
+
+
+/**
+ * Every metric affecting part of the key distinguishes entries.
+ */
+START_TEST(measure_cache_key_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    plot_font_style_t style = test_style;
+    lwc_string *families[2] = {NULL, NULL};
+    size_t offset;
+    int width, x;
+
+    ck_assert(cache->width(&style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 1);
+
+    /* colours do not affect metrics so share the entry */
+    style.foreground = 0xff0000;
+    style.background = 0x00ff00;
+    ck_assert(cache->width(&style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 1);
+
+    style.weight = 700;
+    ck_assert(cache->width(&style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 2);
+    ck_assert_int_eq(width, 5 * (mock_glyph_width + 7));
+
+    style.letter_spacing = 1;
+    ck_assert(cache->width(&style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 3);
+
+    ck_assert(lwc_intern_string("Example Sans", 12, &families[0]) == lwc_error_ok);
+    style.families = families;
+    ck_assert(cache->width(&style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 4);
+    ck_assert(cache->width(&style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 4);
+
+    /* same text and style but a different operation or x */
+    ck_assert(cache->position(&style, "hello", 5, 10, &offset, &x) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 5);
+    ck_assert(cache->position(&style, "hello", 5, 20, &offset, &x) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 6);
+    ck_assert(cache->split(&style, "hello", 5, 20, &offset, &x) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 7);
+
+    /* prefix of the same text */
+    ck_assert(cache->width(&style, "hello", 4, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 8);
+
+    /* the cache must hold its own references to family names */
+    measure_cache_flush();
+    lwc_string_unref(families[0]);
+}
+END_TEST
+
+
+/**
+ * Failed measurements and overlong text are never cached.
+ */
+START_TEST(measure_cache_bypass_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    struct measure_cache_stats stats;
+    char text[1024];
+    int width;
+
+    memset(text, 'a', sizeof(text));
+
+    ck_assert(cache->width(&test_style, text, sizeof(text), &width) == NSERROR_OK);
+    ck_assert(cache->width(&test_style, text, sizeof(text), &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 2);
+
+    mock_layout_table.width = mock_width_fail;
+    ck_assert(cache->width(&test_style, "fail", 4, &width) == NSERROR_INVALID);
+    mock_layout_table.width = mock_width;
+    ck_assert(cache->width(&test_style, "fail", 4, &width) == NSERROR_OK);
+    ck_assert_int_eq(width, 4 * (mock_glyph_width + 4));
+    ck_assert_uint_eq(mock_calls, 4);
+
+    measure_cache_get_stats(&stats);
+    ck_assert_uint_eq(stats.bypass, 2);
+    ck_assert_uint_eq(stats.hits, 0);
+}
+END_TEST
+
+
+/**
+ * Flushing forgets measurements.
+ */
+START_TEST(measure_cache_flush_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    int width;
+
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 1);
+
+    measure_cache_flush();
+
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 2);
+}
+END_TEST
+
+
+/**
+ * Loading a font through the cache forgets measurements made without it,
+ * but a failed load does not.
+ */
+START_TEST(measure_cache_load_font_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    char family[] = "Example Sans";
+    struct font_variant_id id = {
+        .family_name = family,
+    };
+    static const uint8_t data[4] = {0};
+    int width;
+
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 1);
+
+    ck_assert(cache->load_font_data(&id, data, 0) == NSERROR_INVALID);
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 1);
+
+    ck_assert(cache->load_font_data(&id, data, sizeof(data)) == NSERROR_OK);
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 2);
+}
+END_TEST
+
+
+/**
+ * Without initialisation every request is forwarded.
+ */
+START_TEST(measure_cache_uninitialised_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    int width;
+
+    measure_cache_fini();
+
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert(cache->width(&test_style, "hello", 5, &width) == NSERROR_OK);
+    ck_assert_uint_eq(mock_calls, 2);
+}
+END_TEST
+
+
+/**
+ * Repeated reflows of a paragraph at a series of viewport widths, as
+ * happens while a window is resized, reach the frontend only on the
+ * first pass.
+ */
+START_TEST(measure_cache_reflow_test)
+{
+    const struct gui_layout_table *cache = &measure_cache_layout_table;
+    static const int passes = 50;
+    struct measure_cache_stats stats;
+    unsigned int first_pass_calls = 0;
+    clock_t start, end;
+    int pass;
+
+    start = clock();
+    for (pass = 0; pass < passes; pass++) {
+        int available = 200 + (pass % 5) * 40;
+        int line_x = 0;
+        size_t w;
+
+        for (w = 0; w < test_nwords; w++) {
+            const char *word = test_words[w];
+            size_t length = strlen(word);
+            size_t offset;
+            int width, x;
+
+            ck_assert(cache->width(&test_style, word, length, &width) == NSERROR_OK);
+            if (line_x + width > available) {
+                ck_assert(cache->split(&test_style, word, length, available - line_x, &offset, &x) ==
+                          NSERROR_OK);
+                line_x = 0;
+            }
+            line_x += width;
+        }
+
+        if (pass == 0) {
+            first_pass_calls = mock_calls;
+        }
+    }
+    end = clock();
+
+    measure_cache_get_stats(&stats);
+    printf("reflow: %u frontend calls over %d passes (%u on first pass), %llu hits %llu misses, %.3fms\n", mock_calls,
+        passes, first_pass_calls, (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+        (double)(end - start) * 1000.0 / CLOCKS_PER_SEC);
+
+    /* only the handful of distinct viewport widths ever miss */
+    ck_assert_uint_lt(mock_calls, first_pass_calls * 5);
+    ck_assert_uint_gt(stats.hits, stats.misses * 5);
+}
+END_TEST
+
+
+static TCase *measure_cache_case_create(void)
+{
+    TCase *tc;
+
+    tc = tcase_create("Measurement cache");
+
+    tcase_add_checked_fixture(tc, measure_cache_setup, measure_cache_teardown);
+
+    tcase_add_test(tc, measure_cache_results_test);
+    tcase_add_test(tc, measure_cache_key_test);
+    tcase_add_test(tc, measure_cache_bypass_test);
+    tcase_add_test(tc, measure_cache_flush_test);
+    tcase_add_test(tc, measure_cache_load_font_test);
+    tcase_add_test(tc, measure_cache_uninitialised_test);
+    tcase_add_test(tc, measure_cache_reflow_test);
+
+    return tc;
+}
+
+
+static Suite *measure_cache_suite(void)
+{
+    Suite *s;
+    s = suite_create("Text measurement cache");
+
+    suite_add_tcase(s, measure_cache_case_create());
+
+    return s;
+}
+
+
+int main(int argc, char **argv)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = measure_cache_suite();
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_ENV);
+
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
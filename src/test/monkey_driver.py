@@ -25,8 +25,13 @@ runs tests in monkey as defined in a yaml file
 import os
 import sys
 import getopt
+import struct
+import tempfile
+import threading
 import time
+import zlib
 import yaml
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
 
 from monkeyfarmer import Browser
 
@@ -87,6 +92,85 @@ class DriverBrowser(Browser):
             logwin.destroy()
 
 
+class StandInHandler(BaseHTTPRequestHandler):
+    """
+    serves the resources given to a StandInServer
+
+    A conditional request whose If-None-Match matches a resource's ETag
+    is answered 304 Not Modified after the resource's revalidate-delay.
+    """
+
+    def do_GET(self):
+        standin = self.server.standin
+        resource = standin.resources.get(self.path)
+        conditional = self.headers.get('If-None-Match') is not None
+        standin.request_started(self.path, conditional)
+        try:
+            if resource is None:
+                self.send_error(404)
+                return
+            headers = resource.get('headers', {})
+            etag = headers.get('ETag')
+            if conditional and etag is not None and self.headers.get('If-None-Match') == etag:
+                time.sleep(resource.get('revalidate-delay', 0) / 1000)
+                self.send_response(304)
+                for name, value in headers.items():
+                    self.send_header(name, value)
+                self.end_headers()
+                return
+            body = resource.get('body', '').encode('utf-8')
+            self.send_response(resource.get('status', 200))
+            for name, value in headers.items():
+                self.send_header(name, value)
+            self.send_header('Content-Length', str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+        finally:
+            standin.request_finished(self.path)
+
+    def log_message(self, format, *args):
+        # pylint: disable=locally-disabled, redefined-builtin
+        pass
+
+
+class StandInServer:
+    """
+    a local HTTP server standing in for a real one, which records the
+    requests made of it
+    """
+
+    def __init__(self, port, resources):
+        self.resources = {r['path']: r for r in resources}
+        self.lock = threading.Lock()
+        self.counts = {}
+        self.httpd = ThreadingHTTPServer(('127.0.0.1', port), StandInHandler)
+        self.httpd.daemon_threads = True
+        self.httpd.standin = self
+        self.port = self.httpd.server_address[1]
+        self.thread = threading.Thread(target=self.httpd.serve_forever, daemon=True)
+        self.thread.start()
+
+    def request_started(self, path, conditional):
+        with self.lock:
+            counts = self.counts.setdefault(path, {'requests': 0, 'conditional': 0, 'pending': 0})
+            counts['requests'] += 1
+            if conditional:
+                counts['conditional'] += 1
+            counts['pending'] += 1
+
+    def request_finished(self, path):
+        with self.lock:
+            self.counts[path]['pending'] -= 1
+
+    def get_counts(self, path):
+        with self.lock:
+            return dict(self.counts.get(path, {'requests': 0, 'conditional': 0, 'pending': 0}))
+
+    def stop(self):
+        self.httpd.shutdown()
+        self.httpd.server_close()
+
+
 def print_usage():
     print('Usage:')
     print('  ' + sys.argv[0] + ' -m <path to monkey> -t <path to test> [-w <wrapper arguments>]')
@@ -590,6 +674,97 @@ def run_test_step_action_js_exec(ctx, step):
     win.js_exec(cmd)
 
 
+def read_png_pixels(path):
+    """
+    decode an 8 bit RGBA PNG, as monkey screenshots are, into rows of bytes
+    """
+    with open(path, "rb") as fh:
+        data = fh.read()
+    assert data[:8] == b"\x89PNG\r\n\x1a\n", "not a PNG"
+    pos = 8
+    idat = b""
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        if kind == b"IHDR":
+            width, height, depth, colour = struct.unpack(">IIBB", chunk[:10])
+            assert depth == 8 and colour == 6, "not an 8 bit RGBA PNG"
+        elif kind == b"IDAT":
+            idat += chunk
+        pos += 12 + length
+    raw = zlib.decompress(idat)
+    stride = width * 4
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        ftype = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for x in range(stride):
+            left = line[x - 4] if x >= 4 else 0
+            up = prev[x]
+            upleft = prev[x - 4] if x >= 4 else 0
+            if ftype == 1:
+                line[x] = (line[x] + left) & 0xff
+            elif ftype == 2:
+                line[x] = (line[x] + up) & 0xff
+            elif ftype == 3:
+                line[x] = (line[x] + ((left + up) >> 1)) & 0xff
+            elif ftype == 4:
+                p = left + up - upleft
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - upleft)
+                if pa <= pb and pa <= pc:
+                    pred = left
+                elif pb <= pc:
+                    pred = up
+                else:
+                    pred = upleft
+                line[x] = (line[x] + pred) & 0xff
+        rows.append(line)
+        prev = line
+    return width, height, rows
+
+
+def run_test_step_action_screenshot(ctx, step):
+    print(get_indent(ctx) + "Action: " + step["action"])
+    assert_browser(ctx)
+    win = ctx['windows'][step['window']]
+
+    if 'plotter' in step.keys():
+        win.set_plotter(step['plotter'])
+
+    if 'path' in step.keys():
+        path = step['path']
+        remove = False
+    else:
+        fd, path = tempfile.mkstemp(suffix=".png")
+        os.close(fd)
+        remove = True
+
+    try:
+        written = win.screenshot(path)
+        assert written is not None, "screenshot failed: {}".format(ctx['browser'].last_error)
+        print(get_indent(ctx) + "        Painted in {}us".format(win.paint_times[-1]))
+
+        checks = step.get('checks', [])
+        if checks:
+            width, height, rows = read_png_pixels(path)
+        for check in checks:
+            if 'size' in check.keys():
+                print(get_indent(ctx) + "        Check size is {}".format(check['size']))
+                assert [width, height] == check['size']
+            elif 'pixel' in check.keys():
+                x, y = check['pixel']
+                want = check['colour'].lstrip("#")
+                got = "{:02x}{:02x}{:02x}".format(*rows[y][x * 4:x * 4 + 3])
+                print(get_indent(ctx) + "        Check pixel {},{} is #{} got #{}".format(x, y, want, got))
+                assert got == want.lower()
+            else:
+                raise AssertionError("Unknown check: {}".format(repr(check)))
+    finally:
+        if remove:
+            os.remove(path)
+
+
 def run_test_step_action_page_info_state(ctx, step):
     print(get_indent(ctx) + "Action: " + step["action"])
     assert_browser(ctx)
@@ -600,6 +775,27 @@ def run_test_step_action_page_info_state(ctx, step):
     assert win.page_info_state == match
 
 
+def run_test_step_action_server_start(ctx, step):
+    print(get_indent(ctx) + "Action: " + step["action"])
+    tag = step['server']
+    assert ctx['servers'].get(tag) is None
+    server = StandInServer(int(step.get('port', 0)), step.get('resources', []))
+    print(get_indent(ctx) + "        " + tag + " on http://127.0.0.1:{}/".format(server.port))
+    ctx['servers'][tag] = server
+
+
+def run_test_step_action_server_check(ctx, step):
+    print(get_indent(ctx) + "Action: " + step["action"])
+    server = ctx['servers'].get(step['server'])
+    assert server is not None
+    path = step['path']
+    counts = server.get_counts(path)
+    for key in ('requests', 'conditional', 'pending'):
+        if key in step.keys():
+            print(get_indent(ctx) + "        Check {} {} is {} (got {})".format(path, key, step[key], counts[key]))
+            assert counts[key] == int(step[key])
+
+
 def run_test_step_action_quit(ctx, step):
     print(get_indent(ctx) + "Action: " + step["action"])
     assert_browser(ctx)
@@ -631,8 +827,11 @@ STEP_HANDLERS = {
     "clear-log":     run_test_step_action_clear_log,
     "wait-log":      run_test_step_action_wait_log,
     "js-exec":       run_test_step_action_js_exec,
+    "screenshot":    run_test_step_action_screenshot,
     "page-info-state":
                      run_test_step_action_page_info_state,
+    "server-start":  run_test_step_action_server_start,
+    "server-check":  run_test_step_action_server_check,
     "quit":          run_test_step_action_quit,
 }
 
@@ -645,8 +844,13 @@ def walk_test_plan(ctx, plan):
     ctx["depth"] = 0
     ctx["timers"] = dict()
     ctx['repeats'] = dict()
-    for step in plan["steps"]:
-        run_test_step(ctx, step)
+    ctx['servers'] = dict()
+    try:
+        for step in plan["steps"]:
+            run_test_step(ctx, step)
+    finally:
+        for server in ctx['servers'].values():
+            server.stop()
 
 
 def run_test_plan(ctx, plan):
@@ -35,9 +35,10 @@ import errno
 import sys
 
 class StderrEcho(threading.Thread):
-    def __init__(self, stream):
+    def __init__(self, stream, echo=True):
         super().__init__(daemon=True)
         self.stream = stream
+        self.echo = echo
         self.start()
 
     def run(self):
@@ -50,13 +51,15 @@ class StderrEcho(threading.Thread):
             except UnicodeDecodeError:
                 print("WARNING: Unicode decode error")
                 s = line.decode('utf-8', 'replace')
-            sys.stderr.write("{}".format(s))
+            if self.echo:
+                sys.stderr.write("{}".format(s))
 
 class StdoutReader(threading.Thread):
-    def __init__(self, stream, on_line):
+    def __init__(self, stream, on_line, echo=True):
         super().__init__(daemon=True)
         self.stream = stream
         self.on_line = on_line
+        self.echo = echo
         self.start()
 
     def run(self):
@@ -68,13 +71,14 @@ class StdoutReader(threading.Thread):
                 s = line.decode('utf-8')
             except UnicodeDecodeError:
                 s = line.decode('utf-8', 'replace')
-            sys.stderr.write("{}".format(s))
+            if self.echo:
+                sys.stderr.write("{}".format(s))
             self.on_line(line)
 
 
 class MonkeyFarmer:
 
-    def __init__(self, monkey_cmd, monkey_env, online, quiet=False, *, wrapper=None):
+    def __init__(self, monkey_cmd, monkey_env, online, quiet=False, *, wrapper=None, echo=True):
         if wrapper is not None:
             new_cmd = list(wrapper)
             new_cmd.extend(monkey_cmd)
@@ -103,8 +107,8 @@ class MonkeyFarmer:
         self.stdout = self.monkey.stdout
         self.stderr = self.monkey.stderr
 
-        self.err_echo = StderrEcho(self.stderr)
-        self.stdout_reader = StdoutReader(self.stdout, self._on_stdout_line)
+        self.err_echo = StderrEcho(self.stderr, echo)
+        self.stdout_reader = StdoutReader(self.stdout, self._on_stdout_line, echo)
 
         self.buffer = b""
         self.incoming = b""
@@ -192,19 +196,22 @@ class Browser:
 
     # pylint: disable=locally-disabled, too-many-instance-attributes, dangerous-default-value, invalid-name
 
-    def __init__(self, monkey_cmd=["./nsmonkey"], monkey_env=None, quiet=False, *, wrapper=None):
+    def __init__(self, monkey_cmd=["./nsmonkey"], monkey_env=None, quiet=False, *, wrapper=None, echo=True):
         self.farmer = MonkeyFarmer(
             monkey_cmd=monkey_cmd,
             monkey_env=monkey_env,
             online=self.on_monkey_line,
             quiet=quiet,
-            wrapper=wrapper)
+            wrapper=wrapper,
+            echo=echo)
         self.windows = {}
         self.logins = {}
         self.current_draw_target = None
         self.started = False
         self.stopped = False
         self.launchurl = None
+        self.last_error = None
+        self.stats = None
         now = time.time()
         timeout = now + 1
 
@@ -262,6 +269,9 @@ class Browser:
         else:
             pass
 
+    def handle_ERROR(self, *args):
+        self.last_error = " ".join(args)
+
     def handle_WINDOW(self, action, _win, winid, *args):
         if action == "NEW":
             new_win = BrowserWindow(self, winid, *args)
@@ -290,6 +300,40 @@ class Browser:
         if self.current_draw_target is not None:
             self.current_draw_target.handle_plot(*args)
 
+    def handle_STATS(self, what, *args):
+        if self.stats is None:
+            return
+        if what == "RESET" or what == "END":
+            self.stats["complete"] = True
+        elif what == "PHASE":
+            name, _time, usec, _count, count = args
+            self.stats["phases"][name] = {"time": int(usec), "count": int(count)}
+        elif what == "ELAPSED":
+            self.stats["elapsed"] = int(args[0])
+        elif what == "MEMORY":
+            self.stats["memory"] = {args[0].lower(): int(args[1])}
+        elif what == "ALLOC":
+            self.stats["alloc"] = {args[0].lower(): int(args[1]), args[2].lower(): int(args[3])}
+        elif what == "CACHE":
+            self.stats["caches"][args[0].lower()] = {
+                args[n].lower(): int(args[n + 1]) for n in range(1, len(args) - 1, 2)}
+
+    def _stats_command(self, what):
+        self.stats = {"complete": False, "phases": {}, "caches": {}}
+        self.farmer.tell_monkey("STATS %s" % what)
+        while not self.stats["complete"] and not self.farmer.deadmonkey:
+            self.farmer.loop(once=True)
+        stats = self.stats
+        self.stats = None
+        del stats["complete"]
+        return stats
+
+    def reset_stats(self):
+        self._stats_command("RESET")
+
+    def report_stats(self):
+        return self._stats_command("REPORT")
+
     def new_window(self, url=None):
         if url is None:
             self.farmer.tell_monkey("WINDOW NEW")
@@ -405,6 +449,8 @@ class BrowserWindow:
         self.plotting = False
         self.log_entries = []
         self.page_info_state = "UNKNOWN"
+        self.paint_times = []
+        self.screenshot_path = None
 
     def kill(self):
         self.browser.farmer.tell_monkey("WINDOW DESTROY %s" % self.winid)
@@ -443,6 +489,17 @@ class BrowserWindow:
     def js_exec(self, src):
         self.browser.farmer.tell_monkey("WINDOW EXEC WIN %s %s" % (self.winid, src))
 
+    def set_plotter(self, plotter):
+        self.browser.farmer.tell_monkey("WINDOW PLOTTER %s %s" % (self.winid, plotter))
+
+    def screenshot(self, path):
+        self.screenshot_path = None
+        self.browser.last_error = None
+        self.browser.farmer.tell_monkey("WINDOW SCREENSHOT %s %s" % (self.winid, path))
+        while self.screenshot_path is None and self.browser.last_error is None:
+            self.browser.farmer.loop(once=True)
+        return self.screenshot_path
+
     def handle(self, action, *args):
         handler = getattr(self, "handle_window_" + action, None)
         if handler is not None:
@@ -519,6 +576,12 @@ class BrowserWindow:
             self.browser.current_draw_target = None
             self.plotting = False
 
+    def handle_window_PAINT(self, _time, usec):
+        self.paint_times.append(int(usec))
+
+    def handle_window_SCREENSHOT(self, _path, *path):
+        self.screenshot_path = " ".join(path)
+
     def handle_window_CONSOLE_LOG(self, _src, src, folding, level, *msg):
         self.log_entries.append((src, folding == "FOLDABLE", level, " ".join(msg)))
 
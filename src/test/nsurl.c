@@ -781,6 +781,64 @@ START_TEST(nsurl_ref_test)
 END_TEST
 
 
+/**
+ * identical urls are the same object however they are made
+ */
+START_TEST(nsurl_intern_test)
+{
+    nsurl *url[3];
+    nsurl *base;
+    nsurl *many[1000];
+    char buf[64];
+    unsigned int i;
+
+    ck_assert(nsurl_create("http://www.example.com/a/b?c#d", &url[0]) == NSERROR_OK);
+    ck_assert(nsurl_create("HTTP://www.example.com:80/a/b?c#d", &url[1]) == NSERROR_OK);
+    ck_assert(url[0] == url[1]);
+
+    ck_assert(nsurl_create("http://www.example.com/a/x", &base) == NSERROR_OK);
+    ck_assert(nsurl_join(base, "b?c#d", &url[2]) == NSERROR_OK);
+    ck_assert(url[0] == url[2]);
+    nsurl_unref(url[2]);
+
+    /* urls differing only by fragment are distinct, but compare equal
+     * without it */
+    ck_assert(nsurl_create("http://www.example.com/a/b?c#e", &url[2]) == NSERROR_OK);
+    ck_assert(url[0] != url[2]);
+    ck_assert(nsurl_compare(url[0], url[2], NSURL_COMPLETE) == true);
+    ck_assert(nsurl_compare(url[0], url[2], NSURL_WITH_FRAGMENT) == false);
+    ck_assert(nsurl_compare(url[0], base, NSURL_COMPLETE) == false);
+    ck_assert(nsurl_compare(url[0], base, NSURL_HOST) == true);
+    nsurl_unref(url[2]);
+
+    ck_assert(nsurl_defragment(url[0], &url[2]) == NSERROR_OK);
+    nsurl_unref(url[1]);
+    ck_assert(nsurl_create("http://www.example.com/a/b?c", &url[1]) == NSERROR_OK);
+    ck_assert(url[1] == url[2]);
+    nsurl_unref(url[1]);
+    nsurl_unref(url[2]);
+
+    /* enough urls for the table to grow */
+    for (i = 0; i < NELEMS(many); i++) {
+        snprintf(buf, sizeof(buf), "http://www.example.com/%u", i);
+        ck_assert(nsurl_create(buf, &many[i]) == NSERROR_OK);
+    }
+    for (i = 0; i < NELEMS(many); i++) {
+        snprintf(buf, sizeof(buf), "http://www.example.com/%u", i);
+        ck_assert(nsurl_create(buf, &url[1]) == NSERROR_OK);
+        ck_assert(url[1] == many[i]);
+        nsurl_unref(url[1]);
+    }
+    for (i = 0; i < NELEMS(many); i++) {
+        nsurl_unref(many[i]);
+    }
+
+    nsurl_unref(base);
+    nsurl_unref(url[0]);
+}
+END_TEST
+
+
 /**
  * check creation asserts on NULL parameter
  */
@@ -1332,6 +1390,7 @@ static Suite *nsurl_suite(void)
 
     tcase_add_loop_test(tc_create, nsurl_create_test, 0, NELEMS(create_tests));
     tcase_add_test(tc_create, nsurl_ref_test);
+    tcase_add_test(tc_create, nsurl_intern_test);
     suite_add_tcase(s, tc_create);
 
     /* url access and length */
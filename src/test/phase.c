@@ -0,0 +1,164 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for page load phase accounting.
+ *
+ * Checks that nothing is counted until accounting is reset, that nested
+ * phases are charged exclusively and that the phase totals account for
+ * all of the elapsed time.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "utils/phase.h"
+
+/**
+ * Spin for at least a number of microseconds.
+ */
+static void spin(unsigned int us)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000 < us);
+}
+
+static uint64_t total(const struct phase_stats *stats)
+{
+    uint64_t sum = 0;
+    int phase;
+
+    for (phase = 0; phase < PHASE__COUNT; phase++) {
+        sum += stats->time[phase];
+    }
+    return sum;
+}
+
+
+/**
+ * Marks made before accounting is reset are not counted.
+ */
+START_TEST(phase_inactive_test)
+{
+    struct phase_stats stats;
+    enum phase previous;
+
+    phase_disable();
+    phase_reset();
+    phase_disable();
+
+    previous = phase_enter(PHASE_PARSE);
+    ck_assert_int_eq(previous, PHASE_NONE);
+    phase_leave(previous);
+
+    phase_get_stats(&stats);
+    ck_assert_uint_eq(stats.count[PHASE_PARSE], 0);
+    ck_assert_uint_eq(stats.time[PHASE_PARSE], 0);
+}
+END_TEST
+
+
+/**
+ * Nested phases are charged to the innermost phase only.
+ */
+START_TEST(phase_nesting_test)
+{
+    struct phase_stats stats;
+    enum phase outer, inner;
+
+    phase_reset();
+
+    outer = phase_enter(PHASE_BOX);
+    ck_assert_int_eq(outer, PHASE_NONE);
+    spin(2000);
+
+    inner = phase_enter(PHASE_STYLE);
+    ck_assert_int_eq(inner, PHASE_BOX);
+    spin(4000);
+    phase_leave(inner);
+
+    inner = phase_enter(PHASE_STYLE);
+    phase_leave(inner);
+
+    spin(2000);
+    phase_leave(outer);
+
+    phase_disable();
+    phase_get_stats(&stats);
+
+    ck_assert_uint_eq(stats.count[PHASE_BOX], 1);
+    ck_assert_uint_eq(stats.count[PHASE_STYLE], 2);
+    ck_assert_uint_ge(stats.time[PHASE_STYLE], 4000);
+    ck_assert_uint_ge(stats.time[PHASE_BOX], 4000);
+    ck_assert_uint_lt(stats.time[PHASE_BOX], stats.time[PHASE_STYLE] + 4000);
+    ck_assert_uint_eq(total(&stats), stats.elapsed);
+}
+END_TEST
+
+
+/**
+ * Statistics may be read while a phase is active.
+ */
+START_TEST(phase_active_stats_test)
+{
+    struct phase_stats stats;
+    enum phase previous;
+
+    phase_reset();
+
+    previous = phase_enter(PHASE_LAYOUT);
+    spin(1000);
+    phase_get_stats(&stats);
+    ck_assert_uint_ge(stats.time[PHASE_LAYOUT], 1000);
+    ck_assert_uint_eq(total(&stats), stats.elapsed);
+    phase_leave(previous);
+
+    phase_disable();
+}
+END_TEST
+
+
+START_TEST(phase_name_test)
+{
+    ck_assert_str_eq(phase_name(PHASE_FETCH), "fetch");
+    ck_assert_str_eq(phase_name(PHASE_REDRAW), "redraw");
+    ck_assert_str_eq(phase_name(PHASE__COUNT), "unknown");
+}
+END_TEST
+
+
+static Suite *phase_suite(void)
+{
+    Suite *s = suite_create("phase");
+    TCase *tc = tcase_create("Accounting");
+
+    tcase_add_test(tc, phase_inactive_test);
+    tcase_add_test(tc, phase_nesting_test);
+    tcase_add_test(tc, phase_active_stats_test);
+    tcase_add_test(tc, phase_name_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = phase_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
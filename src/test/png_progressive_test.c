@@ -0,0 +1,414 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for decoding PNG images as their data arrives.
+ *
+ * Feeds encoded images to the PNG content handler in chunks, checking
+ * the rows decoded into the partly decoded bitmap as they arrive, that
+ * interlaced images are shown coarsely before they are complete, that the
+ * bitmap is handed to the image cache once the data is complete or ends
+ * early, and that redraws are throttled.
+ */
+
+#include <check.h>
+#include <png.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/utils/utils.h>
+#include "desktop/bitmap.h"
+#include "content/handlers/image/image_cache.h"
+#include "content/handlers/image/png.h"
+
+#include "test/image_decode_stubs.h"
+
+extern const struct content_handler *content_stubs_handler;
+
+/** Size of the test image, not a multiple of the interlace blocks */
+#define TEST_WIDTH 37
+#define TEST_HEIGHT 29
+
+/** Minimum interval between redraws of a partly decoded image / ms */
+#define TEST_PROGRESS_INTERVAL 250
+
+/** Size of the interlace blocks each pass fills, by pass */
+static const int test_block[7][2] = {{8, 8}, {4, 8}, {4, 4}, {2, 4}, {2, 2}, {1, 2}, {1, 1}};
+
+/** Chunk sizes the images are delivered in */
+static const size_t test_chunk[] = {1, 7, 64, 4096};
+
+/** An encoded image */
+struct test_png {
+    uint8_t *data;
+    size_t size;
+};
+
+static const struct content_handler *handler;
+static struct content *content;
+static struct test_png image;
+
+
+static void test_png_write(png_structp png, png_bytep data, png_size_t length)
+{
+    struct test_png *out = png_get_io_ptr(png);
+    uint8_t *grown = realloc(out->data, out->size + length);
+
+    ck_assert_ptr_nonnull(grown);
+    memcpy(grown + out->size, data, length);
+    out->data = grown;
+    out->size += length;
+}
+
+static void test_png_flush(png_structp png)
+{
+    (void)png;
+}
+
+/**
+ * Encode the test image, whose every pixel is different.
+ *
+ * \param interlace true to encode it with Adam7 interlacing
+ */
+static void test_png_encode(bool interlace)
+{
+    png_byte row[TEST_WIDTH * 3];
+    png_structp png;
+    png_infop info;
+    int x, y;
+
+    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    ck_assert_ptr_nonnull(png);
+    info = png_create_info_struct(png);
+    ck_assert_ptr_nonnull(info);
+
+    png_set_write_fn(png, &image, test_png_write, test_png_flush);
+    /* stored, so the rows are spread evenly through the data */
+    png_set_compression_level(png, 0);
+    png_set_IHDR(png, info, TEST_WIDTH, TEST_HEIGHT, 8, PNG_COLOR_TYPE_RGB,
+        interlace ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    for (int pass = png_set_interlace_handling(png); pass > 0; pass--) {
+        for (y = 0; y < TEST_HEIGHT; y++) {
+            for (x = 0; x < TEST_WIDTH; x++) {
+                row[x * 3 + 0] = x * 6;
+                row[x * 3 + 1] = y * 8;
+                row[x * 3 + 2] = 0x80;
+            }
+            png_write_row(png, row);
+        }
+    }
+
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+}
+
+/**
+ * Get the pixel of the test image, in the client bitmap format.
+ */
+static uint32_t test_pixel(int x, int y)
+{
+    uint8_t p[4];
+    uint32_t pixel;
+
+    p[bitmap_layout.r] = x * 6;
+    p[bitmap_layout.g] = y * 8;
+    p[bitmap_layout.b] = 0x80;
+    p[bitmap_layout.a] = 0xff;
+    memcpy(&pixel, p, sizeof(pixel));
+
+    return pixel;
+}
+
+/**
+ * Check the rows decoded into a bitmap are the first rows of the image
+ * and are correct, while the rest are clear.
+ *
+ * \return The number of rows decoded
+ */
+static int check_rows(struct bitmap *bitmap)
+{
+    int rows = 0;
+    int x, y;
+
+    while (rows < TEST_HEIGHT && stub_bitmap_alpha(bitmap, 0, rows) != 0) {
+        rows++;
+    }
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            if (y < rows) {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), test_pixel(x, y));
+            } else {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), 0);
+            }
+        }
+    }
+
+    return rows;
+}
+
+/**
+ * Check each pixel decoded into a bitmap is the pixel at the corner of an
+ * interlace block it is in, as early passes fill whole blocks.
+ *
+ * \return The number of pixels not yet decoded
+ */
+static int check_blocks(struct bitmap *bitmap)
+{
+    int missing = 0;
+    int x, y, pass;
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            uint32_t pixel = stub_bitmap_pixel(bitmap, x, y);
+
+            if (pixel == 0) {
+                missing++;
+                continue;
+            }
+            for (pass = 0; pass < 7; pass++) {
+                int bx = x & ~(test_block[pass][0] - 1);
+                int by = y & ~(test_block[pass][1] - 1);
+
+                if (pixel == test_pixel(bx, by)) {
+                    break;
+                }
+            }
+            ck_assert_msg(pass < 7, "pixel %d,%d is not from its interlace blocks", x, y);
+        }
+    }
+
+    return missing;
+}
+
+/**
+ * Finish the content and check the decoded bitmap was handed to the image
+ * cache as the image.
+ *
+ * \param bitmap The bitmap decoded as data arrived
+ * \param opaque Whether every pixel of the bitmap was decoded
+ */
+static void check_handoff(struct bitmap *bitmap, bool opaque)
+{
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_int_eq(content->status, CONTENT_STATUS_DONE);
+
+    ck_assert_uint_eq(stub_bitmaps_created, 1);
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 0);
+    ck_assert_ptr_eq(image_cache_get_bitmap(content), bitmap);
+    ck_assert(stub_bitmap_opaque(bitmap) == opaque);
+}
+
+/**
+ * Set up the image cache and create a PNG content.
+ *
+ * \param speculative_small Size of the largest image decoded as it arrives
+ */
+static void fixture_init(size_t speculative_small)
+{
+    stub_image_init(speculative_small);
+
+    ck_assert_int_eq(nspng_init(), NSERROR_OK);
+    handler = content_stubs_handler;
+    content = stub_image_create(handler);
+    ck_assert_ptr_nonnull(content);
+
+    memset(&image, 0, sizeof(image));
+}
+
+static void fixture_setup(void)
+{
+    fixture_init(1024 * 1024);
+}
+
+static void fixture_setup_large(void)
+{
+    /* too large to be decoded as it arrives */
+    fixture_init(0);
+}
+
+static void fixture_teardown(void)
+{
+    stub_image_destroy(content);
+    free(image.data);
+    stub_image_fini();
+}
+
+
+/**
+ * Rows are decoded into the bitmap as they arrive, whatever the chunks.
+ */
+START_TEST(png_progressive_chunked_test)
+{
+    struct bitmap *bitmap;
+    int rows;
+
+    test_png_encode(false);
+
+    ck_assert(stub_image_receive(content, image.data, 0, image.size / 2, test_chunk[_i], 0));
+    bitmap = stub_bitmap_last;
+    ck_assert_ptr_nonnull(bitmap);
+    rows = check_rows(bitmap);
+    ck_assert_int_gt(rows, 0);
+    ck_assert_int_lt(rows, TEST_HEIGHT);
+
+    ck_assert(stub_image_receive(content, image.data, image.size / 2, image.size, test_chunk[_i], 0));
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+
+    check_handoff(bitmap, true);
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+}
+END_TEST
+
+/**
+ * Interlaced images fill the whole bitmap coarsely before they sharpen.
+ */
+START_TEST(png_progressive_interlaced_test)
+{
+    struct bitmap *bitmap = NULL;
+    bool coarse = false;
+    size_t received;
+
+    test_png_encode(true);
+
+    for (received = 0; received < image.size; received += 16) {
+        size_t end = (received + 16 < image.size) ? received + 16 : image.size;
+
+        ck_assert(stub_image_receive(content, image.data, received, end, 16, 0));
+        if (stub_bitmap_last == NULL) {
+            continue;
+        }
+        bitmap = stub_bitmap_last;
+        if (check_blocks(bitmap) == 0 && end < image.size &&
+            stub_bitmap_pixel(bitmap, TEST_WIDTH - 1, TEST_HEIGHT - 1) != test_pixel(TEST_WIDTH - 1, TEST_HEIGHT - 1)) {
+            coarse = true;
+        }
+    }
+    ck_assert(coarse);
+
+    check_handoff(bitmap, true);
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+}
+END_TEST
+
+/**
+ * An image whose data ends early keeps the rows which arrived.
+ */
+START_TEST(png_progressive_truncated_test)
+{
+    struct bitmap *bitmap;
+    int rows;
+
+    test_png_encode(false);
+
+    ck_assert(stub_image_receive(content, image.data, 0, image.size * 2 / 3, 64, 0));
+    bitmap = stub_bitmap_last;
+    ck_assert_ptr_nonnull(bitmap);
+
+    check_handoff(bitmap, false);
+    rows = check_rows(bitmap);
+    ck_assert_int_gt(rows, 0);
+    ck_assert_int_lt(rows, TEST_HEIGHT);
+}
+END_TEST
+
+/**
+ * An image whose data ends within its header has no bitmap.
+ */
+START_TEST(png_progressive_truncated_header_test)
+{
+    test_png_encode(false);
+
+    ck_assert(stub_image_receive(content, image.data, 0, 20, 7, 0));
+    ck_assert(content->handler->data_complete(content));
+
+    ck_assert_uint_eq(stub_bitmaps_created, 0);
+    ck_assert_ptr_null(image_cache_get_bitmap(content));
+    ck_assert_uint_eq(stub_redraw_count, 0);
+}
+END_TEST
+
+/**
+ * The first rows are redrawn at once and the rest no more often than the
+ * progress interval, however many chunks they arrive in.
+ */
+START_TEST(png_progressive_throttle_test)
+{
+    unsigned int chunks;
+
+    test_png_encode(false);
+
+    ck_assert(stub_image_receive(content, image.data, 0, image.size / 2, 1, 0));
+    ck_assert_uint_eq(stub_redraw_count, 1);
+
+    chunks = (image.size - image.size / 2 + 15) / 16;
+    ck_assert(stub_image_receive(content, image.data, image.size / 2, image.size, 16, 100));
+    ck_assert_uint_gt(stub_redraw_count, 1);
+    ck_assert_uint_le(stub_redraw_count, 2 + chunks * 100 / TEST_PROGRESS_INTERVAL);
+}
+END_TEST
+
+/**
+ * Images too large to speculate on are decoded when they are needed.
+ */
+START_TEST(png_progressive_large_test)
+{
+    struct bitmap *bitmap;
+
+    test_png_encode(false);
+
+    ck_assert(stub_image_receive(content, image.data, 0, image.size, 64, TEST_PROGRESS_INTERVAL));
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_uint_eq(stub_bitmaps_created, 0);
+    ck_assert_uint_eq(stub_redraw_count, 0);
+
+    bitmap = image_cache_get_bitmap(content);
+    ck_assert_ptr_nonnull(bitmap);
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+}
+END_TEST
+
+
+static Suite *png_progressive_suite(void)
+{
+    Suite *s = suite_create("png_progressive");
+    TCase *tc = tcase_create("Progressive");
+    TCase *tc_large = tcase_create("Large");
+
+    tcase_add_checked_fixture(tc, fixture_setup, fixture_teardown);
+    tcase_add_loop_test(tc, png_progressive_chunked_test, 0, NOF_ELEMENTS(test_chunk));
+    tcase_add_test(tc, png_progressive_interlaced_test);
+    tcase_add_test(tc, png_progressive_truncated_test);
+    tcase_add_test(tc, png_progressive_truncated_header_test);
+    tcase_add_test(tc, png_progressive_throttle_test);
+    suite_add_tcase(s, tc);
+
+    tcase_add_checked_fixture(tc_large, fixture_setup_large, fixture_teardown);
+    tcase_add_test(tc_large, png_progressive_large_test);
+    suite_add_tcase(s, tc_large);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = png_progressive_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
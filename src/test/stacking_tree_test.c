@@ -0,0 +1,300 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the stacking context tree built after layout.
+ *
+ * Uses boxes with real computed styles so z-index and position are read the
+ * way redraw and hit-testing read them. Style creation is in a separate
+ * translation unit to avoid enum collisions.
+ *
+ * The boxes are never scrolled, so box_coords() is provided here as a plain
+ * walk up the tree.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdlib.h>
+
+#include <wisp/content/handlers/html/box.h>
+#include <wisp/content/handlers/html/box_inspect.h>
+#include <wisp/utils/errors.h>
+#include "content/handlers/html/stacking.h"
+
+#include "layout_margin_collapse_style.h"
+
+static struct box *create_box(box_type type, int x, int y)
+{
+    struct box *b = calloc(1, sizeof(struct box));
+    assert(b != NULL);
+    b->type = type;
+    b->style = create_block_style();
+    b->x = x;
+    b->y = y;
+    return b;
+}
+
+static struct box *create_stacked_box(int x, int y, int32_t z_index)
+{
+    struct box *b = create_box(BOX_BLOCK, x, y);
+    style_set_z_index(b->style, z_index);
+    return b;
+}
+
+static struct box *set_size(struct box *b, int width, int height)
+{
+    b->width = width;
+    b->height = height;
+    b->descendant_x1 = width;
+    b->descendant_y1 = height;
+    return b;
+}
+
+static struct box *add_child(struct box *parent, struct box *child)
+{
+    child->parent = parent;
+    if (parent->children == NULL) {
+        parent->children = child;
+    } else {
+        parent->last->next = child;
+        child->prev = parent->last;
+    }
+    parent->last = child;
+    return child;
+}
+
+void box_coords(struct box *box, int *x, int *y)
+{
+    *x = 0;
+    *y = 0;
+    for (; box != NULL; box = box->parent) {
+        *x += box->x;
+        *y += box->y;
+    }
+}
+
+static void free_box_tree(struct box *box)
+{
+    struct box *child = box->children;
+    while (child != NULL) {
+        struct box *next = child->next;
+        free_box_tree(child);
+        child = next;
+    }
+    stacking_node_destroy(box->stacking);
+    destroy_mock_style(box->style);
+    free(box);
+}
+
+/**
+ * The test document:
+ *
+ *   root
+ *     a (auto) at 10,20
+ *       b (z 2) at 1,2
+ *       c (z -1)
+ *     d (z 1)
+ *       e (z 5)
+ *     f (z 2)
+ */
+struct test_tree {
+    struct box *root, *a, *b, *c, *d, *e, *f;
+};
+
+static void create_test_tree(struct test_tree *t)
+{
+    t->root = create_box(BOX_BLOCK, 0, 0);
+    t->a = add_child(t->root, create_box(BOX_BLOCK, 10, 20));
+    t->b = add_child(t->a, create_stacked_box(1, 2, 2));
+    t->c = add_child(t->a, create_stacked_box(0, 0, -1));
+    t->d = add_child(t->root, create_stacked_box(0, 0, 1));
+    t->e = add_child(t->d, create_stacked_box(0, 0, 5));
+    t->f = add_child(t->root, create_stacked_box(0, 0, 2));
+}
+
+
+/**
+ * Each stacking context lists its own z-indexed descendants, sorted.
+ */
+START_TEST(stacking_tree_build_test)
+{
+    struct test_tree t;
+    const struct stacking_node *node;
+
+    create_test_tree(&t);
+    ck_assert_int_eq(stacking_tree_build(t.root), NSERROR_OK);
+
+    node = t.root->stacking;
+    ck_assert(node != NULL);
+    ck_assert_uint_eq(node->negative.count, 1);
+    ck_assert(node->negative.entries[0].box == t.c);
+    ck_assert_int_eq(node->negative.entries[0].x_parent, 10);
+    ck_assert_int_eq(node->negative.entries[0].y_parent, 20);
+
+    /* e is painted within d, equal z-index stays in document order */
+    ck_assert_uint_eq(node->positive.count, 3);
+    ck_assert(node->positive.entries[0].box == t.d);
+    ck_assert(node->positive.entries[1].box == t.b);
+    ck_assert(node->positive.entries[2].box == t.f);
+    ck_assert_int_eq(node->positive.entries[1].x_parent, 10);
+    ck_assert_int_eq(node->positive.entries[2].x_parent, 0);
+
+    ck_assert(t.a->stacking == NULL);
+    ck_assert(t.d->stacking != NULL);
+    ck_assert_uint_eq(t.d->stacking->positive.count, 1);
+    ck_assert(t.d->stacking->positive.entries[0].box == t.e);
+    ck_assert(t.e->stacking != NULL);
+    ck_assert_uint_eq(t.e->stacking->positive.count, 0);
+
+    free_box_tree(t.root);
+}
+END_TEST
+
+
+/**
+ * Rebuilding after a relayout follows z-index changes.
+ */
+START_TEST(stacking_tree_rebuild_test)
+{
+    struct test_tree t;
+    const struct stacking_node *node;
+
+    create_test_tree(&t);
+    ck_assert_int_eq(stacking_tree_build(t.root), NSERROR_OK);
+
+    /* d no longer establishes a stacking context, f moves below b */
+    destroy_mock_style(t.d->style);
+    t.d->style = create_block_style();
+    style_set_z_index(t.f->style, 0);
+    t.a->x = 30;
+
+    ck_assert_int_eq(stacking_tree_build(t.root), NSERROR_OK);
+
+    node = t.root->stacking;
+    ck_assert(t.d->stacking == NULL);
+    ck_assert_uint_eq(node->positive.count, 3);
+    ck_assert(node->positive.entries[0].box == t.f);
+    ck_assert(node->positive.entries[1].box == t.b);
+    ck_assert(node->positive.entries[2].box == t.e);
+    ck_assert_int_eq(node->positive.entries[1].x_parent, 30);
+
+    free_box_tree(t.root);
+}
+END_TEST
+
+
+/**
+ * Destroying the tree removes every node.
+ */
+START_TEST(stacking_tree_destroy_test)
+{
+    struct test_tree t;
+
+    create_test_tree(&t);
+    ck_assert_int_eq(stacking_tree_build(t.root), NSERROR_OK);
+
+    stacking_tree_destroy(t.root);
+    ck_assert(t.root->stacking == NULL);
+    ck_assert(t.d->stacking == NULL);
+    ck_assert(t.e->stacking == NULL);
+
+    free_box_tree(t.root);
+}
+END_TEST
+
+
+/**
+ * Hit-testing finds the topmost stacked box, passing over hidden ones.
+ *
+ *   root
+ *     below (z 1) 0,0 100x100
+ *     menu (z 2, hidden) 0,0 100x100
+ *       item (z 3, visible) 0,0 100x20
+ */
+START_TEST(stacking_tree_hidden_overlay_test)
+{
+    struct box *root, *below, *menu, *item;
+
+    root = set_size(create_box(BOX_BLOCK, 0, 0), 200, 200);
+    below = add_child(root, set_size(create_stacked_box(0, 0, 1), 100, 100));
+    menu = add_child(root, set_size(create_stacked_box(0, 0, 2), 100, 100));
+    style_set_visibility_hidden(menu->style);
+    item = add_child(menu, set_size(create_stacked_box(0, 0, 3), 100, 20));
+    ck_assert_int_eq(stacking_tree_build(root), NSERROR_OK);
+
+    ck_assert(stacking_box_at_point(root, 50, 50) == below);
+    ck_assert(stacking_box_at_point(root, 50, 10) == item);
+    ck_assert(stacking_box_at_point(root, 150, 150) == NULL);
+
+    /* a hidden item lets the pointer through too */
+    style_set_visibility_hidden(item->style);
+    ck_assert(stacking_box_at_point(root, 50, 10) == below);
+
+    free_box_tree(root);
+}
+END_TEST
+
+
+/**
+ * Hit-testing ignores the parts of a stacked box its ancestors clip away.
+ *
+ *   root
+ *     below (z 1) 0,0 200x200
+ *     frame (auto, overflow hidden) 10,10 50x50
+ *       overlay (z 2) 0,0 100x100
+ */
+START_TEST(stacking_tree_clipped_overlay_test)
+{
+    struct box *root, *below, *frame, *overlay;
+
+    root = set_size(create_box(BOX_BLOCK, 0, 0), 200, 200);
+    below = add_child(root, set_size(create_stacked_box(0, 0, 1), 200, 200));
+    frame = add_child(root, set_size(create_box(BOX_BLOCK, 10, 10), 50, 50));
+    style_set_overflow_hidden(frame->style);
+    overlay = add_child(frame, set_size(create_stacked_box(0, 0, 2), 100, 100));
+    ck_assert_int_eq(stacking_tree_build(root), NSERROR_OK);
+
+    ck_assert(stacking_box_at_point(root, 30, 30) == overlay);
+    ck_assert(stacking_box_at_point(root, 80, 30) == below);
+    ck_assert(stacking_box_at_point(root, 30, 80) == below);
+    ck_assert(stacking_box_at_point(root, 5, 5) == below);
+
+    free_box_tree(root);
+}
+END_TEST
+
+
+static Suite *stacking_tree_suite(void)
+{
+    Suite *s = suite_create("Stacking context tree");
+    TCase *tc = tcase_create("Build");
+
+    tcase_add_test(tc, stacking_tree_build_test);
+    tcase_add_test(tc, stacking_tree_rebuild_test);
+    tcase_add_test(tc, stacking_tree_destroy_test);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Hit-testing");
+    tcase_add_test(tc, stacking_tree_hidden_overlay_test);
+    tcase_add_test(tc, stacking_tree_clipped_overlay_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = stacking_tree_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the SVG raster cache.
+ *
+ * Checks that plotters asking for rasterised vectors are given one
+ * cached raster per size, that the raster is rendered again when the
+ * size changes or the diagram is reformatted, that the image cache is
+ * charged for the raster actually held rather than the diagram's
+ * intrinsic size, and that other plotters still get vectors.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/content/llcache.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/misc.h>
+#include <wisp/plotters.h>
+#include <wisp/utils/errors.h>
+#include <wisp/utils/nsurl.h>
+#include "content/handlers/image/image.h"
+#include "content/handlers/image/image_cache.h"
+#include "content/handlers/image/svg.h"
+
+extern const uint8_t *content_stubs_source_data;
+extern size_t content_stubs_source_size;
+extern const struct content_handler *content_stubs_handler;
+
+/** A small icon, scaled up far beyond its intrinsic size by the tests */
+static const char icon_svg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"10\" height=\"10\">"
+                               "<rect width=\"10\" height=\"10\" fill=\"red\"/></svg>";
+
+/** Counts of what the frontend and plotters were asked to do */
+static struct {
+    int bitmaps_created;
+    int bitmaps_destroyed;
+    int rasterised; /**< render_plot calls */
+    int raster_paths; /**< paths plotted into rasters */
+    int page_paths; /**< paths plotted onto the page */
+    int blits; /**< rasters plotted onto the page */
+} counts;
+
+struct bitmap {
+    int width;
+    int height;
+};
+
+
+static void *test_bitmap_create(int width, int height, enum gui_bitmap_flags flags)
+{
+    struct bitmap *bitmap = calloc(1, sizeof(*bitmap));
+
+    (void)flags;
+    if (bitmap != NULL) {
+        bitmap->width = width;
+        bitmap->height = height;
+        counts.bitmaps_created++;
+    }
+    return bitmap;
+}
+
+static void test_bitmap_destroy(void *bitmap)
+{
+    counts.bitmaps_destroyed++;
+    free(bitmap);
+}
+
+static int test_bitmap_get_width(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->width;
+}
+
+static int test_bitmap_get_height(void *bitmap)
+{
+    return ((struct bitmap *)bitmap)->height;
+}
+
+static void test_bitmap_modified(void *bitmap)
+{
+    (void)bitmap;
+}
+
+static nserror test_clip(const struct redraw_context *ctx, const struct rect *clip)
+{
+    (void)ctx;
+    (void)clip;
+    return NSERROR_OK;
+}
+
+static nserror test_rectangle(const struct redraw_context *ctx, const plot_style_t *style, const struct rect *r)
+{
+    (void)ctx;
+    (void)style;
+    (void)r;
+    return NSERROR_OK;
+}
+
+static nserror test_raster_path(const struct redraw_context *ctx, const plot_style_t *style, const float *p,
+    unsigned int n, const float transform[6])
+{
+    (void)ctx;
+    (void)style;
+    (void)p;
+    (void)n;
+    (void)transform;
+    counts.raster_paths++;
+    return NSERROR_OK;
+}
+
+static nserror test_page_path(const struct redraw_context *ctx, const plot_style_t *style, const float *p,
+    unsigned int n, const float transform[6])
+{
+    (void)ctx;
+    (void)style;
+    (void)p;
+    (void)n;
+    (void)transform;
+    counts.page_paths++;
+    return NSERROR_OK;
+}
+
+static nserror test_plot_bitmap(const struct redraw_context *ctx, struct bitmap *bitmap, int x, int y, int width,
+    int height, colour bg, bitmap_flags_t flags)
+{
+    (void)ctx;
+    (void)bitmap;
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+    (void)bg;
+    (void)flags;
+    return NSERROR_OK;
+}
+
+static const struct plotter_table raster_plotters = {
+    .clip = test_clip,
+    .rectangle = test_rectangle,
+    .path = test_raster_path,
+    .bitmap = test_plot_bitmap,
+};
+
+static struct plotter_table page_plotters = {
+    .clip = test_clip,
+    .rectangle = test_rectangle,
+    .path = test_page_path,
+    .bitmap = test_plot_bitmap,
+    .option_raster_vectors = true,
+};
+
+static nserror test_bitmap_render_plot(
+    struct bitmap *bitmap, bool (*redraw)(const struct redraw_context *ctx, void *pw), void *pw)
+{
+    struct redraw_context ctx = {
+        .interactive = false,
+        .background_images = true,
+        .plot = &raster_plotters,
+    };
+
+    (void)bitmap;
+    counts.rasterised++;
+    return redraw(&ctx, pw) ? NSERROR_OK : NSERROR_INVALID;
+}
+
+static struct gui_bitmap_table test_bitmap_table = {
+    .create = test_bitmap_create,
+    .destroy = test_bitmap_destroy,
+    .get_width = test_bitmap_get_width,
+    .get_height = test_bitmap_get_height,
+    .modified = test_bitmap_modified,
+    .render_plot = test_bitmap_render_plot,
+};
+
+static nserror test_schedule(int t, void (*callback)(void *p), void *p)
+{
+    (void)t;
+    (void)callback;
+    (void)p;
+    return NSERROR_OK;
+}
+
+static struct gui_misc_table test_misc_table = {
+    .schedule = test_schedule,
+};
+
+
+/* Dependencies of the image cache which the tests do not exercise */
+
+void content_broadcast(struct content *c, content_msg msg, const union content_msg_data *data)
+{
+    (void)c;
+    (void)msg;
+    (void)data;
+}
+
+nsurl *llcache_handle_get_url(const llcache_handle *handle)
+{
+    (void)handle;
+    return NULL;
+}
+
+bool nsurl_has_component(const nsurl *url, nsurl_component part)
+{
+    (void)url;
+    (void)part;
+    return false;
+}
+
+lwc_string *nsurl_get_component(const nsurl *url, nsurl_component part)
+{
+    (void)url;
+    (void)part;
+    return NULL;
+}
+
+bool image_bitmap_plot(
+    struct bitmap *bitmap, struct content_redraw_data *data, const struct rect *clip, const struct redraw_context *ctx)
+{
+    (void)clip;
+    counts.blits++;
+    return ctx->plot->bitmap(ctx, bitmap, data->x, data->y, data->width, data->height, data->background_colour,
+               BITMAPF_NONE) == NSERROR_OK;
+}
+
+
+static struct content *icon;
+
+static void fixture_setup(void)
+{
+    struct image_cache_parameters params = {
+        .bg_clean_time = 5000,
+        .limit = 64 * 1024 * 1024,
+        .hysteresis = 1024 * 1024,
+        .speculative_small = 0,
+    };
+    const struct content_handler *handler;
+
+    memset(&counts, 0, sizeof(counts));
+    guit->bitmap = &test_bitmap_table;
+    guit->misc = &test_misc_table;
+    test_bitmap_table.render_plot = test_bitmap_render_plot;
+    page_plotters.option_raster_vectors = true;
+
+    ck_assert_int_eq(image_cache_init(&params), NSERROR_OK);
+
+    ck_assert_int_eq(svg_init(), NSERROR_OK);
+    handler = content_stubs_handler;
+    ck_assert_ptr_nonnull(handler);
+
+    content_stubs_source_data = (const uint8_t *)icon_svg;
+    content_stubs_source_size = sizeof(icon_svg) - 1;
+
+    ck_assert_int_eq(handler->create(handler, NULL, NULL, NULL, NULL, false, &icon), NSERROR_OK);
+    ck_assert(handler->data_complete(icon));
+    handler->reformat(icon, 10, 10);
+}
+
+static void fixture_teardown(void)
+{
+    icon->handler->destroy(icon);
+    free(icon);
+    icon = NULL;
+
+    image_cache_fini();
+}
+
+/**
+ * Plot the icon at a size.
+ */
+static void redraw_icon(int width, int height)
+{
+    struct content_redraw_data data = {
+        .width = width,
+        .height = height,
+        .background_colour = 0xffffff,
+        .scale = 1,
+    };
+    struct rect clip = {0, 0, width, height};
+    struct redraw_context ctx = {
+        .interactive = true,
+        .background_images = true,
+        .plot = &page_plotters,
+    };
+
+    ck_assert(icon->handler->redraw(icon, &data, &clip, &ctx));
+}
+
+/**
+ * Get the total size of the bitmaps the image cache holds.
+ */
+static unsigned long cache_bitmap_size(void)
+{
+    char summary[64];
+
+    image_cache_snsummaryf(summary, sizeof(summary), "%c");
+    return strtoul(summary, NULL, 10);
+}
+
+
+/**
+ * Repeated redraws at one size rasterise once and blit the raster.
+ */
+START_TEST(svg_raster_cache_hit_test)
+{
+    redraw_icon(400, 300);
+    redraw_icon(400, 300);
+    redraw_icon(400, 300);
+
+    ck_assert_int_eq(counts.rasterised, 1);
+    ck_assert_int_gt(counts.raster_paths, 0);
+    ck_assert_int_eq(counts.blits, 3);
+    ck_assert_int_eq(counts.page_paths, 0);
+    ck_assert_int_eq(counts.bitmaps_created, 1);
+}
+END_TEST
+
+
+/**
+ * The image cache is charged for the raster, not the intrinsic size.
+ */
+START_TEST(svg_raster_cache_size_test)
+{
+    redraw_icon(400, 300);
+
+    ck_assert_uint_eq(cache_bitmap_size(), 400 * 300 * 4);
+}
+END_TEST
+
+
+/**
+ * A new size replaces the raster with one rendered at that size.
+ */
+START_TEST(svg_raster_cache_resize_test)
+{
+    redraw_icon(400, 300);
+    redraw_icon(64, 32);
+    redraw_icon(64, 32);
+
+    ck_assert_int_eq(counts.rasterised, 2);
+    ck_assert_int_eq(counts.blits, 3);
+    ck_assert_int_eq(counts.bitmaps_created, 2);
+    ck_assert_int_eq(counts.bitmaps_destroyed, 1);
+    ck_assert_uint_eq(cache_bitmap_size(), 64 * 32 * 4);
+}
+END_TEST
+
+
+/**
+ * Reformatting re-parses the diagram so the raster is rendered again.
+ */
+START_TEST(svg_raster_cache_reformat_test)
+{
+    redraw_icon(400, 300);
+    icon->handler->reformat(icon, 10, 10);
+    redraw_icon(400, 300);
+
+    ck_assert_int_eq(counts.rasterised, 2);
+    ck_assert_int_eq(counts.bitmaps_destroyed, 1);
+}
+END_TEST
+
+
+/**
+ * Plotters which do not ask for rasterised vectors get vectors.
+ */
+START_TEST(svg_raster_cache_gate_test)
+{
+    page_plotters.option_raster_vectors = false;
+    redraw_icon(400, 300);
+
+    ck_assert_int_eq(counts.rasterised, 0);
+    ck_assert_int_eq(counts.blits, 0);
+    ck_assert_int_gt(counts.page_paths, 0);
+    ck_assert_uint_eq(cache_bitmap_size(), 0);
+}
+END_TEST
+
+
+/**
+ * Frontends which cannot plot into bitmaps get vectors.
+ */
+START_TEST(svg_raster_cache_no_render_plot_test)
+{
+    test_bitmap_table.render_plot = NULL;
+    redraw_icon(400, 300);
+
+    ck_assert_int_eq(counts.blits, 0);
+    ck_assert_int_gt(counts.page_paths, 0);
+}
+END_TEST
+
+
+/**
+ * Rasters too large for the cache are plotted as vectors.
+ */
+START_TEST(svg_raster_cache_too_large_test)
+{
+    redraw_icon(4096, 4096);
+
+    ck_assert_int_eq(counts.rasterised, 0);
+    ck_assert_int_gt(counts.page_paths, 0);
+}
+END_TEST
+
+
+static Suite *svg_raster_cache_suite(void)
+{
+    Suite *s = suite_create("svg_raster_cache");
+    TCase *tc = tcase_create("Raster cache");
+
+    tcase_add_checked_fixture(tc, fixture_setup, fixture_teardown);
+    tcase_add_test(tc, svg_raster_cache_hit_test);
+    tcase_add_test(tc, svg_raster_cache_size_test);
+    tcase_add_test(tc, svg_raster_cache_resize_test);
+    tcase_add_test(tc, svg_raster_cache_reformat_test);
+    tcase_add_test(tc, svg_raster_cache_gate_test);
+    tcase_add_test(tc, svg_raster_cache_no_render_plot_test);
+    tcase_add_test(tc, svg_raster_cache_too_large_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = svg_raster_cache_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for talloc pools.
+ *
+ * Checks that the children of a pool are carved out of its blocks, that
+ * destructors and reallocation still behave, and that memory is returned
+ * once every chunk in a block has been freed.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/talloc.h"
+
+#define POOL_SIZE 4096
+
+static unsigned int destroyed;
+
+static int count_destructor(void *ptr)
+{
+    destroyed++;
+    return 0;
+}
+
+
+/**
+ * Children of a pool are allocated one after another.
+ */
+START_TEST(talloc_pool_bump_test)
+{
+    void *pool = talloc_pool(NULL, POOL_SIZE);
+    char *a, *b, *c;
+
+    ck_assert(pool != NULL);
+
+    a = talloc_size(pool, 10);
+    b = talloc_size(pool, 10);
+    ck_assert(a != NULL);
+    ck_assert(b != NULL);
+    ck_assert((uintptr_t)a % 16 == 0);
+    ck_assert((uintptr_t)b % 16 == 0);
+    ck_assert(b > a);
+    ck_assert((size_t)(b - a) < 128);
+
+    /* freeing the last chunks lets the block be reused from the start */
+    talloc_free(b);
+    talloc_free(a);
+    c = talloc_size(pool, 10);
+    ck_assert(c == a);
+
+    /* grandchildren are not pooled */
+    ck_assert(talloc_size(c, 10) != NULL);
+
+    ck_assert_uint_eq(talloc_total_blocks(pool), 3);
+    talloc_free(pool);
+}
+END_TEST
+
+
+/**
+ * A pool outgrows its first block and large chunks bypass it.
+ */
+START_TEST(talloc_pool_overflow_test)
+{
+    void *pool = talloc_pool(NULL, POOL_SIZE);
+    void *big;
+    int i;
+
+    for (i = 0; i < 200; i++) {
+        int *p = talloc(pool, int);
+        ck_assert(p != NULL);
+        *p = i;
+    }
+    big = talloc_size(pool, POOL_SIZE);
+    ck_assert(big != NULL);
+    memset(big, 0, POOL_SIZE);
+
+    ck_assert_uint_eq(talloc_total_blocks(pool), 202);
+    ck_assert_uint_eq(talloc_total_size(pool), 200 * sizeof(int) + POOL_SIZE + sizeof(void *));
+    talloc_free(pool);
+}
+END_TEST
+
+
+/**
+ * Destructors of pooled chunks run when the pool is freed.
+ */
+START_TEST(talloc_pool_destructor_test)
+{
+    void *pool = talloc_pool(NULL, POOL_SIZE);
+    int i;
+
+    destroyed = 0;
+    for (i = 0; i < 10; i++) {
+        void *p = talloc_size(pool, 32);
+        talloc_set_destructor(p, count_destructor);
+    }
+    talloc_free(pool);
+
+    ck_assert_uint_eq(destroyed, 10);
+}
+END_TEST
+
+
+/**
+ * The last chunk in a block grows in place, others move out of the pool.
+ */
+START_TEST(talloc_pool_realloc_test)
+{
+    void *pool = talloc_pool(NULL, POOL_SIZE);
+    char *a, *b, *r;
+
+    a = talloc_size(pool, 16);
+    memset(a, 'a', 16);
+    r = talloc_realloc_size(pool, a, 64);
+    ck_assert(r == a);
+
+    b = talloc_size(pool, 16);
+    r = talloc_realloc_size(pool, a, 256);
+    ck_assert(r != NULL);
+    ck_assert(r != a);
+    ck_assert(r[0] == 'a' && r[15] == 'a');
+    ck_assert(talloc_parent(r) == pool);
+
+    /* shrinking never moves */
+    ck_assert(talloc_realloc_size(pool, b, 8) == b);
+
+    ck_assert_uint_eq(talloc_total_size(pool), 256 + 8 + sizeof(void *));
+    talloc_free(pool);
+}
+END_TEST
+
+
+/**
+ * A chunk stolen from a pool outlives it.
+ */
+START_TEST(talloc_pool_steal_test)
+{
+    void *pool = talloc_pool(NULL, POOL_SIZE);
+    void *owner = talloc_size(NULL, 1);
+    char *s;
+
+    s = talloc_strdup(pool, "survivor");
+    ck_assert(talloc_size(pool, 100) != NULL);
+    talloc_steal(owner, s);
+    talloc_free(pool);
+
+    ck_assert_str_eq(s, "survivor");
+    talloc_free(owner);
+}
+END_TEST
+
+
+static Suite *talloc_suite(void)
+{
+    Suite *s = suite_create("talloc");
+    TCase *tc = tcase_create("Pool");
+
+    tcase_add_test(tc, talloc_pool_bump_test);
+    tcase_add_test(tc, talloc_pool_overflow_test);
+    tcase_add_test(tc, talloc_pool_destructor_test);
+    tcase_add_test(tc, talloc_pool_realloc_test);
+    tcase_add_test(tc, talloc_pool_steal_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = talloc_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
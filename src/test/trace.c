@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for structured event tracing.
+ *
+ * Checks that recorded events are written as Chrome trace event JSON, that
+ * names are escaped and that a ring which has wrapped keeps its newest
+ * events and reports the rest as dropped.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "utils/trace.h"
+
+/**
+ * Dump the trace and read it back.
+ *
+ * \return The trace, which the caller must free.
+ */
+static char *dump_and_read(void)
+{
+    const char *dir = getenv("TMPDIR");
+    char path[256];
+    char *data;
+    long len;
+    FILE *fh;
+    int pid;
+
+#ifdef _WIN32
+    pid = _getpid();
+    if (dir == NULL)
+        dir = getenv("TEMP");
+    if (dir == NULL)
+        dir = ".";
+#else
+    pid = getpid();
+    if (dir == NULL)
+        dir = "/tmp";
+#endif
+    snprintf(path, sizeof(path), "%s/wisptracetest%d.json", dir, pid);
+
+    ck_assert_int_eq(trace_dump(path), NSERROR_OK);
+
+    fh = fopen(path, "rb");
+    ck_assert_ptr_nonnull(fh);
+    fseek(fh, 0, SEEK_END);
+    len = ftell(fh);
+    fseek(fh, 0, SEEK_SET);
+    data = malloc(len + 1);
+    ck_assert_ptr_nonnull(data);
+    ck_assert_int_eq((long)fread(data, 1, len, fh), len);
+    data[len] = '\0';
+    fclose(fh);
+    remove(path);
+
+    return data;
+}
+
+
+/**
+ * Each type of event is written with its trace event phase.
+ */
+START_TEST(trace_events_test)
+{
+    char *data;
+
+    TRACE_THREAD_NAME("test");
+    TRACE_BEGIN_ARG("html", "parse chunk", "bytes", 1234);
+    TRACE_FLOW_BEGIN("fetch", "fetch", 0x2a);
+    TRACE_END("html", "parse chunk");
+    TRACE_COUNTER("fetch", "active fetches", 3);
+    TRACE_ASYNC_BEGIN("curl", "queued", 0x2a);
+    TRACE_ASYNC_END("curl", "queued", 0x2a);
+    TRACE_INSTANT("perf", "quote \" and \\ and \n");
+
+    data = dump_and_read();
+
+    ck_assert_ptr_nonnull(strstr(data, "{\"traceEvents\":["));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"thread_name\",\"ph\":\"M\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"args\":{\"name\":\"test\"}"));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"parse chunk\",\"ph\":\"B\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"args\":{\"bytes\":1234}"));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"parse chunk\",\"ph\":\"E\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"ph\":\"s\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"args\":{\"value\":3}"));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"queued\",\"ph\":\"b\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"queued\",\"ph\":\"e\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"id\":\"0x2a\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"quote \\\" and \\\\ and \\u000a\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"dropped_events\":\"0\""));
+
+    free(data);
+    trace_finalise();
+}
+END_TEST
+
+
+/**
+ * A wrapped ring keeps its newest events.
+ */
+START_TEST(trace_wrap_test)
+{
+    char *data;
+    int i;
+
+    TRACE_INSTANT("test", "oldest");
+    for (i = 0; i < (1 << 16); i++) {
+        TRACE_COUNTER("test", "count", i);
+    }
+    TRACE_INSTANT("test", "newest");
+
+    data = dump_and_read();
+
+    ck_assert_ptr_null(strstr(data, "\"name\":\"oldest\""));
+    ck_assert_ptr_null(strstr(data, "\"args\":{\"value\":0}"));
+    ck_assert_ptr_nonnull(strstr(data, "\"args\":{\"value\":1}"));
+    ck_assert_ptr_nonnull(strstr(data, "\"name\":\"newest\""));
+    ck_assert_ptr_nonnull(strstr(data, "\"dropped_events\":\"2\""));
+
+    free(data);
+    trace_finalise();
+}
+END_TEST
+
+
+static Suite *trace_suite(void)
+{
+    Suite *s = suite_create("trace");
+    TCase *tc = tcase_create("Recording");
+
+    tcase_add_test(tc, trace_events_test);
+    tcase_add_test(tc, trace_wrap_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = trace_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
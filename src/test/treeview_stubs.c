@@ -0,0 +1,283 @@
+/*
+ * Treeview stubs for tests which drive the treeview and its clients
+ * without a frontend.
+ *
+ * Bitmaps are plain buffers, text is measured at a fixed width per byte,
+ * and treeview resources are never fetched.  The search textarea reports
+ * text set on it as modified, as it would if the text had been typed.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content.h>
+#include <wisp/content/handlers/css/utils.h>
+#include <wisp/content/hlcache.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/desktop/textarea.h>
+#include <wisp/layout.h>
+#include <wisp/plotters.h>
+#include <wisp/utils/errors.h>
+#include "desktop/bitmap.h"
+#include "desktop/cw_helper.h"
+#include "desktop/knockout.h"
+#include "utils/nscolour.h"
+
+css_fixed nscss_screen_dpi = F_90;
+
+colour nscolours[NSCOLOUR__COUNT];
+
+struct bitmap_colour_layout bitmap_layout = {.r = 0, .g = 1, .b = 2, .a = 3};
+
+
+/** Stub bitmap */
+struct stub_bitmap {
+    int width;
+    int height;
+    unsigned char *data;
+};
+
+static void *stub_bitmap_create(int width, int height, enum gui_bitmap_flags flags)
+{
+    struct stub_bitmap *b = malloc(sizeof(*b));
+
+    if (b == NULL) {
+        return NULL;
+    }
+    b->width = width;
+    b->height = height;
+    b->data = calloc(width * height, 4);
+    if (b->data == NULL) {
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+static void stub_bitmap_destroy(void *bitmap)
+{
+    struct stub_bitmap *b = bitmap;
+
+    if (b != NULL) {
+        free(b->data);
+        free(b);
+    }
+}
+
+static void stub_bitmap_set_opaque(void *bitmap, bool opaque)
+{
+}
+
+static bool stub_bitmap_get_opaque(void *bitmap)
+{
+    return true;
+}
+
+static unsigned char *stub_bitmap_get_buffer(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->data;
+}
+
+static size_t stub_bitmap_get_rowstride(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->width * 4;
+}
+
+static int stub_bitmap_get_width(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->width;
+}
+
+static int stub_bitmap_get_height(void *bitmap)
+{
+    return ((struct stub_bitmap *)bitmap)->height;
+}
+
+static void stub_bitmap_modified(void *bitmap)
+{
+}
+
+static nserror stub_bitmap_render(struct bitmap *bitmap, struct hlcache_handle *content)
+{
+    return NSERROR_OK;
+}
+
+static struct gui_bitmap_table stub_bitmap_table = {
+    .create = stub_bitmap_create,
+    .destroy = stub_bitmap_destroy,
+    .set_opaque = stub_bitmap_set_opaque,
+    .get_opaque = stub_bitmap_get_opaque,
+    .get_buffer = stub_bitmap_get_buffer,
+    .get_rowstride = stub_bitmap_get_rowstride,
+    .get_width = stub_bitmap_get_width,
+    .get_height = stub_bitmap_get_height,
+    .modified = stub_bitmap_modified,
+    .render = stub_bitmap_render,
+};
+
+
+static nserror stub_layout_width(const plot_font_style_t *fstyle, const char *string, size_t length, int *width)
+{
+    *width = length * 8;
+    return NSERROR_OK;
+}
+
+static nserror stub_layout_position(
+    const plot_font_style_t *fstyle, const char *string, size_t length, int x, size_t *char_offset, int *actual_x)
+{
+    *char_offset = (x < 0) ? 0 : ((size_t)x / 8 < length ? (size_t)x / 8 : length);
+    *actual_x = *char_offset * 8;
+    return NSERROR_OK;
+}
+
+static struct gui_layout_table stub_layout_table = {
+    .width = stub_layout_width,
+    .position = stub_layout_position,
+    .split = stub_layout_position,
+};
+
+
+static struct wisp_table stub_gui_table = {
+    .bitmap = &stub_bitmap_table,
+    .layout = &stub_layout_table,
+};
+struct wisp_table *guit = &stub_gui_table;
+
+
+/** Stub textarea, holding its text */
+struct textarea {
+    textarea_client_callback callback;
+    void *data;
+    char *text;
+    unsigned int len; /**< Byte length of text, including terminator */
+};
+
+struct textarea *
+textarea_create(const textarea_flags flags, const textarea_setup *setup, textarea_client_callback callback, void *data)
+{
+    struct textarea *ta = calloc(1, sizeof(*ta));
+
+    if (ta == NULL) {
+        return NULL;
+    }
+    ta->callback = callback;
+    ta->data = data;
+    ta->text = strdup("");
+    if (ta->text == NULL) {
+        free(ta);
+        return NULL;
+    }
+    ta->len = 1;
+    return ta;
+}
+
+void textarea_destroy(struct textarea *ta)
+{
+    if (ta != NULL) {
+        free(ta->text);
+        free(ta);
+    }
+}
+
+bool textarea_set_text(struct textarea *ta, const char *text)
+{
+    struct textarea_msg msg;
+    char *copy = strdup(text);
+
+    if (copy == NULL) {
+        return false;
+    }
+    free(ta->text);
+    ta->text = copy;
+    ta->len = strlen(copy) + 1;
+
+    msg.ta = ta;
+    msg.type = TEXTAREA_MSG_TEXT_MODIFIED;
+    msg.data.modified.text = ta->text;
+    msg.data.modified.len = ta->len;
+    ta->callback(ta->data, &msg);
+
+    return true;
+}
+
+int textarea_get_text(struct textarea *ta, char *buf, unsigned int len)
+{
+    if (buf == NULL) {
+        return ta->len;
+    }
+    if (len < ta->len) {
+        return -1;
+    }
+    memcpy(buf, ta->text, ta->len);
+    return ta->len;
+}
+
+const char *textarea_data(struct textarea *ta, unsigned int *len)
+{
+    if (len != NULL) {
+        *len = ta->len;
+    }
+    return ta->text;
+}
+
+bool textarea_set_caret(struct textarea *ta, int caret)
+{
+    return true;
+}
+
+void textarea_redraw(struct textarea *ta, int x, int y, colour bg, float scale, const struct rect *clip,
+    const struct redraw_context *ctx)
+{
+}
+
+bool textarea_keypress(struct textarea *ta, uint32_t key)
+{
+    return false;
+}
+
+textarea_mouse_status textarea_mouse_action(struct textarea *ta, browser_mouse_state mouse, int x, int y)
+{
+    return TEXTAREA_MOUSE_NONE;
+}
+
+
+nserror hlcache_handle_retrieve(nsurl *url, uint32_t flags, nsurl *referer, llcache_post_data *post,
+    hlcache_handle_callback cb, void *pw, hlcache_child_context *child, content_type accepted_types,
+    hlcache_handle **result)
+{
+    return NSERROR_NOT_FOUND;
+}
+
+nserror hlcache_handle_release(hlcache_handle *handle)
+{
+    return NSERROR_OK;
+}
+
+int content_get_height(struct hlcache_handle *h)
+{
+    return 0;
+}
+
+bool content_redraw(struct hlcache_handle *h, struct content_redraw_data *data, const struct rect *clip,
+    const struct redraw_context *ctx)
+{
+    return false;
+}
+
+bool knockout_plot_start(const struct redraw_context *ctx, struct redraw_context *knk_ctx)
+{
+    *knk_ctx = *ctx;
+    return true;
+}
+
+bool knockout_plot_end(const struct redraw_context *ctx)
+{
+    return true;
+}
+
+nserror cw_helper_scroll_visible(struct core_window *cw_h, const struct rect *r)
+{
+    return NSERROR_OK;
+}
@@ -0,0 +1,471 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for the treeview.
+ *
+ * A tree with folders both larger and smaller than the size at which
+ * child offsets are indexed is put through random insertions, deletions,
+ * expansions and contractions.  After each one, the node found at every
+ * y offset and the y offset of every node are checked against a walk of
+ * the visible rows.  Trigram indexed search is checked against a plain
+ * substring scan of every entry as entries are added, changed and deleted.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/corestrings.h"
+
+#include "desktop/treeview.c"
+
+/** Most nodes a test tree has */
+#define TEST_NODES 600
+
+/** Client data of a test node */
+struct test_node {
+    treeview_node *node;
+    bool live;
+    bool folder;
+    char title[24];
+    char url[24];
+    struct treeview_field_data data[2];
+};
+
+static struct test_node test_nodes[TEST_NODES];
+static unsigned int test_node_count;
+
+static struct treeview_field_desc test_fields[3];
+
+static unsigned int test_seed;
+
+nserror nslog_set_filter_by_options(void)
+{
+    return NSERROR_OK;
+}
+
+static unsigned int test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return (test_seed >> 16) & 0x7fff;
+}
+
+static nserror test_node_cb(struct treeview_node_msg msg, void *data)
+{
+    struct test_node *t = data;
+
+    if (msg.msg == TREE_MSG_NODE_DELETE) {
+        t->live = false;
+        t->node = NULL;
+    }
+    return NSERROR_OK;
+}
+
+static struct treeview_callback_table test_cb = {
+    .folder = test_node_cb,
+    .entry = test_node_cb,
+};
+
+/**
+ * Fill in random text from a small alphabet, so trigrams are shared
+ */
+static void test_text(char *text, size_t size)
+{
+    static const char alphabet[] = "abcABC";
+    size_t len = 3 + test_rand() % (size - 4);
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        text[i] = alphabet[test_rand() % (sizeof(alphabet) - 1)];
+    }
+    text[len] = '\0';
+}
+
+/**
+ * Add a node to a test tree
+ *
+ * \param tree The tree
+ * \param relation Node to add relative to, or NULL for the root
+ * \param rel Relationship to relation
+ * \param folder Whether to add a folder
+ * \return the new node's client data
+ */
+static struct test_node *
+test_add(treeview *tree, treeview_node *relation, enum treeview_relationship rel, bool folder)
+{
+    struct test_node *t;
+
+    ck_assert_uint_lt(test_node_count, TEST_NODES);
+    t = &test_nodes[test_node_count++];
+    t->live = true;
+    t->folder = folder;
+
+    test_text(t->title, sizeof(t->title));
+    test_text(t->url, sizeof(t->url));
+
+    if (folder) {
+        t->data[0].field = test_fields[2].field;
+        t->data[0].value = t->title;
+        t->data[0].value_len = strlen(t->title);
+        ck_assert_int_eq(treeview_create_node_folder(tree, &t->node, relation, rel, &t->data[0], t, TREE_OPTION_NONE),
+            NSERROR_OK);
+    } else {
+        t->data[0].field = test_fields[0].field;
+        t->data[0].value = t->title;
+        t->data[0].value_len = strlen(t->title);
+        t->data[1].field = test_fields[1].field;
+        t->data[1].value = t->url;
+        t->data[1].value_len = strlen(t->url);
+        ck_assert_int_eq(treeview_create_node_entry(tree, &t->node, relation, rel, t->data, t, TREE_OPTION_NONE),
+            NSERROR_OK);
+    }
+
+    return t;
+}
+
+/**
+ * Pick a random live node
+ */
+static struct test_node *test_pick(void)
+{
+    unsigned int i = test_rand() % test_node_count;
+    unsigned int n;
+
+    for (n = 0; n < test_node_count; n++) {
+        if (test_nodes[(i + n) % test_node_count].live) {
+            return &test_nodes[(i + n) % test_node_count];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Create a test tree with one folder big enough to have its children's
+ * offsets indexed, a nested one which is nearly so, and a small one
+ */
+static treeview *test_tree(void)
+{
+    struct test_node *big, *nested, *small;
+    treeview *tree;
+    int i;
+
+    ck_assert_int_eq(treeview_create(&tree, &test_cb, 3, test_fields, NULL, TREEVIEW_SEARCHABLE), NSERROR_OK);
+
+    big = test_add(tree, NULL, TREE_REL_FIRST_CHILD, true);
+    for (i = 0; i < TREEVIEW_CHILD_INDEX_MIN * 3; i++) {
+        test_add(tree, big->node, TREE_REL_FIRST_CHILD, false);
+    }
+
+    nested = test_add(tree, big->node, TREE_REL_FIRST_CHILD, true);
+    for (i = 0; i < TREEVIEW_CHILD_INDEX_MIN - 1; i++) {
+        test_add(tree, nested->node, TREE_REL_FIRST_CHILD, false);
+    }
+
+    small = test_add(tree, big->node, TREE_REL_NEXT_SIBLING, true);
+    for (i = 0; i < 4; i++) {
+        test_add(tree, small->node, TREE_REL_FIRST_CHILD, false);
+    }
+
+    ck_assert_int_eq(treeview_node_expand(tree, big->node), NSERROR_OK);
+    ck_assert_int_eq(treeview_node_expand(tree, nested->node), NSERROR_OK);
+
+    return tree;
+}
+
+/**
+ * Find the node at a y offset, and the number of rows above it, by
+ * walking every visible row
+ */
+static treeview_node *linear_y_node(treeview *tree, int target_y, int *row)
+{
+    int y = treeview__get_search_height(tree);
+    treeview_node *n;
+
+    *row = 0;
+    for (n = treeview_node_next(tree->root, false); n != NULL; n = treeview_node_next(n, false)) {
+        int h = (n->type == TREE_NODE_ENTRY) ? n->height : tree_g.line_height;
+        if (target_y >= y && target_y < y + h) {
+            return n;
+        }
+        y += h;
+        (*row)++;
+    }
+    return NULL;
+}
+
+/**
+ * Find the y offset of a node by walking every visible row above it
+ */
+static int linear_node_y(treeview *tree, const treeview_node *node)
+{
+    int y = treeview__get_search_height(tree);
+    treeview_node *n;
+
+    for (n = treeview_node_next(tree->root, false); n != NULL && n != node; n = treeview_node_next(n, false)) {
+        y += (n->type == TREE_NODE_ENTRY) ? n->height : tree_g.line_height;
+    }
+    return y;
+}
+
+/**
+ * Check row lookups against walks of the visible rows
+ */
+static void check_rows(treeview *tree)
+{
+    int search_height = treeview__get_search_height(tree);
+    treeview_node *n, *expect;
+    int y, expect_row;
+    int row_y, rows;
+
+    for (y = -2; y < search_height + tree->root->height + 2; y++) {
+        expect = linear_y_node(tree, y, &expect_row);
+        ck_assert_ptr_eq(treeview_y_node(tree, y), expect);
+
+        n = treeview__row_at(tree, y - search_height, &row_y, &rows);
+        ck_assert_ptr_eq(n, expect);
+        if (n != NULL) {
+            ck_assert_int_eq(rows, expect_row);
+            ck_assert_int_eq(row_y + search_height, linear_node_y(tree, n));
+        }
+    }
+
+    /* Hidden nodes are placed at the bottom, as the walk leaves them */
+    for (n = tree->root->children; n != NULL; n = treeview_node_next(n, true)) {
+        ck_assert_int_eq(treeview_node_y(tree, n), linear_node_y(tree, n));
+    }
+
+    rows = 0;
+    for (n = treeview_node_next(tree->root, false); n != NULL; n = treeview_node_next(n, false)) {
+        rows++;
+    }
+    ck_assert_int_eq(tree->root->rows, rows);
+}
+
+/**
+ * Check the last search matched exactly what a substring scan matches
+ */
+static void check_search(treeview *tree, const char *text)
+{
+    struct treeview_node_entry *e;
+    int height = 0;
+    bool expect;
+    unsigned int i;
+
+    ck_assert_int_eq(treeview__search(tree, text, strlen(text)), NSERROR_OK);
+
+    for (i = 0; i < test_node_count; i++) {
+        if (!test_nodes[i].live || test_nodes[i].folder) {
+            continue;
+        }
+        e = (struct treeview_node_entry *)test_nodes[i].node;
+        expect = strcasestr(test_nodes[i].title, text) != NULL || strcasestr(test_nodes[i].url, text) != NULL;
+        ck_assert_msg(((e->base.flags & TV_NFLAGS_MATCHED) != 0) == expect, "\"%s\" in \"%s\" \"%s\"", text,
+            test_nodes[i].title, test_nodes[i].url);
+        if (expect) {
+            height += e->base.height;
+        }
+    }
+
+    ck_assert_int_eq(tree->search.height, height);
+}
+
+/**
+ * Search for random text, some of it taken from live entries
+ */
+static void check_searches(treeview *tree)
+{
+    char text[12];
+    struct test_node *t;
+    size_t len, start;
+    int i;
+
+    for (i = 0; i < 40; i++) {
+        t = test_pick();
+        len = 1 + test_rand() % 5;
+        if (i % 4 == 0 || strlen(t->url) < len) {
+            test_text(text, len + 4);
+            text[len] = '\0';
+        } else {
+            start = test_rand() % (strlen(t->url) - len + 1);
+            memcpy(text, t->url + start, len);
+            text[len] = '\0';
+        }
+        check_search(tree, text);
+    }
+}
+
+
+static void treeview_setup(void)
+{
+    test_seed = 1;
+    test_node_count = 0;
+
+    ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+    ck_assert_int_eq(nsoption_init(NULL, NULL, NULL), NSERROR_OK);
+    ck_assert_int_eq(treeview_init(), NSERROR_OK);
+
+    ck_assert(lwc_intern_string("Title", 5, &test_fields[0].field) == lwc_error_ok);
+    test_fields[0].flags = TREE_FLAG_DEFAULT;
+    ck_assert(lwc_intern_string("URL", 3, &test_fields[1].field) == lwc_error_ok);
+    test_fields[1].flags = TREE_FLAG_SEARCHABLE;
+    ck_assert(lwc_intern_string("Folder", 6, &test_fields[2].field) == lwc_error_ok);
+    test_fields[2].flags = TREE_FLAG_DEFAULT;
+}
+
+static void treeview_teardown(void)
+{
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        lwc_string_unref(test_fields[i].field);
+    }
+
+    ck_assert_int_eq(treeview_fini(), NSERROR_OK);
+    nsoption_finalise(nsoptions, nsoptions_default);
+    corestrings_fini();
+}
+
+
+/**
+ * Row lookups match a walk of the visible rows through random insertions,
+ * deletions, expansions and contractions.
+ */
+START_TEST(treeview_rows_test)
+{
+    struct test_node *t;
+    treeview *tree;
+    int i;
+
+    tree = test_tree();
+    check_rows(tree);
+
+    for (i = 0; i < 300; i++) {
+        t = test_pick();
+        if (t == NULL) {
+            /* Everything was deleted; start again */
+            t = test_add(tree, NULL, TREE_REL_FIRST_CHILD, true);
+        }
+        switch (test_rand() % 6) {
+        case 0:
+            /* Insert after a node */
+            test_add(tree, t->node, TREE_REL_NEXT_SIBLING, test_rand() % 8 == 0);
+            break;
+
+        case 1:
+            /* Insert at the top of a folder */
+            test_add(tree, t->folder ? t->node : t->node->parent, TREE_REL_FIRST_CHILD, false);
+            break;
+
+        case 2:
+            if (test_rand() % 4 == 0 || !t->folder) {
+                ck_assert_int_eq(treeview_delete_node(tree, t->node, TREE_OPTION_NONE), NSERROR_OK);
+            }
+            break;
+
+        case 3:
+        case 4:
+            ck_assert_int_eq(treeview_node_expand(tree, t->node), NSERROR_OK);
+            break;
+
+        case 5:
+            ck_assert_int_eq(treeview_node_contract(tree, t->node), NSERROR_OK);
+            break;
+        }
+        check_rows(tree);
+
+        if (test_node_count > TEST_NODES - 4) {
+            break;
+        }
+    }
+
+    ck_assert_int_eq(treeview_expand(tree, false), NSERROR_OK);
+    check_rows(tree);
+    ck_assert_int_eq(treeview_contract(tree, false), NSERROR_OK);
+    check_rows(tree);
+
+    ck_assert_int_eq(treeview_destroy(tree), NSERROR_OK);
+}
+END_TEST
+
+
+/**
+ * Indexed search matches a substring scan as entries are added, changed
+ * and deleted, and after the index is rebuilt.
+ */
+START_TEST(treeview_search_test)
+{
+    struct test_node *t;
+    treeview *tree;
+    unsigned int i;
+
+    tree = test_tree();
+
+    check_searches(tree);
+    ck_assert_ptr_nonnull(tree->search.index);
+
+    /* Entries added to an existing index */
+    for (i = 0; i < 100; i++) {
+        t = test_pick();
+        test_add(tree, t->folder ? t->node : t->node->parent, TREE_REL_FIRST_CHILD, false);
+    }
+    check_searches(tree);
+
+    /* Entries changed */
+    for (i = 0; i < 60; i++) {
+        t = test_pick();
+        if (!t->folder) {
+            test_text(t->url, sizeof(t->url));
+            t->data[1].value_len = strlen(t->url);
+            ck_assert_int_eq(treeview_update_node_entry(tree, t->node, t->data, t), NSERROR_OK);
+        }
+    }
+    check_searches(tree);
+
+    /* Most entries deleted, so the index is rebuilt */
+    for (i = 0; i < test_node_count; i++) {
+        if (test_nodes[i].live && !test_nodes[i].folder && i % 5 != 0) {
+            ck_assert_int_eq(treeview_delete_node(tree, test_nodes[i].node, TREE_OPTION_NONE), NSERROR_OK);
+        }
+    }
+    ck_assert_uint_gt(tree->search.index->stale, tree->search.index->live);
+    check_searches(tree);
+    ck_assert_uint_eq(tree->search.index->stale, 0);
+
+    ck_assert_int_eq(treeview__search(tree, "", 0), NSERROR_OK);
+    ck_assert(!tree->search.search);
+
+    ck_assert_int_eq(treeview_destroy(tree), NSERROR_OK);
+}
+END_TEST
+
+
+static Suite *treeview_suite(void)
+{
+    Suite *s = suite_create("treeview");
+    TCase *tc = tcase_create("Treeview");
+
+    tcase_add_checked_fixture(tc, treeview_setup, treeview_teardown);
+    tcase_add_test(tc, treeview_rows_test);
+    tcase_add_test(tc, treeview_search_test);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = treeview_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
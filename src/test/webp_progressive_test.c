@@ -0,0 +1,326 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of Wisp.
+ *
+ * Tests for decoding WebP images as their data arrives.
+ *
+ * Feeds lossy and lossless encoded images to the WebP content handler in
+ * chunks and compares the partly decoded bitmap with the image decoded in
+ * one go, checking that rows are gained from the top, that the bitmap is
+ * handed to the image cache once complete, that a truncated image is left
+ * to the full decoder, and that redraws are throttled.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <webp/decode.h>
+#include <webp/encode.h>
+
+#include <wisp/bitmap.h>
+#include <wisp/content/content_protected.h>
+#include <wisp/desktop/gui_internal.h>
+#include <wisp/utils/utils.h>
+#include "desktop/bitmap.h"
+#include "content/handlers/image/image_cache.h"
+#include "content/handlers/image/webp.h"
+
+#include "test/image_decode_stubs.h"
+
+extern const struct content_handler *content_stubs_handler;
+
+/** Size of the test image */
+#define TEST_WIDTH 96
+#define TEST_HEIGHT 80
+
+/** Minimum interval between redraws of a partly decoded image / ms */
+#define TEST_PROGRESS_INTERVAL 250
+
+/** Chunk sizes the images are delivered in */
+static const size_t test_chunk[] = {1, 7, 64, 4096};
+
+static const struct content_handler *handler;
+static struct content *content;
+static uint8_t *image;
+static size_t image_size;
+
+/** The test image decoded in one go, in the client bitmap format */
+static uint32_t reference[TEST_WIDTH * TEST_HEIGHT];
+
+
+/**
+ * Encode the test image, a gradient with some detail, and decode it in one
+ * go into the reference pixels.
+ *
+ * \param lossless true to encode it losslessly
+ */
+static void test_webp_create(bool lossless)
+{
+    static uint8_t rgba[TEST_WIDTH * TEST_HEIGHT * 4];
+    uint8_t *decoded;
+    int width, height;
+    int x, y;
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            uint8_t *p = &rgba[(y * TEST_WIDTH + x) * 4];
+
+            p[0] = x * 2;
+            p[1] = y * 3;
+            p[2] = 0x80 + (x ^ y);
+            p[3] = 0xff;
+        }
+    }
+
+    if (lossless) {
+        image_size = WebPEncodeLosslessRGBA(rgba, TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH * 4, &image);
+    } else {
+        image_size = WebPEncodeRGBA(rgba, TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH * 4, 90, &image);
+    }
+    ck_assert_uint_gt(image_size, 0);
+
+    decoded = WebPDecodeRGBA(image, image_size, &width, &height);
+    ck_assert_ptr_nonnull(decoded);
+    ck_assert_int_eq(width, TEST_WIDTH);
+    ck_assert_int_eq(height, TEST_HEIGHT);
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            const uint8_t *d = &decoded[(y * TEST_WIDTH + x) * 4];
+            uint8_t p[4];
+
+            p[bitmap_layout.r] = d[0];
+            p[bitmap_layout.g] = d[1];
+            p[bitmap_layout.b] = d[2];
+            p[bitmap_layout.a] = d[3];
+            memcpy(&reference[y * TEST_WIDTH + x], p, 4);
+        }
+    }
+
+    WebPFree(decoded);
+}
+
+/**
+ * Check the rows decoded into a bitmap are the first rows of the image
+ * and are correct, while the rest are clear.
+ *
+ * \return The number of rows decoded
+ */
+static int check_rows(struct bitmap *bitmap)
+{
+    int rows = 0;
+    int x, y;
+
+    while (rows < TEST_HEIGHT && stub_bitmap_alpha(bitmap, 0, rows) != 0) {
+        rows++;
+    }
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+            if (y < rows) {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), reference[y * TEST_WIDTH + x]);
+            } else {
+                ck_assert_uint_eq(stub_bitmap_pixel(bitmap, x, y), 0);
+            }
+        }
+    }
+
+    return rows;
+}
+
+/**
+ * Finish the content and check the decoded bitmap was handed to the image
+ * cache as the image.
+ *
+ * \param bitmap The bitmap decoded as data arrived
+ */
+static void check_handoff(struct bitmap *bitmap)
+{
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_int_eq(content->status, CONTENT_STATUS_DONE);
+
+    ck_assert_uint_eq(stub_bitmaps_created, 1);
+    ck_assert_uint_eq(stub_bitmaps_destroyed, 0);
+    ck_assert_ptr_eq(image_cache_get_bitmap(content), bitmap);
+    ck_assert(stub_bitmap_opaque(bitmap));
+}
+
+/**
+ * Deliver half the image in chunks and check rows are decoded from the
+ * top, then the rest and check the whole image is handed over.
+ */
+static void check_chunked(size_t chunk)
+{
+    struct bitmap *bitmap;
+    int rows;
+
+    ck_assert(stub_image_receive(content, image, 0, image_size / 2, chunk, 0));
+    bitmap = stub_bitmap_last;
+    ck_assert_ptr_nonnull(bitmap);
+    rows = check_rows(bitmap);
+    ck_assert_int_gt(rows, 0);
+    ck_assert_int_lt(rows, TEST_HEIGHT);
+
+    ck_assert(stub_image_receive(content, image, image_size / 2, image_size, chunk, 0));
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+
+    check_handoff(bitmap);
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+}
+
+/**
+ * Set up the image cache and create a WebP content.
+ *
+ * \param speculative_small Size of the largest image decoded as it arrives
+ */
+static void fixture_init(size_t speculative_small)
+{
+    stub_image_init(speculative_small);
+
+    ck_assert_int_eq(nswebp_init(), NSERROR_OK);
+    handler = content_stubs_handler;
+    content = stub_image_create(handler);
+    ck_assert_ptr_nonnull(content);
+
+    image = NULL;
+    image_size = 0;
+}
+
+static void fixture_setup(void)
+{
+    fixture_init(1024 * 1024);
+}
+
+static void fixture_setup_large(void)
+{
+    /* too large to be decoded as it arrives */
+    fixture_init(0);
+}
+
+static void fixture_teardown(void)
+{
+    stub_image_destroy(content);
+    WebPFree(image);
+    stub_image_fini();
+}
+
+
+/**
+ * Lossy images gain rows from the top as they arrive, whatever the chunks.
+ */
+START_TEST(webp_progressive_lossy_test)
+{
+    test_webp_create(false);
+    check_chunked(test_chunk[_i]);
+}
+END_TEST
+
+/**
+ * Lossless images gain rows from the top as they arrive, whatever the
+ * chunks.
+ */
+START_TEST(webp_progressive_lossless_test)
+{
+    test_webp_create(true);
+    check_chunked(test_chunk[_i]);
+}
+END_TEST
+
+/**
+ * An image whose data ends early is left to the full decoder and the
+ * partly decoded bitmap is discarded.
+ */
+START_TEST(webp_progressive_truncated_test)
+{
+    test_webp_create(false);
+
+    ck_assert(stub_image_receive(content, image, 0, image_size / 2, 64, 0));
+    ck_assert_ptr_nonnull(stub_bitmap_last);
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_int_eq(content->status, CONTENT_STATUS_DONE);
+
+    ck_assert_ptr_null(stub_bitmap_last);
+    ck_assert_ptr_null(image_cache_get_bitmap(content));
+    ck_assert_uint_eq(stub_bitmaps_destroyed, stub_bitmaps_created);
+}
+END_TEST
+
+/**
+ * The first rows are redrawn at once and the rest no more often than the
+ * progress interval, however many chunks they arrive in.
+ */
+START_TEST(webp_progressive_throttle_test)
+{
+    unsigned int chunks;
+
+    test_webp_create(false);
+
+    ck_assert(stub_image_receive(content, image, 0, image_size / 2, 1, 0));
+    ck_assert_uint_eq(stub_redraw_count, 1);
+
+    chunks = (image_size - image_size / 2 + 15) / 16;
+    ck_assert(stub_image_receive(content, image, image_size / 2, image_size, 16, 100));
+    ck_assert_uint_gt(stub_redraw_count, 1);
+    ck_assert_uint_le(stub_redraw_count, 2 + chunks * 100 / TEST_PROGRESS_INTERVAL);
+}
+END_TEST
+
+/**
+ * Images too large to speculate on are decoded when they are needed.
+ */
+START_TEST(webp_progressive_large_test)
+{
+    struct bitmap *bitmap;
+
+    test_webp_create(false);
+
+    ck_assert(stub_image_receive(content, image, 0, image_size, 64, TEST_PROGRESS_INTERVAL));
+    ck_assert(content->handler->data_complete(content));
+    ck_assert_uint_eq(stub_bitmaps_created, 0);
+    ck_assert_uint_eq(stub_redraw_count, 0);
+
+    bitmap = image_cache_get_bitmap(content);
+    ck_assert_ptr_nonnull(bitmap);
+    ck_assert_int_eq(check_rows(bitmap), TEST_HEIGHT);
+}
+END_TEST
+
+
+static Suite *webp_progressive_suite(void)
+{
+    Suite *s = suite_create("webp_progressive");
+    TCase *tc = tcase_create("Progressive");
+    TCase *tc_large = tcase_create("Large");
+
+    tcase_add_checked_fixture(tc, fixture_setup, fixture_teardown);
+    tcase_add_loop_test(tc, webp_progressive_lossy_test, 0, NOF_ELEMENTS(test_chunk));
+    tcase_add_loop_test(tc, webp_progressive_lossless_test, 0, NOF_ELEMENTS(test_chunk));
+    tcase_add_test(tc, webp_progressive_truncated_test);
+    tcase_add_test(tc, webp_progressive_throttle_test);
+    suite_add_tcase(s, tc);
+
+    tcase_add_checked_fixture(tc_large, fixture_setup_large, fixture_teardown);
+    tcase_add_test(tc_large, webp_progressive_large_test);
+    suite_add_tcase(s, tc_large);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = webp_progressive_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
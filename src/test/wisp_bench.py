@@ -0,0 +1,392 @@
+#!/usr/bin/python3
+#
+# Copyright 2026 Wisp Contributors
+#
+# This file is part of NetSurf, http://www.netsurf-browser.org/
+#
+# NetSurf is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# NetSurf is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+benchmarks page loads in monkey over an offline corpus
+
+Each page of the corpus is loaded by a fresh monkey several times.  The
+pages are served by a local stand-in HTTP server, which monkey also uses
+as its proxy so nothing is ever fetched from the network.  Every load is
+painted with the raster plotters and the STATS report taken once it has
+finished; the median of each figure is written out as JSON.
+
+Given a baseline from an earlier run, the results are compared with it
+and the exit status is non-zero if any figure regressed by more than the
+threshold.
+"""
+
+# pylint: disable=locally-disabled, missing-docstring
+
+import argparse
+import email
+import email.policy
+import json
+import mimetypes
+import os
+import shutil
+import statistics
+import sys
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlsplit
+
+import yaml
+
+from monkeyfarmer import Browser
+
+SOURCE_ROOT = os.path.realpath(os.path.join(os.path.dirname(__file__), "..", ".."))
+
+DEFAULT_CORPUS = os.path.join(os.path.dirname(__file__), "bench-corpus.yaml")
+
+# Figures compared against a baseline, where larger is worse
+COMPARED_FIGURES = ("phases", "elapsed", "memory", "alloc")
+
+
+class PageTimeout(Exception):
+    pass
+
+
+def unpack_mhtml(data, base):
+    """
+    unpack an MHTML archive into resources served below base
+
+    The references between parts are rewritten to the served paths, so the
+    page loads entirely from the stand-in server.
+
+    Returns the served document and a dict of the other resources, both as
+    (content type, body) tuples.
+    """
+    archive = email.message_from_bytes(data, policy=email.policy.default)
+    parts = [part for part in archive.walk() if not part.is_multipart()]
+    if len(parts) == 0:
+        raise ValueError("no parts in MHTML archive")
+
+    locations = {}
+    resources = {}
+    for index, part in enumerate(parts):
+        path = "{}/part{}".format(base, index)
+        location = part.get("Content-Location")
+        if location is not None:
+            locations[location.encode("utf-8")] = path.encode("utf-8")
+        resources[path] = (part.get_content_type(), part.get_payload(decode=True) or b"")
+
+    def rewrite(body):
+        for location, path in locations.items():
+            body = body.replace(location.replace(b"&", b"&amp;"), path)
+            body = body.replace(location, path)
+        return body
+
+    for path, (ctype, body) in resources.items():
+        if ctype in ("text/html", "text/css"):
+            resources[path] = (ctype, rewrite(body))
+
+    document = resources.pop("{}/part0".format(base))
+    return document, resources
+
+
+class CorpusHandler(BaseHTTPRequestHandler):
+    """
+    serves the corpus, refusing anything asked of other hosts
+    """
+
+    def do_GET(self):
+        corpus = self.server.corpus
+        url = urlsplit(self.path)
+        if url.netloc not in ("", corpus.netloc):
+            corpus.refused()
+            self.send_error(404, "Offline")
+            return
+
+        found = corpus.find(url.path)
+        if found is None:
+            self.send_error(404)
+            return
+
+        ctype, body = found
+        self.send_response(200)
+        self.send_header("Content-Type", ctype)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_CONNECT(self):
+        self.server.corpus.refused()
+        self.send_error(403, "Offline")
+
+    def log_message(self, format, *args):
+        # pylint: disable=locally-disabled, redefined-builtin
+        pass
+
+
+class CorpusServer:
+    """
+    a local HTTP server standing in for the network
+    """
+
+    def __init__(self, root):
+        self.root = root
+        self.resources = {}
+        self.lock = threading.Lock()
+        self.refusals = 0
+        self.httpd = ThreadingHTTPServer(("127.0.0.1", 0), CorpusHandler)
+        self.httpd.daemon_threads = True
+        self.httpd.corpus = self
+        self.port = self.httpd.server_address[1]
+        self.netloc = "127.0.0.1:{}".format(self.port)
+        self.thread = threading.Thread(target=self.httpd.serve_forever, daemon=True)
+        self.thread.start()
+
+    def add_mhtml(self, page):
+        with open(os.path.join(self.root, page), "rb") as fh:
+            document, resources = unpack_mhtml(fh.read(), "/" + page)
+        self.resources["/" + page] = document
+        self.resources.update(resources)
+
+    def find(self, path):
+        if path in self.resources:
+            return self.resources[path]
+        name = os.path.realpath(os.path.join(self.root, path.lstrip("/")))
+        if not name.startswith(self.root + os.sep) or not os.path.isfile(name):
+            return None
+        ctype = mimetypes.guess_type(name)[0] or "application/octet-stream"
+        with open(name, "rb") as fh:
+            return ctype, fh.read()
+
+    def url(self, page):
+        return "http://{}/{}".format(self.netloc, page)
+
+    def refused(self):
+        with self.lock:
+            self.refusals += 1
+
+    def take_refusals(self):
+        with self.lock:
+            refusals = self.refusals
+            self.refusals = 0
+        return refusals
+
+    def stop(self):
+        self.httpd.shutdown()
+        self.httpd.server_close()
+
+
+def load_corpus(path):
+    with open(path) as fh:
+        corpus = yaml.safe_load(fh)
+    return corpus["pages"]
+
+
+def timed_out(_farmer):
+    raise PageTimeout()
+
+
+def load_once(args, server, page):
+    """
+    load a page in a fresh monkey and return its statistics
+    """
+    home = tempfile.mkdtemp(prefix="wisp-bench-")
+    env = dict(os.environ)
+    env["HOME"] = home
+    browser = Browser(
+        monkey_cmd=[args.monkey],
+        monkey_env=env,
+        quiet=not args.verbose,
+        wrapper=args.wrapper,
+        echo=args.verbose)
+    try:
+        browser.pass_options(
+            "http_proxy=1",
+            "http_proxy_host=127.0.0.1",
+            "http_proxy_port={}".format(server.port),
+            "http_proxy_noproxy=",
+            "enable_javascript={}".format(0 if args.no_javascript else 1))
+        browser.farmer.schedule_event(timed_out, secs=args.timeout)
+
+        win = browser.new_window()
+        win.set_plotter("RASTER")
+        browser.reset_stats()
+        win.load_page(server.url(page))
+        win.redraw()
+        stats = browser.report_stats()
+
+        browser.farmer.unschedule_event(timed_out)
+        if not browser.quit_and_wait():
+            browser.farmer.monkey.kill()
+    except BaseException:
+        browser.farmer.monkey.kill()
+        raise
+    finally:
+        browser.farmer.monkey.wait()
+        shutil.rmtree(home, ignore_errors=True)
+
+    stats["refused"] = server.take_refusals()
+    return stats
+
+
+def median_of(samples):
+    """
+    the median of each figure in a list of like-shaped statistics
+    """
+    first = samples[0]
+    if isinstance(first, dict):
+        return {key: median_of([sample[key] for sample in samples if key in sample]) for key in first}
+    return statistics.median(samples)
+
+
+def add_hit_rates(caches):
+    """
+    add the proportion of lookups each cache answered itself
+
+    Lookups the cache never considers, being uncacheable or bypassing it,
+    are left out.
+    """
+    for counts in caches.values():
+        lookups = sum(value for key, value in counts.items() if key not in ("uncacheable", "bypass"))
+        if lookups > 0:
+            counts["hit_rate"] = counts.get("hit", 0) / lookups
+
+
+def bench_page(args, server, page):
+    samples = []
+    for _ in range(args.iterations):
+        samples.append(load_once(args, server, page))
+
+    result = median_of(samples)
+    add_hit_rates(result["caches"])
+    result["iterations"] = len(samples)
+    return result
+
+
+def flatten(figures, prefix=""):
+    flat = {}
+    for key, value in figures.items():
+        name = prefix + key
+        if isinstance(value, dict):
+            flat.update(flatten(value, name + "."))
+        else:
+            flat[name] = value
+    return flat
+
+
+def compare(results, baseline, threshold, floor):
+    """
+    list the figures which regressed against a baseline
+
+    A figure regresses when it grew by more than threshold percent and by
+    more than floor; a cache hit rate regresses when it fell by more than
+    threshold percentage points.
+    """
+    regressions = []
+    for page, result in results["pages"].items():
+        base = baseline.get("pages", {}).get(page)
+        if base is None:
+            continue
+
+        current = flatten({key: result[key] for key in COMPARED_FIGURES if key in result})
+        previous = flatten({key: base[key] for key in COMPARED_FIGURES if key in base})
+        for name, value in current.items():
+            old = previous.get(name)
+            if old is None or (name.startswith("phases.") and name.endswith(".count")):
+                continue
+            if value - old > floor and value > old * (1 + threshold / 100):
+                regressions.append((page, name, old, value))
+
+        for name, cache in result.get("caches", {}).items():
+            old = base.get("caches", {}).get(name, {}).get("hit_rate")
+            new = cache.get("hit_rate")
+            if old is not None and new is not None and (old - new) * 100 > threshold:
+                regressions.append((page, "caches.{}.hit_rate".format(name), old, new))
+
+    return regressions
+
+
+def parse_argv(argv):
+    parser = argparse.ArgumentParser(description="Benchmark page loads in monkey over an offline corpus")
+    parser.add_argument("-m", "--monkey", required=True, help="path to nsmonkey")
+    parser.add_argument("-c", "--corpus", default=DEFAULT_CORPUS, help="corpus manifest")
+    parser.add_argument("-o", "--output", help="write the results here as JSON")
+    parser.add_argument("-n", "--iterations", type=int, default=5, help="loads of each page")
+    parser.add_argument("-p", "--page", action="append", help="only benchmark this page of the corpus")
+    parser.add_argument("--compare", metavar="BASELINE", help="results of an earlier run to compare with")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percentage a figure may regress by before failing")
+    parser.add_argument("--floor", type=float, default=1000.0,
+                        help="change, in the figure's own unit, below which it never regresses")
+    parser.add_argument("--timeout", type=float, default=60.0, help="seconds allowed for each load")
+    parser.add_argument("--no-javascript", action="store_true", help="load pages without JavaScript")
+    parser.add_argument("-w", "--wrapper", action="append", help="wrapper command for monkey")
+    parser.add_argument("-v", "--verbose", action="store_true", help="show the monkey conversation")
+    args = parser.parse_args(argv)
+    if args.wrapper is not None:
+        args.wrapper = " ".join(args.wrapper).split()
+    return args
+
+
+def main(argv):
+    args = parse_argv(argv)
+    pages = load_corpus(args.corpus)
+    if args.page is not None:
+        pages = [page for page in pages if page in args.page]
+
+    server = CorpusServer(SOURCE_ROOT)
+    results = {"monkey": args.monkey, "iterations": args.iterations, "pages": {}}
+    failed = False
+    try:
+        for page in pages:
+            if page.endswith(".mhtml"):
+                server.add_mhtml(page)
+            start = time.time()
+            try:
+                result = bench_page(args, server, page)
+            except (PageTimeout, RuntimeError) as exc:
+                print("{}: FAILED {}".format(page, type(exc).__name__ if str(exc) == "" else exc))
+                failed = True
+                continue
+            results["pages"][page] = result
+            print("{}: total {:.1f} ms ({}) in {:.1f} s".format(
+                page, result["elapsed"] / 1000,
+                ", ".join("{} {:.1f}".format(name, phase["time"] / 1000)
+                          for name, phase in result["phases"].items() if name != "none"),
+                time.time() - start))
+    finally:
+        server.stop()
+
+    if args.output is not None:
+        with open(args.output, "w") as fh:
+            json.dump(results, fh, indent=2, sort_keys=True)
+            fh.write("\n")
+
+    if args.compare is not None:
+        with open(args.compare) as fh:
+            baseline = json.load(fh)
+        regressions = compare(results, baseline, args.threshold, args.floor)
+        for page, name, old, new in regressions:
+            print("REGRESSION {} {}: {} -> {}".format(page, name, old, new))
+        if len(regressions) > 0:
+            failed = True
+        else:
+            print("No regressions beyond {}%".format(args.threshold))
+
+    return 1 if failed else 0
+
+
+# Some python weirdness to get to main().
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
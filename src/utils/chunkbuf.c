@@ -0,0 +1,470 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Chunked byte buffer (implementation).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wisp/utils/utils.h>
+
+#include "utils/chunkbuf.h"
+
+/** Smallest block allocated when appending */
+#define CHUNKBUF_BLOCK_MIN (64 * 1024)
+
+/** Largest block allocated when appending, unless the data is larger */
+#define CHUNKBUF_BLOCK_MAX (4 * 1024 * 1024)
+
+/**
+ * Reference counted block of bytes
+ *
+ * Runs refer to a prefix of a block, so bytes written beyond the longest
+ * run are invisible to every buffer sharing the block. The bytes are a
+ * separate allocation so they can be handed over by chunkbuf_detach().
+ */
+struct chunkbuf_block {
+    unsigned int refcnt; /**< Number of runs referring to the block */
+    size_t size; /**< Number of bytes the block can hold */
+    size_t used; /**< Number of bytes written to the block */
+    uint8_t *data; /**< The bytes */
+    chunkbuf_release_cb release; /**< Releases wrapped bytes, NULL if owned */
+    void *pw; /**< Private word for release */
+};
+
+/**
+ * Create a block owning its bytes
+ *
+ * \param size  Number of bytes the block can hold
+ * \return the block with a single reference, or NULL on memory exhaustion
+ */
+static struct chunkbuf_block *chunkbuf_block_create(size_t size)
+{
+    struct chunkbuf_block *block;
+
+    block = malloc(sizeof(*block));
+    if (block == NULL) {
+        return NULL;
+    }
+
+    /* Never ask for nothing, which may not be distinguishable from failure */
+    block->data = malloc(size > 0 ? size : 1);
+    if (block->data == NULL) {
+        free(block);
+        return NULL;
+    }
+
+    block->refcnt = 1;
+    block->size = size;
+    block->used = 0;
+    block->release = NULL;
+    block->pw = NULL;
+
+    return block;
+}
+
+/**
+ * Drop a reference to a block, destroying it when none are left
+ *
+ * \param block  The block
+ */
+static void chunkbuf_block_unref(struct chunkbuf_block *block)
+{
+    if (--block->refcnt > 0) {
+        return;
+    }
+
+    if (block->release != NULL) {
+        block->release(block->pw);
+    } else {
+        free(block->data);
+    }
+    free(block);
+}
+
+/**
+ * Add a run to the end of a buffer
+ *
+ * \param buf    The buffer
+ * \param block  The block holding the run, whose reference is taken over
+ * \param len    Length of the run
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion
+ */
+static nserror chunkbuf_push(struct chunkbuf *buf, struct chunkbuf_block *block, size_t len)
+{
+    if (buf->count == buf->alloc) {
+        unsigned int alloc = (buf->alloc == 0) ? 4 : buf->alloc * 2;
+        struct chunkbuf_run *runs;
+
+        runs = realloc(buf->runs, alloc * sizeof(*runs));
+        if (runs == NULL) {
+            return NSERROR_NOMEM;
+        }
+        buf->runs = runs;
+        buf->alloc = alloc;
+    }
+
+    buf->runs[buf->count].block = block;
+    buf->runs[buf->count].len = len;
+    buf->count++;
+    buf->len += len;
+
+    return NSERROR_OK;
+}
+
+/**
+ * Find the space left for appending in the last block of a buffer
+ *
+ * Appending is only possible where the last run ends at the last byte
+ * written to an owned block, which holds for at most one of the buffers
+ * sharing that block.
+ *
+ * \param buf  The buffer
+ * \return the number of bytes that may be appended in place
+ */
+static size_t chunkbuf_room(const struct chunkbuf *buf)
+{
+    const struct chunkbuf_run *run;
+
+    if (buf->count == 0) {
+        return 0;
+    }
+
+    run = &buf->runs[buf->count - 1];
+    if (run->block->release != NULL || run->len != run->block->used) {
+        return 0;
+    }
+
+    return run->block->size - run->block->used;
+}
+
+/**
+ * Copy bytes into the space left in the last block of a buffer
+ *
+ * \param buf   The buffer
+ * \param data  The bytes
+ * \param len   Number of bytes, no more than chunkbuf_room()
+ */
+static void chunkbuf_fill(struct chunkbuf *buf, const uint8_t *data, size_t len)
+{
+    struct chunkbuf_run *run = &buf->runs[buf->count - 1];
+
+    memcpy(run->block->data + run->block->used, data, len);
+    run->block->used += len;
+    run->len += len;
+    buf->len += len;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+void chunkbuf_release(struct chunkbuf *buf)
+{
+    unsigned int i;
+
+    for (i = 0; i < buf->count; i++) {
+        chunkbuf_block_unref(buf->runs[i].block);
+    }
+    free(buf->runs);
+
+    buf->runs = NULL;
+    buf->count = 0;
+    buf->alloc = 0;
+    buf->len = 0;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+nserror chunkbuf_reserve(struct chunkbuf *buf, size_t size)
+{
+    struct chunkbuf_block *block;
+    nserror res;
+
+    if (chunkbuf_room(buf) >= size) {
+        return NSERROR_OK;
+    }
+
+    block = chunkbuf_block_create(size);
+    if (block == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    res = chunkbuf_push(buf, block, 0);
+    if (res != NSERROR_OK) {
+        chunkbuf_block_unref(block);
+    }
+
+    return res;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+nserror chunkbuf_append(struct chunkbuf *buf, const uint8_t *data, size_t len)
+{
+    struct chunkbuf_block *block;
+    size_t room = chunkbuf_room(buf);
+    size_t size;
+    nserror res;
+
+    if (room >= len) {
+        chunkbuf_fill(buf, data, len);
+        return NSERROR_OK;
+    }
+
+    /* Grow in proportion to what is held so the number of blocks stays
+     * logarithmic in the length, without overshooting by too much */
+    size = buf->len;
+    if (size < CHUNKBUF_BLOCK_MIN) {
+        size = CHUNKBUF_BLOCK_MIN;
+    } else if (size > CHUNKBUF_BLOCK_MAX) {
+        size = CHUNKBUF_BLOCK_MAX;
+    }
+    if (size < len - room) {
+        size = len - room;
+    }
+
+    block = chunkbuf_block_create(size);
+    if (block == NULL) {
+        return NSERROR_NOMEM;
+    }
+    res = chunkbuf_push(buf, block, 0);
+    if (res != NSERROR_OK) {
+        chunkbuf_block_unref(block);
+        return res;
+    }
+
+    if (room > 0) {
+        /* Fill the previous block before moving on to the new one */
+        struct chunkbuf_run *run = &buf->runs[buf->count - 2];
+
+        memcpy(run->block->data + run->block->used, data, room);
+        run->block->used += room;
+        run->len += room;
+        buf->len += room;
+        data += room;
+        len -= room;
+    }
+    chunkbuf_fill(buf, data, len);
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+nserror
+chunkbuf_wrap(struct chunkbuf *buf, const uint8_t *data, size_t len, chunkbuf_release_cb release, void *pw)
+{
+    struct chunkbuf_block *block;
+    nserror res;
+
+    block = malloc(sizeof(*block));
+    if (block == NULL) {
+        return NSERROR_NOMEM;
+    }
+    block->refcnt = 1;
+    block->size = len;
+    block->used = len;
+    block->data = (uint8_t *)data;
+    block->release = release;
+    block->pw = pw;
+
+    res = chunkbuf_push(buf, block, len);
+    if (res != NSERROR_OK) {
+        /* The caller still owns the bytes */
+        free(block);
+    }
+
+    return res;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+nserror chunkbuf_clone(const struct chunkbuf *buf, struct chunkbuf *clone)
+{
+    unsigned int i;
+
+    clone->runs = NULL;
+    clone->count = 0;
+    clone->alloc = 0;
+    clone->len = 0;
+
+    if (buf->count == 0) {
+        return NSERROR_OK;
+    }
+
+    clone->runs = malloc(buf->count * sizeof(*clone->runs));
+    if (clone->runs == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    for (i = 0; i < buf->count; i++) {
+        clone->runs[i] = buf->runs[i];
+        clone->runs[i].block->refcnt++;
+    }
+    clone->count = buf->count;
+    clone->alloc = buf->count;
+    clone->len = buf->len;
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+const uint8_t *chunkbuf_get_run(const struct chunkbuf *buf, size_t offset, size_t *len)
+{
+    unsigned int i;
+
+    for (i = 0; i < buf->count; i++) {
+        const struct chunkbuf_run *run = &buf->runs[i];
+
+        if (offset < run->len) {
+            *len = run->len - offset;
+            return run->block->data + offset;
+        }
+        offset -= run->len;
+    }
+
+    *len = 0;
+    return NULL;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+const uint8_t *chunkbuf_flatten(struct chunkbuf *buf)
+{
+    struct chunkbuf_block *block;
+    unsigned int i;
+
+    if (buf->count == 0) {
+        return NULL;
+    }
+
+    if (buf->count == 1) {
+        return buf->runs[0].block->data;
+    }
+
+    block = chunkbuf_block_create(buf->len);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < buf->count; i++) {
+        memcpy(block->data + block->used, buf->runs[i].block->data, buf->runs[i].len);
+        block->used += buf->runs[i].len;
+        chunkbuf_block_unref(buf->runs[i].block);
+    }
+
+    buf->runs[0].block = block;
+    buf->runs[0].len = block->used;
+    buf->count = 1;
+
+    return block->data;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+void chunkbuf_consume_run(struct chunkbuf *buf)
+{
+    struct chunkbuf_run *run;
+    unsigned int drop = 0;
+    unsigned int i;
+
+    /* Empty runs left by reservations go along with the first byte */
+    while (drop < buf->count && buf->runs[drop].len == 0) {
+        drop++;
+    }
+    if (drop == buf->count) {
+        return;
+    }
+
+    run = &buf->runs[drop];
+    buf->len -= run->len;
+    if (drop == buf->count - 1 && run->block->refcnt == 1 && run->block->release == NULL) {
+        /* Keep the last block for whatever is appended next */
+        run->block->used = 0;
+        run->len = 0;
+    } else {
+        drop++;
+    }
+
+    for (i = 0; i < drop; i++) {
+        chunkbuf_block_unref(buf->runs[i].block);
+    }
+    memmove(buf->runs, buf->runs + drop, (buf->count - drop) * sizeof(*buf->runs));
+    buf->count -= drop;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+void chunkbuf_trim(struct chunkbuf *buf)
+{
+    struct chunkbuf_run *run;
+    uint8_t *data;
+
+    if (buf->count == 0) {
+        return;
+    }
+
+    run = &buf->runs[buf->count - 1];
+    if (run->block->refcnt != 1 || run->block->release != NULL || run->block->size == run->len ||
+        run->len == 0) {
+        return;
+    }
+
+    data = realloc(run->block->data, run->len);
+    if (data == NULL) {
+        /* The block is still valid, just larger than it need be */
+        return;
+    }
+    run->block->data = data;
+    run->block->size = run->len;
+    run->block->used = run->len;
+}
+
+
+/* exported interface documented in utils/chunkbuf.h */
+uint8_t *chunkbuf_detach(struct chunkbuf *buf, size_t *len)
+{
+    struct chunkbuf_block *block;
+    uint8_t *data;
+
+    if (chunkbuf_flatten(buf) == NULL) {
+        return NULL;
+    }
+
+    block = buf->runs[0].block;
+    if (block->refcnt == 1 && block->release == NULL) {
+        /* Hand over the block's own allocation */
+        chunkbuf_trim(buf);
+        data = block->data;
+        block->data = NULL;
+    } else {
+        data = malloc(buf->len > 0 ? buf->len : 1);
+        if (data == NULL) {
+            return NULL;
+        }
+        memcpy(data, block->data, buf->len);
+    }
+
+    *len = buf->len;
+    chunkbuf_release(buf);
+
+    return data;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Chunked byte buffer (interface).
+ *
+ * Bytes are appended to a list of reference counted blocks, so growing a
+ * buffer never copies what it already holds. Buffers may share blocks and
+ * are only copied into a single block when a caller needs the bytes to be
+ * contiguous.
+ */
+
+#ifndef _WISP_UTILS_CHUNKBUF_H_
+#define _WISP_UTILS_CHUNKBUF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <wisp/utils/errors.h>
+
+struct chunkbuf_block;
+
+/**
+ * Callback releasing bytes wrapped by a chunked buffer
+ *
+ * \param pw  The private word passed to chunkbuf_wrap()
+ */
+typedef void (*chunkbuf_release_cb)(void *pw);
+
+/**
+ * Run of bytes held in a block
+ */
+struct chunkbuf_run {
+    struct chunkbuf_block *block; /**< Block holding the run */
+    size_t len; /**< Length of the run, from the start of the block */
+};
+
+/**
+ * Chunked byte buffer
+ *
+ * A zeroed buffer is empty and holds no blocks.
+ */
+struct chunkbuf {
+    struct chunkbuf_run *runs; /**< Runs of bytes, in order */
+    unsigned int count; /**< Number of runs */
+    unsigned int alloc; /**< Allocated size of runs */
+    size_t len; /**< Total number of bytes */
+};
+
+/**
+ * Release every block held by a chunked buffer, leaving it empty
+ *
+ * \param buf  The buffer
+ */
+void chunkbuf_release(struct chunkbuf *buf);
+
+/**
+ * Determine whether a chunked buffer holds any blocks
+ *
+ * A buffer may hold an empty block, after chunkbuf_reserve() for example.
+ *
+ * \param buf  The buffer
+ * \return true if the buffer holds a block
+ */
+static inline bool chunkbuf_held(const struct chunkbuf *buf)
+{
+    return buf->count > 0;
+}
+
+/**
+ * Reserve space for bytes about to be appended to a chunked buffer
+ *
+ * \param buf   The buffer
+ * \param size  Number of bytes expected
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion
+ */
+nserror chunkbuf_reserve(struct chunkbuf *buf, size_t size);
+
+/**
+ * Append bytes to a chunked buffer
+ *
+ * \param buf   The buffer
+ * \param data  The bytes to append
+ * \param len   Number of bytes to append
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion
+ */
+nserror chunkbuf_append(struct chunkbuf *buf, const uint8_t *data, size_t len);
+
+/**
+ * Append bytes owned by someone else to a chunked buffer without copying
+ *
+ * The bytes must remain valid until \a release is called, which happens
+ * once no buffer refers to them.
+ *
+ * \param buf      The buffer
+ * \param data     The bytes to append
+ * \param len      Number of bytes to append
+ * \param release  Callback releasing the bytes
+ * \param pw       Private word for \a release
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion, in
+ *         which case \a release has not been called
+ */
+nserror
+chunkbuf_wrap(struct chunkbuf *buf, const uint8_t *data, size_t len, chunkbuf_release_cb release, void *pw);
+
+/**
+ * Make a chunked buffer share the contents of another
+ *
+ * \param buf    The buffer to share
+ * \param clone  Empty buffer to receive the contents
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion
+ */
+nserror chunkbuf_clone(const struct chunkbuf *buf, struct chunkbuf *clone);
+
+/**
+ * Get the contiguous run of bytes at an offset in a chunked buffer
+ *
+ * Iterate over a buffer by advancing the offset by the returned length
+ * until NULL is returned.
+ *
+ * \param buf     The buffer
+ * \param offset  Offset of the first byte wanted
+ * \param len     Updated to the number of contiguous bytes returned
+ * \return the bytes at \a offset, or NULL if there are none
+ */
+const uint8_t *chunkbuf_get_run(const struct chunkbuf *buf, size_t offset, size_t *len);
+
+/**
+ * Make the bytes in a chunked buffer contiguous
+ *
+ * \param buf  The buffer
+ * \return the bytes, or NULL if the buffer holds no block or on memory
+ *         exhaustion
+ */
+const uint8_t *chunkbuf_flatten(struct chunkbuf *buf);
+
+/**
+ * Discard the first run of bytes in a chunked buffer
+ *
+ * \param buf  The buffer
+ */
+void chunkbuf_consume_run(struct chunkbuf *buf);
+
+/**
+ * Release space reserved beyond the end of a chunked buffer
+ *
+ * \param buf  The buffer
+ */
+void chunkbuf_trim(struct chunkbuf *buf);
+
+/**
+ * Take the bytes out of a chunked buffer as a single allocation
+ *
+ * The bytes are only copied if they are not already held in one block that
+ * no other buffer shares. The buffer is left empty on success.
+ *
+ * \param buf  The buffer
+ * \param len  Updated to the number of bytes returned
+ * \return the bytes, to be released with free(), or NULL if the buffer holds
+ *         no block or on memory exhaustion
+ */
+uint8_t *chunkbuf_detach(struct chunkbuf *buf, size_t *len);
+
+#endif
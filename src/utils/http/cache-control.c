@@ -33,6 +33,10 @@ struct http_cache_control {
     bool max_age_valid; /**< Whether max-age is valid */
     bool no_cache; /**< Whether caching is forbidden */
     bool no_store; /**< Whether persistent caching is forbidden */
+    uint32_t stale_while_revalidate; /**< Stale-while-revalidate (delta seconds) */
+    bool stale_while_revalidate_valid; /**< Whether stale-while-revalidate is valid */
+    uint32_t stale_if_error; /**< Stale-if-error (delta seconds) */
+    bool stale_if_error_valid; /**< Whether stale-if-error is valid */
 };
 
 /**
@@ -240,6 +244,10 @@ nserror http_parse_cache_control(const char *header_value, http_cache_control **
     bool max_age_valid = false;
     bool no_cache = false;
     bool no_store = false;
+    uint32_t stale_while_revalidate = 0;
+    bool stale_while_revalidate_valid = false;
+    uint32_t stale_if_error = 0;
+    bool stale_if_error_valid = false;
     nserror error;
 
     /* 1#cache-directive */
@@ -297,6 +305,22 @@ nserror http_parse_cache_control(const char *header_value, http_cache_control **
         }
     }
 
+    /* Find stale-while-revalidate */
+    error = http_directive_list_find_item(directives, corestring_lwc_stale_while_revalidate, &value_str);
+    if (error == NSERROR_OK && value_str != NULL) {
+        error = parse_max_age(value_str, &stale_while_revalidate);
+        stale_while_revalidate_valid = (error == NSERROR_OK);
+        lwc_string_unref(value_str);
+    }
+
+    /* Find stale-if-error */
+    error = http_directive_list_find_item(directives, corestring_lwc_stale_if_error, &value_str);
+    if (error == NSERROR_OK && value_str != NULL) {
+        error = parse_max_age(value_str, &stale_if_error);
+        stale_if_error_valid = (error == NSERROR_OK);
+        lwc_string_unref(value_str);
+    }
+
     http_directive_list_destroy(directives);
 
     cc = malloc(sizeof(*cc));
@@ -308,6 +332,10 @@ nserror http_parse_cache_control(const char *header_value, http_cache_control **
     cc->max_age_valid = max_age_valid;
     cc->no_cache = no_cache;
     cc->no_store = no_store;
+    cc->stale_while_revalidate = stale_while_revalidate;
+    cc->stale_while_revalidate_valid = stale_while_revalidate_valid;
+    cc->stale_if_error = stale_if_error;
+    cc->stale_if_error_valid = stale_if_error_valid;
 
     *result = cc;
 
@@ -343,3 +371,27 @@ bool http_cache_control_no_store(http_cache_control *cc)
 {
     return cc->no_store;
 }
+
+/* See cache-control.h for documentation */
+bool http_cache_control_has_stale_while_revalidate(http_cache_control *cc)
+{
+    return cc->stale_while_revalidate_valid;
+}
+
+/* See cache-control.h for documentation */
+uint32_t http_cache_control_stale_while_revalidate(http_cache_control *cc)
+{
+    return cc->stale_while_revalidate;
+}
+
+/* See cache-control.h for documentation */
+bool http_cache_control_has_stale_if_error(http_cache_control *cc)
+{
+    return cc->stale_if_error_valid;
+}
+
+/* See cache-control.h for documentation */
+uint32_t http_cache_control_stale_if_error(http_cache_control *cc)
+{
+    return cc->stale_if_error;
+}
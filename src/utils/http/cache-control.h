@@ -73,4 +73,38 @@ bool http_cache_control_no_cache(http_cache_control *cc);
  */
 bool http_cache_control_no_store(http_cache_control *cc);
 
+/**
+ * Determine if a valid stale-while-revalidate directive is present
+ *
+ * \param cc Object to inspect
+ * \return Whether stale-while-revalidate is valid
+ */
+bool http_cache_control_has_stale_while_revalidate(http_cache_control *cc);
+
+/**
+ * Get the value of a cache control's stale-while-revalidate
+ *
+ * \param cc Object to inspect
+ * \return Time a stale response may be used while it is revalidated in
+ *         the background, in delta-seconds
+ */
+uint32_t http_cache_control_stale_while_revalidate(http_cache_control *cc);
+
+/**
+ * Determine if a valid stale-if-error directive is present
+ *
+ * \param cc Object to inspect
+ * \return Whether stale-if-error is valid
+ */
+bool http_cache_control_has_stale_if_error(http_cache_control *cc);
+
+/**
+ * Get the value of a cache control's stale-if-error
+ *
+ * \param cc Object to inspect
+ * \return Time a stale response may be used when revalidation fails, in
+ *         delta-seconds
+ */
+uint32_t http_cache_control_stale_if_error(http_cache_control *cc);
+
 #endif
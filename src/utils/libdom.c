@@ -180,6 +180,25 @@ nserror libdom_hubbub_error_to_nserror(dom_hubbub_error error)
 }
 
 
+/* exported interface documented in libdom.h */
+dom_hubbub_error libdom_hubbub_parse_runs(dom_hubbub_parser *parser, libdom_source_run_cb next_run, void *ctx)
+{
+    dom_hubbub_error error = DOM_HUBBUB_OK;
+    const uint8_t *data;
+    size_t offset = 0;
+    size_t len;
+
+    while ((data = next_run(ctx, offset, &len)) != NULL) {
+        error = dom_hubbub_parser_parse_chunk(parser, data, len);
+        if (error != DOM_HUBBUB_OK && error != (DOM_HUBBUB_HUBBUB_ERR | HUBBUB_PAUSED)) {
+            break;
+        }
+        offset += len;
+    }
+
+    return error;
+}
+
 static void ignore_dom_msg(uint32_t severity, void *ctx, const char *msg, ...)
 {
 }
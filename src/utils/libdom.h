@@ -55,6 +55,32 @@ nserror libdom_parse_file(const char *filename, const char *encoding, dom_docume
  */
 nserror libdom_hubbub_error_to_nserror(dom_hubbub_error error);
 
+/**
+ * Callback returning a contiguous run of source data.
+ *
+ * \param ctx The context passed to libdom_hubbub_parse_runs()
+ * \param offset Offset of the first byte wanted
+ * \param len Pointer to location to receive byte length of run
+ * \return Pointer to the data at \a offset, or NULL if there is none.
+ */
+typedef const uint8_t *(*libdom_source_run_cb)(void *ctx, size_t offset, size_t *len);
+
+/**
+ * Feed source data to a hubbub parser one run at a time.
+ *
+ * A parser paused by a blocking script still takes the runs after the
+ * pause and parses them once it is resumed, so a pause does not stop the
+ * feed.
+ *
+ * \param parser The parser to feed
+ * \param next_run Callback returning the run at an offset
+ * \param ctx Context passed to \a next_run
+ * \return DOM_HUBBUB_OK if everything was parsed, DOM_HUBBUB_HUBBUB_ERR |
+ *         HUBBUB_PAUSED if the parser was left paused, or the error which
+ *         stopped the feed.
+ */
+dom_hubbub_error libdom_hubbub_parse_runs(dom_hubbub_parser *parser, libdom_source_run_cb next_run, void *ctx);
+
 /**
  * Walk though a DOM (sub)tree, in depth first order, printing DOM structure.
  *
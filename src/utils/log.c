@@ -18,23 +18,40 @@
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #ifdef _WIN32
 #include <direct.h>
 #include <process.h>
 #include <windows.h>
+#else
+#include <pthread.h>
 #endif
 
 #include <wisp/desktop/version.h>
 #include <wisp/utils/config.h>
 #include <wisp/utils/nsoption.h>
+#include "utils/log_ring.h"
 #include "utils/utsname.h"
 #include "wisp/utils/sys_time.h"
 
 #include <wisp/utils/log.h>
 
+/** Number of messages the logging thread may fall behind by */
+#define LOG_QUEUE_SIZE 4096
+
+/**
+ * Messages at or above this level wait for space in a full queue, those
+ * below it are dropped.
+ */
+#define LOG_QUEUE_WAIT_LEVEL NSLOG_LEVEL_WARNING
+
+/** Longest message text formatted on the stack when logging synchronously */
+#define LOG_SYNC_TEXT 512
+
 /** flag to enable verbose logging */
 bool verbose_log = false;
 
@@ -45,225 +62,391 @@ static FILE *logfile;
 static FILE *split_log_files[7] = {NULL};
 static bool split_logging = false;
 
-#ifdef _WIN32
+/** When the first message was logged */
+static struct timeval log_start_tv;
+
+/** Whether -sync-logs asked for messages to be written by the caller */
+static bool sync_logging = false;
+
+/** Whether messages are being handed to the logging thread */
 static bool async_logging = false;
-struct log_entry {
-    char *text;
-    int level;
-    struct log_entry *next;
-};
-static struct log_entry *log_head = NULL;
-static struct log_entry *log_tail = NULL;
-static size_t log_queue_len = 0;
-static const size_t log_queue_max = 4096;
+
+/** Whether the logging thread should keep waiting for messages */
+static bool log_thread_running = false;
+
+/** Set while the logging thread may be waiting to be woken */
+static int log_thread_idle = 0;
+
+/** Messages waiting for the logging thread */
+static struct log_ring *log_queue;
+
+/** Number of dropped messages the log has already reported */
+static uint64_t log_dropped_reported;
+
+/** Number of messages dropped by queues since destroyed */
+static uint64_t log_dropped_total;
+
+#ifdef _WIN32
 static HANDLE log_event = NULL;
 static uintptr_t log_thread_handle = 0;
-static CRITICAL_SECTION log_queue_cs;
+#else
+static pthread_t log_thread;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+#endif
 
-static void log_enqueue(char *text, int level)
+/** Subtract the `struct timeval' values X and Y
+ *
+ * \param result The timeval structure to store the result in
+ * \param x The first value
+ * \param y The second value
+ * \return 1 if the difference is negative, otherwise 0.
+ */
+static int timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y)
+{
+    /* Perform the carry for the later subtraction by updating y. */
+    if (x->tv_usec < y->tv_usec) {
+        int nsec = (int)(y->tv_usec - x->tv_usec) / 1000000 + 1;
+        y->tv_usec -= 1000000 * nsec;
+        y->tv_sec += nsec;
+    }
+    if ((int)(x->tv_usec - y->tv_usec) > 1000000) {
+        int nsec = (int)(x->tv_usec - y->tv_usec) / 1000000;
+        y->tv_usec += 1000000 * nsec;
+        y->tv_sec -= nsec;
+    }
+
+    /* Compute the time remaining to wait.
+       tv_usec is certainly positive. */
+    result->tv_sec = x->tv_sec - y->tv_sec;
+    result->tv_usec = x->tv_usec - y->tv_usec;
+
+    /* Return 1 if result is negative. */
+    return x->tv_sec < y->tv_sec;
+}
+
+/**
+ * Get the time a message is logged at.
+ *
+ * \param tv Updated with the time.
+ */
+static void log_get_time(struct timeval *tv)
+{
+    gettimeofday(tv, NULL);
+    if (!timerisset(&log_start_tv)) {
+        log_start_tv = *tv;
+    }
+}
+
+/**
+ * Format the time of a message suitably for prepending to it.
+ *
+ * \param when The time the message was logged.
+ * \param buf The buffer to format into.
+ * \param len The size of the buffer.
+ */
+static void log_format_time(const struct timeval *when, char *buf, size_t len)
+{
+    struct timeval start_tv = log_start_tv;
+    struct timeval now_tv = *when;
+    struct timeval tv;
+
+    timeval_subtract(&tv, &now_tv, &start_tv);
+
+    snprintf(buf, len, "(%ld.%06ld)", (long)tv.tv_sec, (long)tv.tv_usec);
+}
+
+/**
+ * Write a message as a line of a log.
+ */
+static void log_write_line(FILE *fh, const char *time_str, const struct log_record *record)
 {
-    if (!async_logging) {
-        if (text == NULL)
-            return;
 #ifdef WITH_NSLOG
-        if (logfile)
-            fprintf(logfile, "%s", text);
+    fprintf(fh, "%s [%s %.*s] %.*s:%i %.*s: %s\n", time_str, nslog_short_level_name((nslog_level)record->level),
+        record->category_len, record->category, record->file_len, record->file, record->line, record->func_len,
+        record->func, record->text);
 #else
-        if (verbose_log && logfile)
-            fprintf(logfile, "%s", text);
+    fprintf(fh, "%s %.*s:%i %.*s: %s\n", time_str, record->file_len, record->file, record->line, record->func_len,
+        record->func, record->text);
 #endif
-        if (split_logging) {
-            int i;
-            for (i = 0; i < 7; i++) {
-                if (split_log_files[i] && level >= i) {
-                    fprintf(split_log_files[i], "%s", text);
-                    fflush(split_log_files[i]);
-                }
+}
+
+/**
+ * Write a message to every log it belongs in.
+ *
+ * \param record The message.
+ * \param pw Unused.
+ */
+static void log_write_record(const struct log_record *record, void *pw)
+{
+    char time_str[32];
+    int i;
+
+    (void)pw;
+
+    log_format_time(&record->time, time_str, sizeof(time_str));
+
+#ifdef WITH_NSLOG
+    if (logfile != NULL) {
+#else
+    if (verbose_log && logfile != NULL) {
+#endif
+        log_write_line(logfile, time_str, record);
+    }
+
+    if (split_logging) {
+        for (i = 0; i < 7; i++) {
+            if (split_log_files[i] != NULL && record->level >= i) {
+                log_write_line(split_log_files[i], time_str, record);
             }
         }
-        free(text);
-        return;
     }
-    EnterCriticalSection(&log_queue_cs);
-    if (log_queue_len >= log_queue_max) {
-        LeaveCriticalSection(&log_queue_cs);
-        free(text);
-        return;
+}
+
+/**
+ * Flush everything written to the logs.
+ */
+static void log_flush(void)
+{
+    int i;
+
+    if (logfile != NULL) {
+        fflush(logfile);
     }
-    struct log_entry *node = (struct log_entry *)malloc(sizeof(struct log_entry));
-    if (node == NULL) {
-        LeaveCriticalSection(&log_queue_cs);
-        free(text);
+
+    if (split_logging) {
+        for (i = 0; i < 7; i++) {
+            if (split_log_files[i] != NULL) {
+                fflush(split_log_files[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Note in the logs how many messages were dropped since last noted.
+ */
+static void log_report_dropped(void)
+{
+    struct log_record record = {
+        .level = NSLOG_LEVEL_WARNING,
+        .category = "wisp",
+        .category_len = 4,
+        .file = __FILE__,
+        .file_len = -1,
+        .func = __func__,
+        .func_len = -1,
+        .line = __LINE__,
+    };
+    char text[64];
+    uint64_t dropped = log_ring_dropped(log_queue);
+
+    if (dropped == log_dropped_reported) {
         return;
     }
-    node->text = text;
-    node->level = level;
-    node->next = NULL;
-    if (log_tail) {
-        log_tail->next = node;
-        log_tail = node;
-    } else {
-        log_head = log_tail = node;
+
+    gettimeofday(&record.time, NULL);
+    snprintf(text, sizeof(text), "%" PRIu64 " log messages dropped, logging fell behind",
+        dropped - log_dropped_reported);
+    record.text = text;
+    log_write_record(&record, NULL);
+
+    log_dropped_reported = dropped;
+}
+
+/**
+ * Write out every message queued for the logging thread.
+ */
+static void log_thread_drain(void)
+{
+    if (log_ring_drain(log_queue, log_write_record, NULL) > 0) {
+        log_report_dropped();
+        log_flush();
     }
-    log_queue_len++;
-    LeaveCriticalSection(&log_queue_cs);
-    if (log_event)
-        SetEvent(log_event);
 }
 
-static void log_drain_all(void)
+/**
+ * Wake the logging thread.
+ *
+ * \param force Wake the thread even if it is not waiting for messages.
+ */
+static void log_thread_wake(bool force)
 {
-    for (;;) {
-        struct log_entry *node = NULL;
-        EnterCriticalSection(&log_queue_cs);
-        if (log_head) {
-            node = log_head;
-            log_head = log_head->next;
-            if (log_head == NULL)
-                log_tail = NULL;
-            log_queue_len--;
-        }
-        LeaveCriticalSection(&log_queue_cs);
-        if (node == NULL)
-            break;
-#ifdef WITH_NSLOG
-        if (logfile)
-            fprintf(logfile, "%s", node->text);
+    /* order the queued message before the check of the thread's state */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!force && __atomic_load_n(&log_thread_idle, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+
+#ifdef _WIN32
+    SetEvent(log_event);
 #else
-        if (verbose_log && logfile)
-            fprintf(logfile, "%s", node->text);
+    pthread_mutex_lock(&log_mutex);
+    pthread_cond_signal(&log_cond);
+    pthread_mutex_unlock(&log_mutex);
 #endif
-        if (split_logging) {
-            int i;
-            for (i = 0; i < 6; i++) {
-                if (split_log_files[i] && node->level >= i) {
-                    fprintf(split_log_files[i], "%s", node->text);
-                    fflush(split_log_files[i]);
-                }
-            }
-        }
-        free(node->text);
-        free(node);
+}
+
+/**
+ * Wait on the logging thread until a message is queued or it is stopped.
+ */
+static void log_thread_wait(void)
+{
+#ifdef _WIN32
+    __atomic_store_n(&log_thread_idle, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (log_ring_empty(log_queue) && __atomic_load_n(&log_thread_running, __ATOMIC_ACQUIRE)) {
+        WaitForSingleObject(log_event, INFINITE);
     }
+    __atomic_store_n(&log_thread_idle, 0, __ATOMIC_RELAXED);
+#else
+    pthread_mutex_lock(&log_mutex);
+    __atomic_store_n(&log_thread_idle, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (log_ring_empty(log_queue) && __atomic_load_n(&log_thread_running, __ATOMIC_ACQUIRE)) {
+        pthread_cond_wait(&log_cond, &log_mutex);
+    }
+    __atomic_store_n(&log_thread_idle, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&log_mutex);
+#endif
 }
 
+#ifdef _WIN32
 static unsigned __stdcall log_thread_proc(void *arg)
+#else
+static void *log_thread_proc(void *arg)
+#endif
 {
     (void)arg;
-    while (async_logging) {
-        if (log_event)
-            WaitForSingleObject(log_event, INFINITE);
-        log_drain_all();
+    while (__atomic_load_n(&log_thread_running, __ATOMIC_ACQUIRE)) {
+        log_thread_drain();
+        log_thread_wait();
     }
-    log_drain_all();
+    log_thread_drain();
     return 0;
 }
 
-static void async_log_start(void)
-{
-    if (async_logging)
-        return;
-    InitializeCriticalSection(&log_queue_cs);
-    log_event = CreateEvent(NULL, FALSE, FALSE, NULL);
-    async_logging = true;
-    log_thread_handle = _beginthreadex(NULL, 0, log_thread_proc, NULL, 0, NULL);
-}
-
+/**
+ * Stop the logging thread once it has written every queued message.
+ *
+ * No other thread may log while the logging thread is stopped.
+ */
 static void async_log_stop(void)
 {
-    if (!async_logging)
+    if (!async_logging) {
         return;
+    }
     async_logging = false;
-    if (log_event)
-        SetEvent(log_event);
-    if (log_thread_handle) {
-        WaitForSingleObject((HANDLE)log_thread_handle, INFINITE);
-        CloseHandle((HANDLE)log_thread_handle);
-        log_thread_handle = 0;
-    }
-    if (log_event) {
-        CloseHandle(log_event);
-        log_event = NULL;
-    }
-    log_drain_all();
-    DeleteCriticalSection(&log_queue_cs);
-}
 
-static void log_enqueue_formatted(int level, const char *prefix, const char *fmt, va_list args)
-{
-    va_list ap;
-    va_copy(ap, args);
-    int msglen = vsnprintf(NULL, 0, fmt, ap);
-    va_end(ap);
-    if (msglen < 0)
-        return;
-    size_t plen = strlen(prefix);
-    char *buf = (char *)malloc(plen + (size_t)msglen + 2);
-    if (buf == NULL)
-        return;
-    memcpy(buf, prefix, plen);
-    va_copy(ap, args);
-    vsnprintf(buf + plen, (size_t)msglen + 1, fmt, ap);
-    va_end(ap);
-    buf[plen + (size_t)msglen] = '\n';
-    buf[plen + (size_t)msglen + 1] = '\0';
-    log_enqueue(buf, level);
-}
+    __atomic_store_n(&log_thread_running, false, __ATOMIC_RELEASE);
+    log_thread_wake(true);
+
+#ifdef _WIN32
+    WaitForSingleObject((HANDLE)log_thread_handle, INFINITE);
+    CloseHandle((HANDLE)log_thread_handle);
+    log_thread_handle = 0;
+    CloseHandle(log_event);
+    log_event = NULL;
+#else
+    pthread_join(log_thread, NULL);
 #endif
 
-/** Subtract the `struct timeval' values X and Y
+    log_thread_drain();
+    log_dropped_total += log_ring_dropped(log_queue);
+    log_ring_destroy(log_queue);
+    log_queue = NULL;
+}
+
+/**
+ * Start handing messages to a logging thread, unless -sync-logs was given.
  *
- * \param result The timeval structure to store the result in
- * \param x The first value
- * \param y The second value
- * \return 1 if the difference is negative, otherwise 0.
+ * Messages are written by the thread, off the caller's critical path.
+ * Should it fall behind, messages below LOG_QUEUE_WAIT_LEVEL are dropped
+ * and counted while those above wait for space.
  */
-static int timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y)
+static void async_log_start(void)
 {
-    /* Perform the carry for the later subtraction by updating y. */
-    if (x->tv_usec < y->tv_usec) {
-        int nsec = (int)(y->tv_usec - x->tv_usec) / 1000000 + 1;
-        y->tv_usec -= 1000000 * nsec;
-        y->tv_sec += nsec;
+    static bool stop_at_exit = false;
+
+    if (async_logging || sync_logging) {
+        return;
     }
-    if ((int)(x->tv_usec - y->tv_usec) > 1000000) {
-        int nsec = (int)(x->tv_usec - y->tv_usec) / 1000000;
-        y->tv_usec += 1000000 * nsec;
-        y->tv_sec -= nsec;
+
+    if (log_ring_create(LOG_QUEUE_SIZE, &log_queue) != NSERROR_OK) {
+        return;
     }
+    log_dropped_reported = 0;
+    log_thread_running = true;
 
-    /* Compute the time remaining to wait.
-       tv_usec is certainly positive. */
-    result->tv_sec = x->tv_sec - y->tv_sec;
-    result->tv_usec = x->tv_usec - y->tv_usec;
+#ifdef _WIN32
+    log_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (log_event != NULL) {
+        log_thread_handle = _beginthreadex(NULL, 0, log_thread_proc, NULL, 0, NULL);
+    }
+    if (log_thread_handle == 0) {
+        if (log_event != NULL) {
+            CloseHandle(log_event);
+            log_event = NULL;
+        }
+#else
+    if (pthread_create(&log_thread, NULL, log_thread_proc, NULL) != 0) {
+#endif
+        log_thread_running = false;
+        log_ring_destroy(log_queue);
+        log_queue = NULL;
+        return;
+    }
 
-    /* Return 1 if result is negative. */
-    return x->tv_sec < y->tv_sec;
+    async_logging = true;
+
+    /* write out what is queued even if the frontend never finalises */
+    if (!stop_at_exit) {
+        atexit(async_log_stop);
+        stop_at_exit = true;
+    }
 }
 
 /**
- * Obtain a formatted string suitable for prepending to a log message
+ * Log a message, through the logging thread if it is running.
  *
- * \return formatted string of the time since first log call
+ * \param record The message, whose text is formatted from fmt.
+ * \param fmt printf format of the message text.
+ * \param args Arguments for the format.
  */
-static const char *nslog_gettime(void)
+static void log_message(struct log_record *record, const char *fmt, va_list args)
 {
-    static struct timeval start_tv;
-    static char buff[32];
-
-    struct timeval tv;
-    struct timeval now_tv;
+    char text[LOG_SYNC_TEXT];
+    char *heap_text = NULL;
+    va_list ap;
+    int len;
 
-    if (!timerisset(&start_tv)) {
-        gettimeofday(&start_tv, NULL);
+    if (async_logging) {
+        if (log_ring_push(log_queue, record, record->level >= LOG_QUEUE_WAIT_LEVEL, fmt, args)) {
+            log_thread_wake(false);
+        }
+        return;
     }
-    gettimeofday(&now_tv, NULL);
 
-    timeval_subtract(&tv, &now_tv, &start_tv);
+    va_copy(ap, args);
+    len = vsnprintf(text, sizeof(text), fmt, ap);
+    va_end(ap);
 
-    snprintf(buff, sizeof(buff), "(%ld.%06ld)", (long)tv.tv_sec, (long)tv.tv_usec);
+    if (len < 0) {
+        text[0] = '\0';
+    } else if ((size_t)len >= sizeof(text)) {
+        heap_text = malloc((size_t)len + 1);
+        if (heap_text != NULL) {
+            va_copy(ap, args);
+            vsnprintf(heap_text, (size_t)len + 1, fmt, ap);
+            va_end(ap);
+        }
+    }
+
+    record->text = (heap_text != NULL) ? heap_text : text;
+    log_write_record(record, NULL);
+    log_flush();
 
-    return buff;
+    free(heap_text);
 }
 
 #ifdef WITH_NSLOG
@@ -281,45 +464,19 @@ NSLOG_DEFINE_CATEGORY(jserrors, "JavaScript error messages");
 
 static void wisp_render_log(void *_ctx, nslog_entry_context_t *ctx, const char *fmt, va_list args)
 {
-#ifdef _WIN32
-    if (async_logging) {
-        char prefix_buf[256];
-        int pre_len = snprintf(prefix_buf, sizeof(prefix_buf), "%s [%s %.*s] %.*s:%i %.*s: ", nslog_gettime(),
-            nslog_short_level_name(ctx->level), ctx->category->namelen, ctx->category->name, ctx->filenamelen,
-            ctx->filename, ctx->lineno, ctx->funcnamelen, ctx->funcname);
-        if (pre_len < 0)
-            return;
-        log_enqueue_formatted((int)ctx->level, prefix_buf, fmt, args);
-        return;
-    }
-#endif
-    if (split_logging) {
-        int i;
-        for (i = 0; i < 7; i++) {
-            if (split_log_files[i] && (int)ctx->level >= i) {
-                va_list ap;
-                va_copy(ap, args);
-                fprintf(split_log_files[i], "%s [%s %.*s] %.*s:%i %.*s: ", nslog_gettime(),
-                    nslog_short_level_name(ctx->level), ctx->category->namelen, ctx->category->name, ctx->filenamelen,
-                    ctx->filename, ctx->lineno, ctx->funcnamelen, ctx->funcname);
-
-                vfprintf(split_log_files[i], fmt, ap);
-                va_end(ap);
-
-                fputc('\n', split_log_files[i]);
-                fflush(split_log_files[i]);
-            }
-        }
-    }
-
-    fprintf(logfile, "%s [%s %.*s] %.*s:%i %.*s: ", nslog_gettime(), nslog_short_level_name(ctx->level),
-        ctx->category->namelen, ctx->category->name, ctx->filenamelen, ctx->filename, ctx->lineno, ctx->funcnamelen,
-        ctx->funcname);
-
-    vfprintf(logfile, fmt, args);
-
-    /* Log entries aren't newline terminated add one for clarity */
-    fputc('\n', logfile);
+    struct log_record record = {
+        .level = (int)ctx->level,
+        .category = ctx->category->name,
+        .category_len = ctx->category->namelen,
+        .file = ctx->filename,
+        .file_len = ctx->filenamelen,
+        .func = ctx->funcname,
+        .func_len = ctx->funcnamelen,
+        .line = ctx->lineno,
+    };
+
+    log_get_time(&record.time);
+    log_message(&record, fmt, args);
 }
 
 /* exported interface documented in utils/log.h */
@@ -349,49 +506,25 @@ nserror nslog_set_filter(const char *filter)
 
 void nslog_log(enum nslog_level level, const char *file, const char *func, int ln, const char *format, ...)
 {
+    struct log_record record = {
+        .level = (int)level,
+        .file = file,
+        .file_len = -1,
+        .func = func,
+        .func_len = -1,
+        .line = ln,
+    };
     va_list ap;
-    int i;
-#ifdef _WIN32
-    if (async_logging) {
-        char prefix_buf[256];
-        int pre_len = snprintf(prefix_buf, sizeof(prefix_buf), "%s %s:%i %s: ", nslog_gettime(), file, ln, func);
-        va_start(ap, format);
-        log_enqueue_formatted((int)level, prefix_buf, format, ap);
-        va_end(ap);
-        return;
-    }
-#endif
-
-    if (verbose_log) {
-        fprintf(logfile, "%s %s:%i %s: ", nslog_gettime(), file, ln, func);
-
-        va_start(ap, format);
 
-        vfprintf(logfile, format, ap);
-
-        va_end(ap);
-
-        fputc('\n', logfile);
+    if (!verbose_log && !split_logging) {
+        return;
     }
 
-    if (split_logging) {
-        const char *time_str = nslog_gettime();
-        /* Iterate over split files. */
-        for (i = 0; i < 7; i++) {
-            /* Check if file is open and level is sufficient for
-             * this file */
-            if (split_log_files[i] && (int)level >= i) {
-                fprintf(split_log_files[i], "%s %s:%i %s: ", time_str, file, ln, func);
+    log_get_time(&record.time);
 
-                va_start(ap, format);
-                vfprintf(split_log_files[i], format, ap);
-                va_end(ap);
-
-                fputc('\n', split_log_files[i]);
-                fflush(split_log_files[i]);
-            }
-        }
-    }
+    va_start(ap, format);
+    log_message(&record, format, ap);
+    va_end(ap);
 }
 
 /* exported interface documented in utils/log.h */
@@ -408,20 +541,24 @@ nserror nslog_init(nslog_ensure_t *ensure, int *pargc, char **argv)
 {
     struct utsname utsname;
     nserror ret = NSERROR_OK;
-    int i;
+    int i, j;
 
-    /* Parse -split-logs */
+    /* Parse -split-logs and -sync-logs */
     for (i = 1; i < *pargc; i++) {
         if (strcmp(argv[i], "-split-logs") == 0) {
             split_logging = true;
-            /* Remove argument */
-            int j;
-            for (j = i + 1; j < *pargc; j++) {
-                argv[j - 1] = argv[j];
-            }
-            (*pargc)--;
-            i--;
+        } else if (strcmp(argv[i], "-sync-logs") == 0) {
+            sync_logging = true;
+        } else {
+            continue;
         }
+
+        /* Remove argument */
+        for (j = i + 1; j < *pargc; j++) {
+            argv[j - 1] = argv[j];
+        }
+        (*pargc)--;
+        i--;
     }
 
     if (((*pargc) > 1) && (argv[1][0] == '-') && (argv[1][1] == 'v') && (argv[1][2] == 0)) {
@@ -486,21 +623,6 @@ nserror nslog_init(nslog_ensure_t *ensure, int *pargc, char **argv)
 
 #endif
 
-    /* sucessfull logging initialisation so log system info */
-    if (ret == NSERROR_OK) {
-#ifdef _WIN32
-        if (verbose_log || split_logging)
-            async_log_start();
-#endif
-        NSLOG(wisp, INFO, "Wisp version '%d.%d'", wisp_version_major, wisp_version_minor);
-        if (uname(&utsname) < 0) {
-            NSLOG(wisp, INFO, "Failed to extract machine information");
-        } else {
-            NSLOG(wisp, INFO, "Wisp on <%s>, node <%s>, release <%s>, version <%s>, machine <%s>",
-                utsname.sysname, utsname.nodename, utsname.release, utsname.version, utsname.machine);
-        }
-    }
-
     if (split_logging && ret == NSERROR_OK) {
         /* Create directory */
 #ifdef _WIN32
@@ -517,6 +639,19 @@ nserror nslog_init(nslog_ensure_t *ensure, int *pargc, char **argv)
         split_log_files[6] = fopen("wisp-logs/ns-critical.txt", "w");
     }
 
+    /* sucessfull logging initialisation so log system info */
+    if (ret == NSERROR_OK) {
+        if (verbose_log || split_logging)
+            async_log_start();
+        NSLOG(wisp, INFO, "Wisp version '%d.%d'", wisp_version_major, wisp_version_minor);
+        if (uname(&utsname) < 0) {
+            NSLOG(wisp, INFO, "Failed to extract machine information");
+        } else {
+            NSLOG(wisp, INFO, "Wisp on <%s>, node <%s>, release <%s>, version <%s>, machine <%s>",
+                utsname.sysname, utsname.nodename, utsname.release, utsname.version, utsname.machine);
+        }
+    }
+
     return ret;
 }
 
@@ -529,13 +664,22 @@ nserror nslog_set_filter_by_options(void)
         return nslog_set_filter(nsoption_charp(log_filter));
 }
 
+/* exported interface documented in utils/log.h */
+uint64_t nslog_dropped(void)
+{
+    uint64_t dropped = log_dropped_total;
+
+    if (async_logging) {
+        dropped += log_ring_dropped(log_queue);
+    }
+    return dropped;
+}
+
 /* exported interface documented in utils/log.h */
 void nslog_finalise(void)
 {
     NSLOG(wisp, INFO, "Finalising logging, please report any further messages");
-#ifdef _WIN32
     async_log_stop();
-#endif
     verbose_log = true;
     if (logfile != stderr) {
         fclose(logfile);
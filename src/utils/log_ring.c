@@ -0,0 +1,231 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Bounded queue of log messages (implementation).
+ *
+ * Each slot carries a sequence number saying whose turn it is: a slot
+ * whose sequence equals the producers' position is free to claim, and
+ * once filled its sequence is advanced by one to publish it to the
+ * consumer, which advances it by the queue size again to free it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "utils/log_ring.h"
+
+/** Longest message text, with its terminator, held within a slot */
+#define LOG_RING_INLINE_TEXT 232
+
+/** Size of a cache line, to keep producers and consumer apart */
+#define LOG_RING_CACHE_LINE 64
+
+/**
+ * A queued message
+ */
+struct log_ring_slot {
+    uint64_t seq; /**< Position the slot is next claimed or published at */
+    struct log_record record;
+    char *heap_text; /**< Text too long for the slot or NULL */
+    char text[LOG_RING_INLINE_TEXT];
+};
+
+/**
+ * Log message queue
+ */
+struct log_ring {
+    uint64_t tail; /**< Position the next message is pushed at */
+    char pad0[LOG_RING_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t head; /**< Position the next message is drained from */
+    char pad1[LOG_RING_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t dropped; /**< Messages dropped because the queue was full */
+    unsigned int mask; /**< Size of the queue less one */
+    struct log_ring_slot slots[];
+};
+
+
+/**
+ * Give up the processor while waiting for space.
+ */
+static void log_ring_yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+
+/* exported interface documented in utils/log_ring.h */
+nserror log_ring_create(unsigned int size, struct log_ring **ring_out)
+{
+    struct log_ring *ring;
+    unsigned int i;
+
+    if (size == 0 || (size & (size - 1)) != 0) {
+        return NSERROR_BAD_PARAMETER;
+    }
+
+    ring = calloc(1, sizeof(*ring) + size * sizeof(struct log_ring_slot));
+    if (ring == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    ring->mask = size - 1;
+    for (i = 0; i < size; i++) {
+        ring->slots[i].seq = i;
+    }
+
+    *ring_out = ring;
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in utils/log_ring.h */
+void log_ring_destroy(struct log_ring *ring)
+{
+    unsigned int i;
+
+    for (i = 0; i <= ring->mask; i++) {
+        free(ring->slots[i].heap_text);
+    }
+    free(ring);
+}
+
+
+/**
+ * Format a message's text into a claimed slot.
+ *
+ * Text too long for the slot is allocated separately, or truncated if
+ * that is not possible.
+ */
+static void log_ring_format(struct log_ring_slot *slot, const char *fmt, va_list args)
+{
+    va_list ap;
+    int len;
+
+    slot->heap_text = NULL;
+
+    va_copy(ap, args);
+    len = vsnprintf(slot->text, sizeof(slot->text), fmt, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        slot->text[0] = '\0';
+    } else if ((size_t)len >= sizeof(slot->text)) {
+        slot->heap_text = malloc((size_t)len + 1);
+        if (slot->heap_text != NULL) {
+            va_copy(ap, args);
+            vsnprintf(slot->heap_text, (size_t)len + 1, fmt, ap);
+            va_end(ap);
+        }
+    }
+}
+
+
+/* exported interface documented in utils/log_ring.h */
+bool log_ring_push(struct log_ring *ring, const struct log_record *record, bool wait, const char *fmt, va_list args)
+{
+    struct log_ring_slot *slot;
+    uint64_t pos;
+    uint64_t seq;
+
+    pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pos) {
+            /* slot is free, try to claim it */
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            /* pos was updated with the current tail */
+        } else if ((int64_t)(seq - pos) < 0) {
+            /* slot still holds a message from the previous lap */
+            if (!wait) {
+                __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+                return false;
+            }
+            log_ring_yield();
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        } else {
+            /* another producer claimed the slot first */
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->record = *record;
+    log_ring_format(slot, fmt, args);
+
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+
+/* exported interface documented in utils/log_ring.h */
+unsigned int log_ring_drain(struct log_ring *ring, log_ring_callback cb, void *pw)
+{
+    struct log_ring_slot *slot;
+    unsigned int count = 0;
+
+    for (;;) {
+        slot = &ring->slots[ring->head & ring->mask];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring->head + 1) {
+            break;
+        }
+
+        slot->record.text = (slot->heap_text != NULL) ? slot->heap_text : slot->text;
+        cb(&slot->record, pw);
+
+        free(slot->heap_text);
+        slot->heap_text = NULL;
+
+        __atomic_store_n(&slot->seq, ring->head + ring->mask + 1, __ATOMIC_RELEASE);
+        ring->head++;
+        count++;
+    }
+
+    return count;
+}
+
+
+/* exported interface documented in utils/log_ring.h */
+bool log_ring_empty(struct log_ring *ring)
+{
+    struct log_ring_slot *slot = &ring->slots[ring->head & ring->mask];
+
+    return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring->head + 1;
+}
+
+
+/* exported interface documented in utils/log_ring.h */
+uint64_t log_ring_dropped(struct log_ring *ring)
+{
+    return __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Bounded queue of log messages (interface).
+ *
+ * Any number of threads may push messages while a single thread drains
+ * them.  Pushing takes no locks: a producer claims a slot with an atomic
+ * compare and exchange, formats the message into it and publishes it.
+ * Only the message text is formatted by the producer; the record's other
+ * fields are kept as given so the consumer can format them later.
+ */
+
+#ifndef _WISP_UTILS_LOG_RING_H_
+#define _WISP_UTILS_LOG_RING_H_
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <wisp/utils/errors.h>
+#include "wisp/utils/sys_time.h"
+
+struct log_ring;
+
+/**
+ * A log message
+ *
+ * The strings other than the text are stored by reference, so must
+ * outlive the queue.  Their lengths may be -1 where they are nul
+ * terminated.
+ */
+struct log_record {
+    struct timeval time; /**< When the message was logged */
+    int level; /**< Level of the message */
+    const char *category; /**< Category name or NULL */
+    int category_len;
+    const char *file; /**< Source file that logged the message */
+    int file_len;
+    const char *func; /**< Function that logged the message */
+    int func_len;
+    int line; /**< Source line that logged the message */
+    const char *text; /**< The formatted message, set when draining */
+};
+
+/**
+ * Callback given each message as it is drained.
+ *
+ * \param record The message, valid only during the call.
+ * \param pw The context passed to log_ring_drain().
+ */
+typedef void (*log_ring_callback)(const struct log_record *record, void *pw);
+
+/**
+ * Create a log message queue.
+ *
+ * \param size The number of messages the queue holds, a power of two.
+ * \param ring_out Updated with the new queue.
+ * \return NSERROR_OK on success, NSERROR_BAD_PARAMETER if size is not a
+ *         power of two or NSERROR_NOMEM.
+ */
+nserror log_ring_create(unsigned int size, struct log_ring **ring_out);
+
+/**
+ * Destroy a log message queue, discarding any messages it holds.
+ *
+ * \param ring The queue to destroy.
+ */
+void log_ring_destroy(struct log_ring *ring);
+
+/**
+ * Add a message to a queue.
+ *
+ * May be called from any thread.  When the queue is full the message is
+ * either dropped and counted, or the caller waits for the consumer to make
+ * space, which it must therefore be doing.
+ *
+ * \param ring The queue.
+ * \param record The message, whose text is ignored.
+ * \param wait Whether to wait for space rather than drop the message.
+ * \param fmt printf format of the message text.
+ * \param args Arguments for the format.
+ * \return true if the message was queued, false if it was dropped.
+ */
+bool log_ring_push(struct log_ring *ring, const struct log_record *record, bool wait, const char *fmt, va_list args);
+
+/**
+ * Remove every queued message, in the order they were queued.
+ *
+ * Only one thread may drain a queue.
+ *
+ * \param ring The queue.
+ * \param cb Callback given each message.
+ * \param pw Context for the callback.
+ * \return The number of messages drained.
+ */
+unsigned int log_ring_drain(struct log_ring *ring, log_ring_callback cb, void *pw);
+
+/**
+ * Determine whether a queue holds no published messages.
+ *
+ * Only meaningful to the thread draining the queue.
+ *
+ * \param ring The queue.
+ * \return true if there is nothing to drain.
+ */
+bool log_ring_empty(struct log_ring *ring);
+
+/**
+ * Get the number of messages dropped because a queue was full.
+ *
+ * \param ring The queue.
+ * \return The number of messages dropped since the queue was created.
+ */
+uint64_t log_ring_dropped(struct log_ring *ring);
+
+#endif
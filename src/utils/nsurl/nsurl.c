@@ -64,6 +64,141 @@
     }
 
 
+/** Number of buckets in the interning table before it first grows */
+#define NSURL_INTERN_INITIAL 256
+
+/** Initial interning table buckets, so interning never fails */
+static nsurl *nsurl__initial_buckets[NSURL_INTERN_INITIAL];
+
+/**
+ * Table of live URLs, keyed by their full string
+ */
+static struct {
+    nsurl **buckets; /* Chains of URLs, size is a power of two */
+    size_t size; /* Number of buckets */
+    size_t count; /* Number of URLs in the table */
+} nsurl__table = {nsurl__initial_buckets, NSURL_INTERN_INITIAL, 0};
+
+
+/**
+ * Find the interning table bucket of a URL
+ *
+ * \param url  The URL
+ * \return Pointer to the head of the URL's bucket chain
+ */
+static nsurl **nsurl__intern_bucket(const nsurl *url)
+{
+    uint32_t hash = url->hash;
+
+    /* The nsurl hash excludes the fragment, but the string does not */
+    if (url->components.fragment != NULL)
+        hash ^= lwc_string_hash_value(url->components.fragment) * 0x9E3779B1u;
+
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return &nsurl__table.buckets[hash & (nsurl__table.size - 1)];
+}
+
+
+/**
+ * Grow the interning table once it holds as many URLs as buckets
+ *
+ * Failure to grow is not fatal, the chains just get longer.
+ */
+static void nsurl__intern_grow(void)
+{
+    size_t old_size = nsurl__table.size;
+    nsurl **old_buckets = nsurl__table.buckets;
+    nsurl **buckets;
+    size_t i;
+
+    if (nsurl__table.count < old_size)
+        return;
+
+    buckets = calloc(old_size * 2, sizeof(*buckets));
+    if (buckets == NULL)
+        return;
+
+    nsurl__table.buckets = buckets;
+    nsurl__table.size = old_size * 2;
+
+    for (i = 0; i < old_size; i++) {
+        nsurl *url, *next;
+
+        for (url = old_buckets[i]; url != NULL; url = next) {
+            nsurl **bucket = nsurl__intern_bucket(url);
+
+            next = url->intern_next;
+            url->intern_next = *bucket;
+            *bucket = url;
+        }
+    }
+
+    if (old_buckets != nsurl__initial_buckets)
+        free(old_buckets);
+    else
+        memset(old_buckets, 0, sizeof(nsurl__initial_buckets));
+}
+
+
+/* exported interface, documented in nsurl/private.h */
+void nsurl__intern(nsurl **url)
+{
+    nsurl *new_url = *url;
+    nsurl **bucket;
+    nsurl *existing;
+
+    assert(new_url->count == 1);
+
+    for (existing = *nsurl__intern_bucket(new_url); existing != NULL; existing = existing->intern_next) {
+        if (existing->length == new_url->length && memcmp(existing->string, new_url->string, new_url->length) == 0) {
+            /* Already have this URL */
+            nsurl__components_destroy(&new_url->components);
+            free(new_url);
+
+            existing->count++;
+            *url = existing;
+            return;
+        }
+    }
+
+    nsurl__intern_grow();
+
+    bucket = nsurl__intern_bucket(new_url);
+    new_url->intern_next = *bucket;
+    *bucket = new_url;
+    nsurl__table.count++;
+}
+
+
+/**
+ * Remove a URL from the interning table
+ *
+ * \param url  The URL, whose last reference has gone
+ */
+static void nsurl__intern_remove(nsurl *url)
+{
+    nsurl **link;
+
+    for (link = nsurl__intern_bucket(url); *link != NULL; link = &(*link)->intern_next) {
+        if (*link == url) {
+            *link = url->intern_next;
+            nsurl__table.count--;
+            break;
+        }
+    }
+
+    if (nsurl__table.count == 0 && nsurl__table.buckets != nsurl__initial_buckets) {
+        /* No URLs left, release the grown table */
+        free(nsurl__table.buckets);
+        nsurl__table.buckets = nsurl__initial_buckets;
+        nsurl__table.size = NSURL_INTERN_INITIAL;
+    }
+}
+
+
 /******************************************************************************
  * NetSurf URL Public API                                                     *
  ******************************************************************************/
@@ -88,6 +223,8 @@ void nsurl_unref(nsurl *url)
     if (--url->count > 0)
         return;
 
+    nsurl__intern_remove(url);
+
     /* Release lwc strings */
     nsurl__components_destroy(&url->components);
 
@@ -104,6 +241,19 @@ bool nsurl_compare(const nsurl *url1, const nsurl *url2, nsurl_component parts)
     assert(url1 != NULL);
     assert(url2 != NULL);
 
+    if (url1 == url2)
+        return true;
+
+    /* URLs are interned, so distinct URLs have distinct strings. That
+     * settles a comparison of every part, or of every part but the
+     * fragment when there are none. The hash covers all but the
+     * fragment. */
+    if ((parts & NSURL_COMPLETE) == NSURL_COMPLETE) {
+        if ((parts & NSURL_FRAGMENT) != 0 ||
+            (url1->components.fragment == NULL && url2->components.fragment == NULL) || url1->hash != url2->hash)
+            return false;
+    }
+
     /* Compare URL components */
 
     /* Path, host and query first, since they're most likely to differ */
@@ -493,6 +643,9 @@ nserror nsurl_defragment(const nsurl *url, nsurl **no_frag)
     /* Give the URL a reference */
     (*no_frag)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(no_frag);
+
     return NSERROR_OK;
 }
 
@@ -553,6 +706,9 @@ nserror nsurl_refragment(const nsurl *url, lwc_string *frag, nsurl **new_url)
     /* Give the URL a reference */
     (*new_url)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(new_url);
+
     return NSERROR_OK;
 }
 
@@ -640,6 +796,9 @@ nserror nsurl_replace_query(const nsurl *url, const char *query, nsurl **new_url
     /* Give the URL a reference */
     (*new_url)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(new_url);
+
     return NSERROR_OK;
 }
 
@@ -713,6 +872,9 @@ nserror nsurl_replace_scheme(const nsurl *url, lwc_string *scheme, nsurl **new_u
     /* Give the URL a reference */
     (*new_url)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(new_url);
+
     return NSERROR_OK;
 }
 
@@ -900,6 +1062,9 @@ nserror nsurl_parent(const nsurl *url, nsurl **new_url)
     /* Give the URL a reference */
     (*new_url)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(new_url);
+
     return NSERROR_OK;
 }
 
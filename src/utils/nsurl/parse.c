@@ -1487,6 +1487,9 @@ nserror nsurl_create(const char *const url_s, nsurl **url)
     /* Give the URL a reference */
     (*url)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(url);
+
     return NSERROR_OK;
 }
 
@@ -1713,5 +1716,8 @@ nserror nsurl_join(const nsurl *base, const char *rel, nsurl **joined)
     /* Give the URL a reference */
     (*joined)->count = 1;
 
+    /* Share the URL with identical ones */
+    nsurl__intern(joined);
+
     return NSERROR_OK;
 }
@@ -60,6 +60,8 @@ struct nsurl {
     int count; /* Number of references to NetSurf URL object */
     uint32_t hash; /* Hash value for nsurl identification */
 
+    struct nsurl *intern_next; /* Next URL in interning table bucket */
+
     size_t length; /* Length of string */
     char string[FLEX_ARRAY_LEN_DECL]; /* Full URL as a string */
 };
@@ -123,6 +125,19 @@ nserror nsurl__components_to_string(const struct nsurl_components *components, n
 void nsurl__calc_hash(nsurl *url);
 
 
+/**
+ * Intern a newly created URL
+ *
+ * If a URL with the same string already exists, the new URL is destroyed
+ * and replaced with a new reference to the existing one. Otherwise the new
+ * URL is entered in the interning table. Either way, URLs with identical
+ * strings are always the same object.
+ *
+ * \param url  Updated to the interned URL, which must have one reference
+ */
+void nsurl__intern(nsurl **url);
+
+
 /**
  * Destroy components
  *
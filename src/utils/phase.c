@@ -0,0 +1,163 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Page load phase accounting (implementation).
+ */
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "utils/phase.h"
+
+/** Whether accounting is enabled */
+static bool phase_active = false;
+
+/** The phase time is currently charged to */
+static enum phase phase_current = PHASE_NONE;
+
+/** When time was last charged, in microseconds */
+static uint64_t phase_mark;
+
+/** When accounting was reset, in microseconds */
+static uint64_t phase_start;
+
+/** Statistics since accounting was reset */
+static struct phase_stats phase_stats;
+
+/** Phase names, indexed by phase */
+static const char *const phase_names[PHASE__COUNT] = {
+    "none",
+    "fetch",
+    "parse",
+    "style",
+    "box",
+    "layout",
+    "redraw",
+};
+
+
+/**
+ * Read a monotonic clock in microseconds.
+ */
+static uint64_t phase_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+
+/**
+ * Charge the time since the last switch and switch to another phase.
+ */
+static void phase_switch(enum phase phase)
+{
+    uint64_t now = phase_clock();
+
+    phase_stats.time[phase_current] += now - phase_mark;
+    phase_mark = now;
+    phase_current = phase;
+}
+
+
+/* exported interface documented in utils/phase.h */
+enum phase phase_enter(enum phase phase)
+{
+    enum phase previous = phase_current;
+
+    if (!phase_active) {
+        return previous;
+    }
+    if (phase != previous) {
+        phase_switch(phase);
+    }
+    phase_stats.count[phase]++;
+
+    return previous;
+}
+
+
+/* exported interface documented in utils/phase.h */
+void phase_leave(enum phase previous)
+{
+    if (phase_active && previous != phase_current) {
+        phase_switch(previous);
+    }
+}
+
+
+/* exported interface documented in utils/phase.h */
+void phase_reset(void)
+{
+    memset(&phase_stats, 0, sizeof(phase_stats));
+    phase_current = PHASE_NONE;
+    phase_start = phase_mark = phase_clock();
+    phase_active = true;
+}
+
+
+/* exported interface documented in utils/phase.h */
+void phase_disable(void)
+{
+    if (phase_active) {
+        phase_switch(PHASE_NONE);
+        phase_stats.elapsed = phase_mark - phase_start;
+        phase_active = false;
+    }
+}
+
+
+/* exported interface documented in utils/phase.h */
+void phase_get_stats(struct phase_stats *stats)
+{
+    if (phase_active) {
+        phase_switch(phase_current);
+        phase_stats.elapsed = phase_mark - phase_start;
+    }
+    *stats = phase_stats;
+}
+
+
+/* exported interface documented in utils/phase.h */
+const char *phase_name(enum phase phase)
+{
+    if (phase >= PHASE__COUNT) {
+        return "unknown";
+    }
+    return phase_names[phase];
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Page load phase accounting (interface).
+ *
+ * The core marks the stretches of work belonging to each phase of loading
+ * a page.  Phases nest, for example style selection during box
+ * construction, and time is charged to the innermost phase only, so the
+ * phase totals never count the same microsecond twice.
+ *
+ * Accounting is off until phase_reset() is called, and costs a single
+ * test per mark while it is off.  It is only meaningful on the thread
+ * running the core.
+ */
+
+#ifndef _WISP_UTILS_PHASE_H_
+#define _WISP_UTILS_PHASE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Phases of loading a page
+ */
+enum phase {
+    PHASE_NONE, /**< Not in any phase */
+    PHASE_FETCH, /**< Polling fetchers and handling what they deliver */
+    PHASE_PARSE, /**< Parsing documents and stylesheets */
+    PHASE_STYLE, /**< Selecting computed styles */
+    PHASE_BOX, /**< Constructing box trees */
+    PHASE_LAYOUT, /**< Laying out box trees */
+    PHASE_REDRAW, /**< Redrawing documents */
+    PHASE__COUNT
+};
+
+/**
+ * Phase accounting statistics
+ */
+struct phase_stats {
+    uint64_t time[PHASE__COUNT]; /**< Microseconds in each phase, excluding nested phases */
+    uint64_t count[PHASE__COUNT]; /**< Number of times each phase was entered */
+    uint64_t elapsed; /**< Microseconds since phase_reset() */
+};
+
+/**
+ * Enter a phase.
+ *
+ * \param phase The phase being entered
+ * \return The phase to pass to phase_leave() once the work is done
+ */
+enum phase phase_enter(enum phase phase);
+
+/**
+ * Leave a phase, returning to the one it was entered from.
+ *
+ * \param previous The value phase_enter() returned
+ */
+void phase_leave(enum phase previous);
+
+/**
+ * Start phase accounting afresh.
+ *
+ * Clears the statistics and enables accounting.  Must be called outside
+ * any phase.
+ */
+void phase_reset(void);
+
+/**
+ * Stop phase accounting.
+ *
+ * The statistics gathered are kept.
+ */
+void phase_disable(void);
+
+/**
+ * Retrieve phase accounting statistics.
+ *
+ * Time spent in the current phase up to now is included.
+ *
+ * \param[out] stats updated with the statistics since phase_reset()
+ */
+void phase_get_stats(struct phase_stats *stats);
+
+/**
+ * Get the name of a phase.
+ *
+ * \param phase The phase
+ * \return A short lower case name
+ */
+const char *phase_name(enum phase phase);
+
+#endif
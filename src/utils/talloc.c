@@ -73,6 +73,8 @@
 #define TALLOC_MAGIC 0xe814ec70
 #define TALLOC_FLAG_FREE 0x01
 #define TALLOC_FLAG_LOOP 0x02
+#define TALLOC_FLAG_POOL 0x04 /* chunk is a pool */
+#define TALLOC_FLAG_POOLMEM 0x08 /* chunk was carved out of a pool */
 #define TALLOC_MAGIC_REFERENCE ((const char *)1)
 
 /* by default we abort when given a bad pointer (such as when talloc_free() is
@@ -114,12 +116,22 @@ struct talloc_reference_handle {
 
 typedef int (*talloc_destructor_t)(void *);
 
+/* a block of memory that the children of a pool are carved out of. The
+   block is freed once it is no longer the pool's current block and all
+   the chunks carved out of it have been freed. */
+struct talloc_pool_block {
+    unsigned objects; /* chunks carved out of the block still in use */
+    int current; /* the pool is still allocating from the block */
+    char *start, *next, *end;
+};
+
 struct talloc_chunk {
     struct talloc_chunk *next, *prev;
     struct talloc_chunk *parent, *child;
     struct talloc_reference_handle *refs;
     talloc_destructor_t destructor;
     const char *name;
+    struct talloc_pool_block *pool; /* block a POOLMEM chunk is in */
     size_t size;
     unsigned flags;
 };
@@ -127,6 +139,8 @@ struct talloc_chunk {
 /* 16 byte alignment seems to keep everyone happy */
 #define TC_HDR_SIZE ((sizeof(struct talloc_chunk) + 15) & ~15)
 #define TC_PTR_FROM_CHUNK(tc) ((void *)(TC_HDR_SIZE + (char *)tc))
+#define TC_ALIGN(size) (((size) + 15) & ~(size_t)15)
+#define TALLOC_POOL_BLOCK_HDR_SIZE TC_ALIGN(sizeof(struct talloc_pool_block))
 
 /* panic if we get a bad magic value */
 static inline struct talloc_chunk *talloc_chunk_from_ptr(const void *ptr)
@@ -208,12 +222,145 @@ const char *talloc_parent_name(const void *ptr)
     return tc ? tc->name : NULL;
 }
 
+/*
+  create a pool block with room for size bytes of chunks
+*/
+static struct talloc_pool_block *talloc_pool_block_create(size_t size)
+{
+    struct talloc_pool_block *block;
+
+    block = (struct talloc_pool_block *)malloc(TALLOC_POOL_BLOCK_HDR_SIZE + size);
+    if (unlikely(block == NULL)) {
+        return NULL;
+    }
+
+    block->objects = 0;
+    block->current = 1;
+    block->start = TALLOC_POOL_BLOCK_HDR_SIZE + (char *)block;
+    block->next = block->start;
+    block->end = block->start + size;
+
+    return block;
+}
+
+/*
+  note a chunk carved out of a pool block has been freed. Once a pool's
+  current block is empty it is reused from the start.
+*/
+static inline void talloc_pool_block_release(struct talloc_pool_block *block)
+{
+    if (--block->objects == 0) {
+        if (block->current) {
+            block->next = block->start;
+        } else {
+            free(block);
+        }
+    }
+}
+
+/*
+  note a pool has stopped allocating from a block
+*/
+static inline void talloc_pool_block_retire(struct talloc_pool_block *block)
+{
+    block->current = 0;
+    if (block->objects == 0) {
+        free(block);
+    }
+}
+
+/*
+  carve a chunk out of a pool, returns NULL if the chunk should be
+  allocated on its own
+*/
+static struct talloc_chunk *talloc_pool_alloc(struct talloc_chunk *pool, size_t size)
+{
+    struct talloc_pool_block **current = (struct talloc_pool_block **)TC_PTR_FROM_CHUNK(pool);
+    struct talloc_pool_block *block = *current;
+    size_t block_size = block->end - block->start;
+    size_t chunk_size = TC_ALIGN(TC_HDR_SIZE + size);
+    struct talloc_chunk *tc;
+
+    /* large chunks would waste too much of a block */
+    if (chunk_size > block_size / 8) {
+        return NULL;
+    }
+
+    if (chunk_size > (size_t)(block->end - block->next)) {
+        block = talloc_pool_block_create(block_size);
+        if (unlikely(block == NULL)) {
+            return NULL;
+        }
+        talloc_pool_block_retire(*current);
+        *current = block;
+    }
+
+    tc = (struct talloc_chunk *)block->next;
+    block->next += chunk_size;
+    block->objects++;
+    tc->pool = block;
+
+    return tc;
+}
+
+/*
+  resize a chunk carved out of a pool. The chunk grows in place if it is
+  the last in its block, otherwise it moves out of the pool.
+*/
+static struct talloc_chunk *talloc_pool_realloc(struct talloc_chunk *tc, size_t size)
+{
+    struct talloc_pool_block *block = tc->pool;
+    char *start = (char *)tc;
+    size_t old_size = TC_ALIGN(TC_HDR_SIZE + tc->size);
+    size_t new_size = TC_ALIGN(TC_HDR_SIZE + size);
+    struct talloc_chunk *new_tc;
+
+    if (block->next == start + old_size && new_size <= (size_t)(block->end - start)) {
+        block->next = start + new_size;
+        return tc;
+    }
+
+    if (new_size <= old_size) {
+        return tc;
+    }
+
+    new_tc = (struct talloc_chunk *)malloc(TC_HDR_SIZE + size);
+    if (unlikely(new_tc == NULL)) {
+        return NULL;
+    }
+    memcpy(new_tc, tc, TC_HDR_SIZE + tc->size);
+    new_tc->flags &= ~TALLOC_FLAG_POOLMEM;
+    new_tc->pool = NULL;
+
+    talloc_pool_block_release(block);
+
+    return new_tc;
+}
+
+/*
+  return the memory of a chunk, which must already be unlinked
+*/
+static inline void talloc_chunk_release(struct talloc_chunk *tc)
+{
+    if (unlikely(tc->flags & TALLOC_FLAG_POOL)) {
+        talloc_pool_block_retire(*(struct talloc_pool_block **)TC_PTR_FROM_CHUNK(tc));
+    }
+
+    if (unlikely(tc->flags & TALLOC_FLAG_POOLMEM)) {
+        talloc_pool_block_release(tc->pool);
+    } else {
+        free(tc);
+    }
+}
+
 /*
    Allocate a bit of memory as a child of an existing pointer
 */
 static inline void *__talloc(const void *context, size_t size)
 {
-    struct talloc_chunk *tc;
+    struct talloc_chunk *tc = NULL;
+    struct talloc_chunk *parent = NULL;
+    unsigned flags = TALLOC_MAGIC;
 
     if (unlikely(context == NULL)) {
         context = null_context;
@@ -223,20 +370,30 @@ static inline void *__talloc(const void *context, size_t size)
         return NULL;
     }
 
-    tc = (struct talloc_chunk *)malloc(TC_HDR_SIZE + size);
-    if (unlikely(tc == NULL))
-        return NULL;
+    if (likely(context)) {
+        parent = talloc_chunk_from_ptr(context);
+        if (unlikely(parent->flags & TALLOC_FLAG_POOL)) {
+            tc = talloc_pool_alloc(parent, size);
+            flags |= TALLOC_FLAG_POOLMEM;
+        }
+    }
+
+    if (tc == NULL) {
+        tc = (struct talloc_chunk *)malloc(TC_HDR_SIZE + size);
+        if (unlikely(tc == NULL))
+            return NULL;
+        tc->pool = NULL;
+        flags = TALLOC_MAGIC;
+    }
 
     tc->size = size;
-    tc->flags = TALLOC_MAGIC;
+    tc->flags = flags;
     tc->destructor = NULL;
     tc->child = NULL;
     tc->name = NULL;
     tc->refs = NULL;
 
-    if (likely(context)) {
-        struct talloc_chunk *parent = talloc_chunk_from_ptr(context);
-
+    if (likely(parent)) {
         if (parent->child) {
             parent->child->parent = NULL;
             tc->next = parent->child;
@@ -434,7 +591,7 @@ static inline int _talloc_free(void *ptr)
     }
 
     tc->flags |= TALLOC_FLAG_FREE;
-    free(tc);
+    talloc_chunk_release(tc);
     return 0;
 }
 
@@ -705,6 +862,31 @@ void *talloc_init(const char *fmt, ...)
     return ptr;
 }
 
+/*
+  create a pool context. Its direct children are carved out of blocks of
+  the given size, so allocating them is cheap and their memory is
+  returned a block at a time as they are freed.
+*/
+void *talloc_pool(const void *context, size_t size)
+{
+    struct talloc_pool_block **current;
+
+    current = (struct talloc_pool_block **)_talloc_named_const(context, sizeof(*current), "talloc_pool");
+    if (unlikely(current == NULL)) {
+        return NULL;
+    }
+
+    *current = talloc_pool_block_create(size);
+    if (unlikely(*current == NULL)) {
+        _talloc_free(current);
+        return NULL;
+    }
+
+    talloc_chunk_from_ptr(current)->flags |= TALLOC_FLAG_POOL;
+
+    return current;
+}
+
 /*
   this is a replacement for the Samba3 talloc_destroy_pool functionality. It
   should probably not be used in new code. It's in here to keep the talloc
@@ -818,15 +1000,19 @@ void *_talloc_realloc(const void *context, void *ptr, size_t size, const char *n
     /* by resetting magic we catch users of the old memory */
     tc->flags |= TALLOC_FLAG_FREE;
 
+    if (unlikely(tc->flags & TALLOC_FLAG_POOLMEM)) {
+        new_ptr = talloc_pool_realloc(tc, size);
+    } else {
 #if ALWAYS_REALLOC
-    new_ptr = malloc(size + TC_HDR_SIZE);
-    if (new_ptr) {
-        memcpy(new_ptr, tc, tc->size + TC_HDR_SIZE);
-        free(tc);
-    }
+        new_ptr = malloc(size + TC_HDR_SIZE);
+        if (new_ptr) {
+            memcpy(new_ptr, tc, tc->size + TC_HDR_SIZE);
+            free(tc);
+        }
 #else
-    new_ptr = realloc(tc, size + TC_HDR_SIZE);
+        new_ptr = realloc(tc, size + TC_HDR_SIZE);
 #endif
+    }
     if (unlikely(!new_ptr)) {
         tc->flags &= ~TALLOC_FLAG_FREE;
         return NULL;
@@ -134,6 +134,7 @@ void *talloc_check_name(const void *ptr, const char *name);
 void *talloc_parent(const void *ptr);
 const char *talloc_parent_name(const void *ptr);
 void *talloc_init(const char *fmt, ...) PRINTF_ATTRIBUTE(1, 2);
+void *talloc_pool(const void *context, size_t size);
 int talloc_free(void *ptr);
 void talloc_free_children(void *ptr);
 void *_talloc_realloc(const void *context, void *ptr, size_t size, const char *name);
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Structured event tracing (implementation).
+ *
+ * Every recording thread owns a ring of events which only it writes, so
+ * recording needs no locks: the event is filled in and then published by
+ * advancing the ring's head with a release store.  A dump reads the head
+ * with an acquire load, copies the ring and then discards any events the
+ * owning thread may have overwritten during the copy.
+ *
+ * Only built when WISP_ENABLE_TRACE is on.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "utils/trace.h"
+
+/** Events kept by each thread, a power of two */
+#define TRACE_RING_SIZE (1 << 16)
+
+/** The process id written with every event */
+#define TRACE_PID 1
+
+/**
+ * A recorded event
+ */
+struct trace_event {
+    uint64_t ts; /**< When the event was recorded, in nanoseconds */
+    const char *category;
+    const char *name;
+    const char *arg; /**< Name of the argument or NULL */
+    int64_t value; /**< Value of the argument or counter */
+    uint64_t id; /**< Identifier of asynchronous spans and flows */
+    enum trace_type type;
+};
+
+/**
+ * The events recorded by one thread
+ */
+struct trace_ring {
+    struct trace_ring *next; /**< Next ring in the list of all rings */
+    unsigned int tid; /**< Thread id written with the events */
+    const char *thread_name; /**< Name of the thread or NULL */
+    uint64_t head; /**< Number of events ever recorded */
+    struct trace_event events[TRACE_RING_SIZE];
+};
+
+/** The ring of the calling thread */
+static __thread struct trace_ring *trace_ring_self;
+
+/** Every ring, newest first */
+static struct trace_ring *trace_rings;
+
+/** The thread id given to the last ring created */
+static unsigned int trace_last_tid;
+
+
+/**
+ * Read a monotonic clock in nanoseconds.
+ */
+static uint64_t trace_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart * 1000000000 +
+        (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+/**
+ * Get the ring of the calling thread, creating it on first use.
+ *
+ * \return The ring or NULL if it could not be allocated.
+ */
+static struct trace_ring *trace_get_ring(void)
+{
+    struct trace_ring *ring = trace_ring_self;
+
+    if (ring != NULL) {
+        return ring;
+    }
+
+    ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->tid = __atomic_add_fetch(&trace_last_tid, 1, __ATOMIC_RELAXED);
+
+    ring->next = __atomic_load_n(&trace_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(
+        &trace_rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        /* ring->next was updated with the current list head */
+    }
+
+    trace_ring_self = ring;
+    return ring;
+}
+
+
+/* exported interface documented in utils/trace.h */
+void trace_record(
+    enum trace_type type, const char *category, const char *name, uint64_t id, const char *arg, int64_t value)
+{
+    struct trace_ring *ring = trace_get_ring();
+    struct trace_event *event;
+    uint64_t head;
+
+    if (ring == NULL) {
+        return;
+    }
+
+    head = ring->head;
+    event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+    event->ts = trace_clock();
+    event->category = category;
+    event->name = name;
+    event->arg = arg;
+    event->value = value;
+    event->id = id;
+    event->type = type;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+/* exported interface documented in utils/trace.h */
+void trace_set_thread_name(const char *name)
+{
+    struct trace_ring *ring = trace_get_ring();
+
+    if (ring != NULL) {
+        __atomic_store_n(&ring->thread_name, name, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * Write a string as a JSON string literal.
+ */
+static void trace_write_string(FILE *fh, const char *str)
+{
+    const unsigned char *c;
+
+    fputc('"', fh);
+    for (c = (const unsigned char *)str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', fh);
+            fputc(*c, fh);
+        } else if (*c < 0x20) {
+            fprintf(fh, "\\u%04x", *c);
+        } else {
+            fputc(*c, fh);
+        }
+    }
+    fputc('"', fh);
+}
+
+
+/**
+ * Write one event as a Chrome trace event object.
+ */
+static void trace_write_event(FILE *fh, unsigned int tid, const struct trace_event *event)
+{
+    static const char phases[] = {
+        [TRACE_TYPE_BEGIN] = 'B',
+        [TRACE_TYPE_END] = 'E',
+        [TRACE_TYPE_INSTANT] = 'i',
+        [TRACE_TYPE_COUNTER] = 'C',
+        [TRACE_TYPE_ASYNC_BEGIN] = 'b',
+        [TRACE_TYPE_ASYNC_END] = 'e',
+        [TRACE_TYPE_FLOW_BEGIN] = 's',
+        [TRACE_TYPE_FLOW_STEP] = 't',
+        [TRACE_TYPE_FLOW_END] = 'f',
+    };
+
+    fputs("{\"cat\":", fh);
+    trace_write_string(fh, event->category);
+    fputs(",\"name\":", fh);
+    trace_write_string(fh, event->name);
+    fprintf(fh, ",\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%" PRIu64 ".%03u", phases[event->type], TRACE_PID,
+        tid, event->ts / 1000, (unsigned int)(event->ts % 1000));
+
+    switch (event->type) {
+    case TRACE_TYPE_INSTANT:
+        fputs(",\"s\":\"t\"", fh);
+        break;
+
+    case TRACE_TYPE_COUNTER:
+        fprintf(fh, ",\"args\":{\"value\":%" PRId64 "}", event->value);
+        break;
+
+    case TRACE_TYPE_FLOW_END:
+        fputs(",\"bp\":\"e\"", fh);
+        /* fall through */
+    case TRACE_TYPE_ASYNC_BEGIN:
+    case TRACE_TYPE_ASYNC_END:
+    case TRACE_TYPE_FLOW_BEGIN:
+    case TRACE_TYPE_FLOW_STEP:
+        fprintf(fh, ",\"id\":\"0x%" PRIx64 "\"", event->id);
+        break;
+
+    default:
+        break;
+    }
+
+    if (event->arg != NULL) {
+        fputs(",\"args\":{", fh);
+        trace_write_string(fh, event->arg);
+        fprintf(fh, ":%" PRId64 "}", event->value);
+    }
+
+    fputc('}', fh);
+}
+
+
+/**
+ * Write the events currently held by a ring.
+ *
+ * \param fh The file to write to.
+ * \param ring The ring to write.
+ * \param copy Space for a copy of the ring's events.
+ * \param first Whether no event has been written yet, updated.
+ * \return The number of events lost to the ring wrapping.
+ */
+static uint64_t trace_write_ring(FILE *fh, struct trace_ring *ring, struct trace_event *copy, bool *first)
+{
+    const char *thread_name;
+    uint64_t head, tail, after, index;
+
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    tail = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+    for (index = tail; index < head; index++) {
+        copy[index & (TRACE_RING_SIZE - 1)] = ring->events[index & (TRACE_RING_SIZE - 1)];
+    }
+
+    /* events the owner recorded during the copy may have replaced some */
+    after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (after > TRACE_RING_SIZE && after - TRACE_RING_SIZE > tail) {
+        tail = (after - TRACE_RING_SIZE < head) ? after - TRACE_RING_SIZE : head;
+    }
+
+    thread_name = __atomic_load_n(&ring->thread_name, __ATOMIC_RELAXED);
+    if (thread_name != NULL) {
+        fprintf(fh, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+            *first ? "" : ",\n", TRACE_PID, ring->tid);
+        trace_write_string(fh, thread_name);
+        fputs("}}", fh);
+        *first = false;
+    }
+
+    for (index = tail; index < head; index++) {
+        if (!*first) {
+            fputs(",\n", fh);
+        }
+        trace_write_event(fh, ring->tid, &copy[index & (TRACE_RING_SIZE - 1)]);
+        *first = false;
+    }
+
+    return tail;
+}
+
+
+/* exported interface documented in utils/trace.h */
+nserror trace_dump(const char *path)
+{
+    struct trace_event *copy;
+    struct trace_ring *ring;
+    uint64_t dropped = 0;
+    bool first = true;
+    FILE *fh;
+    int res;
+
+    copy = malloc(sizeof(*copy) * TRACE_RING_SIZE);
+    if (copy == NULL) {
+        return NSERROR_NOMEM;
+    }
+
+    fh = fopen(path, "w");
+    if (fh == NULL) {
+        free(copy);
+        return NSERROR_SAVE_FAILED;
+    }
+
+    fputs("{\"traceEvents\":[\n", fh);
+    for (ring = __atomic_load_n(&trace_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        dropped += trace_write_ring(fh, ring, copy, &first);
+    }
+    fprintf(fh, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":\"%" PRIu64 "\"}}\n", dropped);
+
+    free(copy);
+
+    res = ferror(fh);
+    if (fclose(fh) != 0 || res != 0) {
+        return NSERROR_SAVE_FAILED;
+    }
+
+    return NSERROR_OK;
+}
+
+
+/* exported interface documented in utils/trace.h */
+void trace_finalise(void)
+{
+    struct trace_ring *ring = __atomic_exchange_n(&trace_rings, NULL, __ATOMIC_ACQUIRE);
+    struct trace_ring *next;
+
+    for (; ring != NULL; ring = next) {
+        next = ring->next;
+        free(ring);
+    }
+    trace_ring_self = NULL;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2026 Wisp Contributors
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Structured event tracing (interface).
+ *
+ * Enable via CMake: -DWISP_ENABLE_TRACE=ON
+ *
+ * Events are recorded into a ring buffer owned by the recording thread,
+ * without locks or formatting, and written out as Chrome trace event
+ * JSON by trace_dump(), for chrome://tracing or https://ui.perfetto.dev.
+ * Each ring keeps the most recent events, older ones being overwritten.
+ *
+ * Categories, names and argument names are stored by reference, so must
+ * be string literals or otherwise outlive the trace.
+ *
+ * Usage:
+ *   TRACE_BEGIN("html", "layout");
+ *   ...
+ *   TRACE_END("html", "layout");
+ *
+ * When tracing is disabled every macro compiles to nothing and its
+ * arguments are not evaluated.
+ */
+
+#ifndef _WISP_UTILS_TRACE_H_
+#define _WISP_UTILS_TRACE_H_
+
+#ifdef WISP_TRACE_ENABLED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <wisp/utils/errors.h>
+
+/**
+ * Types of trace event
+ */
+enum trace_type {
+    TRACE_TYPE_BEGIN, /**< Start of a span on the recording thread */
+    TRACE_TYPE_END, /**< End of the innermost span on the recording thread */
+    TRACE_TYPE_INSTANT, /**< A point in time */
+    TRACE_TYPE_COUNTER, /**< A new value of a counter */
+    TRACE_TYPE_ASYNC_BEGIN, /**< Start of a span identified by id, which may end on any thread */
+    TRACE_TYPE_ASYNC_END, /**< End of a span identified by id */
+    TRACE_TYPE_FLOW_BEGIN, /**< Start of a flow identified by id, from the enclosing span */
+    TRACE_TYPE_FLOW_STEP, /**< Continuation of a flow through the enclosing span */
+    TRACE_TYPE_FLOW_END, /**< End of a flow in the enclosing span */
+};
+
+/**
+ * Record a trace event.
+ *
+ * Use the TRACE_ macros rather than calling this directly.
+ *
+ * \param type The type of event.
+ * \param category The event category.
+ * \param name The event name.
+ * \param id Identifier of asynchronous spans and flows, else 0.
+ * \param arg Name of the argument recorded with the event or NULL.
+ * \param value Value of the argument, or of a counter.
+ */
+void trace_record(
+    enum trace_type type, const char *category, const char *name, uint64_t id, const char *arg, int64_t value);
+
+/**
+ * Name the calling thread in the trace.
+ *
+ * \param name The name, which must outlive the trace.
+ */
+void trace_set_thread_name(const char *name);
+
+/**
+ * Write the events recorded by every thread as Chrome trace event JSON.
+ *
+ * Recording may continue while the trace is written, but events recorded
+ * meanwhile may be left out.
+ *
+ * \param path The file to write.
+ * \return NSERROR_OK on success, NSERROR_SAVE_FAILED if the file could not
+ *         be written or NSERROR_NOMEM.
+ */
+nserror trace_dump(const char *path);
+
+/**
+ * Discard every recorded event and free the ring buffers.
+ *
+ * No thread may record events while, or after, this is called.
+ */
+void trace_finalise(void);
+
+#define TRACE_BEGIN(cat, name) trace_record(TRACE_TYPE_BEGIN, (cat), (name), 0, NULL, 0)
+#define TRACE_BEGIN_ARG(cat, name, arg, value) trace_record(TRACE_TYPE_BEGIN, (cat), (name), 0, (arg), (value))
+#define TRACE_END(cat, name) trace_record(TRACE_TYPE_END, (cat), (name), 0, NULL, 0)
+#define TRACE_INSTANT(cat, name) trace_record(TRACE_TYPE_INSTANT, (cat), (name), 0, NULL, 0)
+#define TRACE_COUNTER(cat, name, value) trace_record(TRACE_TYPE_COUNTER, (cat), (name), 0, NULL, (value))
+#define TRACE_ASYNC_BEGIN(cat, name, id) trace_record(TRACE_TYPE_ASYNC_BEGIN, (cat), (name), (id), NULL, 0)
+#define TRACE_ASYNC_END(cat, name, id) trace_record(TRACE_TYPE_ASYNC_END, (cat), (name), (id), NULL, 0)
+#define TRACE_FLOW_BEGIN(cat, name, id) trace_record(TRACE_TYPE_FLOW_BEGIN, (cat), (name), (id), NULL, 0)
+#define TRACE_FLOW_STEP(cat, name, id) trace_record(TRACE_TYPE_FLOW_STEP, (cat), (name), (id), NULL, 0)
+#define TRACE_FLOW_END(cat, name, id) trace_record(TRACE_TYPE_FLOW_END, (cat), (name), (id), NULL, 0)
+#define TRACE_THREAD_NAME(name) trace_set_thread_name(name)
+
+/** Identifier for asynchronous spans and flows from a pointer */
+#define TRACE_ID(ptr) ((uint64_t)(uintptr_t)(ptr))
+
+#else
+
+#define TRACE_BEGIN(cat, name) ((void)0)
+#define TRACE_BEGIN_ARG(cat, name, arg, value) ((void)0)
+#define TRACE_END(cat, name) ((void)0)
+#define TRACE_INSTANT(cat, name) ((void)0)
+#define TRACE_COUNTER(cat, name, value) ((void)0)
+#define TRACE_ASYNC_BEGIN(cat, name, id) ((void)0)
+#define TRACE_ASYNC_END(cat, name, id) ((void)0)
+#define TRACE_FLOW_BEGIN(cat, name, id) ((void)0)
+#define TRACE_FLOW_STEP(cat, name, id) ((void)0)
+#define TRACE_FLOW_END(cat, name, id) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif /* WISP_TRACE_ENABLED */
+
+#endif